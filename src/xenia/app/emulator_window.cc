@@ -1110,6 +1110,13 @@ void EmulatorWindow::OnKeyDown(ui::KeyEvent& e) {
       RunPreviouslyPlayedTitle();
     } break;
 
+    case ui::VirtualKey::kBack: {
+      RewindBuffer* rewind_buffer = emulator()->rewind_buffer();
+      if (rewind_buffer) {
+        rewind_buffer->RequestRewind();
+      }
+    } break;
+
     default:
       return;
   }
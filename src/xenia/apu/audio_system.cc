@@ -112,7 +112,7 @@ void AudioSystem::WorkerThreadMain() {
     uint32_t client_callback = 0;
     uint32_t client_callback_arg = 0;
     {
-      auto global_lock = global_critical_region_.Acquire();
+      auto audio_lock = critical_region_.Acquire();
 
       for (size_t i = 0; i < kMaximumClientCount; ++i) {
         if (!clients_[i].in_use ||
@@ -210,14 +210,13 @@ void AudioSystem::Shutdown() {
 
   // Unregister all active clients to shut down their audio drivers before
   // the semaphores are destroyed with this AudioSystem.
+  uint32_t wrapped_callback_args[kMaximumClientCount] = {};
   {
-    auto global_lock = global_critical_region_.Acquire();
+    auto audio_lock = critical_region_.Acquire();
     for (size_t i = 0; i < kMaximumClientCount; ++i) {
       if (clients_[i].in_use) {
         DestroyDriver(clients_[i].driver);
-        if (clients_[i].wrapped_callback_arg) {
-          memory()->SystemHeapFree(clients_[i].wrapped_callback_arg);
-        }
+        wrapped_callback_args[i] = clients_[i].wrapped_callback_arg;
         clients_[i].driver = nullptr;
         clients_[i].callback = 0;
         clients_[i].callback_arg = 0;
@@ -226,11 +225,22 @@ void AudioSystem::Shutdown() {
       }
     }
   }
+  // The system heap is under the global critical region, which can't be
+  // acquired within the audio lock domain.
+  for (uint32_t wrapped_callback_arg : wrapped_callback_args) {
+    if (wrapped_callback_arg) {
+      memory()->SystemHeapFree(wrapped_callback_arg);
+    }
+  }
 }
 
 X_STATUS AudioSystem::RegisterClient(uint32_t callback, uint32_t callback_arg,
                                      size_t* out_index) {
-  auto global_lock = global_critical_region_.Acquire();
+  // Allocated before entering the audio lock domain, see Shutdown.
+  uint32_t ptr = memory()->SystemHeapAlloc(0x4);
+  xe::store_and_swap<uint32_t>(memory()->TranslateVirtual(ptr), callback_arg);
+
+  auto audio_lock = critical_region_.Acquire();
 
   auto index = FindFreeClient();
   assert_true(index >= 0);
@@ -244,6 +254,8 @@ X_STATUS AudioSystem::RegisterClient(uint32_t callback, uint32_t callback_arg,
   if (XFAILED(result)) {
     XELOGE("AudioSystem::RegisterClient: CreateDriver failed for index={}",
            index);
+    audio_lock.unlock();
+    memory()->SystemHeapFree(ptr);
     return result;
   }
   assert_not_null(driver);
@@ -251,9 +263,6 @@ X_STATUS AudioSystem::RegisterClient(uint32_t callback, uint32_t callback_arg,
       "AudioSystem::RegisterClient: driver created for index={}, driver={:p}",
       index, (void*)driver);
 
-  uint32_t ptr = memory()->SystemHeapAlloc(0x4);
-  xe::store_and_swap<uint32_t>(memory()->TranslateVirtual(ptr), callback_arg);
-
   clients_[index] = {};
   clients_[index].driver = driver;
   clients_[index].callback = callback;
@@ -277,7 +286,7 @@ X_STATUS AudioSystem::RegisterClient(uint32_t callback, uint32_t callback_arg,
 void AudioSystem::SubmitFrame(size_t index, float* samples) {
   SCOPE_profile_cpu_f("apu");
 
-  auto global_lock = global_critical_region_.Acquire();
+  auto audio_lock = critical_region_.Acquire();
   assert_true(index < kMaximumClientCount);
   if (index >= kMaximumClientCount || !clients_[index].in_use ||
       !clients_[index].driver) {
@@ -302,10 +311,10 @@ void AudioSystem::SubmitFrame(size_t index, float* samples) {
 void AudioSystem::UnregisterClient(size_t index) {
   SCOPE_profile_cpu_f("apu");
 
-  auto global_lock = global_critical_region_.Acquire();
+  auto audio_lock = critical_region_.Acquire();
   assert_true(index < kMaximumClientCount);
   DestroyDriver(clients_[index].driver);
-  memory()->SystemHeapFree(clients_[index].wrapped_callback_arg);
+  uint32_t wrapped_callback_arg = clients_[index].wrapped_callback_arg;
   clients_[index] = {0};
 
   // Drain the semaphore of its count.
@@ -316,6 +325,10 @@ void AudioSystem::UnregisterClient(size_t index) {
                                       std::chrono::milliseconds(0));
   } while (wait_result == xe::threading::WaitResult::kSuccess);
   assert_true(wait_result == xe::threading::WaitResult::kTimeout);
+
+  // See Shutdown.
+  audio_lock.unlock();
+  memory()->SystemHeapFree(wrapped_callback_arg);
 }
 
 bool AudioSystem::Save(ByteStream* stream) {
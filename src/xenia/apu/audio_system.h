@@ -80,7 +80,9 @@ class AudioSystem {
   std::atomic<bool> worker_running_ = {false};
   kernel::object_ref<kernel::XHostThread> worker_thread_;
 
-  xe::global_critical_region global_critical_region_;
+  // Protects clients_. Own lock domain rather than the global critical region,
+  // the worker thread takes it for every pump.
+  xe::lock_domain_critical_region<xe::LockDomain::kAudio> critical_region_;
   static constexpr size_t kMaximumClientCount = 8;
   struct {
     AudioDriver* driver;
@@ -0,0 +1,372 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xenia/apu/xma_context_new.h"
+#include "xenia/apu/xma_helpers.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/memory.h"
+#include "xenia/base/threading.h"
+#include "xenia/memory.h"
+
+DEFINE_path(xma_decode_bench_input, "",
+            "XMA2 .xma or .wav file, or directory of them, with the streams to "
+            "decode.",
+            "APU");
+DEFINE_uint32(xma_decode_bench_voices, 64,
+              "Number of voices decoded at the same time, cycling through the "
+              "input streams.",
+              "APU");
+DEFINE_uint32(xma_decode_bench_max_threads, 0,
+              "Largest benchmarked decoding thread count, each count is twice "
+              "the previous one. 0 to use the logical processor count.",
+              "APU");
+DEFINE_uint32(xma_decode_bench_seconds, 10,
+              "Seconds of audio decoded by every voice for each thread count.",
+              "APU");
+
+namespace xe {
+namespace apu {
+
+namespace {
+
+constexpr uint16_t kXma2FormatTag = 0x166;
+// The largest output ring buffer a context can have.
+constexpr uint32_t kBenchOutputBlockCount = 31;
+// A whole stereo frame per decoding pass.
+constexpr uint32_t kBenchSubframeDecodeCount = 8;
+// Kicks without any output after which a voice is considered broken.
+constexpr uint32_t kMaxStalledKicks = 16;
+
+struct BenchStream {
+  std::filesystem::path path;
+  uint32_t physical_address;
+  uint32_t packet_count;
+  uint32_t channel_count;
+  uint32_t sample_rate_id;
+};
+
+struct BenchVoice {
+  std::unique_ptr<XmaContextNew> context;
+  const BenchStream* stream;
+  uint64_t samples_decoded;
+  uint32_t stalled_kicks;
+  bool failed;
+};
+
+// Loads the packets from the data chunk of an XMA2 RIFF file, as written by
+// xma2encode, to guest physical memory.
+bool LoadStream(const std::filesystem::path& path, Memory* memory,
+                BenchStream& stream) {
+  std::vector<uint8_t> file_data;
+  {
+    FILE* file = filesystem::OpenFile(path, "rb");
+    if (!file) {
+      XELOGW("{}: Unable to open the file", path);
+      return false;
+    }
+    file_data.resize(size_t(std::filesystem::file_size(path)));
+    bool read = fread(file_data.data(), 1, file_data.size(), file) ==
+                file_data.size();
+    fclose(file);
+    if (!read) {
+      XELOGW("{}: Unable to read the file", path);
+      return false;
+    }
+  }
+  if (file_data.size() < 12 || std::memcmp(file_data.data(), "RIFF", 4) ||
+      std::memcmp(file_data.data() + 8, "WAVE", 4)) {
+    XELOGW("{}: Not a RIFF WAVE file", path);
+    return false;
+  }
+  const uint8_t* format = nullptr;
+  const uint8_t* packets = nullptr;
+  uint32_t packets_size = 0;
+  size_t offset = 12;
+  while (offset + 8 <= file_data.size()) {
+    const uint8_t* chunk = file_data.data() + offset;
+    uint32_t chunk_size = xe::load<uint32_t>(chunk + 4);
+    if (chunk_size > file_data.size() - offset - 8) {
+      break;
+    }
+    if (!std::memcmp(chunk, "fmt ", 4) && chunk_size >= 16) {
+      format = chunk + 8;
+    } else if (!std::memcmp(chunk, "data", 4)) {
+      packets = chunk + 8;
+      packets_size = chunk_size;
+    }
+    offset += 8 + size_t(chunk_size) + (chunk_size & 1);
+  }
+  if (!format || xe::load<uint16_t>(format) != kXma2FormatTag) {
+    XELOGW("{}: Not an XMA2 file", path);
+    return false;
+  }
+  stream.path = path;
+  stream.channel_count = xe::load<uint16_t>(format + 2);
+  if (stream.channel_count < 1 || stream.channel_count > 2) {
+    XELOGW("{}: {} channels, only mono and stereo streams are supported", path,
+           stream.channel_count);
+    return false;
+  }
+  uint32_t sample_rate = xe::load<uint32_t>(format + 4);
+  auto sample_rate_it = std::find(std::begin(kIdToSampleRate),
+                                  std::end(kIdToSampleRate), int(sample_rate));
+  if (sample_rate_it == std::end(kIdToSampleRate)) {
+    XELOGW("{}: Unsupported sample rate {}", path, sample_rate);
+    return false;
+  }
+  stream.sample_rate_id =
+      uint32_t(sample_rate_it - std::begin(kIdToSampleRate));
+  // A context input buffer can't have more packets.
+  stream.packet_count =
+      std::min(packets_size / XmaContext::kBytesPerPacket, uint32_t(4095));
+  if (!stream.packet_count) {
+    XELOGW("{}: No XMA packets", path);
+    return false;
+  }
+  uint32_t size = stream.packet_count * XmaContext::kBytesPerPacket;
+  uint32_t address =
+      memory->SystemHeapAlloc(size, XmaContext::kBytesPerPacket,
+                              kSystemHeapPhysical);
+  if (!address) {
+    XELOGE("{}: Failed to allocate {} bytes of physical memory", path, size);
+    return false;
+  }
+  std::memcpy(memory->TranslateVirtual(address), packets, size);
+  stream.physical_address = memory->GetPhysicalAddress(address);
+  return true;
+}
+
+// Makes the context play the stream from the beginning, streaming it from both
+// input buffers.
+void ResetVoice(BenchVoice& voice, Memory* memory, uint32_t output_address) {
+  voice.context->Clear();
+  uint8_t* context_ptr = memory->TranslateVirtual(voice.context->guest_ptr());
+  std::memset(context_ptr, 0, sizeof(XMA_CONTEXT_DATA));
+  XMA_CONTEXT_DATA data(context_ptr);
+  const BenchStream& stream = *voice.stream;
+  data.input_buffer_0_ptr = stream.physical_address;
+  data.input_buffer_0_packet_count = stream.packet_count;
+  data.input_buffer_0_valid = 1;
+  data.input_buffer_1_ptr = stream.physical_address;
+  data.input_buffer_1_packet_count = stream.packet_count;
+  data.input_buffer_1_valid = 1;
+  data.input_buffer_read_offset = xma::GetPacketFrameOffset(
+      memory->TranslatePhysical(stream.physical_address));
+  data.output_buffer_ptr = memory->GetPhysicalAddress(output_address);
+  data.output_buffer_block_count = kBenchOutputBlockCount;
+  data.output_buffer_valid = 1;
+  data.subframe_decode_count = kBenchSubframeDecodeCount;
+  data.sample_rate = stream.sample_rate_id;
+  data.is_stereo = stream.channel_count == 2;
+  data.Store(context_ptr);
+  voice.samples_decoded = 0;
+  voice.stalled_kicks = 0;
+  voice.failed = false;
+}
+
+// Does what a title streaming the audio does every time it mixes: reads all
+// of the output, queues the consumed input buffer again, and kicks the
+// context.
+void KickVoice(BenchVoice& voice, Memory* memory) {
+  uint8_t* context_ptr = memory->TranslateVirtual(voice.context->guest_ptr());
+  XMA_CONTEXT_DATA data(context_ptr);
+  data.input_buffer_0_valid = 1;
+  data.input_buffer_1_valid = 1;
+  data.output_buffer_read_offset = data.output_buffer_write_offset;
+  data.output_buffer_valid = 1;
+  data.error_status = 0;
+  data.Store(context_ptr);
+
+  voice.context->Enable();
+  voice.context->Work();
+
+  XMA_CONTEXT_DATA decoded_data(context_ptr);
+  uint32_t blocks_written =
+      (decoded_data.output_buffer_write_offset + kBenchOutputBlockCount -
+       data.output_buffer_read_offset) %
+      kBenchOutputBlockCount;
+  // The write offset wraps around to the read offset when the whole buffer is
+  // filled, and the output buffer is invalidated.
+  if (!blocks_written && !decoded_data.output_buffer_valid) {
+    blocks_written = kBenchOutputBlockCount;
+  }
+  if (!blocks_written) {
+    if (++voice.stalled_kicks >= kMaxStalledKicks) {
+      XELOGW("{}: The stream stopped decoding", voice.stream->path);
+      voice.failed = true;
+    }
+    return;
+  }
+  voice.stalled_kicks = 0;
+  voice.samples_decoded +=
+      blocks_written * XmaContext::kOutputBytesPerBlock /
+      (XmaContext::kBytesPerSample * voice.stream->channel_count);
+}
+
+}  // namespace
+
+// Decodes --xma_decode_bench_voices voices at once through XmaContextNew, with
+// the voices sharded across an increasing number of threads like the contexts
+// are across the --xma_decoder_threads workers, and reports how many times
+// faster than real time the audio is decoded.
+int xma_decode_bench_main(const std::vector<std::string>& args) {
+  if (cvars::xma_decode_bench_input.empty()) {
+    XELOGE("No input XMA file or directory specified");
+    return 1;
+  }
+  auto memory = std::make_unique<Memory>();
+  if (!memory->Initialize()) {
+    XELOGE("Failed to initialize the memory");
+    return 1;
+  }
+
+  std::vector<std::filesystem::path> paths;
+  if (std::filesystem::is_directory(cvars::xma_decode_bench_input)) {
+    for (const filesystem::FileInfo& file_info :
+         filesystem::ListFiles(cvars::xma_decode_bench_input)) {
+      if (file_info.type == filesystem::FileInfo::Type::kFile) {
+        paths.push_back(file_info.path / file_info.name);
+      }
+    }
+    std::sort(paths.begin(), paths.end());
+  } else {
+    paths.push_back(cvars::xma_decode_bench_input);
+  }
+  std::vector<BenchStream> streams;
+  for (const std::filesystem::path& path : paths) {
+    BenchStream stream;
+    if (LoadStream(path, memory.get(), stream)) {
+      streams.push_back(std::move(stream));
+    }
+  }
+  if (streams.empty()) {
+    XELOGE("No XMA2 streams loaded from {}", cvars::xma_decode_bench_input);
+    return 1;
+  }
+
+  uint32_t voice_count = std::max(cvars::xma_decode_bench_voices, uint32_t(1));
+  uint32_t context_data_address = memory->SystemHeapAlloc(
+      sizeof(XMA_CONTEXT_DATA) * voice_count, 256, kSystemHeapPhysical);
+  uint32_t output_size =
+      kBenchOutputBlockCount * XmaContext::kOutputBytesPerBlock;
+  uint32_t output_address = memory->SystemHeapAlloc(
+      output_size * voice_count, XmaContext::kOutputBytesPerBlock,
+      kSystemHeapPhysical);
+  if (!context_data_address || !output_address) {
+    XELOGE("Failed to allocate the contexts");
+    return 1;
+  }
+  std::vector<BenchVoice> voices(voice_count);
+  for (uint32_t i = 0; i < voice_count; ++i) {
+    BenchVoice& voice = voices[i];
+    voice.context = std::make_unique<XmaContextNew>();
+    if (voice.context->Setup(
+            i, memory.get(),
+            context_data_address + i * uint32_t(sizeof(XMA_CONTEXT_DATA)))) {
+      XELOGE("Failed to set up the XMA context");
+      return 1;
+    }
+    voice.context->set_is_allocated(true);
+    voice.stream = &streams[i % streams.size()];
+  }
+  XELOGI("Decoding {} voices from {} streams, {} seconds each", voice_count,
+         streams.size(), cvars::xma_decode_bench_seconds);
+
+  uint32_t max_thread_count = cvars::xma_decode_bench_max_threads;
+  if (!max_thread_count) {
+    max_thread_count =
+        std::max(uint32_t(1), xe::threading::logical_processor_count());
+  }
+  max_thread_count = std::min(max_thread_count, voice_count);
+  double tick_frequency = double(Clock::QueryHostTickFrequency());
+  double single_thread_factor = 0.0;
+  for (uint32_t thread_count = 1;;
+       thread_count = std::min(thread_count * 2, max_thread_count)) {
+    for (uint32_t i = 0; i < voice_count; ++i) {
+      ResetVoice(voices[i], memory.get(), output_address + i * output_size);
+    }
+    auto decode_shard = [&voices, &memory, thread_count](uint32_t shard) {
+      bool decoding;
+      do {
+        decoding = false;
+        for (uint32_t i = shard; i < voices.size(); i += thread_count) {
+          BenchVoice& voice = voices[i];
+          if (voice.failed ||
+              voice.samples_decoded >=
+                  uint64_t(cvars::xma_decode_bench_seconds) *
+                      uint64_t(kIdToSampleRate[voice.stream->sample_rate_id])) {
+            continue;
+          }
+          KickVoice(voice, memory.get());
+          decoding = true;
+        }
+      } while (decoding);
+    };
+
+    uint64_t start_ticks = Clock::QueryHostTickCount();
+    std::vector<std::unique_ptr<xe::threading::Thread>> threads;
+    for (uint32_t i = 1; i < thread_count; ++i) {
+      auto thread = xe::threading::Thread::Create(
+          {}, [&decode_shard, i]() { decode_shard(i); });
+      if (!thread) {
+        XELOGE("Failed to create a decoding thread");
+        return 1;
+      }
+      thread->set_name("XMA Decode Bench");
+      threads.push_back(std::move(thread));
+    }
+    decode_shard(0);
+    for (auto& thread : threads) {
+      xe::threading::Wait(thread.get(), false);
+    }
+    double seconds =
+        double(Clock::QueryHostTickCount() - start_ticks) / tick_frequency;
+
+    double audio_seconds = 0.0;
+    uint32_t failed_voice_count = 0;
+    for (const BenchVoice& voice : voices) {
+      audio_seconds += double(voice.samples_decoded) /
+                       double(kIdToSampleRate[voice.stream->sample_rate_id]);
+      failed_voice_count += uint32_t(voice.failed);
+    }
+    double real_time_factor = audio_seconds / std::max(seconds, 1e-9);
+    if (thread_count == 1) {
+      single_thread_factor = real_time_factor;
+    }
+    XELOGI(
+        "{} threads: {:.1f}x real time, {:.2f}x the single thread, {:.1f} "
+        "seconds of audio in {:.3f} seconds, {} voices stopped decoding",
+        thread_count, real_time_factor,
+        real_time_factor / std::max(single_thread_factor, 1e-9), audio_seconds,
+        seconds, failed_voice_count);
+    if (thread_count >= max_thread_count) {
+      break;
+    }
+  }
+  return 0;
+}
+
+}  // namespace apu
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-apu-xma-decode-bench",
+                      xe::apu::xma_decode_bench_main, "streams",
+                      "xma_decode_bench_input");
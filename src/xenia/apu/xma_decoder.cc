@@ -9,6 +9,9 @@
 
 #include "xenia/apu/xma_decoder.h"
 
+#include <algorithm>
+
+#include "third_party/fmt/include/fmt/format.h"
 #include "xenia/apu/xma_context.h"
 #include "xenia/apu/xma_context_fake.h"
 #include "xenia/apu/xma_context_master.h"
@@ -21,6 +24,7 @@
 #include "xenia/base/profiling.h"
 #include "xenia/base/ring_buffer.h"
 #include "xenia/base/string_buffer.h"
+#include "xenia/base/threading.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/cpu/thread_state.h"
 #include "xenia/kernel/kernel_state.h"
@@ -61,6 +65,12 @@ DEFINE_bool(use_dedicated_xma_thread, true,
             "better results, but decrease performance a bit.",
             "APU");
 
+DEFINE_int32(xma_decoder_threads, -1,
+             "Number of threads decoding XMA audio with "
+             "use_dedicated_xma_thread, each context is always decoded by the "
+             "same thread. -1 to use a quarter of the logical processors.",
+             "APU");
+
 DEFINE_string(
     xma_decoder, "new",
     "Decoder version used to process XMA audio.\n"
@@ -171,67 +181,89 @@ X_STATUS XmaDecoder::Setup(kernel::KernelState* kernel_state) {
   context_bitmap_.Resize(kContextCount);
 
   worker_running_ = true;
-  work_event_ = xe::threading::Event::CreateAutoResetEvent(false);
-  assert_not_null(work_event_);
-  worker_thread_ =
-      kernel::object_ref<kernel::XHostThread>(new kernel::XHostThread(
-          kernel_state, 128 * 1024, 0,
-          [this]() {
-            if (cvars::use_dedicated_xma_thread) {
-              WorkerThreadMain();
-            }
-            return 0;
-          },
-          kernel_state
-              ->GetIdleProcess()));  // this one doesnt need any process
-                                     // actually. never calls any guest code
-  worker_thread_->set_name("XMA Decoder");
-  worker_thread_->set_can_debugger_suspend(true);
-  worker_thread_->Create();
+  if (cvars::use_dedicated_xma_thread) {
+    uint32_t logical_processor_count =
+        std::max(uint32_t(1), xe::threading::logical_processor_count());
+    uint32_t worker_count;
+    if (cvars::xma_decoder_threads < 0) {
+      worker_count = std::max(logical_processor_count / 4, uint32_t(1));
+    } else {
+      worker_count =
+          std::clamp(uint32_t(cvars::xma_decoder_threads), uint32_t(1),
+                     logical_processor_count);
+    }
+    worker_count = std::min(worker_count, kMaxWorkerCount);
+    for (uint32_t i = 0; i < worker_count; ++i) {
+      auto worker = std::make_unique<DecodeWorker>();
+      worker->work_event = xe::threading::Event::CreateAutoResetEvent(false);
+      assert_not_null(worker->work_event);
+      worker->thread =
+          kernel::object_ref<kernel::XHostThread>(new kernel::XHostThread(
+              kernel_state, 128 * 1024, 0,
+              [this, worker = worker.get()]() {
+                WorkerThreadMain(*worker);
+                return 0;
+              },
+              kernel_state
+                  ->GetIdleProcess()));  // this one doesnt need any process
+                                         // actually. never calls any guest code
+      worker->thread->set_name(worker_count > 1
+                                   ? fmt::format("XMA Decoder {}", i)
+                                   : std::string("XMA Decoder"));
+      worker->thread->set_can_debugger_suspend(true);
+      worker->thread->Create();
+      workers_.push_back(std::move(worker));
+    }
+  }
 
   return X_STATUS_SUCCESS;
 }
 
-void XmaDecoder::WorkerThreadMain() {
+void XmaDecoder::WorkerThreadMain(DecodeWorker& worker) {
+  std::vector<uint32_t> context_ids;
   while (worker_running_) {
-    // Okay, let's loop through XMA contexts to find ones we need to decode!
-    bool did_work = false;
-    for (uint32_t n = 0; n < kContextCount; n++) {
-      bool worked = contexts_[n]->Work();
-      if (worked) {
-        contexts_[n]->SignalWorkDone();
-      }
-      did_work = did_work || worked;
+    {
+      std::lock_guard<xe_mutex> lock(worker.kicked_context_ids_lock);
+      context_ids.swap(worker.kicked_context_ids);
     }
+    for (uint32_t context_id : context_ids) {
+      XmaContext& context = *contexts_[context_id];
+      context.Work();
+      // The kicking thread is waiting even if there was nothing to do, such as
+      // when the context was locked after the kick.
+      context.SignalWorkDone();
+    }
+    bool did_work = !context_ids.empty();
+    context_ids.clear();
 
     if (paused_) {
-      pause_fence_.Signal();
-      resume_fence_.Wait();
+      worker.pause_fence.Signal();
+      worker.resume_fence.Wait();
     }
 
     if (did_work) {
       continue;
     }
-    xe::threading::Wait(work_event_.get(), false);
+    xe::threading::Wait(worker.work_event.get(), false);
   }
 }
 
 void XmaDecoder::Shutdown() {
   worker_running_ = false;
 
-  if (work_event_) {
-    work_event_->Set();
+  for (auto& worker : workers_) {
+    worker->work_event->Set();
   }
 
   if (paused_) {
     Resume();
   }
 
-  if (worker_thread_) {
-    // Wait for work thread.
-    xe::threading::Wait(worker_thread_->thread(), false);
-    worker_thread_.reset();
+  // Wait for work threads.
+  for (auto& worker : workers_) {
+    xe::threading::Wait(worker->thread->thread(), false);
   }
+  workers_.clear();
 
   if (context_data_first_ptr_) {
     memory()->SystemHeapFree(context_data_first_ptr_);
@@ -337,19 +369,32 @@ void XmaDecoder::WriteRegister(uint32_t addr, uint32_t value) {
     // The context ID is a bit in the range of the entire context array.
     const uint32_t base_context_id = (r - XmaRegister::Context0Kick) * 32;
     const uint32_t kicked_value = value;
+    uint32_t kicked_workers = 0;
     while (value) {
       const uint32_t context_id = base_context_id + std::countr_zero(value);
       auto& context = *contexts_[context_id];
       context.Enable();
-      if (!cvars::use_dedicated_xma_thread) {
+      if (workers_.empty()) {
         context.Work();
+      } else {
+        const uint32_t worker_index = context_id % uint32_t(workers_.size());
+        DecodeWorker& worker = *workers_[worker_index];
+        {
+          std::lock_guard<xe_mutex> lock(worker.kicked_context_ids_lock);
+          worker.kicked_context_ids.push_back(context_id);
+        }
+        kicked_workers |= uint32_t(1) << worker_index;
       }
       value &= value - 1;
     }
-    // Signal the decoder thread to start processing.
-    work_event_->SetBoostPriority();
-    if (cvars::use_dedicated_xma_thread) {
-      // Block until the worker finishes, so the game sees updated context data.
+    if (!workers_.empty()) {
+      // Signal the decoder threads to start processing.
+      while (kicked_workers) {
+        workers_[std::countr_zero(kicked_workers)]
+            ->work_event->SetBoostPriority();
+        kicked_workers &= kicked_workers - 1;
+      }
+      // Block until the workers finish, so the game sees updated context data.
       uint32_t remaining = kicked_value;
       while (remaining) {
         const uint32_t context_id =
@@ -409,7 +454,13 @@ void XmaDecoder::Pause() {
   }
   paused_ = true;
 
-  pause_fence_.Wait();
+  // Wake up the idle workers so they see the pause request.
+  for (auto& worker : workers_) {
+    worker->work_event->Set();
+  }
+  for (auto& worker : workers_) {
+    worker->pause_fence.Wait();
+  }
 }
 
 void XmaDecoder::Resume() {
@@ -418,7 +469,9 @@ void XmaDecoder::Resume() {
   }
   paused_ = false;
 
-  resume_fence_.Signal();
+  for (auto& worker : workers_) {
+    worker->resume_fence.Signal();
+  }
 }
 
 }  // namespace apu
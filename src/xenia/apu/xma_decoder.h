@@ -11,8 +11,10 @@
 #define XENIA_APU_XMA_DECODER_H_
 
 #include <atomic>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 #include "xenia/apu/xma_context.h"
 #include "xenia/apu/xma_register_file.h"
@@ -55,7 +57,23 @@ class XmaDecoder {
   int GetContextId(uint32_t guest_ptr);
 
  private:
-  void WorkerThreadMain();
+  // Decodes the contexts kicked to it, in the order of the kicks. Context N is
+  // always decoded by worker N % worker count, so the kicks of a context
+  // complete in order while different contexts are decoded in parallel.
+  struct DecodeWorker {
+    kernel::object_ref<kernel::XHostThread> thread;
+    std::unique_ptr<xe::threading::Event> work_event;
+    xe_mutex kicked_context_ids_lock;
+    std::vector<uint32_t> kicked_context_ids;
+    xe::threading::Fence pause_fence;   // Signaled when worker paused.
+    xe::threading::Fence resume_fence;  // Signaled when resume requested.
+  };
+
+  // One kick register write kicks at most 32 contexts, more workers can't
+  // decode at the same time.
+  static constexpr uint32_t kMaxWorkerCount = 32;
+
+  void WorkerThreadMain(DecodeWorker& worker);
 
   static uint32_t MMIOReadRegisterThunk(void* ppc_context, XmaDecoder* as,
                                         uint32_t addr) {
@@ -71,12 +89,10 @@ class XmaDecoder {
   cpu::Processor* processor_ = nullptr;
 
   std::atomic<bool> worker_running_ = {false};
-  kernel::object_ref<kernel::XHostThread> worker_thread_;
-  std::unique_ptr<xe::threading::Event> work_event_ = nullptr;
+  // Empty if decoding on the kicking thread.
+  std::vector<std::unique_ptr<DecodeWorker>> workers_;
 
   std::atomic<bool> paused_ = false;
-  xe::threading::Fence pause_fence_;   // Signaled when worker paused.
-  xe::threading::Fence resume_fence_;  // Signaled when resume requested.
 
   XmaRegisterFile register_file_;
 
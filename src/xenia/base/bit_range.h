@@ -100,6 +100,36 @@ void SetRange(Block* bits, size_t first, size_t length) {
   bits[block_last] |= set_last;
 }
 
+// Provided length is in bits since the first. Returns whether any bit in the
+// range is set.
+template <typename Block>
+bool IsAnySet(const Block* bits, size_t first, size_t length) {
+  if (!length) {
+    return false;
+  }
+  size_t last = first + length - 1;
+  constexpr size_t block_bits = sizeof(Block) * CHAR_BIT;
+  size_t block_first = first / block_bits;
+  size_t block_last = last / block_bits;
+  Block mask_first = ~((Block(1) << (first & (block_bits - 1))) - 1);
+  Block mask_last = ~Block(0);
+  if ((last & (block_bits - 1)) != (block_bits - 1)) {
+    mask_last &= (Block(1) << ((last & (block_bits - 1)) + 1)) - 1;
+  }
+  if (block_first == block_last) {
+    return (bits[block_first] & mask_first & mask_last) != 0;
+  }
+  if (bits[block_first] & mask_first) {
+    return true;
+  }
+  for (size_t i = block_first + 1; i < block_last; ++i) {
+    if (bits[i]) {
+      return true;
+    }
+  }
+  return (bits[block_last] & mask_last) != 0;
+}
+
 }  // namespace bit_range
 }  // namespace xe
 
@@ -14,6 +14,7 @@
 #include <cstring>
 #include <filesystem>
 #include <functional>
+#include <memory>
 #include <string>
 #include <string_view>
 #include <type_traits>
@@ -156,6 +157,34 @@ void* MapFileView(FileMappingHandle handle, void* base_address, size_t length,
                   PageAccess access, size_t file_offset);
 bool UnmapFileView(FileMappingHandle handle, void* base_address, size_t length);
 
+// Host kernel tracking of writes to memory regions, for finding the pages
+// written to since they were watched without an access violation reaching the
+// process for every page. Only writes through the registered mappings are
+// seen, not through other views of the same file mapping. Implemented with
+// asynchronous userfaultfd write protection and PAGEMAP_SCAN on Linux 6.7+.
+class WriteTracker {
+ public:
+  // Returns null if the host doesn't support write tracking.
+  static std::unique_ptr<WriteTracker> Create();
+
+  virtual ~WriteTracker() = default;
+
+  virtual const char* name() const = 0;
+
+  // Enables tracking for a mapped region, once. Both base_address and length
+  // must be aligned to page_size().
+  virtual bool Register(void* base_address, size_t length) = 0;
+  // Resets the written state of the pages of a registered region so the next
+  // write to each of them is recorded, without changing their protection.
+  virtual bool Watch(void* base_address, size_t length) = 0;
+  // Sets the bits in written_pages, one per page_size() page from
+  // base_address, for the pages written to since they were watched. Pages that
+  // have never been watched may be reported as written too. Doesn't clear the
+  // other bits.
+  virtual bool GetWrittenPages(void* base_address, size_t length,
+                               uint64_t* written_pages) = 0;
+};
+
 inline size_t hash_combine(size_t seed) { return seed; }
 
 template <typename T, typename... Ts>
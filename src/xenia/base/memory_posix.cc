@@ -32,6 +32,52 @@
 #include "xenia/base/main_android.h"
 #endif
 
+#if XE_PLATFORM_LINUX
+#include <linux/fs.h>
+#include <linux/userfaultfd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+// Linux 5.11 to 6.7 userfaultfd and pagemap interfaces, possibly missing from
+// older kernel headers.
+#ifndef UFFD_USER_MODE_ONLY
+#define UFFD_USER_MODE_ONLY 1
+#endif
+#ifndef UFFD_FEATURE_WP_HUGETLBFS_SHMEM
+#define UFFD_FEATURE_WP_HUGETLBFS_SHMEM (1 << 12)
+#endif
+#ifndef UFFD_FEATURE_WP_UNPOPULATED
+#define UFFD_FEATURE_WP_UNPOPULATED (1 << 13)
+#endif
+#ifndef UFFD_FEATURE_WP_ASYNC
+#define UFFD_FEATURE_WP_ASYNC (1 << 15)
+#endif
+#ifndef PAGEMAP_SCAN
+#define PAGE_IS_WRITTEN (1 << 1)
+struct page_region {
+  __u64 start;
+  __u64 end;
+  __u64 categories;
+};
+#define PM_SCAN_CHECK_WPASYNC (1 << 1)
+struct pm_scan_arg {
+  __u64 size;
+  __u64 flags;
+  __u64 start;
+  __u64 end;
+  __u64 walk_end;
+  __u64 vec;
+  __u64 vec_len;
+  __u64 max_pages;
+  __u64 category_inverted;
+  __u64 category_mask;
+  __u64 category_anyof_mask;
+  __u64 return_mask;
+};
+#define PAGEMAP_SCAN _IOWR('f', 16, struct pm_scan_arg)
+#endif
+#endif  // XE_PLATFORM_LINUX
+
 namespace xe {
 namespace memory {
 
@@ -374,5 +420,109 @@ bool UnmapFileView(FileMappingHandle handle, void* base_address,
   return munmap(base_address, length) == 0;
 }
 
+#if XE_PLATFORM_LINUX
+// With asynchronous write protection, the kernel itself resolves write faults
+// on write-protected pages by removing the protection, and PAGEMAP_SCAN reports
+// the pages without it, so nothing is delivered to the process on writes.
+class UserfaultfdWriteTracker : public WriteTracker {
+ public:
+  static std::unique_ptr<UserfaultfdWriteTracker> Create() {
+    // User mode only faults are allowed without privileges by default.
+    int uffd = int(syscall(SYS_userfaultfd,
+                           O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY));
+    if (uffd < 0) {
+      return nullptr;
+    }
+    uffdio_api api = {};
+    api.api = UFFD_API;
+    api.features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED |
+                   UFFD_FEATURE_WP_HUGETLBFS_SHMEM;
+    if (ioctl(uffd, UFFDIO_API, &api) != 0) {
+      close(uffd);
+      return nullptr;
+    }
+    int pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    if (pagemap < 0) {
+      close(uffd);
+      return nullptr;
+    }
+    return std::unique_ptr<UserfaultfdWriteTracker>(
+        new UserfaultfdWriteTracker(uffd, pagemap));
+  }
+
+  ~UserfaultfdWriteTracker() override {
+    close(pagemap_);
+    close(uffd_);
+  }
+
+  const char* name() const override { return "userfaultfd"; }
+
+  bool Register(void* base_address, size_t length) override {
+    uffdio_register uffd_register = {};
+    uffd_register.range.start = reinterpret_cast<uintptr_t>(base_address);
+    uffd_register.range.len = length;
+    uffd_register.mode = UFFDIO_REGISTER_MODE_WP;
+    return ioctl(uffd_, UFFDIO_REGISTER, &uffd_register) == 0;
+  }
+
+  bool Watch(void* base_address, size_t length) override {
+    uffdio_writeprotect write_protect = {};
+    write_protect.range.start = reinterpret_cast<uintptr_t>(base_address);
+    write_protect.range.len = length;
+    write_protect.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+    return ioctl(uffd_, UFFDIO_WRITEPROTECT, &write_protect) == 0;
+  }
+
+  bool GetWrittenPages(void* base_address, size_t length,
+                       uint64_t* written_pages) override {
+    uintptr_t start = reinterpret_cast<uintptr_t>(base_address);
+    uintptr_t end = start + length;
+    size_t page_shift = size_t(xe::log2_floor(page_size()));
+    page_region regions[256];
+    pm_scan_arg scan = {};
+    scan.size = sizeof(scan);
+    scan.flags = PM_SCAN_CHECK_WPASYNC;
+    scan.end = end;
+    scan.vec = reinterpret_cast<uintptr_t>(regions);
+    scan.vec_len = xe::countof(regions);
+    scan.category_mask = PAGE_IS_WRITTEN;
+    scan.return_mask = PAGE_IS_WRITTEN;
+    // Continuing from where the scan stopped if more runs of written pages
+    // than fit in the array were found.
+    for (uintptr_t scan_start = start; scan_start < end;
+         scan_start = uintptr_t(scan.walk_end)) {
+      scan.start = scan_start;
+      int region_count = ioctl(pagemap_, PAGEMAP_SCAN, &scan);
+      if (region_count < 0) {
+        return false;
+      }
+      for (int i = 0; i < region_count; ++i) {
+        size_t page_first = size_t(regions[i].start - start) >> page_shift;
+        size_t page_end = size_t(regions[i].end - start) >> page_shift;
+        for (size_t page = page_first; page < page_end; ++page) {
+          written_pages[page >> 6] |= uint64_t(1) << (page & 63);
+        }
+      }
+    }
+    return true;
+  }
+
+ private:
+  UserfaultfdWriteTracker(int uffd, int pagemap)
+      : uffd_(uffd), pagemap_(pagemap) {}
+
+  int uffd_;
+  int pagemap_;
+};
+#endif  // XE_PLATFORM_LINUX
+
+std::unique_ptr<WriteTracker> WriteTracker::Create() {
+#if XE_PLATFORM_LINUX
+  return UserfaultfdWriteTracker::Create();
+#else
+  return nullptr;
+#endif  // XE_PLATFORM_LINUX
+}
+
 }  // namespace memory
 }  // namespace xe
@@ -282,5 +282,10 @@ bool UnmapFileView(FileMappingHandle handle, void* base_address,
   return UnmapViewOfFile(base_address) ? true : false;
 }
 
+std::unique_ptr<WriteTracker> WriteTracker::Create() {
+  // GetWriteWatch doesn't support file mapping views.
+  return nullptr;
+}
+
 }  // namespace memory
 }  // namespace xe
@@ -8,6 +8,8 @@
  */
 
 #include "xenia/base/mutex.h"
+#include "xenia/base/assert.h"
+#include "xenia/base/logging.h"
 #if XE_PLATFORM_WIN32 == 1
 #include "xenia/base/platform_win.h"
 #elif XE_PLATFORM_LINUX == 1
@@ -38,6 +40,10 @@ void xe_global_mutex::unlock() {
   }
 }
 
+bool xe_global_mutex::owned_by_current_thread() const {
+  return owner_thread_ == GetCurrentThreadId();
+}
+
 bool xe_global_mutex::try_lock() {
   DWORD self = GetCurrentThreadId();
   if (owner_thread_ == self) {
@@ -169,6 +175,10 @@ void xe_global_mutex::unlock() {
   }
 }
 
+bool xe_global_mutex::owned_by_current_thread() const {
+  return owner_.load(std::memory_order_relaxed) == gettid();
+}
+
 bool xe_global_mutex::try_lock() {
   pid_t self = gettid();
 
@@ -253,4 +263,100 @@ global_mutex_type& global_critical_region::mutex() {
   return global_mutex;
 }
 
+const char* GetLockDomainName(LockDomain domain) {
+  switch (domain) {
+    case LockDomain::kGlobal:
+      return "global";
+    case LockDomain::kAudio:
+      return "audio";
+    case LockDomain::kCodeCache:
+      return "code cache";
+    default:
+      return "unknown";
+  }
+}
+
+#if XE_ENABLE_LOCK_ORDER_CHECKING
+namespace {
+// How many times the current thread has entered each lock domain other than
+// the global one, which tracks its owner itself.
+thread_local uint32_t lock_domain_depths_[size_t(LockDomain::kCount)] = {};
+}  // namespace
+
+void CheckLockDomainOrder(LockDomain domain) {
+  // Recursion is always fine.
+  if (domain == LockDomain::kGlobal
+          ? global_critical_region::mutex().owned_by_current_thread()
+          : lock_domain_depths_[size_t(domain)] != 0) {
+    return;
+  }
+  for (size_t i = size_t(domain) + 1; i < size_t(LockDomain::kCount); ++i) {
+    if (lock_domain_depths_[i]) {
+      XELOGE("Lock order violation: acquiring the {} lock domain while holding "
+             "the {} lock domain",
+             GetLockDomainName(domain), GetLockDomainName(LockDomain(i)));
+      assert_always("Lock domains acquired out of order");
+      return;
+    }
+  }
+}
+#endif
+
+void xe_lock_domain_mutex::lock() {
+#if XE_ENABLE_LOCK_ORDER_CHECKING
+  CheckLockDomainOrder(domain_);
+#endif
+  mutex_.lock();
+#if XE_ENABLE_LOCK_ORDER_CHECKING
+  ++lock_domain_depths_[size_t(domain_)];
+#endif
+}
+
+void xe_lock_domain_mutex::unlock() {
+#if XE_ENABLE_LOCK_ORDER_CHECKING
+  --lock_domain_depths_[size_t(domain_)];
+#endif
+  mutex_.unlock();
+}
+
+bool xe_lock_domain_mutex::try_lock() {
+  // Not waiting, so can't deadlock regardless of the order.
+  if (!mutex_.try_lock()) {
+    return false;
+  }
+#if XE_ENABLE_LOCK_ORDER_CHECKING
+  ++lock_domain_depths_[size_t(domain_)];
+#endif
+  return true;
+}
+
+xe_lock_domain_mutex& GetLockDomainMutex(LockDomain domain) {
+  static xe_lock_domain_mutex audio_mutex(LockDomain::kAudio);
+  static xe_lock_domain_mutex code_cache_mutex(LockDomain::kCodeCache);
+  switch (domain) {
+    case LockDomain::kAudio:
+      return audio_mutex;
+    case LockDomain::kCodeCache:
+      return code_cache_mutex;
+    default:
+      assert_unhandled_case(domain);
+      return audio_mutex;
+  }
+}
+
+all_lock_domains_unique_lock::all_lock_domains_unique_lock()
+    : global_lock_(global_critical_region::AcquireDirect()) {
+  for (size_t i = 1; i < size_t(LockDomain::kCount); ++i) {
+    domain_locks_[i - 1] =
+        lock_domain_unique_lock_type(GetLockDomainMutex(LockDomain(i)));
+  }
+}
+
+all_lock_domains_unique_lock::~all_lock_domains_unique_lock() {
+  for (size_t i = domain_locks_.size(); i; --i) {
+    domain_locks_[i - 1].unlock();
+  }
+  global_lock_.unlock();
+}
+
 }  // namespace xe
@@ -9,7 +9,9 @@
 
 #ifndef XENIA_BASE_MUTEX_H_
 #define XENIA_BASE_MUTEX_H_
+#include <array>
 #include <atomic>
+#include <cstdint>
 #include <mutex>
 #include <thread>
 #include "platform.h"
@@ -21,6 +23,15 @@
 #include "memory.h"
 #define XE_ENABLE_FAST_WIN32_MUTEX 1
 #define XE_ENABLE_FAST_LINUX_MUTEX 1
+// Whether acquisitions of lock domains are checked against their order. Needs
+// the owner tracking of the fast recursive mutexes.
+#if !defined(NDEBUG) &&                                             \
+    ((XE_PLATFORM_WIN32 == 1 && XE_ENABLE_FAST_WIN32_MUTEX == 1) || \
+     (XE_PLATFORM_LINUX == 1 && XE_ENABLE_FAST_LINUX_MUTEX == 1))
+#define XE_ENABLE_LOCK_ORDER_CHECKING 1
+#else
+#define XE_ENABLE_LOCK_ORDER_CHECKING 0
+#endif
 namespace xe {
 
 #if XE_PLATFORM_WIN32 == 1 && XE_ENABLE_FAST_WIN32_MUTEX == 1
@@ -37,6 +48,7 @@ class alignas(4096) xe_global_mutex {
   void lock();
   void unlock();
   bool try_lock();
+  bool owned_by_current_thread() const;
 };
 using global_mutex_type = xe_global_mutex;
 
@@ -103,6 +115,7 @@ class alignas(4096) xe_global_mutex {
   void lock();
   void unlock();
   bool try_lock();
+  bool owned_by_current_thread() const;
 };
 using global_mutex_type = xe_global_mutex;
 
@@ -169,6 +182,52 @@ struct null_mutex {
   static bool try_lock() { return true; }
 };
 
+// Lock domains split off the global critical region for subsystems that keep
+// to themselves - their regions don't call into anything else protected by the
+// global critical region, so they don't need to exclude every other guest
+// thread, only each other. Each domain has its own recursive mutex, and
+// keeps the guarantee of the global critical region that matters to the rest
+// of the system: code suspending guest threads acquires every domain along
+// with the global critical region (AcquireAllLockDomains), so no thread is
+// suspended while inside any of them.
+//
+// Domains are ranked in the order they must be acquired in - the global
+// critical region first, then the rest in the order of the enumeration. A
+// thread holding a domain may only acquire domains of a higher rank, or the
+// same one again. With XE_ENABLE_LOCK_ORDER_CHECKING (debug builds), every
+// acquisition is checked against the domains the thread already holds, and
+// violations are logged and asserted before they get the chance to deadlock.
+//
+// A domain must rank before every domain its regions call into, so leaf
+// domains that call into nothing else go last. The kernel object table,
+// memory and the GPU still use the global critical region, and their regions
+// nest in that order: kernel objects allocate from the system heap, and
+// memory calls the GPU physical memory watch callbacks with its lock held.
+// When they're split off, they go between kGlobal and the leaf domains as:
+//   kGlobal
+//   kKernelObjects - object table, calls into memory.
+//   kMemory - heaps and physical access callbacks, calls into the GPU.
+//   kGpuWatches - shared memory and texture cache watch callbacks.
+//   kAudio, kCodeCache - leaves.
+// A new domain is inserted right before the first existing one its regions
+// call into.
+enum class LockDomain : uint32_t {
+  kGlobal,
+  // AudioSystem client table.
+  kAudio,
+  // Code placement, indirection table and call chaining in the code cache.
+  kCodeCache,
+
+  kCount,
+};
+
+const char* GetLockDomainName(LockDomain domain);
+
+#if XE_ENABLE_LOCK_ORDER_CHECKING
+// Called before a blocking acquisition of the domain on the current thread.
+void CheckLockDomainOrder(LockDomain domain);
+#endif
+
 using global_unique_lock_type = std::unique_lock<global_mutex_type>;
 // The global critical region mutex singleton.
 // This must guard any operation that may suspend threads or be sensitive to
@@ -199,6 +258,8 @@ using global_unique_lock_type = std::unique_lock<global_mutex_type>;
 //     MySuspendThread():
 //       auto global_lock = global_critical_region_.Acquire();
 //       ::SuspendThread(thread0);
+// Actual suspension of guest threads uses xe::AcquireAllLockDomains() instead,
+// so this also holds for the regions of the lock domains above.
 //
 // To use the region it's strongly recommended that you keep an instance near
 // the data requiring it. This makes it clear to those reading that the data
@@ -218,11 +279,17 @@ class global_critical_region {
   // to keep an instance of global_critical_region near the members requiring
   // it to keep things readable.
   static global_unique_lock_type AcquireDirect() {
+#if XE_ENABLE_LOCK_ORDER_CHECKING
+    CheckLockDomainOrder(LockDomain::kGlobal);
+#endif
     return global_unique_lock_type(mutex());
   }
 
   // Acquires a lock on the global critical section.
   static inline global_unique_lock_type Acquire() {
+#if XE_ENABLE_LOCK_ORDER_CHECKING
+    CheckLockDomainOrder(LockDomain::kGlobal);
+#endif
     return global_unique_lock_type(mutex());
   }
 
@@ -240,6 +307,82 @@ class global_critical_region {
   }
 };
 
+// Recursive mutex of a lock domain other than the global one.
+class xe_lock_domain_mutex {
+ public:
+  explicit xe_lock_domain_mutex(LockDomain domain) : domain_(domain) {}
+
+  LockDomain domain() const { return domain_; }
+
+  void lock();
+  void unlock();
+  bool try_lock();
+
+ private:
+  global_mutex_type mutex_;
+  LockDomain domain_;
+};
+
+xe_lock_domain_mutex& GetLockDomainMutex(LockDomain domain);
+
+using lock_domain_unique_lock_type = std::unique_lock<xe_lock_domain_mutex>;
+
+// Critical region of a lock domain, used in place of global_critical_region
+// by the subsystem owning the domain, with the same interface:
+// class MyType {
+//   xe::lock_domain_critical_region<xe::LockDomain::kMyDomain>
+//       global_critical_region_;
+//   std::list<...> my_list_;
+// };
+template <LockDomain domain>
+class lock_domain_critical_region {
+  static_assert(domain != LockDomain::kGlobal && domain < LockDomain::kCount,
+                "Use global_critical_region for the global lock domain");
+
+ public:
+  constexpr lock_domain_critical_region() {}
+  static xe_lock_domain_mutex& mutex() { return GetLockDomainMutex(domain); }
+
+  static lock_domain_unique_lock_type AcquireDirect() {
+    return lock_domain_unique_lock_type(mutex());
+  }
+
+  static inline lock_domain_unique_lock_type Acquire() {
+    return lock_domain_unique_lock_type(mutex());
+  }
+
+  static inline void PrepareToAcquire() { swcache::PrefetchW(&mutex()); }
+
+  static inline lock_domain_unique_lock_type AcquireDeferred() {
+    return lock_domain_unique_lock_type(mutex(), std::defer_lock);
+  }
+
+  static inline lock_domain_unique_lock_type TryAcquire() {
+    return lock_domain_unique_lock_type(mutex(), std::try_to_lock);
+  }
+};
+
+// The global critical region together with every lock domain, acquired in
+// order and released in reverse. Hold this instead of only the global
+// critical region when suspending guest threads.
+class all_lock_domains_unique_lock {
+ public:
+  all_lock_domains_unique_lock();
+  ~all_lock_domains_unique_lock();
+  all_lock_domains_unique_lock(const all_lock_domains_unique_lock&) = delete;
+  all_lock_domains_unique_lock& operator=(
+      const all_lock_domains_unique_lock&) = delete;
+
+ private:
+  global_unique_lock_type global_lock_;
+  std::array<lock_domain_unique_lock_type, size_t(LockDomain::kCount) - 1>
+      domain_locks_;
+};
+
+inline all_lock_domains_unique_lock AcquireAllLockDomains() {
+  return all_lock_domains_unique_lock();
+}
+
 }  // namespace xe
 
 #endif  // XENIA_BASE_MUTEX_H_
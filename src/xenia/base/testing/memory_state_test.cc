@@ -0,0 +1,245 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/memory.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "xenia/base/byte_stream.h"
+#include "xenia/base/memory.h"
+
+namespace xe {
+namespace test {
+
+constexpr uint32_t kStateTestHeapSize = 16 * 1024 * 1024;
+constexpr uint32_t kStateTestPageSize = 4096;
+// Committed regions.
+constexpr uint32_t kRandomAddress = 0x00100000;
+constexpr uint32_t kRandomSize = 0x00100000;
+constexpr uint32_t kZeroAddress = 0x00400000;
+constexpr uint32_t kZeroSize = 0x00100000;
+constexpr uint32_t kReadOnlyAddress = 0x00800000;
+constexpr uint32_t kReadOnlySize = 0x00040000;
+
+// A heap backed by host memory, without a full Memory instance.
+class StateTestHeap {
+ public:
+  StateTestHeap() {
+    membase_ = static_cast<uint8_t*>(xe::memory::AllocFixed(
+        nullptr, kStateTestHeapSize, xe::memory::AllocationType::kReserveCommit,
+        xe::memory::PageAccess::kReadWrite));
+    heap_.Initialize(nullptr, membase_, HeapType::kGuestVirtual, 0,
+                     kStateTestHeapSize, kStateTestPageSize);
+  }
+
+  ~StateTestHeap() {
+    xe::memory::DeallocFixed(membase_, kStateTestHeapSize,
+                             xe::memory::DeallocationType::kRelease);
+  }
+
+  VirtualHeap& heap() { return heap_; }
+  uint8_t* membase() { return membase_; }
+
+  void Commit(uint32_t address, uint32_t size, uint32_t protect) {
+    REQUIRE(heap_.AllocFixed(
+        address, size, kStateTestPageSize,
+        kMemoryAllocationReserve | kMemoryAllocationCommit, protect));
+  }
+
+  std::vector<uint8_t> Copy(uint32_t address, uint32_t size) const {
+    return std::vector<uint8_t>(membase_ + address, membase_ + address + size);
+  }
+
+ private:
+  uint8_t* membase_;
+  VirtualHeap heap_;
+};
+
+void FillRandom(uint8_t* data, uint32_t size, uint32_t seed) {
+  std::mt19937 random_engine(seed);
+  for (uint32_t i = 0; i < size; i += sizeof(uint32_t)) {
+    uint32_t value = random_engine();
+    std::memcpy(data + i, &value, sizeof(value));
+  }
+}
+
+void InitializeStateTestHeap(StateTestHeap& heap) {
+  heap.Commit(kRandomAddress, kRandomSize,
+              kMemoryProtectRead | kMemoryProtectWrite);
+  FillRandom(heap.membase() + kRandomAddress, kRandomSize, 1);
+  heap.Commit(kZeroAddress, kZeroSize,
+              kMemoryProtectRead | kMemoryProtectWrite);
+  heap.Commit(kReadOnlyAddress, kReadOnlySize,
+              kMemoryProtectRead | kMemoryProtectWrite);
+  FillRandom(heap.membase() + kReadOnlyAddress, kReadOnlySize, 2);
+  REQUIRE(heap.heap().Protect(kReadOnlyAddress, kReadOnlySize,
+                              kMemoryProtectRead));
+}
+
+TEST_CASE("BaseHeap state round trip", "[memory]") {
+  StateTestHeap heap;
+  InitializeStateTestHeap(heap);
+  std::vector<uint8_t> random_contents = heap.Copy(kRandomAddress, kRandomSize);
+  std::vector<uint8_t> read_only_contents =
+      heap.Copy(kReadOnlyAddress, kReadOnlySize);
+
+  std::vector<uint8_t> state(2 * kStateTestHeapSize);
+  ByteStream save_stream(state.data(), state.size());
+  std::vector<uint64_t> chunk_hashes;
+  REQUIRE(heap.heap().Save(&save_stream, nullptr, &chunk_hashes));
+  REQUIRE(chunk_hashes.size() ==
+          kStateTestHeapSize / BaseHeap::kStateChunkSize);
+  // Zero pages are not stored, and random data can't be compressed.
+  REQUIRE(save_stream.offset() < kRandomSize + kReadOnlySize + 65536);
+
+  FillRandom(heap.membase() + kRandomAddress, kRandomSize, 3);
+  FillRandom(heap.membase() + kZeroAddress, kZeroSize, 4);
+
+  ByteStream restore_stream(state.data(), save_stream.offset());
+  std::vector<uint64_t> restored_chunk_hashes;
+  REQUIRE(heap.heap().Restore(&restore_stream, nullptr,
+                              &restored_chunk_hashes));
+  REQUIRE(restore_stream.offset() == save_stream.offset());
+  REQUIRE(restored_chunk_hashes == chunk_hashes);
+  REQUIRE(heap.Copy(kRandomAddress, kRandomSize) == random_contents);
+  REQUIRE(heap.Copy(kZeroAddress, kZeroSize) ==
+          std::vector<uint8_t>(kZeroSize, 0));
+  REQUIRE(heap.Copy(kReadOnlyAddress, kReadOnlySize) == read_only_contents);
+  uint32_t protect;
+  REQUIRE(heap.heap().QueryProtect(kReadOnlyAddress, &protect));
+  REQUIRE(protect == kMemoryProtectRead);
+}
+
+TEST_CASE("BaseHeap delta state round trip", "[memory]") {
+  StateTestHeap heap;
+  InitializeStateTestHeap(heap);
+
+  std::vector<uint8_t> base_state(2 * kStateTestHeapSize);
+  ByteStream base_save_stream(base_state.data(), base_state.size());
+  std::vector<uint64_t> base_chunk_hashes;
+  REQUIRE(heap.heap().Save(&base_save_stream, nullptr, &base_chunk_hashes));
+
+  // Change one page, and make one zero page non-zero.
+  FillRandom(heap.membase() + kRandomAddress + 5 * kStateTestPageSize,
+             kStateTestPageSize, 5);
+  heap.membase()[kZeroAddress + 7 * kStateTestPageSize + 3] = 1;
+  std::vector<uint8_t> random_contents = heap.Copy(kRandomAddress, kRandomSize);
+  std::vector<uint8_t> zero_contents = heap.Copy(kZeroAddress, kZeroSize);
+  std::vector<uint8_t> read_only_contents =
+      heap.Copy(kReadOnlyAddress, kReadOnlySize);
+
+  std::vector<uint8_t> delta_state(2 * kStateTestHeapSize);
+  ByteStream delta_save_stream(delta_state.data(), delta_state.size());
+  std::vector<uint64_t> delta_chunk_hashes;
+  REQUIRE(heap.heap().Save(&delta_save_stream, &base_chunk_hashes,
+                           &delta_chunk_hashes));
+  // Only the two changed chunks are stored.
+  REQUIRE(delta_save_stream.offset() <
+          2 * BaseHeap::kStateChunkSize + 65536);
+  size_t changed_chunk_count = 0;
+  for (size_t i = 0; i < base_chunk_hashes.size(); ++i) {
+    if (delta_chunk_hashes[i] != base_chunk_hashes[i]) {
+      ++changed_chunk_count;
+    }
+  }
+  REQUIRE(changed_chunk_count == 2);
+
+  FillRandom(heap.membase() + kRandomAddress, kRandomSize, 6);
+  FillRandom(heap.membase() + kZeroAddress, kZeroSize, 7);
+
+  ByteStream delta_restore_stream(delta_state.data(),
+                                  delta_save_stream.offset());
+  ByteStream base_restore_stream(base_state.data(),
+                                 base_save_stream.offset());
+  std::vector<uint64_t> restored_base_chunk_hashes;
+  REQUIRE(heap.heap().Restore(&delta_restore_stream, &base_restore_stream,
+                              &restored_base_chunk_hashes));
+  REQUIRE(base_restore_stream.offset() == base_save_stream.offset());
+  REQUIRE(restored_base_chunk_hashes == base_chunk_hashes);
+  REQUIRE(heap.Copy(kRandomAddress, kRandomSize) == random_contents);
+  REQUIRE(heap.Copy(kZeroAddress, kZeroSize) == zero_contents);
+  REQUIRE(heap.Copy(kReadOnlyAddress, kReadOnlySize) == read_only_contents);
+}
+
+TEST_CASE("BaseHeap delta state rejects a different base state",
+          "[memory]") {
+  StateTestHeap heap;
+  InitializeStateTestHeap(heap);
+
+  std::vector<uint8_t> base_state(2 * kStateTestHeapSize);
+  ByteStream base_save_stream(base_state.data(), base_state.size());
+  std::vector<uint64_t> base_chunk_hashes;
+  REQUIRE(heap.heap().Save(&base_save_stream, nullptr, &base_chunk_hashes));
+
+  FillRandom(heap.membase() + kRandomAddress + 5 * kStateTestPageSize,
+             kStateTestPageSize, 5);
+  std::vector<uint8_t> delta_state(2 * kStateTestHeapSize);
+  ByteStream delta_save_stream(delta_state.data(), delta_state.size());
+  REQUIRE(heap.heap().Save(&delta_save_stream, &base_chunk_hashes, nullptr));
+
+  // The base state is replaced by one with different contents of the chunks
+  // the delta takes from it.
+  FillRandom(heap.membase() + kRandomAddress, kRandomSize, 6);
+  std::vector<uint8_t> other_base_state(2 * kStateTestHeapSize);
+  ByteStream other_base_save_stream(other_base_state.data(),
+                                    other_base_state.size());
+  REQUIRE(heap.heap().Save(&other_base_save_stream, nullptr, nullptr));
+
+  ByteStream delta_restore_stream(delta_state.data(),
+                                  delta_save_stream.offset());
+  ByteStream other_base_restore_stream(other_base_state.data(),
+                                       other_base_save_stream.offset());
+  REQUIRE_FALSE(heap.heap().Restore(&delta_restore_stream,
+                                    &other_base_restore_stream, nullptr));
+}
+
+TEST_CASE("BaseHeap snapshots share unchanged chunks", "[memory]") {
+  StateTestHeap heap;
+  InitializeStateTestHeap(heap);
+  std::vector<uint8_t> random_contents = heap.Copy(kRandomAddress, kRandomSize);
+
+  HeapSnapshot first_snapshot;
+  REQUIRE(heap.heap().TakeSnapshot(nullptr, first_snapshot));
+  REQUIRE(first_snapshot.chunks.size() ==
+          kStateTestHeapSize / BaseHeap::kStateChunkSize);
+  // Only the chunks with committed pages are stored.
+  size_t stored_chunk_count = 0;
+  for (const auto& chunk : first_snapshot.chunks) {
+    if (chunk) {
+      ++stored_chunk_count;
+    }
+  }
+  REQUIRE(stored_chunk_count ==
+          (kRandomSize + kZeroSize + kReadOnlySize) /
+              BaseHeap::kStateChunkSize);
+
+  uint32_t changed_chunk_index = kRandomAddress / BaseHeap::kStateChunkSize;
+  heap.membase()[kRandomAddress + 3] ^= 1;
+  HeapSnapshot second_snapshot;
+  REQUIRE(heap.heap().TakeSnapshot(&first_snapshot, second_snapshot));
+  REQUIRE(second_snapshot.page_table == first_snapshot.page_table);
+  for (size_t i = 0; i < second_snapshot.chunks.size(); ++i) {
+    if (i == changed_chunk_index) {
+      REQUIRE(second_snapshot.chunks[i] != first_snapshot.chunks[i]);
+    } else {
+      REQUIRE(second_snapshot.chunks[i] == first_snapshot.chunks[i]);
+    }
+  }
+
+  FillRandom(heap.membase() + kRandomAddress, kRandomSize, 8);
+  REQUIRE(heap.heap().RestoreSnapshot(first_snapshot));
+  REQUIRE(heap.Copy(kRandomAddress, kRandomSize) == random_contents);
+}
+
+}  // namespace test
+}  // namespace xe
@@ -10,9 +10,20 @@
 #include "xenia/memory.h"
 
 #include "third_party/catch/include/catch.hpp"
+#include "third_party/fmt/include/fmt/format.h"
 
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "xenia/base/clock.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/math.h"
 #include "xenia/base/memory.h"
 
+DECLARE_bool(host_write_tracking);
+DECLARE_bool(physical_write_map);
+
 namespace xe {
 namespace test {
 
@@ -209,5 +220,162 @@ TEST_CASE("PhysicalHeap vE0000000 AllocRange alignment", "[memory]") {
   }
 }
 
+TEST_CASE("WriteTracker reports pages written since watching", "[memory]") {
+  auto write_tracker = xe::memory::WriteTracker::Create();
+  if (!write_tracker) {
+    // Not supported by the host.
+    return;
+  }
+  size_t page_size = xe::memory::page_size();
+  size_t length = 64 * page_size;
+  auto path = fmt::format("xenia_test_{}", Clock::QueryHostTickCount());
+  auto mapping = xe::memory::CreateFileMappingHandle(
+      path, length, xe::memory::PageAccess::kReadWrite, true);
+  REQUIRE(mapping != xe::memory::kFileMappingHandleInvalid);
+  auto view = static_cast<uint8_t*>(xe::memory::MapFileView(
+      mapping, nullptr, length, xe::memory::PageAccess::kReadWrite, 0));
+  auto other_view = static_cast<uint8_t*>(xe::memory::MapFileView(
+      mapping, nullptr, length, xe::memory::PageAccess::kReadWrite, 0));
+  REQUIRE(view);
+  REQUIRE(other_view);
+  REQUIRE(write_tracker->Register(view, length));
+
+  // Writes before watching are not reported.
+  view[3 * page_size] = 1;
+  REQUIRE(write_tracker->Watch(view, length));
+  view[5 * page_size] = 1;
+  view[7 * page_size + 100] = 1;
+  // Neither are the writes through other views.
+  other_view[9 * page_size] = 1;
+  uint64_t written_pages = 0;
+  REQUIRE(write_tracker->GetWrittenPages(view, length, &written_pages));
+  REQUIRE(written_pages == ((uint64_t(1) << 5) | (uint64_t(1) << 7)));
+
+  // Watching again resets only the watched pages.
+  REQUIRE(write_tracker->Watch(view + 5 * page_size, page_size));
+  written_pages = 0;
+  REQUIRE(write_tracker->GetWrittenPages(view, length, &written_pages));
+  REQUIRE(written_pages == (uint64_t(1) << 7));
+
+  xe::memory::UnmapFileView(mapping, other_view, length);
+  xe::memory::UnmapFileView(mapping, view, length);
+  xe::memory::CloseFileMappingHandle(mapping, path);
+}
+
+TEST_CASE("PhysicalHeap physical write map", "[memory]") {
+  cvars::physical_write_map = true;
+  auto memory = std::make_unique<Memory>();
+  bool initialized = memory->Initialize();
+  cvars::physical_write_map = false;
+  REQUIRE(initialized);
+  REQUIRE(memory->physical_write_tracking() ==
+          PhysicalWriteTracking::kWriteMap);
+
+  // Spanning more than one summary region.
+  uint32_t page_size = uint32_t(xe::memory::page_size());
+  uint32_t region_size = uint32_t(1) << Memory::kPhysicalWriteSummaryShift;
+  uint32_t length = 2 * region_size;
+  uint32_t address =
+      memory->SystemHeapAlloc(length, page_size, kSystemHeapPhysical);
+  REQUIRE(address);
+  uint32_t physical_address = memory->GetPhysicalAddress(address);
+  auto host_offset = uint32_t(memory->TranslateVirtual<uint8_t*>(address) -
+                              memory->virtual_membase());
+  std::vector<std::pair<uint32_t, uint32_t>> invalidated_ranges;
+  memory->RegisterPhysicalMemoryInvalidationCallback(
+      [](void* context_ptr, uint32_t physical_address_start, uint32_t length,
+         bool exact_range) {
+        static_cast<std::vector<std::pair<uint32_t, uint32_t>>*>(context_ptr)
+            ->emplace_back(physical_address_start, length);
+        return std::make_pair(uint32_t(0), UINT32_MAX);
+      },
+      &invalidated_ranges);
+
+  // Writes before watching are not reported.
+  memory->MarkPhysicalWrite(host_offset + 4 * page_size, 1);
+  memory->EnablePhysicalMemoryAccessCallbacks(physical_address, length, true,
+                                              false);
+  REQUIRE(memory->PollPhysicalWrites() == 0);
+  REQUIRE(invalidated_ranges.empty());
+
+  // Stores crossing a page boundary and a summary region boundary mark both
+  // sides.
+  uint32_t region_boundary =
+      xe::align(host_offset + 16 * page_size, region_size) - host_offset;
+  memory->MarkPhysicalWrite(host_offset + 3 * page_size - 2, 4);
+  memory->MarkPhysicalWrite(host_offset + 9 * page_size, 4);
+  memory->MarkPhysicalWrite(host_offset + region_boundary - 8, 16);
+  REQUIRE(memory->PollPhysicalWrites() == 5);
+  REQUIRE(invalidated_ranges.size() == 3);
+  REQUIRE(invalidated_ranges[0] ==
+          std::make_pair(physical_address + 2 * page_size, 2 * page_size));
+  REQUIRE(invalidated_ranges[1] ==
+          std::make_pair(physical_address + 9 * page_size, page_size));
+  REQUIRE(invalidated_ranges[2] ==
+          std::make_pair(physical_address + region_boundary - page_size,
+                         2 * page_size));
+  REQUIRE(memory->GetPhysicalWriteStats().write_faults == 0);
+
+  // The marks are cleared, and invalidated pages are not watched anymore.
+  REQUIRE(memory->PollPhysicalWrites() == 0);
+  memory->MarkPhysicalWrite(host_offset + 2 * page_size, 1);
+  REQUIRE(memory->PollPhysicalWrites() == 0);
+  REQUIRE(invalidated_ranges.size() == 3);
+}
+
+TEST_CASE("PhysicalHeap host write tracking", "[memory]") {
+  cvars::host_write_tracking = true;
+  auto memory = std::make_unique<Memory>();
+  bool initialized = memory->Initialize();
+  cvars::host_write_tracking = false;
+  REQUIRE(initialized);
+  if (memory->physical_write_tracking() !=
+      PhysicalWriteTracking::kHostTracker) {
+    // Not supported by the host, write-protecting instead.
+    return;
+  }
+
+  uint32_t page_size = uint32_t(xe::memory::page_size());
+  uint32_t length = 16 * page_size;
+  uint32_t address =
+      memory->SystemHeapAlloc(length, page_size, kSystemHeapPhysical);
+  REQUIRE(address);
+  uint32_t physical_address = memory->GetPhysicalAddress(address);
+  auto host_address = memory->TranslateVirtual<uint8_t*>(address);
+  std::vector<std::pair<uint32_t, uint32_t>> invalidated_ranges;
+  memory->RegisterPhysicalMemoryInvalidationCallback(
+      [](void* context_ptr, uint32_t physical_address_start, uint32_t length,
+         bool exact_range) {
+        static_cast<std::vector<std::pair<uint32_t, uint32_t>>*>(context_ptr)
+            ->emplace_back(physical_address_start, length);
+        return std::make_pair(uint32_t(0), UINT32_MAX);
+      },
+      &invalidated_ranges);
+
+  // Writes before watching are not reported.
+  host_address[4 * page_size] = 1;
+  memory->EnablePhysicalMemoryAccessCallbacks(physical_address, length, true,
+                                              false);
+  REQUIRE(memory->PollPhysicalWrites() == 0);
+  REQUIRE(invalidated_ranges.empty());
+
+  // No access violation, contiguous pages are invalidated together.
+  host_address[2 * page_size] = 1;
+  host_address[3 * page_size + 8] = 1;
+  host_address[9 * page_size] = 1;
+  REQUIRE(memory->PollPhysicalWrites() == 3);
+  REQUIRE(invalidated_ranges.size() == 2);
+  REQUIRE(invalidated_ranges[0] ==
+          std::make_pair(physical_address + 2 * page_size, 2 * page_size));
+  REQUIRE(invalidated_ranges[1] ==
+          std::make_pair(physical_address + 9 * page_size, page_size));
+  REQUIRE(memory->GetPhysicalWriteStats().write_faults == 0);
+
+  // Invalidated pages are not watched anymore.
+  host_address[2 * page_size] = 2;
+  REQUIRE(memory->PollPhysicalWrites() == 0);
+  REQUIRE(invalidated_ranges.size() == 2);
+}
+
 }  // namespace test
 }  // namespace xe
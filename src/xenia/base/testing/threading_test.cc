@@ -9,6 +9,7 @@
 
 #include <array>
 
+#include "xenia/base/mutex.h"
 #include "xenia/base/threading.h"
 
 #define CATCH_CONFIG_ENABLE_CHRONO_STRINGMAKER
@@ -1141,6 +1142,42 @@ TEST_CASE("Test Thread QueueUserCallback", "[thread]") {
   // callbacks.
 }
 
+TEST_CASE("Acquire All Lock Domains", "[lock_domain]") {
+  using audio_region = lock_domain_critical_region<LockDomain::kAudio>;
+  using code_cache_region =
+      lock_domain_critical_region<LockDomain::kCodeCache>;
+
+  // Domains are recursive, and entered in rank order.
+  {
+    auto global_lock = global_critical_region::Acquire();
+    auto audio_lock = audio_region::Acquire();
+    auto code_cache_lock = code_cache_region::Acquire();
+    auto audio_lock_again = audio_region::Acquire();
+    REQUIRE(audio_lock_again.owns_lock());
+  }
+
+  std::atomic<int> audio_acquired = 0;
+  std::atomic<int> code_cache_acquired = 0;
+  auto try_acquire = [&] {
+    auto thread = Thread::Create({}, [&] {
+      audio_acquired = audio_region::TryAcquire().owns_lock() ? 1 : 0;
+      code_cache_acquired =
+          code_cache_region::TryAcquire().owns_lock() ? 1 : 0;
+    });
+    REQUIRE(Wait(thread.get(), false, 1s) == WaitResult::kSuccess);
+  };
+
+  {
+    auto all_domains_lock = AcquireAllLockDomains();
+    try_acquire();
+    REQUIRE(audio_acquired == 0);
+    REQUIRE(code_cache_acquired == 0);
+  }
+  try_acquire();
+  REQUIRE(audio_acquired == 1);
+  REQUIRE(code_cache_acquired == 1);
+}
+
 }  // namespace test
 }  // namespace base
 }  // namespace xe
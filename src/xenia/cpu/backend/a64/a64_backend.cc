@@ -53,6 +53,9 @@ namespace a64 {
 // Resolve a guest function at runtime. Called by the resolve thunk when
 // a guest address has not yet been compiled.
 uint64_t ResolveFunction(void* raw_context, uint64_t target_address);
+// Same, but also chains the call site that entered the chaining resolve thunk.
+uint64_t ResolveAndChainFunction(void* raw_context, uint64_t target_address,
+                                 uint64_t return_address);
 
 // ==========================================================================
 // A64HelperEmitter — generates thunks using xbyak_aarch64.
@@ -63,7 +66,9 @@ class A64HelperEmitter : public A64Emitter {
 
   HostToGuestThunk EmitHostToGuestThunk();
   GuestToHostThunk EmitGuestToHostThunk();
-  ResolveFunctionThunk EmitResolveFunctionThunk();
+  // With chain, the thunk also passes the return address of the bl that
+  // entered it so the calling site can be patched.
+  ResolveFunctionThunk EmitResolveFunctionThunk(bool chain = false);
   void* EmitGuestAndHostSynchronizeStackHelper();
 };
 
@@ -313,7 +318,7 @@ GuestToHostThunk A64HelperEmitter::EmitGuestToHostThunk() {
 //   w16 = guest PPC address (loaded by the call sequence)
 //   x20 = context
 //   x30 = return address (from the BLR that got us here)
-ResolveFunctionThunk A64HelperEmitter::EmitResolveFunctionThunk() {
+ResolveFunctionThunk A64HelperEmitter::EmitResolveFunctionThunk(bool chain) {
   struct {
     size_t prolog;
     size_t prolog_stack_alloc;
@@ -338,8 +343,13 @@ ResolveFunctionThunk A64HelperEmitter::EmitResolveFunctionThunk() {
   // Call ResolveFunction(context, target_address).
   mov(x0, x20);  // x0 = PPCContext*
   mov(x1, x16);  // x1 = guest address (32-bit in w16)
-  // Load address of ResolveFunction.
-  mov(x9, reinterpret_cast<uint64_t>(&ResolveFunction));
+  if (chain) {
+    mov(x2, x30);  // x2 = return address, right after the bl to patch
+    mov(x9, reinterpret_cast<uint64_t>(&ResolveAndChainFunction));
+  } else {
+    // Load address of ResolveFunction.
+    mov(x9, reinterpret_cast<uint64_t>(&ResolveFunction));
+  }
   blr(x9);
   // x0 now holds the resolved host machine code address.
   mov(x9, x0);
@@ -502,6 +512,20 @@ uint64_t ResolveFunction(void* raw_context, uint64_t target_address) {
   return reinterpret_cast<uint64_t>(code);
 }
 
+uint64_t ResolveAndChainFunction(void* raw_context, uint64_t target_address,
+                                 uint64_t return_address) {
+  uint64_t code = ResolveFunction(raw_context, target_address);
+  if (code) {
+    auto guest_context = reinterpret_cast<ppc::PPCContext*>(raw_context);
+    auto backend = static_cast<A64Backend*>(
+        guest_context->thread_state->processor()->backend());
+    backend->code_cache()->ChainCallSite(uint32_t(target_address),
+                                         return_address,
+                                         reinterpret_cast<const void*>(code));
+  }
+  return code;
+}
+
 // ==========================================================================
 // A64Backend
 // ==========================================================================
@@ -602,6 +626,8 @@ bool A64Backend::Initialize(Processor* processor) {
 
   // Set up machine info for the register allocator.
   machine_info_.supports_extended_load_store = true;
+  // The emitter doesn't plant entry counters yet.
+  machine_info_.supports_tiered_compilation = false;
   // GPR set: x22-x28 (7 registers; x19=backend ctx, x20=context, x21=membase)
   auto& gpr_set = machine_info_.register_sets[0];
   gpr_set.id = 0;
@@ -623,9 +649,10 @@ bool A64Backend::Initialize(Processor* processor) {
   host_to_guest_thunk_ = thunk_emitter.EmitHostToGuestThunk();
   guest_to_host_thunk_ = thunk_emitter.EmitGuestToHostThunk();
   resolve_function_thunk_ = thunk_emitter.EmitResolveFunctionThunk();
+  chain_function_thunk_ = thunk_emitter.EmitResolveFunctionThunk(true);
 
   if (!host_to_guest_thunk_ || !guest_to_host_thunk_ ||
-      !resolve_function_thunk_) {
+      !resolve_function_thunk_ || !chain_function_thunk_) {
     XELOGE("A64Backend: Failed to generate thunks");
     return false;
   }
@@ -723,6 +750,9 @@ void A64Backend::InitializeBackendContext(void* ctx) {
   a64_ctx->fpcr_vmx = DEFAULT_VMX_FPCR;
   a64_ctx->flags = (1U << kA64BackendNJMOn);  // NJM on by default
   a64_ctx->guest_tick_count = Clock::GetGuestTickCountPointer();
+  a64_ctx->physical_write_map = processor()->memory()->physical_write_map();
+  a64_ctx->physical_write_summary =
+      processor()->memory()->physical_write_summary();
 
   // Allocate stackpoints for longjmp detection.
   if (cvars::a64_enable_host_guest_stack_synchronization) {
@@ -796,6 +826,10 @@ void A64Backend::FreeGuestTrampoline(uint32_t trampoline_addr) {
   guest_trampoline_address_bitmap_.Release(index);
 }
 
+void A64Backend::UnchainFunction(uint32_t guest_address) {
+  code_cache_->UnchainCallSites(guest_address);
+}
+
 // PPC rounding mode (3-bit) to ARM64 FPCR value.
 // Same table as in a64_sequences.cc SET_ROUNDING_MODE.
 static constexpr uint32_t fpcr_table[8] = {
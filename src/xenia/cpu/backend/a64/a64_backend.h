@@ -84,6 +84,10 @@ struct A64BackendContext {
   // bit 1 = got reserve
   unsigned int flags;
   unsigned int Ox1000;  // constant 0x1000
+  // Memory::physical_write_map() and physical_write_summary(), marked by
+  // stores with --physical_write_map.
+  uint8_t* physical_write_map;
+  uint8_t* physical_write_summary;
 };
 
 // Default FPCR for FPU mode (round to nearest, no flush to zero).
@@ -106,6 +110,10 @@ class A64Backend : public Backend {
   ResolveFunctionThunk resolve_function_thunk() const {
     return resolve_function_thunk_;
   }
+  // Resolve thunk for chainable call sites, also patches the calling site.
+  ResolveFunctionThunk chain_function_thunk() const {
+    return chain_function_thunk_;
+  }
   void* synchronize_guest_and_host_stack_helper() const {
     return synchronize_guest_and_host_stack_helper_;
   }
@@ -137,6 +145,7 @@ class A64Backend : public Backend {
   uint32_t CreateGuestTrampoline(GuestTrampolineProc proc, void* userdata1,
                                  void* userdata2, bool long_term) override;
   void FreeGuestTrampoline(uint32_t trampoline_addr) override;
+  void UnchainFunction(uint32_t guest_address) override;
   void SetGuestRoundingMode(void* ctx, unsigned int mode) override;
   bool PopulatePseudoStacktrace(GuestPseudoStackTrace* st) override;
 
@@ -154,6 +163,7 @@ class A64Backend : public Backend {
   HostToGuestThunk host_to_guest_thunk_ = nullptr;
   GuestToHostThunk guest_to_host_thunk_ = nullptr;
   ResolveFunctionThunk resolve_function_thunk_ = nullptr;
+  ResolveFunctionThunk chain_function_thunk_ = nullptr;
   void* synchronize_guest_and_host_stack_helper_ = nullptr;
 
  public:
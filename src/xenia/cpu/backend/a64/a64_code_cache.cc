@@ -9,6 +9,7 @@
 
 #include "xenia/cpu/backend/a64/a64_code_cache.h"
 
+#include "xenia/base/atomic.h"
 #include "xenia/base/platform.h"
 #if XE_PLATFORM_WIN32
 #include "xenia/base/platform_win.h"
@@ -42,6 +43,24 @@ void A64CodeCache::FlushCodeRange(void* address, size_t size) {
 #endif
 }
 
+bool A64CodeCache::PatchCallSite(uint8_t* site_write_address,
+                                 const uint8_t* site_execute_address,
+                                 const void* target) {
+  // BL #imm26, reaching +-128 MiB. The code cache is larger than that, so far
+  // callees stay behind the resolver.
+  int64_t displacement =
+      reinterpret_cast<const uint8_t*>(target) - site_execute_address;
+  if ((displacement & 3) || displacement < -(int64_t(1) << 27) ||
+      displacement >= (int64_t(1) << 27)) {
+    return false;
+  }
+  uint32_t bl = 0x94000000 | (uint32_t(displacement >> 2) & 0x03FFFFFF);
+  xe::atomic_exchange(int32_t(bl),
+                      reinterpret_cast<volatile int32_t*>(site_write_address));
+  FlushCodeRange(site_write_address, sizeof(bl));
+  return true;
+}
+
 }  // namespace a64
 }  // namespace backend
 }  // namespace cpu
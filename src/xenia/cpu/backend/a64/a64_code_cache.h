@@ -32,6 +32,8 @@ class A64CodeCache : public CodeCacheBase<A64CodeCache> {
   // CRTP hooks for CodeCacheBase.
   void FillCode(void* write_address, size_t size);
   void FlushCodeRange(void* address, size_t size);
+  bool PatchCallSite(uint8_t* site_write_address,
+                     const uint8_t* site_execute_address, const void* target);
 
   // Virtual for platform-specific overrides (_win.cc / _posix.cc).
   virtual UnwindReservation RequestUnwindReservation(uint8_t* entry_address) {
@@ -335,6 +335,26 @@ void A64Emitter::Call(const hir::Instr* instr, GuestFunction* function) {
   ForgetFpcrMode();
   auto fn = static_cast<A64Function*>(function);
 
+  if (cvars::chain_direct_calls && code_cache_->has_indirection_table() &&
+      !(instr->flags & hir::CALL_TAIL)) {
+    // The bl initially goes to a stub jumping to the chaining resolver, which
+    // patches it to the callee's code once it's resolved, if in bl range. The
+    // code cache keeps track of the site and repoints it if the callee is
+    // recompiled, or restores the original bl to the stub.
+    auto& resolve = NewCachedLabel();
+    auto& done = NewCachedLabel();
+    mov(w16, function->address());
+    ldr(x0, ptr(sp, static_cast<uint32_t>(StackLayout::GUEST_CALL_RET_ADDR)));
+    bl(resolve);
+    b(done);
+    L(resolve);
+    mov(x9, reinterpret_cast<uint64_t>(backend_->chain_function_thunk()));
+    br(x9);
+    L(done);
+    synchronize_stack_on_next_instruction_ = true;
+    return;
+  }
+
   if (fn->machine_code()) {
     // Direct call — function is already compiled.
     mov(x9, reinterpret_cast<uint64_t>(fn->machine_code()));
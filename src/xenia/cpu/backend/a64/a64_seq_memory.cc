@@ -131,6 +131,7 @@ static void MMIOAwareStore(void* _ctx, unsigned int guestaddr, T value) {
   auto gaddr = ctx->processor->memory()->LookupVirtualMappedRange(guestaddr);
   if (!gaddr) {
     *reinterpret_cast<T*>(ctx->virtual_membase + guestaddr) = value;
+    ctx->processor->memory()->MarkPhysicalWrite(guestaddr, sizeof(T));
   } else {
     value = xe::byte_swap(value);
     gaddr->write(nullptr, gaddr->callback_context, guestaddr, value);
@@ -292,6 +293,9 @@ struct STORE_I8 : Sequence<STORE_I8, I<OPCODE_STORE, VoidOp, I64Op, I8Op>> {
     } else {
       e.strb(i.src2, ptr(e.GetMembaseReg(), addr));
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 1);
+    }
   }
 };
 struct STORE_I16 : Sequence<STORE_I16, I<OPCODE_STORE, VoidOp, I64Op, I16Op>> {
@@ -313,6 +317,9 @@ struct STORE_I16 : Sequence<STORE_I16, I<OPCODE_STORE, VoidOp, I64Op, I16Op>> {
         e.strh(i.src2, ptr(e.GetMembaseReg(), addr));
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 2);
+    }
   }
 };
 struct STORE_I32 : Sequence<STORE_I32, I<OPCODE_STORE, VoidOp, I64Op, I32Op>> {
@@ -387,6 +394,9 @@ struct STORE_I32 : Sequence<STORE_I32, I<OPCODE_STORE, VoidOp, I64Op, I32Op>> {
             e.str(i.src2, ptr(e.GetMembaseReg(), addr));
           }
         }
+        if (NeedsPhysicalWriteMark(i.src1)) {
+          MarkPhysicalWrite(e, addr, 4);
+        }
       }
       e.L(done);
     } else {
@@ -409,6 +419,9 @@ struct STORE_I32 : Sequence<STORE_I32, I<OPCODE_STORE, VoidOp, I64Op, I32Op>> {
           e.str(i.src2, ptr(e.GetMembaseReg(), addr));
         }
       }
+      if (NeedsPhysicalWriteMark(i.src1)) {
+        MarkPhysicalWrite(e, addr, 4);
+      }
     }
   }
 };
@@ -431,6 +444,9 @@ struct STORE_I64 : Sequence<STORE_I64, I<OPCODE_STORE, VoidOp, I64Op, I64Op>> {
         e.str(i.src2, ptr(e.GetMembaseReg(), addr));
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 8);
+    }
   }
 };
 struct STORE_F32 : Sequence<STORE_F32, I<OPCODE_STORE, VoidOp, I64Op, F32Op>> {
@@ -454,6 +470,9 @@ struct STORE_F32 : Sequence<STORE_F32, I<OPCODE_STORE, VoidOp, I64Op, F32Op>> {
         e.str(i.src2, ptr(e.GetMembaseReg(), addr));
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 4);
+    }
   }
 };
 struct STORE_F64 : Sequence<STORE_F64, I<OPCODE_STORE, VoidOp, I64Op, F64Op>> {
@@ -477,6 +496,9 @@ struct STORE_F64 : Sequence<STORE_F64, I<OPCODE_STORE, VoidOp, I64Op, F64Op>> {
         e.str(i.src2, ptr(e.GetMembaseReg(), addr));
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 8);
+    }
   }
 };
 struct STORE_V128
@@ -505,6 +527,9 @@ struct STORE_V128
         e.str(i.src2, ptr(e.GetMembaseReg(), addr));
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 16);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_STORE, STORE_I8, STORE_I16, STORE_I32, STORE_I64,
@@ -648,6 +673,9 @@ struct STORE_OFFSET_I8
     } else {
       e.strb(i.src3, ptr(e.GetMembaseReg(), e.x0));
     }
+    if (NeedsPhysicalWriteMark(i.src1, i.src2)) {
+      MarkPhysicalWrite(e, e.x0, 1);
+    }
   }
 };
 struct STORE_OFFSET_I16
@@ -671,6 +699,9 @@ struct STORE_OFFSET_I16
         e.strh(i.src3, ptr(e.GetMembaseReg(), e.x0));
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1, i.src2)) {
+      MarkPhysicalWrite(e, e.x0, 2);
+    }
   }
 };
 struct STORE_OFFSET_I32
@@ -764,6 +795,9 @@ struct STORE_OFFSET_I32
             e.str(i.src3, ptr(e.GetMembaseReg(), e.x0));
           }
         }
+        if (NeedsPhysicalWriteMark(i.src1, i.src2)) {
+          MarkPhysicalWrite(e, e.x0, 4);
+        }
       }
       e.L(done);
     } else {
@@ -786,6 +820,9 @@ struct STORE_OFFSET_I32
           e.str(i.src3, ptr(e.GetMembaseReg(), e.x0));
         }
       }
+      if (NeedsPhysicalWriteMark(i.src1, i.src2)) {
+        MarkPhysicalWrite(e, e.x0, 4);
+      }
     }
   }
 };
@@ -810,6 +847,9 @@ struct STORE_OFFSET_I64
         e.str(i.src3, ptr(e.GetMembaseReg(), e.x0));
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1, i.src2)) {
+      MarkPhysicalWrite(e, e.x0, 8);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_STORE_OFFSET, STORE_OFFSET_I8, STORE_OFFSET_I16,
@@ -862,6 +902,9 @@ struct MEMSET_I64
     for (; off + 1 <= len; off += 1) {
       e.strb(e.wzr, AdrPostImm(e.x0, 1));
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, ComputeMemoryAddress(e, i.src1), len);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_MEMSET, MEMSET_I64);
@@ -896,6 +939,9 @@ struct ATOMIC_COMPARE_EXCHANGE_I32
       e.casal(e.w5, e.w6, ptr(e.x4));
       e.cmp(e.w5, e.w0);
       e.cset(i.dest, Xbyak_aarch64::EQ);
+      if (NeedsPhysicalWriteMark(i.src1)) {
+        MarkPhysicalWrite(e, ComputeMemoryAddress(e, i.src1), 4);
+      }
       return;
     }
 
@@ -914,6 +960,9 @@ struct ATOMIC_COMPARE_EXCHANGE_I32
     e.clrex(15);
     e.mov(i.dest, 0);
     e.L(done);
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, ComputeMemoryAddress(e, i.src1), 4);
+    }
   }
 };
 struct ATOMIC_COMPARE_EXCHANGE_I64
@@ -938,6 +987,9 @@ struct ATOMIC_COMPARE_EXCHANGE_I64
       e.casal(e.x5, e.x6, ptr(e.x4));
       e.cmp(e.x5, e.x0);
       e.cset(i.dest, Xbyak_aarch64::EQ);
+      if (NeedsPhysicalWriteMark(i.src1)) {
+        MarkPhysicalWrite(e, ComputeMemoryAddress(e, i.src1), 8);
+      }
       return;
     }
 
@@ -956,6 +1008,9 @@ struct ATOMIC_COMPARE_EXCHANGE_I64
     e.clrex(15);
     e.mov(i.dest, 0);
     e.L(done);
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, ComputeMemoryAddress(e, i.src1), 8);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_ATOMIC_COMPARE_EXCHANGE,
@@ -1124,6 +1179,9 @@ struct RESERVED_STORE_I32
     e.L(no_reserve);
     e.mov(i.dest, 0);
     e.L(done);
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, ComputeMemoryAddress(e, i.src1), 4);
+    }
   }
 };
 struct RESERVED_STORE_I64
@@ -1179,6 +1237,9 @@ struct RESERVED_STORE_I64
     e.L(no_reserve);
     e.mov(i.dest, 0);
     e.L(done);
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, ComputeMemoryAddress(e, i.src1), 8);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_RESERVED_STORE, RESERVED_STORE_I32,
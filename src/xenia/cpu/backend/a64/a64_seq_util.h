@@ -10,12 +10,14 @@
 #ifndef XENIA_CPU_BACKEND_A64_A64_SEQ_UTIL_H_
 #define XENIA_CPU_BACKEND_A64_A64_SEQ_UTIL_H_
 
+#include "xenia/base/cvar.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/vec128.h"
 #include "xenia/cpu/backend/a64/a64_backend.h"
 #include "xenia/cpu/backend/a64/a64_emitter.h"
 #include "xenia/cpu/backend/a64/a64_op.h"
 #include "xenia/cpu/backend/a64/a64_stack_layout.h"
+#include "xenia/memory.h"
 
 #include "xbyak_aarch64.h"
 
@@ -30,6 +32,8 @@ constexpr uint32_t DCZID_EL0 = ARM64_SYSREG(0b11, 0b011, 0b0000, 0b0000, 0b111);
 #error "No MRS wrapper available for current compiler implemented."
 #endif
 
+DECLARE_bool(physical_write_map);
+
 namespace xe {
 namespace cpu {
 namespace backend {
@@ -310,6 +314,66 @@ inline XReg AddGuestMemoryOffset(A64Emitter& e, const XReg& base,
   return e.x0;
 }
 
+// Whether a store to the guest address needs to be marked in the physical
+// write map - constant addresses below the physical memory views are skipped.
+inline bool NeedsPhysicalWriteMark(const I64Op& guest) {
+  if (!cvars::physical_write_map) {
+    return false;
+  }
+  return !guest.is_constant || uint32_t(guest.constant()) >=
+                                   Memory::kPhysicalWriteMapBase;
+}
+inline bool NeedsPhysicalWriteMark(const I64Op& guest, const I64Op& offset) {
+  if (!cvars::physical_write_map) {
+    return false;
+  }
+  return !guest.is_constant || !offset.is_constant ||
+         uint32_t(guest.constant() + offset.constant()) >=
+             Memory::kPhysicalWriteMapBase;
+}
+
+// Sets the bytes of the first and the last byte of a store of size bytes at the
+// membase-relative offset in x16 to w1 in a map of 1 << shift byte granules,
+// with release semantics. Clobbers x0 and x17.
+inline void MarkPhysicalWriteMapBytes(A64Emitter& e, uint32_t shift,
+                                      size_t map_ctx_offset, uint32_t size) {
+  using namespace Xbyak_aarch64;
+  e.ldr(e.x17,
+        ptr(e.GetBackendCtxReg(), static_cast<uint32_t>(map_ctx_offset)));
+  if (size > 1) {
+    // The last byte may be in the next granule if unaligned.
+    e.add(e.x0, e.x16, static_cast<uint64_t>(size - 1));
+    e.add(e.x0, e.x17, e.x0, LSR, shift);
+    e.stlrb(e.w1, ptr(e.x0));
+  }
+  e.add(e.x0, e.x17, e.x16, LSR, shift);
+  e.stlrb(e.w1, ptr(e.x0));
+}
+
+// Marks the pages written by a store of size bytes at the membase-relative
+// address in Memory::physical_write_map(), and then their regions in
+// Memory::physical_write_summary(). The marks are stored with release
+// semantics so the written data and the page marks are visible to whoever
+// observes the later marks. Must be emitted after the store so a poll between
+// the two can't miss it. Clobbers x0, x1, x16 and x17.
+inline void MarkPhysicalWrite(A64Emitter& e, const XReg& host_offset,
+                              uint32_t size) {
+  using namespace Xbyak_aarch64;
+  auto& skip = e.NewCachedLabel();
+  e.mov(e.w16, WReg(host_offset.getIdx()));
+  e.mov(e.w17, Memory::kPhysicalWriteMapBase);
+  e.cmp(e.w16, e.w17);
+  e.b(LO, skip);
+  e.mov(e.w1, 1);
+  MarkPhysicalWriteMapBytes(e, Memory::kPhysicalWriteMapPageShift,
+                            offsetof(A64BackendContext, physical_write_map),
+                            size);
+  MarkPhysicalWriteMapBytes(e, Memory::kPhysicalWriteSummaryShift,
+                            offsetof(A64BackendContext, physical_write_summary),
+                            size);
+  e.L(skip);
+}
+
 // Flush denormal float32 lanes to zero in a NEON register (in-place).
 // A float32 is denormal when 0 < abs(val) < 0x00800000.
 // vreg must not equal sa or sb.
@@ -1962,6 +1962,10 @@ struct STVL_V128 : Sequence<STVL_V128, I<OPCODE_STVL, VoidOp, I64Op, V128Op>> {
     // 2-register TBL: blend original mem and rev32(src).
     e.tbl(VReg(2).b16, VReg(0).b16, 2, VReg(2).b16);
     e.str(QReg(2), ptr(e.x16));
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      e.sub(e.x0, e.x16, e.GetMembaseReg());
+      MarkPhysicalWrite(e, e.x0, 16);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_STVL, STVL_V128);
@@ -2022,6 +2026,10 @@ struct STVR_V128 : Sequence<STVR_V128, I<OPCODE_STVR, VoidOp, I64Op, V128Op>> {
     // 2-register TBL and store.
     e.tbl(VReg(2).b16, VReg(0).b16, 2, VReg(2).b16);
     e.str(QReg(2), ptr(e.x16));
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      e.sub(e.x0, e.x16, e.GetMembaseReg());
+      MarkPhysicalWrite(e, e.x0, 16);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_STVR, STVR_V128);
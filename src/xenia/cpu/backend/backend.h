@@ -10,6 +10,7 @@
 #ifndef XENIA_CPU_BACKEND_BACKEND_H_
 #define XENIA_CPU_BACKEND_BACKEND_H_
 
+#include <filesystem>
 #include <memory>
 
 #include "xenia/cpu/backend/machine_info.h"
@@ -119,6 +120,19 @@ class Backend {
   }
   virtual void FreeGuestTrampoline(uint32_t trampoline_addr) {}
 
+  // Sends call sites chained directly to the guest function's code back
+  // through the resolver, for when that code must no longer be entered.
+  virtual void UnchainFunction(uint32_t guest_address) {}
+
+  // Persistent code cache for a loaded module, keyed by the directory the
+  // module keeps its other caches in. Backends without one ignore these.
+  virtual void OpenModuleCodeCache(Module* module,
+                                   const std::filesystem::path& cache_path) {}
+  virtual void CloseModuleCodeCache(Module* module) {}
+  // Sets up the function from the module's code cache instead of translating
+  // it. Returns false if it has to be translated normally.
+  virtual bool LoadCachedFunction(GuestFunction* function) { return false; }
+
  protected:
   Processor* processor_ = nullptr;
   MachineInfo machine_info_;
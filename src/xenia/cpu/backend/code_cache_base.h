@@ -17,11 +17,13 @@
 #include <cstring>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/assert.h"
+#include "xenia/base/atomic.h"
 #include "xenia/base/clock.h"
 #include "xenia/base/literals.h"
 #include "xenia/base/logging.h"
@@ -80,6 +82,12 @@ struct EmitFunctionInfo {
 //                     void* code_execute_address, size_t code_size)
 //     Optional hook called after code is placed outside the critical section
 //     (used for VTune integration on x64). Default is no-op.
+//
+//   bool PatchCallSite(uint8_t* site_write_address,
+//                      const uint8_t* site_execute_address, const void* target)
+//     Retarget the 4-byte call field of a chained call site (the rel32 of a
+//     call on x64, the bl on ARM64) so the call lands on target, with a single
+//     aligned store. Returns false if target is out of range.
 template <typename Derived>
 class CodeCacheBase : public CodeCache {
  public:
@@ -121,7 +129,10 @@ class CodeCacheBase : public CodeCache {
     }
     uint32_t* indirection_slot = reinterpret_cast<uint32_t*>(
         indirection_table_base_ + (guest_address - kIndirectionTableBase));
-    *indirection_slot = host_address;
+    // Read by the running guest code, and replaced while the function may be
+    // running when it's recompiled at a higher tier.
+    std::atomic_ref<uint32_t>(*indirection_slot)
+        .store(host_address, std::memory_order_release);
   }
 
   void CommitExecutableRange(uint32_t guest_low, uint32_t guest_high) {
@@ -154,7 +165,7 @@ class CodeCacheBase : public CodeCache {
     using namespace xe::literals;
     uint8_t* code_execute_address;
     {
-      auto global_lock = global_critical_region_.Acquire();
+      auto code_cache_lock = critical_region_.Acquire();
 
       code_execute_address =
           generated_code_execute_base_ + generated_code_offset_;
@@ -210,20 +221,94 @@ class CodeCacheBase : public CodeCache {
     self().OnCodePlaced(guest_address, function_info, code_execute_address,
                         func_info.code_size.total);
 
-    // Fix up indirection table.
+    // Fix up indirection table, and send call sites chained to the code this
+    // replaces to the new code.
     if (guest_address && indirection_table_base_) {
+      auto code_cache_lock = critical_region_.Acquire();
       uint32_t* indirection_slot = reinterpret_cast<uint32_t*>(
           indirection_table_base_ + (guest_address - kIndirectionTableBase));
       *indirection_slot =
           uint32_t(reinterpret_cast<uint64_t>(code_execute_address));
+      auto it = chained_call_sites_.find(guest_address);
+      if (it != chained_call_sites_.end()) {
+        auto& sites = it->second;
+        for (size_t i = 0; i < sites.size();) {
+          if (PatchChainedCallSite(sites[i], code_execute_address)) {
+            ++i;
+            continue;
+          }
+          RestoreChainedCallSite(sites[i]);
+          sites[i] = sites.back();
+          sites.pop_back();
+        }
+      }
     }
   }
 
+  // Patches the call site whose call returns to return_address to call target,
+  // the code the guest function currently resolves to, directly. The site
+  // must have been emitted as a chainable call to the chaining resolver.
+  // Returns false if the site was left going through the resolver.
+  bool ChainCallSite(uint32_t guest_address, uint64_t return_address,
+                     const void* target) {
+    if (!indirection_table_base_) {
+      return false;
+    }
+    uint64_t site_offset =
+        return_address - 4 - uint64_t(generated_code_execute_base_);
+    auto code_cache_lock = critical_region_.Acquire();
+    if (site_offset >= generated_code_offset_) {
+      return false;
+    }
+    // Don't chain to code that has been replaced since it was resolved.
+    uint32_t* indirection_slot = reinterpret_cast<uint32_t*>(
+        indirection_table_base_ + (guest_address - kIndirectionTableBase));
+    if (*indirection_slot != uint32_t(reinterpret_cast<uint64_t>(target))) {
+      return false;
+    }
+    auto& sites = chained_call_sites_[guest_address];
+    for (const ChainedCallSite& site : sites) {
+      // Another thread went through the resolver from the same site first.
+      if (site.offset == uint32_t(site_offset)) {
+        return true;
+      }
+    }
+    ChainedCallSite site;
+    site.offset = uint32_t(site_offset);
+    std::memcpy(&site.original, generated_code_write_base_ + site.offset,
+                sizeof(site.original));
+    if (!PatchChainedCallSite(site, target)) {
+      return false;
+    }
+    sites.push_back(site);
+    return true;
+  }
+
+  // Reverts all call sites chained to the guest function back to the
+  // resolver, and resets its indirection slot so the next call resolves it
+  // again.
+  void UnchainCallSites(uint32_t guest_address) {
+    if (!indirection_table_base_) {
+      return;
+    }
+    auto code_cache_lock = critical_region_.Acquire();
+    auto it = chained_call_sites_.find(guest_address);
+    if (it != chained_call_sites_.end()) {
+      for (const ChainedCallSite& site : it->second) {
+        RestoreChainedCallSite(site);
+      }
+      chained_call_sites_.erase(it);
+    }
+    uint32_t* indirection_slot = reinterpret_cast<uint32_t*>(
+        indirection_table_base_ + (guest_address - kIndirectionTableBase));
+    *indirection_slot = indirection_default_value_;
+  }
+
   uint32_t PlaceData(const void* data, size_t length) {
     size_t high_mark;
     uint8_t* data_address = nullptr;
     {
-      auto global_lock = global_critical_region_.Acquire();
+      auto code_cache_lock = critical_region_.Acquire();
       data_address = generated_code_write_base_ + generated_code_offset_;
       generated_code_offset_ += xe::round_up(length, 16);
       high_mark = generated_code_offset_;
@@ -358,7 +443,10 @@ class CodeCacheBase : public CodeCache {
   std::filesystem::path file_name_;
   xe::memory::FileMappingHandle mapping_ =
       xe::memory::kFileMappingHandleInvalid;
-  xe::global_critical_region global_critical_region_;
+  // Code cache state only changes in compilation and code cache maintenance,
+  // which don't touch anything else under the global critical region, so
+  // they don't need to exclude the guest threads running in it.
+  xe::lock_domain_critical_region<xe::LockDomain::kCodeCache> critical_region_;
   uint32_t indirection_default_value_ = 0xFEEDF00D;
   uint8_t* indirection_table_base_ = nullptr;
   uint8_t* generated_code_execute_base_ = nullptr;
@@ -368,8 +456,33 @@ class CodeCacheBase : public CodeCache {
   std::vector<std::pair<uint64_t, GuestFunction*>> generated_code_map_;
 
  private:
+  struct ChainedCallSite {
+    // Offset of the call field from the start of the generated code.
+    uint32_t offset;
+    // Call field as emitted, targeting the resolver.
+    uint32_t original;
+  };
+
+  // Call sites patched to call a guest function's code directly, by guest
+  // address. Protected by critical_region_.
+  std::unordered_map<uint32_t, std::vector<ChainedCallSite>>
+      chained_call_sites_;
+
   Derived& self() { return static_cast<Derived&>(*this); }
 
+  bool PatchChainedCallSite(const ChainedCallSite& site, const void* target) {
+    return self().PatchCallSite(generated_code_write_base_ + site.offset,
+                                generated_code_execute_base_ + site.offset,
+                                target);
+  }
+
+  void RestoreChainedCallSite(const ChainedCallSite& site) {
+    uint8_t* write_address = generated_code_write_base_ + site.offset;
+    xe::atomic_exchange(int32_t(site.original),
+                        reinterpret_cast<volatile int32_t*>(write_address));
+    self().FlushCodeRange(write_address, sizeof(site.original));
+  }
+
   void EnsureCommitted(size_t high_mark) {
     using namespace xe::literals;
     size_t old_commit_mark, new_commit_mark;
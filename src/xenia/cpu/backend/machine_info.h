@@ -18,6 +18,9 @@ namespace backend {
 
 struct MachineInfo {
   bool supports_extended_load_store;
+  // Baseline code emitted by the backend counts its entries and requests an
+  // optimized recompile (see --tiered_compilation).
+  bool supports_tiered_compilation;
 
   struct RegisterSet {
     enum Types {
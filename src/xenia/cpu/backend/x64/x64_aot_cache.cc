@@ -0,0 +1,497 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/backend/x64/x64_aot_cache.h"
+
+#include <cstring>
+#include <limits>
+
+#include "version.h"
+#include "xenia/base/assert.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/platform.h"
+#include "xenia/base/platform_amd64.h"
+#include "xenia/base/xxhash.h"
+#include "xenia/cpu/backend/x64/x64_backend.h"
+#include "xenia/cpu/backend/x64/x64_code_cache.h"
+#include "xenia/cpu/backend/x64/x64_function.h"
+#include "xenia/cpu/cpu_flags.h"
+#include "xenia/cpu/processor.h"
+#include "xenia/memory.h"
+
+#if XE_PLATFORM_WIN32
+#include "xenia/base/platform_win.h"
+extern "C" IMAGE_DOS_HEADER __ImageBase;
+#elif XE_PLATFORM_GNU_LINUX
+// Provided by both GNU ld and lld for the main executable.
+extern "C" char __executable_start[];
+extern "C" char _end[];
+#endif
+
+DEFINE_bool(enable_aot_code_cache, false,
+            "Store translated guest functions on disk next to the instruction "
+            "info cache and reuse them on later launches instead of "
+            "recompiling. Invalidated automatically when the emulator build, "
+            "CPU features or code generation options change.",
+            "x64");
+
+// Everything below changes the code the translator emits, so it's part of the
+// cache key.
+DECLARE_bool(debug);
+DECLARE_bool(disable_context_promotion);
+DECLARE_bool(store_all_context_values);
+DECLARE_bool(full_optimization_even_with_debug);
+DECLARE_bool(inline_mmio_access);
+DECLARE_bool(permit_float_constant_evaluation);
+DECLARE_bool(disable_prefetch_and_cachecontrol);
+DECLARE_bool(no_reserved_ops);
+DECLARE_bool(ignore_trap_instructions);
+DECLARE_bool(break_on_unimplemented_instructions);
+DECLARE_bool(elide_e0_check);
+DECLARE_bool(enable_rmw_context_merging);
+DECLARE_bool(emit_mmio_aware_stores_for_recorded_exception_addresses);
+DECLARE_bool(emit_inline_mmio_checks);
+DECLARE_bool(xop_rotates);
+DECLARE_bool(xop_left_shifts);
+DECLARE_bool(xop_right_shifts);
+DECLARE_bool(xop_arithmetic_right_shifts);
+DECLARE_bool(xop_compares);
+DECLARE_bool(use_fast_dot_product);
+DECLARE_bool(no_round_to_single);
+DECLARE_bool(inline_loadclock);
+DECLARE_bool(delay_via_maybeyield);
+DECLARE_bool(enable_incorrect_roundingmode_behavior);
+DECLARE_uint32(align_all_basic_blocks);
+DECLARE_bool(emit_source_annotations);
+
+namespace xe {
+namespace cpu {
+namespace backend {
+namespace x64 {
+
+static void GetHostImageRange(uintptr_t* base_out, uintptr_t* end_out) {
+#if XE_PLATFORM_WIN32
+  auto base = reinterpret_cast<uintptr_t>(&__ImageBase);
+  auto nt_headers = reinterpret_cast<const IMAGE_NT_HEADERS*>(
+      base + __ImageBase.e_lfanew);
+  *base_out = base;
+  *end_out = base + nt_headers->OptionalHeader.SizeOfImage;
+#elif XE_PLATFORM_GNU_LINUX
+  *base_out = reinterpret_cast<uintptr_t>(__executable_start);
+  *end_out = reinterpret_cast<uintptr_t>(_end);
+#else
+  // Unknown image layout, nothing can be relocated.
+  *base_out = 0;
+  *end_out = 0;
+#endif
+}
+
+uintptr_t GetHostImageBase() {
+  uintptr_t base, end;
+  GetHostImageRange(&base, &end);
+  return base;
+}
+
+bool IsHostImageAddress(const void* address) {
+  uintptr_t base, end;
+  GetHostImageRange(&base, &end);
+  auto value = reinterpret_cast<uintptr_t>(address);
+  return value >= base && value < end;
+}
+
+uint64_t X64AotCache::ComputeKey(X64Backend* backend) {
+  XXH3_state_t hash_state;
+  XXH3_64bits_reset(&hash_state);
+  auto hash = [&hash_state](const auto& value) {
+    XXH3_64bits_update(&hash_state, &value, sizeof(value));
+  };
+
+  hash(kFileVersion);
+  XXH3_64bits_update(&hash_state, XE_BUILD_COMMIT, sizeof(XE_BUILD_COMMIT));
+
+  // Host image layout: relocations assume the same executable, only slid.
+  uintptr_t image_base, image_end;
+  GetHostImageRange(&image_base, &image_end);
+  hash(uint64_t(image_end - image_base));
+  hash(uint64_t(reinterpret_cast<uintptr_t>(&IsHostImageAddress) -
+                image_base));
+
+  // Backend state referenced by absolute address from emitted code.
+  auto processor = backend->processor();
+  hash(amd64::GetFeatureFlags());
+  hash(uint64_t(backend->emitter_data()));
+  hash(uint64_t(
+      reinterpret_cast<uintptr_t>(processor->memory()->virtual_membase())));
+  const void* helpers[] = {
+      reinterpret_cast<const void*>(backend->host_to_guest_thunk()),
+      reinterpret_cast<const void*>(backend->guest_to_host_thunk()),
+      reinterpret_cast<const void*>(backend->resolve_function_thunk()),
+      backend->synchronize_guest_and_host_stack_helper_for_size(1),
+      backend->synchronize_guest_and_host_stack_helper_for_size(2),
+      backend->synchronize_guest_and_host_stack_helper_for_size(4),
+      backend->try_acquire_reservation_helper_,
+      backend->reserved_store_32_helper,
+      backend->reserved_store_64_helper,
+      backend->vrsqrtefp_vector_helper,
+      backend->vrsqrtefp_scalar_helper,
+      backend->frsqrtefp_helper,
+  };
+  for (const void* helper : helpers) {
+    hash(uint64_t(reinterpret_cast<uintptr_t>(helper)));
+  }
+
+  // Code generation options.
+  hash(cvars::pvr);
+  hash(cvars::debug);
+  hash(cvars::disable_context_promotion);
+  hash(cvars::store_all_context_values);
+  hash(cvars::full_optimization_even_with_debug);
+  hash(cvars::inline_mmio_access);
+  hash(cvars::permit_float_constant_evaluation);
+  hash(cvars::disable_prefetch_and_cachecontrol);
+  hash(cvars::no_reserved_ops);
+  hash(cvars::ignore_trap_instructions);
+  hash(cvars::break_on_unimplemented_instructions);
+  hash(cvars::elide_e0_check);
+  hash(cvars::enable_rmw_context_merging);
+  hash(cvars::emit_mmio_aware_stores_for_recorded_exception_addresses);
+  hash(cvars::emit_inline_mmio_checks);
+  hash(cvars::xop_rotates);
+  hash(cvars::xop_left_shifts);
+  hash(cvars::xop_right_shifts);
+  hash(cvars::xop_arithmetic_right_shifts);
+  hash(cvars::xop_compares);
+  hash(cvars::use_fast_dot_product);
+  hash(cvars::no_round_to_single);
+  hash(cvars::inline_loadclock);
+  hash(cvars::delay_via_maybeyield);
+  hash(cvars::enable_incorrect_roundingmode_behavior);
+  hash(cvars::align_all_basic_blocks);
+  hash(cvars::emit_source_annotations);
+  hash(cvars::enable_host_guest_stack_synchronization);
+  hash(cvars::global_register_allocation);
+  hash(cvars::inline_guest_functions);
+  hash(cvars::inline_max_instructions);
+  hash(cvars::inline_max_depth);
+  hash(cvars::chain_direct_calls);
+  hash(cvars::profile_guided_block_layout);
+
+  return XXH3_64bits_digest(&hash_state);
+}
+
+X64AotCache::X64AotCache(X64Backend* backend,
+                         const std::filesystem::path& path)
+    : backend_(backend), path_(path) {}
+
+X64AotCache::~X64AotCache() {
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+std::unique_ptr<X64AotCache> X64AotCache::Open(
+    X64Backend* backend, const std::filesystem::path& module_cache_path) {
+  if (!IsHostImageAddress(reinterpret_cast<const void*>(&IsHostImageAddress))) {
+    XELOGW("AOT code cache is not supported on this platform");
+    return nullptr;
+  }
+  auto cache = std::unique_ptr<X64AotCache>(
+      new X64AotCache(backend, module_cache_path / "x64_code_cache.bin"));
+  if (!cache->Initialize(ComputeKey(backend))) {
+    return nullptr;
+  }
+  return cache;
+}
+
+bool X64AotCache::Initialize(uint64_t key) {
+  if (!xe::filesystem::CreateParentFolder(path_)) {
+    return false;
+  }
+
+  // Read whatever a previous session left behind.
+  FILE* file = xe::filesystem::OpenFile(path_, "rb");
+  if (file) {
+    xe::filesystem::Seek(file, 0, SEEK_END);
+    int64_t file_size = xe::filesystem::Tell(file);
+    xe::filesystem::Seek(file, 0, SEEK_SET);
+    if (file_size > 0) {
+      data_.resize(size_t(file_size));
+      if (fread(data_.data(), 1, data_.size(), file) != data_.size()) {
+        data_.clear();
+      }
+    }
+    fclose(file);
+  }
+
+  // Validate the header and index the records. A torn record at the end (for
+  // instance after a crash mid-write) is cut off.
+  size_t valid_size = 0;
+  FileHeader file_header;
+  if (data_.size() >= sizeof(file_header)) {
+    std::memcpy(&file_header, data_.data(), sizeof(file_header));
+    if (file_header.magic == kFileMagic &&
+        file_header.version == kFileVersion && file_header.key == key) {
+      valid_size = sizeof(file_header);
+    }
+  }
+  if (valid_size) {
+    size_t offset = valid_size;
+    while (data_.size() - offset >= sizeof(RecordHeader)) {
+      RecordHeader record;
+      std::memcpy(&record, data_.data() + offset, sizeof(record));
+      if (record.magic != kRecordMagic) {
+        break;
+      }
+      uint64_t record_size = sizeof(RecordHeader) + uint64_t(record.code_size) +
+                             uint64_t(record.relocation_count) *
+                                 sizeof(X64CodeRelocation) +
+                             uint64_t(record.source_map_count) *
+                                 sizeof(SourceMapEntry) +
+                             uint64_t(record.inlined_callee_count) *
+                                 sizeof(uint32_t);
+      if (record_size > data_.size() - offset) {
+        break;
+      }
+      // Later records for the same address supersede earlier ones.
+      if (record.code_size) {
+        records_[record.guest_address] = offset;
+        std::vector<uint32_t> callees(record.inlined_callee_count);
+        std::memcpy(callees.data(),
+                    data_.data() + offset + size_t(record_size) -
+                        callees.size() * sizeof(uint32_t),
+                    callees.size() * sizeof(uint32_t));
+        AddInlinedCallers(record.guest_address, callees);
+      } else {
+        records_.erase(record.guest_address);
+      }
+      offset += size_t(record_size);
+      valid_size = offset;
+    }
+  } else if (!data_.empty()) {
+    XELOGI("AOT code cache {} is stale, discarding",
+           xe::path_to_utf8(path_));
+  }
+  data_.resize(valid_size);
+
+  if (valid_size) {
+    file_ = xe::filesystem::OpenFile(path_, "r+b");
+    if (file_ && !xe::filesystem::TruncateStdioFile(file_, valid_size)) {
+      fclose(file_);
+      file_ = nullptr;
+    }
+    if (file_) {
+      xe::filesystem::Seek(file_, 0, SEEK_END);
+    }
+  } else {
+    file_ = xe::filesystem::OpenFile(path_, "wb");
+    if (file_) {
+      file_header.magic = kFileMagic;
+      file_header.version = kFileVersion;
+      file_header.key = key;
+      fwrite(&file_header, sizeof(file_header), 1, file_);
+      fflush(file_);
+    }
+  }
+  if (!file_) {
+    XELOGE("Failed to open AOT code cache {}", xe::path_to_utf8(path_));
+    return false;
+  }
+
+  XELOGI("AOT code cache {}: {} functions", xe::path_to_utf8(path_),
+         records_.size());
+  return true;
+}
+
+bool X64AotCache::LoadFunction(X64Function* function) {
+  size_t record_offset;
+  {
+    std::lock_guard<xe_mutex> lock(mutex_);
+    auto it = records_.find(function->address());
+    if (it == records_.end()) {
+      return false;
+    }
+    record_offset = it->second;
+  }
+  uint8_t* record_data = data_.data() + record_offset;
+  RecordHeader record;
+  std::memcpy(&record, record_data, sizeof(record));
+  uint8_t* code = record_data + sizeof(RecordHeader);
+  const uint8_t* relocations_data = code + record.code_size;
+  const uint8_t* source_map_data =
+      relocations_data + record.relocation_count * sizeof(X64CodeRelocation);
+  const uint8_t* inlined_callees_data =
+      source_map_data + record.source_map_count * sizeof(SourceMapEntry);
+  size_t payload_size =
+      record.code_size +
+      record.relocation_count * sizeof(X64CodeRelocation) +
+      record.source_map_count * sizeof(SourceMapEntry) +
+      record.inlined_callee_count * sizeof(uint32_t);
+  if (XXH3_64bits(code, payload_size) != record.payload_hash) {
+    XELOGW("AOT code cache record for {:08X} is corrupt",
+           function->address());
+    return false;
+  }
+
+  std::vector<X64CodeRelocation> relocations(record.relocation_count);
+  std::memcpy(relocations.data(), relocations_data,
+              relocations.size() * sizeof(X64CodeRelocation));
+  for (const auto& relocation : relocations) {
+    size_t width =
+        relocation.type == X64CodeRelocation::kHostImage64 ? 8 : 4;
+    if (relocation.code_offset + width > record.code_size) {
+      return false;
+    }
+  }
+
+  EmitFunctionInfo func_info = {};
+  func_info.code_size.prolog = record.prolog_size;
+  func_info.code_size.body = record.body_size;
+  func_info.code_size.epilog = record.epilog_size;
+  func_info.code_size.tail = record.tail_size;
+  func_info.code_size.total = record.code_size;
+  func_info.prolog_stack_alloc_offset = record.prolog_stack_alloc_offset;
+  func_info.stack_size = record.stack_size;
+
+  // Place without publishing to the indirection table - the code isn't
+  // runnable until the relocations below have been applied.
+  auto code_cache = backend_->code_cache();
+  void* code_execute_address;
+  void* code_write_address;
+  code_cache->PlaceGuestCode(0, code, func_info, function,
+                             code_execute_address, code_write_address);
+
+  auto execute_base = reinterpret_cast<uintptr_t>(code_execute_address);
+  auto write_base = reinterpret_cast<uint8_t*>(code_write_address);
+  uintptr_t image_base = GetHostImageBase();
+  for (const auto& relocation : relocations) {
+    uint8_t* site = write_base + relocation.code_offset;
+    switch (relocation.type) {
+      case X64CodeRelocation::kHostImage64: {
+        uint64_t value = image_base + relocation.value;
+        std::memcpy(site, &value, sizeof(value));
+      } break;
+      case X64CodeRelocation::kCodeCacheRel32: {
+        int64_t displacement =
+            int64_t(relocation.value) -
+            int64_t(execute_base + relocation.code_offset + 4);
+        assert_true(displacement >= std::numeric_limits<int32_t>::min() &&
+                    displacement <= std::numeric_limits<int32_t>::max());
+        int32_t displacement32 = int32_t(displacement);
+        std::memcpy(site, &displacement32, sizeof(displacement32));
+      } break;
+    }
+  }
+  code_cache->FlushCodeRange(code_write_address, record.code_size);
+
+  function->set_end_address(record.end_address);
+  auto& source_map = function->source_map();
+  source_map.resize(record.source_map_count);
+  std::memcpy(source_map.data(), source_map_data,
+              source_map.size() * sizeof(SourceMapEntry));
+  std::vector<uint32_t> inlined_callees(record.inlined_callee_count);
+  std::memcpy(inlined_callees.data(), inlined_callees_data,
+              inlined_callees.size() * sizeof(uint32_t));
+  function->set_inlined_callees(std::move(inlined_callees));
+  function->Setup(reinterpret_cast<uint8_t*>(code_execute_address),
+                  record.code_size);
+
+  assert_true((execute_base >> 32) == 0);
+  code_cache->AddIndirection(function->address(), uint32_t(execute_base));
+  return true;
+}
+
+void X64AotCache::StoreFunction(
+    GuestFunction* function, const void* machine_code,
+    const EmitFunctionInfo& func_info,
+    const std::vector<X64CodeRelocation>& relocations) {
+  const auto& source_map = function->source_map();
+  const auto& inlined_callees = function->inlined_callees();
+
+  RecordHeader record;
+  record.magic = kRecordMagic;
+  record.guest_address = function->address();
+  record.end_address = function->end_address();
+  record.code_size = uint32_t(func_info.code_size.total);
+  record.relocation_count = uint32_t(relocations.size());
+  record.source_map_count = uint32_t(source_map.size());
+  record.prolog_size = uint32_t(func_info.code_size.prolog);
+  record.body_size = uint32_t(func_info.code_size.body);
+  record.epilog_size = uint32_t(func_info.code_size.epilog);
+  record.tail_size = uint32_t(func_info.code_size.tail);
+  record.prolog_stack_alloc_offset =
+      uint32_t(func_info.prolog_stack_alloc_offset);
+  record.stack_size = uint32_t(func_info.stack_size);
+  record.inlined_callee_count = uint32_t(inlined_callees.size());
+  record.reserved = 0;
+
+  std::vector<uint8_t> payload(
+      record.code_size + relocations.size() * sizeof(X64CodeRelocation) +
+      source_map.size() * sizeof(SourceMapEntry) +
+      inlined_callees.size() * sizeof(uint32_t));
+  uint8_t* p = payload.data();
+  std::memcpy(p, machine_code, record.code_size);
+  p += record.code_size;
+  std::memcpy(p, relocations.data(),
+              relocations.size() * sizeof(X64CodeRelocation));
+  p += relocations.size() * sizeof(X64CodeRelocation);
+  std::memcpy(p, source_map.data(), source_map.size() * sizeof(SourceMapEntry));
+  p += source_map.size() * sizeof(SourceMapEntry);
+  std::memcpy(p, inlined_callees.data(),
+              inlined_callees.size() * sizeof(uint32_t));
+  record.payload_hash = XXH3_64bits(payload.data(), payload.size());
+
+  std::lock_guard<xe_mutex> lock(mutex_);
+  if (records_.count(record.guest_address)) {
+    // Came from this file already.
+    return;
+  }
+  AddInlinedCallers(record.guest_address, inlined_callees);
+  fwrite(&record, sizeof(record), 1, file_);
+  fwrite(payload.data(), 1, payload.size(), file_);
+  fflush(file_);
+}
+
+void X64AotCache::AddInlinedCallers(uint32_t guest_address,
+                                    const std::vector<uint32_t>& callees) {
+  for (uint32_t callee : callees) {
+    inlined_callers_[callee].push_back(guest_address);
+  }
+}
+
+void X64AotCache::InvalidateFunction(uint32_t guest_address) {
+  std::lock_guard<xe_mutex> lock(mutex_);
+  // Functions the invalidated ones were inlined into carry a copy of the same
+  // code. Each list is taken out of the index as it's visited, so cycles of
+  // tail-inlined functions end.
+  std::vector<uint32_t> pending = {guest_address};
+  while (!pending.empty()) {
+    uint32_t address = pending.back();
+    pending.pop_back();
+    records_.erase(address);
+    RecordHeader record = {};
+    record.magic = kRecordMagic;
+    record.guest_address = address;
+    record.payload_hash = XXH3_64bits(nullptr, 0);
+    fwrite(&record, sizeof(record), 1, file_);
+
+    auto it = inlined_callers_.find(address);
+    if (it != inlined_callers_.end()) {
+      pending.insert(pending.end(), it->second.begin(), it->second.end());
+      inlined_callers_.erase(it);
+    }
+  }
+  fflush(file_);
+}
+
+}  // namespace x64
+}  // namespace backend
+}  // namespace cpu
+}  // namespace xe
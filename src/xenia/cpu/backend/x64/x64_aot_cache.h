@@ -0,0 +1,148 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_BACKEND_X64_X64_AOT_CACHE_H_
+#define XENIA_CPU_BACKEND_X64_X64_AOT_CACHE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "xenia/base/cvar.h"
+#include "xenia/base/mutex.h"
+#include "xenia/cpu/backend/code_cache_base.h"
+#include "xenia/cpu/function.h"
+
+DECLARE_bool(enable_aot_code_cache);
+
+namespace xe {
+namespace cpu {
+namespace backend {
+namespace x64 {
+
+class X64Backend;
+class X64Function;
+
+// A reference from emitted code to something whose address may differ between
+// sessions. Recorded by the emitter while lowering a function so the machine
+// code can be stored on disk and patched when it's mapped back in.
+struct X64CodeRelocation {
+  enum Type : uint32_t {
+    // 64-bit immediate pointing into the host executable image. value is the
+    // offset from the start of the image.
+    kHostImage64,
+    // rel32 displacement of a call/jmp to a thunk or helper in the code cache.
+    // value is the absolute target address.
+    kCodeCacheRel32,
+  };
+  // Offset of the immediate/displacement from the start of the function.
+  uint32_t code_offset;
+  Type type;
+  uint64_t value;
+};
+static_assert(sizeof(X64CodeRelocation) == 16);
+
+// Returns true if the address lies within the host executable image, so it can
+// be stored as an image-relative offset.
+bool IsHostImageAddress(const void* address);
+uintptr_t GetHostImageBase();
+
+// Persistent on-disk cache of translated machine code for one guest module.
+// Lives in cache_root()/modules/<image sha>/ next to the instruction info
+// cache. Records are appended as functions are compiled and mapped back in
+// through the code cache on later sessions instead of running the PPC->HIR->x64
+// pipeline again.
+//
+// The file header carries a key covering everything that can change the code
+// the emitter produces or the addresses it references (host build, backend
+// feature mask, codegen cvars, constant/thunk placement). Any mismatch discards
+// the whole file.
+class X64AotCache {
+ public:
+  ~X64AotCache();
+
+  static uint64_t ComputeKey(X64Backend* backend);
+
+  static std::unique_ptr<X64AotCache> Open(
+      X64Backend* backend, const std::filesystem::path& module_cache_path);
+
+  // Maps a previously stored function into the code cache. Returns false if
+  // there is no usable record and the function has to be translated.
+  bool LoadFunction(X64Function* function);
+
+  // Appends a freshly emitted function to the cache file.
+  void StoreFunction(GuestFunction* function, const void* machine_code,
+                     const EmitFunctionInfo& func_info,
+                     const std::vector<X64CodeRelocation>& relocations);
+
+  // Drops the stored copy of a function whose translation is known to change
+  // (new instruction info cache flags) so it gets retranslated and stored
+  // again next time, along with the stored functions it was inlined into.
+  void InvalidateFunction(uint32_t guest_address);
+
+ private:
+  static constexpr uint32_t kFileMagic = 0x544F4158;    // 'XAOT'
+  static constexpr uint32_t kRecordMagic = 0x434E5546;  // 'FUNC'
+  // Increment to invalidate all existing caches when the format or the
+  // emitter's relocation coverage changes.
+  static constexpr uint32_t kFileVersion = 2;
+
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+  };
+  // A record with code_size 0 removes any earlier record for the address.
+  struct RecordHeader {
+    uint32_t magic;
+    uint32_t guest_address;
+    uint32_t end_address;
+    uint32_t code_size;
+    uint32_t relocation_count;
+    uint32_t source_map_count;
+    uint32_t prolog_size;
+    uint32_t body_size;
+    uint32_t epilog_size;
+    uint32_t tail_size;
+    uint32_t prolog_stack_alloc_offset;
+    uint32_t stack_size;
+    uint32_t inlined_callee_count;
+    uint32_t reserved;
+    // XXH3 of everything following the header.
+    uint64_t payload_hash;
+  };
+  static_assert(sizeof(RecordHeader) == 64);
+
+  X64AotCache(X64Backend* backend, const std::filesystem::path& path);
+  bool Initialize(uint64_t key);
+  void AddInlinedCallers(uint32_t guest_address,
+                         const std::vector<uint32_t>& callees);
+
+  X64Backend* backend_;
+  std::filesystem::path path_;
+  // Contents of the file as of Open, records index into this.
+  std::vector<uint8_t> data_;
+
+  xe_mutex mutex_;
+  std::unordered_map<uint32_t, size_t> records_;
+  // Stored functions by the entry addresses of the callees inlined into them,
+  // from the file and from this session.
+  std::unordered_map<uint32_t, std::vector<uint32_t>> inlined_callers_;
+  FILE* file_ = nullptr;
+};
+
+}  // namespace x64
+}  // namespace backend
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_BACKEND_X64_X64_AOT_CACHE_H_
@@ -58,7 +58,9 @@ class X64HelperEmitter : public X64Emitter {
   ~X64HelperEmitter() override;
   HostToGuestThunk EmitHostToGuestThunk();
   GuestToHostThunk EmitGuestToHostThunk();
-  ResolveFunctionThunk EmitResolveFunctionThunk();
+  // With chain, the thunk also passes the return address of the call that
+  // entered it so the calling site can be patched.
+  ResolveFunctionThunk EmitResolveFunctionThunk(bool chain = false);
   void* EmitGuestAndHostSynchronizeStackHelper();
   // 1 for loading byte, 2 for halfword and 4 for word.
   // these specialized versions save space in the caller
@@ -232,6 +234,8 @@ bool X64Backend::Initialize(Processor* processor) {
     machine_info_.supports_extended_load_store = false;
   }
 
+  machine_info_.supports_tiered_compilation = true;
+
   auto& gprs = machine_info_.register_sets[0];
   gprs.id = 0;
   std::strcpy(gprs.name, "gpr");
@@ -262,6 +266,7 @@ bool X64Backend::Initialize(Processor* processor) {
   host_to_guest_thunk_ = thunk_emitter.EmitHostToGuestThunk();
   guest_to_host_thunk_ = thunk_emitter.EmitGuestToHostThunk();
   resolve_function_thunk_ = thunk_emitter.EmitResolveFunctionThunk();
+  chain_function_thunk_ = thunk_emitter.EmitResolveFunctionThunk(true);
 
   if (cvars::enable_host_guest_stack_synchronization) {
     synchronize_guest_and_host_stack_helper_ =
@@ -575,12 +580,82 @@ void X64Backend::RecordMMIOExceptionForGuestInstruction(void* host_address) {
             xex_guest_module->GetInstructionAddressFlags(guestaddr);
 
         if (icf) {
+          if (!icf->accessed_mmio) {
+            // The next translation will differ, don't keep reloading the old
+            // one.
+            std::lock_guard<xe_mutex> lock(aot_caches_mutex_);
+            auto it = aot_caches_.find(guest_module);
+            if (it != aot_caches_.end()) {
+              it->second->InvalidateFunction(fnfor->address());
+              // An instruction of an inlined callee, whose own translation and
+              // the other copies of it change too.
+              if (guestaddr < fnfor->address() ||
+                  guestaddr > fnfor->end_address()) {
+                uint32_t callee = 0;
+                for (uint32_t address : fnfor->inlined_callees()) {
+                  if (address <= guestaddr && address > callee) {
+                    callee = address;
+                  }
+                }
+                if (callee) {
+                  it->second->InvalidateFunction(callee);
+                }
+              }
+            }
+          }
           icf->accessed_mmio = true;
         }
       }
     }
   }
 }
+
+void X64Backend::OpenModuleCodeCache(Module* module,
+                                     const std::filesystem::path& cache_path) {
+  if (!cvars::enable_aot_code_cache) {
+    return;
+  }
+  auto cache = X64AotCache::Open(this, cache_path);
+  if (!cache) {
+    return;
+  }
+  std::lock_guard<xe_mutex> lock(aot_caches_mutex_);
+  aot_caches_[module] = std::move(cache);
+}
+
+void X64Backend::CloseModuleCodeCache(Module* module) {
+  std::lock_guard<xe_mutex> lock(aot_caches_mutex_);
+  aot_caches_.erase(module);
+}
+
+bool X64Backend::LoadCachedFunction(GuestFunction* function) {
+  X64AotCache* cache;
+  {
+    std::lock_guard<xe_mutex> lock(aot_caches_mutex_);
+    auto it = aot_caches_.find(function->module());
+    if (it == aot_caches_.end()) {
+      return false;
+    }
+    cache = it->second.get();
+  }
+  return cache->LoadFunction(static_cast<X64Function*>(function));
+}
+
+void X64Backend::StoreCachedFunction(
+    GuestFunction* function, const void* machine_code,
+    const EmitFunctionInfo& func_info,
+    const std::vector<X64CodeRelocation>& relocations) {
+  X64AotCache* cache;
+  {
+    std::lock_guard<xe_mutex> lock(aot_caches_mutex_);
+    auto it = aot_caches_.find(function->module());
+    if (it == aot_caches_.end()) {
+      return;
+    }
+    cache = it->second.get();
+  }
+  cache->StoreFunction(function, machine_code, func_info, relocations);
+}
 bool X64Backend::ExceptionCallback(Exception* ex) {
   if (ex->code() != Exception::Code::kIllegalInstruction) {
     // We only care about illegal instructions. Other things will be handled by
@@ -831,8 +906,10 @@ GuestToHostThunk X64HelperEmitter::EmitGuestToHostThunk() {
 
 // X64Emitter handles actually resolving functions.
 uint64_t ResolveFunction(void* raw_context, uint64_t target_address);
+uint64_t ResolveAndChainFunction(void* raw_context, uint64_t target_address,
+                                 uint64_t return_address);
 
-ResolveFunctionThunk X64HelperEmitter::EmitResolveFunctionThunk() {
+ResolveFunctionThunk X64HelperEmitter::EmitResolveFunctionThunk(bool chain) {
 #if XE_PLATFORM_WIN32
   // ebx = target PPC address
   // rcx = context
@@ -854,7 +931,12 @@ ResolveFunctionThunk X64HelperEmitter::EmitResolveFunctionThunk() {
 
   mov(rcx, rsi);  // context
   mov(rdx, rbx);
-  mov(rax, reinterpret_cast<uint64_t>(&ResolveFunction));
+  if (chain) {
+    mov(r8, qword[rsp + stack_size]);  // return address
+    mov(rax, reinterpret_cast<uint64_t>(&ResolveAndChainFunction));
+  } else {
+    mov(rax, reinterpret_cast<uint64_t>(&ResolveFunction));
+  }
   call(rax);
 
   EmitLoadVolatileRegs();
@@ -893,7 +975,12 @@ ResolveFunctionThunk X64HelperEmitter::EmitResolveFunctionThunk() {
   EmitSaveVolatileRegs();
   mov(rdi, rsi);  // context
   mov(rsi, rbx);  // target PPC address
-  mov(rax, reinterpret_cast<uint64_t>(&ResolveFunction));
+  if (chain) {
+    mov(rdx, qword[rsp + stack_size]);  // return address
+    mov(rax, reinterpret_cast<uint64_t>(&ResolveAndChainFunction));
+  } else {
+    mov(rax, reinterpret_cast<uint64_t>(&ResolveFunction));
+  }
   call(rax);
 
   EmitLoadVolatileRegs();
@@ -1720,6 +1807,9 @@ void X64Backend::InitializeBackendContext(void* ctx) {
   bctx->Ox1000 = 0x1000;
   bctx->guest_tick_count = Clock::GetGuestTickCountPointer();
   bctx->reserve_helper_ = &reserve_helper_;
+  bctx->physical_write_map = processor()->memory()->physical_write_map();
+  bctx->physical_write_summary =
+      processor()->memory()->physical_write_summary();
 }
 void X64Backend::DeinitializeBackendContext(void* ctx) {
   X64BackendContext* bctx = BackendContextForGuestContext(ctx);
@@ -1848,6 +1938,10 @@ void X64Backend::FreeGuestTrampoline(uint32_t trampoline_addr) {
       (trampoline_addr - GUEST_TRAMPOLINE_BASE) / GUEST_TRAMPOLINE_MIN_LEN;
   guest_trampoline_address_bitmap_.Release(index);
 }
+
+void X64Backend::UnchainFunction(uint32_t guest_address) {
+  code_cache_->UnchainCallSites(guest_address);
+}
 }  // namespace x64
 }  // namespace backend
 }  // namespace cpu
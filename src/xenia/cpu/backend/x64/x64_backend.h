@@ -11,10 +11,14 @@
 #define XENIA_CPU_BACKEND_X64_X64_BACKEND_H_
 
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "xenia/base/bit_map.h"
 #include "xenia/base/cvar.h"
+#include "xenia/base/mutex.h"
 #include "xenia/cpu/backend/backend.h"
+#include "xenia/cpu/backend/x64/x64_aot_cache.h"
 
 #if XE_PLATFORM_WIN32 == 1
 // we use KUSER_SHARED's systemtime field, which is at a fixed address and
@@ -111,6 +115,10 @@ struct X64BackendContext {
   unsigned int flags;
   unsigned int Ox1000;  // constant 0x1000 so we can shrink each tail emitted
                         // add of it by... 2 bytes lol
+  // Memory::physical_write_map() and physical_write_summary(), marked by
+  // stores with --physical_write_map.
+  uint8_t* physical_write_map;
+  uint8_t* physical_write_summary;
 };
 constexpr unsigned int DEFAULT_VMX_MXCSR =
     0x8000 |                   // flush to zero
@@ -136,6 +144,10 @@ class X64Backend : public Backend {
   ResolveFunctionThunk resolve_function_thunk() const {
     return resolve_function_thunk_;
   }
+  // Resolve thunk for chainable call sites, also patches the calling site.
+  ResolveFunctionThunk chain_function_thunk() const {
+    return chain_function_thunk_;
+  }
 
   void* synchronize_guest_and_host_stack_helper() const {
     return synchronize_guest_and_host_stack_helper_;
@@ -177,10 +189,20 @@ class X64Backend : public Backend {
                                          bool long_term) override;
 
   virtual void FreeGuestTrampoline(uint32_t trampoline_addr) override;
+  void UnchainFunction(uint32_t guest_address) override;
   virtual void SetGuestRoundingMode(void* ctx, unsigned int mode) override;
   virtual bool PopulatePseudoStacktrace(GuestPseudoStackTrace* st) override;
   void RecordMMIOExceptionForGuestInstruction(void* host_address);
 
+  void OpenModuleCodeCache(Module* module,
+                           const std::filesystem::path& cache_path) override;
+  void CloseModuleCodeCache(Module* module) override;
+  bool LoadCachedFunction(GuestFunction* function) override;
+  // Called by the emitter for every relocatable function it places.
+  void StoreCachedFunction(GuestFunction* function, const void* machine_code,
+                           const EmitFunctionInfo& func_info,
+                           const std::vector<X64CodeRelocation>& relocations);
+
   uint32_t LookupXMMConstantAddress32(unsigned index) {
     return static_cast<uint32_t>(emitter_data() + sizeof(vec128_t) * index);
   }
@@ -202,6 +224,7 @@ class X64Backend : public Backend {
   HostToGuestThunk host_to_guest_thunk_;
   GuestToHostThunk guest_to_host_thunk_;
   ResolveFunctionThunk resolve_function_thunk_;
+  ResolveFunctionThunk chain_function_thunk_;
   void* synchronize_guest_and_host_stack_helper_ = nullptr;
 
   // loads stack sizes 1 byte, 2 bytes or 4 bytes
@@ -223,6 +246,9 @@ class X64Backend : public Backend {
 #endif
 
   alignas(64) ReserveHelper reserve_helper_;
+
+  xe_mutex aot_caches_mutex_;
+  std::unordered_map<const Module*, std::unique_ptr<X64AotCache>> aot_caches_;
   // allocates 8-byte aligned addresses in a normally not executable guest
   // address
   // range that will be used to dispatch to host code
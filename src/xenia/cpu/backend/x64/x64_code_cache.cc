@@ -11,6 +11,8 @@
 
 #include <cstring>
 
+#include "xenia/base/atomic.h"
+
 #if ENABLE_VTUNE
 #include "third_party/vtune/include/jitprofiling.h"
 #pragma comment(lib, "../third_party/vtune/lib64/jitprofiling.lib")
@@ -36,6 +38,24 @@ void X64CodeCache::FlushCodeRange(void* address, size_t size) {
   // x86-64 has coherent I/D caches; no flush needed.
 }
 
+bool X64CodeCache::PatchCallSite(uint8_t* site_write_address,
+                                 const uint8_t* site_execute_address,
+                                 const void* target) {
+  // The emitter aligns the rel32 so other threads executing the call see
+  // either the old or the new displacement, never a mix.
+  if (uintptr_t(site_execute_address) & 3) {
+    return false;
+  }
+  int64_t displacement = reinterpret_cast<const uint8_t*>(target) -
+                         (site_execute_address + sizeof(int32_t));
+  if (displacement != int64_t(int32_t(displacement))) {
+    return false;
+  }
+  xe::atomic_exchange(int32_t(displacement),
+                      reinterpret_cast<volatile int32_t*>(site_write_address));
+  return true;
+}
+
 void X64CodeCache::OnCodePlaced(uint32_t guest_address,
                                 GuestFunction* function_info,
                                 void* code_execute_address, size_t code_size) {
@@ -32,6 +32,8 @@ class X64CodeCache : public CodeCacheBase<X64CodeCache> {
   // CRTP hooks for CodeCacheBase.
   void FillCode(void* write_address, size_t size);
   void FlushCodeRange(void* address, size_t size);
+  bool PatchCallSite(uint8_t* site_write_address,
+                     const uint8_t* site_execute_address, const void* target);
   void OnCodePlaced(uint32_t guest_address, GuestFunction* function_info,
                     void* code_execute_address, size_t code_size);
 
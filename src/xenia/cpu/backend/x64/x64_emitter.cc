@@ -11,8 +11,10 @@
 
 #include <stddef.h>
 
+#include <algorithm>
 #include <climits>
 #include <cstring>
+#include <unordered_set>
 
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/assert.h"
@@ -120,6 +122,13 @@ bool X64Emitter::Emit(GuestFunction* function, HIRBuilder* builder,
   debug_info_flags_ = debug_info_flags;
   trace_data_ = &function->trace_data();
   source_map_arena_.Reset();
+  relocations_.clear();
+  relocatable_ = true;
+  count_entries_ = function->tier() == CompileTier::kBaseline;
+  block_counters_.clear();
+  if (count_entries_ && cvars::profile_guided_block_layout) {
+    SetupBlockCounters(function, builder);
+  }
 
   // Fill the generator with code.
   EmitFunctionInfo func_info = {};
@@ -134,6 +143,11 @@ bool X64Emitter::Emit(GuestFunction* function, HIRBuilder* builder,
   // Stash source map.
   source_map_arena_.CloneContents(out_source_map);
 
+  if (cvars::enable_aot_code_cache && relocatable_ && !debug_info_flags_) {
+    backend_->StoreCachedFunction(function, *out_code_address, func_info,
+                                  relocations_);
+  }
+
   return true;
 }
 void* X64Emitter::Emplace(const EmitFunctionInfo& func_info,
@@ -228,6 +242,10 @@ bool X64Emitter::Emit(HIRBuilder* builder, EmitFunctionInfo& func_info) {
 
   mov(qword[rsp + StackLayout::GUEST_CALL_RET_ADDR], rax);  // 0
 
+  if (count_entries_) {
+    EmitTierUpCounter();
+  }
+
 #if XE_X64_PROFILER_AVAILABLE == 1
   if (cvars::instrument_call_times) {
     mov(rdx, 0x7ffe0014);  // load pointer to kusershared systemtime
@@ -286,6 +304,13 @@ bool X64Emitter::Emit(HIRBuilder* builder, EmitFunctionInfo& func_info) {
     if (cvars::align_all_basic_blocks) {
       align(cvars::align_all_basic_blocks, true);
     }
+    if (block->ordinal < block_counters_.size() &&
+        block_counters_[block->ordinal]) {
+      // Not locked, losing a count now and then doesn't matter. Addressed
+      // through rax, nothing is allocated to it across block boundaries.
+      mov(rax, uint64_t(block_counters_[block->ordinal]));
+      inc(dword[rax]);
+    }
     // Process instructions.
     const Instr* instr = block->instr_head;
     while (instr) {
@@ -359,6 +384,7 @@ void X64Emitter::EmitProfilerEpilogue() {
     mov(ecx, 0x7ffe0014);
     mov(rdx, qword[rcx]);
     mov(r10, (uintptr_t)profiler_entry);
+    MarkNotRelocatable();
     sub(rdx, qword[rsp + StackLayout::GUEST_PROFILER_START]);
 
     // atomic add our time to the profiler entry
@@ -467,6 +493,14 @@ void X64Emitter::UnimplementedInstr(const hir::Instr* i) {
   assert_always();
 }
 
+// Called by baseline code from its entry counter.
+uint64_t TierUpFunction(void* raw_context, uint64_t guest_address) {
+  auto guest_context = reinterpret_cast<ppc::PPCContext_s*>(raw_context);
+  guest_context->thread_state->processor()->RequestTierUp(
+      uint32_t(guest_address));
+  return 0;
+}
+
 // This is used by the X64ThunkEmitter's ResolveFunctionThunk.
 uint64_t ResolveFunction(void* raw_context, uint64_t target_address) {
   auto guest_context = reinterpret_cast<ppc::PPCContext_s*>(raw_context);
@@ -681,13 +715,49 @@ uint64_t ResolveFunction(void* raw_context, uint64_t target_address) {
   return addr;
 }
 
+// Used by the chaining ResolveFunctionThunk, entered from the call sites
+// X64Emitter::Call emits with --chain_direct_calls.
+uint64_t ResolveAndChainFunction(void* raw_context, uint64_t target_address,
+                                 uint64_t return_address) {
+  uint64_t addr = ResolveFunction(raw_context, target_address);
+  // The code cache only chains to what the indirection table holds for the
+  // target, never to a resume point within a function picked for longjmp.
+  auto guest_context = reinterpret_cast<ppc::PPCContext_s*>(raw_context);
+  auto backend = static_cast<X64Backend*>(
+      guest_context->thread_state->processor()->backend());
+  backend->code_cache()->ChainCallSite(uint32_t(target_address),
+                                       return_address,
+                                       reinterpret_cast<const void*>(addr));
+  return addr;
+}
+
 void X64Emitter::Call(const hir::Instr* instr, GuestFunction* function) {
   assert_not_null(function);
   ForgetMxcsrMode();
   auto fn = static_cast<X64Function*>(function);
   // Resolve address to the function to call and store in rax.
 
-  if (fn->machine_code()) {
+  if (cvars::chain_direct_calls && code_cache_->has_indirection_table() &&
+      !(instr->flags & hir::CALL_TAIL)) {
+    // Call the chaining resolver, which patches the rel32 to the callee's code
+    // once it's resolved. The code cache keeps track of the site and repoints
+    // it if the callee is recompiled, so this is fine with tiered compilation,
+    // and the rel32 to the thunk is relocated like any other helper call.
+    mov(ebx, function->address());
+    mov(rcx, qword[rsp + StackLayout::GUEST_CALL_RET_ADDR]);
+    // Keep the rel32 within an aligned dword so it can be patched while other
+    // threads may be executing the call. Functions are placed 16-byte aligned.
+    nop((4 - (getSize() + 1) % 4) % 4);
+    CallHelper(reinterpret_cast<const void*>(backend_->chain_function_thunk()));
+    synchronize_stack_on_next_instruction_ = true;
+    return;
+  }
+
+  // Cached code can't assume the callee lands at the same address next
+  // session, and with tiered compilation the callee may be replaced by its
+  // optimized version later, so both always go through the indirection table.
+  if (fn->machine_code() && !cvars::enable_aot_code_cache &&
+      !cvars::tiered_compilation) {
     if (!(instr->flags & hir::CALL_TAIL)) {
       mov(rcx, qword[rsp + StackLayout::GUEST_CALL_RET_ADDR]);
 
@@ -760,7 +830,7 @@ void X64Emitter::CallIndirect(const hir::Instr* instr,
     // Old-style resolve.
     // Not too important because indirection table is almost always available.
     mov(edx, reg.cvt32());
-    mov(rax, reinterpret_cast<uint64_t>(ResolveFunction));
+    MovHostAddress(rax, reinterpret_cast<const void*>(ResolveFunction));
     mov(rcx, GetContextReg());
     call(rax);
   }
@@ -810,7 +880,9 @@ void X64Emitter::CallExtern(const hir::Instr* instr, const Function* function) {
       mov(rcx, reinterpret_cast<uint64_t>(builtin_function->handler()));
       mov(rdx, reinterpret_cast<uint64_t>(builtin_function->arg0()));
       mov(r8, reinterpret_cast<uint64_t>(builtin_function->arg1()));
-      call(backend()->guest_to_host_thunk());
+      MarkNotRelocatable();
+      CallHelper(
+          reinterpret_cast<const void*>(backend()->guest_to_host_thunk()));
       // rax = host return
     }
   } else if (function->behavior() == Function::Behavior::kExtern) {
@@ -821,15 +893,18 @@ void X64Emitter::CallExtern(const hir::Instr* instr, const Function* function) {
       // rdx = arg0
       // r8  = arg1
       // r9  = arg2
-      mov(rcx, reinterpret_cast<uint64_t>(extern_function->extern_handler()));
+      MovHostAddress(rcx, reinterpret_cast<const void*>(
+                              extern_function->extern_handler()));
       mov(rdx,
           qword[GetContextReg() + offsetof(ppc::PPCContext, kernel_state)]);
-      call(backend()->guest_to_host_thunk());
+      CallHelper(
+          reinterpret_cast<const void*>(backend()->guest_to_host_thunk()));
       // rax = host return
     }
   }
   if (undefined) {
     CallNative(UndefinedCallExtern, reinterpret_cast<uint64_t>(function));
+    MarkNotRelocatable();
   }
 }
 
@@ -854,8 +929,8 @@ void X64Emitter::CallNativeSafe(void* fn) {
   // rdx = arg0
   // r8  = arg1
   // r9  = arg2
-  mov(rcx, reinterpret_cast<uint64_t>(fn));
-  call(backend()->guest_to_host_thunk());
+  MovHostAddress(rcx, fn);
+  CallHelper(reinterpret_cast<const void*>(backend()->guest_to_host_thunk()));
   // rax = host return
 }
 
@@ -864,6 +939,33 @@ void X64Emitter::SetReturnAddress(uint64_t value) {
   mov(qword[rsp + StackLayout::GUEST_CALL_RET_ADDR], rax);
 }
 
+void X64Emitter::MovHostAddress(const Xbyak::Reg64& reg, const void* address) {
+  if (!IsHostImageAddress(address)) {
+    mov(reg, reinterpret_cast<uint64_t>(address));
+    MarkNotRelocatable();
+    return;
+  }
+  // Always the full movabs so there's an imm64 to patch, mov(reg, imm) picks a
+  // shorter form when the value happens to fit.
+  db(0x48 | (reg.getIdx() >= 8 ? 0x01 : 0x00));
+  db(0xB8 | (reg.getIdx() & 7));
+  dq(reinterpret_cast<uint64_t>(address));
+  X64CodeRelocation relocation;
+  relocation.code_offset = uint32_t(getSize() - 8);
+  relocation.type = X64CodeRelocation::kHostImage64;
+  relocation.value = reinterpret_cast<uintptr_t>(address) - GetHostImageBase();
+  relocations_.push_back(relocation);
+}
+
+void X64Emitter::CallHelper(const void* target) {
+  call(target);
+  X64CodeRelocation relocation;
+  relocation.code_offset = uint32_t(getSize() - 4);
+  relocation.type = X64CodeRelocation::kCodeCacheRel32;
+  relocation.value = reinterpret_cast<uintptr_t>(target);
+  relocations_.push_back(relocation);
+}
+
 Xbyak::Reg64 X64Emitter::GetNativeParam(uint32_t param) {
   if (param == 0) {
     return rdx;
@@ -1813,15 +1915,18 @@ void X64Emitter::EnsureSynchronizedGuestAndHostStack() {
         uint32_t stack32 = static_cast<uint32_t>(e.stack_size());
         auto backend = e.backend();
         if (stack32 < 256) {
-          e.call(backend->synchronize_guest_and_host_stack_helper_for_size(1));
+          e.CallHelper(
+              backend->synchronize_guest_and_host_stack_helper_for_size(1));
           e.db(stack32);
 
         } else if (stack32 < 65536) {
-          e.call(backend->synchronize_guest_and_host_stack_helper_for_size(2));
+          e.CallHelper(
+              backend->synchronize_guest_and_host_stack_helper_for_size(2));
           e.dw(stack32);
         } else {
           // ought to be impossible, a host stack bigger than 65536??
-          e.call(backend->synchronize_guest_and_host_stack_helper_for_size(4));
+          e.CallHelper(
+              backend->synchronize_guest_and_host_stack_helper_for_size(4));
           e.dd(stack32);
         }
         e.jmp(return_from_sync, T_NEAR);
@@ -1831,6 +1936,74 @@ void X64Emitter::EnsureSynchronizedGuestAndHostStack() {
 
   L(return_from_sync);
 }
+
+void X64Emitter::EmitTierUpCounter() {
+  // The code cache data area sits above 2 GiB, out of reach of a
+  // sign-extended disp32, so the counter is addressed through a register.
+  uint32_t initial_count = std::max(cvars::tier_up_call_count, uint32_t(1));
+  void* counter = reinterpret_cast<void*>(uintptr_t(
+      code_cache_->PlaceData(&initial_count, sizeof(initial_count))));
+  MarkNotRelocatable();
+
+  Xbyak::Label& return_from_tier_up = NewCachedLabel();
+  Xbyak::Label& tier_up_label = AddToTail(
+      [&return_from_tier_up, guest_address = current_guest_function_](
+          X64Emitter& e, Xbyak::Label& our_tail_label) {
+        e.L(our_tail_label);
+        e.CallNative(TierUpFunction, guest_address);
+        e.jmp(return_from_tier_up, T_NEAR);
+      });
+
+  // Locked so only one thread sees the counter reach zero. It wraps around
+  // afterwards, but by then the indirection table points at the new code.
+  mov(rax, uint64_t(counter));
+  lock();
+  sub(dword[rax], 1);
+  jz(tier_up_label, T_NEAR);
+
+  L(return_from_tier_up);
+}
+
+void X64Emitter::SetupBlockCounters(GuestFunction* function,
+                                    HIRBuilder* builder) {
+  // Keyed by the first guest instruction in the block, which is what the
+  // optimized compile can find its blocks by. Inlined callees may repeat an
+  // address, only the first block with it is counted.
+  std::vector<GuestFunction::BlockCounter> counters;
+  std::vector<uint32_t> counter_ordinals;
+  std::unordered_set<uint32_t> counted_addresses;
+  for (auto block = builder->first_block(); block; block = block->next) {
+    for (auto instr = block->instr_head; instr; instr = instr->next) {
+      if (instr->opcode != &hir::OPCODE_SOURCE_OFFSET_info) {
+        continue;
+      }
+      uint32_t guest_address = static_cast<uint32_t>(instr->src1.offset);
+      if (counted_addresses.insert(guest_address).second) {
+        counters.push_back({guest_address, 0});
+        counter_ordinals.push_back(block->ordinal);
+      }
+      break;
+    }
+  }
+  if (counters.empty()) {
+    return;
+  }
+  // In the code cache data area, above 2 GiB, so the block entries address
+  // them through a register.
+  auto placed_counters = reinterpret_cast<GuestFunction::BlockCounter*>(
+      uintptr_t(code_cache_->PlaceData(
+          counters.data(),
+          counters.size() * sizeof(GuestFunction::BlockCounter))));
+  MarkNotRelocatable();
+  for (size_t i = 0; i < counters.size(); ++i) {
+    if (counter_ordinals[i] >= block_counters_.size()) {
+      block_counters_.resize(counter_ordinals[i] + 1);
+    }
+    block_counters_[counter_ordinals[i]] = &placed_counters[i].count;
+  }
+  function->set_block_counters(placed_counters,
+                               static_cast<uint32_t>(counters.size()));
+}
 }  // namespace x64
 }  // namespace backend
 }  // namespace cpu
@@ -14,6 +14,7 @@
 
 #include "xenia/base/arena.h"
 #include "xenia/cpu/backend/code_cache_base.h"
+#include "xenia/cpu/backend/x64/x64_aot_cache.h"
 #include "xenia/cpu/function.h"
 #include "xenia/cpu/function_trace_data.h"
 #include "xenia/cpu/hir/hir_builder.h"
@@ -270,6 +271,15 @@ class X64Emitter : public Xbyak::CodeGenerator {
   void CallNativeSafe(void* fn);
   void SetReturnAddress(uint64_t value);
 
+  // Loads a host pointer into reg. Pointers into the host executable are
+  // recorded as relocations, anything else (heap objects) keeps the function
+  // out of the AOT code cache.
+  void MovHostAddress(const Xbyak::Reg64& reg, const void* address);
+  // Near call to a thunk or helper placed in the code cache.
+  void CallHelper(const void* target);
+  // The function embeds something only valid for this session.
+  void MarkNotRelocatable() { relocatable_ = false; }
+
   Xbyak::Reg64 GetNativeParam(uint32_t param);
 
   Xbyak::Reg64 GetContextReg() const;
@@ -309,6 +319,12 @@ class X64Emitter : public Xbyak::CodeGenerator {
   void PopStackpoint();
 
   void EnsureSynchronizedGuestAndHostStack();
+  // Counts entries into baseline code and requests an optimized recompile once
+  // --tier_up_call_count is reached.
+  void EmitTierUpCounter();
+  // Allocates the entry counters of the blocks of baseline code for
+  // --profile_guided_block_layout and records them in the function.
+  void SetupBlockCounters(GuestFunction* function, hir::HIRBuilder* builder);
   FunctionDebugInfo* debug_info() const { return debug_info_; }
 
   size_t stack_size() const { return stack_size_; }
@@ -414,6 +430,14 @@ class X64Emitter : public Xbyak::CodeGenerator {
 
   size_t stack_size_ = 0;
 
+  // Session-dependent references in the function being emitted.
+  std::vector<X64CodeRelocation> relocations_;
+  bool relocatable_ = true;
+  // The function is being emitted at CompileTier::kBaseline.
+  bool count_entries_ = false;
+  // By block ordinal, the counter to increment on entry, if any.
+  std::vector<uint32_t*> block_counters_;
+
   static const uint32_t gpr_reg_map_[GPR_COUNT];
   static const uint32_t xmm_reg_map_[XMM_COUNT];
   /*
@@ -29,6 +29,7 @@ DEFINE_bool(enable_rmw_context_merging, false,
             "x64");
 DECLARE_bool(emit_mmio_aware_stores_for_recorded_exception_addresses);
 DECLARE_bool(emit_inline_mmio_checks);
+DECLARE_bool(physical_write_map);
 
 namespace xe {
 namespace cpu {
@@ -295,6 +296,56 @@ RegExp ComputeMemoryAddressOffset(X64Emitter& e, const T& guest,
   }
 }
 
+// Whether a store to the guest address needs to be marked in the physical
+// write map - constant addresses below the physical memory views are skipped.
+template <typename T>
+static bool NeedsPhysicalWriteMark(const T& guest, uint32_t offset = 0) {
+  if (!cvars::physical_write_map) {
+    return false;
+  }
+  return !guest.is_constant || uint32_t(guest.constant()) + offset >=
+                                   Memory::kPhysicalWriteMapBase;
+}
+
+// Sets the bytes of the first and the last byte of a store of size bytes at the
+// membase-relative offset in rcx in a map of 1 << shift byte granules. Clobbers
+// rdx.
+static void MarkPhysicalWriteMapBytes(X64Emitter& e, uint32_t shift,
+                                      size_t map_ctx_offset, uint32_t size) {
+  if (size > 1) {
+    // The last byte may be in the next granule if unaligned.
+    e.lea(e.rdx, e.ptr[e.rcx + (size - 1)]);
+    e.shr(e.rdx, shift);
+    e.add(e.rdx, e.GetBackendCtxPtr(int(map_ctx_offset)));
+    e.mov(e.byte[e.rdx], 1);
+  }
+  e.mov(e.rdx, e.rcx);
+  e.shr(e.rdx, shift);
+  e.add(e.rdx, e.GetBackendCtxPtr(int(map_ctx_offset)));
+  e.mov(e.byte[e.rdx], 1);
+}
+
+// Marks the pages written by a store of size bytes at addr (as returned by
+// ComputeMemoryAddress) in Memory::physical_write_map(), and then their regions
+// in Memory::physical_write_summary() - x86 doesn't reorder the stores. Must be
+// emitted after the store so a poll between the two can't miss it. Clobbers rcx
+// and rdx, but not rax, so addr can still be used afterwards.
+static void MarkPhysicalWrite(X64Emitter& e, const RegExp& addr,
+                              uint32_t size) {
+  Xbyak::Label skip;
+  e.lea(e.rcx, e.ptr[addr]);
+  e.sub(e.rcx, e.GetMembaseReg());
+  e.cmp(e.ecx, Memory::kPhysicalWriteMapBase);
+  e.jb(skip);
+  MarkPhysicalWriteMapBytes(e, Memory::kPhysicalWriteMapPageShift,
+                            offsetof(X64BackendContext, physical_write_map),
+                            size);
+  MarkPhysicalWriteMapBytes(e, Memory::kPhysicalWriteSummaryShift,
+                            offsetof(X64BackendContext, physical_write_summary),
+                            size);
+  e.L(skip);
+}
+
 struct LVL_V128 : Sequence<LVL_V128, I<OPCODE_LVL, V128Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
     e.mov(e.edx, 0xf);
@@ -382,6 +433,9 @@ struct STVL_V128 : Sequence<STVL_V128, I<OPCODE_STVL, VoidOp, I64Op, V128Op>> {
     e.inc(e.edx);
     e.jmp(loop);
     e.L(done);
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, e.rax, 16);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_STVL, STVL_V128);
@@ -415,6 +469,9 @@ struct STVR_V128 : Sequence<STVR_V128, I<OPCODE_STVR, VoidOp, I64Op, V128Op>> {
     e.inc(e.edx);
     e.jmp(loop);
     e.L(skipper);
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, e.rax, 16);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_STVR, STVR_V128);
@@ -431,7 +488,7 @@ struct RESERVED_LOAD_INT32
     // atomic op in the store
     e.prefetchw(e.ptr[e.rax]);
     e.mov(e.ecx, i.src1.reg().cvt32());
-    e.call(e.backend()->try_acquire_reservation_helper_);
+    e.CallHelper(e.backend()->try_acquire_reservation_helper_);
     e.mov(i.dest, e.dword[e.rax]);
 
     e.mov(
@@ -451,7 +508,7 @@ struct RESERVED_LOAD_INT64
     // atomic op in the store
     e.prefetchw(e.ptr[e.rax]);
 
-    e.call(e.backend()->try_acquire_reservation_helper_);
+    e.CallHelper(e.backend()->try_acquire_reservation_helper_);
     e.mov(i.dest, e.qword[ComputeMemoryAddress(e, i.src1)]);
 
     e.mov(
@@ -476,8 +533,11 @@ struct RESERVED_STORE_INT32
     e.mov(e.ecx, i.src1.reg().cvt32());
     e.lea(e.r9, e.ptr[ComputeMemoryAddress(e, i.src1)]);
     e.mov(e.r8d, i.src2);
-    e.call(e.backend()->reserved_store_32_helper);
+    e.CallHelper(e.backend()->reserved_store_32_helper);
     e.setz(i.dest);
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, ComputeMemoryAddress(e, i.src1), 4);
+    }
   }
 };
 
@@ -488,8 +548,11 @@ struct RESERVED_STORE_INT64
     e.mov(e.ecx, i.src1.reg().cvt32());
     e.lea(e.r9, e.ptr[ComputeMemoryAddress(e, i.src1)]);
     e.mov(e.r8, i.src2);
-    e.call(e.backend()->reserved_store_64_helper);
+    e.CallHelper(e.backend()->reserved_store_64_helper);
     e.setz(i.dest);
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, ComputeMemoryAddress(e, i.src1), 8);
+    }
   }
 };
 
@@ -527,6 +590,9 @@ struct ATOMIC_COMPARE_EXCHANGE_I32
     e.lock();
     e.cmpxchg(e.dword[e.GetMembaseReg() + e.rcx], i.src3);
     e.sete(i.dest);
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, e.GetMembaseReg() + e.rcx, 4);
+    }
   }
 };
 struct ATOMIC_COMPARE_EXCHANGE_I64
@@ -557,6 +623,9 @@ struct ATOMIC_COMPARE_EXCHANGE_I64
     e.lock();
     e.cmpxchg(e.qword[e.GetMembaseReg() + e.rcx], i.src3);
     e.sete(i.dest);
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, e.GetMembaseReg() + e.rcx, 8);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_ATOMIC_COMPARE_EXCHANGE,
@@ -1061,6 +1130,7 @@ struct LOAD_MMIO_I32
     auto mmio_range = reinterpret_cast<MMIORange*>(i.src1.value);
     auto read_address = uint32_t(i.src2.value);
     e.mov(e.GetNativeParam(0), uint64_t(mmio_range->callback_context));
+    e.MarkNotRelocatable();
     e.mov(e.GetNativeParam(1).cvt32(), read_address);
     e.CallNativeSafe(reinterpret_cast<void*>(mmio_range->read));
     e.bswap(e.eax);
@@ -1086,6 +1156,7 @@ struct STORE_MMIO_I32
     auto mmio_range = reinterpret_cast<MMIORange*>(i.src1.value);
     auto write_address = uint32_t(i.src2.value);
     e.mov(e.GetNativeParam(0), uint64_t(mmio_range->callback_context));
+    e.MarkNotRelocatable();
     e.mov(e.GetNativeParam(1).cvt32(), write_address);
     if (i.src3.is_constant) {
       e.mov(e.GetNativeParam(2).cvt32(), xe::byte_swap(i.src3.constant()));
@@ -1143,6 +1214,7 @@ static void MMIOAwareStore(void* _ctx, unsigned int guestaddr, T value) {
   auto gaddr = ctx->processor->memory()->LookupVirtualMappedRange(guestaddr);
   if (!gaddr) {
     *reinterpret_cast<T*>(ctx->virtual_membase + guestaddr) = value;
+    ctx->processor->memory()->MarkPhysicalWrite(guestaddr, sizeof(T));
   } else {
     value = xe::byte_swap(value); /*
           was having issues, found by comparing the values used with exceptions
@@ -1309,6 +1381,9 @@ struct STORE_OFFSET_I8
     } else {
       e.mov(e.byte[addr], i.src3);
     }
+    if (NeedsPhysicalWriteMark(i.src1, uint32_t(i.src2.constant()))) {
+      MarkPhysicalWrite(e, addr, 1);
+    }
   }
 };
 
@@ -1339,6 +1414,9 @@ struct STORE_OFFSET_I16
         e.mov(e.word[addr], i.src3);
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1, uint32_t(i.src2.constant()))) {
+      MarkPhysicalWrite(e, addr, 2);
+    }
   }
 };
 
@@ -1426,6 +1504,9 @@ struct STORE_OFFSET_I32
           e.mov(e.dword[addr], i.src3);
         }
       }
+      if (NeedsPhysicalWriteMark(i.src1, uint32_t(i.src2.constant()))) {
+        MarkPhysicalWrite(e, addr, 4);
+      }
       if (inline_mmio) {
         e.L(done);
       }
@@ -1456,6 +1537,9 @@ struct STORE_OFFSET_I64
         e.mov(e.qword[addr], i.src3);
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1, uint32_t(i.src2.constant()))) {
+      MarkPhysicalWrite(e, addr, 8);
+    }
   }
 };
 EMITTER_OPCODE_TABLE(OPCODE_STORE_OFFSET, STORE_OFFSET_I8, STORE_OFFSET_I16,
@@ -1645,6 +1729,9 @@ struct STORE_I8 : Sequence<STORE_I8, I<OPCODE_STORE, VoidOp, I64Op, I8Op>> {
     } else {
       e.mov(e.byte[addr], i.src2);
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 1);
+    }
     if (IsTracingData()) {
       addr = ComputeMemoryAddress(e, i.src1);
       e.mov(e.GetNativeParam(1).cvt8(), e.byte[addr]);
@@ -1674,6 +1761,9 @@ struct STORE_I16 : Sequence<STORE_I16, I<OPCODE_STORE, VoidOp, I64Op, I16Op>> {
         e.mov(e.word[addr], i.src2);
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 2);
+    }
     if (IsTracingData()) {
       addr = ComputeMemoryAddress(e, i.src1);
       e.mov(e.GetNativeParam(1).cvt16(), e.word[addr]);
@@ -1749,11 +1839,15 @@ struct STORE_I32 : Sequence<STORE_I32, I<OPCODE_STORE, VoidOp, I64Op, I32Op>> {
         } else {
           e.mov(e.dword[addr], i.src2);
         }
-        if (IsTracingData()) {
-          e.mov(e.GetNativeParam(1).cvt32(), e.dword[addr]);
-          e.lea(e.GetNativeParam(0), e.ptr[addr]);
-          e.CallNative(reinterpret_cast<void*>(TraceMemoryStoreI32));
-        }
+      }
+      if (NeedsPhysicalWriteMark(i.src1)) {
+        MarkPhysicalWrite(e, addr, 4);
+      }
+      if (IsTracingData() &&
+          !(i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP)) {
+        e.mov(e.GetNativeParam(1).cvt32(), e.dword[addr]);
+        e.lea(e.GetNativeParam(0), e.ptr[addr]);
+        e.CallNative(reinterpret_cast<void*>(TraceMemoryStoreI32));
       }
       if (inline_mmio) {
         e.L(done);
@@ -1783,6 +1877,9 @@ struct STORE_I64 : Sequence<STORE_I64, I<OPCODE_STORE, VoidOp, I64Op, I64Op>> {
         e.mov(e.qword[addr], i.src2);
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 8);
+    }
     if (IsTracingData()) {
       addr = ComputeMemoryAddress(e, i.src1);
       e.mov(e.GetNativeParam(1), e.qword[addr]);
@@ -1810,6 +1907,9 @@ struct STORE_F32 : Sequence<STORE_F32, I<OPCODE_STORE, VoidOp, I64Op, F32Op>> {
         e.vmovss(e.dword[addr], i.src2);
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 4);
+    }
     if (IsTracingData()) {
       addr = ComputeMemoryAddress(e, i.src1);
       e.lea(e.GetNativeParam(1), e.ptr[addr]);
@@ -1838,6 +1938,9 @@ struct STORE_F64 : Sequence<STORE_F64, I<OPCODE_STORE, VoidOp, I64Op, F64Op>> {
         e.vmovsd(e.qword[addr], i.src2);
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 8);
+    }
     if (IsTracingData()) {
       addr = ComputeMemoryAddress(e, i.src1);
       e.lea(e.GetNativeParam(1), e.ptr[addr]);
@@ -1866,6 +1969,9 @@ struct STORE_V128
         e.vmovdqa(e.ptr[addr], i.src2);
       }
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, 16);
+    }
     if (IsTracingData()) {
       addr = ComputeMemoryAddress(e, i.src1);
       e.lea(e.GetNativeParam(1), e.ptr[addr]);
@@ -2030,6 +2136,9 @@ struct MEMSET_I64_I8_I64
         assert_unhandled_case(i.src3.constant());
         break;
     }
+    if (NeedsPhysicalWriteMark(i.src1)) {
+      MarkPhysicalWrite(e, addr, uint32_t(i.src3.constant()));
+    }
     if (IsTracingData()) {
       addr = ComputeMemoryAddress(e, i.src1);
       e.mov(e.GetNativeParam(2), i.src3.constant());
@@ -2284,7 +2284,7 @@ struct EXTRACT_I32
       e.mov(e.al, i.src2);
       e.and_(e.al, 0x03);
       e.shl(e.al, 4);
-      e.mov(e.rdx, reinterpret_cast<uint64_t>(extract_table_32));
+      e.MovHostAddress(e.rdx, extract_table_32);
       e.vmovaps(e.xmm0, e.ptr[e.rdx + e.rax]);
       e.vpshufb(e.xmm0, src1, e.xmm0);
       e.vpextrd(i.dest, e.xmm0, 0);
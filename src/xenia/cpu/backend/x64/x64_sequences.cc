@@ -84,6 +84,7 @@ struct COMMENT : Sequence<COMMENT, I<OPCODE_COMMENT, VoidOp, OffsetOp>> {
       // TODO(benvanik): don't just leak this memory.
       auto str_copy = strdup(str);
       e.mov(e.rdx, reinterpret_cast<uint64_t>(str_copy));
+      e.MarkNotRelocatable();
       e.CallNative(reinterpret_cast<void*>(TraceString));
     }
   }
@@ -2193,7 +2194,7 @@ struct RSQRT_F64 : Sequence<RSQRT_F64, I<OPCODE_RSQRT, F64Op, F64Op>> {
     e.ChangeMxcsrMode(MXCSRMode::Fpu);
     Xmm src1 = GetInputRegOrConstant(e, i.src1, e.xmm3);
     e.vmovsd(e.xmm0, src1);
-    e.call(e.backend()->frsqrtefp_helper);
+    e.CallHelper(e.backend()->frsqrtefp_helper);
     e.vmovsd(i.dest, e.xmm0);
   }
 };
@@ -2208,11 +2209,11 @@ struct RSQRT_V128 : Sequence<RSQRT_V128, I<OPCODE_RSQRT, V128Op, V128Op>> {
     */
     if (i.src1.value && i.src1.value->AllFloatVectorLanesSameValue()) {
       e.vmovss(e.xmm0, src1);
-      e.call(e.backend()->vrsqrtefp_scalar_helper);
+      e.CallHelper(e.backend()->vrsqrtefp_scalar_helper);
       e.vshufps(i.dest, e.xmm0, e.xmm0, 0);
     } else {
       e.vmovaps(e.xmm0, src1);
-      e.call(e.backend()->vrsqrtefp_vector_helper);
+      e.CallHelper(e.backend()->vrsqrtefp_vector_helper);
       e.vmovaps(i.dest, e.xmm0);
     }
   }
@@ -3311,7 +3312,7 @@ struct SET_ROUNDING_MODE_I32
 
       e.mov(e.ecx, i.src1);
       e.cmovc(e.edx, e.eax);
-      e.mov(e.rax, uintptr_t(mxcsr_table));
+      e.MovHostAddress(e.rax, mxcsr_table);
       e.mov(flags_ptr, e.edx);
       e.mov(e.edx, e.ptr[e.rax + e.rcx * 4]);
       // this was not here
@@ -0,0 +1,187 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compile_worker_pool.h"
+
+#include <algorithm>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/byte_order.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/cpu/function.h"
+#include "xenia/cpu/module.h"
+#include "xenia/cpu/processor.h"
+
+DEFINE_int32(
+    compile_threads, -1,
+    "Number of host threads compiling guest functions in the background when "
+    "early precompilation or tiered compilation is enabled. -1 to calculate "
+    "automatically (75% of logical CPU cores), a positive number to specify "
+    "the number of threads explicitly (up to the number of logical CPU "
+    "cores), 0 to compile everything on the thread that needs it.",
+    "CPU");
+
+DECLARE_bool(enable_early_precompilation);
+DECLARE_bool(tiered_compilation);
+
+namespace xe {
+namespace cpu {
+
+static thread_local bool is_compile_worker_thread_ = false;
+
+std::unique_ptr<CompileWorkerPool> CompileWorkerPool::Create(
+    Processor* processor) {
+  if ((!cvars::enable_early_precompilation && !cvars::tiered_compilation) ||
+      !cvars::compile_threads) {
+    return nullptr;
+  }
+  uint32_t logical_processor_count = xe::threading::logical_processor_count();
+  if (!logical_processor_count) {
+    // Pick some reasonable amount if couldn't determine the number of cores.
+    logical_processor_count = 6;
+  }
+  size_t thread_count;
+  if (cvars::compile_threads < 0) {
+    thread_count = std::max(logical_processor_count * 3 / 4, uint32_t(1));
+  } else {
+    thread_count =
+        std::min(uint32_t(cvars::compile_threads), logical_processor_count);
+  }
+  XELOGI("Compiling guest functions on {} background threads", thread_count);
+  return std::make_unique<CompileWorkerPool>(processor, thread_count);
+}
+
+bool CompileWorkerPool::IsCurrentThreadWorker() {
+  return is_compile_worker_thread_;
+}
+
+CompileWorkerPool::CompileWorkerPool(Processor* processor, size_t thread_count)
+    : processor_(processor) {
+  for (size_t i = 0; i < thread_count; ++i) {
+    std::unique_ptr<xe::threading::Thread> thread =
+        xe::threading::Thread::Create({}, [this]() { WorkerThread(); });
+    assert_not_null(thread);
+    thread->set_name("CPU Compiler");
+    threads_.push_back(std::move(thread));
+  }
+}
+
+CompileWorkerPool::~CompileWorkerPool() {
+  {
+    std::lock_guard<xe_mutex> lock(request_lock_);
+    shutdown_ = true;
+  }
+  request_cond_.notify_all();
+  for (auto& thread : threads_) {
+    xe::threading::Wait(thread.get(), false);
+  }
+  threads_.clear();
+}
+
+void CompileWorkerPool::Enqueue(uint32_t address, CompilePriority priority) {
+  {
+    std::lock_guard<xe_mutex> lock(request_lock_);
+    requests_.push({priority, next_sequence_++, address});
+  }
+  request_cond_.notify_one();
+}
+
+void CompileWorkerPool::Enqueue(const std::vector<uint32_t>& addresses,
+                                CompilePriority priority) {
+  if (addresses.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<xe_mutex> lock(request_lock_);
+    for (uint32_t address : addresses) {
+      requests_.push({priority, next_sequence_++, address});
+    }
+  }
+  request_cond_.notify_all();
+}
+
+void CompileWorkerPool::EnqueueDirectCallees(GuestFunction* function) {
+  Module* module = function->module();
+  auto memory = processor_->memory();
+  std::vector<uint32_t> callees;
+  for (uint32_t address = function->address();
+       address <= function->end_address(); address += 4) {
+    uint32_t code = xe::load_and_swap<uint32_t>(
+        memory->TranslateVirtual<const uint32_t*>(address));
+    // bl / bla.
+    if ((code >> 26) != 18 || !(code & 1)) {
+      continue;
+    }
+    int32_t displacement = int32_t(code << 6) >> 6 & ~3;
+    uint32_t target =
+        (code & 2) ? uint32_t(displacement) : address + uint32_t(displacement);
+    if (target == function->address() || !module->ContainsAddress(target) ||
+        processor_->QueryFunction(target)) {
+      continue;
+    }
+    callees.push_back(target);
+  }
+  Enqueue(callees, CompilePriority::kDemandCallee);
+}
+
+void CompileWorkerPool::EnqueueTierUp(uint32_t address) {
+  Enqueue(address, CompilePriority::kTierUp);
+}
+
+void CompileWorkerPool::RemoveRequests(Module* module) {
+  std::lock_guard<xe_mutex> lock(request_lock_);
+  std::vector<Request> kept_requests;
+  kept_requests.reserve(requests_.size());
+  while (!requests_.empty()) {
+    if (!module->ContainsAddress(requests_.top().address)) {
+      kept_requests.push_back(requests_.top());
+    }
+    requests_.pop();
+  }
+  for (const Request& request : kept_requests) {
+    requests_.push(request);
+  }
+}
+
+size_t CompileWorkerPool::pending_request_count() {
+  std::lock_guard<xe_mutex> lock(request_lock_);
+  return requests_.size();
+}
+
+void CompileWorkerPool::WorkerThread() {
+  is_compile_worker_thread_ = true;
+  while (true) {
+    uint32_t address;
+    CompilePriority priority;
+    {
+      std::unique_lock<xe_mutex> lock(request_lock_);
+      request_cond_.wait(lock,
+                         [this]() { return shutdown_ || !requests_.empty(); });
+      if (shutdown_) {
+        break;
+      }
+      address = requests_.top().address;
+      priority = requests_.top().priority;
+      requests_.pop();
+    }
+    if (priority == CompilePriority::kTierUp) {
+      processor_->RecompileOptimized(address);
+      continue;
+    }
+    // Already compiled or being compiled by whoever needed it first.
+    if (processor_->QueryFunction(address)) {
+      continue;
+    }
+    processor_->ResolveFunction(address);
+  }
+}
+
+}  // namespace cpu
+}  // namespace xe
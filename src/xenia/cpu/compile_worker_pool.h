@@ -0,0 +1,103 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILE_WORKER_POOL_H_
+#define XENIA_CPU_COMPILE_WORKER_POOL_H_
+
+#include <condition_variable>
+#include <memory>
+#include <queue>
+#include <vector>
+
+#include "xenia/base/mutex.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace cpu {
+
+class GuestFunction;
+class Module;
+class Processor;
+
+enum class CompilePriority : uint32_t {
+  // Found by scanning the image for prologs and bl targets.
+  kDiscovered,
+  // Resolved during a previous session, according to the instruction info
+  // cache.
+  kPreviouslyResolved,
+  // Direct callee of a function a guest thread just had to wait for.
+  kDemandCallee,
+  // Optimized recompile of a baseline function that reached
+  // --tier_up_call_count, replaces code that's already running.
+  kTierUp,
+};
+
+// Host threads compiling guest functions ahead of use. Each worker goes
+// through Processor::ResolveFunction like any other thread, so it gets its own
+// translator from the frontend's pool, and a guest thread missing on a function
+// only ever waits for that one function - either compiling it itself or
+// waiting on the entry of the worker that got there first.
+class CompileWorkerPool {
+ public:
+  CompileWorkerPool(Processor* processor, size_t thread_count);
+  ~CompileWorkerPool();
+
+  // Creates a pool sized by --compile_threads, or returns nullptr if
+  // background compilation is disabled.
+  static std::unique_ptr<CompileWorkerPool> Create(Processor* processor);
+
+  static bool IsCurrentThreadWorker();
+
+  size_t thread_count() const { return threads_.size(); }
+
+  void Enqueue(uint32_t address, CompilePriority priority);
+  void Enqueue(const std::vector<uint32_t>& addresses,
+               CompilePriority priority);
+  // Queues the targets of the bl instructions within the function.
+  void EnqueueDirectCallees(GuestFunction* function);
+  // Queues an optimized recompile of an already defined baseline function.
+  void EnqueueTierUp(uint32_t address);
+  // Drops the queued requests within a module that is being unloaded.
+  void RemoveRequests(Module* module);
+
+  size_t pending_request_count();
+
+ private:
+  struct Request {
+    CompilePriority priority;
+    // Orders requests of the same priority first-come first-served.
+    uint64_t sequence;
+    uint32_t address;
+  };
+  struct RequestCompare {
+    bool operator()(const Request& a, const Request& b) const {
+      if (a.priority != b.priority) {
+        return a.priority < b.priority;
+      }
+      return a.sequence > b.sequence;
+    }
+  };
+
+  void WorkerThread();
+
+  Processor* processor_;
+
+  xe_mutex request_lock_;
+  std::condition_variable_any request_cond_;
+  std::priority_queue<Request, std::vector<Request>, RequestCompare> requests_;
+  uint64_t next_sequence_ = 0;
+  // Protected with request_lock_, notify_all request_cond_ when set.
+  bool shutdown_ = false;
+  std::vector<std::unique_ptr<xe::threading::Thread>> threads_;
+};
+
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILE_WORKER_POOL_H_
@@ -0,0 +1,202 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/block_layout_pass.h"
+
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/compiler/compiler.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+
+namespace {
+
+// Whether control can continue from the end of the block into the one after
+// it, same as in Block::GetSuccessors.
+bool FallsThrough(const Block* block) {
+  for (Instr* instr = block->instr_tail;
+       instr && (instr->opcode->flags & OPCODE_FLAG_BRANCH);
+       instr = instr->prev) {
+    if (instr->opcode == &OPCODE_BRANCH_info ||
+        instr->opcode == &OPCODE_RETURN_info) {
+      return false;
+    }
+    if ((instr->opcode == &OPCODE_CALL_info ||
+         instr->opcode == &OPCODE_CALL_INDIRECT_info) &&
+        (instr->flags & CALL_TAIL)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Error paths - tw/td with an always true condition, unreachable code.
+bool EndsInTrap(const Block* block) {
+  const Instr* tail = block->instr_tail;
+  return tail && (tail->opcode == &OPCODE_TRAP_info ||
+                  tail->opcode == &OPCODE_DEBUG_BREAK_info);
+}
+
+}  // namespace
+
+BlockLayoutPass::BlockLayoutPass() : CompilerPass() {}
+
+BlockLayoutPass::~BlockLayoutPass() {}
+
+bool BlockLayoutPass::Run(HIRBuilder* builder) {
+  SCOPE_profile_cpu_f("cpu");
+
+  blocks_.clear();
+  for (auto block = builder->first_block(); block; block = block->next) {
+    // Ordinals are redone by the later passes.
+    block->ordinal = static_cast<uint16_t>(blocks_.size());
+    blocks_.push_back(block);
+  }
+  const size_t block_count = blocks_.size();
+  if (block_count < 2) {
+    return true;
+  }
+
+  // Weight of a block is the count of the baseline block starting at the same
+  // guest instruction, -1 if there was none.
+  counts_.clear();
+  for (uint32_t i = 0; i < block_counter_count_; ++i) {
+    counts_.emplace(block_counters_[i].guest_address,
+                    block_counters_[i].count);
+  }
+  weights_.assign(block_count, -1);
+  cold_.assign(block_count, false);
+  falls_through_.assign(block_count, false);
+  for (size_t i = 0; i < block_count; ++i) {
+    Block* block = blocks_[i];
+    falls_through_[i] = FallsThrough(block);
+    if (!counts_.empty()) {
+      for (Instr* instr = block->instr_head; instr; instr = instr->next) {
+        if (instr->opcode == &OPCODE_SOURCE_OFFSET_info) {
+          auto it = counts_.find(static_cast<uint32_t>(instr->src1.offset));
+          if (it != counts_.end()) {
+            weights_[i] = it->second;
+          }
+          break;
+        }
+      }
+    }
+    // The entry block stays first.
+    if (i && (!weights_[i] || EndsInTrap(block))) {
+      cold_[i] = true;
+    }
+  }
+
+  // Grow a trace from the entry, following the hottest successor that hasn't
+  // been placed yet, preferring the original fallthrough on ties. Successors
+  // without a known weight don't extend the trace, then the next hot block in
+  // the original order starts a new one.
+  std::vector<Block*> order;
+  order.reserve(block_count);
+  placed_.assign(block_count, false);
+  size_t next_unplaced = 0;
+  size_t current = 0;
+  while (true) {
+    order.push_back(blocks_[current]);
+    placed_[current] = true;
+
+    size_t best = block_count;
+    successors_.clear();
+    blocks_[current]->GetSuccessors(&successors_);
+    for (Block* successor : successors_) {
+      size_t index = successor->ordinal;
+      if (placed_[index] || cold_[index] || weights_[index] <= 0) {
+        continue;
+      }
+      if (best == block_count || weights_[index] > weights_[best] ||
+          (weights_[index] == weights_[best] && index == current + 1)) {
+        best = index;
+      }
+    }
+    if (best == block_count) {
+      while (next_unplaced < block_count &&
+             (placed_[next_unplaced] || cold_[next_unplaced])) {
+        ++next_unplaced;
+      }
+      if (next_unplaced == block_count) {
+        break;
+      }
+      best = next_unplaced;
+    }
+    current = best;
+  }
+  for (size_t i = 0; i < block_count; ++i) {
+    if (cold_[i]) {
+      order.push_back(blocks_[i]);
+    }
+  }
+
+  bool changed = false;
+  for (size_t i = 0; i < block_count; ++i) {
+    if (order[i] != blocks_[i]) {
+      changed = true;
+      break;
+    }
+  }
+  if (!changed) {
+    return true;
+  }
+
+  builder->ReorderBlocks(order);
+
+  // Make the fallthroughs that have been broken explicit.
+  for (size_t i = 0; i < block_count; ++i) {
+    if (!falls_through_[i]) {
+      continue;
+    }
+    Block* block = blocks_[i];
+    Block* target = i + 1 < block_count ? blocks_[i + 1] : nullptr;
+    if (block->next == target) {
+      continue;
+    }
+    if (!target) {
+      // Was the last block, falling through into the epilog.
+      builder->AppendReturn(block);
+      continue;
+    }
+    Instr* tail = block->instr_tail;
+    if (tail && block->next &&
+        (tail->opcode == &OPCODE_BRANCH_TRUE_info ||
+         tail->opcode == &OPCODE_BRANCH_FALSE_info) &&
+        tail->src2.label->block == block->next) {
+      // The branch target follows now, so invert the condition and branch to
+      // the old fallthrough instead.
+      tail->opcode = tail->opcode == &OPCODE_BRANCH_TRUE_info
+                         ? &OPCODE_BRANCH_FALSE_info
+                         : &OPCODE_BRANCH_TRUE_info;
+      if (!target->label_head) {
+        builder->MarkLabel(builder->NewLabel(), target);
+      }
+      tail->src2.label = target->label_head;
+      continue;
+    }
+    builder->AppendBranch(block, target);
+  }
+
+  return true;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
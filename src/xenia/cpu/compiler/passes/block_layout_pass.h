@@ -0,0 +1,66 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_BLOCK_LAYOUT_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_BLOCK_LAYOUT_PASS_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+#include "xenia/cpu/function.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Orders blocks so the hot path is contiguous. Starting from the entry, each
+// block is followed by its most executed successor according to the block
+// counters of the function's baseline code, and cold blocks - never entered
+// while profiling, or ending in an unconditional trap - are moved to the end
+// of the function. Fallthroughs broken by the new order are turned into
+// branches, inverting conditional branches where that keeps the hot successor
+// as the fallthrough.
+class BlockLayoutPass : public CompilerPass {
+ public:
+  BlockLayoutPass();
+  ~BlockLayoutPass() override;
+
+  // Profile of the function about to be compiled, or nullptr to only move
+  // statically cold blocks.
+  void set_block_counters(const GuestFunction::BlockCounter* counters,
+                          uint32_t count) {
+    block_counters_ = counters;
+    block_counter_count_ = count;
+  }
+
+  bool Run(hir::HIRBuilder* builder) override;
+
+ private:
+  const GuestFunction::BlockCounter* block_counters_ = nullptr;
+  uint32_t block_counter_count_ = 0;
+
+  // Scratch, by block ordinal.
+  std::vector<hir::Block*> blocks_;
+  std::vector<int64_t> weights_;
+  std::vector<bool> cold_;
+  std::vector<bool> falls_through_;
+  std::vector<bool> placed_;
+  std::vector<hir::Block*> successors_;
+  std::unordered_map<uint32_t, uint32_t> counts_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_BLOCK_LAYOUT_PASS_H_
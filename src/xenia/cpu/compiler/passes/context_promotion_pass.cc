@@ -9,6 +9,8 @@
 
 #include "xenia/cpu/compiler/passes/context_promotion_pass.h"
 
+#include <algorithm>
+
 #include "xenia/apu/apu_flags.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/profiling.h"
@@ -39,7 +41,16 @@ using xe::cpu::hir::HIRBuilder;
 using xe::cpu::hir::Instr;
 using xe::cpu::hir::Value;
 
-ContextPromotionPass::ContextPromotionPass() : CompilerPass() {}
+// Conditional branches are volatile so nothing is moved across them, but they
+// don't touch the context.
+static bool ClobbersContext(const Instr* i) {
+  return (i->opcode->flags & OPCODE_FLAG_VOLATILE) &&
+         i->opcode != &OPCODE_BRANCH_TRUE_info &&
+         i->opcode != &OPCODE_BRANCH_FALSE_info;
+}
+
+ContextPromotionPass::ContextPromotionPass(bool promote_across_blocks)
+    : CompilerPass(), promote_across_blocks_(promote_across_blocks) {}
 
 ContextPromotionPass::~ContextPromotionPass() {}
 
@@ -51,6 +62,8 @@ bool ContextPromotionPass::Initialize(Compiler* compiler) {
   // This is a terrible implementation.
   context_values_.resize(sizeof(ppc::PPCContext));
   context_validity_.resize(static_cast<uint32_t>(sizeof(ppc::PPCContext)));
+  matching_validity_.resize(static_cast<uint32_t>(sizeof(ppc::PPCContext)));
+  side_exit_validity_.resize(static_cast<uint32_t>(sizeof(ppc::PPCContext)));
 
   return true;
 }
@@ -72,10 +85,27 @@ bool ContextPromotionPass::Run(HIRBuilder* builder) {
   // instead as it may be faster (at least on the block-level).
 
   // Promote loads to values.
-  // Process each block independently, for now.
+  // Each block starts from scratch unless its predecessors have already been
+  // processed, in which case the values all of them agree on at their ends are
+  // still valid - stores are never removed from block ends, so the context
+  // memory agrees with them too. Loop back edges are the exception, a loop
+  // header keeps the values its loop body doesn't write.
+  if (promote_across_blocks_) {
+    FindPredecessors(builder);
+  }
   auto block = builder->first_block();
   while (block) {
+    if (!promote_across_blocks_ || !InheritPredecessorValues(block)) {
+      context_validity_.reset();
+    }
     PromoteBlock(block);
+    if (promote_across_blocks_ && save_exit_values_[block->ordinal]) {
+      auto& exit_values = exit_values_[block->ordinal];
+      for (int offset = context_validity_.find_first(); offset != -1;
+           offset = context_validity_.find_next(offset)) {
+        exit_values.emplace_back(uint32_t(offset), context_values_[offset]);
+      }
+    }
     block = block->next;
   }
 
@@ -94,16 +124,164 @@ bool ContextPromotionPass::Run(HIRBuilder* builder) {
   return true;
 }
 
+void ContextPromotionPass::FindPredecessors(HIRBuilder* builder) {
+  blocks_.clear();
+  for (auto block = builder->first_block(); block; block = block->next) {
+    block->ordinal = static_cast<uint16_t>(blocks_.size());
+    blocks_.push_back(block);
+  }
+  const size_t block_count = blocks_.size();
+  predecessors_.resize(block_count);
+  for (auto& predecessors : predecessors_) {
+    predecessors.clear();
+  }
+  loop_stores_.resize(block_count);
+  loop_clobbers_context_.assign(block_count, false);
+  save_exit_values_.assign(block_count, false);
+  exit_values_.resize(block_count);
+  for (auto& exit_values : exit_values_) {
+    exit_values.clear();
+  }
+  std::vector<Block*> successors;
+  for (Block* block : blocks_) {
+    successors.clear();
+    block->GetSuccessors(&successors);
+    for (Block* successor : successors) {
+      auto& predecessors = predecessors_[successor->ordinal];
+      if (std::find(predecessors.begin(), predecessors.end(), block) ==
+          predecessors.end()) {
+        predecessors.push_back(block);
+      }
+      // The state at the end of the previous block is still there when the
+      // next one is processed, others need a copy.
+      if (successor->ordinal > block->ordinal + 1) {
+        save_exit_values_[block->ordinal] = true;
+      }
+    }
+  }
+  for (Block* block : blocks_) {
+    for (Block* predecessor : predecessors_[block->ordinal]) {
+      if (predecessor->ordinal >= block->ordinal) {
+        FindLoopStores(block);
+        break;
+      }
+    }
+  }
+}
+
+void ContextPromotionPass::FindLoopStores(Block* header) {
+  auto& loop_stores = loop_stores_[header->ordinal];
+  loop_stores.clear();
+  loop_stores.resize(static_cast<uint32_t>(sizeof(ppc::PPCContext)));
+  // The loop is everything that reaches the back edges without going through
+  // the header. Reaching the function entry means it can be entered elsewhere.
+  llvm::BitVector in_loop(uint32_t(blocks_.size()));
+  in_loop.set(header->ordinal);
+  std::vector<Block*> pending;
+  for (Block* predecessor : predecessors_[header->ordinal]) {
+    if (predecessor->ordinal >= header->ordinal) {
+      pending.push_back(predecessor);
+    }
+  }
+  while (!pending.empty()) {
+    Block* block = pending.back();
+    pending.pop_back();
+    if (in_loop.test(block->ordinal)) {
+      continue;
+    }
+    if (!block->ordinal) {
+      loop_clobbers_context_[header->ordinal] = true;
+      return;
+    }
+    in_loop.set(block->ordinal);
+    pending.insert(pending.end(), predecessors_[block->ordinal].begin(),
+                   predecessors_[block->ordinal].end());
+  }
+  for (int n = in_loop.find_first(); n != -1; n = in_loop.find_next(n)) {
+    for (auto i = blocks_[n]->instr_head; i; i = i->next) {
+      if (ClobbersContext(i)) {
+        loop_clobbers_context_[header->ordinal] = true;
+        return;
+      }
+      if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+        // Anything overlapping the store, promoted values are 8 bytes at most.
+        uint32_t offset = static_cast<uint32_t>(i->src1.offset);
+        uint32_t size = static_cast<uint32_t>(GetTypeSize(i->src2.value->type));
+        loop_stores.set(offset >= 7 ? offset - 7 : 0,
+                        std::min(offset + size, uint32_t(loop_stores.size())));
+      }
+    }
+  }
+}
+
+bool ContextPromotionPass::InheritPredecessorValues(Block* block) {
+  // The function is entered through the first block.
+  if (!block->ordinal) {
+    return false;
+  }
+  const auto& predecessors = predecessors_[block->ordinal];
+  bool is_loop_header = false;
+  Block* first_predecessor = nullptr;
+  for (Block* predecessor : predecessors) {
+    if (predecessor->ordinal >= block->ordinal) {
+      is_loop_header = true;
+    } else if (!first_predecessor || predecessor == block->prev) {
+      first_predecessor = predecessor;
+    }
+  }
+  if (!first_predecessor ||
+      (is_loop_header && loop_clobbers_context_[block->ordinal])) {
+    return false;
+  }
+  if (first_predecessor != block->prev) {
+    context_validity_.reset();
+    for (const auto& exit_value : exit_values_[first_predecessor->ordinal]) {
+      context_values_[exit_value.first] = exit_value.second;
+      context_validity_.set(exit_value.first);
+    }
+  }
+  // Otherwise the state is still the one at the end of the previous block.
+  for (Block* predecessor : predecessors) {
+    if (predecessor == first_predecessor ||
+        predecessor->ordinal >= block->ordinal) {
+      continue;
+    }
+    matching_validity_.reset();
+    for (const auto& exit_value : exit_values_[predecessor->ordinal]) {
+      if (context_validity_.test(exit_value.first) &&
+          context_values_[exit_value.first] == exit_value.second) {
+        matching_validity_.set(exit_value.first);
+      }
+    }
+    context_validity_ &= matching_validity_;
+  }
+  if (is_loop_header) {
+    context_validity_.reset(loop_stores_[block->ordinal]);
+  }
+  return true;
+}
+
 void ContextPromotionPass::PromoteBlock(Block* block) {
   auto& validity = context_validity_;
-  validity.reset();
+  // Merged blocks may be left through a conditional branch before their end,
+  // only values that are the same there and at the end are valid on exit.
+  bool has_side_exit = false;
 
   Instr* i = block->instr_head;
   while (i) {
     auto next = i->next;
-    if (i->opcode->flags & OPCODE_FLAG_VOLATILE) {
+    if (promote_across_blocks_
+            ? ClobbersContext(i)
+            : (i->opcode->flags & OPCODE_FLAG_VOLATILE) != 0) {
       // Volatile instruction - requires all context values be flushed.
       validity.reset();
+      side_exit_validity_.reset();
+    } else if (i->opcode == &OPCODE_BRANCH_TRUE_info ||
+               i->opcode == &OPCODE_BRANCH_FALSE_info) {
+      if (!has_side_exit) {
+        side_exit_validity_ = validity;
+        has_side_exit = true;
+      }
     } else if (i->opcode == &OPCODE_LOAD_CONTEXT_info) {
       const size_t offset = i->src1.offset;
       if (validity.test(static_cast<uint32_t>(offset))) {
@@ -125,10 +303,14 @@ void ContextPromotionPass::PromoteBlock(Block* block) {
         // Store value into the table for later.
         context_values_[offset] = value;
         validity.set(static_cast<uint32_t>(offset));
+        side_exit_validity_.reset(static_cast<uint32_t>(offset));
       }
     }
     i = next;
   }
+  if (has_side_exit) {
+    validity &= side_exit_validity_;
+  }
 }
 
 void ContextPromotionPass::RemoveDeadStoresBlock(Block* block) {
@@ -11,6 +11,7 @@
 #define XENIA_CPU_COMPILER_PASSES_CONTEXT_PROMOTION_PASS_H_
 
 #include <cmath>
+#include <utility>
 #include <vector>
 
 #include "xenia/base/platform.h"
@@ -33,7 +34,11 @@ namespace passes {
 
 class ContextPromotionPass : public CompilerPass {
  public:
-  ContextPromotionPass();
+  // With promote_across_blocks, values known at the end of all predecessors
+  // of a block are reused in it, and loop headers keep the values their loop
+  // never writes. The resulting values are live across block boundaries, loop
+  // back edges included, so the register allocator must support that.
+  explicit ContextPromotionPass(bool promote_across_blocks = false);
   virtual ~ContextPromotionPass() override;
 
   bool Initialize(Compiler* compiler) override;
@@ -41,12 +46,31 @@ class ContextPromotionPass : public CompilerPass {
   bool Run(hir::HIRBuilder* builder) override;
 
  private:
+  void FindPredecessors(hir::HIRBuilder* builder);
+  void FindLoopStores(hir::Block* header);
+  bool InheritPredecessorValues(hir::Block* block);
   void PromoteBlock(hir::Block* block);
   void RemoveDeadStoresBlock(hir::Block* block);
 
  private:
+  bool promote_across_blocks_;
   std::vector<hir::Value*> context_values_;
   llvm::BitVector context_validity_;
+  // By block ordinal, only used with promote_across_blocks_.
+  std::vector<hir::Block*> blocks_;
+  std::vector<std::vector<hir::Block*>> predecessors_;
+  // Context offsets possibly written in the loop a block is the header of,
+  // meaning it's entered from blocks placed at or after it. Headers of loops
+  // that may clobber the whole context, or that can be entered other than
+  // through the header, can't keep anything.
+  std::vector<llvm::BitVector> loop_stores_;
+  std::vector<bool> loop_clobbers_context_;
+  // Valid context values at the end of blocks that are a predecessor of a
+  // block placed after the next one.
+  std::vector<bool> save_exit_values_;
+  std::vector<std::vector<std::pair<uint32_t, hir::Value*>>> exit_values_;
+  llvm::BitVector matching_validity_;
+  llvm::BitVector side_exit_validity_;
 };
 
 }  // namespace passes
@@ -0,0 +1,141 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/dead_store_elimination_pass.h"
+
+#include "xenia/base/cvar.h"
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/ppc/ppc_context.h"
+
+DECLARE_bool(debug);
+DECLARE_bool(store_all_context_values);
+DECLARE_bool(full_optimization_even_with_debug);
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+
+DeadStoreEliminationPass::DeadStoreEliminationPass() : CompilerPass() {}
+
+DeadStoreEliminationPass::~DeadStoreEliminationPass() {}
+
+bool DeadStoreEliminationPass::Initialize(Compiler* compiler) {
+  if (!CompilerPass::Initialize(compiler)) {
+    return false;
+  }
+  dead_bytes_.resize(static_cast<uint32_t>(sizeof(ppc::PPCContext)));
+  return true;
+}
+
+bool DeadStoreEliminationPass::Run(HIRBuilder* builder) {
+  // Same as the store removal in ContextPromotionPass: stores are what makes
+  // register values visible to the debugger.
+  if (!cvars::full_optimization_even_with_debug &&
+      (cvars::debug || cvars::store_all_context_values)) {
+    return true;
+  }
+
+  // Backwards must-analysis: a byte is dead at a point if every path from
+  // there writes it before anything reads it. Blocks start out with everything
+  // dead and are narrowed down until nothing changes, so loops that never read
+  // a byte keep it dead.
+  uint16_t block_count = 0;
+  for (auto block = builder->first_block(); block; block = block->next) {
+    block->ordinal = block_count++;
+  }
+  if (block_entry_dead_bytes_.size() < block_count) {
+    block_entry_dead_bytes_.resize(block_count);
+  }
+  for (uint16_t n = 0; n < block_count; ++n) {
+    auto& entry_dead_bytes = block_entry_dead_bytes_[n];
+    entry_dead_bytes.resize(dead_bytes_.size());
+    entry_dead_bytes.set();
+  }
+
+  bool changed;
+  do {
+    changed = false;
+    // Reverse order converges faster as most edges go forward.
+    for (auto block = builder->last_block(); block; block = block->prev) {
+      ProcessBlock(block, false);
+      auto& entry_dead_bytes = block_entry_dead_bytes_[block->ordinal];
+      if (!(entry_dead_bytes == dead_bytes_)) {
+        entry_dead_bytes = dead_bytes_;
+        changed = true;
+      }
+    }
+  } while (changed);
+
+  for (auto block = builder->first_block(); block; block = block->next) {
+    ProcessBlock(block, true);
+  }
+
+  return true;
+}
+
+void DeadStoreEliminationPass::ProcessBlock(Block* block, bool remove_stores) {
+  // Leaving the function through the end makes everything observable.
+  if (block->next) {
+    dead_bytes_ = block_entry_dead_bytes_[block->next->ordinal];
+  } else {
+    dead_bytes_.reset();
+  }
+
+  Instr* i = block->instr_tail;
+  while (i) {
+    Instr* prev = i->prev;
+    if (i->opcode == &OPCODE_BRANCH_info) {
+      dead_bytes_ = block_entry_dead_bytes_[i->src1.label->block->ordinal];
+    } else if (i->opcode == &OPCODE_BRANCH_TRUE_info ||
+               i->opcode == &OPCODE_BRANCH_FALSE_info) {
+      dead_bytes_ &= block_entry_dead_bytes_[i->src2.label->block->ordinal];
+    } else if ((i->opcode->flags & OPCODE_FLAG_VOLATILE) ||
+               i->opcode == &OPCODE_CONTEXT_BARRIER_info) {
+      // Calls, returns, traps and the like may look at the whole context.
+      dead_bytes_.reset();
+    } else if (i->opcode == &OPCODE_LOAD_CONTEXT_info) {
+      uint32_t offset = static_cast<uint32_t>(i->src1.offset);
+      dead_bytes_.reset(
+          offset, offset + static_cast<uint32_t>(GetTypeSize(i->dest->type)));
+    } else if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+      uint32_t offset = static_cast<uint32_t>(i->src1.offset);
+      uint32_t end_offset =
+          offset + static_cast<uint32_t>(GetTypeSize(i->src2.value->type));
+      bool is_dead = true;
+      for (uint32_t byte = offset; byte < end_offset; ++byte) {
+        if (!dead_bytes_.test(byte)) {
+          is_dead = false;
+          break;
+        }
+      }
+      if (is_dead) {
+        if (remove_stores) {
+          i->UnlinkAndNOP();
+        }
+      } else {
+        dead_bytes_.set(offset, end_offset);
+      }
+    }
+    i = prev;
+  }
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_DEAD_STORE_ELIMINATION_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_DEAD_STORE_ELIMINATION_PASS_H_
+
+#include <vector>
+
+#include "xenia/base/platform.h"
+#include "xenia/cpu/compiler/compiler_pass.h"
+
+#if XE_COMPILER_MSVC
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 4267)
+#include <llvm/ADT/BitVector.h>
+#pragma warning(pop)
+#else
+#include <llvm/ADT/BitVector.h>
+#endif  // XE_COMPILER_MSVC
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// Removes context stores that are overwritten on every path before anything
+// can read them, including across blocks. Tracked per context byte so partial
+// overlaps (CR fields vs the whole CR, FPSCR bits) are handled.
+class DeadStoreEliminationPass : public CompilerPass {
+ public:
+  DeadStoreEliminationPass();
+  ~DeadStoreEliminationPass() override;
+
+  bool Initialize(Compiler* compiler) override;
+
+  bool Run(hir::HIRBuilder* builder) override;
+
+ private:
+  // Walks the block backwards from its exit state, updating dead_bytes_ to the
+  // bytes dead at its entry. Removes dead stores if remove_stores is set.
+  void ProcessBlock(hir::Block* block, bool remove_stores);
+
+  // Context bytes that will be overwritten before being read, at the current
+  // point of the walk.
+  llvm::BitVector dead_bytes_;
+  // By block ordinal, dead_bytes_ at the block entry.
+  std::vector<llvm::BitVector> block_entry_dead_bytes_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_DEAD_STORE_ELIMINATION_PASS_H_
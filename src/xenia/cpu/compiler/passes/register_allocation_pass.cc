@@ -10,12 +10,23 @@
 #include "xenia/cpu/compiler/passes/register_allocation_pass.h"
 
 #include <cstring>
+#include <numeric>
 
 #include "xenia/base/assert.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
 
+#if XE_COMPILER_MSVC
+#pragma warning(push)
+#pragma warning(disable : 4244)
+#pragma warning(disable : 4267)
+#include <llvm/ADT/BitVector.h>
+#pragma warning(pop)
+#else
+#include <llvm/ADT/BitVector.h>
+#endif  // XE_COMPILER_MSVC
+
 namespace xe {
 namespace cpu {
 namespace compiler {
@@ -25,6 +36,7 @@ namespace passes {
 using namespace xe::cpu::hir;
 
 using xe::cpu::backend::MachineInfo;
+using xe::cpu::hir::Block;
 using xe::cpu::hir::HIRBuilder;
 using xe::cpu::hir::Instr;
 using xe::cpu::hir::OpcodeSignatureType;
@@ -34,8 +46,9 @@ using xe::cpu::hir::Value;
 
 #define ASSERT_NO_CYCLES 0
 
-RegisterAllocationPass::RegisterAllocationPass(const MachineInfo* machine_info)
-    : CompilerPass() {
+RegisterAllocationPass::RegisterAllocationPass(const MachineInfo* machine_info,
+                                               bool allocate_across_blocks)
+    : CompilerPass(), allocate_across_blocks_(allocate_across_blocks) {
   // Initialize register sets.
   // TODO(benvanik): rewrite in a way that makes sense - this is terrible.
   auto mi_sets = machine_info->register_sets;
@@ -45,6 +58,7 @@ RegisterAllocationPass::RegisterAllocationPass(const MachineInfo* machine_info)
     auto& mi_set = mi_sets[n];
     auto usage_set = new RegisterSetUsage();
     usage_sets_.all_sets[n] = usage_set;
+    usage_set->index = n;
     usage_set->count = mi_set.count;
     usage_set->set = &mi_set;
     if (mi_set.types & MachineInfo::RegisterSet::INT_TYPES) {
@@ -75,6 +89,13 @@ bool RegisterAllocationPass::Run(HIRBuilder* builder) {
   // optimized with some intra-block analysis (dominators/etc).
   // Really, it'd just be nice to have someone who knew what they
   // were doing lower SSA and do this right.
+  // Values that do cross blocks get their registers up front and are left
+  // alone below.
+  if (allocate_across_blocks_) {
+    AllocateCrossBlockValues(builder);
+  } else {
+    block_reserved_regs_.clear();
+  }
 
   uint16_t block_ordinal = 0;
   uint32_t instr_ordinal = 0;
@@ -84,7 +105,7 @@ bool RegisterAllocationPass::Run(HIRBuilder* builder) {
     block->ordinal = block_ordinal++;
 
     // Reset all state.
-    PrepareBlockState();
+    PrepareBlockState(block);
 
     // Renumber all instructions in the block. This is required so that
     // we can sort the usage pointers below.
@@ -124,10 +145,11 @@ bool RegisterAllocationPass::Run(HIRBuilder* builder) {
         }
       }
 
-      if (GET_OPCODE_SIG_TYPE_DEST(signature) == OPCODE_SIG_TYPE_V) {
-        // Must not have been set already.
-        assert_null(instr->dest->reg.set);
-
+      if (GET_OPCODE_SIG_TYPE_DEST(signature) == OPCODE_SIG_TYPE_V &&
+          instr->dest->reg.set) {
+        // Cross-block value, its register is reserved for the whole block.
+        assert_true(allocate_across_blocks_);
+      } else if (GET_OPCODE_SIG_TYPE_DEST(signature) == OPCODE_SIG_TYPE_V) {
         // Sort the usage list. We depend on this in future uses of this
         // variable.
         SortUsageList(instr->dest);
@@ -194,11 +216,242 @@ void RegisterAllocationPass::DumpUsage(const char* name) {
 #endif
 }
 
-void RegisterAllocationPass::PrepareBlockState() {
+void RegisterAllocationPass::AllocateCrossBlockValues(HIRBuilder* builder) {
+  std::vector<Block*> blocks;
+  for (auto block = builder->first_block(); block; block = block->next) {
+    block->ordinal = static_cast<uint16_t>(blocks.size());
+    blocks.push_back(block);
+  }
+  const size_t block_count = blocks.size();
+  block_reserved_regs_.assign(block_count, {});
+
+  // Gather the values used outside of the block defining them. Instruction
+  // ordinals are only needed within blocks here and are redone later.
+  std::vector<Value*> values;
+  uint32_t instr_ordinal = 0;
+  for (Block* block : blocks) {
+    for (auto instr = block->instr_head; instr; instr = instr->next) {
+      instr->ordinal = instr_ordinal++;
+      if (GET_OPCODE_SIG_TYPE_DEST(instr->opcode->signature) !=
+          OPCODE_SIG_TYPE_V) {
+        continue;
+      }
+      for (auto use = instr->dest->use_head; use; use = use->next) {
+        if (use->instr->block != block) {
+          values.push_back(instr->dest);
+          break;
+        }
+      }
+    }
+  }
+  if (values.empty()) {
+    return;
+  }
+  const size_t value_count = values.size();
+  std::vector<int32_t> value_indices(builder->max_value_ordinal() + 1, -1);
+  for (size_t n = 0; n < value_count; ++n) {
+    value_indices[values[n]->ordinal] = static_cast<int32_t>(n);
+  }
+
+  // Block-level liveness of the values over the CFG. Unlike the incoming
+  // values of DataFlowAnalysisPass this follows loop back edges too, a value
+  // live around a loop keeps its register in every block of the loop.
+  std::vector<llvm::BitVector> defs(block_count,
+                                    llvm::BitVector(uint32_t(value_count)));
+  std::vector<llvm::BitVector> upward_uses(defs);
+  std::vector<llvm::BitVector> live_in(defs);
+  std::vector<llvm::BitVector> live_out(defs);
+  for (size_t n = 0; n < value_count; ++n) {
+    Value* value = values[n];
+    const Block* def_block = value->def->block;
+    defs[def_block->ordinal].set(uint32_t(n));
+    for (auto use = value->use_head; use; use = use->next) {
+      if (use->instr->block != def_block) {
+        upward_uses[use->instr->block->ordinal].set(uint32_t(n));
+      }
+    }
+  }
+  std::vector<std::vector<uint16_t>> successors(block_count);
+  std::vector<Block*> block_successors;
+  for (Block* block : blocks) {
+    block_successors.clear();
+    block->GetSuccessors(&block_successors);
+    for (Block* successor : block_successors) {
+      successors[block->ordinal].push_back(successor->ordinal);
+    }
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t n = block_count; n-- > 0;) {
+      for (uint16_t successor : successors[n]) {
+        live_out[n] |= live_in[successor];
+      }
+      llvm::BitVector block_live_in(live_out[n]);
+      block_live_in.reset(defs[n]);
+      block_live_in |= upward_uses[n];
+      if (block_live_in != live_in[n]) {
+        live_in[n] = block_live_in;
+        changed = true;
+      }
+    }
+  }
+
+  // Blocks each value needs its register in, and whether it's live across
+  // something that clobbers all registers, like a guest call. Conditional
+  // branches are volatile too, but only use scratch registers.
+  std::vector<llvm::BitVector> value_blocks(
+      value_count, llvm::BitVector(uint32_t(block_count)));
+  std::vector<bool> crosses_volatile(value_count, false);
+  for (Block* block : blocks) {
+    const uint16_t b = block->ordinal;
+    llvm::BitVector live(live_in[b]);
+    for (auto instr = block->instr_head; instr; instr = instr->next) {
+      if ((instr->opcode->flags & OPCODE_FLAG_VOLATILE) &&
+          instr->opcode != &OPCODE_BRANCH_TRUE_info &&
+          instr->opcode != &OPCODE_BRANCH_FALSE_info) {
+        for (int n = live.find_first(); n != -1; n = live.find_next(n)) {
+          bool used_after = live_out[b].test(n);
+          for (auto use = values[n]->use_head; use && !used_after;
+               use = use->next) {
+            used_after = use->instr->block == block &&
+                         use->instr->ordinal > instr->ordinal;
+          }
+          if (used_after) {
+            crosses_volatile[n] = true;
+          }
+        }
+      }
+      if (GET_OPCODE_SIG_TYPE_DEST(instr->opcode->signature) ==
+              OPCODE_SIG_TYPE_V &&
+          value_indices[instr->dest->ordinal] >= 0) {
+        live.set(value_indices[instr->dest->ordinal]);
+      }
+    }
+    for (int n = live_in[b].find_first(); n != -1;
+         n = live_in[b].find_next(n)) {
+      value_blocks[n].set(b);
+    }
+    for (int n = defs[b].find_first(); n != -1; n = defs[b].find_next(n)) {
+      value_blocks[n].set(b);
+    }
+  }
+
+  // Greedily color the values with the most uses first. Part of each set is
+  // left to the per-block allocation so it never runs out of registers to
+  // spill into.
+  std::vector<uint32_t> use_counts(value_count, 0);
+  for (size_t n = 0; n < value_count; ++n) {
+    for (auto use = values[n]->use_head; use; use = use->next) {
+      ++use_counts[n];
+    }
+  }
+  std::vector<uint32_t> order(value_count);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&use_counts](uint32_t a, uint32_t b) {
+                     return use_counts[a] > use_counts[b];
+                   });
+  std::vector<llvm::BitVector> occupied_blocks[3];
+  for (size_t i = 0; i < xe::countof(usage_sets_.all_sets); ++i) {
+    auto usage_set = usage_sets_.all_sets[i];
+    if (!usage_set) {
+      break;
+    }
+    uint32_t reserved_limit =
+        usage_set->count > 4
+            ? std::min(usage_set->count - 4, usage_set->count / 2)
+            : 0;
+    occupied_blocks[i].assign(reserved_limit,
+                              llvm::BitVector(uint32_t(block_count)));
+  }
+  for (uint32_t n : order) {
+    Value* value = values[n];
+    auto usage_set = RegisterSetForValue(value);
+    auto& set_occupied_blocks = occupied_blocks[usage_set->index];
+    bool allocated = false;
+    for (uint32_t k = 0; k < set_occupied_blocks.size() && !crosses_volatile[n];
+         ++k) {
+      if (set_occupied_blocks[k].anyCommon(value_blocks[n])) {
+        continue;
+      }
+      set_occupied_blocks[k] |= value_blocks[n];
+      // Take registers from the top, the per-block allocation starts from the
+      // bottom.
+      value->reg.set = usage_set->set;
+      value->reg.index = usage_set->count - 1 - k;
+      for (int b = value_blocks[n].find_first(); b != -1;
+           b = value_blocks[n].find_next(b)) {
+        block_reserved_regs_[b][usage_set->index].set(value->reg.index);
+      }
+      allocated = true;
+      break;
+    }
+    if (!allocated) {
+      LocalizeValue(builder, value);
+    }
+  }
+}
+
+void RegisterAllocationPass::LocalizeValue(HIRBuilder* builder, Value* value) {
+  Block* def_block = value->def->block;
+  if (!value->HasLocalSlot()) {
+    value->SetLocalSlot(builder->AllocLocal(value->type));
+  }
+  Value* local_slot = value->GetLocalSlot();
+
+  // Store right after the def, or as soon after as we can (respecting PAIRED
+  // flags).
+  builder->StoreLocal(local_slot, value);
+  Instr* store = builder->last_instr();
+  Instr* after = value->def;
+  while (after->next && after->next->opcode->flags & OPCODE_FLAG_PAIRED_PREV) {
+    after = after->next;
+  }
+  if (after->next) {
+    store->MoveBefore(after->next);
+  } else {
+    store->MoveBefore(after);
+    after->MoveBefore(store);
+  }
+
+  // Reload before every instruction using it elsewhere, the loaded values are
+  // then local to those blocks.
+  std::vector<Instr*> use_instrs;
+  for (auto use = value->use_head; use; use = use->next) {
+    if (use->instr->block != def_block) {
+      use_instrs.push_back(use->instr);
+    }
+  }
+  for (Instr* instr : use_instrs) {
+    Value* loaded_value = nullptr;
+    instr->VisitValueOperands([&](Value* operand, uint32_t idx) {
+      if (operand != value) {
+        return;
+      }
+      if (!loaded_value) {
+        loaded_value = builder->LoadLocal(local_slot);
+        loaded_value->SetLocalSlot(local_slot);
+        Instr* insert_before = instr;
+        while (insert_before->opcode->flags & OPCODE_FLAG_PAIRED_PREV &&
+               insert_before->prev) {
+          insert_before = insert_before->prev;
+        }
+        builder->last_instr()->MoveBefore(insert_before);
+      }
+      instr->set_srcN(loaded_value, idx);
+    });
+  }
+}
+
+void RegisterAllocationPass::PrepareBlockState(const Block* block) {
   for (size_t i = 0; i < xe::countof(usage_sets_.all_sets); ++i) {
     auto usage_set = usage_sets_.all_sets[i];
     if (usage_set) {
       usage_set->availability.set();
+      if (block->ordinal < block_reserved_regs_.size()) {
+        usage_set->availability &= ~block_reserved_regs_[block->ordinal][i];
+      }
       usage_set->upcoming_uses.clear();
     }
   }
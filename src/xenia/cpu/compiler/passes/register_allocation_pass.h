@@ -11,6 +11,7 @@
 #define XENIA_CPU_COMPILER_PASSES_REGISTER_ALLOCATION_PASS_H_
 
 #include <algorithm>
+#include <array>
 #include <bitset>
 #include <functional>
 #include <vector>
@@ -25,7 +26,11 @@ namespace passes {
 
 class RegisterAllocationPass : public CompilerPass {
  public:
-  explicit RegisterAllocationPass(const backend::MachineInfo* machine_info);
+  // With allocate_across_blocks, values used outside of the block defining
+  // them (see ContextPromotionPass promote_across_blocks) keep one register in
+  // every block they're live in.
+  explicit RegisterAllocationPass(const backend::MachineInfo* machine_info,
+                                  bool allocate_across_blocks = false);
   ~RegisterAllocationPass() override;
 
   bool Run(hir::HIRBuilder* builder) override;
@@ -45,6 +50,8 @@ class RegisterAllocationPass : public CompilerPass {
   };
   struct RegisterSetUsage {
     const backend::MachineInfo::RegisterSet* set = nullptr;
+    // Index in usage_sets_.all_sets.
+    uint32_t index = 0;
     uint32_t count = 0;
     std::bitset<32> availability = 0;
     // TODO(benvanik): another data type.
@@ -52,7 +59,13 @@ class RegisterAllocationPass : public CompilerPass {
   };
 
   void DumpUsage(const char* name);
-  void PrepareBlockState();
+  // Assigns registers to the values live across block boundaries before the
+  // per-block allocation, based on block-level liveness over the CFG. Values
+  // that don't fit or would have to survive a volatile instruction are passed
+  // through a local instead.
+  void AllocateCrossBlockValues(hir::HIRBuilder* builder);
+  void LocalizeValue(hir::HIRBuilder* builder, hir::Value* value);
+  void PrepareBlockState(const hir::Block* block);
   void AdvanceUses(hir::Instr* instr);
   bool IsRegInUse(const hir::RegAssignment& reg);
   RegisterSetUsage* MarkRegUsed(const hir::RegAssignment& reg,
@@ -76,6 +89,10 @@ class RegisterAllocationPass : public CompilerPass {
     RegisterSetUsage* vec_set = nullptr;
     RegisterSetUsage* all_sets[3];
   } usage_sets_;
+
+  bool allocate_across_blocks_;
+  // Registers held by cross-block values, by block ordinal and set index.
+  std::vector<std::array<std::bitset<32>, 3>> block_reserved_regs_;
 };
 
 }  // namespace passes
@@ -13,6 +13,7 @@
 #include "xenia/base/profiling.h"
 #include "xenia/cpu/backend/backend.h"
 #include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/processor.h"
 
 namespace xe {
@@ -77,7 +78,9 @@ bool ValidationPass::ValidateInstruction(Block* block, Instr* instr) {
     assert_true(instr->dest->def == instr);
     auto use = instr->dest->use_head;
     while (use) {
-      assert_true(use->instr->block == block);
+      // Values only leave their block with --global_register_allocation.
+      assert_true(use->instr->block == block ||
+                  cvars::global_register_allocation);
       use = use->next;
     }
   }
@@ -15,17 +15,6 @@
 #include "xenia/cpu/compiler/compiler.h"
 #include "xenia/cpu/processor.h"
 
-#if XE_COMPILER_MSVC
-#pragma warning(push)
-#pragma warning(disable : 4244)
-#pragma warning(disable : 4267)
-#include <llvm/ADT/BitVector.h>
-#pragma warning(pop)
-#else
-#include <llvm/ADT/BitVector.h>
-#include <cmath>
-#endif  // XE_COMPILER_MSVC
-
 namespace xe {
 namespace cpu {
 namespace compiler {
@@ -35,6 +24,7 @@ namespace passes {
 using namespace xe::cpu::hir;
 
 using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
 using xe::cpu::hir::OpcodeInfo;
 using xe::cpu::hir::Value;
 
@@ -42,101 +32,189 @@ ValueReductionPass::ValueReductionPass() : CompilerPass() {}
 
 ValueReductionPass::~ValueReductionPass() {}
 
-void ValueReductionPass::ComputeLastUse(Value* value) {
-  // TODO(benvanik): compute during construction?
-  // Note that this list isn't sorted (unfortunately), so we have to scan
-  // them all.
-  uint32_t max_ordinal = 0;
-  Value::Use* last_use = nullptr;
-  auto use = value->use_head;
-  while (use) {
-    if (!last_use || use->instr->ordinal >= max_ordinal) {
-      last_use = use;
-      max_ordinal = use->instr->ordinal;
+static Value* GetAssignedValue(Value* value) {
+  while (value->def && value->def->opcode == &OPCODE_ASSIGN_info) {
+    value = value->def->src1.value;
+  }
+  return value;
+}
+
+static uint64_t HashConstant(const Value* value) {
+  switch (value->type) {
+    case INT8_TYPE:
+      return uint8_t(value->constant.i8);
+    case INT16_TYPE:
+      return uint16_t(value->constant.i16);
+    case INT32_TYPE:
+    case FLOAT32_TYPE:
+      return uint32_t(value->constant.i32);
+    case INT64_TYPE:
+    case FLOAT64_TYPE:
+      return uint64_t(value->constant.i64);
+    case VEC128_TYPE:
+      return value->constant.v128.low * 31 + value->constant.v128.high;
+    default:
+      return 0;
+  }
+}
+
+// Bitwise, unlike Value::IsConstantEQ, as 0.0 and -0.0 aren't interchangeable.
+static bool AreSameValue(const Value* a, const Value* b) {
+  if (a == b) {
+    return true;
+  }
+  if (!a->IsConstant() || !b->IsConstant() || a->type != b->type) {
+    return false;
+  }
+  switch (a->type) {
+    case INT8_TYPE:
+      return a->constant.i8 == b->constant.i8;
+    case INT16_TYPE:
+      return a->constant.i16 == b->constant.i16;
+    case INT32_TYPE:
+    case FLOAT32_TYPE:
+      return a->constant.i32 == b->constant.i32;
+    case INT64_TYPE:
+    case FLOAT64_TYPE:
+      return a->constant.i64 == b->constant.i64;
+    case VEC128_TYPE:
+      return a->constant.v128 == b->constant.v128;
+    default:
+      return false;
+  }
+}
+
+static uint64_t HashValue(const Value* value) {
+  if (value->IsConstant()) {
+    return HashConstant(value) * 0x9E3779B97F4A7C15ull + value->type;
+  }
+  return uint64_t(reinterpret_cast<uintptr_t>(value));
+}
+
+bool ValueReductionPass::IsNumberable(const Instr* i) {
+  const OpcodeInfo* info = i->opcode;
+  if (info->flags & (OPCODE_FLAG_BRANCH | OPCODE_FLAG_MEMORY |
+                     OPCODE_FLAG_VOLATILE | OPCODE_FLAG_IGNORE |
+                     OPCODE_FLAG_PAIRED_PREV)) {
+    return false;
+  }
+  OpcodeSignatureType dest_type, src1_type, src2_type, src3_type;
+  UnpackOpcodeSig(info->signature, dest_type, src1_type, src2_type, src3_type);
+  if (dest_type != OPCODE_SIG_TYPE_V) {
+    return false;
+  }
+  for (auto src_type : {src1_type, src2_type, src3_type}) {
+    if (src_type != OPCODE_SIG_TYPE_X && src_type != OPCODE_SIG_TYPE_V &&
+        src_type != OPCODE_SIG_TYPE_O) {
+      return false;
     }
-    use = use->next;
   }
-  value->last_use = last_use ? last_use->instr : nullptr;
+  // Results that depend on state other than the operands. Context loads are
+  // ContextPromotionPass's job.
+  return info != &OPCODE_ASSIGN_info && info != &OPCODE_LOAD_CLOCK_info &&
+         info != &OPCODE_LOAD_LOCAL_info && info != &OPCODE_LOAD_CONTEXT_info;
 }
 
-bool ValueReductionPass::Run(HIRBuilder* builder) {
-  // Walk each block and reuse variable ordinals as much as possible.
+uint64_t ValueReductionPass::HashOperands(const Instr* i) {
+  const OpcodeInfo* info = i->opcode;
+  OpcodeSignatureType dest_type, src1_type, src2_type, src3_type;
+  UnpackOpcodeSig(info->signature, dest_type, src1_type, src2_type, src3_type);
+  OpcodeSignatureType src_types[] = {src1_type, src2_type, src3_type};
+  uint64_t src_hashes[3] = {};
+  for (uint32_t n = 0; n < 3; ++n) {
+    if (src_types[n] == OPCODE_SIG_TYPE_V) {
+      src_hashes[n] = HashValue(i->srcs[n].value);
+    } else if (src_types[n] == OPCODE_SIG_TYPE_O) {
+      src_hashes[n] = i->srcs[n].offset;
+    }
+  }
+  uint64_t hash = uint64_t(reinterpret_cast<uintptr_t>(info));
+  hash = hash * 31 + i->flags;
+  hash = hash * 31 + i->dest->type;
+  if (info->flags & OPCODE_FLAG_COMMUNATIVE) {
+    // Order independent so a + b finds b + a.
+    hash = hash * 31 + (src_hashes[0] ^ src_hashes[1]);
+  } else {
+    hash = hash * 31 + src_hashes[0];
+    hash = hash * 31 + src_hashes[1];
+  }
+  hash = hash * 31 + src_hashes[2];
+  return hash;
+}
 
-  llvm::BitVector ordinals(builder->max_value_ordinal());
+bool ValueReductionPass::AreEquivalent(const Instr* a, const Instr* b) {
+  if (a->opcode != b->opcode || a->flags != b->flags ||
+      a->dest->type != b->dest->type) {
+    return false;
+  }
+  OpcodeSignatureType dest_type, src1_type, src2_type, src3_type;
+  UnpackOpcodeSig(a->opcode->signature, dest_type, src1_type, src2_type,
+                  src3_type);
+  auto same_operand = [](OpcodeSignatureType type, const Instr::Op& x,
+                         const Instr::Op& y) {
+    if (type == OPCODE_SIG_TYPE_V) {
+      return AreSameValue(x.value, y.value);
+    }
+    if (type == OPCODE_SIG_TYPE_O) {
+      return x.offset == y.offset;
+    }
+    return true;
+  };
+  if (!same_operand(src3_type, a->src3, b->src3)) {
+    return false;
+  }
+  if (same_operand(src1_type, a->src1, b->src1) &&
+      same_operand(src2_type, a->src2, b->src2)) {
+    return true;
+  }
+  return (a->opcode->flags & OPCODE_FLAG_COMMUNATIVE) &&
+         same_operand(src1_type, a->src1, b->src2) &&
+         same_operand(src2_type, a->src2, b->src1);
+}
 
+bool ValueReductionPass::Run(HIRBuilder* builder) {
+  // Value ordinals stay unique - RegisterAllocationPass indexes by them.
   auto block = builder->first_block();
   while (block) {
-    // Reset used ordinals.
-    ordinals.reset();
-
-    // Renumber all instructions to make liveness tracking easier.
-    uint32_t instr_ordinal = 0;
-    auto instr = block->instr_head;
-    while (instr) {
-      instr->ordinal = instr_ordinal++;
-      instr = instr->next;
-    }
-
-    instr = block->instr_head;
-    while (instr) {
-      const OpcodeInfo* info = instr->opcode;
-      auto dest_type = GET_OPCODE_SIG_TYPE_DEST(info->signature);
-      auto src1_type = GET_OPCODE_SIG_TYPE_SRC1(info->signature);
-      auto src2_type = GET_OPCODE_SIG_TYPE_SRC2(info->signature);
-      auto src3_type = GET_OPCODE_SIG_TYPE_SRC3(info->signature);
-      if (src1_type == OPCODE_SIG_TYPE_V) {
-        auto v = instr->src1.value;
-        if (!v->last_use) {
-          ComputeLastUse(v);
-        }
-        if (v->last_use == instr) {
-          // Available.
-          if (!instr->src1.value->IsConstant()) {
-            ordinals.reset(v->ordinal);
-          }
-        }
-      }
-      if (src2_type == OPCODE_SIG_TYPE_V) {
-        auto v = instr->src2.value;
-        if (!v->last_use) {
-          ComputeLastUse(v);
-        }
-        if (v->last_use == instr) {
-          // Available.
-          if (!instr->src2.value->IsConstant()) {
-            ordinals.reset(v->ordinal);
-          }
+    available_.clear();
+    auto i = block->instr_head;
+    while (i) {
+      // Look through the assignments left by earlier replacements so their
+      // users can be matched too.
+      i->VisitValueOperands([i](Value* value, uint32_t idx) {
+        Value* assigned_value = GetAssignedValue(value);
+        if (assigned_value != value) {
+          i->set_srcN(assigned_value, idx);
         }
-      }
-      if (src3_type == OPCODE_SIG_TYPE_V) {
-        auto v = instr->src3.value;
-        if (!v->last_use) {
-          ComputeLastUse(v);
-        }
-        if (v->last_use == instr) {
-          // Available.
-          if (!instr->src3.value->IsConstant()) {
-            ordinals.reset(v->ordinal);
-          }
-        }
-      }
-      if (dest_type == OPCODE_SIG_TYPE_V) {
-        // Dest values are processed last, as they may be able to reuse a
-        // source value ordinal.
-        auto v = instr->dest;
-        // Find a lower ordinal.
-        for (auto n = 0u; n < ordinals.size(); n++) {
-          if (!ordinals.test(n)) {
-            ordinals.set(n);
-            v->ordinal = n;
+      });
+
+      if (i->opcode == &OPCODE_SET_ROUNDING_MODE_info ||
+          i->opcode == &OPCODE_SET_NJM_info ||
+          (i->opcode->flags & (OPCODE_FLAG_BRANCH | OPCODE_FLAG_VOLATILE))) {
+        // Floating-point results computed before aren't the same anymore -
+        // calls and traps may change the rounding and denormal modes too.
+        available_.clear();
+      } else if (IsNumberable(i)) {
+        uint64_t hash = HashOperands(i);
+        Instr* existing = nullptr;
+        auto range = available_.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+          if (AreEquivalent(it->second, i)) {
+            existing = it->second;
             break;
           }
         }
+        // An instruction followed by one reading its host flags must stay.
+        if (existing &&
+            !(i->next && (i->next->opcode->flags & OPCODE_FLAG_PAIRED_PREV))) {
+          i->Replace(&OPCODE_ASSIGN_info, 0);
+          i->set_src1(existing->dest);
+        } else if (!existing) {
+          available_.emplace(hash, i);
+        }
       }
-
-      instr = instr->next;
+      i = i->next;
     }
-
     block = block->next;
   }
 
@@ -10,6 +10,8 @@
 #ifndef XENIA_CPU_COMPILER_PASSES_VALUE_REDUCTION_PASS_H_
 #define XENIA_CPU_COMPILER_PASSES_VALUE_REDUCTION_PASS_H_
 
+#include <unordered_map>
+
 #include "xenia/cpu/compiler/compiler_pass.h"
 
 namespace xe {
@@ -17,6 +19,9 @@ namespace cpu {
 namespace compiler {
 namespace passes {
 
+// Local value numbering: within each block, an instruction computing the same
+// thing from the same operands as an earlier one is turned into an assignment
+// of the earlier result, leaving the instruction itself to DCE.
 class ValueReductionPass : public CompilerPass {
  public:
   ValueReductionPass();
@@ -25,7 +30,12 @@ class ValueReductionPass : public CompilerPass {
   bool Run(hir::HIRBuilder* builder) override;
 
  private:
-  void ComputeLastUse(hir::Value* value);
+  static bool IsNumberable(const hir::Instr* i);
+  static uint64_t HashOperands(const hir::Instr* i);
+  static bool AreEquivalent(const hir::Instr* a, const hir::Instr* b);
+
+  // Numberable instructions seen so far in the block, by HashOperands.
+  std::unordered_multimap<uint64_t, hir::Instr*> available_;
 };
 
 }  // namespace passes
@@ -33,6 +33,45 @@ DEFINE_bool(trace_function_data, false,
 DEFINE_bool(validate_hir, false,
             "Perform validation checks on the HIR during compilation.", "CPU");
 
+DEFINE_bool(tiered_compilation, false,
+            "Compile functions with a cheap optimization pipeline first and "
+            "recompile them with the full one in the background once they've "
+            "been called --tier_up_call_count times.",
+            "CPU");
+DEFINE_uint32(tier_up_call_count, 1000,
+              "Calls after which a baseline function is recompiled with full "
+              "optimization when --tiered_compilation is enabled.",
+              "CPU");
+DEFINE_bool(global_register_allocation, false,
+            "Carry promoted context values into blocks whose predecessors "
+            "all agree on them, and around loops that don't write them, and "
+            "keep them in host registers across block boundaries instead of "
+            "reloading them from the context.",
+            "CPU");
+DEFINE_bool(inline_guest_functions, false,
+            "Splice small statically known callees into the caller while "
+            "translating it instead of emitting a guest call.",
+            "CPU");
+DEFINE_int32(inline_max_instructions, 32,
+             "Largest callee, in guest instructions, that "
+             "--inline_guest_functions will inline.",
+             "CPU");
+DEFINE_int32(inline_max_depth, 2,
+             "How many levels of callees nested within inlined callees "
+             "--inline_guest_functions will inline.",
+             "CPU");
+DEFINE_bool(chain_direct_calls, false,
+            "Patch statically known guest call sites to call the callee's "
+            "machine code directly once it has been resolved instead of going "
+            "through the indirection table on every call.",
+            "CPU");
+DEFINE_bool(profile_guided_block_layout, false,
+            "Order the blocks of optimized functions hot path first, moving "
+            "blocks that never ran in the baseline tier of "
+            "--tiered_compilation, and ones that only trap, to the end of the "
+            "function. Baseline code counts block entries for this.",
+            "CPU");
+
 // https://github.com/bitsh1ft3r/Xenon/blob/091e8cd4dc4a7c697b4979eb200be7c9dee3590b/Xenon/Core/XCPU/PPU/PowerPC.h#L370
 DEFINE_uint64(
     pvr, 0x710700,
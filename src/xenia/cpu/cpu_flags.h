@@ -24,6 +24,15 @@ DECLARE_bool(trace_function_data);
 
 DECLARE_bool(validate_hir);
 
+DECLARE_bool(tiered_compilation);
+DECLARE_uint32(tier_up_call_count);
+DECLARE_bool(global_register_allocation);
+DECLARE_bool(inline_guest_functions);
+DECLARE_int32(inline_max_instructions);
+DECLARE_int32(inline_max_depth);
+DECLARE_bool(chain_direct_calls);
+DECLARE_bool(profile_guided_block_layout);
+
 DECLARE_uint64(pvr);
 
 // Breakpoints:
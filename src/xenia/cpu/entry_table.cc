@@ -9,29 +9,62 @@
 
 #include "xenia/cpu/entry_table.h"
 
+#include <algorithm>
+
 #include "xenia/base/profiling.h"
 #include "xenia/base/threading.h"
 
 namespace xe {
 namespace cpu {
 
-EntryTable::EntryTable() = default;
+EntryTable::EntryTable() : root_(new std::atomic<Leaf*>[kRootSlotCount]()) {}
 
 EntryTable::~EntryTable() {
-  auto global_lock = global_critical_region_.Acquire();
-  for (auto it : map_.Values()) {
-    Entry* entry = it;
+  for (Entry* entry : entries_) {
+    delete entry;
+  }
+  for (Entry* entry : retired_entries_) {
     delete entry;
   }
+  for (uint32_t i = 0; i < kRootSlotCount; ++i) {
+    delete root_[i].load(std::memory_order_relaxed);
+  }
+}
+
+std::atomic<Entry*>* EntryTable::LookupSlot(uint32_t address) const {
+  Leaf* leaf = root_[address >> kLeafShift].load(std::memory_order_acquire);
+  if (!leaf) {
+    return nullptr;
+  }
+  return &leaf->slots[(address & ((1u << kLeafShift) - 1)) >> 2];
+}
+
+std::atomic<Entry*>* EntryTable::LookupOrCreateSlot(uint32_t address) {
+  auto& root_slot = root_[address >> kLeafShift];
+  Leaf* leaf = root_slot.load(std::memory_order_acquire);
+  if (!leaf) {
+    Leaf* new_leaf = new Leaf();
+    if (root_slot.compare_exchange_strong(leaf, new_leaf,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire)) {
+      leaf = new_leaf;
+    } else {
+      // Another thread published one first, leaf now holds it.
+      delete new_leaf;
+    }
+  }
+  return &leaf->slots[(address & ((1u << kLeafShift) - 1)) >> 2];
 }
 
 Entry* EntryTable::Get(uint32_t address) {
-  auto global_lock = global_critical_region_.Acquire();
-  uint32_t idx = map_.IndexForKey(address);
-  if (idx == map_.size() || *map_.KeyAt(idx) != address) {
+  if (address & 3) {
+    return nullptr;
+  }
+  auto slot = LookupSlot(address);
+  if (!slot) {
     return nullptr;
   }
-  Entry* entry = *map_.ValueAt(idx);
+  Entry* entry = slot->load(std::memory_order_acquire);
   if (entry) {
     // TODO(benvanik): wait if needed?
     if (entry->status != Entry::STATUS_READY) {
@@ -42,63 +75,74 @@ Entry* EntryTable::Get(uint32_t address) {
 }
 
 Entry::Status EntryTable::GetOrCreate(uint32_t address, Entry** out_entry) {
-  // TODO(benvanik): replace with a map with wait-free for find.
-  // https://github.com/facebook/folly/blob/master/folly/AtomicHashMap.h
-
-  auto global_lock = global_critical_region_.Acquire();
-
-  uint32_t idx = map_.IndexForKey(address);
+  if (address & 3) {
+    // Not a valid instruction address, nothing can live there.
+    *out_entry = nullptr;
+    return Entry::STATUS_FAILED;
+  }
 
-  Entry* entry = idx != map_.size() && *map_.KeyAt(idx) == address
-                     ? *map_.ValueAt(idx)
-                     : nullptr;
-  Entry::Status status;
-  if (entry) {
-    // If we aren't ready yet spin and wait.
-    if (entry->status == Entry::STATUS_COMPILING) {
-      // chrispy: i think this is dead code, if we are compiling we're holding
-      // the global lock, arent we? so we wouldnt be executing here
-      // Still compiling, so spin.
-      do {
-        global_lock.unlock();
-        // TODO(benvanik): sleep for less time?
-        xe::threading::Sleep(std::chrono::microseconds(10));
-        global_lock.lock();
-      } while (entry->status == Entry::STATUS_COMPILING);
+  auto slot = LookupOrCreateSlot(address);
+  Entry* entry = slot->load(std::memory_order_acquire);
+  if (!entry) {
+    // Create and return for initialization.
+    Entry* new_entry = new Entry();
+    new_entry->address = address;
+    new_entry->end_address = 0;
+    new_entry->status = Entry::STATUS_COMPILING;
+    new_entry->function = 0;
+    if (slot->compare_exchange_strong(entry, new_entry,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+      {
+        std::lock_guard<xe_mutex> lock(entries_mutex_);
+        entries_.push_back(new_entry);
+      }
+      *out_entry = new_entry;
+      return Entry::STATUS_NEW;
     }
+    // Lost the race, entry now holds the winner.
+    delete new_entry;
+  }
+
+  // If we aren't ready yet spin and wait.
+  Entry::Status status = entry->status;
+  while (status == Entry::STATUS_COMPILING) {
+    // TODO(benvanik): sleep for less time?
+    xe::threading::Sleep(std::chrono::microseconds(10));
     status = entry->status;
-  } else {
-    // Create and return for initialization.
-    entry = new Entry();
-    entry->address = address;
-    entry->end_address = 0;
-    entry->status = Entry::STATUS_COMPILING;
-    entry->function = 0;
-    map_.InsertAt(address, entry, idx);
-    // map_[address] = entry;
-    status = Entry::STATUS_NEW;
-  }
-  global_lock.unlock();
+  }
   *out_entry = entry;
   return status;
 }
 
 void EntryTable::Delete(uint32_t address) {
-  auto global_lock = global_critical_region_.Acquire();
-  // doesnt this leak memory by not deleting the entry?
-  uint32_t idx = map_.IndexForKey(address);
-  if (idx != map_.size() && *map_.KeyAt(idx) == address) {
-    map_.EraseAt(idx);
+  if (address & 3) {
+    return;
+  }
+  auto slot = LookupSlot(address);
+  if (!slot) {
+    return;
+  }
+  Entry* entry = slot->exchange(nullptr, std::memory_order_acq_rel);
+  if (!entry) {
+    return;
+  }
+  std::lock_guard<xe_mutex> lock(entries_mutex_);
+  auto it = std::find(entries_.begin(), entries_.end(), entry);
+  if (it != entries_.end()) {
+    *it = entries_.back();
+    entries_.pop_back();
   }
+  retired_entries_.push_back(entry);
 }
 
 std::vector<Function*> EntryTable::FindWithAddress(uint32_t address) {
-  auto global_lock = global_critical_region_.Acquire();
+  std::lock_guard<xe_mutex> lock(entries_mutex_);
   std::vector<Function*> fns;
-  for (auto& it : map_.Values()) {
-    Entry* entry = it;
-    if (address >= entry->address && address <= entry->end_address) {
-      if (entry->status == Entry::STATUS_READY) {
+  for (Entry* entry : entries_) {
+    // end_address is only stable once the entry is ready.
+    if (entry->status == Entry::STATUS_READY) {
+      if (address >= entry->address && address <= entry->end_address) {
         fns.push_back(entry->function);
       }
     }
@@ -10,11 +10,12 @@
 #ifndef XENIA_CPU_ENTRY_TABLE_H_
 #define XENIA_CPU_ENTRY_TABLE_H_
 
+#include <atomic>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
 #include "xenia/base/mutex.h"
-#include "xenia/base/split_map.h"
 namespace xe {
 namespace cpu {
 
@@ -30,10 +31,16 @@ typedef struct Entry_t {
 
   uint32_t address;
   uint32_t end_address;
-  Status status;
+  // function and end_address must be set before status becomes READY, readers
+  // don't take a lock.
+  std::atomic<Status> status;
   Function* function;
 } Entry;
 
+// Maps guest function addresses to entries. Lookups are wait-free: the table
+// is a two-level radix tree over the 32-bit guest address space with atomic
+// slots, so only publishing a new leaf or entry uses compare-exchange and
+// only the all-entries list used for range queries takes a lock.
 class EntryTable {
  public:
   EntryTable();
@@ -46,10 +53,24 @@ class EntryTable {
   std::vector<Function*> FindWithAddress(uint32_t address);
 
  private:
-  xe::global_critical_region global_critical_region_;
-  // TODO(benvanik): replace with a better data structure.
-  xe::split_map<uint32_t, Entry*> map_;
-  // std::unordered_map<uint32_t, Entry*> map_;
+  // Each leaf covers 64 KiB of guest address space, one slot per instruction.
+  static constexpr uint32_t kLeafShift = 16;
+  static constexpr uint32_t kLeafSlotCount = (1u << kLeafShift) >> 2;
+  static constexpr uint32_t kRootSlotCount = 1u << (32 - kLeafShift);
+  struct Leaf {
+    std::atomic<Entry*> slots[kLeafSlotCount] = {};
+  };
+
+  std::atomic<Entry*>* LookupSlot(uint32_t address) const;
+  std::atomic<Entry*>* LookupOrCreateSlot(uint32_t address);
+
+  std::unique_ptr<std::atomic<Leaf*>[]> root_;
+
+  xe_mutex entries_mutex_;
+  std::vector<Entry*> entries_;
+  // Deleted entries may still be referenced by a concurrent lookup, they're
+  // freed with the table.
+  std::vector<Entry*> retired_entries_;
 };
 
 }  // namespace cpu
@@ -137,7 +137,11 @@ bool GuestFunction::Call(ThreadState* thread_state, uint32_t return_address) {
     ThreadState::Bind(thread_state);
   }
 
-  bool result = CallImpl(thread_state, return_address);
+  // Entered through the optimized recompile once there is one.
+  GuestFunction* optimized_function = this->optimized_function();
+  bool result = optimized_function
+                    ? optimized_function->CallImpl(thread_state, return_address)
+                    : CallImpl(thread_state, return_address);
 
   if (original_thread_state != thread_state) {
     ThreadState::Bind(original_thread_state);
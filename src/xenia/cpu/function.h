@@ -10,6 +10,7 @@
 #ifndef XENIA_CPU_FUNCTION_H_
 #define XENIA_CPU_FUNCTION_H_
 
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -114,10 +115,23 @@ class BuiltinFunction : public Function {
   void* arg1_ = nullptr;
 };
 
+enum class CompileTier : uint8_t {
+  // Cheap pipeline, the machine code counts its entries to find hot functions.
+  kBaseline,
+  // Full optimization pipeline.
+  kOptimized,
+};
+
 class GuestFunction : public Function {
  public:
   typedef void (*ExternHandler)(ppc::PPCContext* ppc_context,
                                 kernel::KernelState* kernel_state);
+  // Entry count of a block of baseline machine code, keyed by the guest
+  // address of the first instruction in the block.
+  struct BlockCounter {
+    uint32_t guest_address;
+    uint32_t count;
+  };
 
   GuestFunction(Module* module, uint32_t address);
   ~GuestFunction() override;
@@ -137,6 +151,50 @@ class GuestFunction : public Function {
   FunctionTraceData& trace_data() { return trace_data_; }
   std::vector<SourceMapEntry>& source_map() { return source_map_; }
 
+  // Tier of the machine code of this function object, or the one requested
+  // from the translator while it's being compiled.
+  CompileTier tier() const { return tier_.load(std::memory_order_acquire); }
+  void set_tier(CompileTier tier) {
+    tier_.store(tier, std::memory_order_release);
+  }
+  // Claims the optimized recompile of a baseline function, true only for the
+  // first caller.
+  bool ClaimTierUp() {
+    return !tier_up_claimed_.exchange(true, std::memory_order_acq_rel);
+  }
+  // The optimized recompile of a baseline function, or null until it's
+  // published. It has its own machine code and source map, the baseline ones
+  // stay valid for the threads still running the baseline code.
+  GuestFunction* optimized_function() const {
+    return optimized_function_.load(std::memory_order_acquire);
+  }
+  void set_optimized_function(std::unique_ptr<GuestFunction> function) {
+    optimized_function_owner_ = std::move(function);
+    optimized_function_.store(optimized_function_owner_.get(),
+                              std::memory_order_release);
+  }
+
+  // Block entry counters of the baseline machine code, with
+  // --profile_guided_block_layout. Placed in the code cache and updated by the
+  // running code, so the counts are only approximate. The optimized recompile
+  // is handed the baseline counters to lay its blocks out by.
+  const BlockCounter* block_counters() const { return block_counters_; }
+  uint32_t block_counter_count() const { return block_counter_count_; }
+  void set_block_counters(const BlockCounter* counters, uint32_t count) {
+    block_counters_ = counters;
+    block_counter_count_ = count;
+  }
+
+  // Entry addresses of the guest functions the translator inlined into this
+  // one. Their code is part of this function's machine code, so anything that
+  // invalidates one of them has to invalidate this function as well.
+  const std::vector<uint32_t>& inlined_callees() const {
+    return inlined_callees_;
+  }
+  void set_inlined_callees(std::vector<uint32_t> callees) {
+    inlined_callees_ = std::move(callees);
+  }
+
   ExternHandler extern_handler() const { return extern_handler_; }
   Export* export_data() const { return export_data_; }
   void SetupExtern(ExternHandler handler, Export* export_data = nullptr);
@@ -160,6 +218,13 @@ class GuestFunction : public Function {
   std::vector<SourceMapEntry> source_map_;
   ExternHandler extern_handler_ = nullptr;
   Export* export_data_ = nullptr;
+  std::atomic<CompileTier> tier_ = CompileTier::kBaseline;
+  std::atomic<bool> tier_up_claimed_ = false;
+  std::unique_ptr<GuestFunction> optimized_function_owner_;
+  std::atomic<GuestFunction*> optimized_function_ = nullptr;
+  const BlockCounter* block_counters_ = nullptr;
+  uint32_t block_counter_count_ = 0;
+  std::vector<uint32_t> inlined_callees_;
 };
 
 }  // namespace cpu
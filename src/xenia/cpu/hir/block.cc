@@ -11,11 +11,42 @@
 
 #include "xenia/base/assert.h"
 #include "xenia/cpu/hir/instr.h"
+#include "xenia/cpu/hir/label.h"
+#include "xenia/cpu/hir/opcodes.h"
 
 namespace xe {
 namespace cpu {
 namespace hir {
 
+void Block::GetSuccessors(std::vector<Block*>* out_successors) const {
+  // Blocks merged by ControlFlowSimplificationPass keep the conditional
+  // branches of the blocks they were made from.
+  for (Instr* instr = instr_head; instr; instr = instr->next) {
+    if (instr->opcode == &OPCODE_BRANCH_TRUE_info ||
+        instr->opcode == &OPCODE_BRANCH_FALSE_info) {
+      out_successors->push_back(instr->src2.label->block);
+    }
+  }
+  bool falls_through = true;
+  for (Instr* instr = instr_tail;
+       instr && (instr->opcode->flags & OPCODE_FLAG_BRANCH);
+       instr = instr->prev) {
+    if (instr->opcode == &OPCODE_BRANCH_info) {
+      out_successors->push_back(instr->src1.label->block);
+      falls_through = false;
+    } else if (instr->opcode == &OPCODE_RETURN_info) {
+      falls_through = false;
+    } else if ((instr->opcode == &OPCODE_CALL_info ||
+                instr->opcode == &OPCODE_CALL_INDIRECT_info) &&
+               (instr->flags & CALL_TAIL)) {
+      falls_through = false;
+    }
+  }
+  if (falls_through && next) {
+    out_successors->push_back(next);
+  }
+}
+
 void Block::AssertNoCycles() {
   Instr* hare = instr_head;
   Instr* tortoise = instr_head;
@@ -10,6 +10,8 @@
 #ifndef XENIA_CPU_HIR_BLOCK_H_
 #define XENIA_CPU_HIR_BLOCK_H_
 
+#include <vector>
+
 #include "xenia/base/arena.h"
 
 namespace llvm {
@@ -63,6 +65,13 @@ class Block {
 
   uint16_t ordinal;
 
+  // Appends the blocks control can continue to from this one, through its
+  // branches, conditional ones can also be in the middle of merged blocks, or
+  // by falling through to the next one.
+  // Unlike the CFG edges this is derived from the current instructions, so it
+  // stays valid after passes that rewrite branches. May contain duplicates.
+  void GetSuccessors(std::vector<Block*>* out_successors) const;
+
   void AssertNoCycles();
 };
 
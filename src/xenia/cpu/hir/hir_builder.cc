@@ -670,6 +670,36 @@ void HIRBuilder::MergeAdjacentBlocks(Block* left, Block* right) {
   }
 }
 
+void HIRBuilder::ReorderBlocks(const std::vector<Block*>& blocks) {
+  Block* prev = nullptr;
+  for (Block* block : blocks) {
+    block->prev = prev;
+    if (prev) {
+      prev->next = block;
+    }
+    prev = block;
+  }
+  if (prev) {
+    prev->next = nullptr;
+  }
+  block_head_ = blocks.empty() ? nullptr : blocks.front();
+  block_tail_ = prev;
+}
+
+void HIRBuilder::AppendBranch(Block* block, Block* target) {
+  Block* old_current_block = current_block_;
+  current_block_ = block;
+  Branch(target);
+  current_block_ = old_current_block;
+}
+
+void HIRBuilder::AppendReturn(Block* block) {
+  Block* old_current_block = current_block_;
+  current_block_ = block;
+  Return();
+  current_block_ = old_current_block;
+}
+
 Block* HIRBuilder::AppendBlock() {
   Block* block = arena_->Alloc<Block>();
   block->ordinal = UINT16_MAX;
@@ -81,6 +81,13 @@ class HIRBuilder {
   void RemoveEdge(Edge* edge);
   void RemoveBlock(Block* block);
   void MergeAdjacentBlocks(Block* left, Block* right);
+  // Relinks the blocks in the given order, which must contain every block
+  // once. Control flow falling through from one block to the next is left
+  // as is, callers have to make it explicit where the order changes.
+  void ReorderBlocks(const std::vector<Block*>& blocks);
+  // Append to the end of an existing block after the HIR has been built.
+  void AppendBranch(Block* block, Block* target);
+  void AppendReturn(Block* block);
 
   Instr* AllocateInstruction();
 
@@ -38,6 +38,24 @@ int InstrEmit_branch(PPCHIRBuilder& f, const char* src, uint64_t cia,
                      bool expect_true = true, bool nia_is_lr = false) {
   uint32_t call_flags = 0;
 
+  if (!lk && nia_is_lr && f.inline_return_label()) {
+    // Return from an inlined callee, which never modifies LR.
+    if (cond) {
+      if (expect_true) {
+        f.BranchTrue(cond, f.inline_return_label());
+      } else {
+        f.BranchFalse(cond, f.inline_return_label());
+      }
+    } else {
+      f.Branch(f.inline_return_label());
+    }
+    return 0;
+  }
+  if (!cond && nia->IsConstant() &&
+      f.TryEmitInlinedCallee(uint32_t(cia), uint32_t(nia->AsUint64()), lk)) {
+    return 0;
+  }
+
   // TODO(benvanik): this may be wrong and overwrite LRs when not desired!
   // The docs say always, though...
   // Note that we do the update before we branch/call as we need it to
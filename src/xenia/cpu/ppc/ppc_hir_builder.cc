@@ -10,6 +10,7 @@
 #include "xenia/cpu/ppc/ppc_hir_builder.h"
 
 #include <stddef.h>
+#include <algorithm>
 #include <cstring>
 
 #include "third_party/fmt/include/fmt/format.h"
@@ -78,6 +79,9 @@ void PPCHIRBuilder::Reset() {
   instr_count_ = 0;
   instr_offset_list_ = NULL;
   label_list_ = NULL;
+  inline_depth_ = 0;
+  inline_return_label_ = nullptr;
+  inlined_callees_.clear();
   with_debug_info_ = false;
   HIRBuilder::Reset();
 }
@@ -85,8 +89,6 @@ void PPCHIRBuilder::Reset() {
 bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
   SCOPE_profile_cpu_f("cpu");
 
-  Memory* memory = frontend_->memory();
-
   function_ = function;
   start_address_ = function_->address();
   // chrispy: i've seen this one happen, not sure why but i think from trying to
@@ -117,8 +119,18 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
   // Always mark entry with label.
   label_list_[0] = NewLabel();
 
-  uint32_t start_address = function_->address();
-  uint32_t end_address = function_->end_address();
+  EmitInstructions(function_->address(), function_->end_address());
+
+  if (false) {
+    DumpAllOpcodeCounts();
+  }
+
+  return Finalize();
+}
+
+void PPCHIRBuilder::EmitInstructions(uint32_t start_address,
+                                     uint32_t end_address) {
+  Memory* memory = frontend_->memory();
   for (uint32_t address = start_address, offset = 0; address <= end_address;
        address += 4, offset++) {
     trace_info_.dest_count = 0;
@@ -191,12 +203,6 @@ bool PPCHIRBuilder::Emit(GuestFunction* function, uint32_t flags) {
       }
     }
   }
-
-  if (false) {
-    DumpAllOpcodeCounts();
-  }
-
-  return Finalize();
 }
 
 void PPCHIRBuilder::MaybeBreakOnInstruction(uint32_t address) {
@@ -294,6 +300,164 @@ Label* PPCHIRBuilder::LookupLabel(uint32_t address) {
   return label;
 }
 
+bool PPCHIRBuilder::TryEmitInlinedCallee(uint32_t cia, uint32_t callee_address,
+                                         bool lk) {
+  if (!cvars::inline_guest_functions) {
+    return false;
+  }
+  // Branches within the range being emitted are local jumps.
+  if (callee_address == function_->address() ||
+      (callee_address >= start_address_ &&
+       (callee_address - start_address_) / 4 < instr_count_)) {
+    return false;
+  }
+  // Returns of a call must land after it, and a tail branch from an inlined
+  // call's callee is still returning there.
+  bool preserve_lr = lk || inline_return_label_;
+  uint32_t end_address;
+  if (!ScanInlinedCallee(callee_address, preserve_lr, inline_depth_ + 1,
+                         &end_address)) {
+    return false;
+  }
+  if (std::find(inlined_callees_.begin(), inlined_callees_.end(),
+                callee_address) == inlined_callees_.end()) {
+    inlined_callees_.push_back(callee_address);
+  }
+
+  Label* return_label = inline_return_label_;
+  if (lk) {
+    // The callee may read LR, but as it never writes it, its returns always
+    // go to the next instruction.
+    StoreLR(LoadConstantUint64(cia + 4));
+    return_label = NewLabel();
+  }
+  if (with_debug_info_) {
+    CommentFormat("inlined {:08X}-{:08X}", callee_address, end_address);
+  }
+
+  uint64_t caller_start_address = start_address_;
+  uint64_t caller_instr_count = instr_count_;
+  Instr** caller_instr_offset_list = instr_offset_list_;
+  Label** caller_label_list = label_list_;
+  Label* caller_return_label = inline_return_label_;
+
+  start_address_ = callee_address;
+  instr_count_ = (end_address - callee_address) / 4 + 1;
+  size_t list_size = instr_count_ * sizeof(void*);
+  instr_offset_list_ = (Instr**)arena_->Alloc(list_size, alignof(void*));
+  label_list_ = (Label**)arena_->Alloc(list_size, alignof(void*));
+  std::memset(instr_offset_list_, 0, list_size);
+  std::memset(label_list_, 0, list_size);
+  inline_return_label_ = return_label;
+  ++inline_depth_;
+
+  EmitInstructions(callee_address, end_address);
+
+  --inline_depth_;
+  inline_return_label_ = caller_return_label;
+  label_list_ = caller_label_list;
+  instr_offset_list_ = caller_instr_offset_list;
+  instr_count_ = caller_instr_count;
+  start_address_ = caller_start_address;
+
+  if (lk) {
+    MarkLabel(return_label);
+  }
+  return true;
+}
+
+bool PPCHIRBuilder::ScanInlinedCallee(uint32_t address, bool preserve_lr,
+                                      uint32_t depth,
+                                      uint32_t* out_end_address) {
+  if (address == function_->address() ||
+      depth > uint32_t(std::max(cvars::inline_max_depth, 0)) ||
+      cvars::inline_max_instructions <= 0) {
+    return false;
+  }
+  // Only plain guest code - not kernel imports or anything with a host
+  // implementation.
+  Module* module = function_->module();
+  if (!module->ContainsAddress(address)) {
+    return false;
+  }
+  Function* callee = LookupFunction(address);
+  if (!callee || !callee->is_guest() ||
+      callee->behavior() == Function::Behavior::kExtern ||
+      static_cast<GuestFunction*>(callee)->extern_handler()) {
+    return false;
+  }
+
+  // Walk forward like the scanner does until an unconditional return nothing
+  // branches past. All branches must stay within the callee, other than a tail
+  // branch at the end, and nothing may call or jump through CTR, so the callee
+  // never needs a real frame on the host stack.
+  Memory* memory = frontend_->memory();
+  uint32_t max_address = address + (cvars::inline_max_instructions - 1) * 4;
+  uint32_t furthest_target = address;
+  for (uint32_t i_address = address; i_address <= max_address;
+       i_address += 4) {
+    uint32_t code =
+        xe::load_and_swap<uint32_t>(memory->TranslateVirtual(i_address));
+    if (!code) {
+      return false;
+    }
+    PPCDecodeData d;
+    d.address = i_address;
+    d.code = code;
+    switch (LookupOpcode(code)) {
+      case PPCOpcode::kInvalid:
+      case PPCOpcode::sc:
+      case PPCOpcode::bcctrx:
+        return false;
+      case PPCOpcode::mtspr:
+        if (preserve_lr &&
+            (((d.XFX.SPR() & 0x1F) << 5) | ((d.XFX.SPR() >> 5) & 0x1F)) == 8) {
+          return false;
+        }
+        break;
+      case PPCOpcode::bcx: {
+        uint32_t target = d.B.ADDR();
+        if (d.B.LK() || target < address || target > max_address) {
+          return false;
+        }
+        furthest_target = std::max(furthest_target, target);
+      } break;
+      case PPCOpcode::bx: {
+        uint32_t target = d.I.ADDR();
+        if (d.I.LK()) {
+          return false;
+        }
+        if (target >= address && target <= max_address) {
+          furthest_target = std::max(furthest_target, target);
+          break;
+        }
+        // Tail branch, which itself needs to be inlined if it's going to
+        // return to an inlined call site.
+        uint32_t tail_end_address;
+        if (furthest_target > i_address ||
+            (preserve_lr && !ScanInlinedCallee(target, true, depth + 1,
+                                               &tail_end_address))) {
+          return false;
+        }
+        *out_end_address = i_address;
+        return true;
+      }
+      case PPCOpcode::bclrx:
+        if (d.XL.LK()) {
+          return false;
+        }
+        if (code == 0x4E800020 && furthest_target <= i_address) {
+          *out_end_address = i_address;
+          return true;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return false;
+}
+
 // Value* PPCHIRBuilder::LoadXER() {
 //}
 //
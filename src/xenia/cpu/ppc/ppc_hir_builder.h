@@ -44,6 +44,18 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   Function* LookupFunction(uint32_t address);
   Label* LookupLabel(uint32_t address);
 
+  // Splices the callee of an unconditional direct call or tail branch at cia
+  // into the function being emitted if --inline_guest_functions allows it.
+  // Returns false if the branch has to be emitted normally.
+  bool TryEmitInlinedCallee(uint32_t cia, uint32_t callee_address, bool lk);
+  // Label returns (blr) from the innermost callee inlined for a call branch
+  // to, or nullptr if not within an inlined call.
+  Label* inline_return_label() const { return inline_return_label_; }
+  // Entry addresses of the callees inlined into the last emitted function.
+  const std::vector<uint32_t>& inlined_callees() const {
+    return inlined_callees_;
+  }
+
   Value* LoadLR();
   void StoreLR(Value* value);
   Value* LoadCTR();
@@ -85,6 +97,9 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   void SetReturnAddress(Value* value);
 
  private:
+  void EmitInstructions(uint32_t start_address, uint32_t end_address);
+  bool ScanInlinedCallee(uint32_t address, bool preserve_lr, uint32_t depth,
+                         uint32_t* out_end_address);
   void MaybeBreakOnInstruction(uint32_t address);
   void AnnotateLabel(uint32_t address, Label* label);
 
@@ -100,6 +115,10 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   uint64_t instr_count_;
   Instr** instr_offset_list_;
   Label** label_list_;
+  // The ones above are for the innermost inlined callee while it's emitted.
+  uint32_t inline_depth_;
+  Label* inline_return_label_;
+  std::vector<uint32_t> inlined_callees_;
 
   // Reset each instruction.
   struct {
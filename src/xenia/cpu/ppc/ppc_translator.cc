@@ -64,7 +64,8 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
       compiler_->AddPass(std::make_unique<passes::ValidationPass>());
     }
 
-    compiler_->AddPass(std::make_unique<passes::ContextPromotionPass>());
+    compiler_->AddPass(std::make_unique<passes::ContextPromotionPass>(
+        cvars::global_register_allocation));
 
     if (validate) {
       compiler_->AddPass(std::make_unique<passes::ValidationPass>());
@@ -96,30 +97,72 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
   if (validate) {
     compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   }
-  // compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
-  // if (validate)
-  // compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
+  if (validate) {
+    compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  }
+  // Reuses equivalent values, leaving the duplicates to DCE.
+  compiler_->AddPass(std::make_unique<passes::ValueReductionPass>());
+  if (validate) {
+    compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  }
   compiler_->AddPass(std::make_unique<passes::DeadCodeEliminationPass>());
   if (validate) {
     compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   }
-
-  //// Removes all unneeded variables. Try not to add new ones after this.
-  // compiler_->AddPass(new passes::ValueReductionPass());
-  // if (validate) compiler_->AddPass(new passes::ValidationPass());
+  if (cvars::profile_guided_block_layout) {
+    auto block_layout_pass = std::make_unique<passes::BlockLayoutPass>();
+    block_layout_pass_ = block_layout_pass.get();
+    compiler_->AddPass(std::move(block_layout_pass));
+    if (validate) {
+      compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+    }
+  }
 
   // Register allocation for the target backend.
   // Will modify the HIR to add loads/stores.
   // This should be the last pass before finalization, as after this all
   // registers are assigned and ready to be emitted.
   compiler_->AddPass(std::make_unique<passes::RegisterAllocationPass>(
-      backend->machine_info()));
+      backend->machine_info(), cvars::global_register_allocation));
   if (validate) {
     compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   }
 
   // Must come last. The HIR is not really HIR after this.
   compiler_->AddPass(std::make_unique<passes::FinalizationPass>());
+
+  // Baseline tier: no iterating to a fixed point and none of the memory
+  // combining, just enough cleanup to keep the register allocator's job small.
+  // Functions that turn out to be hot are recompiled with compiler_.
+  if (cvars::tiered_compilation &&
+      backend->machine_info()->supports_tiered_compilation) {
+    baseline_compiler_.reset(new Compiler(frontend->processor()));
+    baseline_compiler_->AddPass(
+        std::make_unique<passes::ControlFlowAnalysisPass>());
+    baseline_compiler_->AddPass(
+        std::make_unique<passes::ControlFlowSimplificationPass>());
+    if (!cvars::disable_context_promotion) {
+      baseline_compiler_->AddPass(
+          std::make_unique<passes::ContextPromotionPass>());
+      if (validate) {
+        baseline_compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+      }
+    }
+    baseline_compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
+    baseline_compiler_->AddPass(
+        std::make_unique<passes::DeadCodeEliminationPass>());
+    if (validate) {
+      baseline_compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+    }
+    baseline_compiler_->AddPass(
+        std::make_unique<passes::RegisterAllocationPass>(
+            backend->machine_info()));
+    if (validate) {
+      baseline_compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+    }
+    baseline_compiler_->AddPass(std::make_unique<passes::FinalizationPass>());
+  }
 }
 
 PPCTranslator::~PPCTranslator() = default;
@@ -184,6 +227,7 @@ bool PPCTranslator::Translate(GuestFunction* function,
   // Reset() all caching when we leave.
   xe::make_reset_scope(builder_);
   xe::make_reset_scope(compiler_);
+  xe::make_reset_scope(baseline_compiler_);
   xe::make_reset_scope(assembler_);
   xe::make_reset_scope(&string_buffer_);
 
@@ -206,6 +250,20 @@ bool PPCTranslator::Translate(GuestFunction* function,
   std::unique_ptr<FunctionDebugInfo> debug_info;
   if (debug_info_flags) {
     debug_info.reset(new FunctionDebugInfo());
+  } else if (frontend_->processor()->backend()->LoadCachedFunction(function)) {
+    // Machine code from a previous session, nothing to translate.
+    function->set_tier(CompileTier::kOptimized);
+    return true;
+  }
+
+  // Debug builds of functions need the full pipeline so what's shown matches
+  // what runs, and they'd lose their debug info on a tier up anyway.
+  Compiler* compiler = compiler_.get();
+  if (baseline_compiler_ && !debug_info_flags &&
+      function->tier() == CompileTier::kBaseline) {
+    compiler = baseline_compiler_.get();
+  } else {
+    function->set_tier(CompileTier::kOptimized);
   }
 
   // Scan the function to find its extents and gather debug data.
@@ -249,6 +307,7 @@ bool PPCTranslator::Translate(GuestFunction* function,
   if (!builder_->Emit(function, emit_flags)) {
     return false;
   }
+  function->set_inlined_callees(builder_->inlined_callees());
 
   // Stash raw HIR.
   if (debug_info_flags & DebugInfoFlags::kDebugInfoDisasmRawHir) {
@@ -258,7 +317,11 @@ bool PPCTranslator::Translate(GuestFunction* function,
   }
 
   // Compile/optimize/etc.
-  if (!compiler_->Compile(builder_.get())) {
+  if (block_layout_pass_) {
+    block_layout_pass_->set_block_counters(function->block_counters(),
+                                           function->block_counter_count());
+  }
+  if (!compiler->Compile(builder_.get())) {
     return false;
   }
 
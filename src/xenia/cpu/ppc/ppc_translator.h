@@ -19,6 +19,11 @@
 
 namespace xe {
 namespace cpu {
+namespace compiler {
+namespace passes {
+class BlockLayoutPass;
+}  // namespace passes
+}  // namespace compiler
 namespace ppc {
 
 class PPCFrontend;
@@ -41,6 +46,11 @@ class PPCTranslator {
   std::unique_ptr<PPCScanner> scanner_;
   std::unique_ptr<PPCHIRBuilder> builder_;
   std::unique_ptr<compiler::Compiler> compiler_;
+  // Owned by compiler_, null without --profile_guided_block_layout.
+  compiler::passes::BlockLayoutPass* block_layout_pass_ = nullptr;
+  // Cheap pipeline for the first translation of a function with
+  // --tiered_compilation, null if the backend doesn't support it.
+  std::unique_ptr<compiler::Compiler> baseline_compiler_;
   std::unique_ptr<backend::Assembler> assembler_;
 
   StringBuffer string_buffer_;
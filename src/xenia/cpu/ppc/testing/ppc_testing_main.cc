@@ -7,6 +7,7 @@
  ******************************************************************************
  */
 
+#include "xenia/base/byte_order.h"
 #include "xenia/base/console_app_main.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/filesystem.h"
@@ -21,8 +22,10 @@
 #include "xenia/cpu/processor.h"
 #include "xenia/cpu/raw_module.h"
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cinttypes>
 #include <mutex>
 #include <thread>
 #include <unordered_set>
@@ -47,6 +50,17 @@ DEFINE_path(test_bin_path, "src/xenia/cpu/ppc/testing/bin/",
 DEFINE_path(test_skip_file, "src/xenia/cpu/ppc/testing/skip.txt",
             "File containing test case names to skip (one per line).", "Other");
 DEFINE_transient_string(test_name, "", "Test suite name.", "General");
+DEFINE_uint32(resolve_benchmark_threads, 0,
+              "Instead of running tests, resolve guest functions from this "
+              "many host threads at once and report the throughput.",
+              "Other");
+DEFINE_uint32(resolve_benchmark_functions, 4096,
+              "Number of guest functions used by the resolve benchmark.",
+              "Other");
+DEFINE_uint32(resolve_benchmark_iterations, 200,
+              "Passes over all functions each thread makes in the warm phase "
+              "of the resolve benchmark.",
+              "Other");
 
 namespace xe {
 namespace cpu {
@@ -225,6 +239,29 @@ class TestSuite {
   }
 };
 
+std::unique_ptr<xe::cpu::backend::Backend> CreateBackend() {
+  std::unique_ptr<xe::cpu::backend::Backend> backend;
+#if XE_ARCH_AMD64
+  if (cvars::cpu == "x64") {
+    backend.reset(new xe::cpu::backend::x64::X64Backend());
+  }
+#elif XE_ARCH_ARM64
+  if (cvars::cpu == "a64") {
+    backend.reset(new xe::cpu::backend::a64::A64Backend());
+  }
+#endif  // XE_ARCH
+  if (cvars::cpu == "any") {
+    if (!backend) {
+#if XE_ARCH_AMD64
+      backend.reset(new xe::cpu::backend::x64::X64Backend());
+#elif XE_ARCH_ARM64
+      backend.reset(new xe::cpu::backend::a64::A64Backend());
+#endif  // XE_ARCH
+    }
+  }
+  return backend;
+}
+
 class TestRunner {
  public:
   TestRunner() : memory_size_(64_MiB) {
@@ -246,31 +283,9 @@ class TestRunner {
     // Reset memory.
     memory_->Reset();
 
-    std::unique_ptr<xe::cpu::backend::Backend> backend;
-    if (!backend) {
-#if XE_ARCH_AMD64
-      if (cvars::cpu == "x64") {
-        backend.reset(new xe::cpu::backend::x64::X64Backend());
-      }
-#elif XE_ARCH_ARM64
-      if (cvars::cpu == "a64") {
-        backend.reset(new xe::cpu::backend::a64::A64Backend());
-      }
-#endif  // XE_ARCH
-      if (cvars::cpu == "any") {
-        if (!backend) {
-#if XE_ARCH_AMD64
-          backend.reset(new xe::cpu::backend::x64::X64Backend());
-#elif XE_ARCH_ARM64
-          backend.reset(new xe::cpu::backend::a64::A64Backend());
-#endif  // XE_ARCH
-        }
-      }
-    }
-
     // Setup a fresh processor.
     processor_.reset(new Processor(memory_.get(), nullptr));
-    processor_->Setup(std::move(backend));
+    processor_->Setup(CreateBackend());
     processor_->set_debug_info_flags(DebugInfoFlags::kDebugInfoAll);
 
     // Load the binary module.
@@ -870,7 +885,98 @@ bool RunTests(const std::vector<std::string>& test_names) {
   return failed_count ? false : true;
 }
 
+// Measures contention on function resolution: every thread resolves the same
+// set of functions, first while they're still being created (cold) and then
+// once they all exist (warm, lookups only).
+bool RunResolveBenchmark(uint32_t thread_count) {
+  const uint32_t function_count =
+      std::max(cvars::resolve_benchmark_functions, uint32_t(1));
+  const uint32_t iteration_count = cvars::resolve_benchmark_iterations;
+
+  auto memory = std::make_unique<Memory>();
+  memory->Initialize();
+  auto processor = std::make_unique<Processor>(memory.get(), nullptr);
+  if (!processor->Setup(CreateBackend())) {
+    XELOGE("Unable to set up the processor");
+    return false;
+  }
+
+  // One blr per function.
+  const uint32_t code_size = function_count * 4;
+  if (!memory->LookupHeap(START_ADDRESS)
+           ->AllocFixed(START_ADDRESS, code_size, 0,
+                        kMemoryAllocationReserve | kMemoryAllocationCommit,
+                        kMemoryProtectRead | kMemoryProtectWrite)) {
+    XELOGE("Unable to allocate guest code");
+    return false;
+  }
+  auto code = memory->TranslateVirtual<uint32_t*>(START_ADDRESS);
+  for (uint32_t i = 0; i < function_count; ++i) {
+    xe::store_and_swap<uint32_t>(code + i, 0x4E800020);
+  }
+  auto module = std::make_unique<xe::cpu::RawModule>(processor.get());
+  module->set_name("resolve_benchmark");
+  module->set_executable(true);
+  module->SetAddressRange(START_ADDRESS, code_size);
+  processor->AddModule(std::move(module));
+
+  std::vector<std::atomic<Function*>> resolved(function_count);
+  std::atomic<uint32_t> mismatches{0};
+  auto run_phase = [&](const char* name, uint32_t passes) {
+    auto start_time = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < thread_count; ++t) {
+      threads.emplace_back([&, t]() {
+        for (uint32_t pass = 0; pass < passes; ++pass) {
+          // Stagger the starting point so threads collide on different
+          // functions rather than marching in lockstep.
+          for (uint32_t i = 0; i < function_count; ++i) {
+            uint32_t index =
+                (i + t * (function_count / thread_count)) % function_count;
+            Function* fn =
+                processor->ResolveFunction(START_ADDRESS + index * 4);
+            Function* expected = nullptr;
+            if (!fn ||
+                (!resolved[index].compare_exchange_strong(expected, fn) &&
+                 expected != fn)) {
+              mismatches.fetch_add(1, std::memory_order_relaxed);
+            }
+          }
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start_time)
+                       .count();
+    uint64_t resolve_count = uint64_t(thread_count) * passes * function_count;
+    fprintf(stderr, "%s: %" PRIu64 " resolves in %.3f ms, %.1f ns/resolve\n",
+            name, resolve_count, elapsed / 1000000.0,
+            resolve_count ? double(elapsed) / resolve_count : 0.0);
+  };
+
+  fprintf(stderr,
+          "Resolve benchmark: %u threads, %u functions, %u warm passes\n",
+          thread_count, function_count, iteration_count);
+  run_phase("Cold", 1);
+  run_phase("Warm", iteration_count);
+  fflush(stderr);
+
+  if (mismatches) {
+    XELOGE("{} resolves returned no function or a different one",
+           mismatches.load());
+    return false;
+  }
+  return true;
+}
+
 int main(const std::vector<std::string>& args) {
+  if (cvars::resolve_benchmark_threads) {
+    return RunResolveBenchmark(cvars::resolve_benchmark_threads) ? 0 : 1;
+  }
+
   std::vector<std::string> test_names;
   // Collect test names from all positional arguments.
   // argv[0] is the program name, skip it. Also skip --flag arguments
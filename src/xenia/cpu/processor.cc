@@ -53,6 +53,8 @@ DEFINE_path(trace_function_data_path, "", "File to write trace data to.",
 DEFINE_bool(break_on_start, false, "Break into the debugger on startup.",
             "CPU");
 
+DECLARE_bool(enable_early_precompilation);
+
 namespace xe {
 namespace kernel {
 class XThread;
@@ -90,6 +92,9 @@ Processor::Processor(xe::Memory* memory, ExportResolver* export_resolver)
     : memory_(memory), export_resolver_(export_resolver) {}
 
 Processor::~Processor() {
+  // Workers resolve through the modules and the backend.
+  compile_workers_.reset();
+
   {
     auto global_lock = global_critical_region_.Acquire();
     modules_.clear();
@@ -158,6 +163,8 @@ bool Processor::Setup(std::unique_ptr<backend::Backend> backend) {
         ChunkedMappedMemoryWriter::Open(functions_trace_path_, 32_MiB, true);
   }
 
+  compile_workers_ = CompileWorkerPool::Create(this);
+
   return true;
 }
 
@@ -189,6 +196,10 @@ void Processor::RemoveModule(const std::string_view name) {
                    });
 
   if (itr != modules_.cend()) {
+    // Nothing left to compile the queued candidates from.
+    if (compile_workers_) {
+      compile_workers_->RemoveRequests(itr->get());
+    }
     const std::vector<uint32_t> addressed_functions =
         (*itr)->GetAddressedFunctions();
 
@@ -251,6 +262,22 @@ std::vector<Function*> Processor::FindFunctionsWithAddress(uint32_t address) {
 
 void Processor::RemoveFunctionByAddress(uint32_t address) {
   entry_table_.Delete(address);
+  backend_->UnchainFunction(address);
+
+  // Callers that inlined the function would keep running their copy of it.
+  std::vector<uint32_t> callers;
+  {
+    auto global_lock = global_critical_region_.Acquire();
+    auto it = inlined_callers_.find(address);
+    if (it == inlined_callers_.end()) {
+      return;
+    }
+    callers = std::move(it->second);
+    inlined_callers_.erase(it);
+  }
+  for (uint32_t caller : callers) {
+    RemoveFunctionByAddress(caller);
+  }
 }
 
 Function* Processor::ResolveFunction(uint32_t address) {
@@ -285,6 +312,14 @@ Function* Processor::ResolveFunction(uint32_t address) {
     entry->function = function;
     entry->end_address = function->end_address();
     status = entry->status = Entry::STATUS_READY;
+
+    // A guest thread had to wait for this one, get its callees going before
+    // it reaches them.
+    if (cvars::enable_early_precompilation && compile_workers_ &&
+        function->is_guest() && !CompileWorkerPool::IsCurrentThreadWorker()) {
+      compile_workers_->EnqueueDirectCallees(
+          static_cast<GuestFunction*>(function));
+    }
   }
   if (status == Entry::STATUS_READY) {
     // Ready to use.
@@ -294,6 +329,58 @@ Function* Processor::ResolveFunction(uint32_t address) {
     return nullptr;
   }
 }
+
+void Processor::RequestTierUp(uint32_t address) {
+  if (compile_workers_) {
+    compile_workers_->EnqueueTierUp(address);
+  } else {
+    RecompileOptimized(address);
+  }
+}
+
+bool Processor::RecompileOptimized(uint32_t address) {
+  auto function = QueryFunction(address);
+  if (!function || !function->is_guest() ||
+      function->status() != Symbol::Status::kDefined) {
+    return false;
+  }
+  auto guest_function = static_cast<GuestFunction*>(function);
+  if (guest_function->tier() != CompileTier::kBaseline ||
+      !guest_function->ClaimTierUp()) {
+    return true;
+  }
+  // Compiled into a function object of its own, so the threads still running
+  // the baseline code, and the host PC lookups of their exceptions, keep using
+  // the baseline machine code and source map, which are never freed.
+  std::unique_ptr<GuestFunction> optimized_function =
+      backend_->CreateGuestFunction(guest_function->module(), address);
+  optimized_function->set_name(guest_function->name());
+  optimized_function->set_end_address(guest_function->end_address());
+  optimized_function->set_behavior(guest_function->behavior());
+  optimized_function->SetSaverest(guest_function->SaverestType(),
+                                  guest_function->IsRestore(),
+                                  uint8_t(guest_function->SaverestIndex()));
+  if (guest_function->behavior() == Function::Behavior::kExtern) {
+    optimized_function->SetupExtern(guest_function->extern_handler(),
+                                    guest_function->export_data());
+  }
+  optimized_function->set_tier(CompileTier::kOptimized);
+  // Profile of the baseline code, for the block layout pass.
+  optimized_function->set_block_counters(guest_function->block_counters(),
+                                         guest_function->block_counter_count());
+  // The backend publishes the new entry point through the indirection table,
+  // the entry and the symbol stay as they are.
+  if (!frontend_->DefineFunction(optimized_function.get(),
+                                 debug_info_flags_)) {
+    XELOGW("Failed to recompile hot function {:08X}, keeping baseline code",
+           address);
+    return false;
+  }
+  optimized_function->set_status(Symbol::Status::kDefined);
+  guest_function->set_optimized_function(std::move(optimized_function));
+  return true;
+}
+
 Module* Processor::LookupModule(uint32_t address) {
   auto global_lock = global_critical_region_.Acquire();
   // TODO(benvanik): sort by code address (if contiguous) so can bsearch.
@@ -471,6 +558,12 @@ uint8_t* Processor::AllocateFunctionTraceData(size_t size) {
 
 void Processor::OnFunctionDefined(Function* function) {
   auto global_lock = global_critical_region_.Acquire();
+  if (function->is_guest()) {
+    auto guest_function = static_cast<GuestFunction*>(function);
+    for (uint32_t callee : guest_function->inlined_callees()) {
+      inlined_callers_[callee].push_back(guest_function->address());
+    }
+  }
   for (auto breakpoint : breakpoints_) {
     if (breakpoint->address_type() == Breakpoint::AddressType::kGuest) {
       if (function->ContainsAddress(breakpoint->guest_address())) {
@@ -744,7 +837,7 @@ void Processor::ShowDebugger() {
 }
 
 bool Processor::SuspendAllThreads() {
-  auto global_lock = global_critical_region_.Acquire();
+  auto all_domains_lock = xe::AcquireAllLockDomains();
   for (auto& it : thread_debug_infos_) {
     auto thread_info = it.second.get();
     if (thread_info->suspended) {
@@ -19,6 +19,7 @@
 #include "xenia/base/mapped_memory.h"
 #include "xenia/base/mutex.h"
 #include "xenia/cpu/backend/backend.h"
+#include "xenia/cpu/compile_worker_pool.h"
 #include "xenia/cpu/debug_listener.h"
 #include "xenia/cpu/entry_table.h"
 #include "xenia/cpu/export_resolver.h"
@@ -71,6 +72,9 @@ class Processor {
   ppc::PPCFrontend* frontend() const { return frontend_.get(); }
   backend::Backend* backend() const { return backend_.get(); }
   ExportResolver* export_resolver() const { return export_resolver_; }
+  // Background compilation threads, null unless early precompilation or tiered
+  // compilation is on.
+  CompileWorkerPool* compile_workers() const { return compile_workers_.get(); }
 
   bool Setup(std::unique_ptr<backend::Backend> backend);
 
@@ -112,6 +116,7 @@ class Processor {
 
   Function* QueryFunction(uint32_t address);
   std::vector<Function*> FindFunctionsWithAddress(uint32_t address);
+  // Also removes the functions the one at the address was inlined into.
   void RemoveFunctionByAddress(uint32_t address);
 
   Function* LookupFunction(uint32_t address);
@@ -119,6 +124,14 @@ class Processor {
   Function* LookupFunction(Module* module, uint32_t address);
   Function* ResolveFunction(uint32_t address);
 
+  // Called by baseline code that reached --tier_up_call_count. Recompiles the
+  // function on a compile worker, or right away if there are none.
+  void RequestTierUp(uint32_t address);
+  // Compiles a fully optimized translation of a defined baseline function into
+  // a separate function object and makes calls enter it. Threads already
+  // running the baseline code finish on it.
+  bool RecompileOptimized(uint32_t address);
+
   bool Execute(ThreadState* thread_state, uint32_t address);
   bool ExecuteRaw(ThreadState* thread_state, uint32_t address);
   uint64_t Execute(ThreadState* thread_state, uint32_t address, uint64_t args[],
@@ -266,6 +279,7 @@ class Processor {
   ExportResolver* export_resolver_ = nullptr;
 
   EntryTable entry_table_;
+  std::unique_ptr<CompileWorkerPool> compile_workers_;
   xe::global_critical_region global_critical_region_;
   ExecutionState execution_state_ = ExecutionState::kPaused;
   std::vector<std::unique_ptr<Module>> modules_;
@@ -276,6 +290,10 @@ class Processor {
   // removed. Must be guarded with the global lock.
   std::map<uint32_t, std::unique_ptr<ThreadDebugInfo>> thread_debug_infos_;
 
+  // Maps the entry address of each inlined guest function to the defined
+  // functions that carry a copy of it. Must be guarded with the global lock.
+  std::map<uint32_t, std::vector<uint32_t>> inlined_callers_;
+
   // TODO(benvanik): cleanup/change structures.
   std::vector<Breakpoint*> breakpoints_;
 
@@ -52,12 +52,10 @@ TestModule::TestModule(Processor* processor, const std::string_view name,
   compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
   compiler_->AddPass(std::make_unique<passes::ConstantPropagationPass>());
   compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
-  // compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
+  compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
+  compiler_->AddPass(std::make_unique<passes::ValueReductionPass>());
   compiler_->AddPass(std::make_unique<passes::DeadCodeEliminationPass>());
 
-  //// Removes all unneeded variables. Try not to add new ones after this.
-  // compiler_->AddPass(new passes::ValueReductionPass());
-
   // Register allocation for the target backend.
   // Will modify the HIR to add loads/stores.
   // This should be the last pass before finalization, as after this all
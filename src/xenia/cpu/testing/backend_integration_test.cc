@@ -13,7 +13,10 @@
 #include <cmath>
 #include <cstring>
 
+#include "xenia/base/byte_order.h"
 #include "xenia/base/platform.h"
+#include "xenia/cpu/cpu_flags.h"
+#include "xenia/cpu/raw_module.h"
 #if XE_ARCH_AMD64
 #include "xenia/cpu/backend/x64/x64_backend.h"
 #elif XE_ARCH_ARM64
@@ -26,6 +29,8 @@ using namespace xe::cpu::hir;
 using namespace xe::cpu::testing;
 using xe::cpu::ppc::PPCContext;
 
+DECLARE_int32(compile_threads);
+
 // =============================================================================
 // SetGuestRoundingMode (C++ path, not HIR opcode)
 // =============================================================================
@@ -912,3 +917,153 @@ TEST_CASE("JIT_UNWIND_INFO_REGISTERED", "[backend]") {
 
   memory.reset();
 }
+
+// =============================================================================
+// Tiered compilation
+// =============================================================================
+// Runs a guest function past --tier_up_call_count so its baseline code bumps
+// its entry and block counters and recompiles it in place, then checks the
+// optimized compile was handed the baseline profile. Only x64 has a baseline
+// tier.
+#if XE_ARCH_AMD64
+TEST_CASE("TIERED_COMPILATION_TIER_UP", "[backend]") {
+  const bool old_tiered_compilation = cvars::tiered_compilation;
+  const uint32_t old_tier_up_call_count = cvars::tier_up_call_count;
+  const bool old_profile_guided_block_layout =
+      cvars::profile_guided_block_layout;
+  const int32_t old_compile_threads = cvars::compile_threads;
+  cvars::tiered_compilation = true;
+  cvars::tier_up_call_count = 2;
+  cvars::profile_guided_block_layout = true;
+  // Recompile on the calling thread so the test doesn't have to wait.
+  cvars::compile_threads = 0;
+
+  auto memory = std::make_unique<Memory>();
+  memory->Initialize();
+  auto processor = std::make_unique<Processor>(memory.get(), nullptr);
+  REQUIRE(processor->Setup(
+      std::make_unique<xe::cpu::backend::x64::X64Backend>()));
+
+  constexpr uint32_t kCodeAddress = 0x80000000;
+  constexpr uint32_t kCodeSize = 4096;
+  REQUIRE(memory->LookupHeap(kCodeAddress)
+              ->AllocFixed(kCodeAddress, kCodeSize, 0,
+                           kMemoryAllocationReserve | kMemoryAllocationCommit,
+                           kMemoryProtectRead | kMemoryProtectWrite));
+  auto code = memory->TranslateVirtual<uint32_t*>(kCodeAddress);
+  xe::store_and_swap<uint32_t>(code + 0, 0x38630001);  // addi r3, r3, 1
+  xe::store_and_swap<uint32_t>(code + 1, 0x4E800020);  // blr
+  auto module = std::make_unique<RawModule>(processor.get());
+  module->set_name("tiered");
+  module->set_executable(true);
+  module->SetAddressRange(kCodeAddress, kCodeSize);
+  processor->AddModule(std::move(module));
+  processor->backend()->CommitExecutableRange(kCodeAddress,
+                                              kCodeAddress + kCodeSize);
+
+  auto fn = static_cast<GuestFunction*>(
+      processor->ResolveFunction(kCodeAddress));
+  REQUIRE(fn != nullptr);
+  REQUIRE(fn->tier() == CompileTier::kBaseline);
+  REQUIRE(fn->block_counters() != nullptr);
+  REQUIRE(fn->block_counter_count() != 0);
+
+  uint32_t stack_size = 64 * 1024;
+  uint32_t stack_address = memory->SystemHeapAlloc(stack_size);
+  auto thread_state = std::make_unique<ThreadState>(processor.get(), 0x100,
+                                                    stack_address + stack_size);
+  auto ctx = thread_state->context();
+  ctx->r[3] = 0;
+  for (uint32_t i = 0; i < 4; ++i) {
+    ctx->lr = 0xBCBCBCBC;
+    REQUIRE(fn->Call(thread_state.get(), uint32_t(ctx->lr)));
+  }
+  REQUIRE(ctx->r[3] == 4);
+
+  // The baseline entry block ran at least until the tier up.
+  REQUIRE(fn->block_counters()[0].count >= 2);
+  auto optimized_fn = fn->optimized_function();
+  REQUIRE(optimized_fn != nullptr);
+  REQUIRE(optimized_fn->tier() == CompileTier::kOptimized);
+  REQUIRE(optimized_fn->block_counters() == fn->block_counters());
+  REQUIRE(optimized_fn->block_counter_count() == fn->block_counter_count());
+
+  memory->SystemHeapFree(stack_address);
+  thread_state.reset();
+  processor.reset();
+  memory.reset();
+
+  cvars::tiered_compilation = old_tiered_compilation;
+  cvars::tier_up_call_count = old_tier_up_call_count;
+  cvars::profile_guided_block_layout = old_profile_guided_block_layout;
+  cvars::compile_threads = old_compile_threads;
+}
+#endif  // XE_ARCH_AMD64
+
+// A tail branch to a small function gets the callee inlined, and removing the
+// callee has to remove the caller carrying its copy as well.
+TEST_CASE("INLINED_CALLEE_REMOVES_CALLER", "[backend]") {
+  const bool old_inline_guest_functions = cvars::inline_guest_functions;
+  cvars::inline_guest_functions = true;
+
+  auto memory = std::make_unique<Memory>();
+  memory->Initialize();
+
+  std::unique_ptr<xe::cpu::backend::Backend> backend;
+#if XE_ARCH_AMD64
+  backend.reset(new xe::cpu::backend::x64::X64Backend());
+#elif XE_ARCH_ARM64
+  backend.reset(new xe::cpu::backend::a64::A64Backend());
+#endif
+  REQUIRE(backend);
+
+  auto processor = std::make_unique<Processor>(memory.get(), nullptr);
+  REQUIRE(processor->Setup(std::move(backend)));
+
+  constexpr uint32_t kCodeAddress = 0x80000000;
+  constexpr uint32_t kCodeSize = 4096;
+  constexpr uint32_t kCalleeAddress = kCodeAddress;
+  constexpr uint32_t kCallerAddress = kCodeAddress + 0x10;
+  REQUIRE(memory->LookupHeap(kCodeAddress)
+              ->AllocFixed(kCodeAddress, kCodeSize, 0,
+                           kMemoryAllocationReserve | kMemoryAllocationCommit,
+                           kMemoryProtectRead | kMemoryProtectWrite));
+  auto code = memory->TranslateVirtual<uint32_t*>(kCodeAddress);
+  xe::store_and_swap<uint32_t>(code + 0, 0x38630001);  // addi r3, r3, 1
+  xe::store_and_swap<uint32_t>(code + 1, 0x4E800020);  // blr
+  xe::store_and_swap<uint32_t>(code + 4, 0x38630002);  // addi r3, r3, 2
+  xe::store_and_swap<uint32_t>(code + 5, 0x4BFFFFEC);  // b kCalleeAddress
+  auto module = std::make_unique<RawModule>(processor.get());
+  module->set_name("inlined");
+  module->set_executable(true);
+  module->SetAddressRange(kCodeAddress, kCodeSize);
+  processor->AddModule(std::move(module));
+  processor->backend()->CommitExecutableRange(kCodeAddress,
+                                              kCodeAddress + kCodeSize);
+
+  auto caller = static_cast<GuestFunction*>(
+      processor->ResolveFunction(kCallerAddress));
+  REQUIRE(caller != nullptr);
+  REQUIRE(caller->inlined_callees() ==
+          std::vector<uint32_t>{kCalleeAddress});
+
+  uint32_t stack_size = 64 * 1024;
+  uint32_t stack_address = memory->SystemHeapAlloc(stack_size);
+  auto thread_state = std::make_unique<ThreadState>(processor.get(), 0x100,
+                                                    stack_address + stack_size);
+  auto ctx = thread_state->context();
+  ctx->r[3] = 0;
+  ctx->lr = 0xBCBCBCBC;
+  REQUIRE(caller->Call(thread_state.get(), uint32_t(ctx->lr)));
+  REQUIRE(ctx->r[3] == 3);
+
+  processor->RemoveFunctionByAddress(kCalleeAddress);
+  REQUIRE(processor->QueryFunction(kCallerAddress) == nullptr);
+
+  memory->SystemHeapFree(stack_address);
+  thread_state.reset();
+  processor.reset();
+  memory.reset();
+
+  cvars::inline_guest_functions = old_inline_guest_functions;
+}
@@ -0,0 +1,68 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <memory>
+#include <string>
+
+#include "xenia/cpu/compile_worker_pool.h"
+#include "xenia/cpu/module.h"
+#include "xenia/cpu/processor.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+using namespace xe::cpu;
+
+namespace {
+
+// Covers an address range, never compiled from.
+class RangeModule : public Module {
+ public:
+  RangeModule(Processor* processor, uint32_t low_address, uint32_t size)
+      : Module(processor),
+        low_address_(low_address),
+        high_address_(low_address + size) {}
+
+  const std::string& name() const override { return name_; }
+  bool is_executable() const override { return true; }
+  bool ContainsAddress(uint32_t address) override {
+    return address >= low_address_ && address < high_address_;
+  }
+
+ protected:
+  std::unique_ptr<Function> CreateFunction(uint32_t address) override {
+    return nullptr;
+  }
+
+ private:
+  std::string name_ = "range";
+  uint32_t low_address_;
+  uint32_t high_address_;
+};
+
+}  // namespace
+
+TEST_CASE("COMPILE_WORKER_POOL_REMOVE_MODULE_REQUESTS", "[compile_workers]") {
+  Processor processor(nullptr, nullptr);
+  RangeModule unloaded_module(&processor, 0x82000000, 0x1000);
+  RangeModule kept_module(&processor, 0x83000000, 0x1000);
+
+  // No threads, so the requests stay queued.
+  CompileWorkerPool pool(&processor, 0);
+  pool.Enqueue({0x82000000, 0x82000010, 0x83000000},
+               CompilePriority::kDiscovered);
+  pool.Enqueue(0x82000020, CompilePriority::kDemandCallee);
+  pool.EnqueueTierUp(0x83000010);
+  REQUIRE(pool.pending_request_count() == 5);
+
+  pool.RemoveRequests(&unloaded_module);
+  REQUIRE(pool.pending_request_count() == 2);
+
+  pool.RemoveRequests(&kept_module);
+  REQUIRE(pool.pending_request_count() == 0);
+}
@@ -0,0 +1,146 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <cstddef>
+#include <memory>
+
+#include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/compiler/passes/dead_store_elimination_pass.h"
+#include "xenia/cpu/hir/hir_builder.h"
+#include "xenia/cpu/ppc/ppc_context.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+using namespace xe::cpu::hir;
+using namespace xe::cpu;
+using xe::cpu::ppc::PPCContext;
+
+namespace {
+
+// Uses are allocated from the current builder.
+class TestBuilder : public HIRBuilder {
+ public:
+  TestBuilder() { MakeCurrent(); }
+  ~TestBuilder() override { RemoveCurrent(); }
+};
+
+void RunDeadStoreElimination(HIRBuilder& b) {
+  compiler::Compiler compiler(nullptr);
+  compiler.AddPass(
+      std::make_unique<compiler::passes::DeadStoreEliminationPass>());
+  REQUIRE(compiler.Compile(&b));
+}
+
+uint32_t CountContextStores(HIRBuilder& b) {
+  uint32_t count = 0;
+  for (auto block = b.first_block(); block; block = block->next) {
+    for (auto i = block->instr_head; i; i = i->next) {
+      if (i->opcode == &OPCODE_STORE_CONTEXT_info) {
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+size_t GPROffset(int reg) { return offsetof(PPCContext, r) + reg * 8; }
+
+}  // namespace
+
+TEST_CASE("DSE_OVERWRITTEN_IN_BLOCK", "[dse]") {
+  TestBuilder b;
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(1));
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(2));
+  b.Return();
+  RunDeadStoreElimination(b);
+  REQUIRE(CountContextStores(b) == 1);
+}
+
+TEST_CASE("DSE_READ_BEFORE_OVERWRITE", "[dse]") {
+  TestBuilder b;
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(1));
+  b.StoreContext(GPROffset(4), b.LoadContext(GPROffset(3), INT64_TYPE));
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(2));
+  b.Return();
+  RunDeadStoreElimination(b);
+  REQUIRE(CountContextStores(b) == 3);
+}
+
+TEST_CASE("DSE_PARTIAL_OVERWRITE", "[dse]") {
+  // Only the low half is written again, the rest of the first store is live.
+  TestBuilder b;
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(1));
+  b.StoreContext(GPROffset(3), b.LoadConstantUint32(2));
+  b.Return();
+  RunDeadStoreElimination(b);
+  REQUIRE(CountContextStores(b) == 2);
+}
+
+TEST_CASE("DSE_CALL_BETWEEN_STORES", "[dse]") {
+  TestBuilder b;
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(1));
+  b.CallIndirect(b.LoadConstantUint32(0x82000000));
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(2));
+  b.Return();
+  b.MergeAdjacentBlocks(b.first_block(), b.first_block()->next);
+  RunDeadStoreElimination(b);
+  REQUIRE(CountContextStores(b) == 2);
+}
+
+TEST_CASE("DSE_CONTEXT_BARRIER_BETWEEN_STORES", "[dse]") {
+  TestBuilder b;
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(1));
+  b.ContextBarrier();
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(2));
+  b.Return();
+  RunDeadStoreElimination(b);
+  REQUIRE(CountContextStores(b) == 2);
+}
+
+TEST_CASE("DSE_OVERWRITTEN_ON_ALL_PATHS", "[dse]") {
+  TestBuilder b;
+  auto taken = b.NewLabel();
+  auto end = b.NewLabel();
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(1));
+  b.BranchTrue(b.LoadContext(GPROffset(4), INT64_TYPE), taken);
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(2));
+  b.Branch(end);
+  b.MarkLabel(taken);
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(3));
+  b.MarkLabel(end);
+  b.Return();
+  RunDeadStoreElimination(b);
+  REQUIRE(CountContextStores(b) == 2);
+}
+
+TEST_CASE("DSE_OVERWRITTEN_ON_ONE_PATH", "[dse]") {
+  TestBuilder b;
+  auto taken = b.NewLabel();
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(1));
+  b.BranchTrue(b.LoadContext(GPROffset(4), INT64_TYPE), taken);
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(2));
+  b.MarkLabel(taken);
+  b.Return();
+  RunDeadStoreElimination(b);
+  REQUIRE(CountContextStores(b) == 2);
+}
+
+TEST_CASE("DSE_READ_IN_LOOP", "[dse]") {
+  // The loop body reads the value stored before entering it.
+  TestBuilder b;
+  auto loop = b.NewLabel();
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(1));
+  b.MarkLabel(loop);
+  b.StoreContext(GPROffset(4), b.LoadContext(GPROffset(3), INT64_TYPE));
+  b.StoreContext(GPROffset(3), b.LoadConstantUint64(2));
+  b.BranchTrue(b.LoadContext(GPROffset(5), INT64_TYPE), loop);
+  b.Return();
+  RunDeadStoreElimination(b);
+  REQUIRE(CountContextStores(b) == 3);
+}
@@ -0,0 +1,164 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <cstddef>
+#include <memory>
+
+#include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/compiler/passes/value_reduction_pass.h"
+#include "xenia/cpu/hir/hir_builder.h"
+#include "xenia/cpu/ppc/ppc_context.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+using namespace xe::cpu::hir;
+using namespace xe::cpu;
+using xe::cpu::ppc::PPCContext;
+
+namespace {
+
+// Uses are allocated from the current builder.
+class TestBuilder : public HIRBuilder {
+ public:
+  TestBuilder() { MakeCurrent(); }
+  ~TestBuilder() override { RemoveCurrent(); }
+};
+
+void RunValueReduction(HIRBuilder& b) {
+  compiler::Compiler compiler(nullptr);
+  compiler.AddPass(std::make_unique<compiler::passes::ValueReductionPass>());
+  REQUIRE(compiler.Compile(&b));
+}
+
+uint32_t CountOpcode(HIRBuilder& b, const OpcodeInfo& opcode) {
+  uint32_t count = 0;
+  for (auto block = b.first_block(); block; block = block->next) {
+    for (auto i = block->instr_head; i; i = i->next) {
+      if (i->opcode == &opcode) {
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
+Value* LoadGPR(HIRBuilder& b, int reg) {
+  return b.LoadContext(offsetof(PPCContext, r) + reg * 8, INT64_TYPE);
+}
+void StoreGPR(HIRBuilder& b, int reg, Value* value) {
+  b.StoreContext(offsetof(PPCContext, r) + reg * 8, value);
+}
+Value* LoadFPR(HIRBuilder& b, int reg) {
+  return b.LoadContext(offsetof(PPCContext, f) + reg * 8, FLOAT64_TYPE);
+}
+void StoreFPR(HIRBuilder& b, int reg, Value* value) {
+  b.StoreContext(offsetof(PPCContext, f) + reg * 8, value);
+}
+
+}  // namespace
+
+TEST_CASE("LVN_SAME_OPERANDS", "[lvn]") {
+  TestBuilder b;
+  auto v4 = LoadGPR(b, 4);
+  auto v5 = LoadGPR(b, 5);
+  StoreGPR(b, 3, b.Add(v4, v5));
+  StoreGPR(b, 6, b.Add(v4, v5));
+  b.Return();
+  RunValueReduction(b);
+  REQUIRE(CountOpcode(b, OPCODE_ADD_info) == 1);
+}
+
+TEST_CASE("LVN_COMMUTATIVE_OPERANDS", "[lvn]") {
+  TestBuilder b;
+  auto v4 = LoadGPR(b, 4);
+  auto v5 = LoadGPR(b, 5);
+  StoreGPR(b, 3, b.Add(v4, v5));
+  StoreGPR(b, 6, b.Add(v5, v4));
+  StoreGPR(b, 7, b.Sub(v4, v5));
+  StoreGPR(b, 8, b.Sub(v5, v4));
+  b.Return();
+  RunValueReduction(b);
+  REQUIRE(CountOpcode(b, OPCODE_ADD_info) == 1);
+  REQUIRE(CountOpcode(b, OPCODE_SUB_info) == 2);
+}
+
+TEST_CASE("LVN_SAME_CONSTANTS", "[lvn]") {
+  TestBuilder b;
+  auto v4 = LoadGPR(b, 4);
+  StoreGPR(b, 3, b.Add(v4, b.LoadConstantUint64(16)));
+  StoreGPR(b, 5, b.Add(v4, b.LoadConstantUint64(16)));
+  StoreGPR(b, 6, b.Add(v4, b.LoadConstantUint64(32)));
+  b.Return();
+  RunValueReduction(b);
+  REQUIRE(CountOpcode(b, OPCODE_ADD_info) == 2);
+}
+
+TEST_CASE("LVN_SIGNED_ZERO_CONSTANTS", "[lvn]") {
+  // 0.0 and -0.0 compare equal but give different results.
+  TestBuilder b;
+  auto f1 = LoadFPR(b, 1);
+  StoreFPR(b, 2, b.Add(f1, b.LoadConstantFloat64(0.0)));
+  StoreFPR(b, 3, b.Add(f1, b.LoadConstantFloat64(-0.0)));
+  b.Return();
+  RunValueReduction(b);
+  REQUIRE(CountOpcode(b, OPCODE_ADD_info) == 2);
+}
+
+TEST_CASE("LVN_ACROSS_ROUNDING_MODE_CHANGE", "[lvn]") {
+  TestBuilder b;
+  auto f1 = LoadFPR(b, 1);
+  auto f2 = LoadFPR(b, 2);
+  StoreFPR(b, 3, b.Add(f1, f2));
+  b.SetRoundingMode(b.LoadConstantUint32(1));
+  StoreFPR(b, 4, b.Add(f1, f2));
+  b.Return();
+  RunValueReduction(b);
+  REQUIRE(CountOpcode(b, OPCODE_ADD_info) == 2);
+}
+
+TEST_CASE("LVN_ACROSS_CALL", "[lvn]") {
+  // The callee may change the rounding mode. Blocks split only by calls are
+  // merged by ControlFlowSimplificationPass, leaving the call mid-block.
+  TestBuilder b;
+  auto f1 = LoadFPR(b, 1);
+  auto f2 = LoadFPR(b, 2);
+  StoreFPR(b, 3, b.Add(f1, f2));
+  b.CallIndirect(b.LoadConstantUint32(0x82000000));
+  StoreFPR(b, 4, b.Add(f1, f2));
+  b.Return();
+  b.MergeAdjacentBlocks(b.first_block(), b.first_block()->next);
+  RunValueReduction(b);
+  REQUIRE(CountOpcode(b, OPCODE_ADD_info) == 2);
+}
+
+TEST_CASE("LVN_ACROSS_BLOCKS", "[lvn]") {
+  // Numbering is local, a value from another block isn't reused.
+  TestBuilder b;
+  auto next = b.NewLabel();
+  auto v4 = LoadGPR(b, 4);
+  auto v5 = LoadGPR(b, 5);
+  StoreGPR(b, 3, b.Add(v4, v5));
+  b.Branch(next);
+  b.MarkLabel(next);
+  StoreGPR(b, 6, b.Add(v4, v5));
+  b.Return();
+  RunValueReduction(b);
+  REQUIRE(CountOpcode(b, OPCODE_ADD_info) == 2);
+}
+
+TEST_CASE("LVN_MEMORY_LOADS", "[lvn]") {
+  // Memory may change between the loads.
+  TestBuilder b;
+  auto address = LoadGPR(b, 4);
+  StoreGPR(b, 3, b.Load(address, INT64_TYPE));
+  StoreGPR(b, 5, b.Load(address, INT64_TYPE));
+  b.Return();
+  RunValueReduction(b);
+  REQUIRE(CountOpcode(b, OPCODE_LOAD_info) == 2);
+}
@@ -1146,6 +1146,14 @@ void XexModule::Precompile() {
   }
 
   info_cache_.Init(this);
+  processor_->backend()->OpenModuleCodeCache(
+      this, kernel_state_->emulator()->cache_root() / "modules" /
+                image_sha_str_);
+  // Only queued for the workers, compiling them all on the loading thread
+  // would delay booting.
+  if (processor_->compile_workers()) {
+    PrecompileKnownFunctions();
+  }
   PrecompileDiscoveredFunctions();
 }
 bool XexModule::Unload() {
@@ -1154,6 +1162,8 @@ bool XexModule::Unload() {
   }
   loaded_ = false;
 
+  processor_->backend()->CloseModuleCodeCache(this);
+
   // If this isn't a patch, just deallocate the memory occupied by the exe
   if (!is_patch()) {
     assert_not_zero(base_address_);
@@ -1426,6 +1436,7 @@ void XexModule::PrecompileDiscoveredFunctions() {
   }
   auto others = PreanalyzeCode();
 
+  std::vector<uint32_t> to_compile;
   for (auto&& other : others) {
     if (other < low_address_ || other >= high_address_) {
       continue;
@@ -1433,9 +1444,18 @@ void XexModule::PrecompileDiscoveredFunctions() {
     auto sym = processor_->LookupFunction(other);
 
     if (!sym || sym->status() != Symbol::Status::kDefined) {
-      processor_->ResolveFunction(other);
+      to_compile.push_back(other);
     }
   }
+  // Let the title boot while the workers compile, it only waits on the
+  // functions it actually reaches.
+  if (auto compile_workers = processor_->compile_workers()) {
+    compile_workers->Enqueue(to_compile, CompilePriority::kDiscovered);
+    return;
+  }
+  for (uint32_t address : to_compile) {
+    processor_->ResolveFunction(address);
+  }
 }
 void XexModule::PrecompileKnownFunctions() {
   if (!cvars::enable_early_precompilation) {
@@ -1447,17 +1467,24 @@ void XexModule::PrecompileKnownFunctions() {
   if (!flags) {
     return;
   }
-  // maybe should pre-acquire global crit?
+  std::vector<uint32_t> to_compile;
   for (uint32_t i = 0; i < end; i++) {
     if (flags[i].was_resolved) {
       uint32_t addr = low_address_ + (i * 4);
       auto sym = processor_->LookupFunction(addr);
 
       if (!sym || sym->status() != Symbol::Status::kDefined) {
-        processor_->ResolveFunction(addr);
+        to_compile.push_back(addr);
       }
     }
   }
+  if (auto compile_workers = processor_->compile_workers()) {
+    compile_workers->Enqueue(to_compile, CompilePriority::kPreviouslyResolved);
+    return;
+  }
+  for (uint32_t address : to_compile) {
+    processor_->ResolveFunction(address);
+  }
 }
 
 static uint32_t GetBLCalledFunction(XexModule* xexmod, uint32_t current_base,
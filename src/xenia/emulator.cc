@@ -7,6 +7,7 @@
  ******************************************************************************
  */
 
+#include <random>
 #include <ranges>
 
 #include "xenia/emulator.h"
@@ -84,6 +85,12 @@ DEFINE_bool(allow_game_relative_writes, false,
             "generating test data to compare with original hardware. ",
             "General");
 
+DEFINE_bool(save_state_delta, false,
+            "Save states as deltas only containing the memory that has "
+            "changed since the last full state saved or restored, which must "
+            "be kept for restoring the deltas.",
+            "General");
+
 DECLARE_bool(allow_plugins);
 
 DEFINE_int32(priority_class, 0,
@@ -166,6 +173,9 @@ Emulator::Emulator(const std::filesystem::path& command_line,
 Emulator::~Emulator() {
   // Note that we delete things in the reverse order they were initialized.
 
+  // Stop taking snapshots of the systems before shutting them down.
+  rewind_buffer_.reset();
+
   // Give the systems time to shutdown before we delete them.
   if (graphics_system_) {
     graphics_system_->Shutdown();
@@ -341,6 +351,9 @@ X_STATUS Emulator::Setup(
     audio_media_player_->Setup();
   }
 
+  rewind_buffer_ = std::make_unique<RewindBuffer>(this);
+  rewind_buffer_->Start();
+
   // Initialize emulator fallback exception handling last.
   ExceptionHandler::Install(Emulator::ExceptionCallbackThunk, this);
 
@@ -352,7 +365,13 @@ X_STATUS Emulator::TerminateTitle() {
     return X_STATUS_UNSUCCESSFUL;
   }
 
-  kernel_state_->TerminateTitle();
+  {
+    std::lock_guard<std::mutex> rewind_lock(rewind_mutex_);
+    kernel_state_->TerminateTitle();
+    if (rewind_buffer_) {
+      rewind_buffer_->Clear();
+    }
+  }
   title_id_ = std::nullopt;
   title_name_ = "";
   title_version_ = "";
@@ -1073,7 +1092,7 @@ void Emulator::Pause() {
   graphics_system_->Pause();
   audio_system_->Pause();
 
-  auto lock = global_critical_region::AcquireDirect();
+  auto lock = xe::AcquireAllLockDomains();
   auto threads =
       kernel_state()->object_table()->GetObjectsByType<kernel::XThread>(
           kernel::XObject::Type::Thread);
@@ -1120,21 +1139,42 @@ void Emulator::Resume() {
 }
 
 bool Emulator::SaveToFile(const std::filesystem::path& path) {
+  std::lock_guard<std::mutex> rewind_lock(rewind_mutex_);
   Pause();
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+
+  auto absolute_path = std::filesystem::absolute(path);
+  // A delta can't replace its own base.
+  bool delta = cvars::save_state_delta && !state_delta_base_path_.empty() &&
+               state_delta_base_path_ != absolute_path;
 
   filesystem::CreateEmptyFile(path);
   auto map = MappedMemory::Open(path, MappedMemory::Mode::kReadWrite, 0, 2_GiB);
   if (!map) {
+    Resume();
     return false;
   }
 
+  // Identifies the state for the deltas saved against it, so they can't be
+  // restored on top of a different state saved to the same path later.
+  std::random_device random_device;
+  uint64_t state_id = std::mt19937_64(random_device())();
+
   // Save the emulator state to a file
   ByteStream stream(map->data(), map->size());
   stream.Write(kEmulatorSaveSignature);
+  stream.Write(state_id);
   stream.Write(title_id_.has_value());
   if (title_id_.has_value()) {
     stream.Write(title_id_.value());
   }
+  stream.Write(delta);
+  if (delta) {
+    std::string base_path = xe::path_to_utf8(state_delta_base_path_);
+    stream.Write(std::string_view(base_path));
+    stream.Write(state_delta_base_id_);
+    stream.Write(state_delta_base_memory_offset_);
+  }
 
   // It's important we don't hold the global lock here! XThreads need to step
   // forward (possibly through guarded regions) without worry!
@@ -1142,11 +1182,30 @@ bool Emulator::SaveToFile(const std::filesystem::path& path) {
   graphics_system_->Save(&stream);
   audio_system_->Save(&stream);
   kernel_state_->Save(&stream);
-  memory_->Save(&stream);
+  uint64_t memory_offset = stream.offset();
+  MemoryStateHashes memory_hashes;
+  bool memory_saved =
+      memory_->Save(&stream, delta ? &state_delta_base_hashes_ : nullptr,
+                    delta ? nullptr : &memory_hashes);
   map->Close(stream.offset());
 
+  if (memory_saved) {
+    XELOGI("Saved the {} state ({} bytes) in {} ms", delta ? "delta" : "full",
+           stream.offset(),
+           (Clock::QueryHostTickCount() - start_ticks) * 1000 /
+               Clock::QueryHostTickFrequency());
+    if (!delta) {
+      state_delta_base_path_ = absolute_path;
+      state_delta_base_id_ = state_id;
+      state_delta_base_memory_offset_ = memory_offset;
+      state_delta_base_hashes_ = std::move(memory_hashes);
+    }
+  } else {
+    XELOGE("Could not save memory!");
+  }
+
   Resume();
-  return true;
+  return memory_saved;
 }
 
 bool Emulator::RestoreFromFile(const std::filesystem::path& path) {
@@ -1155,7 +1214,9 @@ bool Emulator::RestoreFromFile(const std::filesystem::path& path) {
   if (!map) {
     return false;
   }
+  uint64_t start_ticks = Clock::QueryHostTickCount();
 
+  std::lock_guard<std::mutex> rewind_lock(rewind_mutex_);
   restoring_ = true;
 
   // Terminate any loaded titles.
@@ -1167,6 +1228,7 @@ bool Emulator::RestoreFromFile(const std::filesystem::path& path) {
   if (stream.Read<uint32_t>() != kEmulatorSaveSignature) {
     return false;
   }
+  uint64_t state_id = stream.Read<uint64_t>();
 
   auto has_title_id = stream.Read<bool>();
   std::optional<uint32_t> title_id;
@@ -1182,27 +1244,133 @@ bool Emulator::RestoreFromFile(const std::filesystem::path& path) {
     return false;
   }
 
-  if (!processor_->Restore(&stream)) {
+  // Memory unchanged since the base state is taken from the base state file.
+  bool delta = stream.Read<bool>();
+  std::filesystem::path base_path = std::filesystem::absolute(path);
+  uint64_t base_id = state_id;
+  uint64_t base_memory_offset = 0;
+  std::unique_ptr<MappedMemory> base_map;
+  std::unique_ptr<ByteStream> base_stream;
+  if (delta) {
+    base_path = xe::to_path(stream.Read<std::string>());
+    base_id = stream.Read<uint64_t>();
+    base_memory_offset = stream.Read<uint64_t>();
+    base_map = MappedMemory::Open(base_path, MappedMemory::Mode::kRead);
+    if (base_map &&
+        base_map->size() >= sizeof(uint32_t) + sizeof(uint64_t) &&
+        base_map->size() >= base_memory_offset) {
+      base_stream =
+          std::make_unique<ByteStream>(base_map->data(), base_map->size());
+    }
+    if (!base_stream ||
+        base_stream->Read<uint32_t>() != kEmulatorSaveSignature) {
+      XELOGE("Could not open the base state {}",
+             xe::path_to_utf8(base_path));
+      return false;
+    }
+    if (base_stream->Read<uint64_t>() != base_id) {
+      XELOGE("The base state {} has been replaced since the delta was saved",
+             xe::path_to_utf8(base_path));
+      return false;
+    }
+    base_stream->set_offset(size_t(base_memory_offset));
+  }
+
+  if (!RestoreSystemState(&stream)) {
+    return false;
+  }
+  if (!delta) {
+    base_memory_offset = stream.offset();
+  }
+  MemoryStateHashes base_memory_hashes;
+  if (!memory_->Restore(&stream, base_stream.get(), &base_memory_hashes)) {
+    XELOGE("Could not restore memory!");
+    return false;
+  }
+  state_delta_base_path_ = base_path;
+  state_delta_base_id_ = base_id;
+  state_delta_base_memory_offset_ = base_memory_offset;
+  state_delta_base_hashes_ = std::move(base_memory_hashes);
+  XELOGI("Restored the {} state in {} ms", delta ? "delta" : "full",
+         (Clock::QueryHostTickCount() - start_ticks) * 1000 /
+             Clock::QueryHostTickFrequency());
+
+  // The snapshots are from a different timeline.
+  if (rewind_buffer_) {
+    rewind_buffer_->Clear();
+  }
+
+  FinishRestore();
+  return true;
+}
+
+bool Emulator::TakeRewindSnapshot() {
+  std::lock_guard<std::mutex> rewind_lock(rewind_mutex_);
+  if (!rewind_buffer_ || !is_title_open() || paused_ || restoring_) {
+    return false;
+  }
+  Pause();
+  bool snapshot_taken = rewind_buffer_->TakeSnapshot();
+  Resume();
+  return snapshot_taken;
+}
+
+bool Emulator::Rewind() {
+  std::lock_guard<std::mutex> rewind_lock(rewind_mutex_);
+  if (!rewind_buffer_ || !is_title_open() || restoring_) {
+    return false;
+  }
+  std::unique_ptr<RewindBuffer::Snapshot> snapshot =
+      rewind_buffer_->PopSnapshot();
+  if (!snapshot) {
+    return false;
+  }
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+
+  restoring_ = true;
+
+  Pause();
+  kernel_state_->TerminateTitle();
+
+  auto lock = global_critical_region::AcquireDirect();
+  ByteStream stream(snapshot->system_state.data(),
+                    snapshot->system_state.size());
+  if (!RestoreSystemState(&stream)) {
+    return false;
+  }
+  if (!memory_->RestoreSnapshot(snapshot->memory)) {
+    XELOGE("Could not restore memory!");
+    return false;
+  }
+  XELOGI("Rewound to frame {} in {} ms", snapshot->frame,
+         (Clock::QueryHostTickCount() - start_ticks) * 1000 /
+             Clock::QueryHostTickFrequency());
+
+  FinishRestore();
+  return true;
+}
+
+bool Emulator::RestoreSystemState(ByteStream* stream) {
+  if (!processor_->Restore(stream)) {
     XELOGE("Could not restore processor!");
     return false;
   }
-  if (!graphics_system_->Restore(&stream)) {
+  if (!graphics_system_->Restore(stream)) {
     XELOGE("Could not restore graphics system!");
     return false;
   }
-  if (!audio_system_->Restore(&stream)) {
+  if (!audio_system_->Restore(stream)) {
     XELOGE("Could not restore audio system!");
     return false;
   }
-  if (!kernel_state_->Restore(&stream)) {
+  if (!kernel_state_->Restore(stream)) {
     XELOGE("Could not restore kernel state!");
     return false;
   }
-  if (!memory_->Restore(&stream)) {
-    XELOGE("Could not restore memory!");
-    return false;
-  }
+  return true;
+}
 
+void Emulator::FinishRestore() {
   // Update the main thread.
   auto threads =
       kernel_state_->object_table()->GetObjectsByType<kernel::XThread>();
@@ -1217,8 +1385,6 @@ bool Emulator::RestoreFromFile(const std::filesystem::path& path) {
 
   restore_fence_.Signal();
   restoring_ = false;
-
-  return true;
 }
 
 const std::filesystem::path Emulator::GetNewDiscPath(
@@ -13,6 +13,8 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
@@ -26,6 +28,7 @@
 #include "xenia/memory.h"
 #include "xenia/patcher/patcher.h"
 #include "xenia/patcher/plugin_loader.h"
+#include "xenia/rewind_buffer.h"
 #include "xenia/ui/immediate_drawer.h"
 #include "xenia/vfs/device.h"
 #include "xenia/vfs/virtual_file_system.h"
@@ -55,7 +58,8 @@ class Window;
 
 namespace xe {
 
-constexpr fourcc_t kEmulatorSaveSignature = make_fourcc("XSAV");
+// Changed with incompatible changes of the saved state format.
+constexpr fourcc_t kEmulatorSaveSignature = make_fourcc("XSV2");
 static constexpr std::string_view kDefaultGameSymbolicLink = "GAME:";
 static constexpr std::string_view kDefaultPartitionSymbolicLink = "D:";
 static constexpr std::string_view kDefaultUpdateSymbolicLink = "UPDATE:";
@@ -296,6 +300,13 @@ class Emulator {
   bool SaveToFile(const std::filesystem::path& path);
   bool RestoreFromFile(const std::filesystem::path& path);
 
+  // Snapshots for rewinding are taken periodically if --rewind_interval is not
+  // 0. Rewind restores the newest snapshot and removes it from the buffer, so
+  // calling it repeatedly goes further back.
+  bool TakeRewindSnapshot();
+  bool Rewind();
+  RewindBuffer* rewind_buffer() const { return rewind_buffer_.get(); }
+
   // The game can request another title to be loaded.
   const std::filesystem::path GetNewDiscPath(std::string window_message = "");
 
@@ -323,6 +334,12 @@ class Emulator {
   X_STATUS CompleteLaunch(const std::filesystem::path& path,
                           const std::string_view module_path);
 
+  // Restores the parts of the state saved before the guest memory, with the
+  // title terminated and the global lock held.
+  bool RestoreSystemState(ByteStream* stream);
+  // Resumes the emulator after a state has been restored.
+  void FinishRestore();
+
   std::filesystem::path command_line_;
   std::filesystem::path storage_root_;
   std::filesystem::path content_root_;
@@ -366,6 +383,18 @@ class Emulator {
   bool paused_;
   bool restoring_;
   threading::Fence restore_fence_;  // Fired on restore finish.
+
+  // The last full state saved or restored, for saving states as deltas against
+  // it with --save_state_delta. Empty path if there's none.
+  std::filesystem::path state_delta_base_path_;
+  uint64_t state_delta_base_id_ = 0;
+  uint64_t state_delta_base_memory_offset_ = 0;
+  MemoryStateHashes state_delta_base_hashes_;
+
+  // Serializes taking and restoring states, which pause the emulator, between
+  // the UI and the rewind snapshot thread.
+  std::mutex rewind_mutex_;
+  std::unique_ptr<RewindBuffer> rewind_buffer_;
 };
 
 }  // namespace xe
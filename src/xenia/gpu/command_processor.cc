@@ -18,6 +18,7 @@
 #include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/graphics_system.h"
 #include "xenia/gpu/packet_disassembler.h"
+#include "xenia/gpu/register_write_ranges.h"
 #include "xenia/gpu/sampler_info.h"
 #include "xenia/gpu/texture_info.h"
 #include "xenia/gpu/xenos_zpd_report.h"
@@ -729,19 +730,46 @@ void CommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
 void CommandProcessor::WriteRegistersFromMem(uint32_t start_index,
                                              uint32_t* base,
                                              uint32_t num_registers) {
-  for (uint32_t i = 0; i < num_registers; ++i) {
-    uint32_t data = xe::load_and_swap<uint32_t>(base + i);
-    this->WriteRegister(start_index + i, data);
+  struct Handler {
+    CommandProcessor& command_processor;
+    void OnSpecialRegisterWritten(uint32_t index, uint32_t value) {
+      command_processor.HandleSpecialRegisterWrite(index, value);
+    }
+    void OnFloatConstantsWritten(uint32_t first_index, uint32_t count) {}
+    void OnFetchConstantsWritten(uint32_t first_index, uint32_t count) {}
+    void OnBoolLoopConstantsWritten(uint32_t first_index, uint32_t count) {}
+  };
+  if (uint64_t(start_index) + num_registers > RegisterFile::kRegisterCount) {
+    XELOGW(
+        "CommandProcessor::WriteRegistersFromMem index out of bounds: {} + {}",
+        start_index, num_registers);
   }
+  Handler handler = {*this};
+  register_write_ranges::WriteRange(register_file_->values, start_index, base,
+                                    num_registers, handler);
 }
 
 void CommandProcessor::WriteRegisterRangeFromRing(xe::RingBuffer* ring,
                                                   uint32_t base,
                                                   uint32_t num_registers) {
-  for (uint32_t i = 0; i < num_registers; ++i) {
-    uint32_t data = ring->ReadAndSwap<uint32_t>();
-    WriteRegister(base + i, data);
-  }
+  // Writing the whole range at once rather than reading the ring buffer one
+  // dword at a time, prefetching the part after the wraparound if there is
+  // one.
+  RingBuffer::ReadRange range =
+      ring->BeginPrefetchedRead<swcache::PrefetchTag::Level1>(num_registers *
+                                                              sizeof(uint32_t));
+  uint32_t num_registers_first =
+      uint32_t(range.first_length / sizeof(uint32_t));
+  WriteRegistersFromMem(
+      base, reinterpret_cast<uint32_t*>(const_cast<uint8_t*>(range.first)),
+      num_registers_first);
+  if (range.second) {
+    WriteRegistersFromMem(
+        base + num_registers_first,
+        reinterpret_cast<uint32_t*>(const_cast<uint8_t*>(range.second)),
+        num_registers - num_registers_first);
+  }
+  ring->EndRead(range);
 }
 
 void CommandProcessor::WriteALURangeFromRing(xe::RingBuffer* ring,
@@ -230,7 +230,9 @@ class CommandProcessor {
 
   virtual void WriteRegister(uint32_t index, uint32_t value);
 
-  // mem has big-endian register values
+  // mem has big-endian register values. Stores runs of registers without side
+  // effects in bulk (see register_write_ranges), so subclasses reacting to
+  // writes in WriteRegister must also override this.
   XE_FORCEINLINE
   virtual void WriteRegistersFromMem(uint32_t start_index, uint32_t* base,
                                      uint32_t num_registers);
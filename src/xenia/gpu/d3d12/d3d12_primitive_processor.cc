@@ -76,7 +76,7 @@ void D3D12PrimitiveProcessor::BeginFrame() {
 }
 
 void D3D12PrimitiveProcessor::EndFrame() {
-  ClearPerFrameCache();
+  EndCacheFrame();
   frame_index_buffers_.clear();
 }
 
@@ -46,6 +46,12 @@ DEFINE_bool(
     "some games draw rectangles (for their UI, for instance) without clipping, "
     "but with a proper scissor rectangle.",
     "GPU");
+DEFINE_bool(
+    execute_unclipped_draw_vs_on_cpu_in_batches, true,
+    "For execute_unclipped_draw_vs_on_cpu, execute the vertex shader for "
+    "multiple vertices at once from a pre-decoded form of the shader rather "
+    "than interpreting the microcode for every vertex.",
+    "GPU");
 
 namespace xe {
 namespace gpu {
@@ -168,8 +174,79 @@ uint32_t DrawExtentEstimator::EstimateVertexMaxY(const Shader& vertex_shader) {
 
   shader_interpreter_.SetShader(vertex_shader);
 
-  PositionYExportSink position_y_export_sink;
-  shader_interpreter_.SetExportSink(&position_y_export_sink);
+  bool execute_in_batches = cvars::execute_unclipped_draw_vs_on_cpu_in_batches;
+  PositionYExportSink position_y_export_sinks[ShaderInterpreter::kBatchSize];
+  ShaderInterpreter::ExportSink*
+      batch_export_sinks[ShaderInterpreter::kBatchSize];
+  for (uint32_t i = 0; i < ShaderInterpreter::kBatchSize; ++i) {
+    batch_export_sinks[i] = &position_y_export_sinks[i];
+  }
+  float batch_vertex_indices[ShaderInterpreter::kBatchSize];
+  uint32_t batch_vertex_count = 0;
+  auto flush_batch = [&]() {
+    for (uint32_t i = 0; i < batch_vertex_count; ++i) {
+      position_y_export_sinks[i].Reset();
+    }
+    if (execute_in_batches) {
+      shader_interpreter_.ExecuteBatch(batch_vertex_count, batch_vertex_indices,
+                                       batch_export_sinks);
+    } else {
+      for (uint32_t i = 0; i < batch_vertex_count; ++i) {
+        shader_interpreter_.SetExportSink(&position_y_export_sinks[i]);
+        shader_interpreter_.temp_registers()[0] = batch_vertex_indices[i];
+        shader_interpreter_.Execute();
+      }
+      shader_interpreter_.SetExportSink(nullptr);
+    }
+
+    for (uint32_t i = 0; i < batch_vertex_count; ++i) {
+      const PositionYExportSink& position_y_export_sink =
+          position_y_export_sinks[i];
+      if (position_y_export_sink.vertex_kill().has_value() &&
+          (position_y_export_sink.vertex_kill().value() &
+           ~(UINT32_C(1) << 31))) {
+        continue;
+      }
+      if (!position_y_export_sink.position_y().has_value()) {
+        continue;
+      }
+      float vertex_y = position_y_export_sink.position_y().value();
+      if (!pa_cl_vte_cntl.vtx_xy_fmt) {
+        if (!position_y_export_sink.position_w().has_value()) {
+          continue;
+        }
+        vertex_y /= position_y_export_sink.position_w().value();
+      }
+
+      vertex_y = vertex_y * viewport_y_scale + viewport_y_offset;
+
+      if (vgt_draw_initiator.prim_type == xenos::PrimitiveType::kPointList) {
+        float point_radius_y;
+        if (position_y_export_sink.point_size().has_value()) {
+          // Vertex-specified diameter. Clamped effectively as a signed integer
+          // in the hardware, -NaN, -Infinity ... -0 to the minimum, +Infinity,
+          // +NaN to the maximum.
+          point_radius_y =
+              0.5f *
+              xe::memory::Reinterpret<float>(std::min(
+                  point_vertex_max_diameter_float,
+                  std::max(point_vertex_min_diameter_float,
+                           xe::memory::Reinterpret<int32_t>(
+                               position_y_export_sink.point_size().value()))));
+        } else {
+          // Constant radius.
+          point_radius_y = point_constant_radius_y;
+        }
+        vertex_y += point_radius_y;
+      }
+
+      // std::max is `a < b ? b : a`, thus in case of NaN, the first argument
+      // is always returned - max_y, which is initialized to a normalized value.
+      max_y = std::max(max_y, vertex_y);
+    }
+    batch_vertex_count = 0;
+  };
+
   for (uint32_t i = 0; i < vgt_draw_initiator.num_indices; ++i) {
     uint32_t vertex_index;
     if (vgt_draw_initiator.source_select == xenos::SourceSelect::kDMA) {
@@ -196,53 +273,12 @@ uint32_t DrawExtentEstimator::EstimateVertexMaxY(const Shader& vertex_shader) {
         std::min(max_index,
                  std::max(min_index, (vertex_index + index_offset) & 0xFFFFFF));
 
-    position_y_export_sink.Reset();
-
-    shader_interpreter_.temp_registers()[0] = float(vertex_index);
-    shader_interpreter_.Execute();
-
-    if (position_y_export_sink.vertex_kill().has_value() &&
-        (position_y_export_sink.vertex_kill().value() & ~(UINT32_C(1) << 31))) {
-      continue;
+    batch_vertex_indices[batch_vertex_count++] = float(vertex_index);
+    if (batch_vertex_count >= ShaderInterpreter::kBatchSize) {
+      flush_batch();
     }
-    if (!position_y_export_sink.position_y().has_value()) {
-      continue;
-    }
-    float vertex_y = position_y_export_sink.position_y().value();
-    if (!pa_cl_vte_cntl.vtx_xy_fmt) {
-      if (!position_y_export_sink.position_w().has_value()) {
-        continue;
-      }
-      vertex_y /= position_y_export_sink.position_w().value();
-    }
-
-    vertex_y = vertex_y * viewport_y_scale + viewport_y_offset;
-
-    if (vgt_draw_initiator.prim_type == xenos::PrimitiveType::kPointList) {
-      float point_radius_y;
-      if (position_y_export_sink.point_size().has_value()) {
-        // Vertex-specified diameter. Clamped effectively as a signed integer in
-        // the hardware, -NaN, -Infinity ... -0 to the minimum, +Infinity, +NaN
-        // to the maximum.
-        point_radius_y =
-            0.5f *
-            xe::memory::Reinterpret<float>(std::min(
-                point_vertex_max_diameter_float,
-                std::max(point_vertex_min_diameter_float,
-                         xe::memory::Reinterpret<int32_t>(
-                             position_y_export_sink.point_size().value()))));
-      } else {
-        // Constant radius.
-        point_radius_y = point_constant_radius_y;
-      }
-      vertex_y += point_radius_y;
-    }
-
-    // std::max is `a < b ? b : a`, thus in case of NaN, the first argument is
-    // always returned - max_y, which is initialized to a normalized value.
-    max_y = std::max(max_y, vertex_y);
   }
-  shader_interpreter_.SetExportSink(nullptr);
+  flush_batch();
 
   int32_t max_y_24p8 = ui::FloatToD3D11Fixed16p8(max_y);
   // 16p8 range is -32768 to 32767+255/256, but it's stored as uint32_t here,
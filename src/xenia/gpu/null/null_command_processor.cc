@@ -9,47 +9,378 @@
 
 #include "xenia/gpu/null/null_command_processor.h"
 
+#include "third_party/xxhash/xxhash.h"
+
+#include "xenia/base/assert.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/math.h"
+#include "xenia/gpu/draw_util.h"
+#include "xenia/gpu/null/null_primitive_processor.h"
+#include "xenia/gpu/null/null_render_target_cache.h"
+#include "xenia/gpu/null/null_shared_memory.h"
+#include "xenia/gpu/null/null_texture_cache.h"
+#include "xenia/gpu/register_write_ranges.h"
+#include "xenia/gpu/registers.h"
+
 namespace xe {
 namespace gpu {
 namespace null {
 
+const char* NullCommandProcessor::GetStageName(Stage stage) {
+  switch (stage) {
+    case Stage::kSharedMemory:
+      return "shared memory";
+    case Stage::kPrimitiveProcessing:
+      return "primitive processing";
+    case Stage::kShaderAnalysis:
+      return "shader analysis";
+    case Stage::kShaderTranslation:
+      return "shader translation";
+    case Stage::kTextures:
+      return "textures";
+    case Stage::kRenderTargets:
+      return "render targets";
+    case Stage::kResolves:
+      return "resolves";
+    default:
+      assert_unhandled_case(stage);
+      return "unknown";
+  }
+}
+
 NullCommandProcessor::NullCommandProcessor(NullGraphicsSystem* graphics_system,
-                                           kernel::KernelState* kernel_state)
-    : CommandProcessor(graphics_system, kernel_state) {}
+                                           kernel::KernelState* kernel_state,
+                                           bool emulate_cpu_side)
+    : CommandProcessor(graphics_system, kernel_state),
+      emulate_cpu_side_(emulate_cpu_side) {}
 NullCommandProcessor::~NullCommandProcessor() = default;
 
+void NullCommandProcessor::ClearCaches() {
+  CommandProcessor::ClearCaches();
+  cache_clear_requested_ = true;
+}
+
 void NullCommandProcessor::TracePlaybackWroteMemory(uint32_t base_ptr,
-                                                    uint32_t length) {}
+                                                    uint32_t length) {
+  if (!emulate_cpu_side_) {
+    return;
+  }
+  StageScope stage_scope(*this, Stage::kSharedMemory);
+  shared_memory_->MemoryInvalidationCallback(base_ptr, length, true);
+  primitive_processor_->MemoryInvalidationCallback(base_ptr, length, true);
+}
 
 void NullCommandProcessor::RestoreEdramSnapshot(const void* snapshot) {}
 
 bool NullCommandProcessor::SetupContext() {
-  return CommandProcessor::SetupContext();
+  if (!CommandProcessor::SetupContext()) {
+    return false;
+  }
+  if (!emulate_cpu_side_) {
+    return true;
+  }
+
+  shared_memory_ = std::make_unique<NullSharedMemory>(*this, *memory_);
+  if (!shared_memory_->Initialize()) {
+    XELOGE("Failed to initialize shared memory");
+    return false;
+  }
+
+  primitive_processor_ = std::make_unique<NullPrimitiveProcessor>(
+      *register_file_, *memory_, trace_writer_, *shared_memory_);
+  if (!primitive_processor_->Initialize()) {
+    XELOGE("Failed to initialize the geometric primitive processor");
+    return false;
+  }
+
+  render_target_cache_ = std::make_unique<NullRenderTargetCache>(
+      *register_file_, *memory_, trace_writer_);
+  if (!render_target_cache_->Initialize()) {
+    XELOGE("Failed to initialize the render target cache");
+    return false;
+  }
+
+  texture_cache_ =
+      std::make_unique<NullTextureCache>(*register_file_, *shared_memory_);
+
+  shader_translator_ = std::make_unique<DxbcShaderTranslator>(
+      ui::GraphicsProvider::GpuVendorID(0), false, false);
+
+  texture_cache_->BeginSubmission(submission_current_);
+  return true;
 }
 
 void NullCommandProcessor::ShutdownContext() {
+  shaders_.clear();
+  shader_translator_.reset();
+  texture_cache_.reset();
+  render_target_cache_.reset();
+  primitive_processor_.reset();
+  shared_memory_.reset();
   return CommandProcessor::ShutdownContext();
 }
 
+void NullCommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
+  CommandProcessor::WriteRegister(index, value);
+  if (emulate_cpu_side_ && index >= XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0 &&
+      index <= XE_GPU_REG_SHADER_CONSTANT_FETCH_31_5) {
+    texture_cache_->TextureFetchConstantWritten(
+        (index - XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) / 6);
+  }
+}
+
+void NullCommandProcessor::WriteRegistersFromMem(uint32_t start_index,
+                                                 uint32_t* base,
+                                                 uint32_t num_registers) {
+  struct Handler {
+    NullCommandProcessor& command_processor;
+    void OnSpecialRegisterWritten(uint32_t index, uint32_t value) {
+      command_processor.HandleSpecialRegisterWrite(index, value);
+    }
+    void OnFloatConstantsWritten(uint32_t first_index, uint32_t count) {}
+    void OnFetchConstantsWritten(uint32_t first_index, uint32_t count) {
+      if (command_processor.emulate_cpu_side_) {
+        uint32_t first_fetch_constant, last_fetch_constant;
+        register_write_ranges::GetFetchConstantRange(
+            first_index, count, first_fetch_constant, last_fetch_constant);
+        command_processor.texture_cache_->TextureFetchConstantsWritten(
+            first_fetch_constant, last_fetch_constant);
+      }
+    }
+    void OnBoolLoopConstantsWritten(uint32_t first_index, uint32_t count) {}
+  };
+  Handler handler = {*this};
+  register_write_ranges::WriteRange(register_file_->values, start_index, base,
+                                    num_registers, handler);
+}
+
 void NullCommandProcessor::IssueSwap(uint32_t frontbuffer_ptr,
                                      uint32_t frontbuffer_width,
-                                     uint32_t frontbuffer_height) {}
+                                     uint32_t frontbuffer_height) {
+  if (!emulate_cpu_side_) {
+    return;
+  }
+  ++stats_.frame_count;
+
+  primitive_processor_->EndFrame();
+
+  // The frame is considered completed on the host immediately.
+  texture_cache_->CompletedSubmissionUpdated(submission_current_);
+  if (cache_clear_requested_) {
+    cache_clear_requested_ = false;
+    shaders_.clear();
+    texture_cache_->ClearCache();
+    render_target_cache_->ClearCache();
+    shared_memory_->ClearCache();
+  }
+  ++submission_current_;
+  texture_cache_->BeginSubmission(submission_current_);
+  texture_cache_->BeginFrame();
+  render_target_cache_->BeginFrame();
+}
 
 Shader* NullCommandProcessor::LoadShader(xenos::ShaderType shader_type,
                                          uint32_t guest_address,
                                          const uint32_t* host_address,
                                          uint32_t dword_count) {
-  return nullptr;
+  if (!emulate_cpu_side_) {
+    return nullptr;
+  }
+  uint64_t data_hash =
+      XXH3_64bits(host_address, dword_count * sizeof(uint32_t));
+  auto it = shaders_.find(data_hash);
+  if (it != shaders_.end()) {
+    return it->second.get();
+  }
+  auto shader = std::make_unique<DxbcShader>(shader_type, data_hash,
+                                             host_address, dword_count);
+  DxbcShader* shader_ptr = shader.get();
+  shaders_.emplace(data_hash, std::move(shader));
+  return shader_ptr;
+}
+
+DxbcShader::DxbcTranslation* NullCommandProcessor::TranslateShader(
+    DxbcShader& shader, uint64_t modification) {
+  auto translation = static_cast<DxbcShader::DxbcTranslation*>(
+      shader.GetOrCreateTranslation(modification));
+  if (!translation->is_translated()) {
+    StageScope stage_scope(*this, Stage::kShaderTranslation);
+    if (!shader_translator_->TranslateAnalyzedShader(*translation)) {
+      XELOGE("Shader {:016X} translation failed; marking as ignored",
+             shader.ucode_data_hash());
+    }
+  }
+  return translation->is_valid() ? translation : nullptr;
 }
 
 bool NullCommandProcessor::IssueDraw(xenos::PrimitiveType prim_type,
                                      uint32_t index_count,
                                      IndexBufferInfo* index_buffer_info,
                                      bool major_mode_explicit) {
+  if (!emulate_cpu_side_) {
+    return true;
+  }
+
+  const RegisterFile& regs = *register_file_;
+
+  xenos::EdramMode edram_mode = regs.Get<reg::RB_MODECONTROL>().edram_mode;
+  if (edram_mode == xenos::EdramMode::kCopy) {
+    // Special copy handling.
+    return IssueCopy();
+  }
+
+  // Pick up the guest writes to the watched memory since the last draw.
+  shared_memory_->PollGuestWrites();
+
+  ++stats_.draw_count;
+
+  auto vertex_shader = static_cast<DxbcShader*>(active_vertex_shader());
+  if (!vertex_shader) {
+    // Always need a vertex shader.
+    return false;
+  }
+
+  bool primitive_polygonal = draw_util::IsPrimitivePolygonal(regs);
+  bool is_rasterization_done =
+      draw_util::IsRasterizationPotentiallyDone(regs, primitive_polygonal);
+  DxbcShader* pixel_shader = nullptr;
+  {
+    StageScope stage_scope(*this, Stage::kShaderAnalysis);
+    if (!vertex_shader->is_ucode_analyzed()) {
+      vertex_shader->AnalyzeUcode(ucode_disasm_buffer_);
+    }
+    // See xenos::EdramMode for explanation why the pixel shader is only used
+    // when it's kColorDepth here.
+    if (is_rasterization_done && edram_mode == xenos::EdramMode::kColorDepth) {
+      pixel_shader = static_cast<DxbcShader*>(active_pixel_shader());
+      if (pixel_shader) {
+        if (!pixel_shader->is_ucode_analyzed()) {
+          pixel_shader->AnalyzeUcode(ucode_disasm_buffer_);
+        }
+        if (!draw_util::IsPixelShaderNeededWithRasterization(*pixel_shader,
+                                                             regs)) {
+          pixel_shader = nullptr;
+        }
+      }
+    }
+  }
+  if (!is_rasterization_done && !vertex_shader->memexport_eM_written()) {
+    // This draw has no effect.
+    return true;
+  }
+
+  uint32_t ps_param_gen_pos = UINT32_MAX;
+  uint32_t interpolator_mask =
+      pixel_shader ? (vertex_shader->writes_interpolators() &
+                      pixel_shader->GetInterpolatorInputMask(
+                          regs.Get<reg::SQ_PROGRAM_CNTL>(),
+                          regs.Get<reg::SQ_CONTEXT_MISC>(), ps_param_gen_pos))
+                   : 0;
+
+  PrimitiveProcessor::ProcessingResult primitive_processing_result;
+  {
+    StageScope stage_scope(*this, Stage::kPrimitiveProcessing);
+    if (!primitive_processor_->Process(primitive_processing_result)) {
+      return false;
+    }
+  }
+  if (!primitive_processing_result.host_draw_vertex_count) {
+    // Nothing to draw.
+    return true;
+  }
+
+  // Only the parts of the modifications that commonly vary between draws.
+  DxbcShaderTranslator::Modification vertex_shader_modification(
+      shader_translator_->GetDefaultVertexShaderModification(
+          vertex_shader->GetDynamicAddressableRegisterCount(
+              regs.Get<reg::SQ_PROGRAM_CNTL>().vs_num_reg),
+          primitive_processing_result.host_vertex_shader_type));
+  vertex_shader_modification.vertex.interpolator_mask = interpolator_mask;
+  DxbcShader::DxbcTranslation* vertex_shader_translation =
+      TranslateShader(*vertex_shader, vertex_shader_modification.value);
+  if (!vertex_shader_translation) {
+    return false;
+  }
+  if (pixel_shader) {
+    DxbcShaderTranslator::Modification pixel_shader_modification(
+        shader_translator_->GetDefaultPixelShaderModification(
+            pixel_shader->GetDynamicAddressableRegisterCount(
+                regs.Get<reg::SQ_PROGRAM_CNTL>().ps_num_reg)));
+    pixel_shader_modification.pixel.interpolator_mask = interpolator_mask;
+    if (ps_param_gen_pos < xenos::kMaxInterpolators) {
+      pixel_shader_modification.pixel.param_gen_enable = 1;
+      pixel_shader_modification.pixel.param_gen_interpolator =
+          ps_param_gen_pos;
+    }
+    if (!TranslateShader(*pixel_shader, pixel_shader_modification.value)) {
+      return false;
+    }
+  }
+
+  {
+    StageScope stage_scope(*this, Stage::kRenderTargets);
+    reg::RB_DEPTHCONTROL normalized_depth_control =
+        draw_util::GetNormalizedDepthControl(regs);
+    uint32_t normalized_color_mask =
+        pixel_shader ? draw_util::GetNormalizedColorMask(
+                           regs, pixel_shader->writes_color_targets())
+                     : 0;
+    if (!render_target_cache_->Update(is_rasterization_done,
+                                      normalized_depth_control,
+                                      normalized_color_mask, *vertex_shader)) {
+      return false;
+    }
+  }
+
+  {
+    StageScope stage_scope(*this, Stage::kTextures);
+    uint32_t used_texture_mask =
+        vertex_shader->GetUsedTextureMaskAfterTranslation() |
+        (pixel_shader ? pixel_shader->GetUsedTextureMaskAfterTranslation() : 0);
+    texture_cache_->RequestTextures(used_texture_mask);
+  }
+
+  // Ensure vertex buffers are resident, the index buffer is handled by the
+  // primitive processor.
+  {
+    StageScope stage_scope(*this, Stage::kSharedMemory);
+    const Shader::ConstantRegisterMap& constant_map_vertex =
+        vertex_shader->constant_register_map();
+    for (uint32_t i = 0;
+         i < xe::countof(constant_map_vertex.vertex_fetch_bitmap); ++i) {
+      uint32_t vfetch_bits_remaining =
+          constant_map_vertex.vertex_fetch_bitmap[i];
+      uint32_t j;
+      while (xe::bit_scan_forward(vfetch_bits_remaining, &j)) {
+        vfetch_bits_remaining = xe::clear_lowest_bit(vfetch_bits_remaining);
+        xenos::xe_gpu_vertex_fetch_t vfetch_constant =
+            regs.GetVertexFetch(i * 32 + j);
+        if (vfetch_constant.type != xenos::FetchConstantType::kVertex) {
+          continue;
+        }
+        if (!shared_memory_->RequestRange(vfetch_constant.address << 2,
+                                          vfetch_constant.size << 2)) {
+          return false;
+        }
+      }
+    }
+  }
+
   return true;
 }
 
-bool NullCommandProcessor::IssueCopy() { return true; }
+bool NullCommandProcessor::IssueCopy() {
+  if (!emulate_cpu_side_) {
+    return true;
+  }
+  shared_memory_->PollGuestWrites();
+  ++stats_.copy_count;
+  StageScope stage_scope(*this, Stage::kResolves);
+  uint32_t written_address, written_length;
+  return render_target_cache_->Resolve(*memory_, *shared_memory_,
+                                       *texture_cache_, written_address,
+                                       written_length);
+}
 
 void NullCommandProcessor::InitializeTrace() {}
 
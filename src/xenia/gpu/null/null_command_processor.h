@@ -10,7 +10,16 @@
 #ifndef XENIA_GPU_NULL_NULL_COMMAND_PROCESSOR_H_
 #define XENIA_GPU_NULL_NULL_COMMAND_PROCESSOR_H_
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "xenia/base/clock.h"
+#include "xenia/base/string_buffer.h"
 #include "xenia/gpu/command_processor.h"
+#include "xenia/gpu/dxbc_shader.h"
+#include "xenia/gpu/dxbc_shader_translator.h"
 #include "xenia/gpu/null/null_graphics_system.h"
 #include "xenia/gpu/xenos.h"
 #include "xenia/kernel/kernel_state.h"
@@ -19,20 +28,101 @@ namespace xe {
 namespace gpu {
 namespace null {
 
+class NullPrimitiveProcessor;
+class NullRenderTargetCache;
+class NullSharedMemory;
+class NullTextureCache;
+
 class NullCommandProcessor : public CommandProcessor {
  public:
+  // Parts of the CPU-side work of the host GPU backends, timed separately when
+  // emulating it.
+  enum class Stage : uint32_t {
+    // Invalidation of written memory, and uploads of ranges to the host.
+    kSharedMemory,
+    // Index buffer conversion and primitive type selection.
+    kPrimitiveProcessing,
+    kShaderAnalysis,
+    kShaderTranslation,
+    // Texture keys, bindings and loading.
+    kTextures,
+    // Render target keys, ownership and transfers.
+    kRenderTargets,
+    kResolves,
+
+    kCount,
+  };
+
+  struct Stats {
+    uint32_t frame_count = 0;
+    uint32_t draw_count = 0;
+    uint32_t copy_count = 0;
+    // Exclusive of nested stages, in host ticks.
+    std::array<uint64_t, size_t(Stage::kCount)> stage_ticks = {};
+  };
+
+  static const char* GetStageName(Stage stage);
+
+  // With emulate_cpu_side, draws, copies and shaders go through the shared
+  // memory, primitive processor, texture and render target caches and the
+  // shader translator like on a host GPU backend, without anything being
+  // submitted, for measuring the CPU-side cost of GPU emulation (using the
+  // DXBC translator as it's built on every platform). Otherwise, everything is
+  // dropped.
   NullCommandProcessor(NullGraphicsSystem* graphics_system,
-                       kernel::KernelState* kernel_state);
+                       kernel::KernelState* kernel_state,
+                       bool emulate_cpu_side = false);
   ~NullCommandProcessor();
 
+  void ClearCaches() override;
+
   void TracePlaybackWroteMemory(uint32_t base_ptr, uint32_t length) override;
 
   void RestoreEdramSnapshot(const void* snapshot) override;
 
+  bool emulates_cpu_side() const { return emulate_cpu_side_; }
+
+  // Accumulated since the last reset, read only while the command processor is
+  // idle.
+  const Stats& stats() const { return stats_; }
+  void ResetStats() { stats_ = {}; }
+
+  // Attributes the host time until its destruction to a stage, minus the time
+  // of the stages entered meanwhile.
+  class StageScope {
+   public:
+    StageScope(NullCommandProcessor& command_processor, Stage stage)
+        : command_processor_(command_processor),
+          stage_(stage),
+          outer_stage_(command_processor.current_stage_),
+          start_(Clock::QueryHostTickCount()) {
+      command_processor.current_stage_ = stage;
+    }
+    ~StageScope() {
+      uint64_t ticks = Clock::QueryHostTickCount() - start_;
+      auto& stage_ticks = command_processor_.stats_.stage_ticks;
+      stage_ticks[size_t(stage_)] += ticks;
+      if (outer_stage_ != Stage::kCount) {
+        stage_ticks[size_t(outer_stage_)] -= ticks;
+      }
+      command_processor_.current_stage_ = outer_stage_;
+    }
+
+   private:
+    NullCommandProcessor& command_processor_;
+    Stage stage_;
+    Stage outer_stage_;
+    uint64_t start_;
+  };
+
  private:
   bool SetupContext() override;
   void ShutdownContext() override;
 
+  void WriteRegister(uint32_t index, uint32_t value) override;
+  void WriteRegistersFromMem(uint32_t start_index, uint32_t* base,
+                             uint32_t num_registers) override;
+
   void IssueSwap(uint32_t frontbuffer_ptr, uint32_t frontbuffer_width,
                  uint32_t frontbuffer_height) override;
 
@@ -46,6 +136,29 @@ class NullCommandProcessor : public CommandProcessor {
   bool IssueCopy() override;
 
   void InitializeTrace() override;
+
+  DxbcShader::DxbcTranslation* TranslateShader(DxbcShader& shader,
+                                               uint64_t modification);
+
+  bool emulate_cpu_side_;
+
+  std::unique_ptr<NullSharedMemory> shared_memory_;
+  std::unique_ptr<NullPrimitiveProcessor> primitive_processor_;
+  std::unique_ptr<NullRenderTargetCache> render_target_cache_;
+  std::unique_ptr<NullTextureCache> texture_cache_;
+
+  std::unique_ptr<DxbcShaderTranslator> shader_translator_;
+  StringBuffer ucode_disasm_buffer_;
+  // Shaders by ucode hash, including the ones failed to translate.
+  std::unordered_map<uint64_t, std::unique_ptr<DxbcShader>> shaders_;
+
+  bool cache_clear_requested_ = false;
+
+  // Every frame is one submission, completed by the time the next one starts.
+  uint64_t submission_current_ = 1;
+
+  Stats stats_;
+  Stage current_stage_ = Stage::kCount;
 };
 
 }  // namespace null
@@ -19,7 +19,8 @@ namespace xe {
 namespace gpu {
 namespace null {
 
-NullGraphicsSystem::NullGraphicsSystem() {}
+NullGraphicsSystem::NullGraphicsSystem(bool emulate_cpu_side)
+    : emulate_cpu_side_(emulate_cpu_side) {}
 
 NullGraphicsSystem::~NullGraphicsSystem() {}
 
@@ -32,7 +33,9 @@ X_STATUS NullGraphicsSystem::Setup(cpu::Processor* processor,
 #else
   // This is a null graphics system, but we still setup vulkan because UI needs
   // it through us :|
-  provider_ = xe::ui::vulkan::VulkanProvider::Create(false, with_presentation);
+  provider_ = emulate_cpu_side_ ? nullptr
+                                : xe::ui::vulkan::VulkanProvider::Create(
+                                      false, with_presentation);
 #endif
   return GraphicsSystem::Setup(processor, kernel_state, app_context,
                                with_presentation);
@@ -40,7 +43,7 @@ X_STATUS NullGraphicsSystem::Setup(cpu::Processor* processor,
 
 std::unique_ptr<CommandProcessor> NullGraphicsSystem::CreateCommandProcessor() {
   return std::unique_ptr<CommandProcessor>(
-      new NullCommandProcessor(this, kernel_state_));
+      new NullCommandProcessor(this, kernel_state_, emulate_cpu_side_));
 }
 
 }  // namespace null
@@ -21,7 +21,9 @@ namespace null {
 
 class NullGraphicsSystem : public GraphicsSystem {
  public:
-  NullGraphicsSystem();
+  // See NullCommandProcessor for emulate_cpu_side. No host GPU is needed for
+  // it either, so no presentation is possible with it.
+  explicit NullGraphicsSystem(bool emulate_cpu_side = false);
   ~NullGraphicsSystem() override;
 
   static bool IsAvailable() { return true; }
@@ -34,6 +36,8 @@ class NullGraphicsSystem : public GraphicsSystem {
 
  private:
   std::unique_ptr<CommandProcessor> CreateCommandProcessor() override;
+
+  bool emulate_cpu_side_;
 };
 
 }  // namespace null
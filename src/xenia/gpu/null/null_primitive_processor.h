@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_NULL_NULL_PRIMITIVE_PROCESSOR_H_
+#define XENIA_GPU_NULL_NULL_PRIMITIVE_PROCESSOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "xenia/gpu/primitive_processor.h"
+
+namespace xe {
+namespace gpu {
+namespace null {
+
+// Primitive processor with converted indices written to host memory reused
+// between frames. Reports the least capable host, so every conversion the GPU
+// backends may do on the CPU is done.
+class NullPrimitiveProcessor final : public PrimitiveProcessor {
+ public:
+  NullPrimitiveProcessor(const RegisterFile& register_file, Memory& memory,
+                         TraceWriter& trace_writer,
+                         SharedMemory& shared_memory)
+      : PrimitiveProcessor(register_file, memory, trace_writer,
+                           shared_memory) {}
+  ~NullPrimitiveProcessor();
+
+  bool Initialize();
+  void Shutdown(bool from_destructor = false);
+
+  void EndFrame();
+
+ protected:
+  bool InitializeBuiltinIndexBuffer(
+      size_t size_bytes, std::function<void(void*)> fill_callback) override;
+
+  void* RequestHostConvertedIndexBufferForCurrentFrame(
+      xenos::IndexFormat format, uint32_t index_count, bool coalign_for_simd,
+      uint32_t coalignment_original_address,
+      size_t& backend_handle_out) override;
+
+ private:
+  std::unique_ptr<uint8_t[]> builtin_index_buffer_;
+  // Grown as needed, the first frame_index_buffers_used_ ones are in use in the
+  // current frame.
+  std::vector<std::vector<uint8_t>> frame_index_buffers_;
+  size_t frame_index_buffers_used_ = 0;
+};
+
+}  // namespace null
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_NULL_NULL_PRIMITIVE_PROCESSOR_H_
@@ -0,0 +1,103 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/null/null_render_target_cache.h"
+
+#include "xenia/base/logging.h"
+#include "xenia/gpu/draw_util.h"
+
+namespace xe {
+namespace gpu {
+namespace null {
+
+NullRenderTargetCache::~NullRenderTargetCache() { Shutdown(true); }
+
+bool NullRenderTargetCache::Initialize() {
+  InitializeCommon();
+  return true;
+}
+
+void NullRenderTargetCache::Shutdown(bool from_destructor) {
+  if (!from_destructor) {
+    ClearCache();
+  }
+  DestroyAllRenderTargets(true);
+  ShutdownCommon();
+}
+
+bool NullRenderTargetCache::Resolve(const Memory& memory,
+                                    SharedMemory& shared_memory,
+                                    TextureCache& texture_cache,
+                                    uint32_t& written_address_out,
+                                    uint32_t& written_length_out) {
+  written_address_out = 0;
+  written_length_out = 0;
+
+  draw_util::ResolveInfo resolve_info;
+  if (!draw_util::GetResolveInfo(register_file(), memory, trace_writer_,
+                                 draw_resolution_scale_x(),
+                                 draw_resolution_scale_y(), false, false,
+                                 resolve_info)) {
+    return false;
+  }
+
+  // Nothing to copy/clear.
+  if (!resolve_info.coordinate_info.width_div_8 || !resolve_info.height_div_8) {
+    return true;
+  }
+
+  if (resolve_info.copy_dest_extent_length) {
+    uint32_t dump_base;
+    uint32_t dump_row_length_used;
+    uint32_t dump_rows;
+    uint32_t dump_pitch;
+    resolve_info.GetCopyEdramTileSpan(dump_base, dump_row_length_used,
+                                      dump_rows, dump_pitch);
+    GetResolveCopyRectanglesToDump(dump_base, dump_row_length_used, dump_rows,
+                                   dump_pitch, dump_rectangles_);
+
+    draw_util::ResolveCopyShaderConstants copy_shader_constants;
+    uint32_t copy_group_count_x, copy_group_count_y;
+    if (resolve_info.GetCopyShader(
+            draw_resolution_scale_x(), draw_resolution_scale_y(),
+            copy_shader_constants, copy_group_count_x, copy_group_count_y) !=
+        draw_util::ResolveCopyShaderIndex::kUnknown) {
+      if (shared_memory.RequestRange(resolve_info.copy_dest_extent_start,
+                                     resolve_info.copy_dest_extent_length)) {
+        texture_cache.MarkRangeAsResolved(resolve_info.copy_dest_extent_start,
+                                          resolve_info.copy_dest_extent_length);
+        written_address_out = resolve_info.copy_dest_extent_start;
+        written_length_out = resolve_info.copy_dest_extent_length;
+      } else {
+        XELOGE(
+            "NullRenderTargetCache: Failed to obtain the resolve destination "
+            "memory region");
+      }
+    }
+  }
+
+  if (resolve_info.IsClearingDepth() || resolve_info.IsClearingColor()) {
+    Transfer::Rectangle clear_rectangle;
+    RenderTarget* clear_render_targets[2];
+    PrepareHostRenderTargetsResolveClear(
+        resolve_info, clear_rectangle, clear_render_targets[0],
+        clear_transfers_[0], clear_render_targets[1], clear_transfers_[1]);
+  }
+
+  return true;
+}
+
+RenderTargetCache::RenderTarget* NullRenderTargetCache::CreateRenderTarget(
+    RenderTargetKey key) {
+  return new NullRenderTarget(key);
+}
+
+}  // namespace null
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_NULL_NULL_RENDER_TARGET_CACHE_H_
+#define XENIA_GPU_NULL_NULL_RENDER_TARGET_CACHE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "xenia/gpu/register_file.h"
+#include "xenia/gpu/render_target_cache.h"
+#include "xenia/gpu/shared_memory.h"
+#include "xenia/gpu/texture_cache.h"
+#include "xenia/gpu/trace_writer.h"
+#include "xenia/gpu/xenos.h"
+#include "xenia/memory.h"
+
+namespace xe {
+namespace gpu {
+namespace null {
+
+// Host render target path bookkeeping - render target keys, EDRAM ownership
+// and transfers, and the resolve destination ranges - without host render
+// targets.
+class NullRenderTargetCache final : public RenderTargetCache {
+ public:
+  NullRenderTargetCache(const RegisterFile& register_file,
+                        const Memory& memory, TraceWriter& trace_writer)
+      : RenderTargetCache(register_file, memory, &trace_writer, 1, 1),
+        trace_writer_(trace_writer) {}
+  ~NullRenderTargetCache();
+
+  bool Initialize();
+  void Shutdown(bool from_destructor = false);
+
+  Path GetPath() const override { return Path::kHostRenderTargets; }
+
+  // Performs the same preparation as a host GPU backend - looking up the
+  // render targets owning the copied and the cleared EDRAM ranges, and marking
+  // the destination as written - but doesn't copy or clear anything.
+  bool Resolve(const Memory& memory, SharedMemory& shared_memory,
+               TextureCache& texture_cache, uint32_t& written_address_out,
+               uint32_t& written_length_out);
+
+ protected:
+  bool IsGammaFormatHostStorageSeparate() const override { return false; }
+
+  uint32_t GetMaxRenderTargetWidth() const override {
+    return xenos::kTexture2DCubeMaxWidthHeight;
+  }
+  uint32_t GetMaxRenderTargetHeight() const override {
+    return xenos::kTexture2DCubeMaxWidthHeight;
+  }
+
+  RenderTarget* CreateRenderTarget(RenderTargetKey key) override;
+
+  bool IsHostDepthEncodingDifferent(
+      xenos::DepthRenderTargetFormat format) const override {
+    return false;
+  }
+
+ private:
+  class NullRenderTarget final : public RenderTarget {
+   public:
+    explicit NullRenderTarget(RenderTargetKey key) : RenderTarget(key) {}
+  };
+
+  TraceWriter& trace_writer_;
+
+  std::vector<ResolveCopyDumpRectangle> dump_rectangles_;
+  std::vector<Transfer> clear_transfers_[2];
+};
+
+}  // namespace null
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_NULL_NULL_RENDER_TARGET_CACHE_H_
@@ -0,0 +1,60 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/null/null_shared_memory.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "xenia/gpu/null/null_command_processor.h"
+
+namespace xe {
+namespace gpu {
+namespace null {
+
+NullSharedMemory::~NullSharedMemory() { Shutdown(true); }
+
+bool NullSharedMemory::Initialize() {
+  if (!InitializeCommon()) {
+    return false;
+  }
+  upload_buffer_ = std::make_unique<uint8_t[]>(kUploadBufferSize);
+  return true;
+}
+
+void NullSharedMemory::Shutdown(bool from_destructor) {
+  upload_buffer_.reset();
+  if (!from_destructor) {
+    ShutdownCommon();
+  }
+}
+
+bool NullSharedMemory::UploadRanges(
+    const std::pair<uint32_t, uint32_t>* upload_page_ranges,
+    uint32_t num_upload_ranges) {
+  NullCommandProcessor::StageScope stage_scope(
+      command_processor_, NullCommandProcessor::Stage::kSharedMemory);
+  for (uint32_t i = 0; i < num_upload_ranges; ++i) {
+    uint32_t upload_start = upload_page_ranges[i].first << page_size_log2();
+    uint32_t upload_length = upload_page_ranges[i].second << page_size_log2();
+    MakeRangeValid(upload_start, upload_length, false);
+    const uint8_t* source = memory().TranslatePhysical(upload_start);
+    while (upload_length) {
+      uint32_t chunk_length = std::min(upload_length, kUploadBufferSize);
+      std::memcpy(upload_buffer_.get(), source, chunk_length);
+      source += chunk_length;
+      upload_length -= chunk_length;
+    }
+  }
+  return true;
+}
+
+}  // namespace null
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,53 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_NULL_NULL_SHARED_MEMORY_H_
+#define XENIA_GPU_NULL_NULL_SHARED_MEMORY_H_
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "xenia/gpu/shared_memory.h"
+#include "xenia/memory.h"
+
+namespace xe {
+namespace gpu {
+namespace null {
+
+class NullCommandProcessor;
+
+// Shared memory without a host GPU buffer - uploads are copied to a reused
+// staging buffer, like to the upload buffers of the GPU backends, and dropped.
+class NullSharedMemory : public SharedMemory {
+ public:
+  NullSharedMemory(NullCommandProcessor& command_processor, Memory& memory)
+      : SharedMemory(memory), command_processor_(command_processor) {}
+  ~NullSharedMemory() override;
+
+  bool Initialize();
+  void Shutdown(bool from_destructor = false);
+
+ protected:
+  bool UploadRanges(const std::pair<uint32_t, uint32_t>* upload_page_ranges,
+                    uint32_t num_upload_ranges) override;
+
+ private:
+  static constexpr uint32_t kUploadBufferSize = 2 * 1024 * 1024;
+
+  NullCommandProcessor& command_processor_;
+
+  std::unique_ptr<uint8_t[]> upload_buffer_;
+};
+
+}  // namespace null
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_NULL_NULL_SHARED_MEMORY_H_
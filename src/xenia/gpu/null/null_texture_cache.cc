@@ -0,0 +1,69 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/null/null_texture_cache.h"
+
+#include "xenia/base/assert.h"
+
+namespace xe {
+namespace gpu {
+namespace null {
+
+NullTextureCache::~NullTextureCache() { DestroyAllTextures(true); }
+
+uint32_t NullTextureCache::GetHostFormatSwizzle(TextureKey key) const {
+  return xenos::XE_GPU_TEXTURE_SWIZZLE_RGBA;
+}
+
+uint32_t NullTextureCache::GetMaxHostTextureWidthHeight(
+    xenos::DataDimension dimension) const {
+  switch (dimension) {
+    case xenos::DataDimension::k1D:
+    case xenos::DataDimension::k2DOrStacked:
+    case xenos::DataDimension::kCube:
+      return xenos::kTexture2DCubeMaxWidthHeight;
+    case xenos::DataDimension::k3D:
+      return xenos::kTexture3DMaxWidthHeight;
+    default:
+      assert_unhandled_case(dimension);
+      return 0;
+  }
+}
+
+uint32_t NullTextureCache::GetMaxHostTextureDepthOrArraySize(
+    xenos::DataDimension dimension) const {
+  switch (dimension) {
+    case xenos::DataDimension::k1D:
+    case xenos::DataDimension::k2DOrStacked:
+      return xenos::kTexture2DMaxStackDepth;
+    case xenos::DataDimension::k3D:
+      return xenos::kTexture3DMaxDepth;
+    case xenos::DataDimension::kCube:
+      return 6;
+    default:
+      assert_unhandled_case(dimension);
+      return 0;
+  }
+}
+
+std::unique_ptr<TextureCache::Texture> NullTextureCache::CreateTexture(
+    TextureKey key) {
+  return std::make_unique<NullTexture>(*this, key);
+}
+
+bool NullTextureCache::LoadTextureDataFromResidentMemoryImpl(Texture& texture,
+                                                             bool load_base,
+                                                             bool load_mips) {
+  // Done with compute shaders on the host GPU backends.
+  return true;
+}
+
+}  // namespace null
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,60 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_NULL_NULL_TEXTURE_CACHE_H_
+#define XENIA_GPU_NULL_NULL_TEXTURE_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "xenia/gpu/register_file.h"
+#include "xenia/gpu/shared_memory.h"
+#include "xenia/gpu/texture_cache.h"
+#include "xenia/gpu/xenos.h"
+
+namespace xe {
+namespace gpu {
+namespace null {
+
+// Texture cache with textures that have no host objects - keys, bindings,
+// memory watches and the shared memory requests for loading are all handled,
+// but nothing is loaded.
+class NullTextureCache final : public TextureCache {
+ public:
+  NullTextureCache(const RegisterFile& register_file,
+                   SharedMemory& shared_memory)
+      : TextureCache(register_file, shared_memory, 1, 1) {}
+  ~NullTextureCache();
+
+ protected:
+  uint32_t GetHostFormatSwizzle(TextureKey key) const override;
+
+  uint32_t GetMaxHostTextureWidthHeight(
+      xenos::DataDimension dimension) const override;
+  uint32_t GetMaxHostTextureDepthOrArraySize(
+      xenos::DataDimension dimension) const override;
+
+  std::unique_ptr<Texture> CreateTexture(TextureKey key) override;
+
+  bool LoadTextureDataFromResidentMemoryImpl(Texture& texture, bool load_base,
+                                             bool load_mips) override;
+
+ private:
+  class NullTexture final : public Texture {
+   public:
+    NullTexture(NullTextureCache& texture_cache, const TextureKey& key)
+        : Texture(texture_cache, key) {}
+  };
+};
+
+}  // namespace null
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_NULL_NULL_TEXTURE_CACHE_H_
@@ -0,0 +1,143 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xenia/base/clock.h"
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/string.h"
+#include "xenia/emulator.h"
+#include "xenia/gpu/graphics_system.h"
+#include "xenia/gpu/null/null_command_processor.h"
+#include "xenia/gpu/null/null_graphics_system.h"
+#include "xenia/gpu/trace_player.h"
+#include "xenia/xbox.h"
+
+DECLARE_path(target_trace_file);
+
+namespace xe {
+namespace gpu {
+namespace null {
+
+namespace {
+
+double TicksToMilliseconds(uint64_t ticks) {
+  return double(ticks) * 1000.0 / double(Clock::QueryHostTickFrequency());
+}
+
+}  // namespace
+
+// Replays every frame of a trace through the CPU side of GPU emulation - PM4
+// processing and the work the host GPU backends do before submitting anything
+// - without a host GPU, and reports where the time goes. PM4 time is what's
+// left of the wall time after the timed stages.
+int trace_bench_main(const std::vector<std::string>& args) {
+  std::filesystem::path path;
+  if (!cvars::target_trace_file.empty()) {
+    path = cvars::target_trace_file;
+  } else if (args.size() >= 2) {
+    path = xe::to_path(args[1]);
+  }
+  if (path.empty()) {
+    XELOGE("No trace file specified");
+    return 5;
+  }
+  auto abs_path = std::filesystem::absolute(path);
+
+  auto emulator = std::make_unique<Emulator>("", "", "", "");
+  X_STATUS result = emulator->Setup(
+      nullptr, nullptr, false, nullptr,
+      []() {
+        return std::unique_ptr<GraphicsSystem>(new NullGraphicsSystem(true));
+      },
+      nullptr);
+  if (XFAILED(result)) {
+    XELOGE("Failed to setup emulator: {:08X}", result);
+    return 4;
+  }
+  GraphicsSystem* graphics_system = emulator->graphics_system();
+  auto command_processor =
+      static_cast<NullCommandProcessor*>(graphics_system->command_processor());
+
+  auto player = std::make_unique<TracePlayer>(graphics_system);
+  if (!player->Open(xe::path_to_utf8(abs_path))) {
+    XELOGE("Could not load trace file {}", abs_path);
+    return 5;
+  }
+
+  int frame_count = player->frame_count();
+  XELOGI("Replaying {} frames from {}", frame_count, abs_path);
+
+  uint64_t total_wall_ticks = 0;
+  NullCommandProcessor::Stats total_stats;
+  for (int i = 0; i < frame_count; ++i) {
+    command_processor->ResetStats();
+    uint64_t start_ticks = Clock::QueryHostTickCount();
+    if (!i) {
+      // The player starts at frame 0, seek to its end.
+      player->SeekFrame(0);
+      player->SeekCommand(
+          static_cast<int>(player->current_frame()->commands.size() - 1));
+    } else {
+      player->SeekFrame(i);
+    }
+    player->WaitOnPlayback();
+    uint64_t wall_ticks = Clock::QueryHostTickCount() - start_ticks;
+
+    const NullCommandProcessor::Stats& stats = command_processor->stats();
+    uint64_t stage_ticks_sum = 0;
+    for (size_t j = 0; j < size_t(NullCommandProcessor::Stage::kCount); ++j) {
+      stage_ticks_sum += stats.stage_ticks[j];
+      total_stats.stage_ticks[j] += stats.stage_ticks[j];
+    }
+    total_stats.draw_count += stats.draw_count;
+    total_stats.copy_count += stats.copy_count;
+    total_wall_ticks += wall_ticks;
+    XELOGI(
+        "Frame {}: {:.3f} ms ({:.3f} ms PM4), {} draws, {} copies", i,
+        TicksToMilliseconds(wall_ticks),
+        TicksToMilliseconds(wall_ticks - std::min(wall_ticks, stage_ticks_sum)),
+        stats.draw_count, stats.copy_count);
+  }
+
+  uint64_t total_stage_ticks = 0;
+  for (uint64_t stage_ticks : total_stats.stage_ticks) {
+    total_stage_ticks += stage_ticks;
+  }
+  XELOGI("Total: {:.3f} ms for {} frames, {} draws, {} copies",
+         TicksToMilliseconds(total_wall_ticks), frame_count,
+         total_stats.draw_count, total_stats.copy_count);
+  XELOGI("  {:<24}{:.3f} ms", "PM4",
+         TicksToMilliseconds(total_wall_ticks -
+                             std::min(total_wall_ticks, total_stage_ticks)));
+  for (size_t i = 0; i < size_t(NullCommandProcessor::Stage::kCount); ++i) {
+    XELOGI("  {:<24}{:.3f} ms",
+           NullCommandProcessor::GetStageName(NullCommandProcessor::Stage(i)),
+           TicksToMilliseconds(total_stats.stage_ticks[i]));
+  }
+
+  player.reset();
+  emulator.reset();
+  return 0;
+}
+
+}  // namespace null
+}  // namespace gpu
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-gpu-null-trace-bench",
+                      xe::gpu::null::trace_bench_main, "some.trace",
+                      "target_trace_file");
@@ -0,0 +1,1313 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/primitive_conversion.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/platform.h"
+
+#if XE_ARCH_ARM64
+#include <arm_neon.h>
+#endif
+
+#if XE_ARCH_AMD64 && (defined(__GNUC__) || defined(__clang__))
+#define XE_GPU_PRIMITIVE_CONVERSION_AVX2 __attribute__((target("avx2")))
+#else
+#define XE_GPU_PRIMITIVE_CONVERSION_AVX2
+#endif
+
+namespace xe {
+namespace gpu {
+namespace primitive_conversion {
+
+// SIMD processing here assumes that alignment is not required (neither AVX nor
+// Neon requires it) and there's no punishment for using an unaligned access
+// instruction when the data is actually aligned (AVX has separate aligned /
+// unaligned movs, but they have the same performance nowadays; Neon dropped the
+// alignment specifier in AArch64), but truly unaligned access may result in two
+// hardware memory operations if some boundary that is >= vector size is
+// crossed.
+//
+// Therefore, to minimize unaligned access (primarily reads - since we depend on
+// the data immediately), SIMD usage here is performed according to the
+// following pattern (though we try to co-align the destination and the source
+// prior to calling, but still doing all the operations for more code
+// correctness and fewer unobvious conditions):
+// - Until the source pointer is vector-aligned, process the first indices
+//   without SIMD.
+//   - The best possible outcome of this is that both the source and the
+//     destination will be vector-aligned (if they were co-aligned prior to the
+//     call), in this case, neither load nor store instructions will be crossing
+//     cache lines.
+//   - The other possible outcome is that the source will be aligned (1 memory
+//     read per load), while the destination will be unaligned (1-2 memory
+//     writes per store).
+// - Process whole vectors with SIMD.
+// - If there are less elements than a vector can hold remaining, process them
+//   without SIMD.
+// The source and the destination are co-aligned only to 16 bytes, so with
+// AVX2, half of the 32-byte stores may still cross a cache line.
+//
+// We assume that indices are at least aligned to their natural alignment (2 or
+// 4 bytes depending on the format) - the R6xx documentation says that in
+// DRAW_INDEX, INDEX_BASE_LO is word-aligned, and that's required by host
+// graphics APIs.
+
+namespace {
+
+constexpr xenos::Endian GetIndexTransformEndian(IndexTransform transform) {
+  switch (transform) {
+    case IndexTransform::kTo24Swapping8In16:
+      return xenos::Endian::k8in16;
+    case IndexTransform::kTo24Swapping8In32:
+      return xenos::Endian::k8in32;
+    case IndexTransform::kTo24Swapping16In32:
+      return xenos::Endian::k16in32;
+    default:
+      return xenos::Endian::kNone;
+  }
+}
+
+// The number to XOR the byte number within a 32-bit index with to swap it.
+constexpr uint32_t GetEndianSwapByteXor(xenos::Endian endian) {
+  switch (endian) {
+    case xenos::Endian::k8in16:
+      return 1;
+    case xenos::Endian::k8in32:
+      return 3;
+    case xenos::Endian::k16in32:
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+template <IndexTransform kTransform, typename Index>
+Index TransformIndex(Index index) {
+  if constexpr (kTransform == IndexTransform::kPassthrough) {
+    return index;
+  } else {
+    static_assert(sizeof(Index) == sizeof(uint32_t));
+    return xenos::GpuSwapInline(index, GetIndexTransformEndian(kTransform)) &
+           xenos::kVertexIndexMask;
+  }
+}
+
+// The number of the first indices to process without SIMD so the source
+// pointer becomes aligned to the vector size.
+template <uint32_t kAlignment, typename Index>
+uint32_t GetAlignmentPrologueCount(const Index* source, uint32_t count) {
+  uintptr_t misalignment =
+      reinterpret_cast<uintptr_t>(source) & (kAlignment - 1);
+  if (!misalignment) {
+    return 0;
+  }
+  return std::min(count,
+                  uint32_t((kAlignment - misalignment) / sizeof(Index)));
+}
+
+// Scalar kernels, also used for the indices not fitting in whole vectors by the
+// SIMD kernels.
+
+bool IsResetUsedScalar(const uint16_t* source, uint32_t count,
+                       uint16_t reset_index_guest_endian) {
+  while (count--) {
+    if (*(source++) == reset_index_guest_endian) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Only sets the flags to true, doesn't reset them.
+void Get16BitResetIndexUsageScalar(const uint16_t* source, uint32_t count,
+                                   uint16_t reset_index_guest_endian,
+                                   bool& is_reset_index_used_out,
+                                   bool& is_ffff_used_as_vertex_index_out) {
+  while (count--) {
+    uint16_t index = *(source++);
+    if (index == reset_index_guest_endian) {
+      is_reset_index_used_out = true;
+    }
+    if (index == UINT16_MAX) {
+      is_ffff_used_as_vertex_index_out = true;
+    }
+  }
+}
+
+bool IsResetUsedScalar(const uint32_t* source, uint32_t count,
+                       uint32_t reset_index_guest_endian,
+                       uint32_t low_bits_mask_guest_endian) {
+  while (count--) {
+    if ((*(source++) & low_bits_mask_guest_endian) ==
+        reset_index_guest_endian) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void ReplaceResetIndex16To16Scalar(uint16_t* dest, const uint16_t* source,
+                                   uint32_t count,
+                                   uint16_t reset_index_guest_endian) {
+  while (count--) {
+    uint16_t index = *(source++);
+    *(dest++) = index != reset_index_guest_endian ? index : UINT16_MAX;
+  }
+}
+
+void ReplaceResetIndex16To24Scalar(uint32_t* dest, const uint16_t* source,
+                                   uint32_t count,
+                                   uint16_t reset_index_guest_endian) {
+  while (count--) {
+    uint16_t index = *(source++);
+    *(dest++) = index != reset_index_guest_endian ? index : UINT32_MAX;
+  }
+}
+
+template <xenos::Endian kHostSwap>
+void ReplaceResetIndex32To24Scalar(uint32_t* dest, const uint32_t* source,
+                                   uint32_t count,
+                                   uint32_t reset_index_guest_endian,
+                                   uint32_t low_bits_mask_guest_endian) {
+  while (count--) {
+    uint32_t index = *(source++) & low_bits_mask_guest_endian;
+    *(dest++) = index != reset_index_guest_endian
+                    ? xenos::GpuSwapInline(index, kHostSwap)
+                    : UINT32_MAX;
+  }
+}
+
+template <IndexTransform kTransform, typename Index>
+void TransformIndicesScalar(Index* dest, const Index* source, uint32_t count) {
+  while (count--) {
+    *(dest++) = TransformIndex<kTransform>(*(source++));
+  }
+}
+
+// Primitive type conversion is done by gathering every 16 bytes of the output
+// from a 16-byte window of the source with a byte shuffle, which also swaps the
+// bytes of the indices if needed. The output is produced in blocks of multiple
+// 16-byte chunks, with the windows and the shuffles precomputed for the whole
+// block.
+// AVX2 byte shuffles don't cross 128-bit lanes, so a 256-bit vector would have
+// to be assembled from two windows with an insertion, which occupies the same
+// execution port as the shuffle - and it was measured to be slower than the
+// 128-bit gathering, which is used with AVX2 too.
+
+constexpr uint32_t kGatherChunkBytes = 16;
+// With 16-bit and 32-bit indices, triangle fans and quad lists both repeat
+// their patterns after 3 chunks.
+constexpr uint32_t kGatherBlockChunks = 3;
+
+struct GatherBlock {
+  // In indices, relative to the first source index of the block.
+  uint32_t source_offsets[kGatherBlockChunks];
+  // 0x80 for the bytes of the first index of a triangle fan, which is zeroed by
+  // the shuffle and inserted afterwards.
+  uint8_t shuffles[kGatherChunkBytes * kGatherBlockChunks];
+  // The number of source indices, starting from the first source index of the
+  // block, that must be readable for the block.
+  uint32_t source_read_count;
+};
+
+// source_index_function returns the source index, relative to the beginning of
+// the block, for the output index within the block, or a negative value for the
+// first index of a triangle fan.
+template <typename Index, typename SourceIndexFunction>
+constexpr GatherBlock MakeGatherBlock(SourceIndexFunction source_index_function,
+                                      uint32_t swap_byte_xor) {
+  constexpr uint32_t kChunkIndices = kGatherChunkBytes / sizeof(Index);
+  GatherBlock block = {};
+  for (uint32_t chunk = 0; chunk < kGatherBlockChunks; ++chunk) {
+    uint32_t source_offset = UINT32_MAX;
+    for (uint32_t i = 0; i < kChunkIndices; ++i) {
+      int32_t source_index = source_index_function(chunk * kChunkIndices + i);
+      if (source_index >= 0) {
+        source_offset = std::min(source_offset, uint32_t(source_index));
+      }
+    }
+    block.source_offsets[chunk] = source_offset;
+    block.source_read_count =
+        std::max(block.source_read_count, source_offset + kChunkIndices);
+    for (uint32_t i = 0; i < kChunkIndices; ++i) {
+      int32_t source_index = source_index_function(chunk * kChunkIndices + i);
+      for (uint32_t j = 0; j < sizeof(Index); ++j) {
+        block.shuffles[kGatherChunkBytes * chunk + sizeof(Index) * i + j] =
+            source_index >= 0
+                ? uint8_t(sizeof(Index) *
+                              (uint32_t(source_index) - source_offset) +
+                          (j ^ swap_byte_xor))
+                : uint8_t(0x80);
+      }
+    }
+  }
+  return block;
+}
+
+// Triangles (v[i + 1], v[i + 2], v[0]), with the source starting at v[1].
+template <typename IndexType, IndexTransform kIndexTransform>
+struct TriangleFanGather {
+  using Index = IndexType;
+  static constexpr IndexTransform kTransform = kIndexTransform;
+  static constexpr bool kIsFan = true;
+  static constexpr uint32_t kOutputIndicesPerBlock =
+      kGatherChunkBytes * kGatherBlockChunks / sizeof(Index);
+  static constexpr uint32_t kSourceIndicesPerBlock = kOutputIndicesPerBlock / 3;
+  static_assert(kOutputIndicesPerBlock % 3 == 0);
+  static constexpr GatherBlock kBlock = MakeGatherBlock<Index>(
+          [](uint32_t i) -> int32_t {
+            return i % 3 == 2 ? -1 : int32_t(i / 3 + i % 3);
+          },
+          GetEndianSwapByteXor(GetIndexTransformEndian(kTransform)));
+};
+
+// Triangles (v[4i], v[4i + 1], v[4i + 2]), (v[4i], v[4i + 2], v[4i + 3]).
+template <typename IndexType, IndexTransform kIndexTransform>
+struct QuadListGather {
+  using Index = IndexType;
+  static constexpr IndexTransform kTransform = kIndexTransform;
+  static constexpr bool kIsFan = false;
+  static constexpr uint32_t kOutputIndicesPerBlock =
+      kGatherChunkBytes * kGatherBlockChunks / sizeof(Index);
+  static constexpr uint32_t kSourceIndicesPerBlock =
+      kOutputIndicesPerBlock / 6 * 4;
+  static_assert(kOutputIndicesPerBlock % 6 == 0);
+  static constexpr GatherBlock kBlock = MakeGatherBlock<Index>(
+          [](uint32_t i) -> int32_t {
+            uint32_t quad_vertex = i % 6;
+            return int32_t(4 * (i / 6) +
+                           (quad_vertex < 3    ? quad_vertex
+                            : quad_vertex == 3 ? 0
+                                               : quad_vertex - 2));
+          },
+          GetEndianSwapByteXor(GetIndexTransformEndian(kTransform)));
+};
+
+// The number of whole blocks that can be gathered without reading beyond the
+// source.
+template <typename Gather>
+uint32_t GetGatherBlockCount(uint32_t source_index_count) {
+  if (source_index_count < Gather::kBlock.source_read_count) {
+    return 0;
+  }
+  return (source_index_count - Gather::kBlock.source_read_count) /
+             Gather::kSourceIndicesPerBlock +
+         1;
+}
+
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+
+// 128-bit vectors of bytes reinterpreted as needed, with operations used by
+// both SSSE3 and NEON kernels.
+#if XE_ARCH_AMD64
+using Vector128 = __m128i;
+Vector128 LoadVector128(const void* source) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+}
+void StoreVector128(void* dest, Vector128 value) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), value);
+}
+Vector128 ReplicateVector128U8(uint8_t value) {
+  return _mm_set1_epi8(int8_t(value));
+}
+Vector128 ReplicateVector128U16(uint16_t value) {
+  return _mm_set1_epi16(int16_t(value));
+}
+Vector128 ReplicateVector128U32(uint32_t value) {
+  return _mm_set1_epi32(int32_t(value));
+}
+Vector128 AndVector128(Vector128 a, Vector128 b) { return _mm_and_si128(a, b); }
+Vector128 OrVector128(Vector128 a, Vector128 b) { return _mm_or_si128(a, b); }
+Vector128 CompareEqualVector128U8(Vector128 a, Vector128 b) {
+  return _mm_cmpeq_epi8(a, b);
+}
+Vector128 CompareEqualVector128U16(Vector128 a, Vector128 b) {
+  return _mm_cmpeq_epi16(a, b);
+}
+Vector128 CompareEqualVector128U32(Vector128 a, Vector128 b) {
+  return _mm_cmpeq_epi32(a, b);
+}
+// Bytes of the shuffle with the top bit set produce zeros.
+Vector128 ShuffleVector128U8(Vector128 source, Vector128 shuffle) {
+  return _mm_shuffle_epi8(source, shuffle);
+}
+Vector128 InterleaveLowVector128U16(Vector128 a, Vector128 b) {
+  return _mm_unpacklo_epi16(a, b);
+}
+Vector128 InterleaveHighVector128U16(Vector128 a, Vector128 b) {
+  return _mm_unpackhi_epi16(a, b);
+}
+bool IsAnyNonZeroVector128(Vector128 value) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_setzero_si128())) !=
+         0xFFFF;
+}
+#elif XE_ARCH_ARM64
+using Vector128 = uint8x16_t;
+Vector128 LoadVector128(const void* source) {
+  return vld1q_u8(reinterpret_cast<const uint8_t*>(source));
+}
+void StoreVector128(void* dest, Vector128 value) {
+  vst1q_u8(reinterpret_cast<uint8_t*>(dest), value);
+}
+Vector128 ReplicateVector128U8(uint8_t value) { return vdupq_n_u8(value); }
+Vector128 ReplicateVector128U16(uint16_t value) {
+  return vreinterpretq_u8_u16(vdupq_n_u16(value));
+}
+Vector128 ReplicateVector128U32(uint32_t value) {
+  return vreinterpretq_u8_u32(vdupq_n_u32(value));
+}
+Vector128 AndVector128(Vector128 a, Vector128 b) { return vandq_u8(a, b); }
+Vector128 OrVector128(Vector128 a, Vector128 b) { return vorrq_u8(a, b); }
+Vector128 CompareEqualVector128U8(Vector128 a, Vector128 b) {
+  return vceqq_u8(a, b);
+}
+Vector128 CompareEqualVector128U16(Vector128 a, Vector128 b) {
+  return vreinterpretq_u8_u16(
+      vceqq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+}
+Vector128 CompareEqualVector128U32(Vector128 a, Vector128 b) {
+  return vreinterpretq_u8_u32(
+      vceqq_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)));
+}
+// Out-of-range bytes of the shuffle produce zeros.
+Vector128 ShuffleVector128U8(Vector128 source, Vector128 shuffle) {
+  return vqtbl1q_u8(source, shuffle);
+}
+Vector128 InterleaveLowVector128U16(Vector128 a, Vector128 b) {
+  return vreinterpretq_u8_u16(
+      vzip1q_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+}
+Vector128 InterleaveHighVector128U16(Vector128 a, Vector128 b) {
+  return vreinterpretq_u8_u16(
+      vzip2q_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+}
+bool IsAnyNonZeroVector128(Vector128 value) { return vmaxvq_u8(value) != 0; }
+#endif  // XE_ARCH
+
+Vector128 GetEndianSwapShuffle128(xenos::Endian endian) {
+  uint32_t swap_byte_xor = GetEndianSwapByteXor(endian);
+  uint8_t shuffle[16];
+  for (uint32_t i = 0; i < 16; ++i) {
+    shuffle[i] = uint8_t(i ^ swap_byte_xor);
+  }
+  return LoadVector128(shuffle);
+}
+
+bool IsResetUsed128(const uint16_t* source, uint32_t count,
+                    uint16_t reset_index_guest_endian) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<16>(source, count);
+  if (IsResetUsedScalar(source, prologue_count, reset_index_guest_endian)) {
+    return true;
+  }
+  source += prologue_count;
+  count -= prologue_count;
+  Vector128 reset_index_guest_endian_simd =
+      ReplicateVector128U16(reset_index_guest_endian);
+  for (; count >= 8; count -= 8, source += 8) {
+    if (IsAnyNonZeroVector128(CompareEqualVector128U16(
+            LoadVector128(source), reset_index_guest_endian_simd))) {
+      return true;
+    }
+  }
+  return IsResetUsedScalar(source, count, reset_index_guest_endian);
+}
+
+void Get16BitResetIndexUsage128(const uint16_t* source, uint32_t count,
+                                uint16_t reset_index_guest_endian,
+                                bool& is_reset_index_used_out,
+                                bool& is_ffff_used_as_vertex_index_out) {
+  // Optimized for the more common case (reset index not used at all),
+  // therefore not doing early-outs if both conditions are true for a simpler
+  // loop body.
+  uint32_t prologue_count = GetAlignmentPrologueCount<16>(source, count);
+  Get16BitResetIndexUsageScalar(source, prologue_count,
+                                reset_index_guest_endian,
+                                is_reset_index_used_out,
+                                is_ffff_used_as_vertex_index_out);
+  source += prologue_count;
+  count -= prologue_count;
+  Vector128 reset_index_guest_endian_simd =
+      ReplicateVector128U16(reset_index_guest_endian);
+  Vector128 ffff_simd = ReplicateVector128U16(UINT16_MAX);
+  Vector128 is_reset_simd = ReplicateVector128U8(0);
+  Vector128 is_ffff_simd = ReplicateVector128U8(0);
+  for (; count >= 8; count -= 8, source += 8) {
+    Vector128 source_simd = LoadVector128(source);
+    is_reset_simd = OrVector128(
+        is_reset_simd,
+        CompareEqualVector128U16(source_simd, reset_index_guest_endian_simd));
+    is_ffff_simd = OrVector128(
+        is_ffff_simd, CompareEqualVector128U16(source_simd, ffff_simd));
+  }
+  if (IsAnyNonZeroVector128(is_reset_simd)) {
+    is_reset_index_used_out = true;
+  }
+  if (IsAnyNonZeroVector128(is_ffff_simd)) {
+    is_ffff_used_as_vertex_index_out = true;
+  }
+  Get16BitResetIndexUsageScalar(source, count, reset_index_guest_endian,
+                                is_reset_index_used_out,
+                                is_ffff_used_as_vertex_index_out);
+}
+
+bool IsResetUsed128(const uint32_t* source, uint32_t count,
+                    uint32_t reset_index_guest_endian,
+                    uint32_t low_bits_mask_guest_endian) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<16>(source, count);
+  if (IsResetUsedScalar(source, prologue_count, reset_index_guest_endian,
+                        low_bits_mask_guest_endian)) {
+    return true;
+  }
+  source += prologue_count;
+  count -= prologue_count;
+  Vector128 reset_index_guest_endian_simd =
+      ReplicateVector128U32(reset_index_guest_endian);
+  Vector128 low_bits_mask_guest_endian_simd =
+      ReplicateVector128U32(low_bits_mask_guest_endian);
+  for (; count >= 4; count -= 4, source += 4) {
+    if (IsAnyNonZeroVector128(CompareEqualVector128U32(
+            AndVector128(LoadVector128(source),
+                         low_bits_mask_guest_endian_simd),
+            reset_index_guest_endian_simd))) {
+      return true;
+    }
+  }
+  return IsResetUsedScalar(source, count, reset_index_guest_endian,
+                           low_bits_mask_guest_endian);
+}
+
+void ReplaceResetIndex16To16128(uint16_t* dest, const uint16_t* source,
+                                uint32_t count,
+                                uint16_t reset_index_guest_endian) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<16>(source, count);
+  ReplaceResetIndex16To16Scalar(dest, source, prologue_count,
+                                reset_index_guest_endian);
+  dest += prologue_count;
+  source += prologue_count;
+  count -= prologue_count;
+  Vector128 reset_index_guest_endian_simd =
+      ReplicateVector128U16(reset_index_guest_endian);
+  for (; count >= 8; count -= 8, source += 8, dest += 8) {
+    // Comparison produces 0 or 0xFFFF - we need 0xFFFF as the result for the
+    // primitive reset indices, so the result is `index | (index ==
+    // reset_index)`.
+    Vector128 source_simd = LoadVector128(source);
+    StoreVector128(dest, OrVector128(source_simd,
+                                     CompareEqualVector128U16(
+                                         source_simd,
+                                         reset_index_guest_endian_simd)));
+  }
+  ReplaceResetIndex16To16Scalar(dest, source, count, reset_index_guest_endian);
+}
+
+void ReplaceResetIndex16To24128(uint32_t* dest, const uint16_t* source,
+                                uint32_t count,
+                                uint16_t reset_index_guest_endian) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<16>(source, count);
+  ReplaceResetIndex16To24Scalar(dest, source, prologue_count,
+                                reset_index_guest_endian);
+  dest += prologue_count;
+  source += prologue_count;
+  count -= prologue_count;
+  Vector128 reset_index_guest_endian_simd =
+      ReplicateVector128U16(reset_index_guest_endian);
+  for (; count >= 8; count -= 8, source += 8, dest += 8) {
+    // 1) Compare to the reset index as uint16, getting 0 or 0xFFFF.
+    // 2) For primitive reset indices, replace the lower 16 bits with 0xFFFF
+    //    via OR with the comparison result.
+    // 3) Expand to 32-bit, putting 0xFFFF in the upper 16 bits where the
+    //    comparison has passed, creating 0xFFFFFFFF for primitive reset or
+    //    0x0000#### for non-primitive-reset indices (including 0x0000FFFF if
+    //    the original index buffer had 0xFFFF, but the primitive reset index
+    //    is different).
+    Vector128 source_simd = LoadVector128(source);
+    Vector128 are_reset =
+        CompareEqualVector128U16(source_simd, reset_index_guest_endian_simd);
+    Vector128 result = OrVector128(source_simd, are_reset);
+    StoreVector128(dest, InterleaveLowVector128U16(result, are_reset));
+    StoreVector128(dest + 4, InterleaveHighVector128U16(result, are_reset));
+  }
+  ReplaceResetIndex16To24Scalar(dest, source, count, reset_index_guest_endian);
+}
+
+template <xenos::Endian kHostSwap>
+void ReplaceResetIndex32To24128(uint32_t* dest, const uint32_t* source,
+                                uint32_t count,
+                                uint32_t reset_index_guest_endian,
+                                uint32_t low_bits_mask_guest_endian) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<16>(source, count);
+  ReplaceResetIndex32To24Scalar<kHostSwap>(dest, source, prologue_count,
+                                           reset_index_guest_endian,
+                                           low_bits_mask_guest_endian);
+  dest += prologue_count;
+  source += prologue_count;
+  count -= prologue_count;
+  Vector128 reset_index_guest_endian_simd =
+      ReplicateVector128U32(reset_index_guest_endian);
+  Vector128 low_bits_mask_guest_endian_simd =
+      ReplicateVector128U32(low_bits_mask_guest_endian);
+  Vector128 host_swap_shuffle = GetEndianSwapShuffle128(kHostSwap);
+  for (; count >= 4; count -= 4, source += 4, dest += 4) {
+    Vector128 source_simd =
+        AndVector128(LoadVector128(source), low_bits_mask_guest_endian_simd);
+    Vector128 result = OrVector128(
+        source_simd,
+        CompareEqualVector128U32(source_simd, reset_index_guest_endian_simd));
+    if constexpr (kHostSwap != xenos::Endian::kNone) {
+      result = ShuffleVector128U8(result, host_swap_shuffle);
+    }
+    StoreVector128(dest, result);
+  }
+  ReplaceResetIndex32To24Scalar<kHostSwap>(dest, source, count,
+                                           reset_index_guest_endian,
+                                           low_bits_mask_guest_endian);
+}
+
+template <IndexTransform kTransform>
+void TransformIndices128(uint32_t* dest, const uint32_t* source,
+                         uint32_t count) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<16>(source, count);
+  TransformIndicesScalar<kTransform>(dest, source, prologue_count);
+  dest += prologue_count;
+  source += prologue_count;
+  count -= prologue_count;
+  Vector128 swap_shuffle =
+      GetEndianSwapShuffle128(GetIndexTransformEndian(kTransform));
+  Vector128 mask = ReplicateVector128U32(xenos::kVertexIndexMask);
+  for (; count >= 4; count -= 4, source += 4, dest += 4) {
+    StoreVector128(dest, AndVector128(ShuffleVector128U8(LoadVector128(source),
+                                                         swap_shuffle),
+                                      mask));
+  }
+  TransformIndicesScalar<kTransform>(dest, source, count);
+}
+
+// Returns the number of blocks written.
+template <typename Gather>
+uint32_t Gather128(typename Gather::Index* dest,
+                   const typename Gather::Index* source,
+                   uint32_t source_index_count,
+                   typename Gather::Index fan_first_index) {
+  constexpr uint32_t kChunkIndices =
+      kGatherChunkBytes / sizeof(typename Gather::Index);
+  Vector128 shuffles[kGatherBlockChunks];
+  Vector128 fan_first_chunks[kGatherBlockChunks];
+  Vector128 fan_first_index_simd =
+      sizeof(typename Gather::Index) == sizeof(uint16_t)
+          ? ReplicateVector128U16(uint16_t(fan_first_index))
+          : ReplicateVector128U32(uint32_t(fan_first_index));
+  for (uint32_t i = 0; i < kGatherBlockChunks; ++i) {
+    shuffles[i] =
+        LoadVector128(Gather::kBlock.shuffles + kGatherChunkBytes * i);
+    if constexpr (Gather::kIsFan) {
+      fan_first_chunks[i] = AndVector128(
+          fan_first_index_simd,
+          CompareEqualVector128U8(shuffles[i], ReplicateVector128U8(0x80)));
+    }
+  }
+  Vector128 mask = ReplicateVector128U32(xenos::kVertexIndexMask);
+  auto gather_chunk = [&](uint32_t chunk) {
+    Vector128 result = ShuffleVector128U8(
+        LoadVector128(source + Gather::kBlock.source_offsets[chunk]),
+        shuffles[chunk]);
+    if constexpr (Gather::kTransform != IndexTransform::kPassthrough) {
+      result = AndVector128(result, mask);
+    }
+    if constexpr (Gather::kIsFan) {
+      result = OrVector128(result, fan_first_chunks[chunk]);
+    }
+    StoreVector128(dest + kChunkIndices * chunk, result);
+  };
+  uint32_t block_count = GetGatherBlockCount<Gather>(source_index_count);
+  for (uint32_t i = 0; i < block_count; ++i) {
+    // Not relying on the compiler to unroll the loop over the chunks so the
+    // window offsets are immediates.
+    static_assert(kGatherBlockChunks == 3);
+    gather_chunk(0);
+    gather_chunk(1);
+    gather_chunk(2);
+    source += Gather::kSourceIndicesPerBlock;
+    dest += Gather::kOutputIndicesPerBlock;
+  }
+  return block_count;
+}
+
+#endif  // XE_ARCH_AMD64 || XE_ARCH_ARM64
+
+#if XE_ARCH_AMD64
+
+XE_GPU_PRIMITIVE_CONVERSION_AVX2
+__m256i GetEndianSwapShuffleAVX2(xenos::Endian endian) {
+  return _mm256_broadcastsi128_si256(GetEndianSwapShuffle128(endian));
+}
+
+XE_GPU_PRIMITIVE_CONVERSION_AVX2
+bool IsResetUsedAVX2(const uint16_t* source, uint32_t count,
+                     uint16_t reset_index_guest_endian) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<32>(source, count);
+  if (IsResetUsedScalar(source, prologue_count, reset_index_guest_endian)) {
+    return true;
+  }
+  source += prologue_count;
+  count -= prologue_count;
+  __m256i reset_index_guest_endian_simd =
+      _mm256_set1_epi16(int16_t(reset_index_guest_endian));
+  for (; count >= 16; count -= 16, source += 16) {
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(source)),
+            reset_index_guest_endian_simd))) {
+      return true;
+    }
+  }
+  return IsResetUsedScalar(source, count, reset_index_guest_endian);
+}
+
+XE_GPU_PRIMITIVE_CONVERSION_AVX2
+void Get16BitResetIndexUsageAVX2(const uint16_t* source, uint32_t count,
+                                 uint16_t reset_index_guest_endian,
+                                 bool& is_reset_index_used_out,
+                                 bool& is_ffff_used_as_vertex_index_out) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<32>(source, count);
+  Get16BitResetIndexUsageScalar(source, prologue_count,
+                                reset_index_guest_endian,
+                                is_reset_index_used_out,
+                                is_ffff_used_as_vertex_index_out);
+  source += prologue_count;
+  count -= prologue_count;
+  __m256i reset_index_guest_endian_simd =
+      _mm256_set1_epi16(int16_t(reset_index_guest_endian));
+  __m256i ffff_simd = _mm256_set1_epi16(-1);
+  __m256i is_reset_simd = _mm256_setzero_si256();
+  __m256i is_ffff_simd = _mm256_setzero_si256();
+  for (; count >= 16; count -= 16, source += 16) {
+    __m256i source_simd =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(source));
+    is_reset_simd = _mm256_or_si256(
+        is_reset_simd,
+        _mm256_cmpeq_epi16(source_simd, reset_index_guest_endian_simd));
+    is_ffff_simd = _mm256_or_si256(is_ffff_simd,
+                                   _mm256_cmpeq_epi16(source_simd, ffff_simd));
+  }
+  if (!_mm256_testz_si256(is_reset_simd, is_reset_simd)) {
+    is_reset_index_used_out = true;
+  }
+  if (!_mm256_testz_si256(is_ffff_simd, is_ffff_simd)) {
+    is_ffff_used_as_vertex_index_out = true;
+  }
+  Get16BitResetIndexUsageScalar(source, count, reset_index_guest_endian,
+                                is_reset_index_used_out,
+                                is_ffff_used_as_vertex_index_out);
+}
+
+XE_GPU_PRIMITIVE_CONVERSION_AVX2
+bool IsResetUsedAVX2(const uint32_t* source, uint32_t count,
+                     uint32_t reset_index_guest_endian,
+                     uint32_t low_bits_mask_guest_endian) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<32>(source, count);
+  if (IsResetUsedScalar(source, prologue_count, reset_index_guest_endian,
+                        low_bits_mask_guest_endian)) {
+    return true;
+  }
+  source += prologue_count;
+  count -= prologue_count;
+  __m256i reset_index_guest_endian_simd =
+      _mm256_set1_epi32(int32_t(reset_index_guest_endian));
+  __m256i low_bits_mask_guest_endian_simd =
+      _mm256_set1_epi32(int32_t(low_bits_mask_guest_endian));
+  for (; count >= 8; count -= 8, source += 8) {
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(
+            _mm256_and_si256(
+                _mm256_load_si256(reinterpret_cast<const __m256i*>(source)),
+                low_bits_mask_guest_endian_simd),
+            reset_index_guest_endian_simd))) {
+      return true;
+    }
+  }
+  return IsResetUsedScalar(source, count, reset_index_guest_endian,
+                           low_bits_mask_guest_endian);
+}
+
+XE_GPU_PRIMITIVE_CONVERSION_AVX2
+void ReplaceResetIndex16To16AVX2(uint16_t* dest, const uint16_t* source,
+                                 uint32_t count,
+                                 uint16_t reset_index_guest_endian) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<32>(source, count);
+  ReplaceResetIndex16To16Scalar(dest, source, prologue_count,
+                                reset_index_guest_endian);
+  dest += prologue_count;
+  source += prologue_count;
+  count -= prologue_count;
+  __m256i reset_index_guest_endian_simd =
+      _mm256_set1_epi16(int16_t(reset_index_guest_endian));
+  for (; count >= 16; count -= 16, source += 16, dest += 16) {
+    __m256i source_simd =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(source));
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dest),
+        _mm256_or_si256(source_simd,
+                        _mm256_cmpeq_epi16(source_simd,
+                                           reset_index_guest_endian_simd)));
+  }
+  ReplaceResetIndex16To16Scalar(dest, source, count, reset_index_guest_endian);
+}
+
+XE_GPU_PRIMITIVE_CONVERSION_AVX2
+void ReplaceResetIndex16To24AVX2(uint32_t* dest, const uint16_t* source,
+                                 uint32_t count,
+                                 uint16_t reset_index_guest_endian) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<32>(source, count);
+  ReplaceResetIndex16To24Scalar(dest, source, prologue_count,
+                                reset_index_guest_endian);
+  dest += prologue_count;
+  source += prologue_count;
+  count -= prologue_count;
+  // Zero-extending, and comparing as 32-bit, so the reset indices become
+  // 0xFFFFFFFF after the OR, without lane-crossing interleaving.
+  __m256i reset_index_guest_endian_simd =
+      _mm256_set1_epi32(int32_t(reset_index_guest_endian));
+  for (; count >= 16; count -= 16, source += 16, dest += 16) {
+    for (uint32_t i = 0; i < 2; ++i) {
+      __m256i source_simd = _mm256_cvtepu16_epi32(
+          _mm_load_si128(reinterpret_cast<const __m128i*>(source + 8 * i)));
+      _mm256_storeu_si256(
+          reinterpret_cast<__m256i*>(dest + 8 * i),
+          _mm256_or_si256(source_simd,
+                          _mm256_cmpeq_epi32(source_simd,
+                                             reset_index_guest_endian_simd)));
+    }
+  }
+  ReplaceResetIndex16To24Scalar(dest, source, count, reset_index_guest_endian);
+}
+
+template <xenos::Endian kHostSwap>
+XE_GPU_PRIMITIVE_CONVERSION_AVX2 void ReplaceResetIndex32To24AVX2(
+    uint32_t* dest, const uint32_t* source, uint32_t count,
+    uint32_t reset_index_guest_endian, uint32_t low_bits_mask_guest_endian) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<32>(source, count);
+  ReplaceResetIndex32To24Scalar<kHostSwap>(dest, source, prologue_count,
+                                           reset_index_guest_endian,
+                                           low_bits_mask_guest_endian);
+  dest += prologue_count;
+  source += prologue_count;
+  count -= prologue_count;
+  __m256i reset_index_guest_endian_simd =
+      _mm256_set1_epi32(int32_t(reset_index_guest_endian));
+  __m256i low_bits_mask_guest_endian_simd =
+      _mm256_set1_epi32(int32_t(low_bits_mask_guest_endian));
+  __m256i host_swap_shuffle = GetEndianSwapShuffleAVX2(kHostSwap);
+  for (; count >= 8; count -= 8, source += 8, dest += 8) {
+    __m256i source_simd = _mm256_and_si256(
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(source)),
+        low_bits_mask_guest_endian_simd);
+    __m256i result = _mm256_or_si256(
+        source_simd,
+        _mm256_cmpeq_epi32(source_simd, reset_index_guest_endian_simd));
+    if constexpr (kHostSwap != xenos::Endian::kNone) {
+      result = _mm256_shuffle_epi8(result, host_swap_shuffle);
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), result);
+  }
+  ReplaceResetIndex32To24Scalar<kHostSwap>(dest, source, count,
+                                           reset_index_guest_endian,
+                                           low_bits_mask_guest_endian);
+}
+
+template <IndexTransform kTransform>
+XE_GPU_PRIMITIVE_CONVERSION_AVX2 void TransformIndicesAVX2(
+    uint32_t* dest, const uint32_t* source, uint32_t count) {
+  uint32_t prologue_count = GetAlignmentPrologueCount<32>(source, count);
+  TransformIndicesScalar<kTransform>(dest, source, prologue_count);
+  dest += prologue_count;
+  source += prologue_count;
+  count -= prologue_count;
+  __m256i swap_shuffle =
+      GetEndianSwapShuffleAVX2(GetIndexTransformEndian(kTransform));
+  __m256i mask = _mm256_set1_epi32(int32_t(xenos::kVertexIndexMask));
+  for (; count >= 8; count -= 8, source += 8, dest += 8) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(dest),
+        _mm256_and_si256(
+            _mm256_shuffle_epi8(
+                _mm256_load_si256(reinterpret_cast<const __m256i*>(source)),
+                swap_shuffle),
+            mask));
+  }
+  TransformIndicesScalar<kTransform>(dest, source, count);
+}
+
+#endif  // XE_ARCH_AMD64
+
+template <typename Index, IndexTransform kTransform>
+void TriangleFanToListForTransform(Index* dest, const Index* source,
+                                   uint32_t source_index_count, Isa isa) {
+  if (source_index_count <= 2) {
+    // To match PrimitiveProcessor::GetTriangleFanListIndexCount.
+    return;
+  }
+  Index index_first = TransformIndex<kTransform>(source[0]);
+  // Gathering from v[1].
+  uint32_t triangles_done = 0;
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+  if (isa != Isa::kScalar) {
+    using Gather = TriangleFanGather<Index, kTransform>;
+    triangles_done = Gather::kSourceIndicesPerBlock *
+                     Gather128<Gather>(dest, source + 1,
+                                       source_index_count - 1, index_first);
+  }
+#endif
+  dest += 3 * triangles_done;
+  Index index_previous = TransformIndex<kTransform>(source[1 + triangles_done]);
+  for (uint32_t i = 2 + triangles_done; i < source_index_count; ++i) {
+    Index index_current = TransformIndex<kTransform>(source[i]);
+    *(dest++) = index_previous;
+    *(dest++) = index_current;
+    *(dest++) = index_first;
+    index_previous = index_current;
+  }
+}
+
+template <typename Index, IndexTransform kTransform>
+void QuadListToTriangleListForTransform(Index* dest, const Index* source,
+                                        uint32_t source_index_count, Isa isa) {
+  uint32_t quads_done = 0;
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+  if (isa != Isa::kScalar) {
+    using Gather = QuadListGather<Index, kTransform>;
+    quads_done = Gather::kSourceIndicesPerBlock / 4 *
+                 Gather128<Gather>(dest, source, source_index_count, 0);
+  }
+#endif
+  dest += 6 * quads_done;
+  source += 4 * quads_done;
+  uint32_t quad_count = source_index_count / 4;
+  for (uint32_t i = quads_done; i < quad_count; ++i) {
+    // TODO(Triang3l): Find the correct order.
+    // v0, v1, v2.
+    Index common_index_0 = TransformIndex<kTransform>(*(source++));
+    *(dest++) = common_index_0;
+    *(dest++) = TransformIndex<kTransform>(*(source++));
+    Index common_index_2 = TransformIndex<kTransform>(*(source++));
+    *(dest++) = common_index_2;
+    // v0, v2, v3.
+    *(dest++) = common_index_0;
+    *(dest++) = common_index_2;
+    *(dest++) = TransformIndex<kTransform>(*(source++));
+  }
+}
+
+template <IndexTransform kTransform>
+void LineLoopToStripForTransform(uint32_t* dest, const uint32_t* source,
+                                 uint32_t source_index_count, Isa isa) {
+  switch (isa) {
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+    case Isa::k128:
+      TransformIndices128<kTransform>(dest, source, source_index_count);
+      break;
+#endif
+#if XE_ARCH_AMD64
+    case Isa::kAVX2:
+      TransformIndicesAVX2<kTransform>(dest, source, source_index_count);
+      break;
+#endif
+    default:
+      TransformIndicesScalar<kTransform>(dest, source, source_index_count);
+      break;
+  }
+  dest[source_index_count] = dest[0];
+}
+
+template <xenos::Endian kHostSwap>
+void ReplaceResetIndex32To24ForSwap(uint32_t* dest, const uint32_t* source,
+                                    uint32_t count,
+                                    uint32_t reset_index_guest_endian,
+                                    uint32_t low_bits_mask_guest_endian,
+                                    Isa isa) {
+  switch (isa) {
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+    case Isa::k128:
+      ReplaceResetIndex32To24128<kHostSwap>(dest, source, count,
+                                            reset_index_guest_endian,
+                                            low_bits_mask_guest_endian);
+      break;
+#endif
+#if XE_ARCH_AMD64
+    case Isa::kAVX2:
+      ReplaceResetIndex32To24AVX2<kHostSwap>(dest, source, count,
+                                             reset_index_guest_endian,
+                                             low_bits_mask_guest_endian);
+      break;
+#endif
+    default:
+      ReplaceResetIndex32To24Scalar<kHostSwap>(dest, source, count,
+                                               reset_index_guest_endian,
+                                               low_bits_mask_guest_endian);
+      break;
+  }
+}
+
+}  // namespace
+
+const char* GetIsaName(Isa isa) {
+  switch (isa) {
+    case Isa::kScalar:
+      return "scalar";
+    case Isa::k128:
+#if XE_ARCH_ARM64
+      return "NEON";
+#else
+      return "SSSE3";
+#endif
+    case Isa::kAVX2:
+      return "AVX2";
+    default:
+      return "unknown";
+  }
+}
+
+bool IsIsaSupported(Isa isa) {
+  switch (isa) {
+    case Isa::kScalar:
+      return true;
+    case Isa::k128:
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+      return true;
+#else
+      return false;
+#endif
+    case Isa::kAVX2:
+#if XE_ARCH_AMD64
+      return (amd64::GetFeatureFlags() & amd64::kX64EmitAVX2) != 0;
+#else
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+Isa GetBestIsa() {
+  static const Isa best_isa = []() {
+    for (uint32_t i = uint32_t(Isa::kCount); i > 0; --i) {
+      if (IsIsaSupported(Isa(i - 1))) {
+        return Isa(i - 1);
+      }
+    }
+    return Isa::kScalar;
+  }();
+  return best_isa;
+}
+
+IndexTransform GetTo24IndexTransform(xenos::Endian endian) {
+  switch (endian) {
+    case xenos::Endian::k8in16:
+      return IndexTransform::kTo24Swapping8In16;
+    case xenos::Endian::k8in32:
+      return IndexTransform::kTo24Swapping8In32;
+    case xenos::Endian::k16in32:
+      return IndexTransform::kTo24Swapping16In32;
+    default:
+      return IndexTransform::kTo24NonSwapping;
+  }
+}
+
+bool IsResetUsed(const uint16_t* source, uint32_t count,
+                 uint16_t reset_index_guest_endian, Isa isa) {
+  assert_true(IsIsaSupported(isa));
+  switch (isa) {
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+    case Isa::k128:
+      return IsResetUsed128(source, count, reset_index_guest_endian);
+#endif
+#if XE_ARCH_AMD64
+    case Isa::kAVX2:
+      return IsResetUsedAVX2(source, count, reset_index_guest_endian);
+#endif
+    default:
+      return IsResetUsedScalar(source, count, reset_index_guest_endian);
+  }
+}
+
+void Get16BitResetIndexUsage(const uint16_t* source, uint32_t count,
+                             uint16_t reset_index_guest_endian,
+                             bool& is_reset_index_used_out,
+                             bool& is_ffff_used_as_vertex_index_out, Isa isa) {
+  assert_true(IsIsaSupported(isa));
+  // Optimized for the more common case (reset index not used at all),
+  // therefore not doing early-outs if both conditions are true for a simpler
+  // loop body. Using the index 0xFFFF is likely not that common in general.
+  // TODO(Triang3l): Revisit this - maybe the early-out will be free if this
+  // function is bandwidth-bound.
+  is_ffff_used_as_vertex_index_out = false;
+  if (reset_index_guest_endian == UINT16_MAX) {
+    is_reset_index_used_out =
+        IsResetUsed(source, count, reset_index_guest_endian, isa);
+    return;
+  }
+  is_reset_index_used_out = false;
+  switch (isa) {
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+    case Isa::k128:
+      Get16BitResetIndexUsage128(source, count, reset_index_guest_endian,
+                                 is_reset_index_used_out,
+                                 is_ffff_used_as_vertex_index_out);
+      break;
+#endif
+#if XE_ARCH_AMD64
+    case Isa::kAVX2:
+      Get16BitResetIndexUsageAVX2(source, count, reset_index_guest_endian,
+                                  is_reset_index_used_out,
+                                  is_ffff_used_as_vertex_index_out);
+      break;
+#endif
+    default:
+      Get16BitResetIndexUsageScalar(source, count, reset_index_guest_endian,
+                                    is_reset_index_used_out,
+                                    is_ffff_used_as_vertex_index_out);
+      break;
+  }
+}
+
+bool IsResetUsed(const uint32_t* source, uint32_t count,
+                 uint32_t reset_index_guest_endian,
+                 uint32_t low_bits_mask_guest_endian, Isa isa) {
+  assert_true(IsIsaSupported(isa));
+  switch (isa) {
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+    case Isa::k128:
+      return IsResetUsed128(source, count, reset_index_guest_endian,
+                            low_bits_mask_guest_endian);
+#endif
+#if XE_ARCH_AMD64
+    case Isa::kAVX2:
+      return IsResetUsedAVX2(source, count, reset_index_guest_endian,
+                             low_bits_mask_guest_endian);
+#endif
+    default:
+      return IsResetUsedScalar(source, count, reset_index_guest_endian,
+                               low_bits_mask_guest_endian);
+  }
+}
+
+void ReplaceResetIndex16To16(uint16_t* dest, const uint16_t* source,
+                             uint32_t count, uint16_t reset_index_guest_endian,
+                             Isa isa) {
+  assert_true(IsIsaSupported(isa));
+  switch (isa) {
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+    case Isa::k128:
+      ReplaceResetIndex16To16128(dest, source, count,
+                                 reset_index_guest_endian);
+      break;
+#endif
+#if XE_ARCH_AMD64
+    case Isa::kAVX2:
+      ReplaceResetIndex16To16AVX2(dest, source, count,
+                                  reset_index_guest_endian);
+      break;
+#endif
+    default:
+      ReplaceResetIndex16To16Scalar(dest, source, count,
+                                    reset_index_guest_endian);
+      break;
+  }
+}
+
+void ReplaceResetIndex16To24(uint32_t* dest, const uint16_t* source,
+                             uint32_t count, uint16_t reset_index_guest_endian,
+                             Isa isa) {
+  assert_true(IsIsaSupported(isa));
+  switch (isa) {
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+    case Isa::k128:
+      ReplaceResetIndex16To24128(dest, source, count,
+                                 reset_index_guest_endian);
+      break;
+#endif
+#if XE_ARCH_AMD64
+    case Isa::kAVX2:
+      ReplaceResetIndex16To24AVX2(dest, source, count,
+                                  reset_index_guest_endian);
+      break;
+#endif
+    default:
+      ReplaceResetIndex16To24Scalar(dest, source, count,
+                                    reset_index_guest_endian);
+      break;
+  }
+}
+
+void ReplaceResetIndex32To24(uint32_t* dest, const uint32_t* source,
+                             uint32_t count, uint32_t reset_index_guest_endian,
+                             uint32_t low_bits_mask_guest_endian,
+                             xenos::Endian host_swap, Isa isa) {
+  assert_true(IsIsaSupported(isa));
+  switch (host_swap) {
+    case xenos::Endian::k8in16:
+      ReplaceResetIndex32To24ForSwap<xenos::Endian::k8in16>(
+          dest, source, count, reset_index_guest_endian,
+          low_bits_mask_guest_endian, isa);
+      break;
+    case xenos::Endian::k8in32:
+      ReplaceResetIndex32To24ForSwap<xenos::Endian::k8in32>(
+          dest, source, count, reset_index_guest_endian,
+          low_bits_mask_guest_endian, isa);
+      break;
+    case xenos::Endian::k16in32:
+      ReplaceResetIndex32To24ForSwap<xenos::Endian::k16in32>(
+          dest, source, count, reset_index_guest_endian,
+          low_bits_mask_guest_endian, isa);
+      break;
+    default:
+      ReplaceResetIndex32To24ForSwap<xenos::Endian::kNone>(
+          dest, source, count, reset_index_guest_endian,
+          low_bits_mask_guest_endian, isa);
+      break;
+  }
+}
+
+void TriangleFanToList(uint16_t* dest, const uint16_t* source,
+                       uint32_t source_index_count,
+                       IndexTransform index_transform, Isa isa) {
+  assert_true(index_transform == IndexTransform::kPassthrough);
+  assert_true(IsIsaSupported(isa));
+  TriangleFanToListForTransform<uint16_t, IndexTransform::kPassthrough>(
+      dest, source, source_index_count, isa);
+}
+
+void TriangleFanToList(uint32_t* dest, const uint32_t* source,
+                       uint32_t source_index_count,
+                       IndexTransform index_transform, Isa isa) {
+  assert_true(IsIsaSupported(isa));
+  switch (index_transform) {
+    case IndexTransform::kPassthrough:
+      TriangleFanToListForTransform<uint32_t, IndexTransform::kPassthrough>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24NonSwapping:
+      TriangleFanToListForTransform<uint32_t,
+                                    IndexTransform::kTo24NonSwapping>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24Swapping8In16:
+      TriangleFanToListForTransform<uint32_t,
+                                    IndexTransform::kTo24Swapping8In16>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24Swapping8In32:
+      TriangleFanToListForTransform<uint32_t,
+                                    IndexTransform::kTo24Swapping8In32>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24Swapping16In32:
+      TriangleFanToListForTransform<uint32_t,
+                                    IndexTransform::kTo24Swapping16In32>(
+          dest, source, source_index_count, isa);
+      break;
+    default:
+      assert_unhandled_case(index_transform);
+  }
+}
+
+void LineLoopToStrip(uint16_t* dest, const uint16_t* source,
+                     uint32_t source_index_count,
+                     IndexTransform index_transform, Isa isa) {
+  assert_true(index_transform == IndexTransform::kPassthrough);
+  if (source_index_count <= 1) {
+    // To match PrimitiveProcessor::GetLineLoopStripIndexCount.
+    return;
+  }
+  std::memcpy(dest, source, sizeof(*source) * source_index_count);
+  dest[source_index_count] = source[0];
+}
+
+void LineLoopToStrip(uint32_t* dest, const uint32_t* source,
+                     uint32_t source_index_count,
+                     IndexTransform index_transform, Isa isa) {
+  assert_true(IsIsaSupported(isa));
+  if (source_index_count <= 1) {
+    // To match PrimitiveProcessor::GetLineLoopStripIndexCount.
+    return;
+  }
+  switch (index_transform) {
+    case IndexTransform::kPassthrough:
+      std::memcpy(dest, source, sizeof(*source) * source_index_count);
+      dest[source_index_count] = source[0];
+      break;
+    case IndexTransform::kTo24NonSwapping:
+      LineLoopToStripForTransform<IndexTransform::kTo24NonSwapping>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24Swapping8In16:
+      LineLoopToStripForTransform<IndexTransform::kTo24Swapping8In16>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24Swapping8In32:
+      LineLoopToStripForTransform<IndexTransform::kTo24Swapping8In32>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24Swapping16In32:
+      LineLoopToStripForTransform<IndexTransform::kTo24Swapping16In32>(
+          dest, source, source_index_count, isa);
+      break;
+    default:
+      assert_unhandled_case(index_transform);
+  }
+}
+
+void QuadListToTriangleList(uint16_t* dest, const uint16_t* source,
+                            uint32_t source_index_count,
+                            IndexTransform index_transform, Isa isa) {
+  assert_true(index_transform == IndexTransform::kPassthrough);
+  assert_true(IsIsaSupported(isa));
+  QuadListToTriangleListForTransform<uint16_t, IndexTransform::kPassthrough>(
+      dest, source, source_index_count, isa);
+}
+
+void QuadListToTriangleList(uint32_t* dest, const uint32_t* source,
+                            uint32_t source_index_count,
+                            IndexTransform index_transform, Isa isa) {
+  assert_true(IsIsaSupported(isa));
+  switch (index_transform) {
+    case IndexTransform::kPassthrough:
+      QuadListToTriangleListForTransform<uint32_t,
+                                         IndexTransform::kPassthrough>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24NonSwapping:
+      QuadListToTriangleListForTransform<uint32_t,
+                                         IndexTransform::kTo24NonSwapping>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24Swapping8In16:
+      QuadListToTriangleListForTransform<uint32_t,
+                                         IndexTransform::kTo24Swapping8In16>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24Swapping8In32:
+      QuadListToTriangleListForTransform<uint32_t,
+                                         IndexTransform::kTo24Swapping8In32>(
+          dest, source, source_index_count, isa);
+      break;
+    case IndexTransform::kTo24Swapping16In32:
+      QuadListToTriangleListForTransform<uint32_t,
+                                         IndexTransform::kTo24Swapping16In32>(
+          dest, source, source_index_count, isa);
+      break;
+    default:
+      assert_unhandled_case(index_transform);
+  }
+}
+
+}  // namespace primitive_conversion
+}  // namespace gpu
+}  // namespace xe
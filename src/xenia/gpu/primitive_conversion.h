@@ -0,0 +1,131 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_PRIMITIVE_CONVERSION_H_
+#define XENIA_GPU_PRIMITIVE_CONVERSION_H_
+
+#include <cstdint>
+
+#include "xenia/gpu/xenos.h"
+
+namespace xe {
+namespace gpu {
+namespace primitive_conversion {
+
+// CPU processing of guest index buffers for the PrimitiveProcessor - primitive
+// reset index lookup and replacement, and conversion of primitive types not
+// supported by the host - with kernels for multiple instruction sets.
+//
+// Indices must be aligned to their natural alignment. The kernels mapping
+// indices one to one (primitive reset and line loops) process the first
+// indices without SIMD until the source is aligned to the vector size, so the
+// destination should be co-aligned with the source (see
+// PrimitiveProcessor::GetSimdCoalignmentOffset) for the stores to be aligned
+// too. Primitive type conversion gathers the indices from unaligned 16-byte
+// windows of the source, so the alignment doesn't matter there.
+
+enum class Isa : uint32_t {
+  // Portable, one index at a time.
+  kScalar,
+  // 128-bit vectors - SSSE3 on x86-64, NEON on AArch64.
+  k128,
+  // 256-bit AVX2 vectors for the kernels mapping indices one to one, primitive
+  // type conversion like k128.
+  kAVX2,
+
+  kCount,
+};
+
+const char* GetIsaName(Isa isa);
+bool IsIsaSupported(Isa isa);
+// Cached after the first call as it's used for every primitive.
+Isa GetBestIsa();
+
+// Applied to every index during primitive type conversion. For 32-bit indices
+// on hosts supporting only 24-bit indices, the indices are pre-swapped and
+// pre-masked to 24 bits. 16-bit indices are always passed through.
+enum class IndexTransform : uint32_t {
+  kPassthrough,
+  kTo24NonSwapping,
+  kTo24Swapping8In16,
+  kTo24Swapping8In32,
+  kTo24Swapping16In32,
+};
+
+IndexTransform GetTo24IndexTransform(xenos::Endian endian);
+
+bool IsResetUsed(const uint16_t* source, uint32_t count,
+                 uint16_t reset_index_guest_endian, Isa isa = GetBestIsa());
+void Get16BitResetIndexUsage(const uint16_t* source, uint32_t count,
+                             uint16_t reset_index_guest_endian,
+                             bool& is_reset_index_used_out,
+                             bool& is_ffff_used_as_vertex_index_out,
+                             Isa isa = GetBestIsa());
+// The Xbox 360's GPU only uses the low 24 bits of the index - masking before
+// comparing.
+bool IsResetUsed(const uint32_t* source, uint32_t count,
+                 uint32_t reset_index_guest_endian,
+                 uint32_t low_bits_mask_guest_endian, Isa isa = GetBestIsa());
+void ReplaceResetIndex16To16(uint16_t* dest, const uint16_t* source,
+                             uint32_t count, uint16_t reset_index_guest_endian,
+                             Isa isa = GetBestIsa());
+// For use when the reset index is not 0xFFFF, and 0xFFFF is also used as a
+// valid index - keeps 0xFFFF as a real index and replaces the reset index with
+// 0xFFFFFFFF instead.
+void ReplaceResetIndex16To24(uint32_t* dest, const uint16_t* source,
+                             uint32_t count, uint16_t reset_index_guest_endian,
+                             Isa isa = GetBestIsa());
+// The reset index and the low 24 bits mask are taken explicitly because this
+// function may be used two ways:
+// - Passthrough - when the vertex shader swaps the indices (when 32-bit indices
+//   are supported on the host), in this case host_swap is kNone, but the reset
+//   index and the guest low bits mask can be swapped according to the guest
+//   endian.
+// - Swapping for the host - when only 24 bits of an index are supported on the
+//   host. In this case, masking and comparison are done before applying
+//   host_swap, but according to host_swap, if needed, the data is swapped from
+//   the PowerPC's big endianness to the host GPU little endianness that we
+//   assume, which matches the Xenos's little endianness.
+void ReplaceResetIndex32To24(uint32_t* dest, const uint32_t* source,
+                             uint32_t count, uint32_t reset_index_guest_endian,
+                             uint32_t low_bits_mask_guest_endian,
+                             xenos::Endian host_swap, Isa isa = GetBestIsa());
+
+// Primitive type conversion of a single primitive without primitive reset, the
+// destination must have space for the number of indices returned by the
+// respective PrimitiveProcessor::Get*IndexCount function.
+// Triangle fans as triangle lists, ordered as (v1, v2, v0), (v2, v3, v0) in
+// Direct3D.
+// https://docs.microsoft.com/en-us/windows/desktop/direct3d9/triangle-fans
+void TriangleFanToList(uint16_t* dest, const uint16_t* source,
+                       uint32_t source_index_count,
+                       IndexTransform index_transform, Isa isa = GetBestIsa());
+void TriangleFanToList(uint32_t* dest, const uint32_t* source,
+                       uint32_t source_index_count,
+                       IndexTransform index_transform, Isa isa = GetBestIsa());
+void LineLoopToStrip(uint16_t* dest, const uint16_t* source,
+                     uint32_t source_index_count,
+                     IndexTransform index_transform, Isa isa = GetBestIsa());
+void LineLoopToStrip(uint32_t* dest, const uint32_t* source,
+                     uint32_t source_index_count,
+                     IndexTransform index_transform, Isa isa = GetBestIsa());
+void QuadListToTriangleList(uint16_t* dest, const uint16_t* source,
+                            uint32_t source_index_count,
+                            IndexTransform index_transform,
+                            Isa isa = GetBestIsa());
+void QuadListToTriangleList(uint32_t* dest, const uint32_t* source,
+                            uint32_t source_index_count,
+                            IndexTransform index_transform,
+                            Isa isa = GetBestIsa());
+
+}  // namespace primitive_conversion
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_PRIMITIVE_CONVERSION_H_
@@ -0,0 +1,192 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/gpu/primitive_conversion.h"
+#include "xenia/gpu/xenos.h"
+
+DEFINE_uint32(primitive_conversion_bench_min_indices, 16,
+              "Smallest benchmarked guest index count.", "GPU");
+DEFINE_uint32(primitive_conversion_bench_max_indices, 1024 * 1024,
+              "Largest benchmarked guest index count, each count is 4 times "
+              "the previous one.",
+              "GPU");
+DEFINE_uint32(primitive_conversion_bench_total_indices, 64 * 1024 * 1024,
+              "Number of guest indices to process for each index count and "
+              "instruction set.",
+              "GPU");
+
+namespace xe {
+namespace gpu {
+
+namespace {
+
+// Not present in the random indices, so the lookups scan the whole buffer.
+constexpr uint16_t kBenchResetIndex16 = 0xFFFE;
+constexpr uint32_t kBenchResetIndex32 = 0xFFFFFE;
+
+struct BenchConversion {
+  const char* name;
+  void (*function)(void* dest, const void* source, uint32_t count,
+                   primitive_conversion::Isa isa);
+};
+
+const BenchConversion kBenchConversions[] = {
+    {"Reset lookup 16",
+     [](void* dest, const void* source, uint32_t count,
+        primitive_conversion::Isa isa) {
+       bool is_reset_index_used, is_ffff_used_as_vertex_index;
+       primitive_conversion::Get16BitResetIndexUsage(
+           static_cast<const uint16_t*>(source), count, kBenchResetIndex16,
+           is_reset_index_used, is_ffff_used_as_vertex_index, isa);
+     }},
+    {"Reset lookup 32",
+     [](void* dest, const void* source, uint32_t count,
+        primitive_conversion::Isa isa) {
+       primitive_conversion::IsResetUsed(static_cast<const uint32_t*>(source),
+                                         count, kBenchResetIndex32,
+                                         xenos::kVertexIndexMask, isa);
+     }},
+    {"Reset 16 to 16",
+     [](void* dest, const void* source, uint32_t count,
+        primitive_conversion::Isa isa) {
+       primitive_conversion::ReplaceResetIndex16To16(
+           static_cast<uint16_t*>(dest), static_cast<const uint16_t*>(source),
+           count, kBenchResetIndex16, isa);
+     }},
+    {"Reset 16 to 24",
+     [](void* dest, const void* source, uint32_t count,
+        primitive_conversion::Isa isa) {
+       primitive_conversion::ReplaceResetIndex16To24(
+           static_cast<uint32_t*>(dest), static_cast<const uint16_t*>(source),
+           count, kBenchResetIndex16, isa);
+     }},
+    {"Reset 32 to 24 8in32",
+     [](void* dest, const void* source, uint32_t count,
+        primitive_conversion::Isa isa) {
+       primitive_conversion::ReplaceResetIndex32To24(
+           static_cast<uint32_t*>(dest), static_cast<const uint32_t*>(source),
+           count, kBenchResetIndex32, xenos::kVertexIndexMask,
+           xenos::Endian::k8in32, isa);
+     }},
+    {"Fan 16",
+     [](void* dest, const void* source, uint32_t count,
+        primitive_conversion::Isa isa) {
+       primitive_conversion::TriangleFanToList(
+           static_cast<uint16_t*>(dest), static_cast<const uint16_t*>(source),
+           count, primitive_conversion::IndexTransform::kPassthrough, isa);
+     }},
+    {"Fan 32 8in32",
+     [](void* dest, const void* source, uint32_t count,
+        primitive_conversion::Isa isa) {
+       primitive_conversion::TriangleFanToList(
+           static_cast<uint32_t*>(dest), static_cast<const uint32_t*>(source),
+           count, primitive_conversion::IndexTransform::kTo24Swapping8In32,
+           isa);
+     }},
+    {"Line loop 32 8in32",
+     [](void* dest, const void* source, uint32_t count,
+        primitive_conversion::Isa isa) {
+       primitive_conversion::LineLoopToStrip(
+           static_cast<uint32_t*>(dest), static_cast<const uint32_t*>(source),
+           count, primitive_conversion::IndexTransform::kTo24Swapping8In32,
+           isa);
+     }},
+    {"Quad 16",
+     [](void* dest, const void* source, uint32_t count,
+        primitive_conversion::Isa isa) {
+       primitive_conversion::QuadListToTriangleList(
+           static_cast<uint16_t*>(dest), static_cast<const uint16_t*>(source),
+           count, primitive_conversion::IndexTransform::kPassthrough, isa);
+     }},
+    {"Quad 32 8in32",
+     [](void* dest, const void* source, uint32_t count,
+        primitive_conversion::Isa isa) {
+       primitive_conversion::QuadListToTriangleList(
+           static_cast<uint32_t*>(dest), static_cast<const uint32_t*>(source),
+           count, primitive_conversion::IndexTransform::kTo24Swapping8In32,
+           isa);
+     }},
+};
+
+}  // namespace
+
+// Runs every CPU index buffer conversion with every available instruction set
+// for index counts growing 4 times each step, and reports the throughput in
+// millions of guest indices per second.
+int primitive_conversion_bench_main(const std::vector<std::string>& args) {
+  uint32_t min_indices =
+      std::max(cvars::primitive_conversion_bench_min_indices, 1u);
+  uint32_t max_indices = std::max(
+      cvars::primitive_conversion_bench_max_indices, min_indices);
+  uint32_t total_indices =
+      std::max(cvars::primitive_conversion_bench_total_indices, max_indices);
+  XELOGI("Converting {} to {} indices, {} indices per measurement",
+         min_indices, max_indices, total_indices);
+
+  // Also used as 16-bit indices.
+  std::mt19937 random_engine;
+  std::vector<uint32_t> source(max_indices);
+  for (uint32_t& index : source) {
+    do {
+      index = uint32_t(random_engine());
+    } while (uint16_t(index) == kBenchResetIndex16 ||
+             uint16_t(index >> 16) == kBenchResetIndex16 ||
+             (index & xenos::kVertexIndexMask) == kBenchResetIndex32);
+  }
+  // Fans produce the most indices - 3 for each source index.
+  std::vector<uint32_t> dest(size_t(max_indices) * 3 + 1);
+
+  double tick_frequency = double(Clock::QueryHostTickFrequency());
+  for (const BenchConversion& conversion : kBenchConversions) {
+    for (uint32_t count = min_indices; count <= max_indices;) {
+      uint32_t iterations = std::max(total_indices / count, 1u);
+      double mega_indices = double(count) * iterations / 1000000.0;
+      std::string results;
+      for (uint32_t i = 0; i < uint32_t(primitive_conversion::Isa::kCount);
+           ++i) {
+        auto isa = primitive_conversion::Isa(i);
+        if (!primitive_conversion::IsIsaSupported(isa)) {
+          continue;
+        }
+        uint64_t start_ticks = Clock::QueryHostTickCount();
+        for (uint32_t j = 0; j < iterations; ++j) {
+          conversion.function(dest.data(), source.data(), count, isa);
+        }
+        double seconds =
+            double(Clock::QueryHostTickCount() - start_ticks) / tick_frequency;
+        results += fmt::format("  {} {:.1f} M/s",
+                               primitive_conversion::GetIsaName(isa),
+                               mega_indices / std::max(seconds, 1e-9));
+      }
+      XELOGI("{:<24}{:>8}{}", conversion.name, count, results);
+      if (count > max_indices / 4) {
+        break;
+      }
+      count *= 4;
+    }
+  }
+  return 0;
+}
+
+}  // namespace gpu
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-gpu-primitive-conversion-bench",
+                      xe::gpu::primitive_conversion_bench_main, "");
@@ -9,6 +9,7 @@
 
 #include "xenia/gpu/primitive_processor.h"
 
+#include <algorithm>
 #include <cstring>
 
 #include "xenia/base/assert.h"
@@ -59,47 +60,24 @@ DEFINE_bool(
 DEFINE_int32(
     primitive_processor_cache_min_indices, 4096,
     "Smallest number of guest indices to store in the cache to try reusing "
-    "later in the same frame if processing (such as primitive type conversion "
-    "or reset index replacement) is performed.\n"
+    "later in the same or in subsequent frames if processing (such as "
+    "primitive type conversion or reset index replacement) is performed.\n"
     "Setting this to a very high value may result in excessive CPU processing, "
     "while a very low value may result in excessive locking and lookups.\n"
     "Negative values disable caching.",
     "GPU");
+DEFINE_uint32(
+    primitive_processor_cache_budget_mb, 64,
+    "Maximum size of converted indices, in megabytes, kept by the primitive "
+    "processor cache across frames for reuse while the guest indices are not "
+    "modified. The least recently used conversion results are evicted at the "
+    "end of a frame if the budget is exceeded.\n"
+    "0 keeps converted indices only within the frame they were created in.",
+    "GPU");
 
 namespace xe {
 namespace gpu {
 
-// SIMD processing here assumes that alignment is not required (neither AVX nor
-// Neon requires it) and there's no punishment for using an unaligned access
-// instruction when the data is actually aligned (AVX has separate aligned /
-// unaligned movs, but they have the same performance nowadays; Neon dropped the
-// alignment specifier in AArch64), but truly unaligned access may result in two
-// hardware memory operations if some boundary that is >= vector size is
-// crossed.
-//
-// Therefore, to minimize unaligned access (primarily reads - since we depend on
-// the data immediately), SIMD usage here is performed according to the
-// following pattern (though we try to co-align the destination and the source
-// prior to calling, but still doing all the operations for more code
-// correctness and fewer unobvious conditions):
-// - Until the source pointer is vector-aligned, process the first indices
-//   without SIMD.
-//   - The best possible outcome of this is that both the source and the
-//     destination will be vector-aligned (if they were co-aligned prior to the
-//     call), in this case, neither load nor store instructions will be crossing
-//     cache lines.
-//   - The other possible outcome is that the source will be aligned (1 memory
-//     read per load), while the destination will be unaligned (1-2 memory
-//     writes per store).
-// - Process whole vectors with SIMD.
-// - If there are less elements than a vector can hold remaining, process them
-//   without SIMD.
-//
-// We assume that indices are at least aligned to their natural alignment (2 or
-// 4 bytes depending on the format) - the R6xx documentation says that in
-// DRAW_INDEX, INDEX_BASE_LO is word-aligned, and that's required by host
-// graphics APIs.
-
 PrimitiveProcessor::~PrimitiveProcessor() { ShutdownCommon(); }
 
 bool PrimitiveProcessor::InitializeCommon(
@@ -245,6 +223,7 @@ void PrimitiveProcessor::ShutdownCommon() {
       auto global_lock = global_critical_region_.Acquire();
       cache_map_.clear();
       cache_bucket_free_first_entry_ = SIZE_MAX;
+      cache_host_indices_size_bytes_ = 0;
       std::memset(cache_buckets_non_empty_l1_, 0,
                   sizeof(cache_buckets_non_empty_l1_));
       std::memset(cache_buckets_non_empty_l2_, 0,
@@ -257,22 +236,40 @@ void PrimitiveProcessor::ShutdownCommon() {
   }
 }
 
-void PrimitiveProcessor::ClearPerFrameCache() {
+void PrimitiveProcessor::EndCacheFrame() {
+  // Host buffers of the results obtained before this point are not valid
+  // anymore.
+  ++cache_frame_;
   if (!memory_invalidation_callback_handle_) {
-    // Only do clearing if cache has ever been used.
+    // Only do eviction if cache has ever been used.
     return;
   }
+  uint64_t budget_bytes =
+      uint64_t(cvars::primitive_processor_cache_budget_mb) << 20;
   auto global_lock = global_critical_region_.Acquire();
+  if (cache_host_indices_size_bytes_ <= budget_bytes) {
+    return;
+  }
+  // Evict the least recently used entries storing converted indices until the
+  // budget is met. Entries not storing anything other than the result (such as
+  // when the reset index was not found) are cheap and are only removed on
+  // invalidation.
+  cache_eviction_order_.clear();
   for (const std::pair<CacheKey, size_t>& cache_map_entry : cache_map_) {
-    cache_entry_pool_[cache_map_entry.second].free_next =
-        cache_bucket_free_first_entry_;
-    cache_bucket_free_first_entry_ = cache_map_entry.second;
+    const CacheEntry& entry = cache_entry_pool_[cache_map_entry.second];
+    if (entry.host_indices_size_bytes) {
+      cache_eviction_order_.emplace_back(entry.last_used_frame,
+                                         cache_map_entry.second);
+    }
+  }
+  std::sort(cache_eviction_order_.begin(), cache_eviction_order_.end());
+  for (const std::pair<uint64_t, size_t>& eviction_entry :
+       cache_eviction_order_) {
+    if (cache_host_indices_size_bytes_ <= budget_bytes) {
+      break;
+    }
+    RemoveCacheEntry(eviction_entry.second, global_lock);
   }
-  cache_map_.clear();
-  std::memset(cache_buckets_non_empty_l1_, 0,
-              sizeof(cache_buckets_non_empty_l1_));
-  std::memset(cache_buckets_non_empty_l2_, 0,
-              sizeof(cache_buckets_non_empty_l2_));
 }
 
 bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
@@ -715,8 +712,9 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
           auto guest_indices =
               reinterpret_cast<const uint16_t*>(guest_indices_ptr);
           if (guest_primitive_reset_enabled &&
-              IsResetUsed(guest_indices, guest_draw_vertex_count,
-                          guest_primitive_reset_index_guest_endian)) {
+              primitive_conversion::IsResetUsed(
+                  guest_indices, guest_draw_vertex_count,
+                  guest_primitive_reset_index_guest_endian)) {
             // Multiple primitives in the index buffer - gather all single
             // primitives.
             cacheable.host_draw_vertex_count =
@@ -732,15 +730,16 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
                 0, guest_draw_vertex_count, cacheable.host_draw_vertex_count);
           }
           auto host_indices = reinterpret_cast<uint16_t*>(
-              RequestHostConvertedIndexBufferForCurrentFrame(
+              cache_transaction.RequestHostConvertedIndexBuffer(
                   xenos::IndexFormat::kInt16, cacheable.host_draw_vertex_count,
-                  false, guest_index_base, cacheable.host_index_buffer_handle));
+                  false, cacheable.host_index_buffer_handle));
           if (!host_indices) {
             return false;
           }
           ConvertSinglePrimitiveRanges(
               host_indices, guest_indices, guest_primitive_type,
-              PassthroughIndexTransform(), single_primitive_ranges_.cbegin(),
+              primitive_conversion::IndexTransform::kPassthrough,
+              single_primitive_ranges_.cbegin(),
               single_primitive_ranges_.cend());
         } else {
           // 32-bit indices - may need to pre-swap and pre-mask also if the host
@@ -748,9 +747,10 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
           auto guest_indices =
               reinterpret_cast<const uint32_t*>(guest_indices_ptr);
           if (guest_primitive_reset_enabled &&
-              IsResetUsed(guest_indices, guest_draw_vertex_count,
-                          guest_primitive_reset_index_guest_endian,
-                          guest_index_mask_guest_endian)) {
+              primitive_conversion::IsResetUsed(
+                  guest_indices, guest_draw_vertex_count,
+                  guest_primitive_reset_index_guest_endian,
+                  guest_index_mask_guest_endian)) {
             // Multiple primitives in the index buffer - gather all single
             // primitives.
             cacheable.host_draw_vertex_count =
@@ -766,54 +766,24 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
                 0, guest_draw_vertex_count, cacheable.host_draw_vertex_count);
           }
           auto host_indices = reinterpret_cast<uint32_t*>(
-              RequestHostConvertedIndexBufferForCurrentFrame(
+              cache_transaction.RequestHostConvertedIndexBuffer(
                   xenos::IndexFormat::kInt32, cacheable.host_draw_vertex_count,
-                  false, guest_index_base, cacheable.host_index_buffer_handle));
+                  false, cacheable.host_index_buffer_handle));
           if (!host_indices) {
             return false;
           }
-          auto single_primitive_ranges_beginning =
-              single_primitive_ranges_.cbegin();
-          auto single_primitive_ranges_end = single_primitive_ranges_.cend();
           if (full_32bit_vertex_indices_used_) {
             ConvertSinglePrimitiveRanges(
                 host_indices, guest_indices, guest_primitive_type,
-                PassthroughIndexTransform(), single_primitive_ranges_beginning,
-                single_primitive_ranges_end);
+                primitive_conversion::IndexTransform::kPassthrough,
+                single_primitive_ranges_.cbegin(),
+                single_primitive_ranges_.cend());
           } else {
-            switch (guest_index_endian) {
-              case xenos::Endian::kNone:
-                ConvertSinglePrimitiveRanges(host_indices, guest_indices,
-                                             guest_primitive_type,
-                                             To24NonSwappingIndexTransform(),
-                                             single_primitive_ranges_beginning,
-                                             single_primitive_ranges_end);
-                break;
-              case xenos::Endian::k8in16:
-                ConvertSinglePrimitiveRanges(host_indices, guest_indices,
-                                             guest_primitive_type,
-                                             To24Swapping8In16IndexTransform(),
-                                             single_primitive_ranges_beginning,
-                                             single_primitive_ranges_end);
-                break;
-              case xenos::Endian::k8in32:
-                ConvertSinglePrimitiveRanges(host_indices, guest_indices,
-                                             guest_primitive_type,
-                                             To24Swapping8In32IndexTransform(),
-                                             single_primitive_ranges_beginning,
-                                             single_primitive_ranges_end);
-                break;
-              case xenos::Endian::k16in32:
-                ConvertSinglePrimitiveRanges(host_indices, guest_indices,
-                                             guest_primitive_type,
-                                             To24Swapping16In32IndexTransform(),
-                                             single_primitive_ranges_beginning,
-                                             single_primitive_ranges_end);
-                break;
-              default:
-                assert_unhandled_case(guest_index_endian);
-                return false;
-            }
+            ConvertSinglePrimitiveRanges(
+                host_indices, guest_indices, guest_primitive_type,
+                primitive_conversion::GetTo24IndexTransform(guest_index_endian),
+                single_primitive_ranges_.cbegin(),
+                single_primitive_ranges_.cend());
             cacheable.host_shader_index_endian = xenos::Endian::kNone;
           }
         }
@@ -854,10 +824,10 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
               auto guest_indices =
                   memory_.TranslatePhysical<const uint16_t*>(guest_index_base);
               bool is_reset_index_used, is_ffff_used_as_vertex_index;
-              Get16BitResetIndexUsage(guest_indices, guest_draw_vertex_count,
-                                      guest_primitive_reset_index_guest_endian,
-                                      is_reset_index_used,
-                                      is_ffff_used_as_vertex_index);
+              primitive_conversion::Get16BitResetIndexUsage(
+                  guest_indices, guest_draw_vertex_count,
+                  guest_primitive_reset_index_guest_endian, is_reset_index_used,
+                  is_ffff_used_as_vertex_index);
               if (is_reset_index_used) {
                 cacheable.index_buffer_type =
                     ProcessedIndexBufferType::kHostConverted;
@@ -865,20 +835,19 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
                                                   ? xenos::IndexFormat::kInt32
                                                   : xenos::IndexFormat::kInt16;
                 void* host_indices_ptr =
-                    RequestHostConvertedIndexBufferForCurrentFrame(
+                    cache_transaction.RequestHostConvertedIndexBuffer(
                         cacheable.host_index_format, guest_draw_vertex_count,
-                        true, guest_index_base,
-                        cacheable.host_index_buffer_handle);
+                        true, cacheable.host_index_buffer_handle);
                 if (!host_indices_ptr) {
                   return false;
                 }
                 if (is_ffff_used_as_vertex_index) {
-                  ReplaceResetIndex16To24(
+                  primitive_conversion::ReplaceResetIndex16To24(
                       reinterpret_cast<uint32_t*>(host_indices_ptr),
                       guest_indices, guest_draw_vertex_count,
                       guest_primitive_reset_index_guest_endian);
                 } else {
-                  ReplaceResetIndex16To16(
+                  primitive_conversion::ReplaceResetIndex16To16(
                       reinterpret_cast<uint16_t*>(host_indices_ptr),
                       guest_indices, guest_draw_vertex_count,
                       guest_primitive_reset_index_guest_endian);
@@ -911,43 +880,25 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
           } else {
             auto guest_indices =
                 memory_.TranslatePhysical<const uint32_t*>(guest_index_base);
-            if (IsResetUsed(guest_indices, guest_draw_vertex_count,
-                            guest_primitive_reset_index_guest_endian,
-                            guest_index_mask_guest_endian)) {
+            if (primitive_conversion::IsResetUsed(
+                    guest_indices, guest_draw_vertex_count,
+                    guest_primitive_reset_index_guest_endian,
+                    guest_index_mask_guest_endian)) {
               cacheable.index_buffer_type =
                   ProcessedIndexBufferType::kHostConverted;
               auto host_indices = reinterpret_cast<uint32_t*>(
-                  RequestHostConvertedIndexBufferForCurrentFrame(
+                  cache_transaction.RequestHostConvertedIndexBuffer(
                       xenos::IndexFormat::kInt32, guest_draw_vertex_count, true,
-                      guest_index_base, cacheable.host_index_buffer_handle));
+                      cacheable.host_index_buffer_handle));
               if (!host_indices) {
                 return false;
               }
-              if (full_32bit_vertex_indices_used_ ||
-                  guest_index_endian == xenos::Endian::kNone) {
-                ReplaceResetIndex32To24<xenos::Endian::kNone>(
-                    host_indices, guest_indices, guest_draw_vertex_count,
-                    guest_primitive_reset_index_guest_endian,
-                    guest_index_mask_guest_endian);
-              } else if (guest_index_endian == xenos::Endian::k8in16) {
-                ReplaceResetIndex32To24<xenos::Endian::k8in16>(
-                    host_indices, guest_indices, guest_draw_vertex_count,
-                    guest_primitive_reset_index_guest_endian,
-                    guest_index_mask_guest_endian);
-              } else if (guest_index_endian == xenos::Endian::k8in32) {
-                ReplaceResetIndex32To24<xenos::Endian::k8in32>(
-                    host_indices, guest_indices, guest_draw_vertex_count,
-                    guest_primitive_reset_index_guest_endian,
-                    guest_index_mask_guest_endian);
-              } else if (guest_index_endian == xenos::Endian::k16in32) {
-                ReplaceResetIndex32To24<xenos::Endian::k16in32>(
-                    host_indices, guest_indices, guest_draw_vertex_count,
-                    guest_primitive_reset_index_guest_endian,
-                    guest_index_mask_guest_endian);
-              } else {
-                assert_unhandled_case(guest_index_endian);
-                return false;
-              }
+              primitive_conversion::ReplaceResetIndex32To24(
+                  host_indices, guest_indices, guest_draw_vertex_count,
+                  guest_primitive_reset_index_guest_endian,
+                  guest_index_mask_guest_endian,
+                  full_32bit_vertex_indices_used_ ? xenos::Endian::kNone
+                                                  : guest_index_endian);
               cacheable.host_shader_index_endian =
                   full_32bit_vertex_indices_used_ ? guest_index_endian
                                                   : xenos::Endian::kNone;
@@ -992,349 +943,6 @@ bool PrimitiveProcessor::Process(ProcessingResult& result_out) {
   return true;
 }
 
-bool PrimitiveProcessor::IsResetUsed(const uint16_t* source, uint32_t count,
-                                     uint16_t reset_index_guest_endian) {
-#if XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-  while (count && (reinterpret_cast<uintptr_t>(source) &
-                   (XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE - 1))) {
-    --count;
-    if (*(source++) == reset_index_guest_endian) {
-      return true;
-    }
-  }
-  if (count >= kSimdVectorU16Elements) {
-    SimdVectorU16 reset_index_guest_endian_simd =
-        ReplicateU16(reset_index_guest_endian);
-    while (count >= kSimdVectorU16Elements) {
-      count -= kSimdVectorU16Elements;
-      SimdVectorU16 source_simd = LoadAlignedVectorU16(source);
-      source += kSimdVectorU16Elements;
-#if XE_ARCH_AMD64
-      if (_mm_movemask_epi8(
-              _mm_cmpeq_epi16(source_simd, reset_index_guest_endian_simd))) {
-        return true;
-      }
-#elif XE_ARCH_ARM64
-      uint64x1_t is_any = vreinterpret_u64_u32(vqmovn_u64(vreinterpretq_u64_u16(
-          vceqq_u16(source_simd, reset_index_guest_endian_simd))));
-      if (*reinterpret_cast<const uint64_t*>(&is_any)) {
-        return true;
-      }
-#else
-#error SIMD 16-bit IsResetUsed not implemented.
-#endif  // XE_ARCH
-    }
-  }
-#endif  // XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-  while (count--) {
-    if (*(source++) == reset_index_guest_endian) {
-      return true;
-    }
-  }
-  return false;
-}
-
-void PrimitiveProcessor::Get16BitResetIndexUsage(
-    const uint16_t* source, uint32_t count, uint16_t reset_index_guest_endian,
-    bool& is_reset_index_used_out, bool& is_ffff_used_as_vertex_index_out) {
-  // Optimized for the more common case (reset index not used at all), therefore
-  // not doing early-outs if both conditions are true for a simpler loop body.
-  // Using the index 0xFFFF is likely not that common in general.
-  // TODO(Triang3l): Revisit this - maybe the early-out will be free if this
-  // function is bandwidth-bound.
-  is_ffff_used_as_vertex_index_out = false;
-  if (reset_index_guest_endian == UINT16_MAX) {
-    is_reset_index_used_out =
-        IsResetUsed(source, count, reset_index_guest_endian);
-    return;
-  }
-  is_reset_index_used_out = false;
-#if XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-  while (count && (reinterpret_cast<uintptr_t>(source) &
-                   (XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE - 1))) {
-    --count;
-    uint16_t index = *(source++);
-    if (index == reset_index_guest_endian) {
-      is_reset_index_used_out = true;
-    }
-    if (index == UINT16_MAX) {
-      is_ffff_used_as_vertex_index_out = true;
-    }
-  }
-  if (count >= kSimdVectorU16Elements) {
-    SimdVectorU16 reset_index_guest_endian_simd =
-        ReplicateU16(reset_index_guest_endian);
-    SimdVectorU16 ffff_simd = ReplicateU16(UINT16_MAX);
-    SimdVectorU16 is_reset_simd = ReplicateU16(0);
-    SimdVectorU16 is_ffff_simd = ReplicateU16(0);
-    while (count >= kSimdVectorU16Elements) {
-      count -= kSimdVectorU16Elements;
-      SimdVectorU16 source_simd = LoadAlignedVectorU16(source);
-      source += kSimdVectorU16Elements;
-#if XE_ARCH_AMD64
-      is_reset_simd = _mm_or_si128(
-          is_reset_simd,
-          _mm_cmpeq_epi16(source_simd, reset_index_guest_endian_simd));
-      is_ffff_simd =
-          _mm_or_si128(is_ffff_simd, _mm_cmpeq_epi16(source_simd, ffff_simd));
-#elif XE_ARCH_ARM64
-      is_reset_simd = vorrq_u16(
-          is_reset_simd, vceqq_u16(source_simd, reset_index_guest_endian_simd));
-      is_ffff_simd = vmaxq_u16(is_ffff_simd, source_simd);
-#else
-#error SIMD Get16BitResetIndexUsage not implemented.
-#endif  // XE_ARCH
-    }
-#if XE_ARCH_AMD64
-    if (_mm_movemask_epi8(is_reset_simd)) {
-      is_reset_index_used_out = true;
-    }
-    if (_mm_movemask_epi8(is_ffff_simd)) {
-      is_ffff_used_as_vertex_index_out = true;
-    }
-#elif XE_ARCH_ARM64
-    uint64x1_t is_reset_any =
-        vreinterpret_u64_u32(vqmovn_u64(vreinterpretq_u64_u16(is_reset_simd)));
-    if (*reinterpret_cast<const uint64_t*>(&is_reset_any)) {
-      is_reset_index_used_out = true;
-    }
-    uint64x1_t is_ffff_any = vreinterpret_u64_u32(
-        vqmovn_u64(vreinterpretq_u64_u16(vceqq_u16(is_ffff_simd, ffff_simd))));
-    if (*reinterpret_cast<const uint64_t*>(&is_ffff_any)) {
-      is_ffff_used_as_vertex_index_out = true;
-    }
-#else
-#error SIMD Get16BitResetIndexUsage not implemented.
-#endif  // XE_ARCH
-  }
-#endif  // XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-  while (count--) {
-    uint16_t index = *(source++);
-    if (index == reset_index_guest_endian) {
-      is_reset_index_used_out = true;
-    }
-    if (index == UINT16_MAX) {
-      is_ffff_used_as_vertex_index_out = true;
-    }
-  }
-}
-
-bool PrimitiveProcessor::IsResetUsed(const uint32_t* source, uint32_t count,
-                                     uint32_t reset_index_guest_endian,
-                                     uint32_t low_bits_mask_guest_endian) {
-  // The Xbox 360's GPU only uses the low 24 bits of the index - masking before
-  // comparing.
-#if XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-  while (count && (reinterpret_cast<uintptr_t>(source) &
-                   (XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE - 1))) {
-    --count;
-    if ((*(source++) & low_bits_mask_guest_endian) ==
-        reset_index_guest_endian) {
-      return true;
-    }
-  }
-  if (count >= kSimdVectorU32Elements) {
-    SimdVectorU32 reset_index_guest_endian_simd =
-        ReplicateU32(reset_index_guest_endian);
-    while (count >= kSimdVectorU32Elements) {
-      count -= kSimdVectorU32Elements;
-      SimdVectorU32 source_simd = LoadAlignedVectorU32(source);
-      source += kSimdVectorU32Elements;
-      SimdVectorU32 low_bits_mask_guest_endian_simd =
-          ReplicateU32(low_bits_mask_guest_endian);
-#if XE_ARCH_AMD64
-      source_simd = _mm_and_si128(source_simd, low_bits_mask_guest_endian_simd);
-      if (_mm_movemask_epi8(
-              _mm_cmpeq_epi32(source_simd, reset_index_guest_endian_simd))) {
-        return true;
-      }
-#elif XE_ARCH_ARM64
-      source_simd = vandq_u32(source_simd, low_bits_mask_guest_endian_simd);
-      uint64x1_t is_any = vreinterpret_u64_u32(vqmovn_u64(vreinterpretq_u64_u32(
-          vceqq_u32(source_simd, reset_index_guest_endian_simd))));
-      if (*reinterpret_cast<const uint64_t*>(&is_any)) {
-        return true;
-      }
-#else
-#error SIMD 32-bit IsResetUsed not implemented.
-#endif  // XE_ARCH
-    }
-  }
-#endif  // XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-  while (count--) {
-    if ((*(source++) & low_bits_mask_guest_endian) ==
-        reset_index_guest_endian) {
-      return true;
-    }
-  }
-  return false;
-}
-
-void PrimitiveProcessor::ReplaceResetIndex16To16(
-    uint16_t* dest, const uint16_t* source, uint32_t count,
-    uint16_t reset_index_guest_endian) {
-#if XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-  while (count && (reinterpret_cast<uintptr_t>(source) &
-                   (XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE - 1))) {
-    --count;
-    uint16_t index = *(source++);
-    *(dest++) = index != reset_index_guest_endian ? index : UINT16_MAX;
-  }
-  if (count >= kSimdVectorU16Elements) {
-    SimdVectorU16 reset_index_guest_endian_simd =
-        ReplicateU16(reset_index_guest_endian);
-    while (count >= kSimdVectorU16Elements) {
-      count -= kSimdVectorU16Elements;
-      // Comparison produces 0 or 0xFFFF on AVX and Neon - we need 0xFFFF as the
-      // result for the primitive reset indices, so the result is
-      // `index | (index == reset_index)`.
-      SimdVectorU16 source_simd = LoadAlignedVectorU16(source);
-      source += kSimdVectorU16Elements;
-      SimdVectorU16 result_simd;
-#if XE_ARCH_AMD64
-      result_simd = _mm_or_si128(
-          source_simd,
-          _mm_cmpeq_epi16(source_simd, reset_index_guest_endian_simd));
-#elif XE_ARCH_ARM64
-      result_simd = vorrq_u16(
-          source_simd, vceqq_u16(source_simd, reset_index_guest_endian_simd));
-#else
-#error SIMD ReplaceResetIndex16To16 not implemented.
-#endif  // XE_ARCH
-      StoreUnalignedVectorU16(dest, result_simd);
-      dest += kSimdVectorU16Elements;
-    }
-  }
-#endif  // XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-  while (count--) {
-    uint16_t index = *(source++);
-    *(dest++) = index != reset_index_guest_endian ? index : UINT16_MAX;
-  }
-}
-
-void PrimitiveProcessor::ReplaceResetIndex16To24(
-    uint32_t* dest, const uint16_t* source, uint32_t count,
-    uint16_t reset_index_guest_endian) {
-#if XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-  while (count && (reinterpret_cast<uintptr_t>(source) &
-                   (XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE - 1))) {
-    --count;
-    uint16_t index = *(source++);
-    *(dest++) = index != reset_index_guest_endian ? index : UINT32_MAX;
-  }
-  if (count >= kSimdVectorU16Elements) {
-    SimdVectorU16 reset_index_guest_endian_simd =
-        ReplicateU16(reset_index_guest_endian);
-    while (count >= kSimdVectorU16Elements) {
-      count -= kSimdVectorU16Elements;
-      SimdVectorU16 source_simd = LoadAlignedVectorU16(source);
-      source += kSimdVectorU16Elements;
-      // 1) Compare to the reset index as uint16, getting 0 or 0xFFFF.
-      // 2) For primitive reset indices, replace the lower 16 bits with 0xFFFF
-      //    via OR with the comparison result.
-      // 3) Expand to 32-bit, putting 0xFFFF in the upper 16 bits where
-      //    the comparison has passed, creating 0xFFFFFFFF for primitive reset
-      //    or 0x0000#### for non-primitive-reset indices (including
-      //    0x0000FFFF if the original index buffer had 0xFFFF, but the
-      //    primitive reset index is different).
-      // 4) Store.
-#if XE_ARCH_AMD64
-      __m128i are_reset =
-          _mm_cmpeq_epi16(source_simd, reset_index_guest_endian_simd);
-      __m128i result = _mm_or_si128(source_simd, are_reset);
-      StoreUnalignedVectorU32(dest, _mm_unpacklo_epi16(result, are_reset));
-      // Expecting kSimdVectorU16Elements / 2 to be in the immediate offset
-      // part of the address.
-      StoreUnalignedVectorU32(dest + kSimdVectorU16Elements / 2,
-                              _mm_unpackhi_epi16(result, are_reset));
-#elif XE_ARCH_ARM64
-      // Interleaving the indices and 0 / 0xFFFF via st2.
-      uint16x8x2_t result;
-      result.val[1] = vceqq_u16(source_simd, reset_index_guest_endian_simd);
-      result.val[0] = vorrq_u16(source_simd, result.val[1]);
-      vst2q_u16(reinterpret_cast<uint16_t*>(dest), result);
-#else
-#error SIMD ReplaceResetIndex16To24 not implemented.
-#endif  // XE_ARCH
-      dest += kSimdVectorU16Elements;
-    }
-  }
-#endif  // XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-  while (count--) {
-    uint16_t index = *(source++);
-    *(dest++) = index != reset_index_guest_endian ? index : UINT32_MAX;
-  }
-}
-
-template void PrimitiveProcessor::ReplaceResetIndex32To24<xenos::Endian::kNone>(
-    uint32_t* dest, const uint32_t* source, uint32_t count,
-    uint32_t reset_index_guest_endian, uint32_t low_bits_mask_guest_endian);
-template void
-PrimitiveProcessor::ReplaceResetIndex32To24<xenos::Endian::k8in16>(
-    uint32_t* dest, const uint32_t* source, uint32_t count,
-    uint32_t reset_index_guest_endian, uint32_t low_bits_mask_guest_endian);
-template void
-PrimitiveProcessor::ReplaceResetIndex32To24<xenos::Endian::k8in32>(
-    uint32_t* dest, const uint32_t* source, uint32_t count,
-    uint32_t reset_index_guest_endian, uint32_t low_bits_mask_guest_endian);
-template void
-PrimitiveProcessor::ReplaceResetIndex32To24<xenos::Endian::k16in32>(
-    uint32_t* dest, const uint32_t* source, uint32_t count,
-    uint32_t reset_index_guest_endian, uint32_t low_bits_mask_guest_endian);
-
-#define XE_GPU_PRIMITIVE_PROCESSOR_INSTANTIATE_CONVERSION_NO_PASSTHROUGH(  \
-    ConverterName)                                                         \
-  template void PrimitiveProcessor::ConverterName(                         \
-      uint32_t* dest, const uint32_t* source, uint32_t source_index_count, \
-      const To24NonSwappingIndexTransform& index_transform);               \
-  template void PrimitiveProcessor::ConverterName(                         \
-      uint32_t* dest, const uint32_t* source, uint32_t source_index_count, \
-      const To24Swapping8In16IndexTransform& index_transform);             \
-  template void PrimitiveProcessor::ConverterName(                         \
-      uint32_t* dest, const uint32_t* source, uint32_t source_index_count, \
-      const To24Swapping8In32IndexTransform& index_transform);             \
-  template void PrimitiveProcessor::ConverterName(                         \
-      uint32_t* dest, const uint32_t* source, uint32_t source_index_count, \
-      const To24Swapping16In32IndexTransform& index_transform);
-#define XE_GPU_PRIMITIVE_PROCESSOR_INSTANTIATE_CONVERSION(ConverterName)   \
-  template void PrimitiveProcessor::ConverterName(                         \
-      uint16_t* dest, const uint16_t* source, uint32_t source_index_count, \
-      const PassthroughIndexTransform& index_transform);                   \
-  template void PrimitiveProcessor::ConverterName(                         \
-      uint32_t* dest, const uint32_t* source, uint32_t source_index_count, \
-      const PassthroughIndexTransform& index_transform);                   \
-  XE_GPU_PRIMITIVE_PROCESSOR_INSTANTIATE_CONVERSION_NO_PASSTHROUGH(        \
-      ConverterName)
-XE_GPU_PRIMITIVE_PROCESSOR_INSTANTIATE_CONVERSION(TriangleFanToList)
-XE_GPU_PRIMITIVE_PROCESSOR_INSTANTIATE_CONVERSION_NO_PASSTHROUGH(
-    LineLoopToStrip)
-// TODO(Triang3l): SIMD quad conversion maybe - 2 vectors to 3 vectors (though
-// multiple quads are rarely drawn anyway).
-XE_GPU_PRIMITIVE_PROCESSOR_INSTANTIATE_CONVERSION(QuadListToTriangleList)
-#undef XE_GPU_PRIMITIVE_PROCESSOR_INSTANTIATE_CONVERSION_NO_PASSTHROUGH
-#undef XE_GPU_PRIMITIVE_PROCESSOR_INSTANTIATE_CONVERSION
-
-void PrimitiveProcessor::LineLoopToStrip(
-    uint16_t* dest, const uint16_t* source, uint32_t source_index_count,
-    const PassthroughIndexTransform& index_transform) {
-  if (source_index_count <= 1) {
-    // To match GetLineLoopStripIndexCount.
-    return;
-  }
-  std::memcpy(dest, source, sizeof(*source) * source_index_count);
-  dest[source_index_count] = source[0];
-}
-void PrimitiveProcessor::LineLoopToStrip(
-    uint32_t* dest, const uint32_t* source, uint32_t source_index_count,
-    const PassthroughIndexTransform& index_transform) {
-  if (source_index_count <= 1) {
-    // To match GetLineLoopStripIndexCount.
-    return;
-  }
-  std::memcpy(dest, source, sizeof(*source) * source_index_count);
-  dest[source_index_count] = source[0];
-}
-
 uint32_t PrimitiveProcessor::GetMultiPrimitiveHostIndexCountAndRanges(
     std::function<uint32_t(uint32_t)> single_primitive_guest_to_host_count,
     const uint16_t* source, uint32_t source_index_count,
@@ -1414,22 +1022,33 @@ PrimitiveProcessor::CacheTransaction::CacheTransaction(
   assert_zero(processor_.cache_currently_processing_size_bytes_);
   if (cvars::primitive_processor_cache_min_indices < 0 ||
       key_.count < uint32_t(cvars::primitive_processor_cache_min_indices)) {
-    // Don't cache if the vertex count is too small.
-    key_.key = 0;
+    // Don't cache if the vertex count is too small. Keeping the base for SIMD
+    // co-alignment of the converted indices.
+    key_.count = 0;
   }
   if (!key_.count) {
     return;
   }
-  uint32_t size_bytes =
-      (key_.format == xenos::IndexFormat::kInt16 ? sizeof(uint16_t)
-                                                 : sizeof(uint32_t)) *
-      key_.count;
+  uint32_t size_bytes = key_.GetSizeBytes();
+  std::shared_ptr<uint8_t[]> reupload_indices_storage;
+  const uint8_t* reupload_indices = nullptr;
+  uint32_t reupload_indices_size_bytes = 0;
   {
     auto global_lock = processor_.global_critical_region_.Acquire();
     auto cache_map_it = processor_.cache_map_.find(key_);
     if (cache_map_it != processor_.cache_map_.end()) {
-      result_ = processor_.cache_entry_pool_[cache_map_it->second].result;
+      CacheEntry& entry = processor_.cache_entry_pool_[cache_map_it->second];
+      entry.last_used_frame = processor_.cache_frame_;
+      result_ = entry.result;
       result_type_ = ResultType::kExisting;
+      if (entry.host_indices_size_bytes &&
+          entry.result_frame != processor_.cache_frame_) {
+        // The host buffer is from an earlier frame - upload the converted
+        // indices again, outside the lock since it may take some time.
+        reupload_indices_storage = entry.host_indices_storage;
+        reupload_indices = entry.host_indices;
+        reupload_indices_size_bytes = entry.host_indices_size_bytes;
+      }
     } else {
       // Inhibit writing the new result if the range happens to be modified
       // during the processing outside the lock.
@@ -1437,6 +1056,32 @@ PrimitiveProcessor::CacheTransaction::CacheTransaction(
       processor_.cache_currently_processing_size_bytes_ = size_bytes;
     }
   }
+  if (reupload_indices) {
+    void* mapping = processor_.RequestHostConvertedIndexBufferForCurrentFrame(
+        result_.host_index_format, result_.host_draw_vertex_count, false,
+        key_.base, result_.host_index_buffer_handle);
+    if (!mapping) {
+      // Fall back to processing without the cache, which will likely fail the
+      // same way, but is handled by the processor.
+      key_.count = 0;
+      result_type_ = ResultType::kNewUnset;
+      return;
+    }
+    std::memcpy(mapping, reupload_indices, reupload_indices_size_bytes);
+    // Let the other draws in this frame use the new host buffer if the entry
+    // hasn't been invalidated while uploading.
+    auto global_lock = processor_.global_critical_region_.Acquire();
+    auto cache_map_it = processor_.cache_map_.find(key_);
+    if (cache_map_it != processor_.cache_map_.end()) {
+      CacheEntry& entry = processor_.cache_entry_pool_[cache_map_it->second];
+      if (entry.host_indices == reupload_indices) {
+        entry.result.host_index_buffer_handle =
+            result_.host_index_buffer_handle;
+        entry.result_frame = processor_.cache_frame_;
+      }
+    }
+    return;
+  }
   if (result_type_ != ResultType::kExisting) {
     // Enable the invalidation callback before reading the indices.
     // Also, only enable invalidation callbacks if anything needed processing at
@@ -1452,6 +1097,44 @@ PrimitiveProcessor::CacheTransaction::CacheTransaction(
   }
 }
 
+void* PrimitiveProcessor::CacheTransaction::RequestHostConvertedIndexBuffer(
+    xenos::IndexFormat format, uint32_t index_count, bool coalign_for_simd,
+    size_t& backend_handle_out) {
+  assert_true(result_type_ == ResultType::kNewUnset);
+  void* mapping = processor_.RequestHostConvertedIndexBufferForCurrentFrame(
+      format, index_count, coalign_for_simd, key_.base, backend_handle_out);
+  if (!mapping || !key_.count) {
+    return mapping;
+  }
+  host_indices_size_bytes_ =
+      uint32_t(format == xenos::IndexFormat::kInt16 ? sizeof(uint16_t)
+                                                    : sizeof(uint32_t)) *
+      index_count;
+  // Not value-initializing, the processor writes all the indices.
+  host_indices_storage_ = std::shared_ptr<uint8_t[]>(
+      new uint8_t[host_indices_size_bytes_ +
+                  (coalign_for_simd ? XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
+                                    : 0)]);
+  host_indices_ = host_indices_storage_.get();
+  if (coalign_for_simd) {
+    host_indices_ += GetSimdCoalignmentOffset(host_indices_, key_.base);
+  }
+  host_indices_mapping_ = mapping;
+  return host_indices_;
+}
+
+void PrimitiveProcessor::CacheTransaction::SetNewResult(
+    const CachedResult& new_result) {
+  // Replacement of an existing entry is not allowed.
+  assert_true(result_type_ != ResultType::kExisting);
+  result_ = new_result;
+  result_type_ = ResultType::kNewSet;
+  if (host_indices_mapping_) {
+    std::memcpy(host_indices_mapping_, host_indices_,
+                host_indices_size_bytes_);
+  }
+}
+
 PrimitiveProcessor::CacheTransaction::~CacheTransaction() {
   if (!key_.count || result_type_ == ResultType::kExisting) {
     return;
@@ -1508,11 +1191,68 @@ PrimitiveProcessor::CacheTransaction::~CacheTransaction() {
 
     new_entry.key = key_;
     new_entry.result = result_;
+    new_entry.host_indices_storage = std::move(host_indices_storage_);
+    new_entry.host_indices = host_indices_;
+    new_entry.host_indices_size_bytes = host_indices_size_bytes_;
+    new_entry.result_frame = processor_.cache_frame_;
+    new_entry.last_used_frame = processor_.cache_frame_;
+    processor_.cache_host_indices_size_bytes_ += host_indices_size_bytes_;
 
     processor_.cache_map_.emplace(key_, new_entry_index);
   }
 }
 
+void PrimitiveProcessor::RemoveCacheEntry(
+    size_t entry_index, const global_unique_lock_type& global_lock) {
+  CacheEntry& entry = cache_entry_pool_[entry_index];
+  // Remove the entry from the cache map.
+  auto entry_map_it = cache_map_.find(entry.key);
+  assert_true(entry_map_it != cache_map_.end());
+  if (entry_map_it != cache_map_.end()) {
+    cache_map_.erase(entry_map_it);
+  }
+  // Unlink the entry from the bucket's list.
+  uint32_t entry_bucket_index_first =
+      entry.key.base >> kCacheBucketSizeBytesLog2;
+  uint32_t entry_link_count = entry.GetBucketCount();
+  for (uint32_t entry_link_index = 0; entry_link_index < entry_link_count;
+       ++entry_link_index) {
+    uint32_t entry_bucket_index = entry_bucket_index_first + entry_link_index;
+    size_t entry_link_prev = entry.buckets_prev[entry_link_index];
+    size_t entry_link_next = entry.buckets_next[entry_link_index];
+    if (entry_link_prev != SIZE_MAX) {
+      CacheEntry& entry_prev = cache_entry_pool_[entry_link_prev];
+      entry_prev.buckets_next[size_t(
+          (entry_prev.key.base >> kCacheBucketSizeBytesLog2) !=
+          entry_bucket_index)] = entry_link_next;
+    } else {
+      if (entry_link_next != SIZE_MAX) {
+        cache_bucket_first_entries_[entry_bucket_index] = entry_link_next;
+      } else {
+        // The only entry that was remaining in the bucket - it's empty now.
+        cache_buckets_non_empty_l1_[entry_bucket_index >> 6] &=
+            ~(uint64_t(1) << (entry_bucket_index & 63));
+        UpdateCacheBucketsNonEmptyL2(entry_bucket_index >> 6, global_lock);
+      }
+    }
+    if (entry_link_next != SIZE_MAX) {
+      CacheEntry& entry_next = cache_entry_pool_[entry_link_next];
+      entry_next.buckets_prev[size_t(
+          (entry_next.key.base >> kCacheBucketSizeBytesLog2) !=
+          entry_bucket_index)] = entry_link_prev;
+    }
+  }
+  // Release the converted indices (a cache transaction may still be uploading
+  // them, holding another reference).
+  cache_host_indices_size_bytes_ -= entry.host_indices_size_bytes;
+  entry.host_indices_storage.reset();
+  entry.host_indices = nullptr;
+  entry.host_indices_size_bytes = 0;
+  // Make the entry free for reuse.
+  entry.free_next = cache_bucket_free_first_entry_;
+  cache_bucket_free_first_entry_ = entry_index;
+}
+
 std::pair<uint32_t, uint32_t> PrimitiveProcessor::MemoryInvalidationCallback(
     uint32_t physical_address_start, uint32_t length, bool exact_range) {
   if (length == 0 || physical_address_start >= SharedMemory::kBufferSize) {
@@ -1607,57 +1347,10 @@ std::pair<uint32_t, uint32_t> PrimitiveProcessor::MemoryInvalidationCallback(
           // the specified range.
           if (entry_key.base < physical_address_end) {
             uint32_t entry_end = entry_key.base + entry_key.GetSizeBytes();
-            if (entry_end > physical_address_end) {
+            if (entry_end > physical_address_start) {
               // Invalidate the entry.
               any_invalidated = true;
-              // Remove the entry from the cache map.
-              auto entry_map_it = cache_map_.find(entry_key);
-              assert_true(entry_map_it != cache_map_.end());
-              if (entry_map_it != cache_map_.end()) {
-                cache_map_.erase(entry_map_it);
-              }
-              // Unlink the entry from the bucket's list.
-              uint32_t entry_link_index_last =
-                  ((entry_end - 1) >> kCacheBucketSizeBytesLog2) -
-                  entry_bucket_index_first;
-              assert_true(
-                  entry_link_index_last <= 1,
-                  "Cache entries only store list links within two buckets");
-              for (uint32_t entry_link_index = 0;
-                   entry_link_index <= entry_link_index_last;
-                   ++entry_link_index) {
-                uint32_t entry_bucket_index =
-                    entry_bucket_index_first + entry_link_index;
-                size_t entry_link_prev = entry.buckets_prev[entry_link_index];
-                size_t entry_link_next = entry.buckets_next[entry_link_index];
-                if (entry_link_prev != SIZE_MAX) {
-                  CacheEntry& entry_prev = cache_entry_pool_[entry_link_prev];
-                  entry_prev.buckets_next[size_t(
-                      (entry_prev.key.base >> kCacheBucketSizeBytesLog2) !=
-                      entry_bucket_index)] = entry_link_next;
-                } else {
-                  if (entry_link_next != SIZE_MAX) {
-                    cache_bucket_first_entries_[entry_bucket_index] =
-                        entry_link_next;
-                  } else {
-                    // The only entry that was remaining in the bucket - it's
-                    // empty now.
-                    cache_buckets_non_empty_l1_[entry_bucket_index >> 6] &=
-                        ~(uint64_t(1) << (entry_bucket_index & 63));
-                    UpdateCacheBucketsNonEmptyL2(entry_bucket_index >> 6,
-                                                 global_lock);
-                  }
-                }
-                if (entry_link_next != SIZE_MAX) {
-                  CacheEntry& entry_next = cache_entry_pool_[entry_link_next];
-                  entry_next.buckets_prev[size_t(
-                      (entry_next.key.base >> kCacheBucketSizeBytesLog2) !=
-                      entry_bucket_index)] = entry_link_prev;
-                }
-              }
-              // Make the entry free for reuse.
-              entry.free_next = cache_bucket_free_first_entry_;
-              cache_bucket_free_first_entry_ = entry_index;
+              RemoveCacheEntry(entry_index, global_lock);
             }
           }
           entry_index = next_entry_index;
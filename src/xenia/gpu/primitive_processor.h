@@ -17,15 +17,18 @@
 #include <cstring>
 #include <deque>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "xenia/base/assert.h"
 #include "xenia/base/cvar.h"
 #include "xenia/base/math.h"
 #include "xenia/base/mutex.h"
 #include "xenia/base/platform.h"
+#include "xenia/gpu/primitive_conversion.h"
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/shader.h"
 #include "xenia/gpu/shared_memory.h"
@@ -33,14 +36,9 @@
 #include "xenia/gpu/xenos.h"
 #include "xenia/memory.h"
 
-#if XE_ARCH_AMD64
-// 128-bit SSSE3-level (SSE2+ for integer comparison, SSSE3 for pshufb) or AVX
-// (256-bit AVX only got integer operations such as comparison in AVX2, which is
-// above the minimum requirements of Xenia).
-#include <tmmintrin.h>
-#define XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE 16
-#elif XE_ARCH_ARM64
-#include <arm_neon.h>
+// The alignment of vectors used by the SIMD kernels in primitive_conversion
+// that the guest and the host index buffers are co-aligned to.
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
 #define XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE 16
 #else
 #define XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE 0
@@ -270,10 +268,13 @@ class PrimitiveProcessor {
   // destructor.
   void ShutdownCommon();
 
-  // Call at boundaries of lifespans of converted data (between frames,
-  // preferably in the end of a frame so between the swap and the next draw,
-  // access violation handlers need to do less work).
-  void ClearPerFrameCache();
+  // Call at boundaries of lifespans of the host buffers returned by
+  // RequestHostConvertedIndexBufferForCurrentFrame (between frames, preferably
+  // in the end of a frame so between the swap and the next draw, access
+  // violation handlers need to do less work). Cached conversion results are
+  // kept across frames, but the least recently used ones are evicted if the
+  // converted indices stored for them exceed the cache memory budget.
+  void EndCacheFrame();
 
   static constexpr size_t GetBuiltinIndexBufferOffsetBytes(size_t handle) {
     // For simplicity, just using the handles as byte offsets.
@@ -317,216 +318,10 @@ class PrimitiveProcessor {
       uint32_t coalignment_original_address, size_t& backend_handle_out) = 0;
 
  private:
-#if XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-#if XE_ARCH_AMD64
-  // SSSE3 or AVX.
-  using SimdVectorU16 = __m128i;
-  using SimdVectorU32 = __m128i;
-  static SimdVectorU16 ReplicateU16(uint16_t value) {
-    return _mm_set1_epi16(int16_t(value));
-  }
-  static SimdVectorU32 ReplicateU32(uint32_t value) {
-    return _mm_set1_epi32(int32_t(value));
-  }
-  static SimdVectorU16 LoadAlignedVectorU16(const uint16_t* source) {
-    return _mm_load_si128(reinterpret_cast<const __m128i*>(source));
-  }
-  static SimdVectorU32 LoadAlignedVectorU32(const uint32_t* source) {
-    return _mm_load_si128(reinterpret_cast<const __m128i*>(source));
-  }
-  static void StoreUnalignedVectorU16(uint16_t* dest, SimdVectorU16 source) {
-    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), source);
-  }
-  static void StoreUnalignedVectorU32(uint32_t* dest, SimdVectorU32 source) {
-    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), source);
-  }
-#elif XE_ARCH_ARM64
-  // NEON.
-  using SimdVectorU16 = uint16x8_t;
-  using SimdVectorU32 = uint32x4_t;
-  static SimdVectorU16 ReplicateU16(uint16_t value) {
-    return vdupq_n_u16(value);
-  }
-  static SimdVectorU32 ReplicateU32(uint32_t value) {
-    return vdupq_n_u32(value);
-  }
-  static SimdVectorU16 LoadAlignedVectorU16(const uint16_t* source) {
-#if XE_COMPILER_MSVC
-    return vld1q_u16_ex(source, sizeof(uint16x8_t) * CHAR_BIT);
-#else
-    return vld1q_u16(reinterpret_cast<const uint16_t*>(
-        __builtin_assume_aligned(source, sizeof(uint16x8_t))));
-#endif
-  }
-  static SimdVectorU32 LoadAlignedVectorU32(const uint32_t* source) {
-#if XE_COMPILER_MSVC
-    return vld1q_u32_ex(source, sizeof(uint16x8_t) * CHAR_BIT);
-#else
-    return vld1q_u32(reinterpret_cast<const uint32_t*>(
-        __builtin_assume_aligned(source, sizeof(uint32x4_t))));
-#endif
-  }
-  static void StoreUnalignedVectorU16(uint16_t* dest, SimdVectorU16 source) {
-    vst1q_u16(dest, source);
-  }
-  static void StoreUnalignedVectorU32(uint32_t* dest, SimdVectorU32 source) {
-    vst1q_u32(dest, source);
-  }
-#else
-#error SIMD vector types and constant loads not specified.
-#endif  // XE_ARCH
-  static_assert(
-      sizeof(SimdVectorU16) == XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE,
-      "XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE must reflect the vector size "
-      "actually used");
-  static_assert(
-      sizeof(SimdVectorU32) == XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE,
-      "XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE must reflect the vector size "
-      "actually used");
-  static constexpr uint32_t kSimdVectorU16Elements =
-      sizeof(SimdVectorU16) / sizeof(uint16_t);
-  static constexpr uint32_t kSimdVectorU32Elements =
-      sizeof(SimdVectorU32) / sizeof(uint32_t);
-#endif  // XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-
-  static bool IsResetUsed(const uint16_t* source, uint32_t count,
-                          uint16_t reset_index_guest_endian);
-  static void Get16BitResetIndexUsage(const uint16_t* source, uint32_t count,
-                                      uint16_t reset_index_guest_endian,
-                                      bool& is_reset_index_used_out,
-                                      bool& is_ffff_used_as_vertex_index_out);
-  static bool IsResetUsed(const uint32_t* source, uint32_t count,
-                          uint32_t reset_index_guest_endian,
-                          uint32_t low_bits_mask_guest_endian);
-  static void ReplaceResetIndex16To16(uint16_t* dest, const uint16_t* source,
-                                      uint32_t count,
-                                      uint16_t reset_index_guest_endian);
-  // For use when the reset index is not 0xFFFF, and 0xFFFF is also used as a
-  // valid index - keeps 0xFFFF as a real index and replaces the reset index
-  // with 0xFFFFFFFF instead.
-  static void ReplaceResetIndex16To24(uint32_t* dest, const uint16_t* source,
-                                      uint32_t count,
-                                      uint16_t reset_index_guest_endian);
-  // The reset index and the low 24 bits mask are taken explicitly because this
-  // function may be used two ways:
-  // - Passthrough - when the vertex shader swaps the indices (when 32-bit
-  //   indices are supported on the host), in this case HostSwap is kNone, but
-  //   the reset index and the guest low bits mask can be swapped according to
-  //   the guest endian.
-  // - Swapping for the host - when only 24 bits of an index are supported on
-  //   the host. In this case, masking and comparison are done before applying
-  //   HostSwap, but according to HostSwap, if needed, the data is swapped from
-  //   the PowerPC's big endianness to the host GPU little endianness that we
-  //   assume, which matches the Xenos's little endianness.
-  template <xenos::Endian HostSwap>
-  static void ReplaceResetIndex32To24(uint32_t* dest, const uint32_t* source,
-                                      uint32_t count,
-                                      uint32_t reset_index_guest_endian,
-                                      uint32_t low_bits_mask_guest_endian) {
-    // The Xbox 360's GPU only uses the low 24 bits of the index - masking.
-#if XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-    while (count && (reinterpret_cast<uintptr_t>(source) &
-                     (XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE - 1))) {
-      --count;
-      uint32_t index = *(source++) & low_bits_mask_guest_endian;
-      *(dest++) = index != reset_index_guest_endian
-                      ? xenos::GpuSwapInline(index, HostSwap)
-                      : UINT32_MAX;
-    }
-    if (count >= kSimdVectorU32Elements) {
-      SimdVectorU32 reset_index_guest_endian_simd =
-          ReplicateU32(reset_index_guest_endian);
-      SimdVectorU32 low_bits_mask_guest_endian_simd =
-          ReplicateU32(low_bits_mask_guest_endian);
-#if XE_ARCH_AMD64
-      __m128i host_swap_shuffle;
-      if constexpr (HostSwap != xenos::Endian::kNone) {
-        host_swap_shuffle = _mm_set_epi32(
-            int32_t(xenos::GpuSwapInline(uint32_t(0x0F0E0D0C), HostSwap)),
-            int32_t(xenos::GpuSwapInline(uint32_t(0x0B0A0908), HostSwap)),
-            int32_t(xenos::GpuSwapInline(uint32_t(0x07060504), HostSwap)),
-            int32_t(xenos::GpuSwapInline(uint32_t(0x03020100), HostSwap)));
-      }
-#endif  // XE_ARCH_AMD64
-      while (count >= kSimdVectorU32Elements) {
-        count -= kSimdVectorU32Elements;
-        // Comparison produces 0 or 0xFFFF on AVX and Neon - we need 0xFFFF as
-        // the result for the primitive reset indices, so the result is
-        // `index | (index == reset_index)`.
-        SimdVectorU32 source_simd = LoadAlignedVectorU32(source);
-        source += kSimdVectorU32Elements;
-        SimdVectorU32 result_simd;
-#if XE_ARCH_AMD64
-        source_simd =
-            _mm_and_si128(source_simd, low_bits_mask_guest_endian_simd);
-        result_simd = _mm_or_si128(
-            source_simd,
-            _mm_cmpeq_epi32(source_simd, reset_index_guest_endian_simd));
-        if constexpr (HostSwap != xenos::Endian::kNone) {
-          result_simd = _mm_shuffle_epi8(result_simd, host_swap_shuffle);
-        }
-#elif XE_ARCH_ARM64
-        source_simd = vandq_u32(source_simd, low_bits_mask_guest_endian_simd);
-        result_simd = vorrq_u32(
-            source_simd, vceqq_u32(source_simd, reset_index_guest_endian_simd));
-        if constexpr (HostSwap == xenos::Endian::k8in16) {
-          result_simd = vreinterpretq_u32_u8(
-              vrev16q_u8(vreinterpretq_u8_u32(result_simd)));
-        } else if constexpr (HostSwap == xenos::Endian::k8in32) {
-          result_simd = vreinterpretq_u32_u8(
-              vrev32q_u8(vreinterpretq_u8_u32(result_simd)));
-        } else if constexpr (HostSwap == xenos::Endian::k16in32) {
-          result_simd = vreinterpretq_u32_u16(
-              vrev32q_u16(vreinterpretq_u16_u32(result_simd)));
-        }
-#else
-#error SIMD ReplaceResetIndex32To24 not implemented.
-#endif  // XE_ARCH
-        StoreUnalignedVectorU32(dest, result_simd);
-        dest += kSimdVectorU32Elements;
-      }
-    }
-#endif  // XE_GPU_PRIMITIVE_PROCESSOR_SIMD_SIZE
-    while (count--) {
-      uint32_t index = *(source++) & low_bits_mask_guest_endian;
-      *(dest++) = index != reset_index_guest_endian
-                      ? xenos::GpuSwapInline(index, HostSwap)
-                      : UINT32_MAX;
-    }
-  }
-
   // TODO(Triang3l): 16-bit > 32-bit primitive type conversion for Metal, where
   // primitive reset is always enabled, if UINT16_MAX is used as a real vertex
   // index.
 
-  struct PassthroughIndexTransform {
-    uint16_t operator()(uint16_t index) const { return index; }
-    uint32_t operator()(uint32_t index) const { return index; }
-  };
-  struct To24NonSwappingIndexTransform {
-    uint32_t operator()(uint32_t index) const {
-      return index & xenos::kVertexIndexMask;
-    }
-  };
-  struct To24Swapping8In16IndexTransform {
-    uint32_t operator()(uint32_t index) const {
-      return xenos::GpuSwapInline(index, xenos::Endian::k8in16) &
-             xenos::kVertexIndexMask;
-    }
-  };
-  struct To24Swapping8In32IndexTransform {
-    uint32_t operator()(uint32_t index) const {
-      return xenos::GpuSwapInline(index, xenos::Endian::k8in32) &
-             xenos::kVertexIndexMask;
-    }
-  };
-  struct To24Swapping16In32IndexTransform {
-    uint32_t operator()(uint32_t index) const {
-      return xenos::GpuSwapInline(index, xenos::Endian::k16in32) &
-             xenos::kVertexIndexMask;
-    }
-  };
-
   static constexpr uint32_t GetTwoTriangleStripIndexCount(
       uint32_t strip_count) {
     // 4 vertices per strip, and primitive restarts between strips.
@@ -548,25 +343,6 @@ class PrimitiveProcessor {
       uint32_t fan_index_count) {
     return fan_index_count > 2 ? (fan_index_count - 2) * 3 : 0;
   }
-  template <typename Index, typename IndexTransform>
-  static void TriangleFanToList(Index* dest, const Index* source,
-                                uint32_t source_index_count,
-                                const IndexTransform& index_transform) {
-    if (source_index_count <= 2) {
-      // To match GetTriangleFanListIndexCount.
-      return;
-    }
-    Index index_first = index_transform(source[0]);
-    Index index_previous = index_transform(source[1]);
-    for (uint32_t i = 2; i < source_index_count; ++i) {
-      Index index_current = index_transform(source[i]);
-      *(dest++) = index_previous;
-      *(dest++) = index_current;
-      *(dest++) = index_first;
-      index_previous = index_current;
-    }
-  }
-
   static constexpr uint32_t GetLineLoopStripIndexCount(
       uint32_t loop_index_count) {
     // Even if 2 vertices are supplied, two lines are still drawn between them.
@@ -575,27 +351,6 @@ class PrimitiveProcessor {
     // "If the user only specifies 1 vertex, the drawing command is ignored"
     return loop_index_count > 1 ? loop_index_count + 1 : 0;
   }
-  template <typename Index, typename IndexTransform>
-  static void LineLoopToStrip(Index* dest, const Index* source,
-                              uint32_t source_index_count,
-                              const IndexTransform& index_transform) {
-    if (source_index_count <= 1) {
-      // To match GetLineLoopStripIndexCount.
-      return;
-    }
-    Index index_first = index_transform(source[0]);
-    dest[0] = index_first;
-    for (uint32_t i = 1; i < source_index_count; ++i) {
-      dest[i] = index_transform(source[i]);
-    }
-    dest[source_index_count] = index_first;
-  }
-  static void LineLoopToStrip(uint16_t* dest, const uint16_t* source,
-                              uint32_t source_index_count,
-                              const PassthroughIndexTransform& index_transform);
-  static void LineLoopToStrip(uint32_t* dest, const uint32_t* source,
-                              uint32_t source_index_count,
-                              const PassthroughIndexTransform& index_transform);
 
   // Quad list test cases:
   // - 4D5307E6 - main menu - flying dust on the road - no index buffer.
@@ -603,25 +358,6 @@ class PrimitiveProcessor {
       uint32_t quad_list_index_count) {
     return (quad_list_index_count / 4) * 6;
   }
-  template <typename Index, typename IndexTransform>
-  static void QuadListToTriangleList(Index* dest, const Index* source,
-                                     uint32_t source_index_count,
-                                     const IndexTransform& index_transform) {
-    uint32_t quad_count = source_index_count / 4;
-    for (uint32_t i = 0; i < quad_count; ++i) {
-      // TODO(Triang3l): Find the correct order.
-      // v0, v1, v2.
-      Index common_index_0 = index_transform(*(source++));
-      *(dest++) = common_index_0;
-      *(dest++) = index_transform(*(source++));
-      Index common_index_2 = index_transform(*(source++));
-      *(dest++) = common_index_2;
-      // v0, v2, v3.
-      *(dest++) = common_index_0;
-      *(dest++) = common_index_2;
-      *(dest++) = index_transform(*(source++));
-    }
-  }
 
   // Pre-gathering the ranges allows for usage of the same functions for
   // conversion with and without reset. In addition, this increases safety in
@@ -650,12 +386,11 @@ class PrimitiveProcessor {
       uint32_t reset_index_guest_endian, uint32_t low_bits_mask_guest_endian,
       std::deque<SinglePrimitiveRange>& ranges_append_out);
 
-  template <typename Index, typename IndexTransform,
-            typename PrimitiveRangeIterator>
+  template <typename Index, typename PrimitiveRangeIterator>
   static void ConvertSinglePrimitiveRanges(
       Index* dest, const Index* source,
       xenos::PrimitiveType source_primitive_type,
-      const IndexTransform& index_transform,
+      primitive_conversion::IndexTransform index_transform,
       PrimitiveRangeIterator ranges_beginning,
       PrimitiveRangeIterator ranges_end) {
     Index* dest_write_ptr = dest;
@@ -663,25 +398,27 @@ class PrimitiveProcessor {
       case xenos::PrimitiveType::kTriangleFan:
         for (PrimitiveRangeIterator range_it = ranges_beginning;
              range_it != ranges_end; ++range_it) {
-          TriangleFanToList(dest_write_ptr, source + range_it->guest_offset,
-                            range_it->guest_index_count, index_transform);
+          primitive_conversion::TriangleFanToList(
+              dest_write_ptr, source + range_it->guest_offset,
+              range_it->guest_index_count, index_transform);
           dest_write_ptr += range_it->host_index_count;
         }
         break;
       case xenos::PrimitiveType::kLineLoop:
         for (PrimitiveRangeIterator range_it = ranges_beginning;
              range_it != ranges_end; ++range_it) {
-          LineLoopToStrip(dest_write_ptr, source + range_it->guest_offset,
-                          range_it->guest_index_count, index_transform);
+          primitive_conversion::LineLoopToStrip(
+              dest_write_ptr, source + range_it->guest_offset,
+              range_it->guest_index_count, index_transform);
           dest_write_ptr += range_it->host_index_count;
         }
         break;
       case xenos::PrimitiveType::kQuadList:
         for (PrimitiveRangeIterator range_it = ranges_beginning;
              range_it != ranges_end; ++range_it) {
-          QuadListToTriangleList(dest_write_ptr,
-                                 source + range_it->guest_offset,
-                                 range_it->guest_index_count, index_transform);
+          primitive_conversion::QuadListToTriangleList(
+              dest_write_ptr, source + range_it->guest_offset,
+              range_it->guest_index_count, index_transform);
           dest_write_ptr += range_it->host_index_count;
         }
         break;
@@ -709,7 +446,8 @@ class PrimitiveProcessor {
 
   std::deque<SinglePrimitiveRange> single_primitive_ranges_;
 
-  // Caching for reuse of converted indices within a frame.
+  // Caching for reuse of converted indices within a frame and in subsequent
+  // frames while the guest indices are not modified.
 
   // 256 KB as the largest possible guest index buffer - 0xFFFF 32-bit indices -
   // is slightly smaller than 256 KB, thus cache entries need store links within
@@ -792,6 +530,17 @@ class PrimitiveProcessor {
     size_t buckets_next[2];
     CacheKey key;
     CachedResult result;
+    // For kHostConverted results, a copy of the converted indices to upload
+    // again in frames after the one the result was created or last uploaded
+    // in, since the host buffer of result is only valid within that frame.
+    // Shared with cache transactions uploading the indices outside the global
+    // critical region, which the entry may be invalidated during.
+    std::shared_ptr<uint8_t[]> host_indices_storage;
+    const uint8_t* host_indices = nullptr;
+    uint32_t host_indices_size_bytes = 0;
+    // cache_frame_ when host_index_buffer_handle of result was obtained.
+    uint64_t result_frame = 0;
+    uint64_t last_used_frame = 0;
     static uint32_t GetBucketCount(CacheKey key) {
       uint32_t count =
           ((key.base + (key.GetSizeBytes() - 1)) >> kCacheBucketSizeBytesLog2) -
@@ -824,19 +573,26 @@ class PrimitiveProcessor {
   //     entry in the cache.
   // If an entry was found in the cache (GetFoundResult results non-null), it
   // MUST be used instead of processing - this class doesn't provide the
-  // possibility replace existing entries.
+  // possibility replace existing entries. If it was created in an earlier
+  // frame, its converted indices are uploaded to a buffer for the current frame
+  // during the lookup.
   class CacheTransaction final {
    public:
     CacheTransaction(PrimitiveProcessor& processor, CacheKey key);
     const CachedResult* GetFoundResult() const {
       return result_type_ == ResultType::kExisting ? &result_ : nullptr;
     }
-    void SetNewResult(const CachedResult& new_result) {
-      // Replacement of an existing entry is not allowed.
-      assert_true(result_type_ != ResultType::kExisting);
-      result_ = new_result;
-      result_type_ = ResultType::kNewSet;
-    }
+    // Replacement for RequestHostConvertedIndexBufferForCurrentFrame for the
+    // new result. If the result is going to be cached, returns a buffer in the
+    // CPU memory to write the converted indices to, which SetNewResult copies
+    // to the host buffer for the current frame, so the indices can be uploaded
+    // again in later frames (and the host buffer, which may be write-combined
+    // upload memory, is not read).
+    void* RequestHostConvertedIndexBuffer(xenos::IndexFormat format,
+                                          uint32_t index_count,
+                                          bool coalign_for_simd,
+                                          size_t& backend_handle_out);
+    void SetNewResult(const CachedResult& new_result);
     ~CacheTransaction();
 
    private:
@@ -853,10 +609,19 @@ class PrimitiveProcessor {
       kExisting,
     };
     ResultType result_type_ = ResultType::kNewUnset;
+    std::shared_ptr<uint8_t[]> host_indices_storage_;
+    uint8_t* host_indices_ = nullptr;
+    uint32_t host_indices_size_bytes_ = 0;
+    void* host_indices_mapping_ = nullptr;
   };
 
   std::deque<CacheEntry> cache_entry_pool_;
 
+  // Incremented in EndCacheFrame. Accessed only by the processor.
+  uint64_t cache_frame_ = 0;
+  // Reused between EndCacheFrame calls to avoid allocations.
+  std::vector<std::pair<uint64_t, size_t>> cache_eviction_order_;
+
   void* memory_invalidation_callback_handle_ = nullptr;
 
   xe::global_critical_region global_critical_region_;
@@ -873,6 +638,10 @@ class PrimitiveProcessor {
   uint32_t cache_currently_processing_size_bytes_ = 0;
   // Modified by both the processor and the invalidation callback.
   size_t cache_bucket_free_first_entry_ = SIZE_MAX;
+  // Total host_indices_size_bytes of the entries in the cache, for the memory
+  // budget.
+  // Modified by both the processor and the invalidation callback.
+  uint64_t cache_host_indices_size_bytes_ = 0;
   // Modified by both the processor and the invalidation callback.
   uint64_t cache_buckets_non_empty_l1_[(kCacheBucketCount + 63) / 64] = {};
   // For even faster handling of memory invalidation - whether any bit is set in
@@ -900,6 +669,10 @@ class PrimitiveProcessor {
   // Huge, so it's the last in the class.
   // Modified by both the processor and the invalidation callback.
   size_t cache_bucket_first_entries_[kCacheBucketCount];
+  // Removes an entry from the cache map and the buckets, and makes it free for
+  // reuse. Must be called in a global critical region.
+  void RemoveCacheEntry(size_t entry_index,
+                        const global_unique_lock_type& global_lock);
   static std::pair<uint32_t, uint32_t> MemoryInvalidationCallbackThunk(
       void* context_ptr, uint32_t physical_address_start, uint32_t length,
       bool exact_range);
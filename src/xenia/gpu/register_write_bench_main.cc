@@ -0,0 +1,345 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "xenia/base/bit_range.h"
+#include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/math.h"
+#include "xenia/gpu/register_file.h"
+#include "xenia/gpu/register_write_ranges.h"
+#include "xenia/gpu/registers.h"
+#include "xenia/gpu/trace_reader.h"
+#include "xenia/gpu/xenos.h"
+
+DEFINE_path(register_write_bench_trace, "",
+            "Trace file to take the PM4 packets from. If not specified, "
+            "packets similar to those written by Direct3D 9 for typical draws "
+            "are generated.",
+            "GPU");
+DEFINE_uint32(register_write_bench_total_registers, 256 * 1024 * 1024,
+              "Number of guest register writes to perform with each method.",
+              "GPU");
+
+namespace xe {
+namespace gpu {
+
+namespace {
+
+// Register writes from a packet with the values in the guest byte order.
+struct RegisterWriteRun {
+  uint32_t first_index;
+  const uint32_t* values;
+  uint32_t count;
+};
+
+// Collects the register writes done by the packets in the ring buffer contents,
+// excluding those with the values in the guest memory rather than in the ring.
+void GetPacketRegisterWrites(const uint32_t* ring, uint32_t dword_count,
+                             std::vector<RegisterWriteRun>& runs) {
+  uint32_t offset = 0;
+  while (offset < dword_count) {
+    uint32_t packet = xe::load_and_swap<uint32_t>(ring + offset);
+    const uint32_t* data = ring + offset + 1;
+    uint32_t data_count = 0;
+    switch (packet >> 30) {
+      case 0x0: {
+        data_count = ((packet >> 16) & 0x3FFF) + 1;
+        if (offset + 1 + data_count > dword_count) {
+          return;
+        }
+        uint32_t base_index = packet & 0x7FFF;
+        if ((packet >> 15) & 0x1) {
+          for (uint32_t i = 0; i < data_count; ++i) {
+            runs.push_back({base_index, data + i, 1});
+          }
+        } else {
+          runs.push_back({base_index, data, data_count});
+        }
+      } break;
+      case 0x1:
+        data_count = 2;
+        if (offset + 1 + data_count > dword_count) {
+          return;
+        }
+        runs.push_back({packet & 0x7FF, data, 1});
+        runs.push_back({(packet >> 11) & 0x7FF, data + 1, 1});
+        break;
+      case 0x2:
+        break;
+      case 0x3: {
+        data_count = ((packet >> 16) & 0x3FFF) + 1;
+        if (offset + 1 + data_count > dword_count) {
+          return;
+        }
+        uint32_t offset_type = xe::load_and_swap<uint32_t>(data);
+        switch ((packet >> 8) & 0x7F) {
+          case xenos::PM4_SET_CONSTANT: {
+            static const uint32_t kSetConstantBases[] = {
+                XE_GPU_REG_SHADER_CONSTANT_000_X,
+                XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0,
+                XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031,
+                XE_GPU_REG_SHADER_CONSTANT_LOOP_00,
+                0x2000,
+            };
+            uint32_t type = (offset_type >> 16) & 0xFF;
+            if (type < xe::countof(kSetConstantBases)) {
+              runs.push_back(
+                  {kSetConstantBases[type] + (offset_type & 0x7FF), data + 1,
+                   data_count - 1});
+            }
+          } break;
+          case xenos::PM4_SET_CONSTANT2:
+          case xenos::PM4_SET_SHADER_CONSTANTS:
+            runs.push_back({offset_type & 0xFFFF, data + 1, data_count - 1});
+            break;
+        }
+      } break;
+    }
+    offset += 1 + data_count;
+  }
+}
+
+// Packets for draws with the vertex and pixel shader constants, a fetch
+// constant, and a few other registers changed.
+std::vector<uint32_t> GenerateRing(uint32_t draw_count) {
+  std::mt19937 random_engine;
+  std::vector<uint32_t> ring;
+  auto append_set_constant = [&](uint32_t type, uint32_t index,
+                                 uint32_t count) {
+    ring.push_back(xe::byte_swap((UINT32_C(3) << 30) | (count << 16) |
+                                 (uint32_t(xenos::PM4_SET_CONSTANT) << 8)));
+    ring.push_back(xe::byte_swap((type << 16) | index));
+    for (uint32_t i = 0; i < count; ++i) {
+      ring.push_back(uint32_t(random_engine()));
+    }
+  };
+  for (uint32_t i = 0; i < draw_count; ++i) {
+    // Vertex shader constants.
+    append_set_constant(0, 4 * (random_engine() % 16), 4 * 16);
+    // Pixel shader constants.
+    append_set_constant(0, 4 * (256 + random_engine() % 32), 4 * 8);
+    append_set_constant(1, 6 * (random_engine() % 32), 6);
+    append_set_constant(2, 0, 1);
+    // RB_COLOR_INFO and the following registers.
+    uint32_t type_0_count = 4;
+    ring.push_back(xe::byte_swap(((type_0_count - 1) << 16) |
+                                 uint32_t(XE_GPU_REG_RB_COLOR_INFO)));
+    for (uint32_t j = 0; j < type_0_count; ++j) {
+      ring.push_back(uint32_t(random_engine()));
+    }
+  }
+  return ring;
+}
+
+// The float constants used by the current shaders, for the constant buffer
+// invalidation checks.
+struct BenchState {
+  uint64_t float_constant_map_vertex[4];
+  uint64_t float_constant_map_pixel[4];
+  bool float_constants_vertex_up_to_date;
+  bool float_constants_pixel_up_to_date;
+  uint32_t fetch_constants_written;
+  uint32_t special_registers_written;
+};
+
+// Like Vulkan/D3D12CommandProcessor::WriteRegister.
+void WriteRegisterRunIndividually(RegisterFile& register_file,
+                                  const RegisterWriteRun& run,
+                                  BenchState& state) {
+  for (uint32_t i = 0; i < run.count; ++i) {
+    uint32_t index = run.first_index + i;
+    if (index >= RegisterFile::kRegisterCount) {
+      break;
+    }
+    uint32_t value = xe::load_and_swap<uint32_t>(run.values + i);
+    register_file.values[index] = value;
+    if (index - XE_GPU_REG_SCRATCH_REG0 < 8 ||
+        index == XE_GPU_REG_COHER_STATUS_HOST ||
+        index - XE_GPU_REG_DC_LUT_RW_INDEX <=
+            XE_GPU_REG_DC_LUT_30_COLOR - XE_GPU_REG_DC_LUT_RW_INDEX) {
+      ++state.special_registers_written;
+    } else if (index >= XE_GPU_REG_SHADER_CONSTANT_000_X &&
+               index <= XE_GPU_REG_SHADER_CONSTANT_511_W) {
+      uint32_t float_constant_index =
+          (index - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2;
+      if (float_constant_index >= 256) {
+        float_constant_index -= 256;
+        if (state.float_constant_map_pixel[float_constant_index >> 6] &
+            (UINT64_C(1) << (float_constant_index & 63))) {
+          state.float_constants_pixel_up_to_date = false;
+        }
+      } else {
+        if (state.float_constant_map_vertex[float_constant_index >> 6] &
+            (UINT64_C(1) << (float_constant_index & 63))) {
+          state.float_constants_vertex_up_to_date = false;
+        }
+      }
+    } else if (index >= XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0 &&
+               index <= XE_GPU_REG_SHADER_CONSTANT_FETCH_31_5) {
+      state.fetch_constants_written |=
+          UINT32_C(1) << ((index - XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) / 6);
+    }
+  }
+}
+
+// Like VulkanCommandProcessor::WriteRegistersFromMem.
+void WriteRegisterRunBatched(RegisterFile& register_file,
+                             const RegisterWriteRun& run, BenchState& state) {
+  struct Handler {
+    BenchState& state;
+    void OnSpecialRegisterWritten(uint32_t index, uint32_t value) {
+      ++state.special_registers_written;
+    }
+    void OnFloatConstantsWritten(uint32_t first_index, uint32_t count) {
+      uint32_t first_constant =
+          (first_index - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2;
+      uint32_t end_constant =
+          ((first_index + count - 1 - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2) +
+          1;
+      if (first_constant < 256 &&
+          bit_range::IsAnySet(
+              state.float_constant_map_vertex, first_constant,
+              std::min(end_constant, UINT32_C(256)) - first_constant)) {
+        state.float_constants_vertex_up_to_date = false;
+      }
+      if (end_constant > 256) {
+        uint32_t first_pixel_constant = std::max(first_constant, UINT32_C(256));
+        if (bit_range::IsAnySet(state.float_constant_map_pixel,
+                                first_pixel_constant - 256,
+                                end_constant - first_pixel_constant)) {
+          state.float_constants_pixel_up_to_date = false;
+        }
+      }
+    }
+    void OnFetchConstantsWritten(uint32_t first_index, uint32_t count) {
+      uint32_t first_fetch_constant, last_fetch_constant;
+      register_write_ranges::GetFetchConstantRange(
+          first_index, count, first_fetch_constant, last_fetch_constant);
+      state.fetch_constants_written |=
+          static_cast<uint32_t>((UINT64_C(1) << (last_fetch_constant + 1)) -
+                                (UINT64_C(1) << first_fetch_constant));
+    }
+    void OnBoolLoopConstantsWritten(uint32_t first_index, uint32_t count) {}
+  };
+  Handler handler = {state};
+  register_write_ranges::WriteRange(register_file.values, run.first_index,
+                                    run.values, run.count, handler);
+}
+
+void ResetBenchState(BenchState& state) {
+  // Typically only a few constants are used by the shaders.
+  std::memset(&state, 0, sizeof(state));
+  state.float_constant_map_vertex[0] = UINT64_C(0x00000000FFFF0000);
+  state.float_constant_map_pixel[0] = UINT64_C(0xFF00000000000000);
+  state.float_constants_vertex_up_to_date = true;
+  state.float_constants_pixel_up_to_date = true;
+}
+
+}  // namespace
+
+// Performs the guest register writes from PM4 packets, either recorded in a
+// trace or generated, one register at a time and with bulk copying of runs of
+// registers, and reports the throughput in millions of registers per second.
+int register_write_bench_main(const std::vector<std::string>& args) {
+  TraceReader trace_reader;
+  std::vector<uint32_t> trace_ring;
+  std::vector<uint32_t> generated_ring;
+  std::vector<RegisterWriteRun> runs;
+  if (!cvars::register_write_bench_trace.empty()) {
+    if (!trace_reader.Open(
+            xe::path_to_utf8(cvars::register_write_bench_trace))) {
+      XELOGE("Failed to open the trace file");
+      return 1;
+    }
+    // Frames are unloaded as others are accessed, copy the packets.
+    for (int i = 0; i < trace_reader.frame_count(); ++i) {
+      for (const PacketStartCommand* packet : trace_reader.frame(i)->packets) {
+        auto packet_dwords = reinterpret_cast<const uint32_t*>(packet + 1);
+        trace_ring.insert(trace_ring.end(), packet_dwords,
+                          packet_dwords + packet->count);
+      }
+    }
+    GetPacketRegisterWrites(trace_ring.data(), uint32_t(trace_ring.size()),
+                            runs);
+  } else {
+    generated_ring = GenerateRing(1024);
+    GetPacketRegisterWrites(generated_ring.data(),
+                            uint32_t(generated_ring.size()), runs);
+  }
+  uint64_t registers_per_pass = 0;
+  for (const RegisterWriteRun& run : runs) {
+    registers_per_pass += run.count;
+  }
+  if (!registers_per_pass) {
+    XELOGE("No register writes found in the packets");
+    return 1;
+  }
+  uint32_t passes = uint32_t(std::max(
+      cvars::register_write_bench_total_registers / registers_per_pass,
+      uint64_t(1)));
+  XELOGI("{} register writes in {} runs, {} passes", registers_per_pass,
+         runs.size(), passes);
+  double mega_registers = double(registers_per_pass) * passes / 1000000.0;
+  double tick_frequency = double(Clock::QueryHostTickFrequency());
+
+  auto register_file_individual = std::make_unique<RegisterFile>();
+  BenchState state_individual;
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  for (uint32_t i = 0; i < passes; ++i) {
+    ResetBenchState(state_individual);
+    for (const RegisterWriteRun& run : runs) {
+      WriteRegisterRunIndividually(*register_file_individual, run,
+                                   state_individual);
+    }
+  }
+  double individual_seconds =
+      double(Clock::QueryHostTickCount() - start_ticks) / tick_frequency;
+
+  auto register_file_batched = std::make_unique<RegisterFile>();
+  BenchState state_batched;
+  start_ticks = Clock::QueryHostTickCount();
+  for (uint32_t i = 0; i < passes; ++i) {
+    ResetBenchState(state_batched);
+    for (const RegisterWriteRun& run : runs) {
+      WriteRegisterRunBatched(*register_file_batched, run, state_batched);
+    }
+  }
+  double batched_seconds =
+      double(Clock::QueryHostTickCount() - start_ticks) / tick_frequency;
+
+  XELOGI("Individual {:.1f} M/s, batched {:.1f} M/s",
+         mega_registers / std::max(individual_seconds, 1e-9),
+         mega_registers / std::max(batched_seconds, 1e-9));
+  if (std::memcmp(register_file_individual->values,
+                  register_file_batched->values,
+                  sizeof(register_file_batched->values)) ||
+      std::memcmp(&state_individual, &state_batched, sizeof(BenchState))) {
+    XELOGE("The results of the individual and the batched writes differ");
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace gpu
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-gpu-register-write-bench",
+                      xe::gpu::register_write_bench_main, "");
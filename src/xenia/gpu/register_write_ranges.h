@@ -0,0 +1,139 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_REGISTER_WRITE_RANGES_H_
+#define XENIA_GPU_REGISTER_WRITE_RANGES_H_
+
+#include <algorithm>
+#include <cstdint>
+
+#include "xenia/base/byte_order.h"
+#include "xenia/base/memory.h"
+#include "xenia/base/platform.h"
+#include "xenia/gpu/register_file.h"
+#include "xenia/gpu/registers.h"
+
+namespace xe {
+namespace gpu {
+namespace register_write_ranges {
+
+// Guest register writes from PM4 packets mostly go to registers that only need
+// the new value stored, with the shader constants additionally requiring the
+// host constant buffers and the texture bindings to be invalidated. Runs of
+// writes within the same kind of range can be copied to the register file at
+// once with SIMD byte swapping, with the invalidation done for the whole run,
+// leaving only the few registers with side effects to be written one by one.
+
+enum class RangeType : uint32_t {
+  // The value only needs to be stored.
+  kPlain,
+  // May need CommandProcessor::HandleSpecialRegisterWrite.
+  kSpecial,
+  kFloatConstants,
+  kFetchConstants,
+  kBoolLoopConstants,
+};
+
+struct Range {
+  // Exclusive.
+  uint32_t end;
+  RangeType type;
+};
+
+// Sorted, covering all registers in the register file.
+constexpr Range kRanges[] = {
+    {XE_GPU_REG_SCRATCH_REG0, RangeType::kPlain},
+    {XE_GPU_REG_SCRATCH_REG7 + 1, RangeType::kSpecial},
+    {XE_GPU_REG_COHER_STATUS_HOST, RangeType::kPlain},
+    {XE_GPU_REG_COHER_STATUS_HOST + 1, RangeType::kSpecial},
+    {XE_GPU_REG_DC_LUT_RW_INDEX, RangeType::kPlain},
+    {XE_GPU_REG_DC_LUT_30_COLOR + 1, RangeType::kSpecial},
+    {XE_GPU_REG_SHADER_CONSTANT_000_X, RangeType::kPlain},
+    {XE_GPU_REG_SHADER_CONSTANT_511_W + 1, RangeType::kFloatConstants},
+    {XE_GPU_REG_SHADER_CONSTANT_FETCH_31_5 + 1, RangeType::kFetchConstants},
+    {XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031, RangeType::kPlain},
+    {XE_GPU_REG_SHADER_CONSTANT_LOOP_31 + 1, RangeType::kBoolLoopConstants},
+    {uint32_t(RegisterFile::kRegisterCount), RangeType::kPlain},
+};
+static_assert(XE_GPU_REG_SHADER_CONSTANT_511_W + 1 ==
+              XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0);
+
+// For a register within the register file.
+inline const Range& GetRange(uint32_t index) {
+  const Range* range = kRanges;
+  while (index >= range->end) {
+    ++range;
+  }
+  return *range;
+}
+
+// Stores big-endian register values, such as from the ring buffer, in the
+// register file. Indices beyond the register file are dropped. The handler
+// receives:
+// - void OnSpecialRegisterWritten(uint32_t index, uint32_t value) for every
+//   register in a kSpecial range, after it's stored.
+// - void OnFloatConstantsWritten(uint32_t first_index, uint32_t count),
+//   OnFetchConstantsWritten and OnBoolLoopConstantsWritten for runs of writes
+//   to the constants, after they're stored.
+template <typename Handler>
+XE_FORCEINLINE void WriteRange(uint32_t* register_values, uint32_t first_index,
+                               const uint32_t* source, uint32_t count,
+                               Handler& handler) {
+  if (first_index >= RegisterFile::kRegisterCount) {
+    return;
+  }
+  uint32_t end_index = uint32_t(std::min(
+      uint64_t(first_index) + count, uint64_t(RegisterFile::kRegisterCount)));
+  uint32_t index = first_index;
+  while (index < end_index) {
+    const Range& range = GetRange(index);
+    uint32_t run_count = std::min(range.end, end_index) - index;
+    if (range.type == RangeType::kSpecial) {
+      for (uint32_t i = 0; i < run_count; ++i) {
+        uint32_t value = xe::load_and_swap<uint32_t>(source + i);
+        register_values[index + i] = value;
+        handler.OnSpecialRegisterWritten(index + i, value);
+      }
+    } else {
+      xe::copy_and_swap_32_unaligned(register_values + index, source,
+                                     run_count);
+      switch (range.type) {
+        case RangeType::kFloatConstants:
+          handler.OnFloatConstantsWritten(index, run_count);
+          break;
+        case RangeType::kFetchConstants:
+          handler.OnFetchConstantsWritten(index, run_count);
+          break;
+        case RangeType::kBoolLoopConstants:
+          handler.OnBoolLoopConstantsWritten(index, run_count);
+          break;
+        default:
+          break;
+      }
+    }
+    index += run_count;
+    source += run_count;
+  }
+}
+
+// For invalidation of whole texture bindings or constant buffers.
+inline void GetFetchConstantRange(uint32_t first_index, uint32_t count,
+                                  uint32_t& first_fetch_constant_out,
+                                  uint32_t& last_fetch_constant_out) {
+  first_fetch_constant_out =
+      (first_index - XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) / 6;
+  last_fetch_constant_out =
+      (first_index + count - 1 - XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0) / 6;
+}
+
+}  // namespace register_write_ranges
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_REGISTER_WRITE_RANGES_H_
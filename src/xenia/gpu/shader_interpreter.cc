@@ -257,6 +257,11 @@ const std::array<float, 4> ShaderInterpreter::GetFloatConstant(
     index += relative_address_is_a0 ? state_.address_register
                                     : state_.GetLoopAddress();
   }
+  return GetFloatConstantAtIndex(index);
+}
+
+const std::array<float, 4> ShaderInterpreter::GetFloatConstantAtIndex(
+    int32_t index) const {
   if (index < 0) {
     return std::array<float, 4>();
   }
@@ -322,293 +327,8 @@ void ShaderInterpreter::ExecuteAluInstruction(ucode::AluInstruction instr) {
       }
     }
 
-    bool replicate_vector_result_x = false;
-    switch (vector_opcode) {
-      case ucode::AluVectorOpcode::kAdd: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] = vector_operands[0][i] + vector_operands[1][i];
-        }
-      } break;
-      case ucode::AluVectorOpcode::kMul: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          // Direct3D 9 behavior (0 or denormal * anything = +0).
-          vector_result[i] = (vector_operands[0][i] && vector_operands[1][i])
-                                 ? vector_operands[0][i] * vector_operands[1][i]
-                                 : 0.0f;
-        }
-      } break;
-      case ucode::AluVectorOpcode::kMax: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] =
-              std::isgreaterequal(vector_operands[0][i], vector_operands[1][i])
-                  ? vector_operands[0][i]
-                  : vector_operands[1][i];
-        }
-      } break;
-      case ucode::AluVectorOpcode::kMin: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] =
-              std::isless(vector_operands[0][i], vector_operands[1][i])
-                  ? vector_operands[0][i]
-                  : vector_operands[1][i];
-        }
-      } break;
-      case ucode::AluVectorOpcode::kSeq: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] =
-              float(vector_operands[0][i] == vector_operands[1][i]);
-        }
-      } break;
-      case ucode::AluVectorOpcode::kSgt: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] = float(
-              std::isgreater(vector_operands[0][i], vector_operands[1][i]));
-        }
-      } break;
-      case ucode::AluVectorOpcode::kSge: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] = float(std::isgreaterequal(vector_operands[0][i],
-                                                       vector_operands[1][i]));
-        }
-      } break;
-      case ucode::AluVectorOpcode::kSne: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] =
-              float(vector_operands[0][i] != vector_operands[1][i]);
-        }
-      } break;
-      case ucode::AluVectorOpcode::kFrc: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] =
-              vector_operands[0][i] - std::floor(vector_operands[0][i]);
-        }
-      } break;
-      case ucode::AluVectorOpcode::kTrunc: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] = std::trunc(vector_operands[0][i]);
-        }
-      } break;
-      case ucode::AluVectorOpcode::kFloor: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] = std::floor(vector_operands[0][i]);
-        }
-      } break;
-      case ucode::AluVectorOpcode::kMad: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          // Direct3D 9 behavior (0 or denormal * anything = +0).
-          // Doing the addition rather than conditional assignment even for zero
-          // operands because +0 + -0 must be +0.
-          vector_result[i] =
-              ((vector_operands[0][i] && vector_operands[1][i])
-                   ? vector_operands[0][i] * vector_operands[1][i]
-                   : 0.0f) +
-              vector_operands[2][i];
-        }
-      } break;
-      case ucode::AluVectorOpcode::kCndEq: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] = vector_operands[0][i] == 0.0f
-                                 ? vector_operands[1][i]
-                                 : vector_operands[2][i];
-        }
-      } break;
-      case ucode::AluVectorOpcode::kCndGe: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] = std::isgreaterequal(vector_operands[0][i], 0.0f)
-                                 ? vector_operands[1][i]
-                                 : vector_operands[2][i];
-        }
-      } break;
-      case ucode::AluVectorOpcode::kCndGt: {
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] = std::isgreater(vector_operands[0][i], 0.0f)
-                                 ? vector_operands[1][i]
-                                 : vector_operands[2][i];
-        }
-      } break;
-      case ucode::AluVectorOpcode::kDp4: {
-        vector_result[0] = 0.0f;
-        for (uint32_t i = 0; i < 4; ++i) {
-          // Direct3D 9 behavior (0 or denormal * anything = +0).
-          // Doing the addition even for zero operands because +0 + -0 must be
-          // +0.
-          vector_result[0] +=
-              (vector_operands[0][i] && vector_operands[1][i])
-                  ? vector_operands[0][i] * vector_operands[1][i]
-                  : 0.0f;
-        }
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kDp3: {
-        vector_result[0] = 0.0f;
-        for (uint32_t i = 0; i < 3; ++i) {
-          // Direct3D 9 behavior (0 or denormal * anything = +0).
-          // Doing the addition even for zero operands because +0 + -0 must be
-          // +0.
-          vector_result[0] +=
-              (vector_operands[0][i] && vector_operands[1][i])
-                  ? vector_operands[0][i] * vector_operands[1][i]
-                  : 0.0f;
-        }
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kDp2Add: {
-        // Doing the addition even for zero operands because +0 + -0 must be +0.
-        vector_result[0] = 0.0f;
-        for (uint32_t i = 0; i < 2; ++i) {
-          // Direct3D 9 behavior (0 or denormal * anything = +0).
-          vector_result[0] +=
-              (vector_operands[0][i] && vector_operands[1][i])
-                  ? vector_operands[0][i] * vector_operands[1][i]
-                  : 0.0f;
-        }
-        vector_result[0] += vector_operands[2][0];
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kCube: {
-        // Operand [0] is .z_xy.
-        float x = vector_operands[0][2];
-        float y = vector_operands[0][3];
-        float z = vector_operands[0][0];
-        float x_abs = std::abs(x), y_abs = std::abs(y), z_abs = std::abs(z);
-        // Result is T coordinate, S coordinate, 2 * major axis, face ID.
-        if (z_abs >= x_abs && z_abs >= y_abs) {
-          bool z_negative = std::isless(z, 0.0f);
-          vector_result[0] = -y;
-          vector_result[1] = z_negative ? -x : x;
-          vector_result[2] = z;
-          vector_result[3] = z_negative ? 5.0f : 4.0f;
-        } else if (y_abs >= x_abs) {
-          bool y_negative = std::isless(y, 0.0f);
-          vector_result[0] = y_negative ? -z : z;
-          vector_result[1] = x;
-          vector_result[2] = y;
-          vector_result[3] = y_negative ? 3.0f : 2.0f;
-        } else {
-          bool x_negative = std::isless(x, 0.0f);
-          vector_result[0] = -y;
-          vector_result[1] = x_negative ? z : -z;
-          vector_result[2] = x;
-          vector_result[3] = x_negative ? 1.0f : 0.0f;
-        }
-        vector_result[2] *= 2.0f;
-      } break;
-      case ucode::AluVectorOpcode::kMax4: {
-        if (std::isgreaterequal(vector_operands[0][0], vector_operands[0][1]) &&
-            std::isgreaterequal(vector_operands[0][0], vector_operands[0][2]) &&
-            std::isgreaterequal(vector_operands[0][0], vector_operands[0][3])) {
-          vector_result[0] = vector_operands[0][0];
-        } else if (std::isgreaterequal(vector_operands[0][1],
-                                       vector_operands[0][2]) &&
-                   std::isgreaterequal(vector_operands[0][1],
-                                       vector_operands[0][3])) {
-          vector_result[0] = vector_operands[0][1];
-        } else if (std::isgreaterequal(vector_operands[0][2],
-                                       vector_operands[0][3])) {
-          vector_result[0] = vector_operands[0][2];
-        } else {
-          vector_result[0] = vector_operands[0][3];
-        }
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kSetpEqPush: {
-        state_.predicate =
-            vector_operands[0][3] == 0.0f && vector_operands[1][3] == 0.0f;
-        vector_result[0] =
-            (vector_operands[0][0] == 0.0f && vector_operands[1][0] == 0.0f)
-                ? 0.0f
-                : vector_operands[0][0] + 1.0f;
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kSetpNePush: {
-        state_.predicate =
-            vector_operands[0][3] == 0.0f && vector_operands[1][3] != 0.0f;
-        vector_result[0] =
-            (vector_operands[0][0] == 0.0f && vector_operands[1][0] != 0.0f)
-                ? 0.0f
-                : vector_operands[0][0] + 1.0f;
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kSetpGtPush: {
-        state_.predicate = vector_operands[0][3] == 0.0f &&
-                           std::isgreater(vector_operands[1][3], 0.0f);
-        vector_result[0] = (vector_operands[0][0] == 0.0f &&
-                            std::isgreater(vector_operands[1][0], 0.0f))
-                               ? 0.0f
-                               : vector_operands[0][0] + 1.0f;
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kSetpGePush: {
-        state_.predicate = vector_operands[0][3] == 0.0f &&
-                           std::isgreaterequal(vector_operands[1][3], 0.0f);
-        vector_result[0] = (vector_operands[0][0] == 0.0f &&
-                            std::isgreaterequal(vector_operands[1][0], 0.0f))
-                               ? 0.0f
-                               : vector_operands[0][0] + 1.0f;
-        replicate_vector_result_x = true;
-      } break;
-      // Not implementing pixel kill currently, the interpreter is currently
-      // used only for vertex shaders.
-      case ucode::AluVectorOpcode::kKillEq: {
-        vector_result[0] =
-            float(vector_operands[0][0] == vector_operands[1][0] ||
-                  vector_operands[0][1] == vector_operands[1][1] ||
-                  vector_operands[0][2] == vector_operands[1][2] ||
-                  vector_operands[0][3] == vector_operands[1][3]);
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kKillGt: {
-        vector_result[0] = float(
-            std::isgreater(vector_operands[0][0], vector_operands[1][0]) ||
-            std::isgreater(vector_operands[0][1], vector_operands[1][1]) ||
-            std::isgreater(vector_operands[0][2], vector_operands[1][2]) ||
-            std::isgreater(vector_operands[0][3], vector_operands[1][3]));
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kKillGe: {
-        vector_result[0] = float(
-            std::isgreaterequal(vector_operands[0][0], vector_operands[1][0]) ||
-            std::isgreaterequal(vector_operands[0][1], vector_operands[1][1]) ||
-            std::isgreaterequal(vector_operands[0][2], vector_operands[1][2]) ||
-            std::isgreaterequal(vector_operands[0][3], vector_operands[1][3]));
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kKillNe: {
-        vector_result[0] =
-            float(vector_operands[0][0] != vector_operands[1][0] ||
-                  vector_operands[0][1] != vector_operands[1][1] ||
-                  vector_operands[0][2] != vector_operands[1][2] ||
-                  vector_operands[0][3] != vector_operands[1][3]);
-        replicate_vector_result_x = true;
-      } break;
-      case ucode::AluVectorOpcode::kDst: {
-        vector_result[0] = 1.0f;
-        // Direct3D 9 behavior (0 or denormal * anything = +0).
-        vector_result[1] = (vector_operands[0][1] && vector_operands[1][1])
-                               ? vector_operands[0][1] * vector_operands[1][1]
-                               : 0.0f;
-        vector_result[2] = vector_operands[0][2];
-        vector_result[3] = vector_operands[1][3];
-      } break;
-      case ucode::AluVectorOpcode::kMaxA: {
-        state_.address_register = int32_t(std::floor(
-            xe::clamp_float(vector_operands[0][3], -256.0f, 255.0f) + 0.5f));
-        for (uint32_t i = 0; i < 4; ++i) {
-          vector_result[i] =
-              std::isgreaterequal(vector_operands[0][i], vector_operands[1][i])
-                  ? vector_operands[0][i]
-                  : vector_operands[1][i];
-        }
-      } break;
-      default: {
-        assert_unhandled_case(vector_opcode);
-      }
-    }
-    if (replicate_vector_result_x) {
-      for (uint32_t i = 1; i < 4; ++i) {
-        vector_result[i] = vector_result[0];
-      }
-    }
+    ExecuteAluVectorOperation(vector_opcode, vector_operands, vector_result,
+                              state_.predicate, state_.address_register);
   }
 
   // Scalar operation.
@@ -676,140 +396,497 @@ void ShaderInterpreter::ExecuteAluInstruction(ucode::AluInstruction instr) {
       scalar_operands[i] = scalar_operand;
     }
   }
+  ExecuteAluScalarOperation(scalar_opcode, scalar_operands,
+                            state_.previous_scalar, state_.predicate,
+                            state_.address_register);
+
+  if (instr.vector_clamp()) {
+    for (uint32_t i = 0; i < 4; ++i) {
+      vector_result[i] = xe::saturate(vector_result[i]);
+    }
+  }
+  float scalar_result = instr.scalar_clamp()
+                            ? xe::saturate(state_.previous_scalar)
+                            : state_.previous_scalar;
+
+  uint32_t scalar_result_write_mask = instr.GetScalarOpResultWriteMask();
+  if (instr.is_export()) {
+    if (export_sink_) {
+      float export_value[4];
+      uint32_t export_constant_1_mask = instr.GetConstant1WriteMask();
+      uint32_t export_mask =
+          vector_result_write_mask | scalar_result_write_mask |
+          instr.GetConstant0WriteMask() | export_constant_1_mask;
+      for (uint32_t i = 0; i < 4; ++i) {
+        uint32_t export_component_bit = UINT32_C(1) << i;
+        float export_component = 0.0f;
+        if (vector_result_write_mask & export_component_bit) {
+          export_component = vector_result[i];
+        } else if (scalar_result_write_mask & export_component_bit) {
+          export_component = scalar_result;
+        } else if (export_constant_1_mask & export_component_bit) {
+          export_component = 1.0f;
+        } else {
+          export_component = 0.0f;
+        }
+        export_value[i] = export_component;
+      }
+      export_sink_->Export(
+          ucode::ExportRegister(instr.vector_dest()), export_value,
+          vector_result_write_mask | scalar_result_write_mask |
+              instr.GetConstant0WriteMask() | export_constant_1_mask);
+    }
+  } else {
+    if (vector_result_write_mask) {
+      float* vector_dest =
+          GetTempRegister(instr.vector_dest(), instr.is_vector_dest_relative());
+      for (uint32_t i = 0; i < 4; ++i) {
+        if (vector_result_write_mask & (UINT32_C(1) << i)) {
+          vector_dest[i] = vector_result[i];
+        }
+      }
+    }
+    if (scalar_result_write_mask) {
+      float* scalar_dest =
+          GetTempRegister(instr.scalar_dest(), instr.is_scalar_dest_relative());
+      for (uint32_t i = 0; i < 4; ++i) {
+        if (scalar_result_write_mask & (UINT32_C(1) << i)) {
+          scalar_dest[i] = scalar_result;
+        }
+      }
+    }
+  }
+}
+
+void ShaderInterpreter::ExecuteAluVectorOperation(
+    ucode::AluVectorOpcode vector_opcode, const float (*vector_operands)[4],
+    float* vector_result, bool& predicate, int32_t& address_register) {
+  bool replicate_vector_result_x = false;
+  switch (vector_opcode) {
+    case ucode::AluVectorOpcode::kAdd: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] = vector_operands[0][i] + vector_operands[1][i];
+      }
+    } break;
+    case ucode::AluVectorOpcode::kMul: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        // Direct3D 9 behavior (0 or denormal * anything = +0).
+        vector_result[i] = (vector_operands[0][i] && vector_operands[1][i])
+                               ? vector_operands[0][i] * vector_operands[1][i]
+                               : 0.0f;
+      }
+    } break;
+    case ucode::AluVectorOpcode::kMax: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] =
+            std::isgreaterequal(vector_operands[0][i], vector_operands[1][i])
+                ? vector_operands[0][i]
+                : vector_operands[1][i];
+      }
+    } break;
+    case ucode::AluVectorOpcode::kMin: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] =
+            std::isless(vector_operands[0][i], vector_operands[1][i])
+                ? vector_operands[0][i]
+                : vector_operands[1][i];
+      }
+    } break;
+    case ucode::AluVectorOpcode::kSeq: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] =
+            float(vector_operands[0][i] == vector_operands[1][i]);
+      }
+    } break;
+    case ucode::AluVectorOpcode::kSgt: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] = float(
+            std::isgreater(vector_operands[0][i], vector_operands[1][i]));
+      }
+    } break;
+    case ucode::AluVectorOpcode::kSge: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] = float(std::isgreaterequal(vector_operands[0][i],
+                                                     vector_operands[1][i]));
+      }
+    } break;
+    case ucode::AluVectorOpcode::kSne: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] =
+            float(vector_operands[0][i] != vector_operands[1][i]);
+      }
+    } break;
+    case ucode::AluVectorOpcode::kFrc: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] =
+            vector_operands[0][i] - std::floor(vector_operands[0][i]);
+      }
+    } break;
+    case ucode::AluVectorOpcode::kTrunc: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] = std::trunc(vector_operands[0][i]);
+      }
+    } break;
+    case ucode::AluVectorOpcode::kFloor: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] = std::floor(vector_operands[0][i]);
+      }
+    } break;
+    case ucode::AluVectorOpcode::kMad: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        // Direct3D 9 behavior (0 or denormal * anything = +0).
+        // Doing the addition rather than conditional assignment even for zero
+        // operands because +0 + -0 must be +0.
+        vector_result[i] =
+            ((vector_operands[0][i] && vector_operands[1][i])
+                 ? vector_operands[0][i] * vector_operands[1][i]
+                 : 0.0f) +
+            vector_operands[2][i];
+      }
+    } break;
+    case ucode::AluVectorOpcode::kCndEq: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] = vector_operands[0][i] == 0.0f
+                               ? vector_operands[1][i]
+                               : vector_operands[2][i];
+      }
+    } break;
+    case ucode::AluVectorOpcode::kCndGe: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] = std::isgreaterequal(vector_operands[0][i], 0.0f)
+                               ? vector_operands[1][i]
+                               : vector_operands[2][i];
+      }
+    } break;
+    case ucode::AluVectorOpcode::kCndGt: {
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] = std::isgreater(vector_operands[0][i], 0.0f)
+                               ? vector_operands[1][i]
+                               : vector_operands[2][i];
+      }
+    } break;
+    case ucode::AluVectorOpcode::kDp4: {
+      vector_result[0] = 0.0f;
+      for (uint32_t i = 0; i < 4; ++i) {
+        // Direct3D 9 behavior (0 or denormal * anything = +0).
+        // Doing the addition even for zero operands because +0 + -0 must be
+        // +0.
+        vector_result[0] +=
+            (vector_operands[0][i] && vector_operands[1][i])
+                ? vector_operands[0][i] * vector_operands[1][i]
+                : 0.0f;
+      }
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kDp3: {
+      vector_result[0] = 0.0f;
+      for (uint32_t i = 0; i < 3; ++i) {
+        // Direct3D 9 behavior (0 or denormal * anything = +0).
+        // Doing the addition even for zero operands because +0 + -0 must be
+        // +0.
+        vector_result[0] +=
+            (vector_operands[0][i] && vector_operands[1][i])
+                ? vector_operands[0][i] * vector_operands[1][i]
+                : 0.0f;
+      }
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kDp2Add: {
+      // Doing the addition even for zero operands because +0 + -0 must be +0.
+      vector_result[0] = 0.0f;
+      for (uint32_t i = 0; i < 2; ++i) {
+        // Direct3D 9 behavior (0 or denormal * anything = +0).
+        vector_result[0] +=
+            (vector_operands[0][i] && vector_operands[1][i])
+                ? vector_operands[0][i] * vector_operands[1][i]
+                : 0.0f;
+      }
+      vector_result[0] += vector_operands[2][0];
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kCube: {
+      // Operand [0] is .z_xy.
+      float x = vector_operands[0][2];
+      float y = vector_operands[0][3];
+      float z = vector_operands[0][0];
+      float x_abs = std::abs(x), y_abs = std::abs(y), z_abs = std::abs(z);
+      // Result is T coordinate, S coordinate, 2 * major axis, face ID.
+      if (z_abs >= x_abs && z_abs >= y_abs) {
+        bool z_negative = std::isless(z, 0.0f);
+        vector_result[0] = -y;
+        vector_result[1] = z_negative ? -x : x;
+        vector_result[2] = z;
+        vector_result[3] = z_negative ? 5.0f : 4.0f;
+      } else if (y_abs >= x_abs) {
+        bool y_negative = std::isless(y, 0.0f);
+        vector_result[0] = y_negative ? -z : z;
+        vector_result[1] = x;
+        vector_result[2] = y;
+        vector_result[3] = y_negative ? 3.0f : 2.0f;
+      } else {
+        bool x_negative = std::isless(x, 0.0f);
+        vector_result[0] = -y;
+        vector_result[1] = x_negative ? z : -z;
+        vector_result[2] = x;
+        vector_result[3] = x_negative ? 1.0f : 0.0f;
+      }
+      vector_result[2] *= 2.0f;
+    } break;
+    case ucode::AluVectorOpcode::kMax4: {
+      if (std::isgreaterequal(vector_operands[0][0], vector_operands[0][1]) &&
+          std::isgreaterequal(vector_operands[0][0], vector_operands[0][2]) &&
+          std::isgreaterequal(vector_operands[0][0], vector_operands[0][3])) {
+        vector_result[0] = vector_operands[0][0];
+      } else if (std::isgreaterequal(vector_operands[0][1],
+                                     vector_operands[0][2]) &&
+                 std::isgreaterequal(vector_operands[0][1],
+                                     vector_operands[0][3])) {
+        vector_result[0] = vector_operands[0][1];
+      } else if (std::isgreaterequal(vector_operands[0][2],
+                                     vector_operands[0][3])) {
+        vector_result[0] = vector_operands[0][2];
+      } else {
+        vector_result[0] = vector_operands[0][3];
+      }
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kSetpEqPush: {
+      predicate =
+          vector_operands[0][3] == 0.0f && vector_operands[1][3] == 0.0f;
+      vector_result[0] =
+          (vector_operands[0][0] == 0.0f && vector_operands[1][0] == 0.0f)
+              ? 0.0f
+              : vector_operands[0][0] + 1.0f;
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kSetpNePush: {
+      predicate =
+          vector_operands[0][3] == 0.0f && vector_operands[1][3] != 0.0f;
+      vector_result[0] =
+          (vector_operands[0][0] == 0.0f && vector_operands[1][0] != 0.0f)
+              ? 0.0f
+              : vector_operands[0][0] + 1.0f;
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kSetpGtPush: {
+      predicate = vector_operands[0][3] == 0.0f &&
+                         std::isgreater(vector_operands[1][3], 0.0f);
+      vector_result[0] = (vector_operands[0][0] == 0.0f &&
+                          std::isgreater(vector_operands[1][0], 0.0f))
+                             ? 0.0f
+                             : vector_operands[0][0] + 1.0f;
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kSetpGePush: {
+      predicate = vector_operands[0][3] == 0.0f &&
+                         std::isgreaterequal(vector_operands[1][3], 0.0f);
+      vector_result[0] = (vector_operands[0][0] == 0.0f &&
+                          std::isgreaterequal(vector_operands[1][0], 0.0f))
+                             ? 0.0f
+                             : vector_operands[0][0] + 1.0f;
+      replicate_vector_result_x = true;
+    } break;
+    // Not implementing pixel kill currently, the interpreter is currently
+    // used only for vertex shaders.
+    case ucode::AluVectorOpcode::kKillEq: {
+      vector_result[0] =
+          float(vector_operands[0][0] == vector_operands[1][0] ||
+                vector_operands[0][1] == vector_operands[1][1] ||
+                vector_operands[0][2] == vector_operands[1][2] ||
+                vector_operands[0][3] == vector_operands[1][3]);
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kKillGt: {
+      vector_result[0] = float(
+          std::isgreater(vector_operands[0][0], vector_operands[1][0]) ||
+          std::isgreater(vector_operands[0][1], vector_operands[1][1]) ||
+          std::isgreater(vector_operands[0][2], vector_operands[1][2]) ||
+          std::isgreater(vector_operands[0][3], vector_operands[1][3]));
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kKillGe: {
+      vector_result[0] = float(
+          std::isgreaterequal(vector_operands[0][0], vector_operands[1][0]) ||
+          std::isgreaterequal(vector_operands[0][1], vector_operands[1][1]) ||
+          std::isgreaterequal(vector_operands[0][2], vector_operands[1][2]) ||
+          std::isgreaterequal(vector_operands[0][3], vector_operands[1][3]));
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kKillNe: {
+      vector_result[0] =
+          float(vector_operands[0][0] != vector_operands[1][0] ||
+                vector_operands[0][1] != vector_operands[1][1] ||
+                vector_operands[0][2] != vector_operands[1][2] ||
+                vector_operands[0][3] != vector_operands[1][3]);
+      replicate_vector_result_x = true;
+    } break;
+    case ucode::AluVectorOpcode::kDst: {
+      vector_result[0] = 1.0f;
+      // Direct3D 9 behavior (0 or denormal * anything = +0).
+      vector_result[1] = (vector_operands[0][1] && vector_operands[1][1])
+                             ? vector_operands[0][1] * vector_operands[1][1]
+                             : 0.0f;
+      vector_result[2] = vector_operands[0][2];
+      vector_result[3] = vector_operands[1][3];
+    } break;
+    case ucode::AluVectorOpcode::kMaxA: {
+      address_register = int32_t(std::floor(
+          xe::clamp_float(vector_operands[0][3], -256.0f, 255.0f) + 0.5f));
+      for (uint32_t i = 0; i < 4; ++i) {
+        vector_result[i] =
+            std::isgreaterequal(vector_operands[0][i], vector_operands[1][i])
+                ? vector_operands[0][i]
+                : vector_operands[1][i];
+      }
+    } break;
+    default: {
+      assert_unhandled_case(vector_opcode);
+    }
+  }
+  if (replicate_vector_result_x) {
+    for (uint32_t i = 1; i < 4; ++i) {
+      vector_result[i] = vector_result[0];
+    }
+  }
+}
+
+void ShaderInterpreter::ExecuteAluScalarOperation(
+    ucode::AluScalarOpcode scalar_opcode, const float* scalar_operands,
+    float& previous_scalar, bool& predicate, int32_t& address_register) {
   switch (scalar_opcode) {
     case ucode::AluScalarOpcode::kAdds:
     case ucode::AluScalarOpcode::kAddsc0:
     case ucode::AluScalarOpcode::kAddsc1: {
-      state_.previous_scalar = scalar_operands[0] + scalar_operands[1];
+      previous_scalar = scalar_operands[0] + scalar_operands[1];
     } break;
     case ucode::AluScalarOpcode::kAddsPrev: {
-      state_.previous_scalar = scalar_operands[0] + state_.previous_scalar;
+      previous_scalar = scalar_operands[0] + previous_scalar;
     } break;
     case ucode::AluScalarOpcode::kMuls:
     case ucode::AluScalarOpcode::kMulsc0:
     case ucode::AluScalarOpcode::kMulsc1: {
       // Direct3D 9 behavior (0 or denormal * anything = +0).
-      state_.previous_scalar = (scalar_operands[0] && scalar_operands[1])
+      previous_scalar = (scalar_operands[0] && scalar_operands[1])
                                    ? scalar_operands[0] * scalar_operands[1]
                                    : 0.0f;
     } break;
     case ucode::AluScalarOpcode::kMulsPrev: {
       // Direct3D 9 behavior (0 or denormal * anything = +0).
-      state_.previous_scalar = (scalar_operands[0] && state_.previous_scalar)
-                                   ? scalar_operands[0] * state_.previous_scalar
+      previous_scalar = (scalar_operands[0] && previous_scalar)
+                                   ? scalar_operands[0] * previous_scalar
                                    : 0.0f;
     } break;
     case ucode::AluScalarOpcode::kMulsPrev2: {
-      if (state_.previous_scalar == -FLT_MAX ||
-          !std::isfinite(state_.previous_scalar) ||
+      if (previous_scalar == -FLT_MAX ||
+          !std::isfinite(previous_scalar) ||
           !std::isfinite(scalar_operands[1]) ||
           std::islessequal(scalar_operands[1], 0.0f)) {
-        state_.previous_scalar = -FLT_MAX;
+        previous_scalar = -FLT_MAX;
       } else {
         // Direct3D 9 behavior (0 or denormal * anything = +0).
-        state_.previous_scalar =
-            (scalar_operands[0] && state_.previous_scalar)
-                ? scalar_operands[0] * state_.previous_scalar
+        previous_scalar =
+            (scalar_operands[0] && previous_scalar)
+                ? scalar_operands[0] * previous_scalar
                 : 0.0f;
       }
     } break;
     case ucode::AluScalarOpcode::kMaxs: {
-      state_.previous_scalar =
+      previous_scalar =
           std::isgreaterequal(scalar_operands[0], scalar_operands[1])
               ? scalar_operands[0]
               : scalar_operands[1];
     } break;
     case ucode::AluScalarOpcode::kMins: {
-      state_.previous_scalar =
+      previous_scalar =
           std::isless(scalar_operands[0], scalar_operands[1])
               ? scalar_operands[0]
               : scalar_operands[1];
     } break;
     case ucode::AluScalarOpcode::kSeqs: {
-      state_.previous_scalar = float(scalar_operands[0] == 0.0f);
+      previous_scalar = float(scalar_operands[0] == 0.0f);
     } break;
     case ucode::AluScalarOpcode::kSgts: {
-      state_.previous_scalar = float(std::isgreater(scalar_operands[0], 0.0f));
+      previous_scalar = float(std::isgreater(scalar_operands[0], 0.0f));
     } break;
     case ucode::AluScalarOpcode::kSges: {
-      state_.previous_scalar =
+      previous_scalar =
           float(std::isgreaterequal(scalar_operands[0], 0.0f));
     } break;
     case ucode::AluScalarOpcode::kSnes: {
-      state_.previous_scalar = float(scalar_operands[0] != 0.0f);
+      previous_scalar = float(scalar_operands[0] != 0.0f);
     } break;
     case ucode::AluScalarOpcode::kFrcs: {
-      state_.previous_scalar =
+      previous_scalar =
           scalar_operands[0] - std::floor(scalar_operands[0]);
     } break;
     case ucode::AluScalarOpcode::kTruncs: {
-      state_.previous_scalar = std::trunc(scalar_operands[0]);
+      previous_scalar = std::trunc(scalar_operands[0]);
     } break;
     case ucode::AluScalarOpcode::kFloors: {
-      state_.previous_scalar = std::floor(scalar_operands[0]);
+      previous_scalar = std::floor(scalar_operands[0]);
     } break;
     case ucode::AluScalarOpcode::kExp: {
-      state_.previous_scalar = std::exp2(scalar_operands[0]);
+      previous_scalar = std::exp2(scalar_operands[0]);
     } break;
     case ucode::AluScalarOpcode::kLogc: {
-      state_.previous_scalar = std::log2(scalar_operands[0]);
-      if (state_.previous_scalar == -INFINITY) {
-        state_.previous_scalar = -FLT_MAX;
+      previous_scalar = std::log2(scalar_operands[0]);
+      if (previous_scalar == -INFINITY) {
+        previous_scalar = -FLT_MAX;
       }
     } break;
     case ucode::AluScalarOpcode::kLog: {
-      state_.previous_scalar = std::log2(scalar_operands[0]);
+      previous_scalar = std::log2(scalar_operands[0]);
     } break;
     case ucode::AluScalarOpcode::kRcpc: {
-      state_.previous_scalar = 1.0f / scalar_operands[0];
-      if (state_.previous_scalar == -INFINITY) {
-        state_.previous_scalar = -FLT_MAX;
-      } else if (state_.previous_scalar == INFINITY) {
-        state_.previous_scalar = FLT_MAX;
+      previous_scalar = 1.0f / scalar_operands[0];
+      if (previous_scalar == -INFINITY) {
+        previous_scalar = -FLT_MAX;
+      } else if (previous_scalar == INFINITY) {
+        previous_scalar = FLT_MAX;
       }
     } break;
     case ucode::AluScalarOpcode::kRcpf: {
-      state_.previous_scalar = 1.0f / scalar_operands[0];
-      if (state_.previous_scalar == -INFINITY) {
-        state_.previous_scalar = -0.0f;
-      } else if (state_.previous_scalar == INFINITY) {
-        state_.previous_scalar = 0.0f;
+      previous_scalar = 1.0f / scalar_operands[0];
+      if (previous_scalar == -INFINITY) {
+        previous_scalar = -0.0f;
+      } else if (previous_scalar == INFINITY) {
+        previous_scalar = 0.0f;
       }
     } break;
     case ucode::AluScalarOpcode::kRcp: {
-      state_.previous_scalar = 1.0f / scalar_operands[0];
+      previous_scalar = 1.0f / scalar_operands[0];
     } break;
     case ucode::AluScalarOpcode::kRsqc: {
-      state_.previous_scalar = 1.0f / std::sqrt(scalar_operands[0]);
-      if (state_.previous_scalar == -INFINITY) {
-        state_.previous_scalar = -FLT_MAX;
-      } else if (state_.previous_scalar == INFINITY) {
-        state_.previous_scalar = FLT_MAX;
+      previous_scalar = 1.0f / std::sqrt(scalar_operands[0]);
+      if (previous_scalar == -INFINITY) {
+        previous_scalar = -FLT_MAX;
+      } else if (previous_scalar == INFINITY) {
+        previous_scalar = FLT_MAX;
       }
     } break;
     case ucode::AluScalarOpcode::kRsqf: {
-      state_.previous_scalar = 1.0f / std::sqrt(scalar_operands[0]);
-      if (state_.previous_scalar == -INFINITY) {
-        state_.previous_scalar = -0.0f;
-      } else if (state_.previous_scalar == INFINITY) {
-        state_.previous_scalar = 0.0f;
+      previous_scalar = 1.0f / std::sqrt(scalar_operands[0]);
+      if (previous_scalar == -INFINITY) {
+        previous_scalar = -0.0f;
+      } else if (previous_scalar == INFINITY) {
+        previous_scalar = 0.0f;
       }
     } break;
     case ucode::AluScalarOpcode::kRsq: {
-      state_.previous_scalar = 1.0f / std::sqrt(scalar_operands[0]);
+      previous_scalar = 1.0f / std::sqrt(scalar_operands[0]);
     } break;
     case ucode::AluScalarOpcode::kMaxAs: {
-      state_.address_register = int32_t(std::floor(
+      address_register = int32_t(std::floor(
           xe::clamp_float(scalar_operands[0], -256.0f, 255.0f) + 0.5f));
-      state_.previous_scalar =
+      previous_scalar =
           std::isgreaterequal(scalar_operands[0], scalar_operands[1])
               ? scalar_operands[0]
               : scalar_operands[1];
     } break;
     case ucode::AluScalarOpcode::kMaxAsf: {
-      state_.address_register = int32_t(
+      address_register = int32_t(
           std::floor(xe::clamp_float(scalar_operands[0], -256.0f, 255.0f)));
-      state_.previous_scalar =
+      previous_scalar =
           std::isgreaterequal(scalar_operands[0], scalar_operands[1])
               ? scalar_operands[0]
               : scalar_operands[1];
@@ -817,73 +894,73 @@ void ShaderInterpreter::ExecuteAluInstruction(ucode::AluInstruction instr) {
     case ucode::AluScalarOpcode::kSubs:
     case ucode::AluScalarOpcode::kSubsc0:
     case ucode::AluScalarOpcode::kSubsc1: {
-      state_.previous_scalar = scalar_operands[0] - scalar_operands[1];
+      previous_scalar = scalar_operands[0] - scalar_operands[1];
     } break;
     case ucode::AluScalarOpcode::kSubsPrev: {
-      state_.previous_scalar = scalar_operands[0] - state_.previous_scalar;
+      previous_scalar = scalar_operands[0] - previous_scalar;
     } break;
     case ucode::AluScalarOpcode::kSetpEq: {
-      state_.predicate = scalar_operands[0] == 0.0f;
-      state_.previous_scalar = float(!state_.predicate);
+      predicate = scalar_operands[0] == 0.0f;
+      previous_scalar = float(!predicate);
     } break;
     case ucode::AluScalarOpcode::kSetpNe: {
-      state_.predicate = scalar_operands[0] != 0.0f;
-      state_.previous_scalar = float(!state_.predicate);
+      predicate = scalar_operands[0] != 0.0f;
+      previous_scalar = float(!predicate);
     } break;
     case ucode::AluScalarOpcode::kSetpGt: {
-      state_.predicate = std::isgreater(scalar_operands[0], 0.0f);
-      state_.previous_scalar = float(!state_.predicate);
+      predicate = std::isgreater(scalar_operands[0], 0.0f);
+      previous_scalar = float(!predicate);
     } break;
     case ucode::AluScalarOpcode::kSetpGe: {
-      state_.predicate = std::isgreaterequal(scalar_operands[0], 0.0f);
-      state_.previous_scalar = float(!state_.predicate);
+      predicate = std::isgreaterequal(scalar_operands[0], 0.0f);
+      previous_scalar = float(!predicate);
     } break;
     case ucode::AluScalarOpcode::kSetpInv: {
-      state_.predicate = scalar_operands[0] == 1.0f;
-      state_.previous_scalar =
-          state_.predicate
+      predicate = scalar_operands[0] == 1.0f;
+      previous_scalar =
+          predicate
               ? 0.0f
               : (scalar_operands[0] == 0.0f ? 1.0f : scalar_operands[0]);
     } break;
     case ucode::AluScalarOpcode::kSetpPop: {
       float new_counter = scalar_operands[0] - 1.0f;
-      state_.predicate = std::islessequal(new_counter, 0.0f);
-      state_.previous_scalar = state_.predicate ? 0.0f : new_counter;
+      predicate = std::islessequal(new_counter, 0.0f);
+      previous_scalar = predicate ? 0.0f : new_counter;
     } break;
     case ucode::AluScalarOpcode::kSetpClr: {
-      state_.predicate = false;
-      state_.previous_scalar = FLT_MAX;
+      predicate = false;
+      previous_scalar = FLT_MAX;
     } break;
     case ucode::AluScalarOpcode::kSetpRstr: {
-      state_.predicate = scalar_operands[0] == 0.0f;
-      state_.previous_scalar = state_.predicate ? 0.0f : scalar_operands[0];
+      predicate = scalar_operands[0] == 0.0f;
+      previous_scalar = predicate ? 0.0f : scalar_operands[0];
     } break;
     // Not implementing pixel kill currently, the interpreter is currently used
     // only for vertex shaders.
     case ucode::AluScalarOpcode::kKillsEq: {
-      state_.previous_scalar = float(scalar_operands[0] == 0.0f);
+      previous_scalar = float(scalar_operands[0] == 0.0f);
     } break;
     case ucode::AluScalarOpcode::kKillsGt: {
-      state_.previous_scalar = float(std::isgreater(scalar_operands[0], 0.0f));
+      previous_scalar = float(std::isgreater(scalar_operands[0], 0.0f));
     } break;
     case ucode::AluScalarOpcode::kKillsGe: {
-      state_.previous_scalar =
+      previous_scalar =
           float(std::isgreaterequal(scalar_operands[0], 0.0f));
     } break;
     case ucode::AluScalarOpcode::kKillsNe: {
-      state_.previous_scalar = float(scalar_operands[0] != 0.0f);
+      previous_scalar = float(scalar_operands[0] != 0.0f);
     } break;
     case ucode::AluScalarOpcode::kKillsOne: {
-      state_.previous_scalar = float(scalar_operands[0] == 1.0f);
+      previous_scalar = float(scalar_operands[0] == 1.0f);
     } break;
     case ucode::AluScalarOpcode::kSqrt: {
-      state_.previous_scalar = std::sqrt(scalar_operands[0]);
+      previous_scalar = std::sqrt(scalar_operands[0]);
     } break;
     case ucode::AluScalarOpcode::kSin: {
-      state_.previous_scalar = std::sin(scalar_operands[0]);
+      previous_scalar = std::sin(scalar_operands[0]);
     } break;
     case ucode::AluScalarOpcode::kCos: {
-      state_.previous_scalar = std::cos(scalar_operands[0]);
+      previous_scalar = std::cos(scalar_operands[0]);
     } break;
     case ucode::AluScalarOpcode::kRetainPrev: {
     } break;
@@ -891,63 +968,6 @@ void ShaderInterpreter::ExecuteAluInstruction(ucode::AluInstruction instr) {
       assert_unhandled_case(scalar_opcode);
     }
   }
-
-  if (instr.vector_clamp()) {
-    for (uint32_t i = 0; i < 4; ++i) {
-      vector_result[i] = xe::saturate(vector_result[i]);
-    }
-  }
-  float scalar_result = instr.scalar_clamp()
-                            ? xe::saturate(state_.previous_scalar)
-                            : state_.previous_scalar;
-
-  uint32_t scalar_result_write_mask = instr.GetScalarOpResultWriteMask();
-  if (instr.is_export()) {
-    if (export_sink_) {
-      float export_value[4];
-      uint32_t export_constant_1_mask = instr.GetConstant1WriteMask();
-      uint32_t export_mask =
-          vector_result_write_mask | scalar_result_write_mask |
-          instr.GetConstant0WriteMask() | export_constant_1_mask;
-      for (uint32_t i = 0; i < 4; ++i) {
-        uint32_t export_component_bit = UINT32_C(1) << i;
-        float export_component = 0.0f;
-        if (vector_result_write_mask & export_component_bit) {
-          export_component = vector_result[i];
-        } else if (scalar_result_write_mask & export_component_bit) {
-          export_component = scalar_result;
-        } else if (export_constant_1_mask & export_component_bit) {
-          export_component = 1.0f;
-        } else {
-          export_component = 0.0f;
-        }
-        export_value[i] = export_component;
-      }
-      export_sink_->Export(
-          ucode::ExportRegister(instr.vector_dest()), export_value,
-          vector_result_write_mask | scalar_result_write_mask |
-              instr.GetConstant0WriteMask() | export_constant_1_mask);
-    }
-  } else {
-    if (vector_result_write_mask) {
-      float* vector_dest =
-          GetTempRegister(instr.vector_dest(), instr.is_vector_dest_relative());
-      for (uint32_t i = 0; i < 4; ++i) {
-        if (vector_result_write_mask & (UINT32_C(1) << i)) {
-          vector_dest[i] = vector_result[i];
-        }
-      }
-    }
-    if (scalar_result_write_mask) {
-      float* scalar_dest =
-          GetTempRegister(instr.scalar_dest(), instr.is_scalar_dest_relative());
-      for (uint32_t i = 0; i < 4; ++i) {
-        if (scalar_result_write_mask & (UINT32_C(1) << i)) {
-          scalar_dest[i] = scalar_result;
-        }
-      }
-    }
-  }
 }
 
 void ShaderInterpreter::StoreFetchResult(uint32_t dest, bool is_dest_relative,
@@ -986,10 +1006,6 @@ void ShaderInterpreter::StoreFetchResult(uint32_t dest, bool is_dest_relative,
 
 void ShaderInterpreter::ExecuteVertexFetchInstruction(
     ucode::VertexFetchInstruction instr) {
-  // FIXME(Triang3l): Bit scan loops over components cause a link-time
-  // optimization internal error in Visual Studio 2019, mainly in the format
-  // unpacking. Using loops with up to 4 iterations here instead.
-
   if (!instr.is_mini_fetch()) {
     state_.vfetch_full_last = instr;
   }
@@ -1007,8 +1023,22 @@ void ShaderInterpreter::ExecuteVertexFetchInstruction(
         instr.stride() * vertex_index + fetch_constant.address;
   }
 
+  float result[4];
+  FetchVertexData(instr, fetch_constant, state_.vfetch_address_dwords, result);
+  StoreFetchResult(instr.dest(), instr.is_dest_relative(), instr.dest_swizzle(),
+                   result);
+}
+
+void ShaderInterpreter::FetchVertexData(
+    ucode::VertexFetchInstruction instr,
+    const xenos::xe_gpu_vertex_fetch_t& fetch_constant, uint32_t address_dwords,
+    float* result) const {
+  // FIXME(Triang3l): Bit scan loops over components cause a link-time
+  // optimization internal error in Visual Studio 2019, mainly in the format
+  // unpacking. Using loops with up to 4 iterations here instead.
+
   // TODO(Triang3l): Find the default values for unused components.
-  float result[4] = {};
+  std::memset(result, 0, sizeof(float) * 4);
   uint32_t dest_swizzle = instr.dest_swizzle();
   uint32_t used_result_components = 0b0000;
   for (uint32_t i = 0; i < 4; ++i) {
@@ -1025,7 +1055,7 @@ void ShaderInterpreter::ExecuteVertexFetchInstruction(
         reinterpret_cast<const uint32_t*>(memory_.physical_membase());
     uint32_t buffer_end_dwords = fetch_constant.address + fetch_constant.size;
     uint32_t dword_0_address_dwords =
-        uint32_t(int32_t(state_.vfetch_address_dwords) + instr.offset());
+        uint32_t(int32_t(address_dwords) + instr.offset());
     for (uint32_t i = 0; i < 4; ++i) {
       if (!(needed_dwords & (UINT32_C(1) << i))) {
         continue;
@@ -1214,9 +1244,6 @@ void ShaderInterpreter::ExecuteVertexFetchInstruction(
       result[i] *= exp_adjust_factor;
     }
   }
-
-  StoreFetchResult(instr.dest(), instr.is_dest_relative(), instr.dest_swizzle(),
-                   result);
 }
 
 }  // namespace gpu
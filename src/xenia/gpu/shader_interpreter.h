@@ -14,6 +14,9 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/shader.h"
@@ -25,6 +28,9 @@ namespace gpu {
 
 class ShaderInterpreter {
  public:
+  // Number of invocations executed together by ExecuteBatch.
+  static constexpr uint32_t kBatchSize = 8;
+
   ShaderInterpreter(const RegisterFile& register_file, const Memory& memory)
       : register_file_(register_file), memory_(memory) {}
 
@@ -61,13 +67,26 @@ class ShaderInterpreter {
   void SetShader(xenos::ShaderType shader_type, const uint32_t* ucode) {
     shader_type_ = shader_type;
     ucode_ = ucode;
+    shader_ = nullptr;
   }
   void SetShader(const Shader& shader) {
     assert_true(CanInterpretShader(shader));
     SetShader(shader.type(), shader.ucode_dwords());
+    shader_ = &shader;
   }
 
   void Execute();
+  // Executes up to kBatchSize invocations of the shader, each starting with
+  // the current temporary registers, but with r0.x from r0_x_values, and
+  // exporting to the respective sink from export_sinks (which may be null).
+  // Unlike Execute, leaves the temporary registers and the export sink
+  // unchanged.
+  // With the shader set from a Shader object, the invocations are executed
+  // together from a pre-decoded form of the shader cached by its ucode hash.
+  // Invocations taking different predicated branches, and shaders containing
+  // loops, fall back to Execute for each invocation.
+  void ExecuteBatch(uint32_t count, const float* r0_x_values,
+                    ExportSink* const* export_sinks);
 
  private:
   struct State {
@@ -102,6 +121,66 @@ class ShaderInterpreter {
     }
   };
 
+  // An ALU operand or a vertex fetch index source with all addressing other
+  // than a0-relative resolved, since aL is always 0 in shaders executed in
+  // batches (loops are not supported there).
+  struct BatchOperand {
+    // Temporary register or float constant index.
+    uint32_t index;
+    bool is_temp;
+    bool is_a0_relative;
+    uint32_t absolute_mask;
+    uint32_t negate_bit;
+    // Vector operands use all 4, scalar ones use only the first.
+    uint8_t components[4];
+  };
+
+  struct BatchInstruction {
+    enum class Type : uint8_t {
+      kAlu,
+      kVertexFetch,
+      // Texture fetch, not supported, storing zeros.
+      kZeroFetch,
+    };
+    Type type;
+    bool is_predicated;
+    bool predicate_condition;
+    // For the ALU, whether the vector operation needs to be executed.
+    bool is_vector_executed;
+    uint32_t vector_operand_count;
+    uint32_t scalar_operand_count;
+    BatchOperand vector_operands[3];
+    BatchOperand scalar_operands[2];
+    // The raw ucode::AluInstruction or ucode::FetchInstruction.
+    uint32_t dwords[3];
+  };
+
+  struct BatchShader {
+    // False if the shader needs to be executed by Execute, such as if it
+    // contains loops.
+    bool is_batchable = false;
+    std::vector<ucode::ControlFlowInstruction> cf_instructions;
+    // For exec control flow instructions, the index of the first instruction
+    // in instructions.
+    std::vector<uint32_t> cf_exec_first_instructions;
+    std::vector<BatchInstruction> instructions;
+  };
+
+  // An export or an allocation done by an invocation executed in a batch,
+  // delivered to its sink after the whole batch has been executed so they can
+  // be discarded if the invocation has to be executed again by Execute.
+  struct BatchExport {
+    // UINT32_MAX for AllocExport.
+    uint32_t export_register;
+    // AllocExport type and size, or Export value mask.
+    uint32_t alloc_type;
+    uint32_t mask_or_size;
+    float value[4];
+  };
+
+  // Per-invocation state of a batch, in a structure-of-arrays layout.
+  struct BatchState;
+
   static float FlushDenormal(float value) {
     uint32_t bits = *reinterpret_cast<const uint32_t*>(&value);
     bits &= (bits & UINT32_C(0x7F800000)) ? ~UINT32_C(0) : (UINT32_C(1) << 31);
@@ -120,11 +199,45 @@ class ShaderInterpreter {
   }
   const std::array<float, 4> GetFloatConstant(
       uint32_t address, bool is_relative, bool relative_address_is_a0) const;
+  const std::array<float, 4> GetFloatConstantAtIndex(int32_t index) const;
 
   void ExecuteAluInstruction(ucode::AluInstruction instr);
+  // Writes the full result for all 4 components, and updates the state that
+  // may be changed by the operation.
+  static void ExecuteAluVectorOperation(ucode::AluVectorOpcode vector_opcode,
+                                        const float (*vector_operands)[4],
+                                        float* vector_result, bool& predicate,
+                                        int32_t& address_register);
+  static void ExecuteAluScalarOperation(ucode::AluScalarOpcode scalar_opcode,
+                                        const float* scalar_operands,
+                                        float& previous_scalar,
+                                        bool& predicate,
+                                        int32_t& address_register);
   void StoreFetchResult(uint32_t dest, bool is_dest_relative, uint32_t swizzle,
                         const float* value);
   void ExecuteVertexFetchInstruction(ucode::VertexFetchInstruction instr);
+  // Unpacks the data for a vertex fetch from the vertex at address_dwords,
+  // before the destination swizzle.
+  void FetchVertexData(ucode::VertexFetchInstruction instr,
+                       const xenos::xe_gpu_vertex_fetch_t& fetch_constant,
+                       uint32_t address_dwords, float* result) const;
+
+  const BatchShader& GetBatchShader(const Shader& shader);
+  static BatchOperand DecodeBatchAluOperand(ucode::AluInstruction instr,
+                                            uint32_t operand_index);
+  // Returns the mask of the invocations that need to be executed by Execute.
+  uint32_t ExecuteBatchShader(const BatchShader& batch_shader, uint32_t count,
+                              const float* r0_x_values);
+  void LoadBatchOperand(const BatchOperand& operand, uint32_t component_count,
+                        const BatchState& batch_state,
+                        float (*values)[kBatchSize]) const;
+  static void StoreBatchFetchResult(uint32_t dest, uint32_t swizzle,
+                                    const float* value, uint32_t lane,
+                                    BatchState& batch_state);
+  void ExecuteBatchAlu(const BatchInstruction& instr, uint32_t lane_mask,
+                       BatchState& batch_state) const;
+  void ExecuteBatchFetch(const BatchInstruction& instr, uint32_t lane_mask,
+                         BatchState& batch_state) const;
 
   const RegisterFile& register_file_;
   const Memory& memory_;
@@ -135,11 +248,17 @@ class ShaderInterpreter {
 
   xenos::ShaderType shader_type_ = xenos::ShaderType::kVertex;
   const uint32_t* ucode_ = nullptr;
+  // Non-null if set from a Shader object, for executing in batches.
+  const Shader* shader_ = nullptr;
 
   // For both inputs and locals.
   float temp_registers_[xenos::kMaxShaderTempRegisters][4];
 
   State state_;
+
+  // Pre-decoded shaders for executing in batches by the ucode hash.
+  std::unordered_map<uint64_t, std::unique_ptr<BatchShader>> batch_shaders_;
+  std::vector<BatchExport> batch_exports_[kBatchSize];
 };
 
 }  // namespace gpu
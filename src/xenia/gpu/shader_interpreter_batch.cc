@@ -0,0 +1,742 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/math.h"
+#include "xenia/gpu/shader_interpreter.h"
+
+namespace xe {
+namespace gpu {
+
+// Shaders are pre-decoded and interpreted for several invocations at once
+// rather than translated to host code. xbyak is available for x64, but a JIT
+// would also need an AArch64 code generator, and keeping its results
+// bit-identical to the per-invocation interpreter in Execute would be harder.
+// The batched loops here are portable and compiled for every host.
+
+struct ShaderInterpreter::BatchState {
+  alignas(32) float temp_registers[xenos::kMaxShaderTempRegisters][4]
+                                  [kBatchSize];
+  float previous_scalar[kBatchSize];
+  int32_t address_register[kBatchSize];
+  uint32_t vfetch_address_dwords[kBatchSize];
+  ucode::VertexFetchInstruction vfetch_full_last[kBatchSize];
+  uint32_t predicate_mask;
+  std::vector<BatchExport>* exports;
+};
+
+void ShaderInterpreter::ExecuteBatch(uint32_t count, const float* r0_x_values,
+                                     ExportSink* const* export_sinks) {
+  assert_true(count <= kBatchSize);
+  count = std::min(count, kBatchSize);
+  if (!count) {
+    return;
+  }
+
+  uint32_t execute_lane_mask = (UINT32_C(1) << count) - 1;
+  if (shader_) {
+    const BatchShader& batch_shader = GetBatchShader(*shader_);
+    if (batch_shader.is_batchable) {
+      execute_lane_mask =
+          ExecuteBatchShader(batch_shader, count, r0_x_values);
+    }
+  }
+
+  for (uint32_t lane = 0; lane < count; ++lane) {
+    if (execute_lane_mask & (UINT32_C(1) << lane)) {
+      continue;
+    }
+    ExportSink* export_sink = export_sinks[lane];
+    if (!export_sink) {
+      continue;
+    }
+    for (const BatchExport& batch_export : batch_exports_[lane]) {
+      if (batch_export.export_register == UINT32_MAX) {
+        export_sink->AllocExport(ucode::AllocType(batch_export.alloc_type),
+                                 batch_export.mask_or_size);
+      } else {
+        export_sink->Export(
+            ucode::ExportRegister(batch_export.export_register),
+            batch_export.value, batch_export.mask_or_size);
+      }
+    }
+  }
+
+  if (execute_lane_mask) {
+    ExportSink* export_sink_saved = export_sink_;
+    float temp_registers_saved[xenos::kMaxShaderTempRegisters][4];
+    std::memcpy(temp_registers_saved, temp_registers_,
+                sizeof(temp_registers_));
+    uint32_t lane;
+    while (xe::bit_scan_forward(execute_lane_mask, &lane)) {
+      execute_lane_mask &= ~(UINT32_C(1) << lane);
+      std::memcpy(temp_registers_, temp_registers_saved,
+                  sizeof(temp_registers_));
+      temp_registers_[0][0] = r0_x_values[lane];
+      export_sink_ = export_sinks[lane];
+      Execute();
+    }
+    std::memcpy(temp_registers_, temp_registers_saved,
+                sizeof(temp_registers_));
+    export_sink_ = export_sink_saved;
+  }
+}
+
+const ShaderInterpreter::BatchShader& ShaderInterpreter::GetBatchShader(
+    const Shader& shader) {
+  auto it = batch_shaders_.find(shader.ucode_data_hash());
+  if (it != batch_shaders_.end()) {
+    return *it->second;
+  }
+
+  auto batch_shader = std::make_unique<BatchShader>();
+  const uint32_t* ucode = shader.ucode_dwords();
+  uint32_t ucode_instruction_count = uint32_t(shader.ucode_dword_count() / 3);
+  uint32_t cf_pair_index_bound =
+      std::min(shader.cf_pair_index_bound(), ucode_instruction_count);
+  batch_shader->cf_instructions.resize(2 * cf_pair_index_bound);
+  batch_shader->cf_exec_first_instructions.resize(2 * cf_pair_index_bound);
+  for (uint32_t i = 0; i < cf_pair_index_bound; ++i) {
+    ucode::UnpackControlFlowInstructions(
+        ucode + 3 * i, batch_shader->cf_instructions.data() + 2 * i);
+  }
+  bool is_batchable = true;
+  for (uint32_t cf_index = 0;
+       is_batchable && cf_index < 2 * cf_pair_index_bound; ++cf_index) {
+    const ucode::ControlFlowInstruction& cf_instr =
+        batch_shader->cf_instructions[cf_index];
+    ucode::ControlFlowOpcode cf_opcode = cf_instr.opcode();
+    if (cf_opcode == ucode::ControlFlowOpcode::kLoopStart ||
+        cf_opcode == ucode::ControlFlowOpcode::kLoopEnd) {
+      // aL and the loop stack are not tracked for batches.
+      is_batchable = false;
+      break;
+    }
+    if (!ucode::IsControlFlowOpcodeExec(cf_opcode)) {
+      continue;
+    }
+    const ucode::ControlFlowExecInstruction& cf_exec = cf_instr.exec;
+    if (cf_exec.address() + cf_exec.count() > ucode_instruction_count) {
+      is_batchable = false;
+      break;
+    }
+    batch_shader->cf_exec_first_instructions[cf_index] =
+        uint32_t(batch_shader->instructions.size());
+    for (uint32_t exec_index = 0; exec_index < cf_exec.count(); ++exec_index) {
+      BatchInstruction& instr = batch_shader->instructions.emplace_back();
+      std::memcpy(instr.dwords, ucode + 3 * (cf_exec.address() + exec_index),
+                  sizeof(instr.dwords));
+      if ((cf_exec.sequence() >> (exec_index << 1)) & 0b01) {
+        const ucode::FetchInstruction& fetch_instr =
+            *reinterpret_cast<const ucode::FetchInstruction*>(instr.dwords);
+        instr.type =
+            fetch_instr.opcode() == ucode::FetchOpcode::kVertexFetch
+                ? BatchInstruction::Type::kVertexFetch
+                : BatchInstruction::Type::kZeroFetch;
+        instr.is_predicated = fetch_instr.is_predicated();
+        instr.predicate_condition = fetch_instr.predicate_condition();
+        continue;
+      }
+      const ucode::AluInstruction& alu_instr =
+          *reinterpret_cast<const ucode::AluInstruction*>(instr.dwords);
+      instr.type = BatchInstruction::Type::kAlu;
+      instr.is_predicated = alu_instr.is_predicated();
+      instr.predicate_condition = alu_instr.predicate_condition();
+      const ucode::AluVectorOpcodeInfo& vector_opcode_info =
+          ucode::GetAluVectorOpcodeInfo(alu_instr.vector_opcode());
+      instr.is_vector_executed = alu_instr.GetVectorOpResultWriteMask() ||
+                                 vector_opcode_info.changed_state;
+      if (instr.is_vector_executed) {
+        instr.vector_operand_count = vector_opcode_info.GetOperandCount();
+        for (uint32_t i = 0; i < instr.vector_operand_count; ++i) {
+          instr.vector_operands[i] = DecodeBatchAluOperand(alu_instr, 1 + i);
+        }
+      }
+      const ucode::AluScalarOpcodeInfo& scalar_opcode_info =
+          ucode::GetAluScalarOpcodeInfo(alu_instr.scalar_opcode());
+      uint32_t scalar_src_swizzle = alu_instr.src_swizzle(3);
+      uint32_t scalar_src_negate_bit = uint32_t(alu_instr.src_negate(3)) << 31;
+      switch (scalar_opcode_info.operand_count) {
+        case 1: {
+          // r#/c#.w or r#/c#.wx.
+          instr.scalar_operand_count =
+              scalar_opcode_info.single_operand_is_two_component ? 2 : 1;
+          BatchOperand scalar_operand = DecodeBatchAluOperand(alu_instr, 3);
+          for (uint32_t i = 0; i < instr.scalar_operand_count; ++i) {
+            instr.scalar_operands[i] = scalar_operand;
+            instr.scalar_operands[i].components[0] =
+                scalar_operand.components[(3 + i) & 3];
+          }
+        } break;
+        case 2: {
+          // c#.w and r#.x, without the absolute value.
+          instr.scalar_operand_count = 2;
+          BatchOperand& scalar_operand_constant = instr.scalar_operands[0];
+          scalar_operand_constant.index = alu_instr.src_reg(3);
+          scalar_operand_constant.is_temp = false;
+          scalar_operand_constant.is_a0_relative =
+              alu_instr.src_const_is_addressed(3) &&
+              alu_instr.is_const_address_register_relative();
+          scalar_operand_constant.components[0] = uint8_t(
+              ucode::AluInstruction::GetSwizzledComponentIndex(
+                  scalar_src_swizzle, 3));
+          BatchOperand& scalar_operand_temp = instr.scalar_operands[1];
+          scalar_operand_temp.index =
+              alu_instr.scalar_const_reg_op_src_temp_reg() &
+              (xenos::kMaxShaderTempRegisters - 1);
+          scalar_operand_temp.is_temp = true;
+          scalar_operand_temp.is_a0_relative = false;
+          scalar_operand_temp.components[0] = uint8_t(
+              ucode::AluInstruction::GetSwizzledComponentIndex(
+                  scalar_src_swizzle, 0));
+          for (uint32_t i = 0; i < 2; ++i) {
+            instr.scalar_operands[i].absolute_mask = ~UINT32_C(0);
+            instr.scalar_operands[i].negate_bit = scalar_src_negate_bit;
+          }
+        } break;
+      }
+    }
+  }
+  batch_shader->is_batchable = is_batchable;
+
+  return *batch_shaders_
+              .emplace(shader.ucode_data_hash(), std::move(batch_shader))
+              .first->second;
+}
+
+ShaderInterpreter::BatchOperand ShaderInterpreter::DecodeBatchAluOperand(
+    ucode::AluInstruction instr, uint32_t operand_index) {
+  BatchOperand operand;
+  uint32_t src_register = instr.src_reg(operand_index);
+  bool src_absolute = false;
+  operand.is_temp = instr.src_is_temp(operand_index);
+  if (operand.is_temp) {
+    // aL is 0 outside loops.
+    operand.index = ucode::AluInstruction::src_temp_reg(src_register);
+    operand.is_a0_relative = false;
+    src_absolute =
+        ucode::AluInstruction::is_src_temp_value_absolute(src_register);
+  } else {
+    operand.index = src_register;
+    operand.is_a0_relative = instr.src_const_is_addressed(operand_index) &&
+                             instr.is_const_address_register_relative();
+  }
+  operand.absolute_mask = ~(uint32_t(src_absolute) << 31);
+  operand.negate_bit = uint32_t(instr.src_negate(operand_index)) << 31;
+  uint32_t src_swizzle = instr.src_swizzle(operand_index);
+  for (uint32_t i = 0; i < 4; ++i) {
+    operand.components[i] = uint8_t(
+        ucode::AluInstruction::GetSwizzledComponentIndex(src_swizzle, i));
+  }
+  return operand;
+}
+
+uint32_t ShaderInterpreter::ExecuteBatchShader(const BatchShader& batch_shader,
+                                               uint32_t count,
+                                               const float* r0_x_values) {
+  BatchState batch_state;
+  for (uint32_t i = 0; i < xenos::kMaxShaderTempRegisters; ++i) {
+    for (uint32_t j = 0; j < 4; ++j) {
+      std::fill_n(batch_state.temp_registers[i][j], kBatchSize,
+                  temp_registers_[i][j]);
+    }
+  }
+  std::memcpy(batch_state.temp_registers[0][0], r0_x_values,
+              sizeof(float) * count);
+  std::memset(batch_state.previous_scalar, 0,
+              sizeof(batch_state.previous_scalar));
+  std::memset(batch_state.address_register, 0,
+              sizeof(batch_state.address_register));
+  std::memset(batch_state.vfetch_address_dwords, 0,
+              sizeof(batch_state.vfetch_address_dwords));
+  std::memset(batch_state.vfetch_full_last, 0,
+              sizeof(batch_state.vfetch_full_last));
+  batch_state.predicate_mask = 0;
+  batch_state.exports = batch_exports_;
+  for (uint32_t lane = 0; lane < count; ++lane) {
+    batch_exports_[lane].clear();
+  }
+
+  const uint32_t* bool_constants =
+      &register_file_[XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031];
+  auto is_bool_constant_true = [bool_constants](uint32_t bool_address) {
+    return (bool_constants[bool_address >> 5] &
+            (UINT32_C(1) << (bool_address & 31))) != 0;
+  };
+
+  // Invocations that haven't reached the end of the shader yet, the control
+  // flow is uniform across them.
+  uint32_t lane_mask = (UINT32_C(1) << count) - 1;
+  uint32_t execute_lane_mask = 0;
+  uint32_t call_stack_depth = 0;
+  uint32_t call_return_addresses[4];
+  uint32_t cf_count = uint32_t(batch_shader.cf_instructions.size());
+  uint32_t cf_index_next = 1;
+  for (uint32_t cf_index = 0; lane_mask; cf_index = cf_index_next) {
+    cf_index_next = cf_index + 1;
+    if (cf_index >= cf_count) {
+      // Malformed shader, let Execute interpret whatever is there.
+      execute_lane_mask |= lane_mask;
+      break;
+    }
+
+    const ucode::ControlFlowInstruction& cf_instr =
+        batch_shader.cf_instructions[cf_index];
+    ucode::ControlFlowOpcode cf_opcode = cf_instr.opcode();
+    switch (cf_opcode) {
+      case ucode::ControlFlowOpcode::kNop: {
+      } break;
+
+      case ucode::ControlFlowOpcode::kExec:
+      case ucode::ControlFlowOpcode::kExecEnd:
+      case ucode::ControlFlowOpcode::kCondExec:
+      case ucode::ControlFlowOpcode::kCondExecEnd:
+      case ucode::ControlFlowOpcode::kCondExecPred:
+      case ucode::ControlFlowOpcode::kCondExecPredEnd:
+      case ucode::ControlFlowOpcode::kCondExecPredClean:
+      case ucode::ControlFlowOpcode::kCondExecPredCleanEnd: {
+        uint32_t exec_lane_mask = lane_mask;
+        switch (cf_opcode) {
+          case ucode::ControlFlowOpcode::kCondExec:
+          case ucode::ControlFlowOpcode::kCondExecEnd:
+          case ucode::ControlFlowOpcode::kCondExecPredClean:
+          case ucode::ControlFlowOpcode::kCondExecPredCleanEnd: {
+            if (cf_instr.cond_exec.condition() !=
+                is_bool_constant_true(cf_instr.cond_exec.bool_address())) {
+              exec_lane_mask = 0;
+            }
+          } break;
+          case ucode::ControlFlowOpcode::kCondExecPred:
+          case ucode::ControlFlowOpcode::kCondExecPredEnd: {
+            exec_lane_mask &= cf_instr.cond_exec_pred.condition()
+                                  ? batch_state.predicate_mask
+                                  : ~batch_state.predicate_mask;
+          } break;
+          default:
+            break;
+        }
+        if (!exec_lane_mask) {
+          continue;
+        }
+
+        const BatchInstruction* instructions =
+            batch_shader.instructions.data() +
+            batch_shader.cf_exec_first_instructions[cf_index];
+        for (uint32_t exec_index = 0; exec_index < cf_instr.exec.count();
+             ++exec_index) {
+          const BatchInstruction& instr = instructions[exec_index];
+          uint32_t instr_lane_mask = exec_lane_mask;
+          if (instr.is_predicated) {
+            instr_lane_mask &= instr.predicate_condition
+                                   ? batch_state.predicate_mask
+                                   : ~batch_state.predicate_mask;
+            if (!instr_lane_mask) {
+              continue;
+            }
+          }
+          if (instr.type == BatchInstruction::Type::kAlu) {
+            ExecuteBatchAlu(instr, instr_lane_mask, batch_state);
+          } else {
+            ExecuteBatchFetch(instr, instr_lane_mask, batch_state);
+          }
+        }
+
+        if (ucode::DoesControlFlowOpcodeEndShader(cf_opcode)) {
+          lane_mask &= ~exec_lane_mask;
+        }
+      } break;
+
+      case ucode::ControlFlowOpcode::kCondCall:
+      case ucode::ControlFlowOpcode::kCondJmp: {
+        // The layouts of the two are the same other than the direction bit
+        // that is not used.
+        bool is_call = cf_opcode == ucode::ControlFlowOpcode::kCondCall;
+        if (is_call && call_stack_depth >= 4) {
+          continue;
+        }
+        const ucode::ControlFlowCondJmpInstruction& cf_cond_jmp =
+            cf_instr.cond_jmp;
+        uint32_t taken_lane_mask = lane_mask;
+        if (!cf_cond_jmp.is_unconditional()) {
+          if (cf_cond_jmp.is_predicated()) {
+            taken_lane_mask &= cf_cond_jmp.condition()
+                                   ? batch_state.predicate_mask
+                                   : ~batch_state.predicate_mask;
+          } else if (cf_cond_jmp.condition() !=
+                     is_bool_constant_true(cf_cond_jmp.bool_address())) {
+            taken_lane_mask = 0;
+          }
+        }
+        if (taken_lane_mask != lane_mask) {
+          // Continue with the invocations not taking the branch, and execute
+          // the divergent ones from the beginning by Execute.
+          execute_lane_mask |= taken_lane_mask;
+          lane_mask &= ~taken_lane_mask;
+          continue;
+        }
+        if (is_call) {
+          call_return_addresses[call_stack_depth++] = cf_index + 1;
+        }
+        cf_index_next = cf_cond_jmp.address();
+      } break;
+
+      case ucode::ControlFlowOpcode::kReturn: {
+        if (!call_stack_depth) {
+          continue;
+        }
+        cf_index_next = call_return_addresses[--call_stack_depth];
+      } break;
+
+      case ucode::ControlFlowOpcode::kAlloc: {
+        BatchExport batch_alloc = {};
+        batch_alloc.export_register = UINT32_MAX;
+        batch_alloc.alloc_type = uint32_t(cf_instr.alloc.alloc_type());
+        batch_alloc.mask_or_size = cf_instr.alloc.size();
+        uint32_t alloc_lane_mask = lane_mask;
+        uint32_t lane;
+        while (xe::bit_scan_forward(alloc_lane_mask, &lane)) {
+          alloc_lane_mask &= ~(UINT32_C(1) << lane);
+          batch_exports_[lane].push_back(batch_alloc);
+        }
+      } break;
+
+      case ucode::ControlFlowOpcode::kMarkVsFetchDone: {
+      } break;
+
+      default:
+        // Loops are not batchable.
+        assert_unhandled_case(cf_opcode);
+    }
+  }
+  return execute_lane_mask;
+}
+
+void ShaderInterpreter::LoadBatchOperand(const BatchOperand& operand,
+                                         uint32_t component_count,
+                                         const BatchState& batch_state,
+                                         float (*values)[kBatchSize]) const {
+  if (operand.is_temp) {
+    for (uint32_t i = 0; i < component_count; ++i) {
+      std::memcpy(values[i],
+                  batch_state.temp_registers[operand.index]
+                                            [operand.components[i]],
+                  sizeof(float) * kBatchSize);
+    }
+  } else if (!operand.is_a0_relative) {
+    std::array<float, 4> constant =
+        GetFloatConstantAtIndex(int32_t(operand.index));
+    for (uint32_t i = 0; i < component_count; ++i) {
+      std::fill_n(values[i], kBatchSize, constant[operand.components[i]]);
+    }
+  } else {
+    for (uint32_t lane = 0; lane < kBatchSize; ++lane) {
+      std::array<float, 4> constant = GetFloatConstantAtIndex(
+          int32_t(operand.index) + batch_state.address_register[lane]);
+      for (uint32_t i = 0; i < component_count; ++i) {
+        values[i][lane] = constant[operand.components[i]];
+      }
+    }
+  }
+  for (uint32_t i = 0; i < component_count; ++i) {
+    for (uint32_t lane = 0; lane < kBatchSize; ++lane) {
+      float value = FlushDenormal(values[i][lane]);
+      *reinterpret_cast<uint32_t*>(&value) =
+          (*reinterpret_cast<const uint32_t*>(&value) &
+           operand.absolute_mask) ^
+          operand.negate_bit;
+      values[i][lane] = value;
+    }
+  }
+}
+
+void ShaderInterpreter::ExecuteBatchAlu(const BatchInstruction& instr,
+                                        uint32_t lane_mask,
+                                        BatchState& batch_state) const {
+  const ucode::AluInstruction& alu_instr =
+      *reinterpret_cast<const ucode::AluInstruction*>(instr.dwords);
+  uint32_t lane;
+
+  // Vector operation. The most common operations are done for all the
+  // invocations at once, others are done by the same code as in Execute.
+  alignas(32) float vector_result[4][kBatchSize] = {};
+  if (instr.is_vector_executed) {
+    alignas(32) float vector_operands[3][4][kBatchSize] = {};
+    for (uint32_t i = 0; i < instr.vector_operand_count; ++i) {
+      LoadBatchOperand(instr.vector_operands[i], 4, batch_state,
+                       vector_operands[i]);
+    }
+    ucode::AluVectorOpcode vector_opcode = alu_instr.vector_opcode();
+    switch (vector_opcode) {
+      case ucode::AluVectorOpcode::kAdd: {
+        for (uint32_t i = 0; i < 4; ++i) {
+          for (uint32_t j = 0; j < kBatchSize; ++j) {
+            vector_result[i][j] =
+                vector_operands[0][i][j] + vector_operands[1][i][j];
+          }
+        }
+      } break;
+      case ucode::AluVectorOpcode::kMul: {
+        for (uint32_t i = 0; i < 4; ++i) {
+          for (uint32_t j = 0; j < kBatchSize; ++j) {
+            // Direct3D 9 behavior (0 or denormal * anything = +0).
+            vector_result[i][j] =
+                (vector_operands[0][i][j] && vector_operands[1][i][j])
+                    ? vector_operands[0][i][j] * vector_operands[1][i][j]
+                    : 0.0f;
+          }
+        }
+      } break;
+      case ucode::AluVectorOpcode::kMax: {
+        for (uint32_t i = 0; i < 4; ++i) {
+          for (uint32_t j = 0; j < kBatchSize; ++j) {
+            vector_result[i][j] = std::isgreaterequal(vector_operands[0][i][j],
+                                                      vector_operands[1][i][j])
+                                      ? vector_operands[0][i][j]
+                                      : vector_operands[1][i][j];
+          }
+        }
+      } break;
+      case ucode::AluVectorOpcode::kMad: {
+        for (uint32_t i = 0; i < 4; ++i) {
+          for (uint32_t j = 0; j < kBatchSize; ++j) {
+            // Direct3D 9 behavior (0 or denormal * anything = +0).
+            vector_result[i][j] =
+                ((vector_operands[0][i][j] && vector_operands[1][i][j])
+                     ? vector_operands[0][i][j] * vector_operands[1][i][j]
+                     : 0.0f) +
+                vector_operands[2][i][j];
+          }
+        }
+      } break;
+      case ucode::AluVectorOpcode::kDp4:
+      case ucode::AluVectorOpcode::kDp3: {
+        uint32_t component_count =
+            vector_opcode == ucode::AluVectorOpcode::kDp4 ? 4 : 3;
+        for (uint32_t i = 0; i < component_count; ++i) {
+          for (uint32_t j = 0; j < kBatchSize; ++j) {
+            // Direct3D 9 behavior (0 or denormal * anything = +0).
+            vector_result[0][j] +=
+                (vector_operands[0][i][j] && vector_operands[1][i][j])
+                    ? vector_operands[0][i][j] * vector_operands[1][i][j]
+                    : 0.0f;
+          }
+        }
+        for (uint32_t i = 1; i < 4; ++i) {
+          std::memcpy(vector_result[i], vector_result[0],
+                      sizeof(float) * kBatchSize);
+        }
+      } break;
+      default: {
+        uint32_t vector_lane_mask = lane_mask;
+        while (xe::bit_scan_forward(vector_lane_mask, &lane)) {
+          vector_lane_mask &= ~(UINT32_C(1) << lane);
+          float lane_operands[3][4];
+          for (uint32_t i = 0; i < 3; ++i) {
+            for (uint32_t j = 0; j < 4; ++j) {
+              lane_operands[i][j] = vector_operands[i][j][lane];
+            }
+          }
+          float lane_result[4];
+          bool predicate = (batch_state.predicate_mask >> lane) & 1;
+          ExecuteAluVectorOperation(vector_opcode, lane_operands, lane_result,
+                                    predicate,
+                                    batch_state.address_register[lane]);
+          batch_state.predicate_mask =
+              (batch_state.predicate_mask & ~(UINT32_C(1) << lane)) |
+              (uint32_t(predicate) << lane);
+          for (uint32_t i = 0; i < 4; ++i) {
+            vector_result[i][lane] = lane_result[i];
+          }
+        }
+      }
+    }
+  }
+
+  // Scalar operation, after the vector operation might have changed a0.
+  float scalar_operands[2][kBatchSize] = {};
+  for (uint32_t i = 0; i < instr.scalar_operand_count; ++i) {
+    LoadBatchOperand(instr.scalar_operands[i], 1, batch_state,
+                     &scalar_operands[i]);
+  }
+  ucode::AluScalarOpcode scalar_opcode = alu_instr.scalar_opcode();
+  uint32_t scalar_lane_mask = lane_mask;
+  while (xe::bit_scan_forward(scalar_lane_mask, &lane)) {
+    scalar_lane_mask &= ~(UINT32_C(1) << lane);
+    float lane_operands[2] = {scalar_operands[0][lane],
+                              scalar_operands[1][lane]};
+    bool predicate = (batch_state.predicate_mask >> lane) & 1;
+    ExecuteAluScalarOperation(scalar_opcode, lane_operands,
+                              batch_state.previous_scalar[lane], predicate,
+                              batch_state.address_register[lane]);
+    batch_state.predicate_mask =
+        (batch_state.predicate_mask & ~(UINT32_C(1) << lane)) |
+        (uint32_t(predicate) << lane);
+  }
+
+  if (alu_instr.vector_clamp()) {
+    for (uint32_t i = 0; i < 4; ++i) {
+      for (uint32_t j = 0; j < kBatchSize; ++j) {
+        vector_result[i][j] = xe::saturate(vector_result[i][j]);
+      }
+    }
+  }
+
+  uint32_t vector_result_write_mask = alu_instr.GetVectorOpResultWriteMask();
+  uint32_t scalar_result_write_mask = alu_instr.GetScalarOpResultWriteMask();
+  if (alu_instr.is_export()) {
+    BatchExport batch_export;
+    batch_export.export_register = alu_instr.vector_dest();
+    batch_export.alloc_type = 0;
+    uint32_t export_constant_1_mask = alu_instr.GetConstant1WriteMask();
+    batch_export.mask_or_size =
+        vector_result_write_mask | scalar_result_write_mask |
+        alu_instr.GetConstant0WriteMask() | export_constant_1_mask;
+    uint32_t export_lane_mask = lane_mask;
+    while (xe::bit_scan_forward(export_lane_mask, &lane)) {
+      export_lane_mask &= ~(UINT32_C(1) << lane);
+      float scalar_result = batch_state.previous_scalar[lane];
+      if (alu_instr.scalar_clamp()) {
+        scalar_result = xe::saturate(scalar_result);
+      }
+      for (uint32_t i = 0; i < 4; ++i) {
+        uint32_t export_component_bit = UINT32_C(1) << i;
+        float export_component;
+        if (vector_result_write_mask & export_component_bit) {
+          export_component = vector_result[i][lane];
+        } else if (scalar_result_write_mask & export_component_bit) {
+          export_component = scalar_result;
+        } else if (export_constant_1_mask & export_component_bit) {
+          export_component = 1.0f;
+        } else {
+          export_component = 0.0f;
+        }
+        batch_export.value[i] = export_component;
+      }
+      batch_state.exports[lane].push_back(batch_export);
+    }
+    return;
+  }
+
+  // aL is 0 outside loops.
+  if (vector_result_write_mask) {
+    float(*vector_dest)[kBatchSize] =
+        batch_state.temp_registers[alu_instr.vector_dest()];
+    for (uint32_t i = 0; i < 4; ++i) {
+      if (!(vector_result_write_mask & (UINT32_C(1) << i))) {
+        continue;
+      }
+      uint32_t write_lane_mask = lane_mask;
+      while (xe::bit_scan_forward(write_lane_mask, &lane)) {
+        write_lane_mask &= ~(UINT32_C(1) << lane);
+        vector_dest[i][lane] = vector_result[i][lane];
+      }
+    }
+  }
+  if (scalar_result_write_mask) {
+    float(*scalar_dest)[kBatchSize] =
+        batch_state.temp_registers[alu_instr.scalar_dest()];
+    uint32_t write_lane_mask = lane_mask;
+    while (xe::bit_scan_forward(write_lane_mask, &lane)) {
+      write_lane_mask &= ~(UINT32_C(1) << lane);
+      float scalar_result = batch_state.previous_scalar[lane];
+      if (alu_instr.scalar_clamp()) {
+        scalar_result = xe::saturate(scalar_result);
+      }
+      for (uint32_t i = 0; i < 4; ++i) {
+        if (scalar_result_write_mask & (UINT32_C(1) << i)) {
+          scalar_dest[i][lane] = scalar_result;
+        }
+      }
+    }
+  }
+}
+
+void ShaderInterpreter::ExecuteBatchFetch(const BatchInstruction& instr,
+                                          uint32_t lane_mask,
+                                          BatchState& batch_state) const {
+  const ucode::FetchInstruction& fetch_instr =
+      *reinterpret_cast<const ucode::FetchInstruction*>(instr.dwords);
+  uint32_t lane;
+
+  if (instr.type != BatchInstruction::Type::kVertexFetch) {
+    // Not supporting texture fetching (very complex).
+    float zero_result[4] = {};
+    while (xe::bit_scan_forward(lane_mask, &lane)) {
+      lane_mask &= ~(UINT32_C(1) << lane);
+      StoreBatchFetchResult(fetch_instr.dest(), fetch_instr.dest_swizzle(),
+                            zero_result, lane, batch_state);
+    }
+    return;
+  }
+
+  ucode::VertexFetchInstruction vfetch_instr = fetch_instr.vertex_fetch();
+  while (xe::bit_scan_forward(lane_mask, &lane)) {
+    lane_mask &= ~(UINT32_C(1) << lane);
+    if (!vfetch_instr.is_mini_fetch()) {
+      batch_state.vfetch_full_last[lane] = vfetch_instr;
+    }
+    xenos::xe_gpu_vertex_fetch_t fetch_constant = register_file_.GetVertexFetch(
+        batch_state.vfetch_full_last[lane].fetch_constant_index());
+    if (!vfetch_instr.is_mini_fetch()) {
+      // aL is 0 outside loops.
+      uint32_t vertex_index = uint32_t(std::floor(
+          batch_state.temp_registers[vfetch_instr.src()]
+                                    [vfetch_instr.src_swizzle()][lane] +
+          (vfetch_instr.is_index_rounded() ? 0.5f : 0.0f)));
+      batch_state.vfetch_address_dwords[lane] =
+          vfetch_instr.stride() * vertex_index + fetch_constant.address;
+    }
+    float result[4];
+    FetchVertexData(vfetch_instr, fetch_constant,
+                    batch_state.vfetch_address_dwords[lane], result);
+    StoreBatchFetchResult(vfetch_instr.dest(), vfetch_instr.dest_swizzle(),
+                          result, lane, batch_state);
+  }
+}
+
+void ShaderInterpreter::StoreBatchFetchResult(uint32_t dest, uint32_t swizzle,
+                                              const float* value,
+                                              uint32_t lane,
+                                              BatchState& batch_state) {
+  // aL is 0 outside loops.
+  float(*dest_data)[kBatchSize] = batch_state.temp_registers[dest];
+  for (uint32_t i = 0; i < 4; ++i) {
+    ucode::FetchDestinationSwizzle component_swizzle =
+        ucode::GetFetchDestinationComponentSwizzle(swizzle, i);
+    switch (component_swizzle) {
+      case ucode::FetchDestinationSwizzle::kX:
+        dest_data[i][lane] = value[0];
+        break;
+      case ucode::FetchDestinationSwizzle::kY:
+        dest_data[i][lane] = value[1];
+        break;
+      case ucode::FetchDestinationSwizzle::kZ:
+        dest_data[i][lane] = value[2];
+        break;
+      case ucode::FetchDestinationSwizzle::kW:
+        dest_data[i][lane] = value[3];
+        break;
+      case ucode::FetchDestinationSwizzle::k1:
+        dest_data[i][lane] = 1.0f;
+        break;
+      case ucode::FetchDestinationSwizzle::kKeep:
+        break;
+      default:
+        dest_data[i][lane] = 0.0f;
+        break;
+    }
+  }
+}
+
+}  // namespace gpu
+}  // namespace xe
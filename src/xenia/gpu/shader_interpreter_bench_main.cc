@@ -0,0 +1,216 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/string_buffer.h"
+#include "xenia/gpu/register_file.h"
+#include "xenia/gpu/shader.h"
+#include "xenia/gpu/shader_interpreter.h"
+#include "xenia/gpu/ucode.h"
+#include "xenia/gpu/xenos.h"
+#include "xenia/memory.h"
+
+DEFINE_uint32(shader_interpreter_bench_vertices, 4 * 1024 * 1024,
+              "Number of vertices to execute the benchmarked vertex shader "
+              "for with each execution method.",
+              "GPU");
+
+namespace xe {
+namespace gpu {
+
+namespace {
+
+// Different vertices within the range are fetched so the guest memory accesses
+// are similar to those of real draws.
+constexpr uint32_t kBenchVertexCount = 65536;
+
+// Keeps the largest exported position component so the work isn't optimized
+// away.
+class BenchExportSink : public ShaderInterpreter::ExportSink {
+ public:
+  void AllocExport(ucode::AllocType type, uint32_t size) override {}
+  void Export(ucode::ExportRegister export_register, const float* value,
+              uint32_t value_mask) override {
+    for (uint32_t i = 0; i < 4; ++i) {
+      if (value_mask & (UINT32_C(1) << i)) {
+        max_value_ = std::max(max_value_, value[i]);
+      }
+    }
+  }
+
+  float max_value() const { return max_value_; }
+
+ private:
+  float max_value_ = 0.0f;
+};
+
+// A typical position-only vertex shader:
+// alloc position
+// exec_end
+//   vfetch r1.xyz1, r0.x, vf0 (float3)
+//   dp4 oPos.x, c0, r1
+//   dp4 oPos.y, c1, r1
+//   dp4 oPos.z, c2, r1
+//   dp4 oPos.w, c3, r1
+std::vector<uint32_t> GetBenchShaderUcode() {
+  std::vector<uint32_t> ucode;
+  uint32_t cf_alloc_dword_0 = 0;
+  uint32_t cf_alloc_dword_1 =
+      (uint32_t(ucode::AllocType::kVsPosition) << 9) |
+      (uint32_t(ucode::ControlFlowOpcode::kAlloc) << 12);
+  // The instructions are after the single control flow pair, the first one is
+  // a fetch.
+  uint32_t cf_exec_dword_0 = 1 | (5 << 12) | (0b01 << 16);
+  uint32_t cf_exec_dword_1 = uint32_t(ucode::ControlFlowOpcode::kExecEnd)
+                             << 12;
+  ucode.push_back(cf_alloc_dword_0);
+  ucode.push_back((cf_alloc_dword_1 & 0xFFFF) | (cf_exec_dword_0 << 16));
+  ucode.push_back((cf_exec_dword_0 >> 16) | (cf_exec_dword_1 << 16));
+  // vfetch.
+  ucode.push_back((1 << 12) | (1 << 19));
+  ucode.push_back(0 | (1 << 3) | (2 << 6) | (5 << 9) | (1 << 13) |
+                  (uint32_t(xenos::VertexFormat::k_32_32_32_FLOAT) << 16));
+  ucode.push_back(3);
+  // dp4.
+  for (uint32_t i = 0; i < 4; ++i) {
+    ucode.push_back(uint32_t(ucode::ExportRegister::kVSPosition) | (1 << 15) |
+                    ((UINT32_C(1) << i) << 16) |
+                    (uint32_t(ucode::AluScalarOpcode::kRetainPrev) << 26));
+    ucode.push_back(0);
+    ucode.push_back((1 << 8) | (i << 16) |
+                    (uint32_t(ucode::AluVectorOpcode::kDp4) << 24) | (1 << 30));
+  }
+  return ucode;
+}
+
+}  // namespace
+
+// Executes a simple vertex shader with the CPU shader interpreter for a number
+// of vertices one at a time and in batches, and reports the throughput in
+// millions of vertices per second.
+int shader_interpreter_bench_main(const std::vector<std::string>& args) {
+  uint32_t vertex_count =
+      std::max(cvars::shader_interpreter_bench_vertices,
+               ShaderInterpreter::kBatchSize);
+  XELOGI("Executing the vertex shader for {} vertices", vertex_count);
+
+  auto memory = std::make_unique<Memory>();
+  if (!memory->Initialize()) {
+    XELOGE("Failed to initialize the guest memory");
+    return 1;
+  }
+  uint32_t vertex_data_size = sizeof(float) * 3 * kBenchVertexCount;
+  if (!memory->LookupHeap(0xA0000000)
+           ->AllocFixed(0xA0000000, vertex_data_size, 0,
+                        kMemoryAllocationReserve | kMemoryAllocationCommit,
+                        kMemoryProtectRead | kMemoryProtectWrite)) {
+    XELOGE("Failed to allocate the vertex data");
+    return 1;
+  }
+  std::mt19937 random_engine;
+  std::uniform_real_distribution<float> position_distribution(-100.0f, 100.0f);
+  auto vertex_data = memory->TranslatePhysical<uint32_t*>(0);
+  for (uint32_t i = 0; i < 3 * kBenchVertexCount; ++i) {
+    // Guest big-endian data.
+    vertex_data[i] = xe::byte_swap(
+        std::bit_cast<uint32_t>(position_distribution(random_engine)));
+  }
+
+  auto register_file = std::make_unique<RegisterFile>();
+  RegisterFile& regs = *register_file;
+  regs[XE_GPU_REG_SQ_VS_CONST] = 255 << 12;
+  const float matrix[4][4] = {
+      {0.5f, 0.0f, 0.0f, 0.0f},
+      {0.0f, 0.5f, 0.0f, 0.0f},
+      {0.0f, 0.0f, 0.25f, 0.5f},
+      {0.0f, 0.0f, 0.0f, 1.0f},
+  };
+  std::memcpy(&regs[XE_GPU_REG_SHADER_CONSTANT_000_X], matrix, sizeof(matrix));
+  xenos::xe_gpu_vertex_fetch_t fetch = {};
+  fetch.type = xenos::FetchConstantType::kVertex;
+  fetch.endian = xenos::Endian::k8in32;
+  fetch.size = 3 * kBenchVertexCount;
+  std::memcpy(&regs[XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0], &fetch,
+              sizeof(fetch));
+
+  std::vector<uint32_t> ucode = GetBenchShaderUcode();
+  Shader shader(xenos::ShaderType::kVertex, 1, ucode.data(), ucode.size(),
+                std::endian::native);
+  StringBuffer ucode_disasm_buffer;
+  shader.AnalyzeUcode(ucode_disasm_buffer);
+  if (!ShaderInterpreter::CanInterpretShader(shader)) {
+    XELOGE("The benchmarked shader can't be interpreted");
+    return 1;
+  }
+  ShaderInterpreter interpreter(regs, *memory);
+  interpreter.SetShader(shader);
+
+  double tick_frequency = double(Clock::QueryHostTickFrequency());
+  double mega_vertices = double(vertex_count) / 1000000.0;
+
+  BenchExportSink execute_sink;
+  interpreter.SetExportSink(&execute_sink);
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  for (uint32_t i = 0; i < vertex_count; ++i) {
+    interpreter.temp_registers()[0] = float(i % kBenchVertexCount);
+    interpreter.Execute();
+  }
+  double execute_seconds =
+      double(Clock::QueryHostTickCount() - start_ticks) / tick_frequency;
+  interpreter.SetExportSink(nullptr);
+
+  BenchExportSink batch_sinks[ShaderInterpreter::kBatchSize];
+  ShaderInterpreter::ExportSink* batch_sink_pointers[ShaderInterpreter::
+                                                         kBatchSize];
+  for (uint32_t i = 0; i < ShaderInterpreter::kBatchSize; ++i) {
+    batch_sink_pointers[i] = &batch_sinks[i];
+  }
+  start_ticks = Clock::QueryHostTickCount();
+  for (uint32_t i = 0; i < vertex_count; i += ShaderInterpreter::kBatchSize) {
+    uint32_t batch_count =
+        std::min(vertex_count - i, ShaderInterpreter::kBatchSize);
+    float r0_x_values[ShaderInterpreter::kBatchSize];
+    for (uint32_t j = 0; j < batch_count; ++j) {
+      r0_x_values[j] = float((i + j) % kBenchVertexCount);
+    }
+    interpreter.ExecuteBatch(batch_count, r0_x_values, batch_sink_pointers);
+  }
+  double batch_seconds =
+      double(Clock::QueryHostTickCount() - start_ticks) / tick_frequency;
+
+  float batch_max_value = 0.0f;
+  for (const BenchExportSink& batch_sink : batch_sinks) {
+    batch_max_value = std::max(batch_max_value, batch_sink.max_value());
+  }
+  XELOGI("Execute {:.2f} M/s, ExecuteBatch {:.2f} M/s (max {} / {})",
+         mega_vertices / std::max(execute_seconds, 1e-9),
+         mega_vertices / std::max(batch_seconds, 1e-9),
+         execute_sink.max_value(), batch_max_value);
+  return 0;
+}
+
+}  // namespace gpu
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-gpu-shader-interpreter-bench",
+                      xe::gpu::shader_interpreter_bench_main, "");
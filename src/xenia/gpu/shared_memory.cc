@@ -13,6 +13,7 @@
 #include "xenia/base/bit_range.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/profiling.h"
+#include "xenia/base/xxhash.h"
 
 namespace xe {
 namespace gpu {
@@ -299,6 +300,18 @@ void SharedMemory::RangeWrittenByGpu(uint32_t start, uint32_t length) {
   MakeRangeValid(start, length, true);
 }
 
+void SharedMemory::PollGuestWrites() {
+  if (memory().physical_write_tracking() == PhysicalWriteTracking::kProtect) {
+    return;
+  }
+  memory().PollPhysicalWrites();
+  Memory::PhysicalWriteStats stats = memory().GetPhysicalWriteStats();
+  COUNT_profile_set("gpu/shared_memory/physical_write_faults",
+                    stats.write_faults);
+  COUNT_profile_set("gpu/shared_memory/physical_write_polled_pages",
+                    stats.polled_pages);
+}
+
 bool SharedMemory::AllocateSparseHostGpuMemoryRange(
     uint32_t offset_allocations, uint32_t length_allocations) {
   assert_always(
@@ -444,6 +457,34 @@ bool SharedMemory::IsRangeValid(uint32_t start, uint32_t length) const {
   return true;
 }
 
+bool SharedMemory::HashRangeContents(uint32_t start, uint32_t length,
+                                     uint64_t& hash_out) const {
+  if (start > kBufferSize || (kBufferSize - start) < length) {
+    return false;
+  }
+  if (length) {
+    const uint32_t page_first = start >> page_size_log2_;
+    const uint32_t page_last = (start + length - 1) >> page_size_log2_;
+    const uint32_t block_first = page_first >> 6;
+    const uint32_t block_last = page_last >> 6;
+    for (uint32_t i = block_first; i <= block_last; ++i) {
+      uint64_t range_mask = UINT64_MAX;
+      if (i == block_first) {
+        range_mask &= ~((uint64_t(1) << (page_first & 63)) - 1);
+      }
+      if (i == block_last && (page_last & 63) != 63) {
+        range_mask &= (uint64_t(1) << ((page_last & 63) + 1)) - 1;
+      }
+      if (system_page_flags_valid_and_gpu_written_[i] & range_mask) {
+        return false;
+      }
+    }
+  }
+  hash_out =
+      XXH3_64bits(memory().TranslatePhysical<const uint8_t*>(start), length);
+  return true;
+}
+
 template <typename T>
 XE_FORCEINLINE XE_NOALIAS static T mod_shift_left(T value, uint32_t by) {
 #if XE_ARCH_AMD64 == 1
@@ -76,6 +76,13 @@ class SharedMemory {
   // memory copy. Hold the global critical region if relying on this for state
   // transitions such as watch installation.
   bool IsRangeValid(uint32_t start, uint32_t length) const;
+  // Hashes the guest memory contents of the range for detecting rewrites of
+  // identical data. Returns false if any page in the range contains data
+  // written by the GPU (such as resolves), which is not in the guest memory.
+  // The hash only describes what has been uploaded if the range is still valid
+  // after the call, which must be checked within the global critical region.
+  bool HashRangeContents(uint32_t start, uint32_t length,
+                         uint64_t& hash_out) const;
 
   void TryFindUploadRange(const uint32_t& block_first,
                           const uint32_t& block_last,
@@ -105,6 +112,13 @@ class SharedMemory {
   // regions in those pages.
   void RangeWrittenByGpu(uint32_t start, uint32_t length);
 
+  // With --physical_write_map or --host_write_tracking, delivers the CPU
+  // writes to watched pages made since the previous poll to the invalidation
+  // callback - must be called before the shared memory or anything watching it
+  // is used for a draw or a resolve. Does nothing when the writes are caught
+  // with access violations instead.
+  void PollGuestWrites();
+
  protected:
   SharedMemory(Memory& memory);
   // Call in implementation-specific initialization.
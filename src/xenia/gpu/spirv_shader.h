@@ -11,6 +11,7 @@
 #define XENIA_GPU_SPIRV_SHADER_H_
 
 #include <atomic>
+#include <mutex>
 #include <vector>
 
 #include "xenia/gpu/shader.h"
@@ -34,7 +35,9 @@ class SpirvShader : public Shader {
 
   // Resource bindings are gathered after the successful translation of any
   // modification for simplicity of translation (and they don't depend on
-  // modification bits).
+  // modification bits). Modifications may be translated on different threads,
+  // but the bindings are published before any successful translation is
+  // completed.
 
   struct TextureBinding {
     uint32_t fetch_constant : 5;
@@ -69,7 +72,10 @@ class SpirvShader : public Shader {
  private:
   friend class SpirvShaderTranslator;
 
-  std::atomic_flag bindings_setup_entered_ = ATOMIC_FLAG_INIT;
+  // Written once by the first translation, other translations completed
+  // meanwhile wait for the bindings to be written.
+  std::mutex bindings_setup_mutex_;
+  std::atomic<bool> bindings_set_up_{false};
   std::vector<TextureBinding> texture_bindings_;
   std::vector<SamplerBinding> sampler_bindings_;
   uint32_t used_texture_mask_ = 0;
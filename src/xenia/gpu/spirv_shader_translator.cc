@@ -851,33 +851,42 @@ void SpirvShaderTranslator::PostTranslation() {
     return;
   }
   SpirvShader* spirv_shader = dynamic_cast<SpirvShader*>(&translation.shader());
-  if (spirv_shader && !spirv_shader->bindings_setup_entered_.test_and_set(
-                          std::memory_order_relaxed)) {
-    spirv_shader->texture_bindings_.clear();
-    spirv_shader->texture_bindings_.reserve(texture_bindings_.size());
-    for (const TextureBinding& translator_binding : texture_bindings_) {
-      SpirvShader::TextureBinding& shader_binding =
-          spirv_shader->texture_bindings_.emplace_back();
-      // For a stable hash.
-      std::memset(&shader_binding, 0, sizeof(shader_binding));
-      shader_binding.fetch_constant = translator_binding.fetch_constant;
-      shader_binding.dimension = translator_binding.dimension;
-      shader_binding.is_signed = translator_binding.is_signed;
-      spirv_shader->used_texture_mask_ |= UINT32_C(1)
-                                          << translator_binding.fetch_constant;
-    }
-    spirv_shader->sampler_bindings_.clear();
-    spirv_shader->sampler_bindings_.reserve(sampler_bindings_.size());
-    for (const SamplerBinding& translator_binding : sampler_bindings_) {
-      SpirvShader::SamplerBinding& shader_binding =
-          spirv_shader->sampler_bindings_.emplace_back();
-      shader_binding.fetch_constant = translator_binding.fetch_constant;
-      shader_binding.mag_filter = translator_binding.mag_filter;
-      shader_binding.min_filter = translator_binding.min_filter;
-      shader_binding.mip_filter = translator_binding.mip_filter;
-      shader_binding.aniso_filter = translator_binding.aniso_filter;
-    }
+  if (!spirv_shader ||
+      spirv_shader->bindings_set_up_.load(std::memory_order_acquire)) {
+    return;
+  }
+  // Another modification may be translated on a different thread - if it's
+  // writing the bindings, wait for them before completing this translation.
+  std::lock_guard<std::mutex> bindings_setup_lock(
+      spirv_shader->bindings_setup_mutex_);
+  if (spirv_shader->bindings_set_up_.load(std::memory_order_relaxed)) {
+    return;
   }
+  spirv_shader->texture_bindings_.clear();
+  spirv_shader->texture_bindings_.reserve(texture_bindings_.size());
+  for (const TextureBinding& translator_binding : texture_bindings_) {
+    SpirvShader::TextureBinding& shader_binding =
+        spirv_shader->texture_bindings_.emplace_back();
+    // For a stable hash.
+    std::memset(&shader_binding, 0, sizeof(shader_binding));
+    shader_binding.fetch_constant = translator_binding.fetch_constant;
+    shader_binding.dimension = translator_binding.dimension;
+    shader_binding.is_signed = translator_binding.is_signed;
+    spirv_shader->used_texture_mask_ |= UINT32_C(1)
+                                        << translator_binding.fetch_constant;
+  }
+  spirv_shader->sampler_bindings_.clear();
+  spirv_shader->sampler_bindings_.reserve(sampler_bindings_.size());
+  for (const SamplerBinding& translator_binding : sampler_bindings_) {
+    SpirvShader::SamplerBinding& shader_binding =
+        spirv_shader->sampler_bindings_.emplace_back();
+    shader_binding.fetch_constant = translator_binding.fetch_constant;
+    shader_binding.mag_filter = translator_binding.mag_filter;
+    shader_binding.min_filter = translator_binding.min_filter;
+    shader_binding.mip_filter = translator_binding.mip_filter;
+    shader_binding.aniso_filter = translator_binding.aniso_filter;
+  }
+  spirv_shader->bindings_set_up_.store(true, std::memory_order_release);
 }
 
 void SpirvShaderTranslator::ProcessLabel(uint32_t cf_index) {
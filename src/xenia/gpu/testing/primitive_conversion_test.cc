@@ -0,0 +1,374 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/primitive_conversion.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "xenia/gpu/xenos.h"
+
+namespace xe {
+namespace gpu {
+namespace test {
+
+using primitive_conversion::IndexTransform;
+using primitive_conversion::Isa;
+
+// Around the 128-bit and 256-bit vector sizes and the gather block sizes, with
+// odd tails.
+constexpr uint32_t kTestIndexCounts[] = {
+    0,  1,  2,  3,  4,  5,  7,  8,  9,  11,  15,  16,  17,  23,  24,  25,
+    31, 32, 33, 47, 48, 49, 63, 64, 65, 95, 97, 127, 128, 129, 255, 1021};
+// Indices written past the end of the expected output are detected in this
+// many indices after it.
+constexpr uint32_t kTestGuardIndexCount = 16;
+
+constexpr xenos::Endian kTestEndians[] = {
+    xenos::Endian::kNone, xenos::Endian::k8in16, xenos::Endian::k8in32,
+    xenos::Endian::k16in32};
+constexpr IndexTransform kTestIndexTransforms[] = {
+    IndexTransform::kPassthrough, IndexTransform::kTo24NonSwapping,
+    IndexTransform::kTo24Swapping8In16, IndexTransform::kTo24Swapping8In32,
+    IndexTransform::kTo24Swapping16In32};
+
+// Indices starting at an offset (in indices) from a 32-byte boundary, followed
+// by guard indices, initially filled with a pattern not produced by any of the
+// conversions.
+template <typename Index>
+class TestIndexBuffer {
+ public:
+  // Offsets covering every misalignment relative to the largest vector.
+  static constexpr uint32_t kOffsetCount = 32 / sizeof(Index);
+
+  TestIndexBuffer(uint32_t count, uint32_t offset)
+      : chunks_(((offset + count + kTestGuardIndexCount) * sizeof(Index) +
+                 sizeof(Chunk) - 1) /
+                sizeof(Chunk)),
+        offset_(offset),
+        count_(count) {
+    std::memset(chunks_.data(), 0xCD, sizeof(Chunk) * chunks_.size());
+  }
+
+  Index* data() { return reinterpret_cast<Index*>(chunks_.data()) + offset_; }
+  const Index* data() const {
+    return reinterpret_cast<const Index*>(chunks_.data()) + offset_;
+  }
+  uint32_t count() const { return count_; }
+  Index& operator[](uint32_t index) { return data()[index]; }
+
+  // Including the guard.
+  std::vector<Index> GetContents() const {
+    return std::vector<Index>(data(), data() + count_ + kTestGuardIndexCount);
+  }
+
+ private:
+  struct alignas(32) Chunk {
+    uint8_t bytes[32];
+  };
+  std::vector<Chunk> chunks_;
+  uint32_t offset_;
+  uint32_t count_;
+};
+
+// How the reset index is placed in the source indices.
+enum class ResetPlacement : uint32_t {
+  kNone,
+  kFirst,
+  kMiddle,
+  kLast,
+  kRandom,
+
+  kCount,
+};
+
+// Random indices, with the reset index and 0xFFFF (which is special for 16-bit
+// indices) only where requested. The reset index is compared after masking
+// with reset_mask.
+template <typename Index>
+void RandomizeIndices(TestIndexBuffer<Index>& indices, std::mt19937& random,
+                      Index reset_index, Index reset_mask,
+                      ResetPlacement reset_placement) {
+  uint32_t count = indices.count();
+  for (uint32_t i = 0; i < count; ++i) {
+    Index index = Index(random());
+    if (reset_placement == ResetPlacement::kRandom && !(random() & 7)) {
+      index = reset_index | (index & ~reset_mask);
+    } else if ((index & reset_mask) == reset_index) {
+      index ^= Index(1);
+    }
+    if (!(random() & 15)) {
+      index = Index(UINT32_MAX);
+      if (reset_placement != ResetPlacement::kRandom &&
+          (index & reset_mask) == reset_index) {
+        index ^= Index(1);
+      }
+    }
+    indices[i] = index;
+  }
+  if (!count) {
+    return;
+  }
+  switch (reset_placement) {
+    case ResetPlacement::kFirst:
+      indices[0] = reset_index;
+      break;
+    case ResetPlacement::kMiddle:
+      indices[count / 2] = reset_index;
+      break;
+    case ResetPlacement::kLast:
+      indices[count - 1] = reset_index;
+      break;
+    default:
+      break;
+  }
+}
+
+// Calls the function for every supported SIMD instruction set with the
+// information about it added to the failure messages.
+template <typename Function>
+void ForEachSimdIsa(Function function) {
+  for (uint32_t i = uint32_t(Isa::kScalar) + 1; i < uint32_t(Isa::kCount);
+       ++i) {
+    if (!primitive_conversion::IsIsaSupported(Isa(i))) {
+      continue;
+    }
+    INFO("ISA " << primitive_conversion::GetIsaName(Isa(i)));
+    function(Isa(i));
+  }
+}
+
+// Writes the output of a conversion to a buffer at the offset, and returns the
+// whole output including the guard.
+template <typename DestIndex, typename Function>
+std::vector<DestIndex> Convert(uint32_t dest_count, uint32_t dest_offset,
+                               Function function) {
+  TestIndexBuffer<DestIndex> dest(dest_count, dest_offset);
+  function(dest.data());
+  return dest.GetContents();
+}
+
+TEST_CASE("primitive_conversion_reset_16_isa_consistency",
+          "[primitive_conversion]") {
+  std::mt19937 random(1);
+  for (uint16_t reset_index : {uint16_t(0xFFFF), uint16_t(0x3412)}) {
+    for (uint32_t count : kTestIndexCounts) {
+      for (uint32_t offset = 0;
+           offset < TestIndexBuffer<uint16_t>::kOffsetCount; ++offset) {
+        for (uint32_t placement = 0;
+             placement < uint32_t(ResetPlacement::kCount); ++placement) {
+          INFO("Reset index " << reset_index << ", " << count
+                              << " indices at offset " << offset
+                              << ", reset placement " << placement);
+          TestIndexBuffer<uint16_t> source(count, offset);
+          RandomizeIndices(source, random, reset_index, uint16_t(0xFFFF),
+                           ResetPlacement(placement));
+          bool reference_reset_used = primitive_conversion::IsResetUsed(
+              source.data(), count, reset_index, Isa::kScalar);
+          bool reference_usage_reset, reference_usage_ffff;
+          primitive_conversion::Get16BitResetIndexUsage(
+              source.data(), count, reset_index, reference_usage_reset,
+              reference_usage_ffff, Isa::kScalar);
+          REQUIRE(reference_usage_reset == reference_reset_used);
+          // The destination is co-aligned with the source in practice, but
+          // any alignment must work.
+          for (uint32_t dest_offset : {offset, offset + 1}) {
+            INFO("Destination offset " << dest_offset);
+            std::vector<uint16_t> reference_16 =
+                Convert<uint16_t>(count, dest_offset, [&](uint16_t* dest) {
+                  primitive_conversion::ReplaceResetIndex16To16(
+                      dest, source.data(), count, reset_index, Isa::kScalar);
+                });
+            std::vector<uint32_t> reference_24 =
+                Convert<uint32_t>(count, dest_offset, [&](uint32_t* dest) {
+                  primitive_conversion::ReplaceResetIndex16To24(
+                      dest, source.data(), count, reset_index, Isa::kScalar);
+                });
+            ForEachSimdIsa([&](Isa isa) {
+              REQUIRE(primitive_conversion::IsResetUsed(
+                          source.data(), count, reset_index, isa) ==
+                      reference_reset_used);
+              bool usage_reset, usage_ffff;
+              primitive_conversion::Get16BitResetIndexUsage(
+                  source.data(), count, reset_index, usage_reset, usage_ffff,
+                  isa);
+              REQUIRE(usage_reset == reference_usage_reset);
+              REQUIRE(usage_ffff == reference_usage_ffff);
+              REQUIRE(Convert<uint16_t>(
+                          count, dest_offset, [&](uint16_t* dest) {
+                            primitive_conversion::ReplaceResetIndex16To16(
+                                dest, source.data(), count, reset_index, isa);
+                          }) == reference_16);
+              REQUIRE(Convert<uint32_t>(
+                          count, dest_offset, [&](uint32_t* dest) {
+                            primitive_conversion::ReplaceResetIndex16To24(
+                                dest, source.data(), count, reset_index, isa);
+                          }) == reference_24);
+            });
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("primitive_conversion_reset_32_isa_consistency",
+          "[primitive_conversion]") {
+  std::mt19937 random(2);
+  for (xenos::Endian guest_endian : kTestEndians) {
+    uint32_t reset_index = xenos::GpuSwap(uint32_t(0x00563412), guest_endian);
+    uint32_t low_bits_mask =
+        xenos::GpuSwap(xenos::kVertexIndexMask, guest_endian);
+    for (uint32_t count : kTestIndexCounts) {
+      for (uint32_t offset = 0;
+           offset < TestIndexBuffer<uint32_t>::kOffsetCount; ++offset) {
+        for (uint32_t placement = 0;
+             placement < uint32_t(ResetPlacement::kCount); ++placement) {
+          INFO("Guest endian " << uint32_t(guest_endian) << ", " << count
+                               << " indices at offset " << offset
+                               << ", reset placement " << placement);
+          TestIndexBuffer<uint32_t> source(count, offset);
+          RandomizeIndices(source, random, reset_index, low_bits_mask,
+                           ResetPlacement(placement));
+          bool reference_reset_used = primitive_conversion::IsResetUsed(
+              source.data(), count, reset_index, low_bits_mask, Isa::kScalar);
+          ForEachSimdIsa([&](Isa isa) {
+            REQUIRE(primitive_conversion::IsResetUsed(source.data(), count,
+                                                      reset_index,
+                                                      low_bits_mask, isa) ==
+                    reference_reset_used);
+          });
+          for (xenos::Endian host_swap : kTestEndians) {
+            for (uint32_t dest_offset : {offset, offset + 1}) {
+              INFO("Host swap " << uint32_t(host_swap)
+                                << ", destination offset " << dest_offset);
+              std::vector<uint32_t> reference =
+                  Convert<uint32_t>(count, dest_offset, [&](uint32_t* dest) {
+                    primitive_conversion::ReplaceResetIndex32To24(
+                        dest, source.data(), count, reset_index,
+                        low_bits_mask, host_swap, Isa::kScalar);
+                  });
+              ForEachSimdIsa([&](Isa isa) {
+                REQUIRE(Convert<uint32_t>(
+                            count, dest_offset, [&](uint32_t* dest) {
+                              primitive_conversion::ReplaceResetIndex32To24(
+                                  dest, source.data(), count, reset_index,
+                                  low_bits_mask, host_swap, isa);
+                            }) == reference);
+              });
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// Converts primitives of every type with the scalar reference and with every
+// SIMD instruction set.
+template <typename Index>
+void TestPrimitiveTypeIsaConsistency(IndexTransform index_transform,
+                                     std::mt19937& random) {
+  for (uint32_t count : kTestIndexCounts) {
+    for (uint32_t offset = 0; offset < TestIndexBuffer<Index>::kOffsetCount;
+         ++offset) {
+      TestIndexBuffer<Index> source(count, offset);
+      for (uint32_t i = 0; i < count; ++i) {
+        source[i] = Index(random());
+      }
+      uint32_t triangle_fan_count = count > 2 ? (count - 2) * 3 : 0;
+      uint32_t line_loop_count = count > 1 ? count + 1 : 0;
+      uint32_t quad_list_count = count / 4 * 6;
+      for (uint32_t dest_offset : {offset, offset + 1}) {
+        INFO("Index transform " << uint32_t(index_transform) << ", " << count
+                                << " indices at offset " << offset
+                                << ", destination offset " << dest_offset);
+        auto convert_triangle_fan = [&](Isa isa) {
+          return Convert<Index>(
+              triangle_fan_count, dest_offset, [&](Index* dest) {
+                primitive_conversion::TriangleFanToList(
+                    dest, source.data(), count, index_transform, isa);
+              });
+        };
+        auto convert_line_loop = [&](Isa isa) {
+          return Convert<Index>(line_loop_count, dest_offset, [&](Index* dest) {
+            primitive_conversion::LineLoopToStrip(dest, source.data(), count,
+                                                  index_transform, isa);
+          });
+        };
+        auto convert_quad_list = [&](Isa isa) {
+          return Convert<Index>(quad_list_count, dest_offset, [&](Index* dest) {
+            primitive_conversion::QuadListToTriangleList(
+                dest, source.data(), count, index_transform, isa);
+          });
+        };
+        std::vector<Index> reference_triangle_fan =
+            convert_triangle_fan(Isa::kScalar);
+        std::vector<Index> reference_line_loop =
+            convert_line_loop(Isa::kScalar);
+        std::vector<Index> reference_quad_list =
+            convert_quad_list(Isa::kScalar);
+        ForEachSimdIsa([&](Isa isa) {
+          REQUIRE(convert_triangle_fan(isa) == reference_triangle_fan);
+          REQUIRE(convert_line_loop(isa) == reference_line_loop);
+          REQUIRE(convert_quad_list(isa) == reference_quad_list);
+        });
+      }
+    }
+  }
+}
+
+TEST_CASE("primitive_conversion_primitive_type_isa_consistency",
+          "[primitive_conversion]") {
+  std::mt19937 random(3);
+  // 16-bit indices are always passed through.
+  TestPrimitiveTypeIsaConsistency<uint16_t>(IndexTransform::kPassthrough,
+                                            random);
+  for (IndexTransform index_transform : kTestIndexTransforms) {
+    TestPrimitiveTypeIsaConsistency<uint32_t>(index_transform, random);
+  }
+}
+
+TEST_CASE("primitive_conversion_primitive_type_order",
+          "[primitive_conversion]") {
+  // 24 bits of big-endian indices 0x10 + i, the upper byte must be dropped.
+  uint32_t source[5];
+  for (uint32_t i = 0; i < 5; ++i) {
+    source[i] = xenos::GpuSwap(0xAB000010 + i, xenos::Endian::k8in32);
+  }
+  for (uint32_t i = 0; i < uint32_t(Isa::kCount); ++i) {
+    if (!primitive_conversion::IsIsaSupported(Isa(i))) {
+      continue;
+    }
+    INFO("ISA " << primitive_conversion::GetIsaName(Isa(i)));
+    uint32_t triangle_fan[9];
+    primitive_conversion::TriangleFanToList(
+        triangle_fan, source, 5, IndexTransform::kTo24Swapping8In32, Isa(i));
+    REQUIRE(std::vector<uint32_t>(triangle_fan, triangle_fan + 9) ==
+            std::vector<uint32_t>{0x11, 0x12, 0x10, 0x12, 0x13, 0x10, 0x13,
+                                  0x14, 0x10});
+    uint32_t line_loop[6];
+    primitive_conversion::LineLoopToStrip(
+        line_loop, source, 5, IndexTransform::kTo24Swapping8In32, Isa(i));
+    REQUIRE(std::vector<uint32_t>(line_loop, line_loop + 6) ==
+            std::vector<uint32_t>{0x10, 0x11, 0x12, 0x13, 0x14, 0x10});
+    uint32_t quad_list[6];
+    primitive_conversion::QuadListToTriangleList(
+        quad_list, source, 5, IndexTransform::kTo24Swapping8In32, Isa(i));
+    REQUIRE(std::vector<uint32_t>(quad_list, quad_list + 6) ==
+            std::vector<uint32_t>{0x10, 0x11, 0x12, 0x10, 0x12, 0x13});
+  }
+}
+
+}  // namespace test
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,169 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/register_write_ranges.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "xenia/base/bit_range.h"
+#include "xenia/base/byte_order.h"
+#include "xenia/gpu/register_file.h"
+#include "xenia/gpu/registers.h"
+
+namespace xe {
+namespace gpu {
+namespace test {
+
+struct RecordingHandler {
+  struct Call {
+    register_write_ranges::RangeType type;
+    uint32_t first_index;
+    uint32_t count;
+
+    bool operator==(const Call& other) const {
+      return type == other.type && first_index == other.first_index &&
+             count == other.count;
+    }
+  };
+
+  void OnSpecialRegisterWritten(uint32_t index, uint32_t value) {
+    calls.push_back({register_write_ranges::RangeType::kSpecial, index, 1});
+  }
+  void OnFloatConstantsWritten(uint32_t first_index, uint32_t count) {
+    calls.push_back({register_write_ranges::RangeType::kFloatConstants,
+                     first_index, count});
+  }
+  void OnFetchConstantsWritten(uint32_t first_index, uint32_t count) {
+    calls.push_back({register_write_ranges::RangeType::kFetchConstants,
+                     first_index, count});
+  }
+  void OnBoolLoopConstantsWritten(uint32_t first_index, uint32_t count) {
+    calls.push_back({register_write_ranges::RangeType::kBoolLoopConstants,
+                     first_index, count});
+  }
+
+  std::vector<Call> calls;
+};
+
+// Writes the register indices themselves, big-endian, as values.
+void WriteIndexValues(RegisterFile& register_file, uint32_t first_index,
+                      uint32_t count, RecordingHandler& handler) {
+  std::vector<uint32_t> source(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    source[i] = xe::byte_swap(first_index + i);
+  }
+  register_write_ranges::WriteRange(register_file.values, first_index,
+                                    source.data(), count, handler);
+}
+
+TEST_CASE("Register write ranges cover the register file",
+          "[register_write_ranges]") {
+  uint32_t previous_end = 0;
+  for (const register_write_ranges::Range& range :
+       register_write_ranges::kRanges) {
+    REQUIRE(range.end > previous_end);
+    previous_end = range.end;
+  }
+  REQUIRE(previous_end == RegisterFile::kRegisterCount);
+  REQUIRE(register_write_ranges::GetRange(XE_GPU_REG_SCRATCH_REG0).type ==
+          register_write_ranges::RangeType::kSpecial);
+  REQUIRE(register_write_ranges::GetRange(XE_GPU_REG_SCRATCH_REG7 + 1).type ==
+          register_write_ranges::RangeType::kPlain);
+  REQUIRE(register_write_ranges::GetRange(XE_GPU_REG_SHADER_CONSTANT_511_W)
+              .type == register_write_ranges::RangeType::kFloatConstants);
+  REQUIRE(register_write_ranges::GetRange(XE_GPU_REG_SHADER_CONSTANT_LOOP_31)
+              .type == register_write_ranges::RangeType::kBoolLoopConstants);
+}
+
+TEST_CASE("Register write ranges split runs", "[register_write_ranges]") {
+  auto register_file = std::make_unique<RegisterFile>();
+  std::memset(register_file->values, 0, sizeof(register_file->values));
+
+  SECTION("Plain registers") {
+    RecordingHandler handler;
+    WriteIndexValues(*register_file, XE_GPU_REG_RB_COLOR_INFO, 16, handler);
+    REQUIRE(handler.calls.empty());
+    for (uint32_t i = 0; i < 16; ++i) {
+      REQUIRE(register_file->values[XE_GPU_REG_RB_COLOR_INFO + i] ==
+              XE_GPU_REG_RB_COLOR_INFO + i);
+    }
+  }
+
+  SECTION("Special registers") {
+    RecordingHandler handler;
+    uint32_t first_index = XE_GPU_REG_SCRATCH_REG0 - 2;
+    WriteIndexValues(*register_file, first_index, 12, handler);
+    REQUIRE(handler.calls.size() == 8);
+    for (uint32_t i = 0; i < 8; ++i) {
+      RecordingHandler::Call expected_call = {
+          register_write_ranges::RangeType::kSpecial,
+          XE_GPU_REG_SCRATCH_REG0 + i, 1};
+      REQUIRE(handler.calls[i] == expected_call);
+    }
+    for (uint32_t i = 0; i < 12; ++i) {
+      REQUIRE(register_file->values[first_index + i] == first_index + i);
+    }
+  }
+
+  SECTION("Constants") {
+    RecordingHandler handler;
+    // The last float constant, all fetch constants and the bool constants.
+    uint32_t first_index = XE_GPU_REG_SHADER_CONSTANT_511_X;
+    uint32_t count = XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 + 8 - first_index;
+    WriteIndexValues(*register_file, first_index, count, handler);
+    std::vector<RecordingHandler::Call> expected_calls = {
+        {register_write_ranges::RangeType::kFloatConstants, first_index, 4},
+        {register_write_ranges::RangeType::kFetchConstants,
+         XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0, 6 * 32},
+        {register_write_ranges::RangeType::kBoolLoopConstants,
+         XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031, 8},
+    };
+    REQUIRE(handler.calls == expected_calls);
+    for (uint32_t i = 0; i < count; ++i) {
+      REQUIRE(register_file->values[first_index + i] == first_index + i);
+    }
+    uint32_t first_fetch_constant, last_fetch_constant;
+    register_write_ranges::GetFetchConstantRange(
+        XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0 + 5, 2, first_fetch_constant,
+        last_fetch_constant);
+    REQUIRE(first_fetch_constant == 0);
+    REQUIRE(last_fetch_constant == 1);
+  }
+
+  SECTION("Beyond the register file") {
+    RecordingHandler handler;
+    uint32_t first_index = RegisterFile::kRegisterCount - 2;
+    WriteIndexValues(*register_file, first_index, 4, handler);
+    REQUIRE(register_file->values[first_index] == first_index);
+    REQUIRE(register_file->values[first_index + 1] == first_index + 1);
+  }
+}
+
+TEST_CASE("Bit range any set", "[register_write_ranges]") {
+  uint64_t bits[4] = {};
+  REQUIRE(!bit_range::IsAnySet(bits, 0, 256));
+  bits[1] = UINT64_C(1) << 10;
+  REQUIRE(bit_range::IsAnySet(bits, 0, 256));
+  REQUIRE(bit_range::IsAnySet(bits, 74, 1));
+  REQUIRE(!bit_range::IsAnySet(bits, 75, 181));
+  REQUIRE(!bit_range::IsAnySet(bits, 0, 74));
+  REQUIRE(bit_range::IsAnySet(bits, 10, 65));
+  REQUIRE(!bit_range::IsAnySet(bits, 74, 0));
+  bits[3] = UINT64_C(1) << 63;
+  REQUIRE(bit_range::IsAnySet(bits, 200, 56));
+  REQUIRE(!bit_range::IsAnySet(bits, 75, 180));
+}
+
+}  // namespace test
+}  // namespace gpu
+}  // namespace xe
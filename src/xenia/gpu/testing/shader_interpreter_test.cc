@@ -0,0 +1,634 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/shader_interpreter.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+#include <bit>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "xenia/base/math.h"
+#include "xenia/base/string_buffer.h"
+#include "xenia/gpu/register_file.h"
+#include "xenia/gpu/shader.h"
+#include "xenia/gpu/ucode.h"
+#include "xenia/gpu/xenos.h"
+#include "xenia/memory.h"
+
+namespace xe {
+namespace gpu {
+namespace test {
+
+// Vertex data is placed at the beginning of the physical memory.
+constexpr uint32_t kTestVertexDataSizeDwords = 16384;
+constexpr uint32_t kTestVertexFetchConstantCount = 3;
+
+// Records everything exported by an invocation bit by bit.
+class RecordingExportSink : public ShaderInterpreter::ExportSink {
+ public:
+  void AllocExport(ucode::AllocType type, uint32_t size) override {
+    records_.push_back(UINT32_MAX);
+    records_.push_back(uint32_t(type));
+    records_.push_back(size);
+  }
+  void Export(ucode::ExportRegister export_register, const float* value,
+              uint32_t value_mask) override {
+    records_.push_back(uint32_t(export_register));
+    records_.push_back(value_mask);
+    for (uint32_t i = 0; i < 4; ++i) {
+      records_.push_back(std::bit_cast<uint32_t>(value[i]));
+    }
+  }
+
+  const std::vector<uint32_t>& records() const { return records_; }
+
+ private:
+  std::vector<uint32_t> records_;
+};
+
+// Builds ucode from control flow instructions and ALU / fetch instructions with
+// exec addresses relative to the first ALU / fetch instruction.
+class TestShaderBuilder {
+ public:
+  uint32_t cf_count() const { return uint32_t(cf_.size()); }
+
+  uint32_t AddExec(ucode::ControlFlowOpcode opcode, uint32_t sequence,
+                   uint32_t bool_address = 0, bool condition = false) {
+    return AddControlFlow(
+        uint32_t(instructions_.size() / 3) | (sequence << 16),
+        (bool_address << 2) | (uint32_t(condition) << 10) |
+            (uint32_t(opcode) << 12));
+  }
+  // Must be called after AddExec for the instructions of the exec.
+  void AddInstruction(const uint32_t* dwords) {
+    instructions_.insert(instructions_.end(), dwords, dwords + 3);
+    cf_.back().dword_0 += UINT32_C(1) << 12;
+  }
+  uint32_t AddJump(ucode::ControlFlowOpcode opcode, uint32_t address,
+                   bool is_unconditional, bool is_predicated,
+                   uint32_t bool_address, bool condition) {
+    return AddControlFlow(address | (uint32_t(is_unconditional) << 13) |
+                              (uint32_t(is_predicated) << 14),
+                          (bool_address << 2) | (uint32_t(condition) << 10) |
+                              (uint32_t(opcode) << 12));
+  }
+  void SetJumpAddress(uint32_t cf_index, uint32_t address) {
+    cf_[cf_index].dword_0 = (cf_[cf_index].dword_0 & ~UINT32_C(0x1FFF)) |
+                            address;
+  }
+  uint32_t AddAlloc(ucode::AllocType type, uint32_t size) {
+    return AddControlFlow(
+        size, (uint32_t(type) << 9) |
+                  (uint32_t(ucode::ControlFlowOpcode::kAlloc) << 12));
+  }
+  uint32_t AddReturn() {
+    return AddControlFlow(
+        0, uint32_t(ucode::ControlFlowOpcode::kReturn) << 12);
+  }
+
+  std::unique_ptr<Shader> Build(uint64_t hash) const {
+    uint32_t cf_pair_count = (uint32_t(cf_.size()) + 1) / 2;
+    std::vector<uint32_t> ucode(3 * cf_pair_count);
+    for (uint32_t i = 0; i < cf_pair_count; ++i) {
+      ucode::ControlFlowInstruction cf_ab[2] = {};
+      for (uint32_t j = 0; j < 2 && 2 * i + j < cf_.size(); ++j) {
+        cf_ab[j].dword_0 = cf_[2 * i + j].dword_0;
+        cf_ab[j].dword_1 = cf_[2 * i + j].dword_1;
+        if (ucode::IsControlFlowOpcodeExec(cf_ab[j].opcode())) {
+          // Make the exec address absolute.
+          cf_ab[j].dword_0 += cf_pair_count;
+        }
+      }
+      ucode[3 * i] = cf_ab[0].dword_0;
+      ucode[3 * i + 1] = (cf_ab[0].dword_1 & 0xFFFF) | (cf_ab[1].dword_0 << 16);
+      ucode[3 * i + 2] = (cf_ab[1].dword_0 >> 16) | (cf_ab[1].dword_1 << 16);
+    }
+    ucode.insert(ucode.end(), instructions_.begin(), instructions_.end());
+    auto shader =
+        std::make_unique<Shader>(xenos::ShaderType::kVertex, hash, ucode.data(),
+                                 ucode.size(), std::endian::native);
+    StringBuffer ucode_disasm_buffer;
+    shader->AnalyzeUcode(ucode_disasm_buffer);
+    return shader;
+  }
+
+ private:
+  struct ControlFlow {
+    uint32_t dword_0;
+    uint32_t dword_1;
+  };
+
+  uint32_t AddControlFlow(uint32_t dword_0, uint32_t dword_1) {
+    cf_.push_back({dword_0, dword_1});
+    return uint32_t(cf_.size() - 1);
+  }
+
+  std::vector<ControlFlow> cf_;
+  std::vector<uint32_t> instructions_;
+};
+
+struct TestAlu {
+  ucode::AluVectorOpcode vector_opcode = ucode::AluVectorOpcode::kMax;
+  ucode::AluScalarOpcode scalar_opcode = ucode::AluScalarOpcode::kRetainPrev;
+  uint32_t vector_dest = 0;
+  uint32_t scalar_dest = 0;
+  uint32_t vector_write_mask = 0;
+  uint32_t scalar_write_mask = 0;
+  bool is_export = false;
+  bool scalar_dest_relative = false;
+  bool vector_clamp = false;
+  bool scalar_clamp = false;
+  bool abs_constants = false;
+  // 1-based like in ucode::AluInstruction.
+  uint32_t src_reg[4] = {};
+  bool src_is_temp[4] = {};
+  uint32_t src_swizzle[4] = {};
+  bool src_negate[4] = {};
+  bool is_predicated = false;
+  bool predicate_condition = false;
+  bool const_address_register_relative = false;
+  bool const_0_addressed = false;
+  bool const_1_addressed = false;
+
+  void Encode(uint32_t* dwords) const {
+    dwords[0] = vector_dest | (uint32_t(abs_constants) << 7) |
+                (scalar_dest << 8) | (uint32_t(scalar_dest_relative) << 14) |
+                (uint32_t(is_export) << 15) | (vector_write_mask << 16) |
+                (scalar_write_mask << 20) | (uint32_t(vector_clamp) << 24) |
+                (uint32_t(scalar_clamp) << 25) |
+                (uint32_t(scalar_opcode) << 26);
+    dwords[1] = src_swizzle[3] | (src_swizzle[2] << 8) |
+                (src_swizzle[1] << 16) | (uint32_t(src_negate[3]) << 24) |
+                (uint32_t(src_negate[2]) << 25) |
+                (uint32_t(src_negate[1]) << 26) |
+                (uint32_t(predicate_condition) << 27) |
+                (uint32_t(is_predicated) << 28) |
+                (uint32_t(const_address_register_relative) << 29) |
+                (uint32_t(const_1_addressed) << 30) |
+                (uint32_t(const_0_addressed) << 31);
+    dwords[2] = src_reg[3] | (src_reg[2] << 8) | (src_reg[1] << 16) |
+                (uint32_t(vector_opcode) << 24) |
+                (uint32_t(src_is_temp[3]) << 29) |
+                (uint32_t(src_is_temp[2]) << 30) |
+                (uint32_t(src_is_temp[1]) << 31);
+  }
+};
+
+struct TestVertexFetch {
+  uint32_t src_component = 0;
+  uint32_t dest = 0;
+  uint32_t const_index_sel = 0;
+  uint32_t dest_swizzle = 0;
+  bool is_signed = false;
+  bool is_normalized = false;
+  bool signed_rf_no_zero = false;
+  bool is_index_rounded = false;
+  xenos::VertexFormat format = xenos::VertexFormat::k_32_32_32_32_FLOAT;
+  int32_t exp_adjust = 0;
+  bool is_mini_fetch = false;
+  bool is_predicated = false;
+  bool predicate_condition = false;
+  uint32_t stride = 0;
+  int32_t offset = 0;
+
+  // Always from r0 and from vf0...2.
+  void Encode(uint32_t* dwords) const {
+    dwords[0] = (dest << 12) | (UINT32_C(1) << 19) | (const_index_sel << 25) |
+                (src_component << 30);
+    dwords[1] = dest_swizzle | (uint32_t(is_signed) << 12) |
+                (uint32_t(!is_normalized) << 13) |
+                (uint32_t(signed_rf_no_zero) << 14) |
+                (uint32_t(is_index_rounded) << 15) |
+                (uint32_t(format) << 16) |
+                ((uint32_t(exp_adjust) & 0x3F) << 24) |
+                (uint32_t(is_mini_fetch) << 30) |
+                (uint32_t(is_predicated) << 31);
+    dwords[2] = stride | ((uint32_t(offset) & 0x7FFFFF) << 8) |
+                (uint32_t(predicate_condition) << 31);
+  }
+};
+
+class ShaderInterpreterTestContext {
+ public:
+  ShaderInterpreterTestContext()
+      : register_file_(std::make_unique<RegisterFile>()),
+        memory_(std::make_unique<Memory>()) {
+    REQUIRE(memory_->Initialize());
+    REQUIRE(memory_->LookupHeap(0xA0000000)
+                ->AllocFixed(0xA0000000, sizeof(uint32_t) *
+                                             kTestVertexDataSizeDwords,
+                             0, kMemoryAllocationReserve |
+                                    kMemoryAllocationCommit,
+                             kMemoryProtectRead | kMemoryProtectWrite));
+    interpreter_ =
+        std::make_unique<ShaderInterpreter>(*register_file_, *memory_);
+  }
+
+  RegisterFile& register_file() { return *register_file_; }
+  uint32_t* vertex_data() {
+    return memory_->TranslatePhysical<uint32_t*>(0);
+  }
+  ShaderInterpreter& interpreter() { return *interpreter_; }
+
+  void SetVertexFetchConstant(uint32_t index, uint32_t address_dwords,
+                              uint32_t size_dwords, xenos::Endian endian) {
+    xenos::xe_gpu_vertex_fetch_t fetch = {};
+    fetch.type = xenos::FetchConstantType::kVertex;
+    fetch.address = address_dwords;
+    fetch.endian = endian;
+    fetch.size = size_dwords;
+    std::memcpy(&(*register_file_)[XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0 +
+                                   2 * index],
+                &fetch, sizeof(fetch));
+  }
+
+  // Executes the invocations with Execute and with ExecuteBatch, and checks if
+  // the exports are the same.
+  void CheckBatchMatchesExecute(const Shader& shader, uint32_t count,
+                                const float* r0_x_values) {
+    ShaderInterpreter& interpreter = *interpreter_;
+    interpreter.SetShader(shader);
+    float temp_registers[xenos::kMaxShaderTempRegisters][4];
+    std::memcpy(temp_registers, interpreter.temp_registers(),
+                sizeof(temp_registers));
+
+    RecordingExportSink execute_sinks[ShaderInterpreter::kBatchSize];
+    for (uint32_t i = 0; i < count; ++i) {
+      std::memcpy(interpreter.temp_registers(), temp_registers,
+                  sizeof(temp_registers));
+      interpreter.temp_registers()[0] = r0_x_values[i];
+      interpreter.SetExportSink(&execute_sinks[i]);
+      interpreter.Execute();
+    }
+    interpreter.SetExportSink(nullptr);
+    std::memcpy(interpreter.temp_registers(), temp_registers,
+                sizeof(temp_registers));
+
+    RecordingExportSink batch_sinks[ShaderInterpreter::kBatchSize];
+    ShaderInterpreter::ExportSink* batch_sink_pointers[ShaderInterpreter::
+                                                           kBatchSize];
+    for (uint32_t i = 0; i < ShaderInterpreter::kBatchSize; ++i) {
+      batch_sink_pointers[i] = &batch_sinks[i];
+    }
+    interpreter.ExecuteBatch(count, r0_x_values, batch_sink_pointers);
+
+    REQUIRE(std::memcmp(interpreter.temp_registers(), temp_registers,
+                        sizeof(temp_registers)) == 0);
+    REQUIRE(interpreter.GetExportSink() == nullptr);
+    for (uint32_t i = 0; i < count; ++i) {
+      REQUIRE(batch_sinks[i].records() == execute_sinks[i].records());
+    }
+  }
+
+ private:
+  std::unique_ptr<RegisterFile> register_file_;
+  std::unique_ptr<Memory> memory_;
+  std::unique_ptr<ShaderInterpreter> interpreter_;
+};
+
+TEST_CASE("ShaderInterpreter batch transform", "[shader_interpreter]") {
+  ShaderInterpreterTestContext context;
+  RegisterFile& regs = context.register_file();
+  regs[XE_GPU_REG_SQ_VS_CONST] = 255 << 12;
+  // c0...c3 - translation by (1, 2, 3) with the rows as dot product operands.
+  const float matrix[4][4] = {
+      {1.0f, 0.0f, 0.0f, 1.0f},
+      {0.0f, 1.0f, 0.0f, 2.0f},
+      {0.0f, 0.0f, 1.0f, 3.0f},
+      {0.0f, 0.0f, 0.0f, 1.0f},
+  };
+  std::memcpy(&regs[XE_GPU_REG_SHADER_CONSTANT_000_X], matrix,
+              sizeof(matrix));
+  // float3 positions, with W set to 1 by the fetch.
+  uint32_t* vertex_data = context.vertex_data();
+  for (uint32_t i = 0; i < 3 * 16; ++i) {
+    vertex_data[i] = std::bit_cast<uint32_t>(float(i));
+  }
+  context.SetVertexFetchConstant(0, 0, 3 * 16, xenos::Endian::kNone);
+
+  TestShaderBuilder builder;
+  builder.AddAlloc(ucode::AllocType::kVsPosition, 0);
+  builder.AddExec(ucode::ControlFlowOpcode::kExecEnd, 0b01);
+  TestVertexFetch vfetch;
+  vfetch.dest = 1;
+  // xyz1.
+  vfetch.dest_swizzle = 0 | (1 << 3) | (2 << 6) | (5 << 9);
+  vfetch.format = xenos::VertexFormat::k_32_32_32_FLOAT;
+  vfetch.stride = 3;
+  uint32_t dwords[3];
+  vfetch.Encode(dwords);
+  builder.AddInstruction(dwords);
+  for (uint32_t i = 0; i < 4; ++i) {
+    TestAlu dp4;
+    dp4.vector_opcode = ucode::AluVectorOpcode::kDp4;
+    dp4.vector_dest = uint32_t(ucode::ExportRegister::kVSPosition);
+    dp4.vector_write_mask = UINT32_C(1) << i;
+    dp4.is_export = true;
+    dp4.src_reg[1] = i;
+    dp4.src_reg[2] = 1;
+    dp4.src_is_temp[2] = true;
+    dp4.Encode(dwords);
+    builder.AddInstruction(dwords);
+  }
+  std::unique_ptr<Shader> shader = builder.Build(1);
+  REQUIRE(ShaderInterpreter::CanInterpretShader(*shader));
+
+  const float r0_x_values[ShaderInterpreter::kBatchSize] = {0.0f, 1.0f, 2.0f,
+                                                            3.0f, 4.0f, 5.0f,
+                                                            6.0f, 7.0f};
+  RecordingExportSink sinks[ShaderInterpreter::kBatchSize];
+  ShaderInterpreter::ExportSink* sink_pointers[ShaderInterpreter::kBatchSize];
+  for (uint32_t i = 0; i < ShaderInterpreter::kBatchSize; ++i) {
+    sink_pointers[i] = &sinks[i];
+  }
+  ShaderInterpreter& interpreter = context.interpreter();
+  interpreter.SetShader(*shader);
+  interpreter.ExecuteBatch(ShaderInterpreter::kBatchSize, r0_x_values,
+                           sink_pointers);
+  for (uint32_t i = 0; i < ShaderInterpreter::kBatchSize; ++i) {
+    const std::vector<uint32_t>& records = sinks[i].records();
+    // The allocation and 4 single-component exports.
+    REQUIRE(records.size() == 3 + 4 * 6);
+    REQUIRE(records[0] == UINT32_MAX);
+    for (uint32_t j = 0; j < 4; ++j) {
+      const uint32_t* position_export = records.data() + 3 + 6 * j;
+      REQUIRE(position_export[0] ==
+              uint32_t(ucode::ExportRegister::kVSPosition));
+      REQUIRE(position_export[1] == UINT32_C(1) << j);
+      float expected = j < 3 ? float(3 * i + j) + float(j + 1) : 1.0f;
+      REQUIRE(std::bit_cast<float>(position_export[2 + j]) == expected);
+    }
+  }
+
+  context.CheckBatchMatchesExecute(*shader, ShaderInterpreter::kBatchSize,
+                                   r0_x_values);
+}
+
+TEST_CASE("ShaderInterpreter batch random programs", "[shader_interpreter]") {
+  ShaderInterpreterTestContext context;
+  RegisterFile& regs = context.register_file();
+  std::mt19937 random_engine(0x3A7E);
+  auto random = [&random_engine](uint32_t bound) {
+    return uint32_t(random_engine() % bound);
+  };
+
+  // Values including zeros, denormals, infinities and NaNs.
+  auto random_float = [&]() {
+    switch (random(8)) {
+      case 0:
+        return 0.0f;
+      case 1:
+        return -0.0f;
+      case 2:
+        return 1.0f;
+      case 3:
+        return std::bit_cast<float>(uint32_t(random_engine()));
+      case 4:
+        return std::bit_cast<float>(uint32_t(random_engine()) & 0x807FFFFF);
+      default:
+        return (float(random(2001)) - 1000.0f) / float(1 + random(16));
+    }
+  };
+
+  // Relative constant addressing with a0 only, as aL is 0 outside loops, and
+  // Execute asserts it's used only in loops.
+  regs[XE_GPU_REG_SQ_VS_CONST] = 255 << 12;
+  uint32_t* vertex_data = context.vertex_data();
+  for (uint32_t i = 0; i < kTestVertexDataSizeDwords; ++i) {
+    vertex_data[i] = random(4) ? std::bit_cast<uint32_t>(random_float())
+                               : uint32_t(random_engine());
+  }
+  static const xenos::VertexFormat kVertexFormats[] = {
+      xenos::VertexFormat::k_8_8_8_8,
+      xenos::VertexFormat::k_2_10_10_10,
+      xenos::VertexFormat::k_10_11_11,
+      xenos::VertexFormat::k_11_11_10,
+      xenos::VertexFormat::k_16_16,
+      xenos::VertexFormat::k_16_16_16_16,
+      xenos::VertexFormat::k_16_16_FLOAT,
+      xenos::VertexFormat::k_16_16_16_16_FLOAT,
+      xenos::VertexFormat::k_32,
+      xenos::VertexFormat::k_32_32,
+      xenos::VertexFormat::k_32_32_32_32,
+      xenos::VertexFormat::k_32_FLOAT,
+      xenos::VertexFormat::k_32_32_FLOAT,
+      xenos::VertexFormat::k_32_32_32_32_FLOAT,
+      xenos::VertexFormat::k_32_32_32_FLOAT,
+  };
+
+  // Registers other than r0 (the vertex index) used by the programs.
+  constexpr uint32_t kTempCount = 8;
+  auto random_alu = [&](bool is_export) {
+    TestAlu alu;
+    alu.vector_opcode = ucode::AluVectorOpcode(random(30));
+    uint32_t scalar_opcode;
+    do {
+      scalar_opcode = random(51);
+    } while (scalar_opcode == 41);
+    alu.scalar_opcode = ucode::AluScalarOpcode(scalar_opcode);
+    alu.vector_write_mask = random(16);
+    alu.scalar_write_mask = random(16);
+    if (is_export) {
+      static const ucode::ExportRegister kExportRegisters[] = {
+          ucode::ExportRegister::kVSInterpolator0,
+          ucode::ExportRegister::kVSInterpolator1,
+          ucode::ExportRegister::kVSPosition,
+          ucode::ExportRegister::kVSPointSizeEdgeFlagKillVertex,
+      };
+      alu.is_export = true;
+      alu.vector_dest = uint32_t(kExportRegisters[random(4)]);
+      alu.scalar_dest_relative = random(2) != 0;
+    } else {
+      alu.vector_dest = 1 + random(kTempCount);
+      alu.scalar_dest = 1 + random(kTempCount);
+    }
+    alu.vector_clamp = random(4) == 0;
+    alu.scalar_clamp = random(4) == 0;
+    alu.abs_constants = random(2) != 0;
+    for (uint32_t i = 1; i <= 3; ++i) {
+      alu.src_is_temp[i] = random(3) != 0;
+      if (alu.src_is_temp[i]) {
+        // No aL-relative addressing, random absolute value.
+        alu.src_reg[i] = random(kTempCount + 1) | (random(2) << 7);
+      } else {
+        alu.src_reg[i] = random(2) ? random(8) : random(256);
+      }
+      alu.src_swizzle[i] = random(4) ? random(256) : 0;
+      alu.src_negate[i] = random(4) == 0;
+    }
+    alu.is_predicated = random(4) == 0;
+    alu.predicate_condition = random(2) != 0;
+    if (random(4) == 0) {
+      alu.const_address_register_relative = true;
+      alu.const_0_addressed = random(2) != 0;
+      alu.const_1_addressed = random(2) != 0;
+    }
+    return alu;
+  };
+  auto random_vfetch = [&]() {
+    TestVertexFetch vfetch;
+    vfetch.dest = 1 + random(kTempCount);
+    vfetch.const_index_sel = random(kTestVertexFetchConstantCount);
+    for (uint32_t i = 0; i < 4; ++i) {
+      // 0...5 are XYZW01, 7 is keep.
+      uint32_t component_swizzle = random(7);
+      vfetch.dest_swizzle |=
+          (component_swizzle == 6 ? 7 : component_swizzle) << (3 * i);
+    }
+    vfetch.is_signed = random(2) != 0;
+    vfetch.is_normalized = random(2) != 0;
+    vfetch.signed_rf_no_zero = random(2) != 0;
+    vfetch.is_index_rounded = random(2) != 0;
+    vfetch.format =
+        kVertexFormats[random(uint32_t(xe::countof(kVertexFormats)))];
+    vfetch.exp_adjust = random(4) ? 0 : int32_t(random(9)) - 4;
+    vfetch.is_mini_fetch = random(4) == 0;
+    vfetch.is_predicated = random(4) == 0;
+    vfetch.predicate_condition = random(2) != 0;
+    vfetch.stride = random(17);
+    vfetch.offset = int32_t(random(33)) - 16;
+    return vfetch;
+  };
+  auto add_random_exec = [&](TestShaderBuilder& builder,
+                             ucode::ControlFlowOpcode opcode) {
+    uint32_t count = 1 + random(6);
+    uint32_t sequence = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      if (random(4) == 0) {
+        sequence |= UINT32_C(1) << (2 * i);
+      }
+    }
+    builder.AddExec(opcode, sequence, random(4), random(2) != 0);
+    for (uint32_t i = 0; i < count; ++i) {
+      uint32_t dwords[3];
+      if (sequence & (UINT32_C(1) << (2 * i))) {
+        random_vfetch().Encode(dwords);
+      } else {
+        random_alu(random(4) == 0).Encode(dwords);
+      }
+      builder.AddInstruction(dwords);
+    }
+  };
+  static const ucode::ControlFlowOpcode kExecOpcodes[] = {
+      ucode::ControlFlowOpcode::kExec,
+      ucode::ControlFlowOpcode::kCondExec,
+      ucode::ControlFlowOpcode::kCondExecPred,
+      ucode::ControlFlowOpcode::kCondExecPredClean,
+      ucode::ControlFlowOpcode::kCondExecPredEnd,
+      ucode::ControlFlowOpcode::kCondExecEnd,
+  };
+
+  for (uint32_t program = 0; program < 256; ++program) {
+    for (uint32_t i = 0; i < 256; ++i) {
+      float value = random_float();
+      if (random(2)) {
+        // Also testing a0-relative addressing with small indices.
+        value = float(int32_t(random(12)) - 4);
+      }
+      for (uint32_t j = 0; j < 4; ++j) {
+        regs[XE_GPU_REG_SHADER_CONSTANT_000_X + 4 * i + j] =
+            std::bit_cast<uint32_t>(j == 3 && random(2) ? value
+                                                        : random_float());
+      }
+    }
+    regs[XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031] = uint32_t(random_engine());
+    for (uint32_t i = 0; i < kTestVertexFetchConstantCount; ++i) {
+      context.SetVertexFetchConstant(i, random(64), 256 + random(4096),
+                                     xenos::Endian(random(4)));
+    }
+    float* temp_registers = context.interpreter().temp_registers();
+    for (uint32_t i = 0; i < 4 * xenos::kMaxShaderTempRegisters; ++i) {
+      temp_registers[i] = random_float();
+    }
+
+    TestShaderBuilder builder;
+    builder.AddAlloc(ucode::AllocType::kVsPosition, 0);
+    // Calls to a subroutine placed after the end, and jumps forward, for
+    // testing the uniform control flow and the fallback for invocations taking
+    // different predicated branches.
+    std::vector<uint32_t> calls;
+    std::vector<uint32_t> forward_jumps;
+    uint32_t exec_count = 1 + random(6);
+    for (uint32_t i = 0; i < exec_count; ++i) {
+      for (uint32_t forward_jump : forward_jumps) {
+        builder.SetJumpAddress(forward_jump, builder.cf_count());
+      }
+      forward_jumps.clear();
+      switch (random(6)) {
+        case 0:
+          calls.push_back(builder.AddJump(ucode::ControlFlowOpcode::kCondCall,
+                                          0, random(2) != 0, random(2) != 0,
+                                          random(4), random(2) != 0));
+          break;
+        case 1:
+          forward_jumps.push_back(
+              builder.AddJump(ucode::ControlFlowOpcode::kCondJmp, 0,
+                              random(2) != 0, random(2) != 0, random(4),
+                              random(2) != 0));
+          break;
+        default:
+          break;
+      }
+      add_random_exec(builder, kExecOpcodes[random(
+                                   uint32_t(xe::countof(kExecOpcodes)))]);
+    }
+    for (uint32_t forward_jump : forward_jumps) {
+      builder.SetJumpAddress(forward_jump, builder.cf_count());
+    }
+    // Export all the temporary registers and the previous scalar, in two execs
+    // as an exec can contain up to 6 instructions.
+    for (uint32_t i = 0; i <= kTempCount; ++i) {
+      if (i == 0 || i == 5) {
+        builder.AddExec(i ? ucode::ControlFlowOpcode::kExecEnd
+                          : ucode::ControlFlowOpcode::kExec,
+                        0);
+      }
+      TestAlu export_alu;
+      export_alu.vector_dest = i;
+      export_alu.vector_write_mask = 0b1111;
+      export_alu.is_export = true;
+      for (uint32_t j = 1; j <= 2; ++j) {
+        export_alu.src_reg[j] = i;
+        export_alu.src_is_temp[j] = true;
+      }
+      if (i == kTempCount) {
+        export_alu.vector_write_mask = 0b0111;
+        export_alu.scalar_write_mask = 0b1000;
+      }
+      uint32_t dwords[3];
+      export_alu.Encode(dwords);
+      builder.AddInstruction(dwords);
+    }
+    if (!calls.empty()) {
+      uint32_t subroutine = builder.cf_count();
+      for (uint32_t call : calls) {
+        builder.SetJumpAddress(call, subroutine);
+      }
+      add_random_exec(builder, ucode::ControlFlowOpcode::kExec);
+      builder.AddReturn();
+    }
+    std::unique_ptr<Shader> shader = builder.Build(program);
+    REQUIRE(ShaderInterpreter::CanInterpretShader(*shader));
+
+    float r0_x_values[ShaderInterpreter::kBatchSize];
+    for (float& r0_x : r0_x_values) {
+      r0_x = float(random(1024)) * 0.25f;
+    }
+    context.CheckBatchMatchesExecute(
+        *shader, 1 + random(ShaderInterpreter::kBatchSize), r0_x_values);
+  }
+}
+
+}  // namespace test
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,275 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/texture_cache.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "xenia/base/cvar.h"
+#include "xenia/base/mutex.h"
+#include "xenia/gpu/register_file.h"
+#include "xenia/gpu/shared_memory.h"
+#include "xenia/gpu/xenos.h"
+#include "xenia/memory.h"
+
+DECLARE_bool(texture_cache_content_hash);
+DECLARE_uint32(texture_cache_max_textures);
+
+namespace xe {
+namespace gpu {
+namespace test {
+
+// Shared memory without a host GPU buffer - only tracks the validity of the
+// pages.
+class TestSharedMemory : public SharedMemory {
+ public:
+  explicit TestSharedMemory(Memory& memory) : SharedMemory(memory) {}
+  bool Initialize() { return InitializeCommon(); }
+
+ protected:
+  bool UploadRanges(const std::pair<uint32_t, uint32_t>* upload_page_ranges,
+                    uint32_t num_upload_ranges) override {
+    for (uint32_t i = 0; i < num_upload_ranges; ++i) {
+      MakeRangeValid(upload_page_ranges[i].first << page_size_log2(),
+                     upload_page_ranges[i].second << page_size_log2(), false);
+    }
+    return true;
+  }
+};
+
+// Texture cache without host textures, counting the creations and the loads.
+class TestTextureCache : public TextureCache {
+ public:
+  TestTextureCache(const RegisterFile& register_file,
+                   SharedMemory& shared_memory)
+      : TextureCache(register_file, shared_memory, 1, 1) {}
+
+  using TextureCache::Texture;
+  using TextureCache::TextureKey;
+
+  using TextureCache::FindOrCreateTexture;
+  using TextureCache::LoadTextureData;
+
+  uint32_t textures_created() const { return textures_created_; }
+  uint32_t textures_loaded() const { return textures_loaded_; }
+
+ protected:
+  class TestTexture : public Texture {
+   public:
+    TestTexture(TextureCache& texture_cache, const TextureKey& key)
+        : Texture(texture_cache, key) {}
+  };
+
+  uint32_t GetHostFormatSwizzle(TextureKey key) const override {
+    return xenos::XE_GPU_TEXTURE_SWIZZLE_RGBA;
+  }
+  uint32_t GetMaxHostTextureWidthHeight(
+      xenos::DataDimension dimension) const override {
+    return 8192;
+  }
+  uint32_t GetMaxHostTextureDepthOrArraySize(
+      xenos::DataDimension dimension) const override {
+    return 1024;
+  }
+  std::unique_ptr<Texture> CreateTexture(TextureKey key) override {
+    ++textures_created_;
+    return std::make_unique<TestTexture>(*this, key);
+  }
+  bool LoadTextureDataFromResidentMemoryImpl(Texture& texture, bool load_base,
+                                             bool load_mips) override {
+    ++textures_loaded_;
+    return true;
+  }
+
+ private:
+  uint32_t textures_created_ = 0;
+  uint32_t textures_loaded_ = 0;
+};
+
+using Texture = TestTextureCache::Texture;
+using TextureKey = TestTextureCache::TextureKey;
+
+class ContentHashTest {
+ public:
+  // Enough for a 32x32 linear 32bpp texture with the row pitch alignment.
+  static constexpr uint32_t kTextureAllocationSize = 0x10000;
+
+  ContentHashTest() {
+    cvars::texture_cache_content_hash = true;
+    memory_ = std::make_unique<Memory>();
+    REQUIRE(memory_->Initialize());
+    shared_memory_ = std::make_unique<TestSharedMemory>(*memory_);
+    REQUIRE(shared_memory_->Initialize());
+    texture_cache_ =
+        std::make_unique<TestTextureCache>(register_file_, *shared_memory_);
+  }
+  ~ContentHashTest() {
+    texture_cache_.reset();
+    shared_memory_.reset();
+    memory_.reset();
+    cvars::texture_cache_content_hash = false;
+    cvars::texture_cache_max_textures = 0;
+  }
+
+  TestTextureCache& texture_cache() { return *texture_cache_; }
+
+  // Returns the guest virtual address of a new texture data allocation, and
+  // the key of a texture there.
+  std::pair<uint32_t, TextureKey> AllocateTexture() {
+    uint32_t address = memory_->SystemHeapAlloc(
+        kTextureAllocationSize, 4096, kSystemHeapPhysical);
+    REQUIRE(address);
+    TextureKey key;
+    key.base_page = memory_->GetPhysicalAddress(address) >> 12;
+    key.dimension = xenos::DataDimension::k2DOrStacked;
+    key.width_minus_1 = 31;
+    key.height_minus_1 = 31;
+    key.pitch = 32 >> 5;
+    key.format = xenos::TextureFormat::k_8_8_8_8;
+    key.endianness = xenos::Endian::k8in32;
+    key.is_valid = 1;
+    REQUIRE(key.GetGuestLayout().base.level_data_extent_bytes <=
+            kTextureAllocationSize);
+    return std::make_pair(address, key);
+  }
+
+  // Writes the data like the guest CPU, invalidating the watched ranges.
+  void WriteTextureData(uint32_t address, uint8_t value) {
+    memory_->TriggerPhysicalMemoryCallbacks(global_critical_region_.Acquire(),
+                                            address, kTextureAllocationSize,
+                                            true, false);
+    std::memset(memory_->TranslateVirtual(address), value,
+                kTextureAllocationSize);
+  }
+
+  Texture* LoadTexture(const TextureKey& key) {
+    Texture* texture = texture_cache_->FindOrCreateTexture(key);
+    REQUIRE(texture);
+    REQUIRE(texture_cache_->LoadTextureData(*texture));
+    return texture;
+  }
+
+  // Destroys the least recently created textures above the count.
+  void EvictTextures(uint32_t max_textures) {
+    cvars::texture_cache_max_textures = max_textures;
+    texture_cache_->CompletedSubmissionUpdated(0);
+    cvars::texture_cache_max_textures = 0;
+  }
+
+ private:
+  xe::global_critical_region global_critical_region_;
+  RegisterFile register_file_;
+  std::unique_ptr<Memory> memory_;
+  std::unique_ptr<TestSharedMemory> shared_memory_;
+  std::unique_ptr<TestTextureCache> texture_cache_;
+};
+
+TEST_CASE("Texture content hash skips rewrites with the same data",
+          "[texture_cache]") {
+  ContentHashTest test;
+  auto [address, key] = test.AllocateTexture();
+  test.WriteTextureData(address, 1);
+  Texture* texture = test.LoadTexture(key);
+  REQUIRE(test.texture_cache().textures_loaded() == 1);
+  REQUIRE(texture->content_hash());
+
+  // Rewritten with the same data - up to date again without a reload.
+  test.WriteTextureData(address, 1);
+  REQUIRE(texture->base_outdated_lockless());
+  REQUIRE(test.LoadTexture(key) == texture);
+  REQUIRE(!texture->base_outdated_lockless());
+  REQUIRE(test.texture_cache().textures_loaded() == 1);
+
+  // Changed data must be reloaded.
+  uint64_t content_hash = texture->content_hash();
+  test.WriteTextureData(address, 2);
+  REQUIRE(test.LoadTexture(key) == texture);
+  REQUIRE(test.texture_cache().textures_loaded() == 2);
+  REQUIRE(texture->content_hash() != content_hash);
+}
+
+TEST_CASE("Texture content hash shares textures with the same data",
+          "[texture_cache]") {
+  ContentHashTest test;
+  auto [address_0, key_0] = test.AllocateTexture();
+  auto [address_1, key_1] = test.AllocateTexture();
+  test.WriteTextureData(address_0, 1);
+  test.WriteTextureData(address_1, 1);
+  Texture* texture_0 = test.LoadTexture(key_0);
+
+  // Same data at a different address - the existing texture is used.
+  REQUIRE(test.LoadTexture(key_1) == texture_0);
+  REQUIRE(test.LoadTexture(key_1) == texture_0);
+  REQUIRE(test.texture_cache().textures_created() == 1);
+  REQUIRE(test.texture_cache().textures_loaded() == 1);
+
+  // Modifying the aliased range stops the sharing.
+  test.WriteTextureData(address_1, 2);
+  Texture* texture_1 = test.LoadTexture(key_1);
+  REQUIRE(texture_1 != texture_0);
+  REQUIRE(test.texture_cache().textures_created() == 2);
+  REQUIRE(test.texture_cache().textures_loaded() == 2);
+  REQUIRE(test.LoadTexture(key_0) == texture_0);
+}
+
+TEST_CASE("Texture content hash keeps other textures with the same data",
+          "[texture_cache]") {
+  ContentHashTest test;
+  auto [address_0, key_0] = test.AllocateTexture();
+  auto [address_1, key_1] = test.AllocateTexture();
+  auto [address_2, key_2] = test.AllocateTexture();
+  test.WriteTextureData(address_0, 1);
+  test.WriteTextureData(address_1, 2);
+  test.LoadTexture(key_0);
+  Texture* texture_1 = test.LoadTexture(key_1);
+  // Both textures have the same contents now.
+  test.WriteTextureData(address_1, 1);
+  REQUIRE(test.LoadTexture(key_1) == texture_1);
+  REQUIRE(test.texture_cache().textures_created() == 2);
+  REQUIRE(test.texture_cache().textures_loaded() == 3);
+
+  // The first texture is destroyed, but the second can still be shared.
+  test.EvictTextures(1);
+  test.WriteTextureData(address_2, 1);
+  REQUIRE(test.LoadTexture(key_2) == texture_1);
+  REQUIRE(test.texture_cache().textures_created() == 2);
+  REQUIRE(test.texture_cache().textures_loaded() == 3);
+}
+
+TEST_CASE("Texture content hash aliases are destroyed with the texture",
+          "[texture_cache]") {
+  ContentHashTest test;
+  auto [address_0, key_0] = test.AllocateTexture();
+  auto [address_1, key_1] = test.AllocateTexture();
+  auto [address_2, key_2] = test.AllocateTexture();
+  test.WriteTextureData(address_0, 1);
+  test.WriteTextureData(address_1, 1);
+  test.WriteTextureData(address_2, 2);
+  Texture* texture_0 = test.LoadTexture(key_0);
+  REQUIRE(test.LoadTexture(key_1) == texture_0);
+  Texture* texture_2 = test.LoadTexture(key_2);
+  REQUIRE(test.texture_cache().textures_created() == 2);
+
+  // Nothing with the same contents is left after the texture is destroyed.
+  test.EvictTextures(1);
+  Texture* texture_1 = test.LoadTexture(key_1);
+  REQUIRE(texture_1 != texture_2);
+  REQUIRE(test.texture_cache().textures_created() == 3);
+  REQUIRE(test.texture_cache().textures_loaded() == 3);
+  REQUIRE(test.LoadTexture(key_2) == texture_2);
+}
+
+}  // namespace test
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,411 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/texture_conversion.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "xenia/base/byte_order.h"
+#include "xenia/base/math.h"
+#include "xenia/gpu/texture_address.h"
+#include "xenia/gpu/xenos.h"
+
+namespace xe {
+namespace gpu {
+namespace test {
+
+using texture_conversion::Isa;
+
+// Guest data and constants for loading a texture of the given size in blocks
+// into a tightly packed host buffer, like the host GPU backends do.
+struct TestTexture {
+  TextureCache::LoadShaderIndex load_shader;
+  TextureCache::LoadConstants constants = {};
+  uint32_t bytes_per_guest_block;
+  std::vector<uint8_t> source;
+  size_t dest_size;
+
+  TestTexture(TextureCache::LoadShaderIndex load_shader,
+              uint32_t bytes_per_guest_block, uint32_t width_blocks,
+              uint32_t height_blocks, uint32_t depth, bool is_tiled,
+              xenos::Endian endian, bool is_decompressing = false)
+      : load_shader(load_shader),
+        bytes_per_guest_block(bytes_per_guest_block) {
+    const TextureCache::LoadShaderInfo& info =
+        TextureCache::GetLoadShaderInfo(load_shader);
+    constants.is_tiled_3d_endian_scale = uint32_t(is_tiled) |
+                                         (uint32_t(depth > 1) << 1) |
+                                         (uint32_t(endian) << 2);
+    constants.guest_offset = 0;
+    constants.guest_pitch_aligned = xe::round_up(width_blocks, 32u);
+    constants.guest_z_stride_block_rows_aligned =
+        xe::round_up(height_blocks, 32u);
+    constants.size_blocks[0] = width_blocks;
+    constants.size_blocks[1] = height_blocks;
+    constants.size_blocks[2] = depth;
+    constants.host_offset = 0;
+    uint32_t block_size = is_decompressing ? 4 : 1;
+    constants.host_pitch =
+        info.bytes_per_host_block * block_size *
+        xe::round_up(width_blocks,
+                     UINT32_C(1) << info.guest_x_blocks_per_thread_log2);
+    constants.height_texels = height_blocks * block_size;
+    // 3D tiling interleaves groups of 4 slices.
+    source.resize(size_t(constants.guest_pitch_aligned) *
+                  constants.guest_z_stride_block_rows_aligned *
+                  (depth > 1 ? xe::round_up(depth, 4u) : 1) *
+                  bytes_per_guest_block);
+    dest_size = size_t(constants.host_pitch) * constants.height_texels * depth;
+  }
+
+  uint32_t source_address(uint32_t x, uint32_t y, uint32_t z) const {
+    uint32_t bytes_per_block_log2 = std::countr_zero(bytes_per_guest_block);
+    if (!(constants.is_tiled_3d_endian_scale & 1)) {
+      return (x + constants.guest_pitch_aligned *
+                      (y + constants.guest_z_stride_block_rows_aligned * z))
+             << bytes_per_block_log2;
+    }
+    if (constants.size_blocks[2] > 1) {
+      return uint32_t(texture_address::Tiled3D(
+          int32_t(x), int32_t(y), int32_t(z), constants.guest_pitch_aligned,
+          constants.guest_z_stride_block_rows_aligned, bytes_per_block_log2));
+    }
+    return uint32_t(texture_address::Tiled2D(int32_t(x), int32_t(y),
+                                             constants.guest_pitch_aligned,
+                                             bytes_per_block_log2));
+  }
+
+  void Randomize(std::mt19937& random) {
+    for (uint8_t& byte : source) {
+      byte = uint8_t(random());
+    }
+  }
+
+  std::vector<uint8_t> Load(Isa isa) const {
+    std::vector<uint8_t> dest(dest_size, 0xCD);
+    REQUIRE(texture_conversion::LoadTexture(load_shader, constants,
+                                            source.data(), source.size(),
+                                            dest.data(), dest.size(), isa));
+    return dest;
+  }
+};
+
+uint32_t LoadU32(const uint8_t* bytes) {
+  uint32_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+uint32_t Expand5To8(uint32_t value) { return (value << 3) | (value >> 2); }
+uint32_t Expand6To8(uint32_t value) { return (value << 2) | (value >> 4); }
+
+// Rounding to the nearest even, with doubles.
+uint16_t FloatToHalfReference(float value) {
+  uint16_t sign = std::signbit(value) ? 0x8000 : 0;
+  double abs_value = std::fabs(double(value));
+  if (std::isnan(value)) {
+    return sign | 0x7E00;
+  }
+  if (abs_value < std::ldexp(1.0, -14)) {
+    return sign | uint16_t(std::nearbyint(abs_value * std::ldexp(1.0, 24)));
+  }
+  int exponent;
+  std::frexp(abs_value, &exponent);
+  --exponent;
+  double mantissa = std::nearbyint(abs_value * std::ldexp(1.0, 10 - exponent));
+  if (mantissa >= 2048.0) {
+    mantissa *= 0.5;
+    ++exponent;
+  }
+  if (exponent > 15) {
+    return sign | 0x7C00;
+  }
+  return sign | uint16_t(((exponent + 15) << 10) | (uint32_t(mantissa) - 1024));
+}
+
+TEST_CASE("texture_conversion_isa_consistency", "[texture_conversion]") {
+  std::mt19937 random(1);
+  for (uint32_t i = 0; i < TextureCache::kLoadShaderCount; ++i) {
+    auto load_shader = TextureCache::LoadShaderIndex(i);
+    for (uint32_t variant = 0; variant < 16; ++variant) {
+      bool is_tiled = (variant & 1) != 0;
+      uint32_t depth = (variant & 2) ? 3 : 1;
+      auto endian = xenos::Endian(variant >> 2);
+      bool is_decompressing =
+          load_shader >= TextureCache::kLoadShaderIndexDXT1ToRGBA8 &&
+          load_shader <= TextureCache::kLoadShaderIndexCTX1;
+      // Worst case guest block size, with sizes not multiples of the number of
+      // blocks per thread.
+      TestTexture texture(load_shader, 16, 37 + variant * 5, 13 + variant,
+                          depth, is_tiled, endian, is_decompressing);
+      texture.Randomize(random);
+      std::vector<uint8_t> reference = texture.Load(Isa::kScalar);
+      for (uint32_t j = uint32_t(Isa::kScalar) + 1; j < uint32_t(Isa::kCount);
+           ++j) {
+        if (!texture_conversion::IsIsaSupported(Isa(j))) {
+          continue;
+        }
+        INFO(texture_conversion::GetLoadShaderName(load_shader)
+             << " " << texture_conversion::GetIsaName(Isa(j)) << " variant "
+             << variant);
+        REQUIRE(texture.Load(Isa(j)) == reference);
+      }
+    }
+  }
+}
+
+TEST_CASE("texture_conversion_untile_32bpb", "[texture_conversion]") {
+  std::mt19937 random(2);
+  for (uint32_t depth : {1u, 5u}) {
+    TestTexture texture(TextureCache::kLoadShaderIndex32bpb, 4, 70, 33, depth,
+                        true, xenos::Endian::k8in32);
+    texture.Randomize(random);
+    for (uint32_t i = 0; i < uint32_t(Isa::kCount); ++i) {
+      if (!texture_conversion::IsIsaSupported(Isa(i))) {
+        continue;
+      }
+      std::vector<uint8_t> dest = texture.Load(Isa(i));
+      for (uint32_t z = 0; z < depth; ++z) {
+        for (uint32_t y = 0; y < 33; ++y) {
+          for (uint32_t x = 0; x < 70; ++x) {
+            uint32_t guest = xe::byte_swap(LoadU32(
+                texture.source.data() + texture.source_address(x, y, z)));
+            uint32_t host = LoadU32(
+                dest.data() + (z * 33 + y) * texture.constants.host_pitch +
+                x * 4);
+            REQUIRE(host == guest);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("texture_conversion_dxt1", "[texture_conversion]") {
+  std::mt19937 random(3);
+  TestTexture texture(TextureCache::kLoadShaderIndexDXT1ToRGBA8, 8, 9, 5, 1,
+                      true, xenos::Endian::kNone, true);
+  texture.Randomize(random);
+  // Make sure both modes are covered.
+  for (uint32_t y = 0; y < 5; ++y) {
+    for (uint32_t x = 0; x < 9; ++x) {
+      uint8_t* colors = texture.source.data() + texture.source_address(x, y, 0);
+      uint16_t color_0, color_1;
+      std::memcpy(&color_0, colors, sizeof(color_0));
+      std::memcpy(&color_1, colors + 2, sizeof(color_1));
+      if ((color_0 > color_1) != ((x + y) & 1)) {
+        std::memcpy(colors, &color_1, sizeof(color_1));
+        std::memcpy(colors + 2, &color_0, sizeof(color_0));
+      }
+    }
+  }
+  for (uint32_t i = 0; i < uint32_t(Isa::kCount); ++i) {
+    if (!texture_conversion::IsIsaSupported(Isa(i))) {
+      continue;
+    }
+    std::vector<uint8_t> dest = texture.Load(Isa(i));
+    for (uint32_t y = 0; y < 5; ++y) {
+      for (uint32_t x = 0; x < 9; ++x) {
+        const uint8_t* block =
+            texture.source.data() + texture.source_address(x, y, 0);
+        uint32_t colors = LoadU32(block);
+        uint32_t codes = LoadU32(block + 4);
+        uint32_t end[2][3];
+        for (uint32_t j = 0; j < 2; ++j) {
+          uint32_t color = colors >> (16 * j);
+          end[j][0] = Expand5To8((color >> 11) & 31);
+          end[j][1] = Expand6To8((color >> 5) & 63);
+          end[j][2] = Expand5To8(color & 31);
+        }
+        bool is_opaque = (colors & 0xFFFF) > (colors >> 16);
+        for (uint32_t texel = 0; texel < 16; ++texel) {
+          uint32_t code = (codes >> (2 * texel)) & 3;
+          uint32_t expected = 0xFF000000u;
+          for (uint32_t j = 0; j < 3; ++j) {
+            uint32_t component;
+            switch (code) {
+              case 0:
+                component = end[0][j];
+                break;
+              case 1:
+                component = end[1][j];
+                break;
+              case 2:
+                component = is_opaque ? (2 * end[0][j] + end[1][j]) / 3
+                                      : (end[0][j] + end[1][j]) / 2;
+                break;
+              default:
+                component = is_opaque ? (end[0][j] + 2 * end[1][j]) / 3 : 0;
+                break;
+            }
+            expected |= component << (8 * j);
+          }
+          if (!is_opaque && code == 3) {
+            expected = 0;
+          }
+          uint32_t host = LoadU32(
+              dest.data() + (y * 4 + texel / 4) * texture.constants.host_pitch +
+              (x * 4 + texel % 4) * 4);
+          REQUIRE(host == expected);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("texture_conversion_dxt5_alpha", "[texture_conversion]") {
+  std::mt19937 random(4);
+  TestTexture texture(TextureCache::kLoadShaderIndexDXT5ToRGBA8, 16, 6, 4, 1,
+                      false, xenos::Endian::kNone, true);
+  texture.Randomize(random);
+  for (uint32_t i = 0; i < uint32_t(Isa::kCount); ++i) {
+    if (!texture_conversion::IsIsaSupported(Isa(i))) {
+      continue;
+    }
+    std::vector<uint8_t> dest = texture.Load(Isa(i));
+    for (uint32_t y = 0; y < 4; ++y) {
+      for (uint32_t x = 0; x < 6; ++x) {
+        const uint8_t* block =
+            texture.source.data() + texture.source_address(x, y, 0);
+        uint64_t alpha_block;
+        std::memcpy(&alpha_block, block, sizeof(alpha_block));
+        uint32_t end_0 = alpha_block & 0xFF, end_1 = (alpha_block >> 8) & 0xFF;
+        for (uint32_t texel = 0; texel < 16; ++texel) {
+          uint32_t code = (alpha_block >> (16 + 3 * texel)) & 7;
+          uint32_t expected;
+          if (code < 2) {
+            expected = code ? end_1 : end_0;
+          } else if (end_0 > end_1) {
+            expected = ((8 - code) * end_0 + (code - 1) * end_1) / 7;
+          } else if (code < 6) {
+            expected = ((6 - code) * end_0 + (code - 1) * end_1) / 5;
+          } else {
+            expected = code == 7 ? 0xFF : 0;
+          }
+          uint32_t host = LoadU32(
+              dest.data() + (y * 4 + texel / 4) * texture.constants.host_pitch +
+              (x * 4 + texel % 4) * 4);
+          REQUIRE((host >> 24) == expected);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("texture_conversion_rg16_snorm_to_float", "[texture_conversion]") {
+  TestTexture texture(TextureCache::kLoadShaderIndexRG16SNormToFloat, 4, 256,
+                      256, 1, false, xenos::Endian::kNone);
+  // All 16-bit values in both components.
+  for (uint32_t i = 0; i < 0x10000; ++i) {
+    uint32_t value = i | ((i ^ 0xA5A5) << 16);
+    std::memcpy(texture.source.data() + i * 4, &value, sizeof(value));
+  }
+  for (uint32_t i = 0; i < uint32_t(Isa::kCount); ++i) {
+    if (!texture_conversion::IsIsaSupported(Isa(i))) {
+      continue;
+    }
+    std::vector<uint8_t> dest = texture.Load(Isa(i));
+    for (uint32_t j = 0; j < 0x10000; ++j) {
+      uint32_t guest = LoadU32(texture.source.data() + j * 4);
+      uint32_t host = LoadU32(dest.data() + j * 4);
+      for (uint32_t k = 0; k < 2; ++k) {
+        float value = std::max(
+            float(int16_t(guest >> (16 * k))) * (1.0f / 32767.0f), -1.0f);
+        REQUIRE(uint16_t(host >> (16 * k)) == FloatToHalfReference(value));
+      }
+    }
+  }
+}
+
+TEST_CASE("texture_conversion_depth_float", "[texture_conversion]") {
+  std::mt19937 random(5);
+  TestTexture texture(TextureCache::kLoadShaderIndexDepthFloat, 4, 64, 64, 1,
+                      false, xenos::Endian::kNone);
+  texture.Randomize(random);
+  // Zero and denormals.
+  for (uint32_t i = 0; i < 64 * 16; ++i) {
+    uint32_t value = ((i * 1021) & 0xFFFFF) << 8;
+    std::memcpy(texture.source.data() + i * 4, &value, sizeof(value));
+  }
+  for (uint32_t i = 0; i < uint32_t(Isa::kCount); ++i) {
+    if (!texture_conversion::IsIsaSupported(Isa(i))) {
+      continue;
+    }
+    std::vector<uint8_t> dest = texture.Load(Isa(i));
+    for (uint32_t j = 0; j < 64 * 64; ++j) {
+      uint32_t f24 = LoadU32(texture.source.data() + j * 4) >> 8;
+      uint32_t exponent = f24 >> 20, mantissa = f24 & 0xFFFFF;
+      double expected =
+          exponent ? std::ldexp(1.0 + std::ldexp(double(mantissa), -20),
+                                int(exponent) - 15)
+                   : std::ldexp(double(mantissa), -34);
+      REQUIRE(std::bit_cast<float>(LoadU32(dest.data() + j * 4)) ==
+              float(expected));
+    }
+  }
+}
+
+TEST_CASE("texture_conversion_robust_access", "[texture_conversion]") {
+  std::mt19937 random(6);
+  TestTexture texture(TextureCache::kLoadShaderIndex64bpb, 8, 40, 20, 1, false,
+                      xenos::Endian::kNone);
+  texture.Randomize(random);
+  size_t source_size = texture.source.size() / 2 + 4;
+  for (uint32_t i = 0; i < uint32_t(Isa::kCount); ++i) {
+    if (!texture_conversion::IsIsaSupported(Isa(i))) {
+      continue;
+    }
+    std::vector<uint8_t> dest(texture.dest_size + 16, 0xCD);
+    size_t dest_size = texture.dest_size - 4;
+    REQUIRE(texture_conversion::LoadTexture(
+        texture.load_shader, texture.constants, texture.source.data(),
+        source_size, dest.data(), dest_size, Isa(i)));
+    for (size_t j = 0; j < dest_size; ++j) {
+      uint32_t y = uint32_t(j / texture.constants.host_pitch);
+      uint32_t x = uint32_t(j % texture.constants.host_pitch);
+      if (x >= 40 * 8) {
+        continue;
+      }
+      size_t source_offset = size_t(texture.source_address(0, y, 0)) + x;
+      uint8_t expected =
+          source_offset < source_size ? texture.source[source_offset] : 0;
+      REQUIRE(dest[j] == expected);
+    }
+    for (size_t j = dest_size; j < dest.size(); ++j) {
+      REQUIRE(dest[j] == 0xCD);
+    }
+  }
+}
+
+TEST_CASE("texture_conversion_rejects_resolution_scale",
+          "[texture_conversion]") {
+  TestTexture texture(TextureCache::kLoadShaderIndex32bpb, 4, 8, 8, 1, false,
+                      xenos::Endian::kNone);
+  std::vector<uint8_t> dest(texture.dest_size);
+  TextureCache::LoadConstants constants = texture.constants;
+  // 1x is the same as not scaled.
+  constants.is_tiled_3d_endian_scale |= (1 << 4) | (1 << 7);
+  REQUIRE(texture_conversion::LoadTexture(
+      texture.load_shader, constants, texture.source.data(),
+      texture.source.size(), dest.data(), dest.size()));
+  constants.is_tiled_3d_endian_scale |= 2 << 4;
+  REQUIRE_FALSE(texture_conversion::LoadTexture(
+      texture.load_shader, constants, texture.source.data(),
+      texture.source.size(), dest.data(), dest.size()));
+}
+
+}  // namespace test
+}  // namespace gpu
+}  // namespace xe
@@ -14,6 +14,7 @@
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
+#include "xenia/base/xxhash.h"
 #include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/shared_memory.h"
 
@@ -51,6 +52,18 @@ DEFINE_uint32(
     "Maximum host texture memory usage (in megabytes) above which textures "
     "will be destroyed as soon as possible.",
     "GPU");
+DEFINE_uint32(
+    texture_cache_max_textures, 0,
+    "Maximum number of textures above which the least recently used textures "
+    "will be destroyed as soon as they're not used by the GPU anymore, also "
+    "limiting host memory not counted in the texture memory usage, such as "
+    "descriptors and bookkeeping (0 for no limit).",
+    "GPU");
+DEFINE_bool(
+    texture_cache_log_frame_statistics, false,
+    "Log the number of textures created, destroyed due to the memory limits, "
+    "loaded and reloaded during each frame, and the resident textures.",
+    "GPU");
 DEFINE_uint32(
     texture_cache_memory_limit_render_to_texture, 24,
     "Part of the host texture memory budget (in megabytes) that will be scaled "
@@ -61,6 +74,14 @@ DEFINE_uint32(
     "textures - so with 2x2 resolution scaling, the soft limit will be 360 + "
     "96 MB, and with 3x3, it will be 360 + 216 MB.",
     "GPU");
+DEFINE_bool(
+    texture_cache_content_hash, false,
+    "Hash the guest data of textures when their memory is modified to skip "
+    "reloading textures that the game has rewritten with identical data, and "
+    "to use one host texture for identical textures at different addresses.\n"
+    "Costs hashing of the data whenever a texture needs to be reloaded, useful "
+    "in games streaming the same data repeatedly.",
+    "GPU");
 DEFINE_bool(tiled_shared_memory, true,
             "Enable tiled/sparse resources for efficient large address space "
             "support. Disable for graphics debugger compatibility.",
@@ -217,7 +238,11 @@ void TextureCache::CompletedSubmissionUpdated(
   while (texture_used_first_ != nullptr) {
     uint64_t total_host_memory_usage_mb =
         (textures_total_host_memory_usage_ + ((UINT32_C(1) << 20) - 1)) >> 20;
-    bool limit_hard_exceeded = total_host_memory_usage_mb > limit_hard_mb;
+    // The count limit is handled like the hard limit.
+    bool limit_hard_exceeded =
+        total_host_memory_usage_mb > limit_hard_mb ||
+        (cvars::texture_cache_max_textures &&
+         textures_.size() > cvars::texture_cache_max_textures);
     if (total_host_memory_usage_mb <= limit_soft_mb && !limit_hard_exceeded) {
       break;
     }
@@ -245,6 +270,7 @@ void TextureCache::CompletedSubmissionUpdated(
       assert_true(found_texture_it->second.get() == texture);
       textures_.erase(found_texture_it);
       // `texture` is invalid now.
+      ++frame_statistics_.textures_evicted;
     }
   }
   if (destroyed_any) {
@@ -263,6 +289,32 @@ void TextureCache::BeginFrame() {
   // sure bindings are reset so a new attempt will surely be made if the texture
   // is requested again.
   ResetTextureBindings();
+
+  frame_statistics_.textures_resident = uint32_t(textures_.size());
+  frame_statistics_.host_memory_usage = textures_total_host_memory_usage_;
+  last_frame_statistics_ = frame_statistics_;
+  frame_statistics_ = FrameStatistics();
+  COUNT_profile_set("gpu/texture_cache/frame_textures_created",
+                    last_frame_statistics_.textures_created);
+  COUNT_profile_set("gpu/texture_cache/frame_textures_evicted",
+                    last_frame_statistics_.textures_evicted);
+  COUNT_profile_set("gpu/texture_cache/frame_textures_loaded",
+                    last_frame_statistics_.textures_loaded);
+  COUNT_profile_set("gpu/texture_cache/frame_textures_reloaded",
+                    last_frame_statistics_.textures_reloaded);
+  if (cvars::texture_cache_log_frame_statistics) {
+    XELOGGPU(
+        "Texture cache frame: {} created, {} evicted, {} loaded, {} reloaded, "
+        "{} resident using {} MB",
+        last_frame_statistics_.textures_created,
+        last_frame_statistics_.textures_evicted,
+        last_frame_statistics_.textures_loaded,
+        last_frame_statistics_.textures_reloaded,
+        last_frame_statistics_.textures_resident,
+        (last_frame_statistics_.host_memory_usage +
+         ((UINT32_C(1) << 20) - 1)) >>
+            20);
+  }
 }
 
 void TextureCache::MarkRangeAsResolved(uint32_t start_unscaled,
@@ -498,6 +550,13 @@ TextureCache::Texture::Texture(TextureCache& texture_cache,
 }
 
 TextureCache::Texture::~Texture() {
+  if (content_hash_) {
+    texture_cache_.RemoveTextureFromContentIndex(*this);
+  }
+  if (!texture_cache_.texture_aliases_by_texture_.empty()) {
+    texture_cache_.DestroyTextureAliases(this);
+  }
+
   if (mips_watch_handle_) {
     texture_cache().shared_memory().UnwatchMemoryRange(mips_watch_handle_);
   }
@@ -539,6 +598,7 @@ bool TextureCache::Texture::MakeUpToDateAndWatch(
     return false;
   }
 
+  has_been_loaded_ = true;
   if (watch_base) {
     assert_not_zero(GetGuestBaseSize());
     base_outdated_ = false;
@@ -556,6 +616,33 @@ bool TextureCache::Texture::MakeUpToDateAndWatch(
   return true;
 }
 
+void TextureCache::Texture::SetContentHashes(uint64_t base_content_hash,
+                                             uint64_t mips_content_hash) {
+  base_content_hash_ = base_content_hash;
+  mips_content_hash_ = mips_content_hash;
+  // Textures not owned by the cache, such as 3D-as-2D wrappers that are also
+  // loaded with tiling different than what the key implies, are not shared.
+  uint64_t new_content_hash = 0;
+  if (in_usage_list_ && !force_load_3d_tiling_ &&
+      (base_content_hash || !GetGuestBaseSize()) &&
+      (mips_content_hash || !GetGuestMipsSize())) {
+    new_content_hash = GetTextureContentHash(key(), base_content_hash,
+                                             mips_content_hash);
+  }
+  if (new_content_hash == content_hash_) {
+    return;
+  }
+  if (content_hash_) {
+    texture_cache_.RemoveTextureFromContentIndex(*this);
+  }
+  content_hash_ = new_content_hash;
+  if (content_hash_) {
+    // Other textures may have the same contents too, any of them can be
+    // shared, and the rest stay indexed when one is destroyed.
+    texture_cache_.textures_by_content_.emplace(content_hash_, this);
+  }
+}
+
 void TextureCache::Texture::MarkAsUsed() {
   // Textures not in usage tracking (track_usage=false) should not be linked.
   if (!in_usage_list_) {
@@ -610,6 +697,10 @@ void TextureCache::WatchCallback(const global_unique_lock_type& global_lock,
 
 void TextureCache::DestroyAllTextures(bool from_destructor) {
   ResetTextureBindings(from_destructor);
+  while (!texture_aliases_.empty()) {
+    DestroyTextureAlias(texture_aliases_.begin());
+  }
+  COUNT_profile_set("gpu/texture_cache/content_hash_shared", 0);
   textures_.clear();
   COUNT_profile_set("gpu/texture_cache/textures", 0);
 }
@@ -659,6 +750,14 @@ TextureCache::Texture* TextureCache::FindOrCreateTexture(TextureKey key) {
     return found_texture_it->second.get();
   }
 
+  // Try to use a texture with the same data at a different address.
+  if (cvars::texture_cache_content_hash && !key.scaled_resolve) {
+    Texture* alias_texture = FindOrCreateTextureAlias(key);
+    if (alias_texture) {
+      return alias_texture;
+    }
+  }
+
   // Create the texture and add it to the map.
   Texture* texture;
   {
@@ -672,6 +771,7 @@ TextureCache::Texture* TextureCache::FindOrCreateTexture(TextureKey key) {
         textures_.emplace(key, std::move(new_texture)).first->second.get();
   }
   COUNT_profile_set("gpu/texture_cache/textures", textures_.size());
+  ++frame_statistics_.textures_created;
   texture->LogAction("Created");
   return texture;
 }
@@ -747,6 +847,9 @@ void TextureCache::LoadTexturesData(Texture** textures, uint32_t n_textures) {
 
   uint64_t index_base_outdated = 0;
   uint64_t index_mips_outdated = 0;
+  uint64_t content_hashes[64][2];
+  // Textures for which any data is actually loaded, not skipped.
+  uint64_t index_data_loaded = 0;
   uint32_t nkept = 0;
   {
     auto global_lock = global_critical_region_.Acquire();
@@ -823,12 +926,25 @@ void TextureCache::LoadTexturesData(Texture** textures, uint32_t n_textures) {
       }
     }
 
+    bool load_base = (index_base_outdated & (1ULL << i)) != 0;
+    bool load_mips = (index_mips_outdated & (1ULL << i)) != 0;
+    bool hash_contents =
+        cvars::texture_cache_content_hash && !texture_key.scaled_resolve;
+    if (hash_contents) {
+      SkipUnchangedTextureParts(texture, load_base, load_mips,
+                                content_hashes[i][0], content_hashes[i][1]);
+    }
+
     // Actually load the texture data.
-    if (!LoadTextureDataFromResidentMemoryImpl(
-            texture, (index_base_outdated & (1ULL << i)) != 0,
-            (index_mips_outdated & (1ULL << i)) != 0)) {
+    if ((load_base || load_mips) &&
+        !LoadTextureDataFromResidentMemoryImpl(texture, load_base,
+                                               load_mips)) {
+      if (hash_contents) {
+        texture.SetContentHashes(0, 0);
+      }
       continue;
     }
+    index_data_loaded |= uint64_t(load_base || load_mips) << i;
 
     // reque for makeuptodatandwatch
     textures[i] = &texture;
@@ -845,9 +961,23 @@ void TextureCache::LoadTexturesData(Texture** textures, uint32_t n_textures) {
       // resolves as well to detect when the CPU wants to reuse the memory for a
       // regular texture or a vertex buffer, and thus the scaled resolve version
       // is not up to date anymore.
+      bool hash_contents = cvars::texture_cache_content_hash &&
+                           !texture->key().scaled_resolve;
+      bool was_loaded = texture->has_been_loaded();
       if (!texture->MakeUpToDateAndWatch(crit)) {
+        // The data might have been modified between uploading and hashing.
+        if (hash_contents) {
+          texture->SetContentHashes(0, 0);
+        }
         continue;
       }
+      if (hash_contents) {
+        texture->SetContentHashes(content_hashes[i][0], content_hashes[i][1]);
+      }
+      if (index_data_loaded & (1ULL << i)) {
+        ++(was_loaded ? frame_statistics_.textures_reloaded
+                      : frame_statistics_.textures_loaded);
+      }
 
       texture->LogAction("Loaded");
     }
@@ -917,9 +1047,22 @@ bool TextureCache::LoadTextureData(Texture& texture) {
     }
   }
 
+  bool load_base = base_outdated;
+  bool load_mips = mips_outdated;
+  uint64_t base_content_hash = 0, mips_content_hash = 0;
+  bool hash_contents =
+      cvars::texture_cache_content_hash && !texture_key.scaled_resolve;
+  if (hash_contents) {
+    SkipUnchangedTextureParts(texture, load_base, load_mips, base_content_hash,
+                              mips_content_hash);
+  }
+
   // Actually load the texture data.
-  if (!LoadTextureDataFromResidentMemoryImpl(texture, base_outdated,
-                                             mips_outdated)) {
+  if ((load_base || load_mips) &&
+      !LoadTextureDataFromResidentMemoryImpl(texture, load_base, load_mips)) {
+    if (hash_contents) {
+      texture.SetContentHashes(0, 0);
+    }
     return false;
   }
 
@@ -927,15 +1070,228 @@ bool TextureCache::LoadTextureData(Texture& texture) {
   // resolves as well to detect when the CPU wants to reuse the memory for a
   // regular texture or a vertex buffer, and thus the scaled resolve version is
   // not up to date anymore.
+  bool was_loaded = texture.has_been_loaded();
   if (!texture.MakeUpToDateAndWatch(global_critical_region_.Acquire())) {
+    // The data might have been modified between uploading and hashing.
+    if (hash_contents) {
+      texture.SetContentHashes(0, 0);
+    }
     return false;
   }
+  if (hash_contents) {
+    texture.SetContentHashes(base_content_hash, mips_content_hash);
+  }
+  if (load_base || load_mips) {
+    ++(was_loaded ? frame_statistics_.textures_reloaded
+                  : frame_statistics_.textures_loaded);
+  }
 
   texture.LogAction("Loaded");
 
   return true;
 }
 
+uint64_t TextureCache::GetTextureContentHash(TextureKey key,
+                                            uint64_t base_content_hash,
+                                            uint64_t mips_content_hash) {
+  // Only whether the levels are present affects the layout, not where they are.
+  key.base_page = key.base_page ? 1 : 0;
+  key.mip_page = key.mip_page ? 1 : 0;
+  uint64_t data_hashes[] = {base_content_hash, mips_content_hash};
+  return XXH3_64bits_withSeed(data_hashes, sizeof(data_hashes),
+                              XXH3_64bits(&key, sizeof(key)));
+}
+
+void TextureCache::SkipUnchangedTextureParts(const Texture& texture,
+                                             bool& load_base, bool& load_mips,
+                                             uint64_t& base_content_hash,
+                                             uint64_t& mips_content_hash) {
+  const TextureKey& texture_key = texture.key();
+  base_content_hash = texture.base_content_hash();
+  mips_content_hash = texture.mips_content_hash();
+  if (load_base) {
+    if (!shared_memory().HashRangeContents(texture_key.base_page << 12,
+                                           texture.GetGuestBaseSize(),
+                                           base_content_hash)) {
+      base_content_hash = 0;
+    }
+    if (base_content_hash &&
+        base_content_hash == texture.base_content_hash()) {
+      load_base = false;
+      COUNT_profile_add("gpu/texture_cache/content_hash_hits", 1);
+    } else {
+      COUNT_profile_add("gpu/texture_cache/content_hash_misses", 1);
+    }
+  }
+  if (load_mips) {
+    if (!shared_memory().HashRangeContents(texture_key.mip_page << 12,
+                                           texture.GetGuestMipsSize(),
+                                           mips_content_hash)) {
+      mips_content_hash = 0;
+    }
+    if (mips_content_hash &&
+        mips_content_hash == texture.mips_content_hash()) {
+      load_mips = false;
+      COUNT_profile_add("gpu/texture_cache/content_hash_hits", 1);
+    } else {
+      COUNT_profile_add("gpu/texture_cache/content_hash_misses", 1);
+    }
+  }
+}
+
+TextureCache::Texture* TextureCache::FindOrCreateTextureAlias(
+    const TextureKey& key) {
+  auto found_alias_it = texture_aliases_.find(key);
+  if (found_alias_it != texture_aliases_.end()) {
+    TextureAlias& alias = found_alias_it->second;
+    bool alias_up_to_date;
+    {
+      auto global_lock = global_critical_region_.Acquire();
+      alias_up_to_date = !alias.outdated &&
+                         !alias.texture->base_outdated(global_lock) &&
+                         !alias.texture->mips_outdated(global_lock);
+    }
+    if (alias_up_to_date &&
+        alias.texture->content_hash() == alias.content_hash) {
+      return alias.texture;
+    }
+    DestroyTextureAlias(found_alias_it);
+    COUNT_profile_set("gpu/texture_cache/content_hash_shared",
+                      texture_aliases_.size());
+  }
+  if (textures_by_content_.empty()) {
+    return nullptr;
+  }
+
+  // Upload the ranges before hashing so any modification after the hashing
+  // invalidates them - also needed for watching.
+  texture_util::TextureGuestLayout guest_layout = key.GetGuestLayout();
+  uint32_t base_size = guest_layout.base.level_data_extent_bytes;
+  uint32_t mips_size = guest_layout.mips_total_extent_bytes;
+  if (base_size &&
+      !shared_memory().RequestRange(key.base_page << 12,
+                                    xe::align(base_size, UINT32_C(16)))) {
+    return nullptr;
+  }
+  if (mips_size &&
+      !shared_memory().RequestRange(key.mip_page << 12,
+                                    xe::align(mips_size, UINT32_C(16)))) {
+    return nullptr;
+  }
+  uint64_t base_content_hash = 0, mips_content_hash = 0;
+  if ((base_size &&
+       !shared_memory().HashRangeContents(key.base_page << 12, base_size,
+                                          base_content_hash)) ||
+      (mips_size &&
+       !shared_memory().HashRangeContents(key.mip_page << 12, mips_size,
+                                          mips_content_hash))) {
+    return nullptr;
+  }
+  uint64_t content_hash =
+      GetTextureContentHash(key, base_content_hash, mips_content_hash);
+  auto content_range = textures_by_content_.equal_range(content_hash);
+  if (content_range.first == content_range.second) {
+    return nullptr;
+  }
+
+  auto global_lock = global_critical_region_.Acquire();
+  Texture* texture = nullptr;
+  for (auto content_it = content_range.first;
+       content_it != content_range.second; ++content_it) {
+    if (!content_it->second->base_outdated(global_lock) &&
+        !content_it->second->mips_outdated(global_lock)) {
+      texture = content_it->second;
+      break;
+    }
+  }
+  if (!texture ||
+      !shared_memory().IsRangeValid(key.base_page << 12,
+                                    xe::align(base_size, UINT32_C(16))) ||
+      !shared_memory().IsRangeValid(key.mip_page << 12,
+                                    xe::align(mips_size, UINT32_C(16)))) {
+    return nullptr;
+  }
+  TextureAlias& alias = texture_aliases_[key];
+  texture_aliases_by_texture_.emplace(texture, key);
+  alias.texture = texture;
+  alias.content_hash = content_hash;
+  if (base_size) {
+    alias.base_watch_handle = shared_memory().WatchMemoryRange(
+        key.base_page << 12, base_size, TextureAliasWatchCallback, &alias,
+        this, 0);
+  }
+  if (mips_size) {
+    alias.mips_watch_handle = shared_memory().WatchMemoryRange(
+        key.mip_page << 12, mips_size, TextureAliasWatchCallback, &alias,
+        this, 1);
+  }
+  COUNT_profile_set("gpu/texture_cache/content_hash_shared",
+                    texture_aliases_.size());
+  key.LogAction("Shared");
+  return texture;
+}
+
+void TextureCache::DestroyTextureAlias(
+    std::unordered_map<TextureKey, TextureAlias, TextureKey::Hasher>::iterator
+        alias_it) {
+  TextureAlias& alias = alias_it->second;
+  {
+    // Synchronize with the watch callbacks resetting the handles.
+    auto global_lock = global_critical_region_.Acquire();
+    if (alias.mips_watch_handle) {
+      shared_memory().UnwatchMemoryRange(alias.mips_watch_handle);
+    }
+    if (alias.base_watch_handle) {
+      shared_memory().UnwatchMemoryRange(alias.base_watch_handle);
+    }
+  }
+  auto owner_range = texture_aliases_by_texture_.equal_range(alias.texture);
+  for (auto owner_it = owner_range.first; owner_it != owner_range.second;
+       ++owner_it) {
+    if (owner_it->second == alias_it->first) {
+      texture_aliases_by_texture_.erase(owner_it);
+      break;
+    }
+  }
+  texture_aliases_.erase(alias_it);
+}
+
+void TextureCache::DestroyTextureAliases(const Texture* texture) {
+  auto owner_it = texture_aliases_by_texture_.find(texture);
+  while (owner_it != texture_aliases_by_texture_.end()) {
+    // Removes owner_it.
+    DestroyTextureAlias(texture_aliases_.find(owner_it->second));
+    owner_it = texture_aliases_by_texture_.find(texture);
+  }
+  COUNT_profile_set("gpu/texture_cache/content_hash_shared",
+                    texture_aliases_.size());
+}
+
+void TextureCache::RemoveTextureFromContentIndex(const Texture& texture) {
+  auto content_range = textures_by_content_.equal_range(texture.content_hash());
+  for (auto content_it = content_range.first;
+       content_it != content_range.second; ++content_it) {
+    if (content_it->second == &texture) {
+      textures_by_content_.erase(content_it);
+      return;
+    }
+  }
+}
+
+void TextureCache::TextureAliasWatchCallback(
+    const global_unique_lock_type& global_lock, void* context, void* data,
+    uint64_t argument, bool invalidated_by_gpu) {
+  TextureAlias& alias = *static_cast<TextureAlias*>(context);
+  if (argument) {
+    alias.mips_watch_handle = nullptr;
+  } else {
+    alias.base_watch_handle = nullptr;
+  }
+  alias.outdated = true;
+  static_cast<TextureCache*>(data)->texture_became_outdated_.store(
+      true, std::memory_order_release);
+}
+
 void TextureCache::BindingInfoFromFetchConstant(
     const xenos::xe_gpu_texture_fetch_t& fetch, TextureKey& key_out,
     uint8_t* swizzled_signs_out) {
@@ -91,6 +91,24 @@ class TextureCache {
     return draw_resolution_scale_x_ > 1 || draw_resolution_scale_y_ > 1;
   }
 
+  // Texture cache activity during one frame.
+  struct FrameStatistics {
+    uint32_t textures_created = 0;
+    // Destroyed because of the memory budget.
+    uint32_t textures_evicted = 0;
+    // Initial loads of the data of textures.
+    uint32_t textures_loaded = 0;
+    // Loads of the data of textures after it has been modified in the memory.
+    uint32_t textures_reloaded = 0;
+    // As of the end of the frame.
+    uint32_t textures_resident = 0;
+    uint64_t host_memory_usage = 0;
+  };
+  // Statistics of the last completed frame.
+  const FrameStatistics& last_frame_statistics() const {
+    return last_frame_statistics_;
+  }
+
   virtual void ClearCache();
 
   virtual void CompletedSubmissionUpdated(uint64_t completed_submission_index);
@@ -280,9 +298,24 @@ class TextureCache {
     bool base_outdated_lockless() const { return base_outdated_; }
     bool mips_outdated_lockless() const { return mips_outdated_; }
     bool MakeUpToDateAndWatch(const global_unique_lock_type& global_lock);
+    // Whether the data has been made up to date at least once.
+    bool has_been_loaded() const { return has_been_loaded_; }
 
     void WatchCallback(const global_unique_lock_type& global_lock, bool is_mip);
 
+    // Hashes of the guest data currently loaded into the host texture, for
+    // texture_cache_content_hash - 0 if not hashed, or if the data couldn't be
+    // hashed (such as when it was written by the GPU).
+    uint64_t base_content_hash() const { return base_content_hash_; }
+    uint64_t mips_content_hash() const { return mips_content_hash_; }
+    // Hash of the whole contents of the texture, including the key without the
+    // addresses, or 0 if any part hasn't been hashed.
+    uint64_t content_hash() const { return content_hash_; }
+    // Called after loading the data with the hashes of what has been loaded,
+    // makes the texture discoverable by other textures with the same contents.
+    void SetContentHashes(uint64_t base_content_hash,
+                          uint64_t mips_content_hash);
+
     // For LRU caching - updates the last usage frame and moves the texture to
     // the end of the usage queue. Must be called any time the texture is
     // referenced by any GPU work in the implementation to make sure it's not
@@ -331,9 +364,14 @@ class TextureCache {
     bool base_outdated_ = false;
     // Whether the recent mip data needs reloading from the memory.
     bool mips_outdated_ = false;
+    bool has_been_loaded_ = false;
     // Watch handles for the memory ranges.
     SharedMemory::WatchHandle base_watch_handle_ = nullptr;
     SharedMemory::WatchHandle mips_watch_handle_ = nullptr;
+
+    uint64_t base_content_hash_ = 0;
+    uint64_t mips_content_hash_ = 0;
+    uint64_t content_hash_ = 0;
   };
 
   // Rules of data access in load shaders:
@@ -419,6 +457,8 @@ class TextureCache {
   // loads / stores, for 8bpp and 16bpp+ respectively, can be used for untiling
   // regardless of the resolution scale).
 
+ public:
+  // Also used for loading on the CPU by texture_conversion.
   struct LoadConstants {
     uint32_t is_tiled_3d_endian_scale;
     // Base offset in bytes, resolution-scaled.
@@ -500,6 +540,13 @@ class TextureCache {
     }
   };
 
+  static const LoadShaderInfo& GetLoadShaderInfo(
+      LoadShaderIndex load_shader_index) {
+    assert_true(load_shader_index < kLoadShaderCount);
+    return load_shader_info_[load_shader_index];
+  }
+
+ protected:
   static constexpr uint8_t kSwizzledSignsUnsigned =
       uint8_t(xenos::TextureSign::kUnsigned) * uint8_t(0b01010101);
 
@@ -579,11 +626,6 @@ class TextureCache {
   // should be made.
   Texture* FindOrCreateTexture(TextureKey key);
 
-  static const LoadShaderInfo& GetLoadShaderInfo(
-      LoadShaderIndex load_shader_index) {
-    assert_true(load_shader_index < kLoadShaderCount);
-    return load_shader_info_[load_shader_index];
-  }
   // Integer num_format on fixed textures. Returns the packed scale used by the
   // shader to restore guest integer units from normalized host samples.
   static uint32_t GetIntegerScaleBits(xenos::TextureFormat guest_format,
@@ -629,6 +671,43 @@ class TextureCache {
                             void* context, void* data, uint64_t argument,
                             bool invalidated_by_gpu);
 
+  // Content hashing (texture_cache_content_hash).
+  // A texture key for which the data in the memory is the same as in a texture
+  // with a different key (at a different address), using that texture instead
+  // of creating a new one. The ranges of the key are watched separately to
+  // stop sharing when they are modified.
+  struct TextureAlias {
+    Texture* texture = nullptr;
+    // The content hash of the texture when the alias was created, if it has
+    // changed, the texture has been reloaded with different data.
+    uint64_t content_hash = 0;
+    SharedMemory::WatchHandle base_watch_handle = nullptr;
+    SharedMemory::WatchHandle mips_watch_handle = nullptr;
+    // To be accessed within the global critical region.
+    bool outdated = false;
+  };
+  static uint64_t GetTextureContentHash(TextureKey key,
+                                        uint64_t base_content_hash,
+                                        uint64_t mips_content_hash);
+  // Hashes the parts of the texture that are about to be reloaded (the ranges
+  // must be requested in the shared memory already), and removes the parts that
+  // contain the same data as currently loaded from loading. Returns the hashes
+  // to pass to SetContentHashes after loading.
+  void SkipUnchangedTextureParts(const Texture& texture, bool& load_base,
+                                 bool& load_mips, uint64_t& base_content_hash,
+                                 uint64_t& mips_content_hash);
+  // Returns an existing texture with the same contents as the memory currently
+  // referenced by the key, or nullptr if there's none.
+  Texture* FindOrCreateTextureAlias(const TextureKey& key);
+  void DestroyTextureAlias(
+      std::unordered_map<TextureKey, TextureAlias,
+                         TextureKey::Hasher>::iterator alias_it);
+  void DestroyTextureAliases(const Texture* texture);
+  void RemoveTextureFromContentIndex(const Texture& texture);
+  static void TextureAliasWatchCallback(
+      const global_unique_lock_type& global_lock, void* context, void* data,
+      uint64_t argument, bool invalidated_by_gpu);
+
   // Checks if there are any pages that contain scaled resolve data within the
   // range.
   bool IsRangeScaledResolved(uint32_t start_unscaled, uint32_t length_unscaled);
@@ -668,11 +747,22 @@ class TextureCache {
   std::unordered_map<TextureKey, std::unique_ptr<Texture>, TextureKey::Hasher>
       textures_;
 
+  // Textures with loaded data known completely, by content hash.
+  std::unordered_multimap<uint64_t, Texture*> textures_by_content_;
+  std::unordered_map<TextureKey, TextureAlias, TextureKey::Hasher>
+      texture_aliases_;
+  // Keys of texture_aliases_ by the texture they're using.
+  std::unordered_multimap<const Texture*, TextureKey>
+      texture_aliases_by_texture_;
+
   uint64_t textures_total_host_memory_usage_ = 0;
 
   Texture* texture_used_first_ = nullptr;
   Texture* texture_used_last_ = nullptr;
 
+  FrameStatistics frame_statistics_;
+  FrameStatistics last_frame_statistics_;
+
   // Whether a texture has become outdated (a memory watch has been triggered),
   // so need to recheck if textures aren't outdated, disregarding whether fetch
   // constants have been changed.
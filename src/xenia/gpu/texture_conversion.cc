@@ -0,0 +1,1805 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/texture_conversion.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/platform.h"
+#include "xenia/gpu/texture_address.h"
+#include "xenia/gpu/xenos.h"
+
+#if XE_ARCH_ARM64
+#include <arm_neon.h>
+#endif
+
+namespace xe {
+namespace gpu {
+namespace texture_conversion {
+
+namespace {
+
+// The kernels below are written against a uint4-like vector of 32-bit
+// components, mirroring the shader code (see the corresponding functions in
+// pixel_formats.xesli and the texture_load_*.xesl shaders) so they can be
+// compared easily. Lane-wise shifts are by amounts known at compile time in
+// all the callers, so they're folded into immediates.
+
+class U32x4Scalar {
+ public:
+  U32x4Scalar() = default;
+
+  static U32x4Scalar Splat(uint32_t x) { return Set(x, x, x, x); }
+  static U32x4Scalar Set(uint32_t x, uint32_t y, uint32_t z, uint32_t w) {
+    U32x4Scalar r;
+    r.v_[0] = x;
+    r.v_[1] = y;
+    r.v_[2] = z;
+    r.v_[3] = w;
+    return r;
+  }
+  static U32x4Scalar Load(const void* source) {
+    U32x4Scalar r;
+    std::memcpy(r.v_, source, sizeof(r.v_));
+    return r;
+  }
+  void Store(void* dest) const { std::memcpy(dest, v_, sizeof(v_)); }
+
+  template <unsigned int kLane>
+  uint32_t Lane() const {
+    return v_[kLane];
+  }
+
+#define XE_U32X4_SCALAR_BINARY_OP(op)                                   \
+  friend U32x4Scalar operator op(const U32x4Scalar& a,                  \
+                                 const U32x4Scalar& b) {                \
+    return Set(a.v_[0] op b.v_[0], a.v_[1] op b.v_[1], a.v_[2] op b.v_[2], \
+               a.v_[3] op b.v_[3]);                                     \
+  }                                                                     \
+  friend U32x4Scalar operator op(const U32x4Scalar& a, uint32_t b) {    \
+    return a op Splat(b);                                               \
+  }
+  XE_U32X4_SCALAR_BINARY_OP(&)
+  XE_U32X4_SCALAR_BINARY_OP(|)
+  XE_U32X4_SCALAR_BINARY_OP(^)
+  XE_U32X4_SCALAR_BINARY_OP(+)
+  XE_U32X4_SCALAR_BINARY_OP(-)
+  XE_U32X4_SCALAR_BINARY_OP(*)
+#undef XE_U32X4_SCALAR_BINARY_OP
+
+  friend U32x4Scalar operator~(const U32x4Scalar& a) {
+    return Set(~a.v_[0], ~a.v_[1], ~a.v_[2], ~a.v_[3]);
+  }
+  friend U32x4Scalar operator<<(const U32x4Scalar& a, unsigned int shift) {
+    return Set(a.v_[0] << shift, a.v_[1] << shift, a.v_[2] << shift,
+               a.v_[3] << shift);
+  }
+  friend U32x4Scalar operator>>(const U32x4Scalar& a, unsigned int shift) {
+    return Set(a.v_[0] >> shift, a.v_[1] >> shift, a.v_[2] >> shift,
+               a.v_[3] >> shift);
+  }
+
+  static U32x4Scalar ShlLanes(const U32x4Scalar& a, unsigned int x,
+                              unsigned int y, unsigned int z, unsigned int w) {
+    return Set(a.v_[0] << x, a.v_[1] << y, a.v_[2] << z, a.v_[3] << w);
+  }
+  static U32x4Scalar ShrLanes(const U32x4Scalar& a, unsigned int x,
+                              unsigned int y, unsigned int z, unsigned int w) {
+    return Set(a.v_[0] >> x, a.v_[1] >> y, a.v_[2] >> z, a.v_[3] >> w);
+  }
+  static U32x4Scalar ShrSigned(const U32x4Scalar& a, unsigned int shift) {
+    return Set(uint32_t(int32_t(a.v_[0]) >> shift),
+               uint32_t(int32_t(a.v_[1]) >> shift),
+               uint32_t(int32_t(a.v_[2]) >> shift),
+               uint32_t(int32_t(a.v_[3]) >> shift));
+  }
+
+  // Comparisons return all ones in the lanes where they're true.
+  static U32x4Scalar Equal(const U32x4Scalar& a, const U32x4Scalar& b) {
+    return Set(a.v_[0] == b.v_[0] ? UINT32_MAX : 0,
+               a.v_[1] == b.v_[1] ? UINT32_MAX : 0,
+               a.v_[2] == b.v_[2] ? UINT32_MAX : 0,
+               a.v_[3] == b.v_[3] ? UINT32_MAX : 0);
+  }
+  static U32x4Scalar GreaterSigned(const U32x4Scalar& a,
+                                   const U32x4Scalar& b) {
+    return Set(int32_t(a.v_[0]) > int32_t(b.v_[0]) ? UINT32_MAX : 0,
+               int32_t(a.v_[1]) > int32_t(b.v_[1]) ? UINT32_MAX : 0,
+               int32_t(a.v_[2]) > int32_t(b.v_[2]) ? UINT32_MAX : 0,
+               int32_t(a.v_[3]) > int32_t(b.v_[3]) ? UINT32_MAX : 0);
+  }
+  static U32x4Scalar Select(const U32x4Scalar& mask, const U32x4Scalar& a,
+                            const U32x4Scalar& b) {
+    return (a & mask) | (b & ~mask);
+  }
+
+  // (a.x, b.x, a.y, b.y) and (a.z, b.z, a.w, b.w).
+  static U32x4Scalar InterleaveLow(const U32x4Scalar& a,
+                                   const U32x4Scalar& b) {
+    return Set(a.v_[0], b.v_[0], a.v_[1], b.v_[1]);
+  }
+  static U32x4Scalar InterleaveHigh(const U32x4Scalar& a,
+                                    const U32x4Scalar& b) {
+    return Set(a.v_[2], b.v_[2], a.v_[3], b.v_[3]);
+  }
+  // (a.x, a.z, b.x, b.z) and (a.y, a.w, b.y, b.w).
+  static U32x4Scalar EvenLanes(const U32x4Scalar& a, const U32x4Scalar& b) {
+    return Set(a.v_[0], a.v_[2], b.v_[0], b.v_[2]);
+  }
+  static U32x4Scalar OddLanes(const U32x4Scalar& a, const U32x4Scalar& b) {
+    return Set(a.v_[1], a.v_[3], b.v_[1], b.v_[3]);
+  }
+
+  // Truncating, the components must fit.
+  static U32x4Scalar PackTo8(const U32x4Scalar& a, const U32x4Scalar& b,
+                             const U32x4Scalar& c, const U32x4Scalar& d) {
+    const U32x4Scalar* sources[] = {&a, &b, &c, &d};
+    U32x4Scalar r;
+    for (uint32_t i = 0; i < 4; ++i) {
+      const uint32_t* s = sources[i]->v_;
+      r.v_[i] = s[0] | (s[1] << 8) | (s[2] << 16) | (s[3] << 24);
+    }
+    return r;
+  }
+  static U32x4Scalar PackTo16(const U32x4Scalar& a, const U32x4Scalar& b) {
+    return Set(a.v_[0] | (a.v_[1] << 16), a.v_[2] | (a.v_[3] << 16),
+               b.v_[0] | (b.v_[1] << 16), b.v_[2] | (b.v_[3] << 16));
+  }
+
+  // Floating-point operations on the bits of 32-bit floats.
+  static U32x4Scalar ConvertSignedToFloat(const U32x4Scalar& a) {
+    return Set(std::bit_cast<uint32_t>(float(int32_t(a.v_[0]))),
+               std::bit_cast<uint32_t>(float(int32_t(a.v_[1]))),
+               std::bit_cast<uint32_t>(float(int32_t(a.v_[2]))),
+               std::bit_cast<uint32_t>(float(int32_t(a.v_[3]))));
+  }
+  static U32x4Scalar AddFloat(const U32x4Scalar& a, const U32x4Scalar& b) {
+    U32x4Scalar r;
+    for (uint32_t i = 0; i < 4; ++i) {
+      r.v_[i] = std::bit_cast<uint32_t>(std::bit_cast<float>(a.v_[i]) +
+                                        std::bit_cast<float>(b.v_[i]));
+    }
+    return r;
+  }
+  static U32x4Scalar MulFloat(const U32x4Scalar& a, float b) {
+    U32x4Scalar r;
+    for (uint32_t i = 0; i < 4; ++i) {
+      r.v_[i] = std::bit_cast<uint32_t>(std::bit_cast<float>(a.v_[i]) * b);
+    }
+    return r;
+  }
+  static U32x4Scalar MaxFloat(const U32x4Scalar& a, float b) {
+    U32x4Scalar r;
+    for (uint32_t i = 0; i < 4; ++i) {
+      r.v_[i] =
+          std::bit_cast<uint32_t>(std::max(b, std::bit_cast<float>(a.v_[i])));
+    }
+    return r;
+  }
+
+  // XeEndianSwap16 and XeEndianSwap32.
+  static U32x4Scalar EndianSwap16(const U32x4Scalar& a, xenos::Endian endian) {
+    if (endian == xenos::Endian::k8in16) {
+      return ((a & 0x00FF00FFu) << 8) | ((a & 0xFF00FF00u) >> 8);
+    }
+    return a;
+  }
+  static U32x4Scalar EndianSwap32(U32x4Scalar a, xenos::Endian endian) {
+    if (endian == xenos::Endian::k8in16 || endian == xenos::Endian::k8in32) {
+      a = ((a & 0x00FF00FFu) << 8) | ((a & 0xFF00FF00u) >> 8);
+    }
+    if (endian == xenos::Endian::k8in32 || endian == xenos::Endian::k16in32) {
+      a = (a << 16) | (a >> 16);
+    }
+    return a;
+  }
+
+ private:
+  uint32_t v_[4];
+};
+
+#if XE_ARCH_AMD64
+
+// SSE4.1 (the build targets AVX).
+class U32x4SSE {
+ public:
+  static U32x4SSE Splat(uint32_t x) { return U32x4SSE(_mm_set1_epi32(x)); }
+  static U32x4SSE Set(uint32_t x, uint32_t y, uint32_t z, uint32_t w) {
+    return U32x4SSE(_mm_setr_epi32(x, y, z, w));
+  }
+  static U32x4SSE Load(const void* source) {
+    return U32x4SSE(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source)));
+  }
+  void Store(void* dest) const {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), v_);
+  }
+
+  template <unsigned int kLane>
+  uint32_t Lane() const {
+    return uint32_t(_mm_extract_epi32(v_, kLane));
+  }
+
+#define XE_U32X4_SSE_BINARY_OP(op, intrinsic)                              \
+  friend U32x4SSE operator op(const U32x4SSE& a, const U32x4SSE& b) {      \
+    return U32x4SSE(intrinsic(a.v_, b.v_));                                \
+  }                                                                        \
+  friend U32x4SSE operator op(const U32x4SSE& a, uint32_t b) {             \
+    return a op Splat(b);                                                  \
+  }
+  XE_U32X4_SSE_BINARY_OP(&, _mm_and_si128)
+  XE_U32X4_SSE_BINARY_OP(|, _mm_or_si128)
+  XE_U32X4_SSE_BINARY_OP(^, _mm_xor_si128)
+  XE_U32X4_SSE_BINARY_OP(+, _mm_add_epi32)
+  XE_U32X4_SSE_BINARY_OP(-, _mm_sub_epi32)
+  XE_U32X4_SSE_BINARY_OP(*, _mm_mullo_epi32)
+#undef XE_U32X4_SSE_BINARY_OP
+
+  friend U32x4SSE operator~(const U32x4SSE& a) {
+    return U32x4SSE(_mm_xor_si128(a.v_, _mm_set1_epi32(-1)));
+  }
+  friend U32x4SSE operator<<(const U32x4SSE& a, unsigned int shift) {
+    return U32x4SSE(_mm_slli_epi32(a.v_, int(shift)));
+  }
+  friend U32x4SSE operator>>(const U32x4SSE& a, unsigned int shift) {
+    return U32x4SSE(_mm_srli_epi32(a.v_, int(shift)));
+  }
+
+  static U32x4SSE ShlLanes(const U32x4SSE& a, unsigned int x, unsigned int y,
+                           unsigned int z, unsigned int w) {
+    if (x == y && y == z && z == w) {
+      return a << x;
+    }
+    return U32x4SSE(_mm_mullo_epi32(
+        a.v_, _mm_setr_epi32(1 << x, 1 << y, 1 << z, 1 << w)));
+  }
+  static U32x4SSE ShrLanes(const U32x4SSE& a, unsigned int x, unsigned int y,
+                           unsigned int z, unsigned int w) {
+    if (x == y && y == z && z == w) {
+      return a >> x;
+    }
+    // Variable shifts are AVX2.
+    __m128i xy = _mm_blend_epi16(_mm_srli_epi32(a.v_, int(x)),
+                                 _mm_srli_epi32(a.v_, int(y)), 0b00001100);
+    __m128i zw = _mm_blend_epi16(_mm_srli_epi32(a.v_, int(z)),
+                                 _mm_srli_epi32(a.v_, int(w)), 0b11000000);
+    return U32x4SSE(_mm_blend_epi16(xy, zw, 0b11110000));
+  }
+  static U32x4SSE ShrSigned(const U32x4SSE& a, unsigned int shift) {
+    return U32x4SSE(_mm_srai_epi32(a.v_, int(shift)));
+  }
+
+  static U32x4SSE Equal(const U32x4SSE& a, const U32x4SSE& b) {
+    return U32x4SSE(_mm_cmpeq_epi32(a.v_, b.v_));
+  }
+  static U32x4SSE GreaterSigned(const U32x4SSE& a, const U32x4SSE& b) {
+    return U32x4SSE(_mm_cmpgt_epi32(a.v_, b.v_));
+  }
+  static U32x4SSE Select(const U32x4SSE& mask, const U32x4SSE& a,
+                         const U32x4SSE& b) {
+    return U32x4SSE(_mm_blendv_epi8(b.v_, a.v_, mask.v_));
+  }
+
+  static U32x4SSE InterleaveLow(const U32x4SSE& a, const U32x4SSE& b) {
+    return U32x4SSE(_mm_unpacklo_epi32(a.v_, b.v_));
+  }
+  static U32x4SSE InterleaveHigh(const U32x4SSE& a, const U32x4SSE& b) {
+    return U32x4SSE(_mm_unpackhi_epi32(a.v_, b.v_));
+  }
+  static U32x4SSE EvenLanes(const U32x4SSE& a, const U32x4SSE& b) {
+    return U32x4SSE(_mm_castps_si128(
+        _mm_shuffle_ps(_mm_castsi128_ps(a.v_), _mm_castsi128_ps(b.v_),
+                       _MM_SHUFFLE(2, 0, 2, 0))));
+  }
+  static U32x4SSE OddLanes(const U32x4SSE& a, const U32x4SSE& b) {
+    return U32x4SSE(_mm_castps_si128(
+        _mm_shuffle_ps(_mm_castsi128_ps(a.v_), _mm_castsi128_ps(b.v_),
+                       _MM_SHUFFLE(3, 1, 3, 1))));
+  }
+
+  // Saturating, but the components must fit anyway for the same results as
+  // the other implementations.
+  static U32x4SSE PackTo8(const U32x4SSE& a, const U32x4SSE& b,
+                          const U32x4SSE& c, const U32x4SSE& d) {
+    return U32x4SSE(_mm_packus_epi16(_mm_packus_epi32(a.v_, b.v_),
+                                     _mm_packus_epi32(c.v_, d.v_)));
+  }
+  static U32x4SSE PackTo16(const U32x4SSE& a, const U32x4SSE& b) {
+    return U32x4SSE(_mm_packus_epi32(a.v_, b.v_));
+  }
+
+  static U32x4SSE ConvertSignedToFloat(const U32x4SSE& a) {
+    return U32x4SSE(_mm_castps_si128(_mm_cvtepi32_ps(a.v_)));
+  }
+  static U32x4SSE AddFloat(const U32x4SSE& a, const U32x4SSE& b) {
+    return U32x4SSE(_mm_castps_si128(
+        _mm_add_ps(_mm_castsi128_ps(a.v_), _mm_castsi128_ps(b.v_))));
+  }
+  static U32x4SSE MulFloat(const U32x4SSE& a, float b) {
+    return U32x4SSE(_mm_castps_si128(
+        _mm_mul_ps(_mm_castsi128_ps(a.v_), _mm_set1_ps(b))));
+  }
+  static U32x4SSE MaxFloat(const U32x4SSE& a, float b) {
+    return U32x4SSE(_mm_castps_si128(
+        _mm_max_ps(_mm_castsi128_ps(a.v_), _mm_set1_ps(b))));
+  }
+
+  static __m128i GetEndianSwap16Shuffle(xenos::Endian endian) {
+    if (endian == xenos::Endian::k8in16) {
+      return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15,
+                           14);
+    }
+    return _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  }
+  static __m128i GetEndianSwap32Shuffle(xenos::Endian endian) {
+    switch (endian) {
+      case xenos::Endian::k8in16:
+        return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15,
+                             14);
+      case xenos::Endian::k8in32:
+        return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13,
+                             12);
+      case xenos::Endian::k16in32:
+        return _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12,
+                             13);
+      default:
+        return _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+                             15);
+    }
+  }
+  static U32x4SSE EndianSwap16(const U32x4SSE& a, xenos::Endian endian) {
+    if (endian != xenos::Endian::k8in16) {
+      return a;
+    }
+    return U32x4SSE(_mm_shuffle_epi8(a.v_, GetEndianSwap16Shuffle(endian)));
+  }
+  static U32x4SSE EndianSwap32(const U32x4SSE& a, xenos::Endian endian) {
+    if (endian == xenos::Endian::kNone) {
+      return a;
+    }
+    return U32x4SSE(_mm_shuffle_epi8(a.v_, GetEndianSwap32Shuffle(endian)));
+  }
+
+  U32x4SSE() = default;
+
+ private:
+  explicit U32x4SSE(__m128i v) : v_(v) {}
+
+  __m128i v_;
+};
+using U32x4Simd = U32x4SSE;
+
+#elif XE_ARCH_ARM64
+
+class U32x4NEON {
+ public:
+  static U32x4NEON Splat(uint32_t x) { return U32x4NEON(vdupq_n_u32(x)); }
+  static U32x4NEON Set(uint32_t x, uint32_t y, uint32_t z, uint32_t w) {
+    const uint32_t components[] = {x, y, z, w};
+    return U32x4NEON(vld1q_u32(components));
+  }
+  static U32x4NEON Load(const void* source) {
+    return U32x4NEON(
+        vreinterpretq_u32_u8(vld1q_u8(static_cast<const uint8_t*>(source))));
+  }
+  void Store(void* dest) const {
+    vst1q_u8(static_cast<uint8_t*>(dest), vreinterpretq_u8_u32(v_));
+  }
+
+  template <unsigned int kLane>
+  uint32_t Lane() const {
+    return vgetq_lane_u32(v_, kLane);
+  }
+
+#define XE_U32X4_NEON_BINARY_OP(op, intrinsic)                              \
+  friend U32x4NEON operator op(const U32x4NEON& a, const U32x4NEON& b) {    \
+    return U32x4NEON(intrinsic(a.v_, b.v_));                                \
+  }                                                                         \
+  friend U32x4NEON operator op(const U32x4NEON& a, uint32_t b) {            \
+    return a op Splat(b);                                                   \
+  }
+  XE_U32X4_NEON_BINARY_OP(&, vandq_u32)
+  XE_U32X4_NEON_BINARY_OP(|, vorrq_u32)
+  XE_U32X4_NEON_BINARY_OP(^, veorq_u32)
+  XE_U32X4_NEON_BINARY_OP(+, vaddq_u32)
+  XE_U32X4_NEON_BINARY_OP(-, vsubq_u32)
+  XE_U32X4_NEON_BINARY_OP(*, vmulq_u32)
+#undef XE_U32X4_NEON_BINARY_OP
+
+  friend U32x4NEON operator~(const U32x4NEON& a) {
+    return U32x4NEON(vmvnq_u32(a.v_));
+  }
+  friend U32x4NEON operator<<(const U32x4NEON& a, unsigned int shift) {
+    return U32x4NEON(vshlq_u32(a.v_, vdupq_n_s32(int32_t(shift))));
+  }
+  friend U32x4NEON operator>>(const U32x4NEON& a, unsigned int shift) {
+    return U32x4NEON(vshlq_u32(a.v_, vdupq_n_s32(-int32_t(shift))));
+  }
+
+  static U32x4NEON ShlLanes(const U32x4NEON& a, unsigned int x, unsigned int y,
+                            unsigned int z, unsigned int w) {
+    const int32_t shifts[] = {int32_t(x), int32_t(y), int32_t(z), int32_t(w)};
+    return U32x4NEON(vshlq_u32(a.v_, vld1q_s32(shifts)));
+  }
+  static U32x4NEON ShrLanes(const U32x4NEON& a, unsigned int x, unsigned int y,
+                            unsigned int z, unsigned int w) {
+    const int32_t shifts[] = {-int32_t(x), -int32_t(y), -int32_t(z),
+                              -int32_t(w)};
+    return U32x4NEON(vshlq_u32(a.v_, vld1q_s32(shifts)));
+  }
+  static U32x4NEON ShrSigned(const U32x4NEON& a, unsigned int shift) {
+    return U32x4NEON(vreinterpretq_u32_s32(vshlq_s32(
+        vreinterpretq_s32_u32(a.v_), vdupq_n_s32(-int32_t(shift)))));
+  }
+
+  static U32x4NEON Equal(const U32x4NEON& a, const U32x4NEON& b) {
+    return U32x4NEON(vceqq_u32(a.v_, b.v_));
+  }
+  static U32x4NEON GreaterSigned(const U32x4NEON& a, const U32x4NEON& b) {
+    return U32x4NEON(
+        vcgtq_s32(vreinterpretq_s32_u32(a.v_), vreinterpretq_s32_u32(b.v_)));
+  }
+  static U32x4NEON Select(const U32x4NEON& mask, const U32x4NEON& a,
+                          const U32x4NEON& b) {
+    return U32x4NEON(vbslq_u32(mask.v_, a.v_, b.v_));
+  }
+
+  static U32x4NEON InterleaveLow(const U32x4NEON& a, const U32x4NEON& b) {
+    return U32x4NEON(vzip1q_u32(a.v_, b.v_));
+  }
+  static U32x4NEON InterleaveHigh(const U32x4NEON& a, const U32x4NEON& b) {
+    return U32x4NEON(vzip2q_u32(a.v_, b.v_));
+  }
+  static U32x4NEON EvenLanes(const U32x4NEON& a, const U32x4NEON& b) {
+    return U32x4NEON(vuzp1q_u32(a.v_, b.v_));
+  }
+  static U32x4NEON OddLanes(const U32x4NEON& a, const U32x4NEON& b) {
+    return U32x4NEON(vuzp2q_u32(a.v_, b.v_));
+  }
+
+  // Truncating, the components must fit.
+  static U32x4NEON PackTo8(const U32x4NEON& a, const U32x4NEON& b,
+                           const U32x4NEON& c, const U32x4NEON& d) {
+    uint16x8_t ab = vcombine_u16(vmovn_u32(a.v_), vmovn_u32(b.v_));
+    uint16x8_t cd = vcombine_u16(vmovn_u32(c.v_), vmovn_u32(d.v_));
+    return U32x4NEON(
+        vreinterpretq_u32_u8(vcombine_u8(vmovn_u16(ab), vmovn_u16(cd))));
+  }
+  static U32x4NEON PackTo16(const U32x4NEON& a, const U32x4NEON& b) {
+    return U32x4NEON(vreinterpretq_u32_u16(
+        vcombine_u16(vmovn_u32(a.v_), vmovn_u32(b.v_))));
+  }
+
+  static U32x4NEON ConvertSignedToFloat(const U32x4NEON& a) {
+    return U32x4NEON(
+        vreinterpretq_u32_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(a.v_))));
+  }
+  static U32x4NEON AddFloat(const U32x4NEON& a, const U32x4NEON& b) {
+    return U32x4NEON(vreinterpretq_u32_f32(vaddq_f32(
+        vreinterpretq_f32_u32(a.v_), vreinterpretq_f32_u32(b.v_))));
+  }
+  static U32x4NEON MulFloat(const U32x4NEON& a, float b) {
+    return U32x4NEON(
+        vreinterpretq_u32_f32(vmulq_n_f32(vreinterpretq_f32_u32(a.v_), b)));
+  }
+  static U32x4NEON MaxFloat(const U32x4NEON& a, float b) {
+    return U32x4NEON(vreinterpretq_u32_f32(
+        vmaxq_f32(vreinterpretq_f32_u32(a.v_), vdupq_n_f32(b))));
+  }
+
+  static U32x4NEON EndianSwap16(const U32x4NEON& a, xenos::Endian endian) {
+    if (endian != xenos::Endian::k8in16) {
+      return a;
+    }
+    return U32x4NEON(vreinterpretq_u32_u8(vrev16q_u8(vreinterpretq_u8_u32(a.v_))));
+  }
+  static U32x4NEON EndianSwap32(const U32x4NEON& a, xenos::Endian endian) {
+    switch (endian) {
+      case xenos::Endian::k8in16:
+        return U32x4NEON(
+            vreinterpretq_u32_u8(vrev16q_u8(vreinterpretq_u8_u32(a.v_))));
+      case xenos::Endian::k8in32:
+        return U32x4NEON(
+            vreinterpretq_u32_u8(vrev32q_u8(vreinterpretq_u8_u32(a.v_))));
+      case xenos::Endian::k16in32:
+        return U32x4NEON(
+            vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(a.v_))));
+      default:
+        return a;
+    }
+  }
+
+  U32x4NEON() = default;
+
+ private:
+  explicit U32x4NEON(uint32x4_t v) : v_(v) {}
+
+  uint32x4_t v_;
+};
+using U32x4Simd = U32x4NEON;
+
+#endif  // XE_ARCH
+
+// Integer division of values below 2^16 by constants.
+template <typename V>
+V Div3(const V& a) {
+  return (a * 0xAAABu) >> 17;
+}
+template <typename V>
+V Div5(const V& a) {
+  return (a * 0xCCCDu) >> 18;
+}
+// Exact for values below 13110.
+template <typename V>
+V Div7(const V& a) {
+  return (a * 0x2493u) >> 16;
+}
+
+// pack_half_2x16 of the float bits in each component, rounding to the nearest
+// even like f32tof16 in Direct3D.
+template <typename V>
+V Float32To16(const V& f32) {
+  V sign = f32 & 0x80000000u;
+  V abs_f32 = f32 ^ sign;
+  // Normalized - rebias the exponent and round the mantissa.
+  V normalized =
+      (abs_f32 + (uint32_t(15 - 127) << 23) + 0xFFFu + ((abs_f32 >> 13) & 1u)) >>
+      13;
+  // Denormalized - let the floating-point addition of 0.5 do the rounding.
+  V denormalized = V::AddFloat(abs_f32, V::Splat(0x3F000000u)) - 0x3F000000u;
+  V f16 = V::Select(V::GreaterSigned(V::Splat(0x38800000u), abs_f32),
+                    denormalized, normalized);
+  // Overflow to infinity, NaN to a quiet NaN.
+  f16 = V::Select(V::GreaterSigned(abs_f32, V::Splat(0x477FFFFFu)),
+                  V::Splat(0x7C00u), f16);
+  f16 = V::Select(V::GreaterSigned(abs_f32, V::Splat(0x7F800000u)),
+                  V::Splat(0x7E00u), f16);
+  return f16 | (sign >> 16);
+}
+
+// pixel_formats.xesli.
+
+template <typename V>
+V R5G5B5A1ToB5G5R5A1(const V& packed_texels) {
+  return (packed_texels & 0x83E083E0u) |
+         ((packed_texels & 0x001F001Fu) << 10) |
+         ((packed_texels & 0x7C007C00u) >> 10);
+}
+
+template <typename V>
+V R5G6B5ToB5G6R5(const V& packed_texels) {
+  return (packed_texels & 0x07E007E0u) |
+         ((packed_texels & 0x001F001Fu) << 11) |
+         ((packed_texels & 0xF800F800u) >> 11);
+}
+
+template <typename V>
+V R5G5B6ToB5G6R5WithRBGASwizzle(const V& packed_texels) {
+  return ((packed_texels & 0x001F001Fu) << 11) |
+         ((packed_texels & 0xFFE0FFE0u) >> 5);
+}
+
+template <typename V>
+V R4G4B4A4ToB4G4R4A4(const V& packed_texels) {
+  return (packed_texels & 0xF0F0F0F0u) | ((packed_texels & 0x000F000Fu) << 8) |
+         ((packed_texels & 0x0F000F00u) >> 8);
+}
+
+template <typename V>
+V R4G4B4A4ToA4R4G4B4(const V& packed_texels) {
+  return ((packed_texels & 0x0FFF0FFFu) << 4) |
+         ((packed_texels & 0xF000F000u) >> 12);
+}
+
+template <typename V>
+V GBGR8ToGRGB8(const V& packed_texels) {
+  return (packed_texels & 0x00FF00FFu) | ((packed_texels & 0x0000FF00u) << 16) |
+         ((packed_texels & 0xFF000000u) >> 16);
+}
+
+template <typename V>
+V BGRG8ToRGBG8(const V& packed_texels) {
+  return (packed_texels & 0xFF00FF00u) | ((packed_texels & 0x000000FFu) << 16) |
+         ((packed_texels & 0x00FF0000u) >> 16);
+}
+
+template <typename V>
+void GBGR8ToRGB8WithRGBBSwizzle(const V& packed_texels, V& out_01,
+                                V& out_23) {
+  V rba = (packed_texels >> 24) |
+          (((packed_texels & 0x0000FF00u) << 8) * 0x101u);
+  V g_low = (packed_texels & 0x000000FFu) << 8;
+  V g_high = (packed_texels & 0x00FF0000u) >> 8;
+  out_01 = V::InterleaveLow(rba | g_low, rba | g_high);
+  out_23 = V::InterleaveHigh(rba | g_low, rba | g_high);
+}
+
+template <typename V>
+void BGRG8ToRGB8WithRGBBSwizzle(const V& packed_texels, V& out_01,
+                                V& out_23) {
+  V rba = ((packed_texels & 0x00FF0000u) >> 16) |
+          (((packed_texels & 0x000000FFu) << 16) * 0x101u);
+  V g_low = packed_texels & 0x0000FF00u;
+  V g_high = (packed_texels & 0xFF000000u) >> 16;
+  out_01 = V::InterleaveLow(rba | g_low, rba | g_high);
+  out_23 = V::InterleaveHigh(rba | g_low, rba | g_high);
+}
+
+template <typename V>
+void R10G11B11UNormToRGBA16(const V& packed_texels, V& out_01, V& out_23) {
+  V red_green = (((packed_texels & 1023u) << 6) |
+                 ((packed_texels >> 4) & 63u)) |
+                ((packed_texels & (2047u << 10)) << (21 - 10)) |
+                (packed_texels & (31u << 16));
+  V blue_alpha = ((((packed_texels >> 21) & 2047u) << 5) |
+                  ((packed_texels >> 27) & 31u)) |
+                 0xFFFF0000u;
+  out_01 = V::InterleaveLow(red_green, blue_alpha);
+  out_23 = V::InterleaveHigh(red_green, blue_alpha);
+}
+
+template <typename V>
+void R11G11B10UNormToRGBA16(const V& packed_texels, V& out_01, V& out_23) {
+  V red_green = (((packed_texels & 2047u) << 5) |
+                 ((packed_texels >> 6) & 31u)) |
+                ((packed_texels & (2047u << 11)) << (21 - 11)) |
+                ((packed_texels & (31u << 17)) >> (17 - 16));
+  V blue_alpha = ((((packed_texels >> 22) & 1023u) << 6) |
+                  ((packed_texels >> 26) & 63u)) |
+                 0xFFFF0000u;
+  out_01 = V::InterleaveLow(red_green, blue_alpha);
+  out_23 = V::InterleaveHigh(red_green, blue_alpha);
+}
+
+// Assuming the original number has only 10 bits.
+template <typename V>
+V SNorm10To16(V s10) {
+  V signs = s10 >> 9;
+  V is_negative = ~V::Equal(signs, V::Splat(0));
+  // -512 and -511 are both -1.0, but with -512 the conversion will overflow.
+  s10 = V::Select(V::Equal(s10, V::Splat(0x200u)), V::Splat(0x201u), s10);
+  // Take the absolute value.
+  s10 = (s10 ^ (is_negative & 0x3FFu)) + signs;
+  // Expand the 9-bit absolute value to 15 bits like unorm.
+  s10 = (s10 << 6) | (s10 >> 3);
+  // Apply the sign.
+  return (s10 ^ (is_negative & 0xFFFFu)) + signs;
+}
+
+// Assuming the original number has only 11 bits.
+template <typename V>
+V SNorm11To16(V s11) {
+  V signs = s11 >> 10;
+  V is_negative = ~V::Equal(signs, V::Splat(0));
+  // -1024 and -1023 are both -1.0, but with -1024 the conversion will overflow.
+  s11 = V::Select(V::Equal(s11, V::Splat(0x400u)), V::Splat(0x401u), s11);
+  // Take the absolute value.
+  s11 = (s11 ^ (is_negative & 0x7FFu)) + signs;
+  // Expand the 10-bit absolute value to 15 bits like unorm.
+  s11 = (s11 << 5) | (s11 >> 5);
+  // Apply the sign.
+  return (s11 ^ (is_negative & 0xFFFFu)) + signs;
+}
+
+template <typename V>
+void R10G11B11SNormToRGBA16(const V& packed_texels, V& out_01, V& out_23) {
+  V red_green = SNorm10To16(packed_texels & 1023u) |
+                (SNorm11To16((packed_texels >> 10) & 2047u) << 16);
+  V blue_alpha = SNorm11To16(packed_texels >> 21) | 0x7FFF0000u;
+  out_01 = V::InterleaveLow(red_green, blue_alpha);
+  out_23 = V::InterleaveHigh(red_green, blue_alpha);
+}
+
+template <typename V>
+void R11G11B10SNormToRGBA16(const V& packed_texels, V& out_01, V& out_23) {
+  V red_green = SNorm11To16(packed_texels & 2047u) |
+                (SNorm11To16((packed_texels >> 11) & 2047u) << 16);
+  V blue_alpha = SNorm10To16(packed_texels >> 22) | 0x7FFF0000u;
+  out_01 = V::InterleaveLow(red_green, blue_alpha);
+  out_23 = V::InterleaveHigh(red_green, blue_alpha);
+}
+
+template <typename V>
+V RG16UNormToRG16Float(const V& packed_texels) {
+  V r = V::MulFloat(V::ConvertSignedToFloat(packed_texels & 0xFFFFu),
+                    1.0f / 65535.0f);
+  V g = V::MulFloat(V::ConvertSignedToFloat(packed_texels >> 16),
+                    1.0f / 65535.0f);
+  return Float32To16(r) | (Float32To16(g) << 16);
+}
+
+template <typename V>
+V RG16SNormToRG16Float(const V& packed_texels) {
+  V r = V::MaxFloat(
+      V::MulFloat(V::ConvertSignedToFloat(V::ShrSigned(packed_texels << 16, 16)),
+                  1.0f / 32767.0f),
+      -1.0f);
+  V g = V::MaxFloat(
+      V::MulFloat(V::ConvertSignedToFloat(V::ShrSigned(packed_texels, 16)),
+                  1.0f / 32767.0f),
+      -1.0f);
+  return Float32To16(r) | (Float32To16(g) << 16);
+}
+
+template <typename V>
+V DepthUNorm24To32(const V& blocks) {
+  // XeUNorm24To32 - division by 2^24 is exact.
+  V n24 = blocks >> 8;
+  return V::MulFloat(V::ConvertSignedToFloat(n24 + (n24 >> 23)),
+                     1.0f / 16777216.0f);
+}
+
+template <typename V>
+V DepthFloat20e4To32(const V& blocks) {
+  // XeFloat20e4To32. Instead of normalizing the denormalized 20e4 mantissa
+  // using the leading zero count, take the exact conversion of it to a float,
+  // which is 2^(20 - (1 - 15)) = 2^34 times the value - subtract 34 from the
+  // exponent.
+  V f24 = blocks >> 8;
+  V mantissa = f24 & 0xFFFFFu;
+  V exponent = f24 >> 20;
+  V normalized = ((exponent + 112u) << 23) | (mantissa << 3);
+  V denormalized = V::ConvertSignedToFloat(mantissa) - (34u << 23);
+  V f32 = V::Select(V::Equal(exponent, V::Splat(0)), denormalized, normalized);
+  return V::Select(V::Equal(f24, V::Splat(0)), V::Splat(0), f32);
+}
+
+// Per-block parts of DXT decompression, on scalars, same as in the shaders.
+
+void DXTColorEndpointsToBGR8In10(uint32_t bgr_end_565, uint32_t& end_0,
+                                 uint32_t& end_1) {
+  end_0 = ((bgr_end_565 << 3) & (31u << 3)) |
+          ((bgr_end_565 << (12 - 5)) & (63u << 12)) |
+          ((bgr_end_565 << (23 - 11)) & (31u << 23));
+  end_1 = ((bgr_end_565 >> (16 - 3)) & (31u << 3)) |
+          ((bgr_end_565 >> (21 - 12)) & (63u << 12)) |
+          ((bgr_end_565 >> (27 - 23)) & (31u << 23));
+  // Apply the lower bit replication to give full dynamic range.
+  end_0 |= (end_0 >> 5) & (7u | (7u << 20));
+  end_1 |= (end_1 >> 5) & (7u | (7u << 20));
+  end_0 |= (end_0 >> 6) & (3u << 10);
+  end_1 |= (end_1 >> 6) & (3u << 10);
+}
+
+uint32_t DXTHighColorWeights(uint32_t codes) {
+  codes = ((codes & 0x55555555u) << 1) | ((codes & 0xAAAAAAAAu) >> 1);
+  return codes ^ ((codes & 0xAAAAAAAAu) >> 1);
+}
+
+uint32_t DXT1TransWeights(uint32_t codes) {
+  codes = ~codes;
+  return codes ^ ((codes & 0x55555555u) << 1);
+}
+
+uint32_t DXT5High8StepAlphaWeights(uint32_t codes_24b) {
+  uint32_t is_first = ((codes_24b & 0x249249u) |
+                       ((codes_24b & 0x492492u) >> 1) |
+                       ((codes_24b & 0x924924u) >> 2)) ^
+                      0x249249u;
+  uint32_t is_second = (codes_24b & 0x249249u) &
+                       ~((codes_24b & 0x492492u) >> 1) &
+                       ~((codes_24b & 0x924924u) >> 2);
+  return ((codes_24b | is_first) - 0x249249u) | is_second | (is_second << 1) |
+         (is_second << 2);
+}
+
+uint32_t DXT5High6StepAlphaWeights(uint32_t codes_24b) {
+  uint32_t is_constant =
+      codes_24b & 0x492492u & ((codes_24b & 0x924924u) >> 1);
+  is_constant |= (is_constant << 1) | (is_constant >> 1);
+  uint32_t constant_values =
+      ((codes_24b & 0x249249u) | (0x492492u | 0x924924u)) & is_constant;
+  uint32_t is_first = ((codes_24b & 0x249249u) |
+                       ((codes_24b & 0x492492u) >> 1) |
+                       ((codes_24b & 0x924924u) >> 2)) ^
+                      0x249249u;
+  uint32_t is_second = (codes_24b & 0x249249u) &
+                       ~((codes_24b & 0x492492u) >> 1) &
+                       ~((codes_24b & 0x924924u) >> 2);
+  codes_24b =
+      ((codes_24b | is_first) - 0x249249u) | is_second | (is_second << 2);
+  return (codes_24b & ~is_constant) | constant_values;
+}
+
+uint32_t DXT5HighAlphaWeights(uint32_t end_0, uint32_t end_1,
+                              uint32_t codes_24b) {
+  return end_0 <= end_1 ? DXT5High6StepAlphaWeights(codes_24b)
+                        : DXT5High8StepAlphaWeights(codes_24b);
+}
+
+// Per-row parts, on vectors of the 4 texels of a row of a block.
+
+// XeDXTOpaqueRowToRGB8, weights_high shifted right by 8 * row index.
+template <typename V>
+V DXTOpaqueRowToRGB8(uint32_t end_0, uint32_t end_1, uint32_t weights_high) {
+  V bgr_row_8in10_3x =
+      (V::ShrLanes(V::Splat(~weights_high), 0, 2, 4, 6) & 3u) * end_0 +
+      (V::ShrLanes(V::Splat(weights_high), 0, 2, 4, 6) & 3u) * end_1;
+  return (Div3(bgr_row_8in10_3x & 1023u) << 16) |
+         (Div3((bgr_row_8in10_3x >> 10) & 1023u) << 8) |
+         Div3(bgr_row_8in10_3x >> 20);
+}
+
+// XeDXT1TransRowToRGBA8, weights shifted right by 8 * row index.
+template <typename V>
+V DXT1TransRowToRGBA8(uint32_t end_0, uint32_t end_1, uint32_t weights) {
+  V weights_low = V::ShrLanes(V::Splat(weights), 0, 2, 4, 6) & 1u;
+  V weights_high = V::ShrLanes(V::Splat(weights), 1, 3, 5, 7) & 1u;
+  V bgr_row_8in10_scaled = weights_low * end_0 + weights_high * end_1;
+  // Whether the texel is (RGB0+RGB1)/2 - divide the weighted sum by 2 (shift
+  // right by 1) if it is.
+  V is_half = V::Equal(weights_low & weights_high, V::Splat(1));
+  V b = bgr_row_8in10_scaled & 1023u;
+  V g = (bgr_row_8in10_scaled >> 10) & 1023u;
+  V r = bgr_row_8in10_scaled >> 20;
+  b = V::Select(is_half, b >> 1, b);
+  g = V::Select(is_half, g >> 1, g);
+  r = V::Select(is_half, r >> 1, r);
+  // Whether the texel is opaque.
+  V alpha = (weights_low | weights_high) * 0xFF000000u;
+  return (b << 16) + (g << 8) + r + alpha;
+}
+
+// XeDXT5RowToA8, one alpha per component rather than per byte, weights from
+// DXT5HighAlphaWeights shifted right by 12 * (row index & 1).
+template <typename V>
+V DXT5RowToA8(uint32_t end_0, uint32_t end_1, uint32_t weights) {
+  V weights_high = V::ShrLanes(V::Splat(weights), 0, 3, 6, 9) & 7u;
+  if (end_0 <= end_1) {
+    // 6 and 7 are constant 0 and 1, excluded from the interpolation.
+    V is_constant = V::GreaterSigned(weights_high, V::Splat(5));
+    V weights_high_interp = weights_high & ~is_constant;
+    V weights_low_interp = (V::Splat(5) - weights_high_interp) & ~is_constant;
+    return Div5(weights_low_interp * end_0 + weights_high_interp * end_1) +
+           (weights_high & is_constant & 1u) * 0xFFu;
+  }
+  return Div7((V::Splat(7) - weights_high) * end_0 + weights_high * end_1);
+}
+
+// XeCTX1TwoBlocksRowToR8G8 for one block, one R8G8 texel per component, with
+// the endpoints as 0x00gg00rr, weights shifted right by 8 * row index.
+template <typename V>
+V CTX1RowToR8G8(uint32_t end_0, uint32_t end_1, uint32_t weights_high) {
+  V row_8in16 =
+      (V::ShrLanes(V::Splat(~weights_high), 0, 2, 4, 6) & 3u) * end_0 +
+      (V::ShrLanes(V::Splat(weights_high), 0, 2, 4, 6) & 3u) * end_1;
+  return Div3(row_8in16 & 0xFFFFu) | (Div3(row_8in16 >> 16) << 8);
+}
+
+// XeDXT3FourBlocksRowToA8.
+template <typename V>
+V DXT3FourBlocksRowToA8(const V& alphas) {
+  return (alphas & 0xFu) | ((alphas & 0xFFu) << 4) | ((alphas & 0xFF0u) << 8) |
+         ((alphas & 0xFF00u) << 12) | ((alphas & 0xF000u) << 16);
+}
+
+template <typename V>
+V DXT3AAs1111TwoBlocksRowToBGRA4(uint32_t halfblock_0, uint32_t halfblock_1) {
+  V halfblocks = V::Set(halfblock_0, halfblock_0, halfblock_1, halfblock_1);
+  V row = ((V::ShrLanes(halfblocks, 3, 11, 3, 11) & 1u) << 8) |
+          ((V::ShrLanes(halfblocks, 7, 15, 7, 15) & 1u) << 24) |
+          ((V::ShrLanes(halfblocks, 2, 10, 2, 10) & 1u) << 4) |
+          ((V::ShrLanes(halfblocks, 6, 14, 6, 14) & 1u) << 20) |
+          (V::ShrLanes(halfblocks, 1, 9, 1, 9) & 1u) |
+          ((V::ShrLanes(halfblocks, 5, 13, 5, 13) & 1u) << 16) |
+          ((V::ShrLanes(halfblocks, 0, 8, 0, 8) & 1u) << 12) |
+          ((V::ShrLanes(halfblocks, 4, 12, 4, 12) & 1u) << 28);
+  row = row | (row << 1);
+  return row | (row << 2);
+}
+
+template <typename V>
+V DXT3AAs1111TwoBlocksRowToARGB4(uint32_t halfblock_0, uint32_t halfblock_1) {
+  V halfblocks = V::Set(halfblock_0, halfblock_0, halfblock_1, halfblock_1);
+  V row = ((V::ShrLanes(halfblocks, 3, 11, 3, 11) & 1u) << 4) |
+          ((V::ShrLanes(halfblocks, 7, 15, 7, 15) & 1u) << 20) |
+          ((V::ShrLanes(halfblocks, 2, 10, 2, 10) & 1u) << 8) |
+          ((V::ShrLanes(halfblocks, 6, 14, 6, 14) & 1u) << 24) |
+          ((V::ShrLanes(halfblocks, 1, 9, 1, 9) & 1u) << 12) |
+          ((V::ShrLanes(halfblocks, 5, 13, 5, 13) & 1u) << 28) |
+          (V::ShrLanes(halfblocks, 0, 8, 0, 8) & 1u) |
+          ((V::ShrLanes(halfblocks, 4, 12, 4, 12) & 1u) << 16);
+  row = row | (row << 1);
+  return row | (row << 2);
+}
+
+// texture_load.xesli.
+
+struct LoadContext {
+  const uint8_t* source;
+  size_t source_size;
+  uint8_t* dest;
+  size_t dest_size;
+  bool is_tiled;
+  bool is_3d;
+  xenos::Endian endian;
+  uint32_t guest_offset;
+  uint32_t guest_pitch_aligned;
+  uint32_t guest_z_stride_block_rows_aligned;
+  uint32_t size_blocks[3];
+  uint32_t host_offset;
+  uint32_t host_pitch;
+  uint32_t height_texels;
+};
+
+// XeTextureLoadSourceAddress.
+uint32_t GetSourceAddress(const LoadContext& context, uint32_t x, uint32_t y,
+                          uint32_t z, uint32_t bytes_per_block_log2) {
+  uint32_t address;
+  if (!context.is_tiled) {
+    address = (x + context.guest_pitch_aligned *
+                       (y + context.guest_z_stride_block_rows_aligned * z))
+              << bytes_per_block_log2;
+  } else if (context.is_3d) {
+    address = uint32_t(texture_address::Tiled3D(
+        int32_t(x), int32_t(y), int32_t(z), context.guest_pitch_aligned,
+        context.guest_z_stride_block_rows_aligned, bytes_per_block_log2));
+  } else {
+    address = uint32_t(texture_address::Tiled2D(
+        int32_t(x), int32_t(y), context.guest_pitch_aligned,
+        bytes_per_block_log2));
+  }
+  return address + context.guest_offset;
+}
+
+// XeTextureLoadLocalXAddressXor.
+uint32_t GetLocalXAddressXor(uint32_t x, uint32_t bytes_per_block_log2,
+                             bool is_tiled) {
+  if (is_tiled) {
+    return uint32_t(texture_address::TiledCombine(
+        int32_t((x & 0b111) << bytes_per_block_log2), 0, (x >> 3) & 0b11, 0));
+  }
+  return x << bytes_per_block_log2;
+}
+
+// XeTextureHostLinearOffset.
+uint32_t GetHostOffset(const LoadContext& context, uint32_t x, uint32_t y,
+                       uint32_t z, uint32_t height,
+                       uint32_t bytes_per_block) {
+  return context.host_offset + x * bytes_per_block +
+         (z * height + y) * context.host_pitch;
+}
+
+template <typename V>
+V LoadSource(const LoadContext& context, uint32_t offset) {
+  if (XE_LIKELY(context.source_size >= 16 &&
+                offset <= context.source_size - 16)) {
+    return V::Load(context.source + offset);
+  }
+  uint8_t bytes[16] = {};
+  if (offset < context.source_size) {
+    std::memcpy(bytes, context.source + offset, context.source_size - offset);
+  }
+  return V::Load(bytes);
+}
+
+uint64_t LoadSource8(const LoadContext& context, uint32_t offset) {
+  uint64_t value = 0;
+  if (XE_LIKELY(context.source_size >= 8 &&
+                offset <= context.source_size - 8)) {
+    std::memcpy(&value, context.source + offset, sizeof(value));
+  } else if (offset < context.source_size) {
+    std::memcpy(&value, context.source + offset, context.source_size - offset);
+  }
+  return value;
+}
+
+template <typename V>
+void StoreDest(const LoadContext& context, uint32_t offset, const V& value) {
+  if (XE_LIKELY(context.dest_size >= 16 && offset <= context.dest_size - 16)) {
+    value.Store(context.dest + offset);
+    return;
+  }
+  if (offset < context.dest_size) {
+    uint8_t bytes[16];
+    value.Store(bytes);
+    std::memcpy(context.dest + offset, bytes, context.dest_size - offset);
+  }
+}
+
+// Kernels, each Thread doing what one shader invocation does, except for the
+// check of whether the first block is within the bounds, done by Dispatch.
+
+// texture_load_8bpb.xesli.
+struct Load8bpb {
+  static constexpr uint32_t kBlocksPerThreadLog2 = 4;
+
+  template <typename V>
+  static void Thread(const LoadContext& context, uint32_t x, uint32_t y,
+                     uint32_t z) {
+    uint32_t block_offset_host =
+        GetHostOffset(context, x, y, z, context.size_blocks[1], 1);
+    uint32_t block_offset_guest = GetSourceAddress(context, x, y, z, 0);
+    uint64_t blocks[] = {
+        LoadSource8(context, block_offset_guest),
+        LoadSource8(context,
+                    block_offset_guest +
+                        GetLocalXAddressXor(8, 0, context.is_tiled)),
+    };
+    StoreDest(context, block_offset_host, V::Load(blocks));
+  }
+};
+
+struct TransformNone {
+  template <typename V>
+  static V Apply(const V& blocks) {
+    return blocks;
+  }
+};
+
+#define XE_TEXTURE_CONVERSION_TRANSFORM(name, function) \
+  struct Transform##name {                              \
+    template <typename V>                               \
+    static V Apply(const V& blocks) {                   \
+      return function(blocks);                          \
+    }                                                   \
+  };
+XE_TEXTURE_CONVERSION_TRANSFORM(R5G5B5A1ToB5G5R5A1, R5G5B5A1ToB5G5R5A1)
+XE_TEXTURE_CONVERSION_TRANSFORM(R5G6B5ToB5G6R5, R5G6B5ToB5G6R5)
+XE_TEXTURE_CONVERSION_TRANSFORM(R5G5B6ToB5G6R5WithRBGASwizzle,
+                                R5G5B6ToB5G6R5WithRBGASwizzle)
+XE_TEXTURE_CONVERSION_TRANSFORM(R4G4B4A4ToB4G4R4A4, R4G4B4A4ToB4G4R4A4)
+XE_TEXTURE_CONVERSION_TRANSFORM(R4G4B4A4ToA4R4G4B4, R4G4B4A4ToA4R4G4B4)
+XE_TEXTURE_CONVERSION_TRANSFORM(GBGR8ToGRGB8, GBGR8ToGRGB8)
+XE_TEXTURE_CONVERSION_TRANSFORM(BGRG8ToRGBG8, BGRG8ToRGBG8)
+XE_TEXTURE_CONVERSION_TRANSFORM(RG16UNormToRG16Float, RG16UNormToRG16Float)
+XE_TEXTURE_CONVERSION_TRANSFORM(RG16SNormToRG16Float, RG16SNormToRG16Float)
+XE_TEXTURE_CONVERSION_TRANSFORM(DepthUNorm24To32, DepthUNorm24To32)
+XE_TEXTURE_CONVERSION_TRANSFORM(DepthFloat20e4To32, DepthFloat20e4To32)
+#undef XE_TEXTURE_CONVERSION_TRANSFORM
+
+#define XE_TEXTURE_CONVERSION_EXPAND(name, function)                 \
+  struct Expand##name {                                              \
+    template <typename V>                                            \
+    static void Apply(const V& blocks, V& out_01, V& out_23) {       \
+      function(blocks, out_01, out_23);                              \
+    }                                                                \
+  };
+XE_TEXTURE_CONVERSION_EXPAND(GBGR8ToRGB8, GBGR8ToRGB8WithRGBBSwizzle)
+XE_TEXTURE_CONVERSION_EXPAND(BGRG8ToRGB8, BGRG8ToRGB8WithRGBBSwizzle)
+XE_TEXTURE_CONVERSION_EXPAND(R10G11B11ToRGBA16, R10G11B11UNormToRGBA16)
+XE_TEXTURE_CONVERSION_EXPAND(R10G11B11ToRGBA16SNorm, R10G11B11SNormToRGBA16)
+XE_TEXTURE_CONVERSION_EXPAND(R11G11B10ToRGBA16, R11G11B10UNormToRGBA16)
+XE_TEXTURE_CONVERSION_EXPAND(R11G11B10ToRGBA16SNorm, R11G11B10SNormToRGBA16)
+#undef XE_TEXTURE_CONVERSION_EXPAND
+
+// texture_load_16bpb.xesli, texture_load_32bpb.xesli,
+// texture_load_64bpb.xesli and texture_load_128bpb.xesli - two 16-byte guest
+// runs per thread.
+template <uint32_t kBytesPerBlockLog2, typename Transform>
+struct LoadTransform {
+  static constexpr uint32_t kBlocksPerThreadLog2 = 5 - kBytesPerBlockLog2;
+
+  template <typename V>
+  static void Thread(const LoadContext& context, uint32_t x, uint32_t y,
+                     uint32_t z) {
+    uint32_t block_offset_host =
+        GetHostOffset(context, x, y, z, context.size_blocks[1],
+                      1 << kBytesPerBlockLog2);
+    uint32_t block_offset_guest =
+        GetSourceAddress(context, x, y, z, kBytesPerBlockLog2);
+    for (uint32_t i = 0; i < 2; ++i) {
+      if (i) {
+        block_offset_host += 16;
+        block_offset_guest += GetLocalXAddressXor(
+            16 >> kBytesPerBlockLog2, kBytesPerBlockLog2, context.is_tiled);
+      }
+      V guest_blocks = LoadSource<V>(context, block_offset_guest);
+      guest_blocks = kBytesPerBlockLog2 == 1
+                         ? V::EndianSwap16(guest_blocks, context.endian)
+                         : V::EndianSwap32(guest_blocks, context.endian);
+      StoreDest(context, block_offset_host, Transform::Apply(guest_blocks));
+    }
+  }
+};
+
+// texture_load_32bpb_64bpb.xesli.
+template <typename Expand>
+struct Load32bpbTo64bpb {
+  static constexpr uint32_t kBlocksPerThreadLog2 = 3;
+
+  template <typename V>
+  static void Thread(const LoadContext& context, uint32_t x, uint32_t y,
+                     uint32_t z) {
+    uint32_t block_offset_host =
+        GetHostOffset(context, x, y, z, context.size_blocks[1], 8);
+    uint32_t block_offset_guest = GetSourceAddress(context, x, y, z, 2);
+    for (uint32_t i = 0; i < 2; ++i) {
+      if (i) {
+        block_offset_host += 0x20;
+        block_offset_guest += GetLocalXAddressXor(4, 2, context.is_tiled);
+      }
+      V guest_blocks = V::EndianSwap32(
+          LoadSource<V>(context, block_offset_guest), context.endian);
+      V block_0, block_1;
+      Expand::Apply(guest_blocks, block_0, block_1);
+      StoreDest(context, block_offset_host, block_0);
+      StoreDest(context, block_offset_host + 0x10, block_1);
+    }
+  }
+};
+
+// texture_load_dxt1_rgba8.cs.xesl.
+struct LoadDXT1ToRGBA8 {
+  static constexpr uint32_t kBlocksPerThreadLog2 = 2;
+
+  template <typename V>
+  static void Thread(const LoadContext& context, uint32_t x, uint32_t y,
+                     uint32_t z) {
+    uint32_t texel_y = y << 2;
+    uint32_t block_offset_host =
+        GetHostOffset(context, x << 2, texel_y, z, context.height_texels, 4);
+    uint32_t block_offset_guest = GetSourceAddress(context, x, y, z, 3);
+    V blocks_01 = V::EndianSwap32(LoadSource<V>(context, block_offset_guest),
+                                  context.endian);
+    block_offset_guest += GetLocalXAddressXor(2, 3, context.is_tiled);
+    V blocks_23 = V::EndianSwap32(LoadSource<V>(context, block_offset_guest),
+                                  context.endian);
+    uint32_t colors[] = {
+        blocks_01.template Lane<0>(), blocks_01.template Lane<2>(),
+        blocks_23.template Lane<0>(), blocks_23.template Lane<2>()};
+    uint32_t weights[] = {
+        blocks_01.template Lane<1>(), blocks_01.template Lane<3>(),
+        blocks_23.template Lane<1>(), blocks_23.template Lane<3>()};
+    uint32_t end_8in10[4][2];
+    bool is_trans[4];
+    for (uint32_t i = 0; i < 4; ++i) {
+      DXTColorEndpointsToBGR8In10(colors[i], end_8in10[i][0],
+                                  end_8in10[i][1]);
+      is_trans[i] = end_8in10[i][0] <= end_8in10[i][1];
+      weights[i] = is_trans[i] ? DXT1TransWeights(weights[i])
+                               : DXTHighColorWeights(weights[i]);
+    }
+    for (uint32_t row = 0; row < 4; ++row) {
+      if (row) {
+        if (texel_y + row >= context.height_texels) {
+          break;
+        }
+        block_offset_host += context.host_pitch;
+      }
+      for (uint32_t i = 0; i < 4; ++i) {
+        uint32_t row_weights = weights[i] >> (8 * row);
+        StoreDest(context, block_offset_host + 0x10 * i,
+                  is_trans[i]
+                      ? DXT1TransRowToRGBA8<V>(end_8in10[i][0],
+                                               end_8in10[i][1], row_weights)
+                      : (DXTOpaqueRowToRGB8<V>(end_8in10[i][0],
+                                               end_8in10[i][1], row_weights) |
+                         0xFF000000u));
+      }
+    }
+  }
+};
+
+// texture_load_dxt3_rgba8.cs.xesl and texture_load_dxt5_rgba8.cs.xesl.
+template <bool kDXT5>
+struct LoadDXT3Or5ToRGBA8 {
+  static constexpr uint32_t kBlocksPerThreadLog2 = 1;
+
+  template <typename V>
+  static void Thread(const LoadContext& context, uint32_t x, uint32_t y,
+                     uint32_t z) {
+    uint32_t texel_y = y << 2;
+    uint32_t block_offset_host =
+        GetHostOffset(context, x << 2, texel_y, z, context.height_texels, 4);
+    uint32_t block_offset_guest = GetSourceAddress(context, x, y, z, 4);
+    for (uint32_t i = 0; i < 2; ++i) {
+      if (i) {
+        block_offset_host += 16;
+        block_offset_guest += GetLocalXAddressXor(1, 4, context.is_tiled);
+      }
+      V block = V::EndianSwap32(LoadSource<V>(context, block_offset_guest),
+                                context.endian);
+      uint32_t alpha_0 = block.template Lane<0>();
+      uint32_t alpha_1 = block.template Lane<1>();
+      uint32_t bgr_end_8in10[2];
+      DXTColorEndpointsToBGR8In10(block.template Lane<2>(), bgr_end_8in10[0],
+                                  bgr_end_8in10[1]);
+      uint32_t bgr_weights = DXTHighColorWeights(block.template Lane<3>());
+      uint32_t alpha_end[2], alpha_weights = 0;
+      if (kDXT5) {
+        alpha_end[0] = alpha_0 & 0xFF;
+        alpha_end[1] = (alpha_0 >> 8) & 0xFF;
+      }
+      for (uint32_t row = 0; row < 4; ++row) {
+        if (row && texel_y + row >= context.height_texels) {
+          break;
+        }
+        V rgb = DXTOpaqueRowToRGB8<V>(bgr_end_8in10[0], bgr_end_8in10[1],
+                                      bgr_weights >> (8 * row));
+        V a;
+        if (kDXT5) {
+          if (!(row & 1)) {
+            alpha_weights = DXT5HighAlphaWeights(
+                alpha_end[0], alpha_end[1],
+                row ? alpha_1 >> 8 : (alpha_0 >> 16) | ((alpha_1 & 0xFF) << 16));
+          }
+          a = DXT5RowToA8<V>(alpha_end[0], alpha_end[1],
+                             alpha_weights >> (12 * (row & 1)))
+              << 24;
+        } else {
+          uint32_t alpha_shift = 16 * (row & 1);
+          a = (V::ShrLanes(V::Splat((row < 2 ? alpha_0 : alpha_1) >>
+                                    alpha_shift),
+                           0, 4, 8, 12) &
+               0xFu) *
+              0x11000000u;
+        }
+        StoreDest(context, block_offset_host + context.host_pitch * row,
+                  rgb | a);
+      }
+    }
+  }
+};
+
+// texture_load_dxn_rg8.cs.xesl.
+struct LoadDXNToRG8 {
+  static constexpr uint32_t kBlocksPerThreadLog2 = 1;
+
+  template <typename V>
+  static void Thread(const LoadContext& context, uint32_t x, uint32_t y,
+                     uint32_t z) {
+    uint32_t texel_y = y << 2;
+    uint32_t block_offset_host =
+        GetHostOffset(context, x << 2, texel_y, z, context.height_texels, 2);
+    uint32_t block_offset_guest = GetSourceAddress(context, x, y, z, 4);
+    V block_0 = V::EndianSwap32(LoadSource<V>(context, block_offset_guest),
+                                context.endian);
+    block_offset_guest += GetLocalXAddressXor(1, 4, context.is_tiled);
+    V block_1 = V::EndianSwap32(LoadSource<V>(context, block_offset_guest),
+                                context.endian);
+    // Red and green halves of the two blocks.
+    uint32_t halves[4][2] = {
+        {block_0.template Lane<0>(), block_0.template Lane<1>()},
+        {block_0.template Lane<2>(), block_0.template Lane<3>()},
+        {block_1.template Lane<0>(), block_1.template Lane<1>()},
+        {block_1.template Lane<2>(), block_1.template Lane<3>()},
+    };
+    uint32_t end[4][2], weights[4];
+    for (uint32_t row = 0; row < 4; ++row) {
+      if (row) {
+        if (texel_y + row >= context.height_texels) {
+          break;
+        }
+        block_offset_host += context.host_pitch;
+      }
+      for (uint32_t i = 0; i < 4; ++i) {
+        if (!row) {
+          end[i][0] = halves[i][0] & 0xFF;
+          end[i][1] = (halves[i][0] >> 8) & 0xFF;
+        }
+        if (row & 1) {
+          weights[i] >>= 12;
+        } else {
+          weights[i] = DXT5HighAlphaWeights(
+              end[i][0], end[i][1],
+              row ? halves[i][1] >> 8
+                  : (halves[i][0] >> 16) | ((halves[i][1] & 0xFF) << 16));
+        }
+      }
+      V texels_0 = DXT5RowToA8<V>(end[0][0], end[0][1], weights[0]) |
+                   (DXT5RowToA8<V>(end[1][0], end[1][1], weights[1]) << 8);
+      V texels_1 = DXT5RowToA8<V>(end[2][0], end[2][1], weights[2]) |
+                   (DXT5RowToA8<V>(end[3][0], end[3][1], weights[3]) << 8);
+      StoreDest(context, block_offset_host, V::PackTo16(texels_0, texels_1));
+    }
+  }
+};
+
+// texture_load_dxt3a.cs.xesl, texture_load_dxt3aas1111.xesli and
+// texture_load_dxt5a_r8.cs.xesl - 4 8-byte alpha blocks per thread.
+enum class AlphaBlockFormat {
+  kDXT3A,
+  kDXT3AAs1111ToBGRA4,
+  kDXT3AAs1111ToARGB4,
+  kDXT5A,
+};
+
+template <AlphaBlockFormat kFormat>
+struct LoadAlphaBlocks {
+  static constexpr uint32_t kBlocksPerThreadLog2 = 2;
+
+  template <typename V>
+  static void Thread(const LoadContext& context, uint32_t x, uint32_t y,
+                     uint32_t z) {
+    constexpr uint32_t kHostBytesPerTexel =
+        (kFormat == AlphaBlockFormat::kDXT3AAs1111ToBGRA4 ||
+         kFormat == AlphaBlockFormat::kDXT3AAs1111ToARGB4)
+            ? 2
+            : 1;
+    uint32_t texel_y = y << 2;
+    uint32_t block_offset_host =
+        GetHostOffset(context, x << 2, texel_y, z, context.height_texels,
+                      kHostBytesPerTexel);
+    uint32_t block_offset_guest = GetSourceAddress(context, x, y, z, 3);
+    V blocks_01 = V::EndianSwap32(LoadSource<V>(context, block_offset_guest),
+                                  context.endian);
+    block_offset_guest += GetLocalXAddressXor(2, 3, context.is_tiled);
+    V blocks_23 = V::EndianSwap32(LoadSource<V>(context, block_offset_guest),
+                                  context.endian);
+    // Words 0 and 1 of the 4 blocks.
+    V words_0 = V::EvenLanes(blocks_01, blocks_23);
+    V words_1 = V::OddLanes(blocks_01, blocks_23);
+    uint32_t end[4][2], weights[4];
+    for (uint32_t row = 0; row < 4; ++row) {
+      if (row) {
+        if (texel_y + row >= context.height_texels) {
+          break;
+        }
+        block_offset_host += context.host_pitch;
+      }
+      if (kFormat == AlphaBlockFormat::kDXT5A) {
+        uint32_t blocks[4][2] = {
+            {words_0.template Lane<0>(), words_1.template Lane<0>()},
+            {words_0.template Lane<1>(), words_1.template Lane<1>()},
+            {words_0.template Lane<2>(), words_1.template Lane<2>()},
+            {words_0.template Lane<3>(), words_1.template Lane<3>()},
+        };
+        for (uint32_t i = 0; i < 4; ++i) {
+          if (!row) {
+            end[i][0] = blocks[i][0] & 0xFF;
+            end[i][1] = (blocks[i][0] >> 8) & 0xFF;
+          }
+          if (row & 1) {
+            weights[i] >>= 12;
+          } else {
+            weights[i] = DXT5HighAlphaWeights(
+                end[i][0], end[i][1],
+                row ? blocks[i][1] >> 8
+                    : (blocks[i][0] >> 16) | ((blocks[i][1] & 0xFF) << 16));
+          }
+        }
+        StoreDest(context, block_offset_host,
+                  V::PackTo8(DXT5RowToA8<V>(end[0][0], end[0][1], weights[0]),
+                             DXT5RowToA8<V>(end[1][0], end[1][1], weights[1]),
+                             DXT5RowToA8<V>(end[2][0], end[2][1], weights[2]),
+                             DXT5RowToA8<V>(end[3][0], end[3][1],
+                                            weights[3])));
+        continue;
+      }
+      V halfblocks = (row < 2 ? words_0 : words_1) >> (16 * (row & 1));
+      if (kFormat == AlphaBlockFormat::kDXT3A) {
+        StoreDest(context, block_offset_host,
+                  DXT3FourBlocksRowToA8(halfblocks));
+        continue;
+      }
+      uint32_t halfblock_0 = halfblocks.template Lane<0>();
+      uint32_t halfblock_1 = halfblocks.template Lane<1>();
+      uint32_t halfblock_2 = halfblocks.template Lane<2>();
+      uint32_t halfblock_3 = halfblocks.template Lane<3>();
+      if (kFormat == AlphaBlockFormat::kDXT3AAs1111ToBGRA4) {
+        StoreDest(context, block_offset_host,
+                  DXT3AAs1111TwoBlocksRowToBGRA4<V>(halfblock_0, halfblock_1));
+        StoreDest(context, block_offset_host + 16,
+                  DXT3AAs1111TwoBlocksRowToBGRA4<V>(halfblock_2, halfblock_3));
+      } else {
+        StoreDest(context, block_offset_host,
+                  DXT3AAs1111TwoBlocksRowToARGB4<V>(halfblock_0, halfblock_1));
+        StoreDest(context, block_offset_host + 16,
+                  DXT3AAs1111TwoBlocksRowToARGB4<V>(halfblock_2, halfblock_3));
+      }
+    }
+  }
+};
+
+// texture_load_ctx1.cs.xesl.
+struct LoadCTX1 {
+  static constexpr uint32_t kBlocksPerThreadLog2 = 2;
+
+  template <typename V>
+  static void Thread(const LoadContext& context, uint32_t x, uint32_t y,
+                     uint32_t z) {
+    uint32_t texel_y = y << 2;
+    uint32_t block_offset_host =
+        GetHostOffset(context, x << 2, texel_y, z, context.height_texels, 2);
+    uint32_t block_offset_guest = GetSourceAddress(context, x, y, z, 3);
+    for (uint32_t i = 0; i < 2; ++i) {
+      if (i) {
+        block_offset_host += 16;
+        block_offset_guest += GetLocalXAddressXor(2, 3, context.is_tiled);
+      }
+      V blocks = V::EndianSwap32(LoadSource<V>(context, block_offset_guest),
+                                 context.endian);
+      // Unpack the endpoints as 0x00gg00rr so they can be multiplied by their
+      // weights allowing overflow.
+      uint32_t ends[] = {blocks.template Lane<0>(), blocks.template Lane<2>()};
+      uint32_t end_8in16[2][2];
+      for (uint32_t j = 0; j < 2; ++j) {
+        end_8in16[j][0] = ((ends[j] >> 8) & 0xFF) | ((ends[j] & 0xFF) << 16);
+        end_8in16[j][1] = (ends[j] >> 24) | (ends[j] & 0xFF0000);
+      }
+      uint32_t weights_high[] = {DXTHighColorWeights(blocks.template Lane<1>()),
+                                 DXTHighColorWeights(blocks.template Lane<3>())};
+      for (uint32_t row = 0; row < 4; ++row) {
+        if (row && texel_y + row >= context.height_texels) {
+          break;
+        }
+        StoreDest(context, block_offset_host + context.host_pitch * row,
+                  V::PackTo16(CTX1RowToR8G8<V>(end_8in16[0][0], end_8in16[0][1],
+                                               weights_high[0] >> (8 * row)),
+                              CTX1RowToR8G8<V>(end_8in16[1][0], end_8in16[1][1],
+                                               weights_high[1] >> (8 * row))));
+      }
+    }
+  }
+};
+
+using DispatchFunction = void (*)(const LoadContext& context);
+
+template <typename V, typename Kernel>
+void Dispatch(const LoadContext& context) {
+  for (uint32_t z = 0; z < context.size_blocks[2]; ++z) {
+    for (uint32_t y = 0; y < context.size_blocks[1]; ++y) {
+      for (uint32_t x = 0; x < context.size_blocks[0];
+           x += UINT32_C(1) << Kernel::kBlocksPerThreadLog2) {
+        Kernel::template Thread<V>(context, x, y, z);
+      }
+    }
+  }
+}
+
+template <typename V>
+DispatchFunction GetDispatchFunction(
+    TextureCache::LoadShaderIndex load_shader) {
+  switch (load_shader) {
+    case TextureCache::kLoadShaderIndex8bpb:
+      return Dispatch<V, Load8bpb>;
+    case TextureCache::kLoadShaderIndex16bpb:
+      return Dispatch<V, LoadTransform<1, TransformNone>>;
+    case TextureCache::kLoadShaderIndex32bpb:
+      return Dispatch<V, LoadTransform<2, TransformNone>>;
+    case TextureCache::kLoadShaderIndex64bpb:
+      return Dispatch<V, LoadTransform<3, TransformNone>>;
+    case TextureCache::kLoadShaderIndex128bpb:
+      return Dispatch<V, LoadTransform<4, TransformNone>>;
+    case TextureCache::kLoadShaderIndexR5G5B5A1ToB5G5R5A1:
+      return Dispatch<V, LoadTransform<1, TransformR5G5B5A1ToB5G5R5A1>>;
+    case TextureCache::kLoadShaderIndexR5G6B5ToB5G6R5:
+      return Dispatch<V, LoadTransform<1, TransformR5G6B5ToB5G6R5>>;
+    case TextureCache::kLoadShaderIndexR5G5B6ToB5G6R5WithRBGASwizzle:
+      return Dispatch<V,
+                      LoadTransform<1, TransformR5G5B6ToB5G6R5WithRBGASwizzle>>;
+    case TextureCache::kLoadShaderIndexRGBA4ToBGRA4:
+      return Dispatch<V, LoadTransform<1, TransformR4G4B4A4ToB4G4R4A4>>;
+    case TextureCache::kLoadShaderIndexRGBA4ToARGB4:
+      return Dispatch<V, LoadTransform<1, TransformR4G4B4A4ToA4R4G4B4>>;
+    case TextureCache::kLoadShaderIndexGBGR8ToGRGB8:
+      return Dispatch<V, LoadTransform<2, TransformGBGR8ToGRGB8>>;
+    case TextureCache::kLoadShaderIndexGBGR8ToRGB8:
+      return Dispatch<V, Load32bpbTo64bpb<ExpandGBGR8ToRGB8>>;
+    case TextureCache::kLoadShaderIndexBGRG8ToRGBG8:
+      return Dispatch<V, LoadTransform<2, TransformBGRG8ToRGBG8>>;
+    case TextureCache::kLoadShaderIndexBGRG8ToRGB8:
+      return Dispatch<V, Load32bpbTo64bpb<ExpandBGRG8ToRGB8>>;
+    case TextureCache::kLoadShaderIndexR10G11B11ToRGBA16:
+      return Dispatch<V, Load32bpbTo64bpb<ExpandR10G11B11ToRGBA16>>;
+    case TextureCache::kLoadShaderIndexR10G11B11ToRGBA16SNorm:
+      return Dispatch<V, Load32bpbTo64bpb<ExpandR10G11B11ToRGBA16SNorm>>;
+    case TextureCache::kLoadShaderIndexR11G11B10ToRGBA16:
+      return Dispatch<V, Load32bpbTo64bpb<ExpandR11G11B10ToRGBA16>>;
+    case TextureCache::kLoadShaderIndexR11G11B10ToRGBA16SNorm:
+      return Dispatch<V, Load32bpbTo64bpb<ExpandR11G11B10ToRGBA16SNorm>>;
+    case TextureCache::kLoadShaderIndexR16UNormToFloat:
+      return Dispatch<V, LoadTransform<1, TransformRG16UNormToRG16Float>>;
+    case TextureCache::kLoadShaderIndexR16SNormToFloat:
+      return Dispatch<V, LoadTransform<1, TransformRG16SNormToRG16Float>>;
+    case TextureCache::kLoadShaderIndexRG16UNormToFloat:
+      return Dispatch<V, LoadTransform<2, TransformRG16UNormToRG16Float>>;
+    case TextureCache::kLoadShaderIndexRG16SNormToFloat:
+      return Dispatch<V, LoadTransform<2, TransformRG16SNormToRG16Float>>;
+    case TextureCache::kLoadShaderIndexRGBA16UNormToFloat:
+      return Dispatch<V, LoadTransform<3, TransformRG16UNormToRG16Float>>;
+    case TextureCache::kLoadShaderIndexRGBA16SNormToFloat:
+      return Dispatch<V, LoadTransform<3, TransformRG16SNormToRG16Float>>;
+    case TextureCache::kLoadShaderIndexDXT1ToRGBA8:
+      return Dispatch<V, LoadDXT1ToRGBA8>;
+    case TextureCache::kLoadShaderIndexDXT3ToRGBA8:
+      return Dispatch<V, LoadDXT3Or5ToRGBA8<false>>;
+    case TextureCache::kLoadShaderIndexDXT5ToRGBA8:
+      return Dispatch<V, LoadDXT3Or5ToRGBA8<true>>;
+    case TextureCache::kLoadShaderIndexDXNToRG8:
+      return Dispatch<V, LoadDXNToRG8>;
+    case TextureCache::kLoadShaderIndexDXT3A:
+      return Dispatch<V, LoadAlphaBlocks<AlphaBlockFormat::kDXT3A>>;
+    case TextureCache::kLoadShaderIndexDXT3AAs1111ToBGRA4:
+      return Dispatch<V,
+                      LoadAlphaBlocks<AlphaBlockFormat::kDXT3AAs1111ToBGRA4>>;
+    case TextureCache::kLoadShaderIndexDXT3AAs1111ToARGB4:
+      return Dispatch<V,
+                      LoadAlphaBlocks<AlphaBlockFormat::kDXT3AAs1111ToARGB4>>;
+    case TextureCache::kLoadShaderIndexDXT5AToR8:
+      return Dispatch<V, LoadAlphaBlocks<AlphaBlockFormat::kDXT5A>>;
+    case TextureCache::kLoadShaderIndexCTX1:
+      return Dispatch<V, LoadCTX1>;
+    case TextureCache::kLoadShaderIndexDepthUnorm:
+      return Dispatch<V, LoadTransform<2, TransformDepthUNorm24To32>>;
+    case TextureCache::kLoadShaderIndexDepthFloat:
+      return Dispatch<V, LoadTransform<2, TransformDepthFloat20e4To32>>;
+    default:
+      return nullptr;
+  }
+}
+
+#if XE_ARCH_AMD64
+
+// Untiling copies for 16bpb and above, putting the two 16-byte runs of a
+// thread together in one 32-byte store, or, for linear textures, copying whole
+// rows.
+template <uint32_t kBytesPerBlockLog2>
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("avx2")))
+#endif
+void DispatchCopyAVX2(const LoadContext& context) {
+  constexpr uint32_t kBlocksPerThreadLog2 = 5 - kBytesPerBlockLog2;
+  __m128i shuffle_128 =
+      kBytesPerBlockLog2 == 1
+          ? U32x4SSE::GetEndianSwap16Shuffle(context.endian)
+          : U32x4SSE::GetEndianSwap32Shuffle(context.endian);
+  __m256i shuffle = _mm256_broadcastsi128_si256(shuffle_128);
+  uint32_t thread_count =
+      (context.size_blocks[0] + ((UINT32_C(1) << kBlocksPerThreadLog2) - 1)) >>
+      kBlocksPerThreadLog2;
+  uint32_t run_xor = GetLocalXAddressXor(
+      16 >> kBytesPerBlockLog2, kBytesPerBlockLog2, context.is_tiled);
+  for (uint32_t z = 0; z < context.size_blocks[2]; ++z) {
+    for (uint32_t y = 0; y < context.size_blocks[1]; ++y) {
+      uint32_t offset_host =
+          GetHostOffset(context, 0, y, z, context.size_blocks[1],
+                        1 << kBytesPerBlockLog2);
+      bool host_in_bounds = size_t(offset_host) + size_t(thread_count) * 32 <=
+                            context.dest_size;
+      if (!context.is_tiled && host_in_bounds) {
+        uint32_t offset_guest =
+            GetSourceAddress(context, 0, y, z, kBytesPerBlockLog2);
+        if (size_t(offset_guest) + size_t(thread_count) * 32 <=
+            context.source_size) {
+          const uint8_t* source = context.source + offset_guest;
+          uint8_t* dest = context.dest + offset_host;
+          for (uint32_t i = 0; i < thread_count; ++i) {
+            _mm256_storeu_si256(
+                reinterpret_cast<__m256i*>(dest + 32 * i),
+                _mm256_shuffle_epi8(
+                    _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i*>(source + 32 * i)),
+                    shuffle));
+          }
+          continue;
+        }
+      }
+      for (uint32_t i = 0; i < thread_count; ++i) {
+        uint32_t x = i << kBlocksPerThreadLog2;
+        uint32_t offset_guest =
+            GetSourceAddress(context, x, y, z, kBytesPerBlockLog2);
+        uint32_t offset_guest_1 = offset_guest + run_xor;
+        if (!host_in_bounds ||
+            size_t(std::max(offset_guest, offset_guest_1)) + 16 >
+                context.source_size) {
+          LoadTransform<kBytesPerBlockLog2, TransformNone>::template Thread<
+              U32x4SSE>(context, x, y, z);
+          continue;
+        }
+        __m256i blocks = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                context.source + offset_guest))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(context.source +
+                                                             offset_guest_1)),
+            1);
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(context.dest + offset_host + 32 * i),
+            _mm256_shuffle_epi8(blocks, shuffle));
+      }
+    }
+  }
+}
+
+DispatchFunction GetDispatchFunctionAVX2(
+    TextureCache::LoadShaderIndex load_shader) {
+  switch (load_shader) {
+    case TextureCache::kLoadShaderIndex16bpb:
+      return DispatchCopyAVX2<1>;
+    case TextureCache::kLoadShaderIndex32bpb:
+      return DispatchCopyAVX2<2>;
+    case TextureCache::kLoadShaderIndex64bpb:
+      return DispatchCopyAVX2<3>;
+    case TextureCache::kLoadShaderIndex128bpb:
+      return DispatchCopyAVX2<4>;
+    default:
+      return GetDispatchFunction<U32x4SSE>(load_shader);
+  }
+}
+
+#endif  // XE_ARCH_AMD64
+
+}  // namespace
+
+const char* GetIsaName(Isa isa) {
+  switch (isa) {
+    case Isa::kScalar:
+      return "scalar";
+    case Isa::k128:
+#if XE_ARCH_ARM64
+      return "NEON";
+#else
+      return "SSE4.1";
+#endif
+    case Isa::kAVX2:
+      return "AVX2";
+    default:
+      return "unknown";
+  }
+}
+
+bool IsIsaSupported(Isa isa) {
+  switch (isa) {
+    case Isa::kScalar:
+      return true;
+    case Isa::k128:
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+      return true;
+#else
+      return false;
+#endif
+    case Isa::kAVX2:
+#if XE_ARCH_AMD64
+      return (amd64::GetFeatureFlags() & amd64::kX64EmitAVX2) != 0;
+#else
+      return false;
+#endif
+    default:
+      return false;
+  }
+}
+
+Isa GetBestIsa() {
+  for (uint32_t i = uint32_t(Isa::kCount); i > 0; --i) {
+    if (IsIsaSupported(Isa(i - 1))) {
+      return Isa(i - 1);
+    }
+  }
+  return Isa::kScalar;
+}
+
+const char* GetLoadShaderName(TextureCache::LoadShaderIndex load_shader) {
+  switch (load_shader) {
+    case TextureCache::kLoadShaderIndex8bpb:
+      return "8bpb";
+    case TextureCache::kLoadShaderIndex16bpb:
+      return "16bpb";
+    case TextureCache::kLoadShaderIndex32bpb:
+      return "32bpb";
+    case TextureCache::kLoadShaderIndex64bpb:
+      return "64bpb";
+    case TextureCache::kLoadShaderIndex128bpb:
+      return "128bpb";
+    case TextureCache::kLoadShaderIndexR5G5B5A1ToB5G5R5A1:
+      return "R5G5B5A1ToB5G5R5A1";
+    case TextureCache::kLoadShaderIndexR5G6B5ToB5G6R5:
+      return "R5G6B5ToB5G6R5";
+    case TextureCache::kLoadShaderIndexR5G5B6ToB5G6R5WithRBGASwizzle:
+      return "R5G5B6ToB5G6R5WithRBGASwizzle";
+    case TextureCache::kLoadShaderIndexRGBA4ToBGRA4:
+      return "RGBA4ToBGRA4";
+    case TextureCache::kLoadShaderIndexRGBA4ToARGB4:
+      return "RGBA4ToARGB4";
+    case TextureCache::kLoadShaderIndexGBGR8ToGRGB8:
+      return "GBGR8ToGRGB8";
+    case TextureCache::kLoadShaderIndexGBGR8ToRGB8:
+      return "GBGR8ToRGB8";
+    case TextureCache::kLoadShaderIndexBGRG8ToRGBG8:
+      return "BGRG8ToRGBG8";
+    case TextureCache::kLoadShaderIndexBGRG8ToRGB8:
+      return "BGRG8ToRGB8";
+    case TextureCache::kLoadShaderIndexR10G11B11ToRGBA16:
+      return "R10G11B11ToRGBA16";
+    case TextureCache::kLoadShaderIndexR10G11B11ToRGBA16SNorm:
+      return "R10G11B11ToRGBA16SNorm";
+    case TextureCache::kLoadShaderIndexR11G11B10ToRGBA16:
+      return "R11G11B10ToRGBA16";
+    case TextureCache::kLoadShaderIndexR11G11B10ToRGBA16SNorm:
+      return "R11G11B10ToRGBA16SNorm";
+    case TextureCache::kLoadShaderIndexR16UNormToFloat:
+      return "R16UNormToFloat";
+    case TextureCache::kLoadShaderIndexR16SNormToFloat:
+      return "R16SNormToFloat";
+    case TextureCache::kLoadShaderIndexRG16UNormToFloat:
+      return "RG16UNormToFloat";
+    case TextureCache::kLoadShaderIndexRG16SNormToFloat:
+      return "RG16SNormToFloat";
+    case TextureCache::kLoadShaderIndexRGBA16UNormToFloat:
+      return "RGBA16UNormToFloat";
+    case TextureCache::kLoadShaderIndexRGBA16SNormToFloat:
+      return "RGBA16SNormToFloat";
+    case TextureCache::kLoadShaderIndexDXT1ToRGBA8:
+      return "DXT1ToRGBA8";
+    case TextureCache::kLoadShaderIndexDXT3ToRGBA8:
+      return "DXT3ToRGBA8";
+    case TextureCache::kLoadShaderIndexDXT5ToRGBA8:
+      return "DXT5ToRGBA8";
+    case TextureCache::kLoadShaderIndexDXNToRG8:
+      return "DXNToRG8";
+    case TextureCache::kLoadShaderIndexDXT3A:
+      return "DXT3A";
+    case TextureCache::kLoadShaderIndexDXT3AAs1111ToBGRA4:
+      return "DXT3AAs1111ToBGRA4";
+    case TextureCache::kLoadShaderIndexDXT3AAs1111ToARGB4:
+      return "DXT3AAs1111ToARGB4";
+    case TextureCache::kLoadShaderIndexDXT5AToR8:
+      return "DXT5AToR8";
+    case TextureCache::kLoadShaderIndexCTX1:
+      return "CTX1";
+    case TextureCache::kLoadShaderIndexDepthUnorm:
+      return "DepthUnorm";
+    case TextureCache::kLoadShaderIndexDepthFloat:
+      return "DepthFloat";
+    default:
+      return "unknown";
+  }
+}
+
+bool LoadTexture(TextureCache::LoadShaderIndex load_shader,
+                 const TextureCache::LoadConstants& constants,
+                 const void* source, size_t source_size, void* dest,
+                 size_t dest_size, Isa isa) {
+  // Resolution scale in bits 4:6 and 7:9, 0 or 1 if not scaled.
+  if (((constants.is_tiled_3d_endian_scale >> 4) & 0b111) > 1 ||
+      ((constants.is_tiled_3d_endian_scale >> 7) & 0b111) > 1) {
+    return false;
+  }
+  if (!IsIsaSupported(isa)) {
+    return false;
+  }
+  DispatchFunction dispatch_function = nullptr;
+  switch (isa) {
+    case Isa::kScalar:
+      dispatch_function = GetDispatchFunction<U32x4Scalar>(load_shader);
+      break;
+#if XE_ARCH_AMD64 || XE_ARCH_ARM64
+    case Isa::k128:
+      dispatch_function = GetDispatchFunction<U32x4Simd>(load_shader);
+      break;
+#endif
+#if XE_ARCH_AMD64
+    case Isa::kAVX2:
+      dispatch_function = GetDispatchFunctionAVX2(load_shader);
+      break;
+#endif
+    default:
+      break;
+  }
+  if (!dispatch_function) {
+    return false;
+  }
+
+  LoadContext context;
+  context.source = static_cast<const uint8_t*>(source);
+  context.source_size = source_size;
+  context.dest = static_cast<uint8_t*>(dest);
+  context.dest_size = dest_size;
+  context.is_tiled = (constants.is_tiled_3d_endian_scale & 1) != 0;
+  context.is_3d = (constants.is_tiled_3d_endian_scale & (1 << 1)) != 0;
+  context.endian =
+      xenos::Endian((constants.is_tiled_3d_endian_scale >> 2) & 0b11);
+  context.guest_offset = constants.guest_offset;
+  context.guest_pitch_aligned = constants.guest_pitch_aligned;
+  context.guest_z_stride_block_rows_aligned =
+      constants.guest_z_stride_block_rows_aligned;
+  std::memcpy(context.size_blocks, constants.size_blocks,
+              sizeof(context.size_blocks));
+  context.host_offset = constants.host_offset;
+  context.host_pitch = constants.host_pitch;
+  context.height_texels = constants.height_texels;
+  dispatch_function(context);
+  return true;
+}
+
+}  // namespace texture_conversion
+}  // namespace gpu
+}  // namespace xe
@@ -0,0 +1,63 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_TEXTURE_CONVERSION_H_
+#define XENIA_GPU_TEXTURE_CONVERSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "xenia/gpu/texture_cache.h"
+
+namespace xe {
+namespace gpu {
+namespace texture_conversion {
+
+// CPU versions of the texture load compute shaders (without resolution
+// scaling), untiling and converting guest texture data to the same host layout
+// and giving the same results bit for bit, for uses where there's no host GPU
+// or the data is needed on the CPU - texture dumping, trace tools, preloading -
+// and as the reference for the shaders.
+
+enum class Isa : uint32_t {
+  // Portable, one component at a time.
+  kScalar,
+  // 128-bit vectors - SSE4.1 on x86-64, NEON on AArch64.
+  k128,
+  // Untiling copies with 256-bit AVX2 vectors, everything else like k128.
+  kAVX2,
+
+  kCount,
+};
+
+const char* GetIsaName(Isa isa);
+bool IsIsaSupported(Isa isa);
+Isa GetBestIsa();
+
+const char* GetLoadShaderName(TextureCache::LoadShaderIndex load_shader);
+
+// Does what one dispatch of the load shader with the given constants does for
+// all size_blocks[2] slices. The source is what's bound as the source buffer of
+// the shader (guest_offset is relative to it), and the destination is the host
+// buffer (host_offset is relative to it). Like with robust buffer access on the
+// GPU, reads beyond source_size return zeros, and writes beyond dest_size are
+// dropped. Returns false if the load shader or the resolution scale in the
+// constants isn't supported. Like for the shaders, the host pitch must be
+// aligned to the number of blocks processed by one thread, from
+// TextureCache::GetLoadShaderInfo.
+bool LoadTexture(TextureCache::LoadShaderIndex load_shader,
+                 const TextureCache::LoadConstants& constants,
+                 const void* source, size_t source_size, void* dest,
+                 size_t dest_size, Isa isa = GetBestIsa());
+
+}  // namespace texture_conversion
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_TEXTURE_CONVERSION_H_
@@ -0,0 +1,197 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "third_party/fmt/include/fmt/format.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/math.h"
+#include "xenia/gpu/texture_cache.h"
+#include "xenia/gpu/texture_conversion.h"
+#include "xenia/gpu/texture_info.h"
+#include "xenia/gpu/xenos.h"
+
+DEFINE_uint32(texture_conversion_bench_width, 1024,
+              "Width of the benchmarked textures in texels.", "GPU");
+DEFINE_uint32(texture_conversion_bench_height, 1024,
+              "Height of the benchmarked textures in texels.", "GPU");
+DEFINE_uint32(texture_conversion_bench_iterations, 16,
+              "Number of loads of each texture per instruction set.", "GPU");
+DEFINE_bool(texture_conversion_bench_linear, false,
+            "Benchmark loading linear rather than tiled textures.", "GPU");
+
+namespace xe {
+namespace gpu {
+
+namespace {
+
+struct BenchFormat {
+  xenos::TextureFormat format;
+  TextureCache::LoadShaderIndex load_shader;
+};
+
+// A format for each load shader, formats that may be loaded with different
+// shaders listed once per shader.
+const BenchFormat kBenchFormats[] = {
+    {xenos::TextureFormat::k_8, TextureCache::kLoadShaderIndex8bpb},
+    {xenos::TextureFormat::k_8_8, TextureCache::kLoadShaderIndex16bpb},
+    {xenos::TextureFormat::k_8_8_8_8, TextureCache::kLoadShaderIndex32bpb},
+    {xenos::TextureFormat::k_16_16_16_16_FLOAT,
+     TextureCache::kLoadShaderIndex64bpb},
+    {xenos::TextureFormat::k_32_32_32_32_FLOAT,
+     TextureCache::kLoadShaderIndex128bpb},
+    {xenos::TextureFormat::k_1_5_5_5,
+     TextureCache::kLoadShaderIndexR5G5B5A1ToB5G5R5A1},
+    {xenos::TextureFormat::k_5_6_5,
+     TextureCache::kLoadShaderIndexR5G6B5ToB5G6R5},
+    {xenos::TextureFormat::k_6_5_5,
+     TextureCache::kLoadShaderIndexR5G5B6ToB5G6R5WithRBGASwizzle},
+    {xenos::TextureFormat::k_4_4_4_4,
+     TextureCache::kLoadShaderIndexRGBA4ToBGRA4},
+    {xenos::TextureFormat::k_4_4_4_4,
+     TextureCache::kLoadShaderIndexRGBA4ToARGB4},
+    {xenos::TextureFormat::k_Y1_Cr_Y0_Cb_REP,
+     TextureCache::kLoadShaderIndexGBGR8ToGRGB8},
+    {xenos::TextureFormat::k_Y1_Cr_Y0_Cb_REP,
+     TextureCache::kLoadShaderIndexGBGR8ToRGB8},
+    {xenos::TextureFormat::k_Cr_Y1_Cb_Y0_REP,
+     TextureCache::kLoadShaderIndexBGRG8ToRGBG8},
+    {xenos::TextureFormat::k_Cr_Y1_Cb_Y0_REP,
+     TextureCache::kLoadShaderIndexBGRG8ToRGB8},
+    {xenos::TextureFormat::k_10_11_11,
+     TextureCache::kLoadShaderIndexR10G11B11ToRGBA16},
+    {xenos::TextureFormat::k_10_11_11,
+     TextureCache::kLoadShaderIndexR10G11B11ToRGBA16SNorm},
+    {xenos::TextureFormat::k_11_11_10,
+     TextureCache::kLoadShaderIndexR11G11B10ToRGBA16},
+    {xenos::TextureFormat::k_11_11_10,
+     TextureCache::kLoadShaderIndexR11G11B10ToRGBA16SNorm},
+    {xenos::TextureFormat::k_16, TextureCache::kLoadShaderIndexR16UNormToFloat},
+    {xenos::TextureFormat::k_16, TextureCache::kLoadShaderIndexR16SNormToFloat},
+    {xenos::TextureFormat::k_16_16,
+     TextureCache::kLoadShaderIndexRG16UNormToFloat},
+    {xenos::TextureFormat::k_16_16,
+     TextureCache::kLoadShaderIndexRG16SNormToFloat},
+    {xenos::TextureFormat::k_16_16_16_16,
+     TextureCache::kLoadShaderIndexRGBA16UNormToFloat},
+    {xenos::TextureFormat::k_16_16_16_16,
+     TextureCache::kLoadShaderIndexRGBA16SNormToFloat},
+    {xenos::TextureFormat::k_DXT1, TextureCache::kLoadShaderIndexDXT1ToRGBA8},
+    {xenos::TextureFormat::k_DXT2_3,
+     TextureCache::kLoadShaderIndexDXT3ToRGBA8},
+    {xenos::TextureFormat::k_DXT4_5,
+     TextureCache::kLoadShaderIndexDXT5ToRGBA8},
+    {xenos::TextureFormat::k_DXN, TextureCache::kLoadShaderIndexDXNToRG8},
+    {xenos::TextureFormat::k_DXT3A, TextureCache::kLoadShaderIndexDXT3A},
+    {xenos::TextureFormat::k_DXT3A_AS_1_1_1_1,
+     TextureCache::kLoadShaderIndexDXT3AAs1111ToBGRA4},
+    {xenos::TextureFormat::k_DXT3A_AS_1_1_1_1,
+     TextureCache::kLoadShaderIndexDXT3AAs1111ToARGB4},
+    {xenos::TextureFormat::k_DXT5A, TextureCache::kLoadShaderIndexDXT5AToR8},
+    {xenos::TextureFormat::k_CTX1, TextureCache::kLoadShaderIndexCTX1},
+    {xenos::TextureFormat::k_24_8, TextureCache::kLoadShaderIndexDepthUnorm},
+    {xenos::TextureFormat::k_24_8_FLOAT,
+     TextureCache::kLoadShaderIndexDepthFloat},
+};
+
+}  // namespace
+
+// Loads textures of random data in every format supported by the CPU texture
+// conversion with every available instruction set, and reports the throughput
+// in megabytes of guest data per second.
+int texture_conversion_bench_main(const std::vector<std::string>& args) {
+  uint32_t width = std::max(cvars::texture_conversion_bench_width, 1u);
+  uint32_t height = std::max(cvars::texture_conversion_bench_height, 1u);
+  uint32_t iterations =
+      std::max(cvars::texture_conversion_bench_iterations, 1u);
+  bool is_tiled = !cvars::texture_conversion_bench_linear;
+  XELOGI("Loading {} {}x{} textures {} times", is_tiled ? "tiled" : "linear",
+         width, height, iterations);
+
+  std::mt19937 random_engine;
+  std::vector<uint8_t> source, dest;
+  double tick_frequency = double(Clock::QueryHostTickFrequency());
+  for (const BenchFormat& bench_format : kBenchFormats) {
+    const FormatInfo* format_info = FormatInfo::Get(bench_format.format);
+    const TextureCache::LoadShaderInfo& load_shader_info =
+        TextureCache::GetLoadShaderInfo(bench_format.load_shader);
+    uint32_t width_blocks =
+        xe::align(width, format_info->block_width) / format_info->block_width;
+    uint32_t height_blocks = xe::align(height, format_info->block_height) /
+                             format_info->block_height;
+    uint32_t bytes_per_block = format_info->bytes_per_block();
+
+    TextureCache::LoadConstants constants = {};
+    constants.is_tiled_3d_endian_scale =
+        uint32_t(is_tiled) | (uint32_t(xenos::Endian::k8in16) << 2);
+    constants.guest_pitch_aligned = xe::align(width_blocks, 32u);
+    constants.guest_z_stride_block_rows_aligned = xe::align(height_blocks, 32u);
+    constants.size_blocks[0] = width_blocks;
+    constants.size_blocks[1] = height_blocks;
+    constants.size_blocks[2] = 1;
+    uint32_t host_width =
+        xe::align(width_blocks,
+                  UINT32_C(1) << load_shader_info.guest_x_blocks_per_thread_log2);
+    if (format_info->type == FormatType::kCompressed) {
+      host_width *= format_info->block_width;
+      constants.height_texels = height_blocks * format_info->block_height;
+    } else {
+      constants.height_texels = height_blocks;
+    }
+    constants.host_pitch = load_shader_info.bytes_per_host_block * host_width;
+
+    size_t source_size = size_t(constants.guest_pitch_aligned) *
+                         constants.guest_z_stride_block_rows_aligned *
+                         bytes_per_block;
+    source.resize(source_size);
+    for (uint8_t& byte : source) {
+      byte = uint8_t(random_engine());
+    }
+    dest.resize(size_t(constants.host_pitch) * constants.height_texels);
+    double guest_megabytes =
+        double(width_blocks) * height_blocks * bytes_per_block * iterations /
+        (1024.0 * 1024.0);
+
+    std::string results;
+    for (uint32_t i = 0; i < uint32_t(texture_conversion::Isa::kCount); ++i) {
+      auto isa = texture_conversion::Isa(i);
+      if (!texture_conversion::IsIsaSupported(isa)) {
+        continue;
+      }
+      uint64_t start_ticks = Clock::QueryHostTickCount();
+      for (uint32_t j = 0; j < iterations; ++j) {
+        texture_conversion::LoadTexture(bench_format.load_shader, constants,
+                                        source.data(), source.size(),
+                                        dest.data(), dest.size(), isa);
+      }
+      double seconds =
+          double(Clock::QueryHostTickCount() - start_ticks) / tick_frequency;
+      results += fmt::format("  {} {:.1f} MB/s",
+                             texture_conversion::GetIsaName(isa),
+                             guest_megabytes / std::max(seconds, 1e-9));
+    }
+    XELOGI("{:<24}{}",
+           texture_conversion::GetLoadShaderName(bench_format.load_shader),
+           results);
+  }
+  return 0;
+}
+
+}  // namespace gpu
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-gpu-texture-conversion-bench",
+                      xe::gpu::texture_conversion_bench_main, "");
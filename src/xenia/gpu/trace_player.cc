@@ -34,7 +34,7 @@ TracePlayer::TracePlayer(GraphicsSystem* graphics_system)
   assert_not_null(playback_event_);
 }
 
-const TraceReader::Frame* TracePlayer::current_frame() const {
+const TraceReader::Frame* TracePlayer::current_frame() {
   if (current_frame_index_ >= frame_count()) {
     return nullptr;
   }
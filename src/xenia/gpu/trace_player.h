@@ -35,7 +35,7 @@ class TracePlayer : public TraceReader {
   int current_frame_index() const { return current_frame_index_; }
   int current_command_index() const { return current_command_index_; }
   bool is_playing_trace() const { return playing_trace_; }
-  const Frame* current_frame() const;
+  const Frame* current_frame();
 
   // Only valid if playing_trace is true.
   // Scalar from 0-10000
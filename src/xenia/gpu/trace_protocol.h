@@ -19,11 +19,16 @@ namespace gpu {
 static constexpr char kTraceExtension[] = "xtr";
 
 // Any byte changes to the files should bump this version.
-// Only builds with matching versions will work.
+// Only builds with matching versions will work, with the exception of
+// kTraceFormatVersionFlat traces that can still be read.
 // Other changes besides the file format may require bumps, such as
 // anything that changes what is recorded into the files (new GPU
 // command processor commands, etc).
-constexpr uint32_t kTraceFormatVersion = 1;
+constexpr uint32_t kTraceFormatVersion = 2;
+// The command stream directly follows the header, with each memory buffer
+// individually compressed with snappy. The whole file must be parsed to find
+// the frames.
+constexpr uint32_t kTraceFormatVersionFlat = 1;
 
 // Trace file header identifying information about the trace.
 // This must be positioned at the start of the file and must only occur once.
@@ -95,6 +100,9 @@ enum class MemoryEncodingFormat {
   kNone,
   // Data is compressed with third_party/snappy.
   kSnappy,
+  // Data is in a TraceRecordType::kBlob record, and the encoded data is the
+  // uint32_t index of the blob. encoded_length == sizeof(uint32_t).
+  kBlob,
 };
 
 // Represents the GPU reading or writing data from or to memory.
@@ -170,6 +178,54 @@ struct GammaRampCommand {
   uint32_t encoded_length;
 };
 
+// Since kTraceFormatVersion 2, the header is followed by records, each
+// starting with a TraceRecordHeader, and the file ends with a TraceFooter.
+// The command stream is split into a zstd-compressed record for every frame,
+// so frames can be loaded individually from the memory-mapped file. Memory
+// buffers are stored once for every distinct contents in separately compressed
+// blob records, possibly using a dictionary trained on the first blobs, and are
+// referenced from the commands with MemoryEncodingFormat::kBlob.
+enum class TraceRecordType : uint32_t {
+  // zstd-compressed commands of one frame, up to and including its swap event.
+  kFrame,
+  // zstd-compressed memory contents. Blobs are indexed in the order of their
+  // records in the file.
+  kBlob,
+  // Uncompressed zstd dictionary used for all blobs if present. Written before
+  // all blob records.
+  kDictionary,
+  // Uncompressed uint64_t offsets of the headers of all kFrame records, then
+  // of all kBlob records.
+  kIndex,
+};
+
+struct TraceRecordHeader {
+  TraceRecordType type;
+  // Number of bytes following the header in the trace file.
+  uint32_t encoded_length;
+  // Number of bytes after decompression. Equal to encoded_length for
+  // uncompressed records.
+  uint32_t decoded_length;
+};
+
+// 'XTRI' in a little-endian file.
+constexpr uint32_t kTraceFooterMagic = 0x49525458;
+
+// Last bytes of the file. May be missing if the trace was not closed properly,
+// in this case the records can still be located by scanning the file.
+struct TraceFooter {
+  // Offset of the kIndex record header from the start of the file.
+  uint64_t index_offset;
+  // Offset of the kDictionary record header, or 0 if there's no dictionary.
+  uint64_t dictionary_offset;
+  uint32_t frame_count;
+  uint32_t blob_count;
+  uint32_t reserved;
+  // Set to kTraceFooterMagic.
+  uint32_t magic;
+};
+static_assert(sizeof(TraceFooter) == 32);
+
 }  // namespace gpu
 }  // namespace xe
 
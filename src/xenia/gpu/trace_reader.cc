@@ -9,7 +9,11 @@
 
 #include "xenia/gpu/trace_reader.h"
 
+#include <algorithm>
+#include <cstring>
+
 #include "third_party/snappy/snappy.h"
+#include "third_party/zstd/lib/zstd.h"
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/mapped_memory.h"
@@ -43,13 +47,20 @@ bool TraceReader::Open(const std::string_view path) {
   trace_size_ = mmap_->size();
 
   // Verify version.
+  if (trace_size_ < sizeof(TraceHeader)) {
+    XELOGE("Trace file is too small");
+    Close();
+    return false;
+  }
   auto header = reinterpret_cast<const TraceHeader*>(trace_data_);
-  if (header->version != kTraceFormatVersion) {
+  if (header->version != kTraceFormatVersion &&
+      header->version != kTraceFormatVersionFlat) {
     XELOGE("Trace format version mismatch, code has {}, file has {}",
            kTraceFormatVersion, header->version);
     if (header->version < kTraceFormatVersion) {
       XELOGE("You need to regenerate your trace for the latest version");
     }
+    Close();
     return false;
   }
 
@@ -60,21 +71,196 @@ bool TraceReader::Open(const std::string_view path) {
   XELOGI("    Commit: {}", commit_str);
   XELOGI("  Title ID: {}", header->title_id);
 
-  ParseTrace();
+  if (header->version == kTraceFormatVersionFlat) {
+    ParseCommands(trace_data_ + sizeof(TraceHeader),
+                  trace_size_ - sizeof(TraceHeader), true, frames_);
+    return true;
+  }
+
+  if (!ReadRecordIndex()) {
+    Close();
+    return false;
+  }
+  // Frames are parsed when they're accessed.
+  frames_.resize(frame_record_offsets_.size());
+  XELOGI("    Frames: {}", frame_record_offsets_.size());
+  XELOGI("     Blobs: {}", blob_record_offsets_.size());
 
   return true;
 }
 
+TraceReader::~TraceReader() { Close(); }
+
 void TraceReader::Close() {
   mmap_.reset();
   trace_data_ = nullptr;
   trace_size_ = 0;
+  frames_.clear();
+  frame_record_offsets_.clear();
+  blob_record_offsets_.clear();
+  loaded_frames_.clear();
+  if (blob_dictionary_) {
+    ZSTD_freeDDict(blob_dictionary_);
+    blob_dictionary_ = nullptr;
+  }
+  if (blob_decompression_context_) {
+    ZSTD_freeDCtx(blob_decompression_context_);
+    blob_decompression_context_ = nullptr;
+  }
+}
+
+const TraceReader::Frame* TraceReader::frame(int n) {
+  if (!frame_record_offsets_.empty()) {
+    auto loaded_it =
+        std::find(loaded_frames_.begin(), loaded_frames_.end(), n);
+    if (loaded_it != loaded_frames_.end()) {
+      loaded_frames_.erase(loaded_it);
+    } else {
+      LoadFrame(n);
+      if (loaded_frames_.size() >= kMaxLoadedFrames) {
+        frames_[loaded_frames_.front()] = Frame();
+        loaded_frames_.pop_front();
+      }
+    }
+    loaded_frames_.push_back(n);
+  }
+  return &frames_[n];
+}
+
+bool TraceReader::ReadRecordIndex() {
+  if (trace_size_ >= sizeof(TraceHeader) + sizeof(TraceFooter)) {
+    TraceFooter footer;
+    std::memcpy(&footer, trace_data_ + trace_size_ - sizeof(footer),
+                sizeof(footer));
+    TraceRecordHeader index_header;
+    const uint8_t* index_data;
+    if (footer.magic == kTraceFooterMagic &&
+        GetRecord(footer.index_offset, TraceRecordType::kIndex, index_header,
+                  index_data) &&
+        index_header.encoded_length ==
+            sizeof(uint64_t) *
+                (uint64_t(footer.frame_count) + footer.blob_count)) {
+      frame_record_offsets_.resize(footer.frame_count);
+      std::memcpy(frame_record_offsets_.data(), index_data,
+                  sizeof(uint64_t) * footer.frame_count);
+      blob_record_offsets_.resize(footer.blob_count);
+      std::memcpy(blob_record_offsets_.data(),
+                  index_data + sizeof(uint64_t) * footer.frame_count,
+                  sizeof(uint64_t) * footer.blob_count);
+      if (footer.dictionary_offset) {
+        TraceRecordHeader dictionary_header;
+        const uint8_t* dictionary_data;
+        if (!GetRecord(footer.dictionary_offset, TraceRecordType::kDictionary,
+                       dictionary_header, dictionary_data)) {
+          XELOGE("Trace blob dictionary record is invalid");
+          return false;
+        }
+        blob_dictionary_ = ZSTD_createDDict(dictionary_data,
+                                            dictionary_header.encoded_length);
+      }
+    }
+  }
+
+  if (frame_record_offsets_.empty() && blob_record_offsets_.empty()) {
+    // Not closed properly, likely if the emulator has crashed during a
+    // streaming trace - locate the records that have been fully written.
+    XELOGW("Trace has no record index, scanning the records");
+    uint64_t offset = sizeof(TraceHeader);
+    bool scanning = true;
+    while (scanning && trace_size_ - offset >= sizeof(TraceRecordHeader)) {
+      TraceRecordHeader record_header;
+      std::memcpy(&record_header, trace_data_ + offset, sizeof(record_header));
+      if (trace_size_ - offset - sizeof(record_header) <
+          record_header.encoded_length) {
+        break;
+      }
+      switch (record_header.type) {
+        case TraceRecordType::kFrame:
+          frame_record_offsets_.push_back(offset);
+          break;
+        case TraceRecordType::kBlob:
+          blob_record_offsets_.push_back(offset);
+          break;
+        case TraceRecordType::kDictionary:
+          if (!blob_dictionary_) {
+            blob_dictionary_ =
+                ZSTD_createDDict(trace_data_ + offset + sizeof(record_header),
+                                 record_header.encoded_length);
+          }
+          break;
+        default:
+          scanning = false;
+          break;
+      }
+      offset += sizeof(record_header) + record_header.encoded_length;
+    }
+  }
+
+  blob_decompression_context_ = ZSTD_createDCtx();
+  if (!blob_decompression_context_) {
+    XELOGE("Failed to create the trace blob decompression context");
+    return false;
+  }
+  return true;
+}
+
+bool TraceReader::GetRecord(uint64_t offset, TraceRecordType type,
+                            TraceRecordHeader& header_out,
+                            const uint8_t*& data_out) const {
+  if (offset > trace_size_ ||
+      trace_size_ - offset < sizeof(TraceRecordHeader)) {
+    return false;
+  }
+  std::memcpy(&header_out, trace_data_ + offset, sizeof(header_out));
+  if (header_out.type != type || trace_size_ - offset - sizeof(header_out) <
+                                     header_out.encoded_length) {
+    return false;
+  }
+  data_out = trace_data_ + offset + sizeof(header_out);
+  return true;
 }
 
-void TraceReader::ParseTrace() {
-  // Skip file header.
-  auto trace_ptr = trace_data_;
-  trace_ptr += sizeof(TraceHeader);
+void TraceReader::LoadFrame(int n) {
+  Frame& frame = frames_[n];
+  frame = Frame();
+  TraceRecordHeader record_header;
+  const uint8_t* record_data;
+  std::unique_ptr<uint8_t[]> data;
+  size_t data_size = 0;
+  if (GetRecord(frame_record_offsets_[n], TraceRecordType::kFrame,
+                record_header, record_data)) {
+    data = std::make_unique<uint8_t[]>(record_header.decoded_length);
+    size_t decompressed_size =
+        ZSTD_decompress(data.get(), record_header.decoded_length, record_data,
+                        record_header.encoded_length);
+    if (!ZSTD_isError(decompressed_size) &&
+        decompressed_size == record_header.decoded_length) {
+      data_size = decompressed_size;
+    } else {
+      XELOGE("Failed to decompress trace frame {}", n);
+    }
+  } else {
+    XELOGE("Trace frame {} record is invalid", n);
+  }
+  if (data_size) {
+    std::vector<Frame> parsed_frames;
+    ParseCommands(data.get(), data_size, false, parsed_frames);
+    if (!parsed_frames.empty()) {
+      frame = std::move(parsed_frames.front());
+    }
+  }
+  if (!frame.start_ptr) {
+    // Keep the frame valid, but empty.
+    frame.start_ptr = frame.end_ptr = data.get();
+    frame.command_tree = std::make_unique<CommandBuffer>();
+  }
+  frame.data = std::move(data);
+}
+
+void TraceReader::ParseCommands(const uint8_t* data, size_t size,
+                                bool split_frames,
+                                std::vector<Frame>& frames_out) {
+  auto trace_ptr = data;
 
   Frame current_frame;
   current_frame.start_ptr = trace_ptr;
@@ -86,7 +272,7 @@ void TraceReader::ParseTrace() {
   current_frame.command_tree =
       std::unique_ptr<CommandBuffer>(current_command_buffer);
 
-  while (trace_ptr < trace_data_ + trace_size_) {
+  while (trace_ptr < data + size) {
     ++current_frame.command_count;
     auto type = static_cast<TraceCommandType>(xe::load<uint32_t>(trace_ptr));
     switch (type) {
@@ -134,6 +320,7 @@ void TraceReader::ParseTrace() {
         auto cmd = reinterpret_cast<const PacketStartCommand*>(trace_ptr);
         packet_start_ptr = trace_ptr;
         packet_start = cmd;
+        current_frame.packets.push_back(cmd);
         trace_ptr += sizeof(*cmd) + cmd->count * 4;
         break;
       }
@@ -176,13 +363,12 @@ void TraceReader::ParseTrace() {
         }
         if (pending_break) {
           current_frame.end_ptr = trace_ptr;
-          frames_.push_back(std::move(current_frame));
+          frames_out.push_back(std::move(current_frame));
+          current_frame = Frame();
           current_command_buffer = new CommandBuffer();
           current_frame.command_tree =
               std::unique_ptr<CommandBuffer>(current_command_buffer);
           current_frame.start_ptr = trace_ptr;
-          current_frame.end_ptr = nullptr;
-          current_frame.command_count = 0;
           pending_break = false;
         }
         break;
@@ -207,7 +393,7 @@ void TraceReader::ParseTrace() {
         trace_ptr += sizeof(*cmd);
         switch (cmd->event_type) {
           case EventCommand::Type::kSwap: {
-            pending_break = true;
+            pending_break = split_frames;
             break;
           }
         }
@@ -231,10 +417,34 @@ void TraceReader::ParseTrace() {
   }
   if (pending_break || current_frame.command_count) {
     current_frame.end_ptr = trace_ptr;
-    frames_.push_back(std::move(current_frame));
+    frames_out.push_back(std::move(current_frame));
   }
 }
 
+bool TraceReader::ReadBlob(uint32_t blob_index, void* dest,
+                           size_t dest_size) {
+  TraceRecordHeader record_header;
+  const uint8_t* record_data;
+  if (blob_index >= blob_record_offsets_.size() ||
+      !GetRecord(blob_record_offsets_[blob_index], TraceRecordType::kBlob,
+                 record_header, record_data) ||
+      record_header.decoded_length != dest_size) {
+    XELOGE("Trace blob {} is invalid", blob_index);
+    return false;
+  }
+  size_t decompressed_size;
+  if (blob_dictionary_) {
+    decompressed_size = ZSTD_decompress_usingDDict(
+        blob_decompression_context_, dest, dest_size, record_data,
+        record_header.encoded_length, blob_dictionary_);
+  } else {
+    decompressed_size =
+        ZSTD_decompressDCtx(blob_decompression_context_, dest, dest_size,
+                            record_data, record_header.encoded_length);
+  }
+  return !ZSTD_isError(decompressed_size) && decompressed_size == dest_size;
+}
+
 bool TraceReader::DecompressMemory(MemoryEncodingFormat encoding_format,
                                    const void* src, size_t src_size, void* dest,
                                    size_t dest_size) {
@@ -246,6 +456,11 @@ bool TraceReader::DecompressMemory(MemoryEncodingFormat encoding_format,
     case MemoryEncodingFormat::kSnappy:
       return snappy::RawUncompress(reinterpret_cast<const char*>(src), src_size,
                                    reinterpret_cast<char*>(dest));
+    case MemoryEncodingFormat::kBlob:
+      if (src_size != sizeof(uint32_t)) {
+        return false;
+      }
+      return ReadBlob(xe::load<uint32_t>(src), dest, dest_size);
     default:
       assert_unhandled_case(encoding_format);
       return false;
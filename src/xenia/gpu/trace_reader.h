@@ -10,6 +10,9 @@
 #ifndef XENIA_GPU_TRACE_READER_H_
 #define XENIA_GPU_TRACE_READER_H_
 
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <string_view>
 #include <vector>
 
@@ -17,6 +20,9 @@
 #include "xenia/gpu/trace_protocol.h"
 #include "xenia/memory.h"
 
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;
+typedef struct ZSTD_DDict_s ZSTD_DDict;
+
 namespace xe {
 namespace gpu {
 
@@ -87,16 +93,26 @@ class TraceReader {
 
     // Tree of all command buffers
     std::unique_ptr<CommandBuffer> command_tree;
+
+    // All PM4 packets in the frame in the order of execution, each followed by
+    // the recorded big-endian ring buffer dwords of the packet.
+    std::vector<const PacketStartCommand*> packets;
+
+    // Decompressed commands if the frame is loaded from a record.
+    std::unique_ptr<uint8_t[]> data;
   };
 
   TraceReader() = default;
-  virtual ~TraceReader() = default;
+  virtual ~TraceReader();
 
   const TraceHeader* header() const {
     return reinterpret_cast<const TraceHeader*>(trace_data_);
   }
 
-  const Frame* frame(int n) const { return &frames_[n]; }
+  // Frames of compressed traces are decompressed when accessed, with only the
+  // kMaxLoadedFrames most recently accessed ones kept in memory, so the
+  // returned pointer stays valid only until other frames are accessed.
+  const Frame* frame(int n);
   int frame_count() const { return int(frames_.size()); }
 
   bool Open(const std::string_view path);
@@ -104,7 +120,18 @@ class TraceReader {
   void Close();
 
  protected:
-  void ParseTrace();
+  static constexpr size_t kMaxLoadedFrames = 4;
+
+  // Parses the command stream of kTraceFormatVersionFlat traces, or of a single
+  // frame if split_frames is false.
+  void ParseCommands(const uint8_t* data, size_t size, bool split_frames,
+                     std::vector<Frame>& frames_out);
+  bool ReadRecordIndex();
+  bool GetRecord(uint64_t offset, TraceRecordType type,
+                 TraceRecordHeader& header_out,
+                 const uint8_t*& data_out) const;
+  void LoadFrame(int n);
+  bool ReadBlob(uint32_t blob_index, void* dest, size_t dest_size);
   bool DecompressMemory(MemoryEncodingFormat encoding_format, const void* src,
                         size_t src_size, void* dest, size_t dest_size);
 
@@ -112,6 +139,15 @@ class TraceReader {
   const uint8_t* trace_data_ = nullptr;
   size_t trace_size_ = 0;
   std::vector<Frame> frames_;
+
+  // For compressed traces.
+  std::vector<uint64_t> frame_record_offsets_;
+  std::vector<uint64_t> blob_record_offsets_;
+  // Indices of the loaded frames, from the least recently accessed.
+  std::deque<int> loaded_frames_;
+  ZSTD_DDict* blob_dictionary_ = nullptr;
+  // Blobs are decompressed during playback on the command processor thread.
+  ZSTD_DCtx* blob_decompression_context_ = nullptr;
 };
 
 }  // namespace gpu
@@ -9,26 +9,41 @@
 
 #include "xenia/gpu/trace_writer.h"
 
+#include <algorithm>
 #include <cstring>
+#include <memory>
 
-#include "third_party/snappy/snappy-sinksource.h"
-#include "third_party/snappy/snappy.h"
+#include "third_party/zstd/lib/zdict.h"
+#include "third_party/zstd/lib/zstd.h"
 
 #include "version.h"
 #include "xenia/base/assert.h"
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/string.h"
+#include "xenia/base/xxhash.h"
 #include "xenia/gpu/registers.h"
 #include "xenia/gpu/xenos.h"
 
 namespace xe {
 namespace gpu {
 #if XE_ENABLE_TRACE_WRITER_INSTRUMENTATION == 1
+namespace {
+// Fast enough to keep up with streaming traces.
+constexpr int kTraceCompressionLevel = 3;
+// Small blobs, such as constants and vertex data of individual draws, benefit
+// from a dictionary the most. The dictionary is trained once enough of them are
+// collected, or when the amount of blobs kept in memory until then gets large.
+constexpr size_t kMaxBlobDictionarySampleLength = 128 * 1024;
+constexpr size_t kBlobDictionarySampleLength = 8 * 1024 * 1024;
+constexpr size_t kMaxPendingBlobLength = 64 * 1024 * 1024;
+constexpr size_t kBlobDictionaryCapacity = 112 * 1024;
+}  // namespace
+
 TraceWriter::TraceWriter(uint8_t* membase)
     : membase_(membase), file_(nullptr) {}
 
-TraceWriter::~TraceWriter() = default;
+TraceWriter::~TraceWriter() { Close(); }
 
 bool TraceWriter::Open(const std::filesystem::path& path, uint32_t title_id) {
   Close();
@@ -44,6 +59,13 @@ bool TraceWriter::Open(const std::filesystem::path& path, uint32_t title_id) {
     return false;
   }
 
+  compression_context_ = ZSTD_createCCtx();
+  if (!compression_context_) {
+    fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+
   // Write header first. Must be at the top of the file.
   TraceHeader header;
   header.version = kTraceFormatVersion;
@@ -51,6 +73,7 @@ bool TraceWriter::Open(const std::filesystem::path& path, uint32_t title_id) {
               sizeof(header.build_commit_sha));
   header.title_id = title_id;
   fwrite(&header, sizeof(header), 1, file_);
+  file_offset_ = sizeof(header);
 
   cached_memory_reads_.clear();
   return true;
@@ -64,7 +87,38 @@ void TraceWriter::Flush() {
 
 void TraceWriter::Close() {
   if (file_) {
+    WriteFrameRecord();
+    WritePendingBlobs();
+
+    std::vector<uint64_t> index;
+    index.reserve(frame_record_offsets_.size() + blob_record_offsets_.size());
+    index.insert(index.end(), frame_record_offsets_.cbegin(),
+                 frame_record_offsets_.cend());
+    index.insert(index.end(), blob_record_offsets_.cbegin(),
+                 blob_record_offsets_.cend());
+    TraceFooter footer = {};
+    footer.index_offset = WriteRecord(TraceRecordType::kIndex, index.data(),
+                                      sizeof(uint64_t) * index.size());
+    footer.dictionary_offset = dictionary_record_offset_;
+    footer.frame_count = uint32_t(frame_record_offsets_.size());
+    footer.blob_count = uint32_t(blob_record_offsets_.size());
+    footer.magic = kTraceFooterMagic;
+    fwrite(&footer, sizeof(footer), 1, file_);
+
     cached_memory_reads_.clear();
+    frame_data_.clear();
+    frame_record_offsets_.clear();
+    blob_record_offsets_.clear();
+    dictionary_record_offset_ = 0;
+    blob_indices_.clear();
+    blob_count_ = 0;
+    blob_dictionary_pending_ = true;
+    if (blob_dictionary_) {
+      ZSTD_freeCDict(blob_dictionary_);
+      blob_dictionary_ = nullptr;
+    }
+    ZSTD_freeCCtx(compression_context_);
+    compression_context_ = nullptr;
 
     fflush(file_);
     fclose(file_);
@@ -81,7 +135,7 @@ void TraceWriter::WritePrimaryBufferStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       0,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendFrameData(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WritePrimaryBufferEnd() {
@@ -91,7 +145,7 @@ void TraceWriter::WritePrimaryBufferEnd() {
   PrimaryBufferEndCommand cmd = {
       TraceCommandType::kPrimaryBufferEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendFrameData(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WriteIndirectBufferStart(uint32_t base_ptr, uint32_t count) {
@@ -103,7 +157,7 @@ void TraceWriter::WriteIndirectBufferStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       0,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendFrameData(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WriteIndirectBufferEnd() {
@@ -113,7 +167,7 @@ void TraceWriter::WriteIndirectBufferEnd() {
   IndirectBufferEndCommand cmd = {
       TraceCommandType::kIndirectBufferEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendFrameData(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WritePacketStart(uint32_t base_ptr, uint32_t count) {
@@ -125,8 +179,8 @@ void TraceWriter::WritePacketStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       count,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
-  fwrite(membase_ + base_ptr, 4, count, file_);
+  AppendFrameData(&cmd, sizeof(cmd));
+  AppendFrameData(membase_ + base_ptr, sizeof(uint32_t) * count);
 }
 
 void TraceWriter::WritePacketEnd() {
@@ -136,7 +190,7 @@ void TraceWriter::WritePacketEnd() {
   PacketEndCommand cmd = {
       TraceCommandType::kPacketEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendFrameData(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WriteMemoryRead(uint32_t base_ptr, size_t length,
@@ -181,86 +235,43 @@ void TraceWriter::WriteMemoryWrite(uint32_t base_ptr, size_t length,
                      host_ptr);
 }
 
-class SnappySink : public snappy::Sink {
- public:
-  SnappySink(FILE* file) : file_(file) {}
-
-  void Append(const char* bytes, size_t n) override {
-    fwrite(bytes, 1, n, file_);
-  }
-
- private:
-  FILE* file_ = nullptr;
-};
-
 void TraceWriter::WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
                                      size_t length, const void* host_ptr) {
   MemoryCommand cmd = {};
   cmd.type = type;
   cmd.base_ptr = base_ptr;
-  cmd.encoding_format = MemoryEncodingFormat::kNone;
-  cmd.encoded_length = cmd.decoded_length = static_cast<uint32_t>(length);
+  cmd.decoded_length = static_cast<uint32_t>(length);
 
   if (!host_ptr) {
     host_ptr = membase_ + cmd.base_ptr;
   }
 
-  bool compress = compress_output_ && length > compression_threshold_;
-  if (compress) {
-    // Write the header now so we reserve space in the buffer.
-    long header_position = std::ftell(file_);
-    cmd.encoding_format = MemoryEncodingFormat::kSnappy;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-
-    // Stream the content right to the buffer.
-    snappy::ByteArraySource snappy_source(
-        reinterpret_cast<const char*>(host_ptr), cmd.decoded_length);
-    SnappySink snappy_sink(file_);
-    cmd.encoded_length =
-        static_cast<uint32_t>(snappy::Compress(&snappy_source, &snappy_sink));
-
-    // Seek back and overwrite the header with our final size.
-    std::fseek(file_, header_position, SEEK_SET);
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    std::fseek(file_, header_position + sizeof(cmd) + cmd.encoded_length,
-               SEEK_SET);
+  if (length >= blob_threshold_) {
+    uint32_t blob_index = WriteBlob(host_ptr, length);
+    cmd.encoding_format = MemoryEncodingFormat::kBlob;
+    cmd.encoded_length = sizeof(blob_index);
+    AppendFrameData(&cmd, sizeof(cmd));
+    AppendFrameData(&blob_index, sizeof(blob_index));
   } else {
-    // Uncompressed - write buffer directly to the file.
+    // Small enough to be compressed along with the commands.
     cmd.encoding_format = MemoryEncodingFormat::kNone;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    fwrite(host_ptr, 1, cmd.decoded_length, file_);
+    cmd.encoded_length = cmd.decoded_length;
+    AppendFrameData(&cmd, sizeof(cmd));
+    AppendFrameData(host_ptr, cmd.decoded_length);
   }
 }
 
 void TraceWriter::WriteEdramSnapshot(const void* snapshot) {
+  if (!file_) {
+    return;
+  }
   EdramSnapshotCommand cmd = {};
   cmd.type = TraceCommandType::kEdramSnapshot;
-
-  if (compress_output_) {
-    // Write the header now so we reserve space in the buffer.
-    long header_position = std::ftell(file_);
-    cmd.encoding_format = MemoryEncodingFormat::kSnappy;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-
-    // Stream the content right to the buffer.
-    snappy::ByteArraySource snappy_source(
-        reinterpret_cast<const char*>(snapshot), xenos::kEdramSizeBytes);
-    SnappySink snappy_sink(file_);
-    cmd.encoded_length =
-        static_cast<uint32_t>(snappy::Compress(&snappy_source, &snappy_sink));
-
-    // Seek back and overwrite the header with our final size.
-    std::fseek(file_, header_position, SEEK_SET);
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    std::fseek(file_, header_position + sizeof(cmd) + cmd.encoded_length,
-               SEEK_SET);
-  } else {
-    // Uncompressed - write buffer directly to the file.
-    cmd.encoding_format = MemoryEncodingFormat::kNone;
-    cmd.encoded_length = xenos::kEdramSizeBytes;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    fwrite(snapshot, 1, xenos::kEdramSizeBytes, file_);
-  }
+  uint32_t blob_index = WriteBlob(snapshot, xenos::kEdramSizeBytes);
+  cmd.encoding_format = MemoryEncodingFormat::kBlob;
+  cmd.encoded_length = sizeof(blob_index);
+  AppendFrameData(&cmd, sizeof(cmd));
+  AppendFrameData(&blob_index, sizeof(blob_index));
 }
 
 void TraceWriter::WriteEvent(EventCommand::Type event_type) {
@@ -271,51 +282,38 @@ void TraceWriter::WriteEvent(EventCommand::Type event_type) {
       TraceCommandType::kEvent,
       event_type,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  AppendFrameData(&cmd, sizeof(cmd));
+  if (event_type == EventCommand::Type::kSwap) {
+    WriteFrameRecord();
+  }
 }
 
 void TraceWriter::WriteRegisters(uint32_t first_register,
                                  const uint32_t* register_values,
                                  uint32_t register_count,
                                  bool execute_callbacks_on_play) {
+  if (!file_) {
+    return;
+  }
   RegistersCommand cmd = {};
   cmd.type = TraceCommandType::kRegisters;
   cmd.first_register = first_register;
   cmd.register_count = register_count;
   cmd.execute_callbacks = execute_callbacks_on_play;
-
-  uint32_t uncompressed_length = uint32_t(sizeof(uint32_t) * register_count);
-  if (compress_output_) {
-    // Write the header now so we reserve space in the buffer.
-    long header_position = std::ftell(file_);
-    cmd.encoding_format = MemoryEncodingFormat::kSnappy;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-
-    // Stream the content right to the buffer.
-    snappy::ByteArraySource snappy_source(
-        reinterpret_cast<const char*>(register_values), uncompressed_length);
-    SnappySink snappy_sink(file_);
-    cmd.encoded_length =
-        static_cast<uint32_t>(snappy::Compress(&snappy_source, &snappy_sink));
-
-    // Seek back and overwrite the header with our final size.
-    std::fseek(file_, header_position, SEEK_SET);
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    std::fseek(file_, header_position + sizeof(cmd) + cmd.encoded_length,
-               SEEK_SET);
-  } else {
-    // Uncompressed - write the values directly to the file.
-    cmd.encoding_format = MemoryEncodingFormat::kNone;
-    cmd.encoded_length = uncompressed_length;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    fwrite(register_values, 1, uncompressed_length, file_);
-  }
+  // Compressed along with the commands.
+  cmd.encoding_format = MemoryEncodingFormat::kNone;
+  cmd.encoded_length = uint32_t(sizeof(uint32_t) * register_count);
+  AppendFrameData(&cmd, sizeof(cmd));
+  AppendFrameData(register_values, cmd.encoded_length);
 }
 
 void TraceWriter::WriteGammaRamp(
     const reg::DC_LUT_30_COLOR* gamma_ramp_256_entry_table,
     const reg::DC_LUT_PWL_DATA* gamma_ramp_pwl_rgb,
     uint32_t gamma_ramp_rw_component) {
+  if (!file_) {
+    return;
+  }
   GammaRampCommand cmd = {};
   cmd.type = TraceCommandType::kGammaRamp;
   cmd.rw_component = uint8_t(gamma_ramp_rw_component);
@@ -324,42 +322,141 @@ void TraceWriter::WriteGammaRamp(
       sizeof(reg::DC_LUT_30_COLOR) * 256;
   constexpr uint32_t kPWLUncompressedLength =
       sizeof(reg::DC_LUT_PWL_DATA) * 3 * 128;
-  constexpr uint32_t kUncompressedLength =
+  // Compressed along with the commands.
+  cmd.encoding_format = MemoryEncodingFormat::kNone;
+  cmd.encoded_length =
       k256EntryTableUncompressedLength + kPWLUncompressedLength;
-  if (compress_output_) {
-    // Write the header now so we reserve space in the buffer.
-    long header_position = std::ftell(file_);
-    cmd.encoding_format = MemoryEncodingFormat::kSnappy;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-
-    // Stream the content right to the buffer.
-    {
-      std::unique_ptr<char[]> gamma_ramps(new char[kUncompressedLength]);
-      std::memcpy(gamma_ramps.get(), gamma_ramp_256_entry_table,
+  AppendFrameData(&cmd, sizeof(cmd));
+  AppendFrameData(gamma_ramp_256_entry_table,
                   k256EntryTableUncompressedLength);
-      std::memcpy(gamma_ramps.get() + k256EntryTableUncompressedLength,
-                  gamma_ramp_pwl_rgb, kPWLUncompressedLength);
-      snappy::ByteArraySource snappy_source(gamma_ramps.get(),
-                                            kUncompressedLength);
-      SnappySink snappy_sink(file_);
-      cmd.encoded_length =
-          static_cast<uint32_t>(snappy::Compress(&snappy_source, &snappy_sink));
+  AppendFrameData(gamma_ramp_pwl_rgb, kPWLUncompressedLength);
+}
+
+void TraceWriter::AppendFrameData(const void* data, size_t length) {
+  const uint8_t* data_bytes = reinterpret_cast<const uint8_t*>(data);
+  frame_data_.insert(frame_data_.end(), data_bytes, data_bytes + length);
+}
+
+void TraceWriter::WriteFrameRecord() {
+  if (frame_data_.empty()) {
+    return;
+  }
+  frame_record_offsets_.push_back(WriteRecord(
+      TraceRecordType::kFrame, frame_data_.data(), frame_data_.size()));
+  frame_data_.clear();
+}
+
+uint32_t TraceWriter::WriteBlob(const void* data, size_t length) {
+  // Repeated reads of the same resources (and identical resources at different
+  // addresses) are stored only once.
+  uint64_t hash = XXH3_64bits(data, length);
+  auto blob_it = blob_indices_.find(hash);
+  if (blob_it != blob_indices_.end()) {
+    return blob_it->second;
+  }
+  uint32_t blob_index = blob_count_++;
+  blob_indices_.emplace(hash, blob_index);
+
+  if (!blob_dictionary_pending_) {
+    blob_record_offsets_.push_back(
+        WriteRecord(TraceRecordType::kBlob, data, length));
+    return blob_index;
+  }
+
+  const uint8_t* data_bytes = reinterpret_cast<const uint8_t*>(data);
+  pending_blob_data_.insert(pending_blob_data_.end(), data_bytes,
+                            data_bytes + length);
+  pending_blob_lengths_.push_back(length);
+  if (length <= kMaxBlobDictionarySampleLength) {
+    pending_blob_sample_length_ += length;
+  }
+  if (pending_blob_sample_length_ >= kBlobDictionarySampleLength ||
+      pending_blob_data_.size() >= kMaxPendingBlobLength) {
+    WritePendingBlobs();
+  }
+  return blob_index;
+}
+
+void TraceWriter::WritePendingBlobs() {
+  if (!blob_dictionary_pending_) {
+    return;
+  }
+  blob_dictionary_pending_ = false;
+
+  // Train only on the small blobs, the large ones compress well by themselves.
+  std::vector<uint8_t> samples;
+  std::vector<size_t> sample_lengths;
+  samples.reserve(pending_blob_sample_length_);
+  size_t pending_blob_offset = 0;
+  for (size_t length : pending_blob_lengths_) {
+    if (length <= kMaxBlobDictionarySampleLength) {
+      samples.insert(
+          samples.end(), pending_blob_data_.cbegin() + pending_blob_offset,
+          pending_blob_data_.cbegin() + pending_blob_offset + length);
+      sample_lengths.push_back(length);
+    }
+    pending_blob_offset += length;
+  }
+  if (!sample_lengths.empty()) {
+    std::unique_ptr<uint8_t[]> dictionary(
+        new uint8_t[kBlobDictionaryCapacity]);
+    size_t dictionary_length = ZDICT_trainFromBuffer(
+        dictionary.get(), kBlobDictionaryCapacity, samples.data(),
+        sample_lengths.data(), unsigned(sample_lengths.size()));
+    // Fails if there are too few samples, the blobs are compressed without a
+    // dictionary in this case.
+    if (!ZDICT_isError(dictionary_length)) {
+      blob_dictionary_ = ZSTD_createCDict(dictionary.get(), dictionary_length,
+                                          kTraceCompressionLevel);
+      if (blob_dictionary_) {
+        dictionary_record_offset_ = WriteRecord(
+            TraceRecordType::kDictionary, dictionary.get(), dictionary_length);
+      }
     }
+  }
 
-    // Seek back and overwrite the header with our final size.
-    std::fseek(file_, header_position, SEEK_SET);
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    std::fseek(file_, header_position + sizeof(cmd) + cmd.encoded_length,
-               SEEK_SET);
-  } else {
-    // Uncompressed - write the values directly to the file.
-    cmd.encoding_format = MemoryEncodingFormat::kNone;
-    cmd.encoded_length = kUncompressedLength;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    fwrite(gamma_ramp_256_entry_table, 1, k256EntryTableUncompressedLength,
-           file_);
-    fwrite(gamma_ramp_pwl_rgb, 1, kPWLUncompressedLength, file_);
+  pending_blob_offset = 0;
+  for (size_t length : pending_blob_lengths_) {
+    blob_record_offsets_.push_back(
+        WriteRecord(TraceRecordType::kBlob,
+                    pending_blob_data_.data() + pending_blob_offset, length));
+    pending_blob_offset += length;
   }
+  pending_blob_data_.clear();
+  pending_blob_data_.shrink_to_fit();
+  pending_blob_lengths_.clear();
+  pending_blob_sample_length_ = 0;
+}
+
+uint64_t TraceWriter::WriteRecord(TraceRecordType type, const void* data,
+                                  size_t length) {
+  TraceRecordHeader header = {};
+  header.type = type;
+  header.decoded_length = uint32_t(length);
+  const void* encoded_data = data;
+  header.encoded_length = header.decoded_length;
+  if (type == TraceRecordType::kFrame || type == TraceRecordType::kBlob) {
+    record_buffer_.resize(std::max(record_buffer_.size(),
+                                   ZSTD_compressBound(length)));
+    size_t compressed_length;
+    if (type == TraceRecordType::kBlob && blob_dictionary_) {
+      compressed_length = ZSTD_compress_usingCDict(
+          compression_context_, record_buffer_.data(), record_buffer_.size(),
+          data, length, blob_dictionary_);
+    } else {
+      compressed_length = ZSTD_compressCCtx(
+          compression_context_, record_buffer_.data(), record_buffer_.size(),
+          data, length, kTraceCompressionLevel);
+    }
+    assert_false(ZSTD_isError(compressed_length));
+    encoded_data = record_buffer_.data();
+    header.encoded_length = uint32_t(compressed_length);
+  }
+  uint64_t header_offset = file_offset_;
+  fwrite(&header, sizeof(header), 1, file_);
+  fwrite(encoded_data, 1, header.encoded_length, file_);
+  file_offset_ += sizeof(header) + header.encoded_length;
+  return header_offset;
 }
 #endif
 }  //  namespace gpu
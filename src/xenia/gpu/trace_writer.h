@@ -10,9 +10,13 @@
 #ifndef XENIA_GPU_TRACE_WRITER_H_
 #define XENIA_GPU_TRACE_WRITER_H_
 
+#include <cstdint>
+#include <cstdio>
 #include <filesystem>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "xenia/gpu/registers.h"
 #include "xenia/gpu/trace_protocol.h"
@@ -27,6 +31,9 @@
 #define XE_ENABLE_TRACE_WRITER_INSTRUMENTATION 1
 #endif
 
+typedef struct ZSTD_CCtx_s ZSTD_CCtx;
+typedef struct ZSTD_CDict_s ZSTD_CDict;
+
 namespace xe {
 namespace gpu {
 
@@ -66,12 +73,42 @@ class TraceWriter {
   void WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
                           size_t length, const void* host_ptr = nullptr);
 
+  void AppendFrameData(const void* data, size_t length);
+  // Writes the commands of the current frame as a record.
+  void WriteFrameRecord();
+  // Returns the index of the blob with the contents, writing it if it's new.
+  uint32_t WriteBlob(const void* data, size_t length);
+  // Trains the blob dictionary on the pending blobs and writes them.
+  void WritePendingBlobs();
+  // Returns the offset of the record header in the file.
+  uint64_t WriteRecord(TraceRecordType type, const void* data, size_t length);
+
   std::set<uint64_t> cached_memory_reads_;
   uint8_t* membase_;
   FILE* file_;
-
-  bool compress_output_ = true;
-  size_t compression_threshold_ = 1024;  // Min. number of bytes to compress.
+  uint64_t file_offset_ = 0;
+
+  // Commands since the last frame record.
+  std::vector<uint8_t> frame_data_;
+  std::vector<uint8_t> record_buffer_;
+  std::vector<uint64_t> frame_record_offsets_;
+  std::vector<uint64_t> blob_record_offsets_;
+  uint64_t dictionary_record_offset_ = 0;
+
+  // Blob indices by the XXH3 hashes of their contents.
+  std::unordered_map<uint64_t, uint32_t> blob_indices_;
+  uint32_t blob_count_ = 0;
+  // Blobs collected before the dictionary is trained, concatenated.
+  bool blob_dictionary_pending_ = true;
+  std::vector<uint8_t> pending_blob_data_;
+  std::vector<size_t> pending_blob_lengths_;
+  size_t pending_blob_sample_length_ = 0;
+
+  ZSTD_CCtx* compression_context_ = nullptr;
+  ZSTD_CDict* blob_dictionary_ = nullptr;
+
+  // Min. number of bytes to store in a blob rather than with the commands.
+  size_t blob_threshold_ = 1024;
 
 #else
   // this could be annoying to maintain if new methods are added or the
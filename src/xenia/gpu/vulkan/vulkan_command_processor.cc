@@ -9,11 +9,13 @@
 
 #include "xenia/gpu/vulkan/vulkan_command_processor.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 
 #include "xenia/apu/audio_system.h"
 #include "xenia/base/assert.h"
+#include "xenia/base/bit_range.h"
 #include "xenia/base/byte_order.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
@@ -22,6 +24,7 @@
 #include "xenia/gpu/draw_util.h"
 #include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/packet_disassembler.h"
+#include "xenia/gpu/register_write_ranges.h"
 #include "xenia/gpu/registers.h"
 #include "xenia/gpu/shader.h"
 #include "xenia/gpu/spirv_shader_translator.h"
@@ -1407,10 +1410,60 @@ void VulkanCommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
 void VulkanCommandProcessor::WriteRegistersFromMem(uint32_t start_index,
                                                    uint32_t* base,
                                                    uint32_t num_registers) {
-  for (uint32_t i = 0; i < num_registers; ++i) {
-    uint32_t data = xe::load_and_swap<uint32_t>(base + i);
-    VulkanCommandProcessor::WriteRegister(start_index + i, data);
-  }
+  // Same invalidation as in WriteRegister, but once for every run of constants.
+  struct Handler {
+    VulkanCommandProcessor& command_processor;
+    void OnSpecialRegisterWritten(uint32_t index, uint32_t value) {
+      command_processor.HandleSpecialRegisterWrite(index, value);
+    }
+    void OnFloatConstantsWritten(uint32_t first_index, uint32_t count) {
+      if (!command_processor.frame_open_) {
+        return;
+      }
+      uint32_t first_constant =
+          (first_index - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2;
+      uint32_t end_constant =
+          ((first_index + count - 1 - XE_GPU_REG_SHADER_CONSTANT_000_X) >> 2) +
+          1;
+      if (first_constant < 256 &&
+          bit_range::IsAnySet(
+              command_processor.current_float_constant_map_vertex_,
+              first_constant, std::min(end_constant, UINT32_C(256)) -
+                                  first_constant)) {
+        command_processor.current_constant_buffers_up_to_date_ &= ~(
+            UINT32_C(1) << SpirvShaderTranslator::kConstantBufferFloatVertex);
+      }
+      if (end_constant > 256) {
+        uint32_t first_pixel_constant = std::max(first_constant, UINT32_C(256));
+        if (bit_range::IsAnySet(
+                command_processor.current_float_constant_map_pixel_,
+                first_pixel_constant - 256,
+                end_constant - first_pixel_constant)) {
+          command_processor.current_constant_buffers_up_to_date_ &=
+              ~(UINT32_C(1)
+                << SpirvShaderTranslator::kConstantBufferFloatPixel);
+        }
+      }
+    }
+    void OnFetchConstantsWritten(uint32_t first_index, uint32_t count) {
+      command_processor.current_constant_buffers_up_to_date_ &=
+          ~(UINT32_C(1) << SpirvShaderTranslator::kConstantBufferFetch);
+      if (command_processor.texture_cache_) {
+        uint32_t first_fetch_constant, last_fetch_constant;
+        register_write_ranges::GetFetchConstantRange(
+            first_index, count, first_fetch_constant, last_fetch_constant);
+        command_processor.texture_cache_->TextureFetchConstantsWritten(
+            first_fetch_constant, last_fetch_constant);
+      }
+    }
+    void OnBoolLoopConstantsWritten(uint32_t first_index, uint32_t count) {
+      command_processor.current_constant_buffers_up_to_date_ &=
+          ~(UINT32_C(1) << SpirvShaderTranslator::kConstantBufferBoolLoop);
+    }
+  };
+  Handler handler = {*this};
+  register_write_ranges::WriteRange(register_file_->values, start_index, base,
+                                    num_registers, handler);
 }
 void VulkanCommandProcessor::SparseBindBuffer(
     VkBuffer buffer, uint32_t bind_count, const VkSparseMemoryBind* binds,
@@ -2376,6 +2429,9 @@ bool VulkanCommandProcessor::IssueDraw(xenos::PrimitiveType prim_type,
     return IssueCopy();
   }
 
+  // Pick up the guest writes to the watched memory since the last draw.
+  shared_memory_->PollGuestWrites();
+
   const ui::vulkan::VulkanDevice::Properties& device_properties =
       GetVulkanDevice()->properties();
 
@@ -2494,6 +2550,11 @@ bool VulkanCommandProcessor::IssueDraw(xenos::PrimitiveType prim_type,
                            pixel_shader->GetOrCreateTranslation(
                                pixel_shader_modification.value))
                      : nullptr;
+    if (!pipeline_cache_->RequestShaderTranslations(vertex_shader_translation,
+                                                    pixel_shader_translation)) {
+      // Still being translated in the background.
+      return true;
+    }
     if (!pipeline_cache_->EnsureShadersTranslated(vertex_shader_translation,
                                                   pixel_shader_translation)) {
       return false;
@@ -2987,6 +3048,7 @@ bool VulkanCommandProcessor::IssueCopy() {
   if (!BeginSubmission(true)) {
     return false;
   }
+  shared_memory_->PollGuestWrites();
 
   uint32_t written_address, written_length;
   reg::RB_COPY_DEST_INFO copy_dest_info;
@@ -4210,6 +4272,8 @@ bool VulkanCommandProcessor::BeginSubmission(bool is_guest_command) {
     primitive_processor_->BeginFrame();
 
     texture_cache_->BeginFrame();
+
+    pipeline_cache_->BeginFrame();
   }
 
   return true;
@@ -16,6 +16,7 @@
 #include "third_party/fmt/include/fmt/format.h"
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
@@ -59,6 +60,23 @@ DEFINE_int32(
     "the number of threads explicitly (up to the number of logical CPU cores), "
     "0 to disable multithreaded pipeline creation.",
     "Vulkan");
+DEFINE_int32(
+    vulkan_shader_translation_threads, 0,
+    "Number of threads used for translating shaders when they're first used "
+    "by a draw, instead of stalling command processing for the translation. "
+    "-1 to calculate automatically (50% of logical CPU cores), a positive "
+    "number to specify the number of threads explicitly (up to the number of "
+    "logical CPU cores), 0 to translate shaders on the command processor "
+    "thread.",
+    "Vulkan");
+DEFINE_bool(
+    vulkan_skip_draws_during_shader_translation, true,
+    "With vulkan_shader_translation_threads, skip draws using shaders that "
+    "are still being translated (objects may be missing for a few frames) "
+    "instead of waiting for the translation to be completed (the vertex and "
+    "the pixel shader are still translated in parallel then). Draws with "
+    "shaders exporting data to memory are never skipped.",
+    "Vulkan");
 namespace xe {
 namespace gpu {
 namespace vulkan {
@@ -195,6 +213,26 @@ bool VulkanPipelineCache::Initialize() {
     // Pick some reasonable amount if couldn't determine the number of cores.
     logical_processor_count = 6;
   }
+  if (cvars::vulkan_shader_translation_threads != 0) {
+    size_t translation_thread_count;
+    if (cvars::vulkan_shader_translation_threads < 0) {
+      translation_thread_count =
+          std::max(logical_processor_count / 2, uint32_t(1));
+    } else {
+      translation_thread_count =
+          std::min(uint32_t(cvars::vulkan_shader_translation_threads),
+                   logical_processor_count);
+    }
+    translation_threads_shutdown_ = false;
+    for (size_t i = 0; i < translation_thread_count; ++i) {
+      std::unique_ptr<xe::threading::Thread> translation_thread =
+          xe::threading::Thread::Create({}, [this]() { TranslationThread(); });
+      assert_not_null(translation_thread);
+      translation_thread->set_name("Vulkan Shader Translation");
+      translation_threads_.push_back(std::move(translation_thread));
+    }
+  }
+
   creation_completion_event_ =
       xe::threading::Event::CreateManualResetEvent(true);
   assert_not_null(creation_completion_event_);
@@ -224,8 +262,20 @@ void VulkanPipelineCache::Shutdown() {
   // Shut down shader storage first.
   ShutdownShaderStorage();
 
-  // Shut down all threads, before destroying the pipelines since they may be
-  // creating them.
+  // Shut down all threads, before destroying the shaders and the pipelines
+  // since they may be translating or creating them.
+  if (!translation_threads_.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(translation_request_lock_);
+      translation_threads_shutdown_ = true;
+    }
+    translation_request_cond_.notify_all();
+    for (size_t i = 0; i < translation_threads_.size(); ++i) {
+      xe::threading::Wait(translation_threads_[i].get(), false);
+    }
+    translation_threads_.clear();
+    translation_queue_.clear();
+  }
   if (!creation_threads_.empty()) {
     {
       std::lock_guard<std::mutex> lock(creation_request_lock_);
@@ -475,6 +525,137 @@ VulkanPipelineCache::GetCurrentPixelShaderModification(
   return modification;
 }
 
+void VulkanPipelineCache::BeginFrame() {
+  uint64_t stall_ticks = frame_shader_translation_stall_ticks_.exchange(
+      0, std::memory_order_relaxed);
+  COUNT_profile_set("gpu/vulkan/shader_translation_stall_us",
+                    uint32_t(stall_ticks * 1000000 /
+                             xe::Clock::QueryHostTickFrequency()));
+  COUNT_profile_set("gpu/vulkan/shader_translation_skipped_draws",
+                    frame_shader_translation_skipped_draws_);
+  frame_shader_translation_skipped_draws_ = 0;
+}
+
+bool VulkanPipelineCache::RequestShaderTranslations(
+    VulkanShader::VulkanTranslation* vertex_shader,
+    VulkanShader::VulkanTranslation* pixel_shader) {
+  if (translation_threads_.empty()) {
+    return true;
+  }
+  using AsyncTranslationState =
+      VulkanShader::VulkanTranslation::AsyncTranslationState;
+  VulkanShader::VulkanTranslation* const translations[] = {vertex_shader,
+                                                           pixel_shader};
+  bool translation_pending = false;
+  // Memory export results may be consumed by the CPU or by later draws (for
+  // instance, pre-skinned vertices), unlike a missing object, dropping them
+  // can't be recovered from in the next frames.
+  bool skip_draw = cvars::vulkan_skip_draws_during_shader_translation;
+  for (VulkanShader::VulkanTranslation* translation : translations) {
+    if (!translation) {
+      continue;
+    }
+    if (translation->shader().memexport_eM_written()) {
+      skip_draw = false;
+    }
+    switch (translation->async_translation_state()) {
+      case AsyncTranslationState::kNotRequested:
+        // May have been translated on this thread before, such as for the
+        // shader storage.
+        if (translation->is_translated()) {
+          break;
+        }
+        translation->SetAsyncTranslationState(AsyncTranslationState::kQueued);
+        {
+          std::lock_guard<std::mutex> lock(translation_request_lock_);
+          translation_queue_.push_back(translation);
+        }
+        translation_request_cond_.notify_one();
+        translation_pending = true;
+        break;
+      case AsyncTranslationState::kQueued:
+        translation_pending = true;
+        break;
+      case AsyncTranslationState::kTranslated:
+        break;
+    }
+  }
+  if (!translation_pending) {
+    return true;
+  }
+  if (skip_draw) {
+    ++frame_shader_translation_skipped_draws_;
+    return false;
+  }
+  uint64_t wait_start = xe::Clock::QueryHostTickCount();
+  {
+    std::unique_lock<std::mutex> lock(translation_request_lock_);
+    translation_completion_cond_.wait(lock, [&translations]() {
+      for (VulkanShader::VulkanTranslation* translation : translations) {
+        if (translation && translation->async_translation_state() ==
+                               AsyncTranslationState::kQueued) {
+          return false;
+        }
+      }
+      return true;
+    });
+  }
+  frame_shader_translation_stall_ticks_.fetch_add(
+      xe::Clock::QueryHostTickCount() - wait_start, std::memory_order_relaxed);
+  return true;
+}
+
+void VulkanPipelineCache::AwaitShaderTranslations() {
+  if (translation_threads_.empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(translation_request_lock_);
+  translation_completion_cond_.wait(lock, [this]() {
+    return translation_queue_.empty() && !translation_threads_busy_;
+  });
+}
+
+void VulkanPipelineCache::TranslationThread() {
+  const ui::vulkan::VulkanDevice* const vulkan_device =
+      command_processor_.GetVulkanDevice();
+  SpirvShaderTranslator translator(
+      SpirvShaderTranslator::Features(vulkan_device),
+      render_target_cache_.msaa_2x_attachments_supported(),
+      render_target_cache_.msaa_2x_no_attachments_supported(),
+      render_target_cache_.GetPath() ==
+          RenderTargetCache::Path::kPixelShaderInterlock,
+      render_target_cache_.draw_resolution_scale_x(),
+      render_target_cache_.draw_resolution_scale_y());
+  for (;;) {
+    VulkanShader::VulkanTranslation* translation;
+    {
+      std::unique_lock<std::mutex> lock(translation_request_lock_);
+      translation_request_cond_.wait(lock, [this]() {
+        return !translation_queue_.empty() || translation_threads_shutdown_;
+      });
+      if (translation_threads_shutdown_) {
+        break;
+      }
+      translation = translation_queue_.front();
+      translation_queue_.pop_front();
+      ++translation_threads_busy_;
+    }
+
+    // The ucode has been analyzed on the command processor thread when
+    // choosing the modification. If this fails, the translation is marked as
+    // invalid, and draws with it are dropped by EnsureShadersTranslated.
+    TranslateAnalyzedShader(translator, *translation);
+    translation->SetAsyncTranslationState(
+        VulkanShader::VulkanTranslation::AsyncTranslationState::kTranslated);
+
+    {
+      std::lock_guard<std::mutex> lock(translation_request_lock_);
+      --translation_threads_busy_;
+    }
+    translation_completion_cond_.notify_all();
+  }
+}
+
 bool VulkanPipelineCache::EnsureShadersTranslated(
     VulkanShader::VulkanTranslation* vertex_shader,
     VulkanShader::VulkanTranslation* pixel_shader) {
@@ -485,8 +666,14 @@ bool VulkanPipelineCache::EnsureShadersTranslated(
                   xenos::VertexShaderExportMode::kPosition2VectorsEdgeKill);
   assert_false(register_file_.Get<reg::SQ_PROGRAM_CNTL>().gen_index_vtx);
   if (!vertex_shader->is_translated()) {
+    uint64_t translation_start = xe::Clock::QueryHostTickCount();
     vertex_shader->shader().AnalyzeUcode(ucode_disasm_buffer_);
-    if (!TranslateAnalyzedShader(*shader_translator_, *vertex_shader)) {
+    bool translated =
+        TranslateAnalyzedShader(*shader_translator_, *vertex_shader);
+    frame_shader_translation_stall_ticks_.fetch_add(
+        xe::Clock::QueryHostTickCount() - translation_start,
+        std::memory_order_relaxed);
+    if (!translated) {
       XELOGE("Failed to translate the vertex shader!");
       return false;
     }
@@ -497,8 +684,14 @@ bool VulkanPipelineCache::EnsureShadersTranslated(
   }
   if (pixel_shader != nullptr) {
     if (!pixel_shader->is_translated()) {
+      uint64_t translation_start = xe::Clock::QueryHostTickCount();
       pixel_shader->shader().AnalyzeUcode(ucode_disasm_buffer_);
-      if (!TranslateAnalyzedShader(*shader_translator_, *pixel_shader)) {
+      bool translated =
+          TranslateAnalyzedShader(*shader_translator_, *pixel_shader);
+      frame_shader_translation_stall_ticks_.fetch_add(
+          xe::Clock::QueryHostTickCount() - translation_start,
+          std::memory_order_relaxed);
+      if (!translated) {
         XELOGE("Failed to translate the pixel shader!");
         return false;
       }
@@ -864,8 +1057,16 @@ bool VulkanPipelineCache::TranslateAnalyzedShader(
   // TODO(Triang3l): Log that the shader has been successfully translated in
   // common code.
 
-  // Set up the texture binding layout.
-  if (shader.EnterBindingLayoutUserUIDSetup()) {
+  // Set up the texture binding layout. Modifications of the shader may be
+  // translated on multiple threads, and the layouts are shared - whichever
+  // translation gets here first sets up the UIDs, and others wait for them so
+  // the shader-level data is published before any translation is marked as
+  // completed.
+  if (!shader.AreBindingLayoutUserUIDsSetUp()) {
+    std::lock_guard<std::mutex> layouts_lock(layouts_mutex_);
+    if (shader.AreBindingLayoutUserUIDsSetUp()) {
+      return true;
+    }
     // Obtain the unique IDs of the binding layout if there are any texture
     // bindings, for invalidation in the command processor.
     size_t texture_binding_layout_uid = kLayoutUIDEmpty;
@@ -907,7 +1108,6 @@ bool VulkanPipelineCache::TranslateAnalyzedShader(
                                             new_uid);
       }
     }
-    shader.SetTextureBindingLayoutUserUID(texture_binding_layout_uid);
 
     // Use the sampler count for samplers because it's the only thing that must
     // be the same for layouts to be compatible in this case
@@ -917,7 +1117,8 @@ bool VulkanPipelineCache::TranslateAnalyzedShader(
         kLayoutUIDEmpty == 0,
         "Empty layout UID is assumed to be 0 because for bindful samplers, the "
         "UID is their count");
-    shader.SetSamplerBindingLayoutUserUID(
+    shader.SetBindingLayoutUserUIDs(
+        texture_binding_layout_uid,
         shader.GetSamplerBindingsAfterTranslation().size());
   }
 
@@ -929,6 +1130,9 @@ void VulkanPipelineCache::TranslateShadersForStorage(
     bool edram_fsi_used) {
   uint64_t translation_start = xe::Clock::QueryHostTickCount();
 
+  // Don't translate anything being translated for draws already.
+  AwaitShaderTranslations();
+
   std::vector<std::pair<VulkanShader*, uint64_t>> translations_to_do;
   translations_to_do.reserve(translations_needed.size());
   for (const auto& needed : translations_needed) {
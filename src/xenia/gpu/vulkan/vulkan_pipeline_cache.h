@@ -135,6 +135,18 @@ class VulkanPipelineCache {
       const Shader& shader, uint32_t interpolator_mask,
       uint32_t param_gen_pos) const;
 
+  void BeginFrame();
+
+  // With translation threads, queues the translation of the shaders that
+  // haven't been translated yet. Returns false if the draw needs to be skipped
+  // because the translation is still in progress, or, if draws should not be
+  // skipped or the shaders use memory export, waits for it to be completed.
+  // EnsureShadersTranslated must still be called afterwards.
+  bool RequestShaderTranslations(
+      VulkanShader::VulkanTranslation* vertex_shader,
+      VulkanShader::VulkanTranslation* pixel_shader);
+  // Waits for all the queued shader translations to be completed.
+  void AwaitShaderTranslations();
   bool EnsureShadersTranslated(VulkanShader::VulkanTranslation* vertex_shader,
                                VulkanShader::VulkanTranslation* pixel_shader);
   bool ConfigurePipeline(
@@ -466,6 +478,21 @@ class VulkanPipelineCache {
   // Previously used pipeline, to avoid lookups if the state wasn't changed.
   std::pair<const PipelineDescription, Pipeline>* last_pipeline_ = nullptr;
 
+  void TranslationThread();
+
+  // For asynchronous shader translation, with a translator per thread.
+  std::vector<std::unique_ptr<xe::threading::Thread>> translation_threads_;
+  bool translation_threads_shutdown_ = false;
+  size_t translation_threads_busy_ = 0;
+  std::deque<VulkanShader::VulkanTranslation*> translation_queue_;
+  std::mutex translation_request_lock_;
+  std::condition_variable translation_request_cond_;
+  std::condition_variable translation_completion_cond_;
+  // Time spent on the command processor thread translating shaders or waiting
+  // for their translation in the current frame.
+  std::atomic<uint64_t> frame_shader_translation_stall_ticks_{0};
+  uint32_t frame_shader_translation_skipped_draws_ = 0;
+
   void CreationThread();
 
   // For asynchronous creation.
@@ -117,7 +117,7 @@ void VulkanPrimitiveProcessor::EndSubmission() {
 }
 
 void VulkanPrimitiveProcessor::EndFrame() {
-  ClearPerFrameCache();
+  EndCacheFrame();
   frame_index_buffers_.clear();
 }
 
@@ -10,6 +10,7 @@
 #ifndef XENIA_GPU_VULKAN_VULKAN_SHADER_H_
 #define XENIA_GPU_VULKAN_VULKAN_SHADER_H_
 
+#include <atomic>
 #include <cstdint>
 
 #include "xenia/gpu/spirv_shader.h"
@@ -31,8 +32,25 @@ class VulkanShader : public SpirvShader {
     VkShaderModule GetOrCreateShaderModule();
     VkShaderModule shader_module() const { return shader_module_; }
 
+    // For translation on the pipeline cache translation threads - the results
+    // of a queued translation may be accessed by other threads only after
+    // observing kTranslated.
+    enum class AsyncTranslationState : uint32_t {
+      kNotRequested,
+      kQueued,
+      kTranslated,
+    };
+    AsyncTranslationState async_translation_state() const {
+      return async_translation_state_.load(std::memory_order_acquire);
+    }
+    void SetAsyncTranslationState(AsyncTranslationState state) {
+      async_translation_state_.store(state, std::memory_order_release);
+    }
+
    private:
     VkShaderModule shader_module_ = VK_NULL_HANDLE;
+    std::atomic<AsyncTranslationState> async_translation_state_{
+        AsyncTranslationState::kNotRequested};
   };
 
   explicit VulkanShader(const ui::vulkan::VulkanDevice* vulkan_device,
@@ -51,16 +69,16 @@ class VulkanShader : public SpirvShader {
     return sampler_binding_layout_user_uid_;
   }
   // Modifications of the same shader can be translated on different threads.
-  // The "set" function must only be called if "enter" returned true - these are
-  // set up only once.
-  bool EnterBindingLayoutUserUIDSetup() {
-    return !binding_layout_user_uids_set_up_.test_and_set();
-  }
-  void SetTextureBindingLayoutUserUID(size_t uid) {
-    texture_binding_layout_user_uid_ = uid;
+  // The UIDs are set up once, by the owner while holding its layout lock, and
+  // are published with release ordering - a translation must not be used until
+  // the UIDs have been observed as set up.
+  bool AreBindingLayoutUserUIDsSetUp() const {
+    return binding_layout_user_uids_set_up_.load(std::memory_order_acquire);
   }
-  void SetSamplerBindingLayoutUserUID(size_t uid) {
-    sampler_binding_layout_user_uid_ = uid;
+  void SetBindingLayoutUserUIDs(size_t texture_uid, size_t sampler_uid) {
+    texture_binding_layout_user_uid_ = texture_uid;
+    sampler_binding_layout_user_uid_ = sampler_uid;
+    binding_layout_user_uids_set_up_.store(true, std::memory_order_release);
   }
 
  protected:
@@ -69,7 +87,7 @@ class VulkanShader : public SpirvShader {
  private:
   const ui::vulkan::VulkanDevice* vulkan_device_;
 
-  std::atomic_flag binding_layout_user_uids_set_up_ = ATOMIC_FLAG_INIT;
+  std::atomic<bool> binding_layout_user_uids_set_up_{false};
   size_t texture_binding_layout_user_uid_ = 0;
   size_t sampler_binding_layout_user_uid_ = 0;
 };
@@ -9,10 +9,15 @@
 
 #include "xenia/memory.h"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cstring>
+#include <functional>
 #include <random>
 
 #include "third_party/fmt/include/fmt/format.h"
+#include "third_party/zstd/lib/zstd.h"
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_stream.h"
 #include "xenia/base/clock.h"
@@ -20,6 +25,7 @@
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/threading.h"
+#include "xenia/base/xxhash.h"
 
 #include "xenia/cpu/mmio_handler.h"
 
@@ -50,8 +56,39 @@ DEFINE_int32(scribble_heap_value, 0,
              "Value used to fill all allocated heap memory. 0 - Random value. "
              "Valid range: [1-255]",
              "Memory");
+DEFINE_int32(save_state_threads, -1,
+             "Number of additional threads to compress and decompress guest "
+             "memory with when saving and restoring the emulator state. -1 to "
+             "use 3/4 of the logical processors.",
+             "Memory");
+DEFINE_bool(physical_write_map, false,
+            "Track guest writes to GPU-watched physical memory by marking the "
+            "written pages in a map in the recompiled stores, polled before "
+            "every GPU draw and resolve, instead of write-protecting the "
+            "watched pages and catching access violations. Writes made by the "
+            "host on behalf of the guest are not tracked.",
+            "Memory");
+DEFINE_bool(host_write_tracking, false,
+            "Track guest writes to GPU-watched physical memory with the host "
+            "kernel, polled before every GPU draw and resolve, instead of "
+            "write-protecting the watched pages and catching access "
+            "violations. Requires Linux 6.7 or newer (asynchronous userfaultfd "
+            "write protection), otherwise falls back to write-protecting. "
+            "Ignored with --physical_write_map.",
+            "Memory");
 
 namespace xe {
+
+// One byte per 4 KB page of the 4 GB virtual address space, plus one for the
+// last byte of a store crossing the end of it.
+constexpr size_t kPhysicalWriteMapSize =
+    (size_t(1) << (32 - Memory::kPhysicalWriteMapPageShift)) + 1;
+// The summary is placed after the map, aligned for scanning it in 64-bit words.
+constexpr size_t kPhysicalWriteSummaryOffset =
+    xe::align(kPhysicalWriteMapSize, size_t(4096));
+constexpr size_t kPhysicalWriteSummarySize =
+    (size_t(1) << (32 - Memory::kPhysicalWriteSummaryShift)) + 1;
+
 uint32_t get_page_count(uint32_t value, uint32_t page_size) {
   return xe::round_up(value, page_size) / page_size;
 }
@@ -165,6 +202,14 @@ Memory::~Memory() {
     delete invalidation_callback;
   }
 
+  if (physical_write_map_) {
+    xe::memory::DeallocFixed(physical_write_map_, 0,
+                             xe::memory::DeallocationType::kRelease);
+    physical_write_map_ = nullptr;
+    physical_write_summary_ = nullptr;
+  }
+  physical_write_tracker_.reset();
+
   heaps_.v00000000.Dispose();
   heaps_.v40000000.Dispose();
   heaps_.v80000000.Dispose();
@@ -268,6 +313,35 @@ bool Memory::Initialize() {
                            xe::memory::PageAccess::kReadWrite);
   }
 
+  if (cvars::physical_write_map) {
+    // Only the pages of the map actually written to are committed.
+    physical_write_map_ = static_cast<uint8_t*>(xe::memory::AllocFixed(
+        nullptr, kPhysicalWriteSummaryOffset + kPhysicalWriteSummarySize,
+        xe::memory::AllocationType::kReserveCommit,
+        xe::memory::PageAccess::kReadWrite));
+    if (!physical_write_map_) {
+      XELOGE("Unable to allocate the physical memory write map");
+      return false;
+    }
+    physical_write_summary_ = physical_write_map_ + kPhysicalWriteSummaryOffset;
+    physical_write_tracking_ = PhysicalWriteTracking::kWriteMap;
+  } else if (cvars::host_write_tracking) {
+    physical_write_tracker_ = xe::memory::WriteTracker::Create();
+    if (physical_write_tracker_ &&
+        heaps_.vA0000000.RegisterWriteTracker(*physical_write_tracker_) &&
+        heaps_.vC0000000.RegisterWriteTracker(*physical_write_tracker_) &&
+        heaps_.vE0000000.RegisterWriteTracker(*physical_write_tracker_)) {
+      XELOGI("Tracking writes to physical memory with {}",
+             physical_write_tracker_->name());
+      physical_write_tracking_ = PhysicalWriteTracking::kHostTracker;
+    } else {
+      XELOGW(
+          "Host write tracking is not supported, write-protecting watched "
+          "physical memory instead");
+      physical_write_tracker_.reset();
+    }
+  }
+
   // Add handlers for MMIO.
   mmio_handler_ = cpu::MMIOHandler::Install(
       virtual_membase_, physical_membase_, physical_membase_ + 0x1FFFFFFF,
@@ -615,6 +689,7 @@ bool Memory::AccessViolationCallback(
   if (heap->heap_type() != HeapType::kGuestPhysical) {
     return false;
   }
+  ++physical_write_stats_.write_faults;
 
   // Access violation callbacks from the guest are triggered when the global
   // critical region mutex is locked once.
@@ -646,6 +721,24 @@ bool Memory::TriggerPhysicalMemoryCallbacks(
   return false;
 }
 
+uint32_t Memory::PollPhysicalWrites() {
+  if (physical_write_tracking_ == PhysicalWriteTracking::kProtect) {
+    return 0;
+  }
+  auto global_lock = global_critical_region_.Acquire();
+  uint32_t written_page_count = heaps_.vA0000000.CollectWrittenPages() +
+                                heaps_.vC0000000.CollectWrittenPages() +
+                                heaps_.vE0000000.CollectWrittenPages();
+  ++physical_write_stats_.polls;
+  physical_write_stats_.polled_pages += written_page_count;
+  return written_page_count;
+}
+
+Memory::PhysicalWriteStats Memory::GetPhysicalWriteStats() {
+  auto global_lock = global_critical_region_.Acquire();
+  return physical_write_stats_;
+}
+
 void* Memory::RegisterPhysicalMemoryInvalidationCallback(
     PhysicalMemoryInvalidationCallback callback, void* callback_context) {
   auto entry = new std::pair<PhysicalMemoryInvalidationCallback, void*>(
@@ -742,25 +835,82 @@ void Memory::DumpMap() {
   XELOGE("");
 }
 
-bool Memory::Save(ByteStream* stream) {
+std::array<BaseHeap*, 5> Memory::GetStateHeaps() {
+  return {
+      &heaps_.v00000000, &heaps_.v40000000, &heaps_.v80000000,
+      &heaps_.v90000000, &heaps_.physical,
+  };
+}
+
+bool Memory::Save(ByteStream* stream, const MemoryStateHashes* delta_base,
+                  MemoryStateHashes* hashes_out) {
   XELOGD("Serializing memory...");
-  heaps_.v00000000.Save(stream);
-  heaps_.v40000000.Save(stream);
-  heaps_.v80000000.Save(stream);
-  heaps_.v90000000.Save(stream);
-  heaps_.physical.Save(stream);
+  std::array<BaseHeap*, 5> heaps = GetStateHeaps();
+  if (delta_base && delta_base->heap_chunk_hashes.size() != heaps.size()) {
+    delta_base = nullptr;
+  }
+  if (hashes_out) {
+    hashes_out->heap_chunk_hashes.clear();
+    hashes_out->heap_chunk_hashes.resize(heaps.size());
+  }
+  for (size_t i = 0; i < heaps.size(); ++i) {
+    if (!heaps[i]->Save(
+            stream, delta_base ? &delta_base->heap_chunk_hashes[i] : nullptr,
+            hashes_out ? &hashes_out->heap_chunk_hashes[i] : nullptr)) {
+      return false;
+    }
+  }
 
   return true;
 }
 
-bool Memory::Restore(ByteStream* stream) {
+bool Memory::Restore(ByteStream* stream, ByteStream* base_stream,
+                     MemoryStateHashes* base_hashes_out) {
   XELOGD("Restoring memory...");
-  heaps_.v00000000.Restore(stream);
-  heaps_.v40000000.Restore(stream);
-  heaps_.v80000000.Restore(stream);
-  heaps_.v90000000.Restore(stream);
-  heaps_.physical.Restore(stream);
+  std::array<BaseHeap*, 5> heaps = GetStateHeaps();
+  if (base_hashes_out) {
+    base_hashes_out->heap_chunk_hashes.clear();
+    base_hashes_out->heap_chunk_hashes.resize(heaps.size());
+  }
+  for (size_t i = 0; i < heaps.size(); ++i) {
+    if (!heaps[i]->Restore(
+            stream, base_stream,
+            base_hashes_out ? &base_hashes_out->heap_chunk_hashes[i]
+                            : nullptr)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Memory::TakeSnapshot(const MemorySnapshot* previous,
+                          MemorySnapshot& snapshot_out) {
+  std::array<BaseHeap*, 5> heaps = GetStateHeaps();
+  if (previous && previous->heaps.size() != heaps.size()) {
+    previous = nullptr;
+  }
+  snapshot_out.heaps.clear();
+  snapshot_out.heaps.resize(heaps.size());
+  for (size_t i = 0; i < heaps.size(); ++i) {
+    if (!heaps[i]->TakeSnapshot(previous ? &previous->heaps[i] : nullptr,
+                                snapshot_out.heaps[i])) {
+      return false;
+    }
+  }
+  return true;
+}
 
+bool Memory::RestoreSnapshot(const MemorySnapshot& snapshot) {
+  std::array<BaseHeap*, 5> heaps = GetStateHeaps();
+  if (snapshot.heaps.size() != heaps.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < heaps.size(); ++i) {
+    if (!heaps[i]->RestoreSnapshot(snapshot.heaps[i])) {
+      return false;
+    }
+  }
   return true;
 }
 
@@ -875,45 +1025,323 @@ void BaseHeap::DumpMap() {
   }
 }
 
-bool BaseHeap::Save(ByteStream* stream) {
-  XELOGD("Heap {:08X}-{:08X}", heap_base_, heap_base_ + (heap_size_ - 1));
+namespace {
 
-  for (size_t i = 0; i < page_table_.size(); i++) {
-    auto& page = page_table_[i];
-    stream->Write(page.qword);
-    if (!page.state) {
-      // Unallocated.
-      continue;
+enum class StateChunkEncoding : uint32_t {
+  // No data - the chunk has no committed pages, or all of them are zero.
+  kEmpty,
+  // The non-zero committed pages, compressed with zstd.
+  kZstd,
+  // The non-zero committed pages, stored as is because they don't compress.
+  kRaw,
+  // Same as in the base state.
+  kBase,
+};
+
+struct StateChunkHeader {
+  // Hash of the committed page contents and of which pages are committed.
+  uint64_t hash;
+  // Committed pages that are zero and not stored in the chunk.
+  uint64_t zero_page_mask;
+  StateChunkEncoding encoding;
+  uint32_t encoded_length;
+};
+
+// Fast enough to not make saving the state bound by compression.
+constexpr int kStateCompressionLevel = 1;
+
+static_assert(BaseHeap::kStateChunkSize / 4096 <= 64,
+              "Chunk page masks must fit in 64 bits");
+
+// Calls the function, which takes work items from a shared atomic counter, on
+// the calling thread and on up to --save_state_threads more threads.
+void RunOnStateThreads(size_t work_item_count,
+                       const std::function<void()>& function) {
+  size_t thread_count = 0;
+  if (cvars::save_state_threads != 0 && work_item_count > 1) {
+    uint32_t logical_processor_count =
+        std::max(uint32_t(1), xe::threading::logical_processor_count());
+    if (cvars::save_state_threads < 0) {
+      thread_count = std::max(logical_processor_count * 3 / 4, uint32_t(1));
+    } else {
+      thread_count = std::min(uint32_t(cvars::save_state_threads),
+                              logical_processor_count);
+    }
+    thread_count = std::min(thread_count, work_item_count - 1);
+  }
+  std::vector<std::unique_ptr<xe::threading::Thread>> threads;
+  for (size_t i = 0; i < thread_count; ++i) {
+    auto thread = xe::threading::Thread::Create({}, function);
+    if (thread) {
+      thread->set_name("Save State");
+      threads.push_back(std::move(thread));
     }
+  }
+  function();
+  for (auto& thread : threads) {
+    xe::threading::Wait(thread.get(), false);
+  }
+}
 
-    // TODO(DrChat): write compressed with snappy.
-    if (page.state & kMemoryAllocationCommit) {
-      void* addr = TranslateRelative(i * page_size_);
+bool IsZeroPage(const uint8_t* page, uint32_t page_size) {
+  const uint64_t* page_qwords = reinterpret_cast<const uint64_t*>(page);
+  uint64_t bits = 0;
+  for (uint32_t i = 0; i < page_size / sizeof(uint64_t); ++i) {
+    bits |= page_qwords[i];
+  }
+  return !bits;
+}
 
-      memory::PageAccess old_access;
-      memory::Protect(addr, page_size_, memory::PageAccess::kReadWrite,
-                      &old_access);
+// Takes the chunk table of a heap state from the stream, and skips the chunk
+// data.
+bool ReadStateChunks(ByteStream* stream, uint32_t chunk_count,
+                     std::vector<StateChunkHeader>& headers_out,
+                     std::vector<const uint8_t*>& data_out) {
+  if (stream->Read<uint32_t>() != chunk_count) {
+    return false;
+  }
+  headers_out.resize(chunk_count);
+  stream->Read(headers_out.data(), sizeof(StateChunkHeader) * chunk_count);
+  data_out.resize(chunk_count);
+  const uint8_t* data = stream->data() + stream->offset();
+  size_t data_length = 0;
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    data_out[i] = data + data_length;
+    data_length += headers_out[i].encoded_length;
+  }
+  if (stream->data_length() - stream->offset() < data_length) {
+    return false;
+  }
+  stream->Advance(data_length);
+  return true;
+}
 
-      stream->Write(addr, page_size_);
+}  // namespace
 
-      memory::Protect(addr, page_size_, old_access, nullptr);
-    }
+uint32_t BaseHeap::state_chunk_count() const {
+  uint32_t chunk_page_count = kStateChunkSize >> page_size_shift_;
+  return (uint32_t(page_table_.size()) + chunk_page_count - 1) /
+         chunk_page_count;
+}
+
+bool BaseHeap::SavePageTable(std::vector<uint8_t>& compressed_out) const {
+  uint32_t page_count = uint32_t(page_table_.size());
+  std::vector<uint64_t> page_table_qwords(page_count);
+  for (uint32_t i = 0; i < page_count; ++i) {
+    page_table_qwords[i] = page_table_[i].qword;
+  }
+  size_t page_table_size = sizeof(uint64_t) * page_count;
+  compressed_out.resize(ZSTD_compressBound(page_table_size));
+  size_t compressed_size =
+      ZSTD_compress(compressed_out.data(), compressed_out.size(),
+                    page_table_qwords.data(), page_table_size,
+                    kStateCompressionLevel);
+  if (ZSTD_isError(compressed_size)) {
+    XELOGE("Failed to compress the page table");
+    return false;
   }
+  compressed_out.resize(compressed_size);
+  return true;
+}
 
+bool BaseHeap::RestorePageTable(const uint8_t* compressed,
+                                size_t compressed_size) {
+  uint32_t page_count = uint32_t(page_table_.size());
+  std::vector<uint64_t> page_table_qwords(page_count);
+  size_t page_table_size = sizeof(uint64_t) * page_count;
+  if (ZSTD_decompress(page_table_qwords.data(), page_table_size, compressed,
+                      compressed_size) != page_table_size) {
+    XELOGE("Failed to decompress the page table");
+    return false;
+  }
+  for (uint32_t i = 0; i < page_count; ++i) {
+    page_table_[i].qword = page_table_qwords[i];
+  }
   return true;
 }
 
-bool BaseHeap::Restore(ByteStream* stream) {
-  XELOGD("Heap {:08X}-{:08X}", heap_base_, heap_base_ + (heap_size_ - 1));
+void BaseHeap::EncodeStateChunks(
+    const std::vector<uint64_t>* reference_chunk_hashes,
+    std::vector<MemoryStateChunk>& chunks_out,
+    std::vector<uint8_t>& chunks_unchanged_out) {
+  uint32_t page_count = uint32_t(page_table_.size());
+  uint32_t chunk_page_count = kStateChunkSize >> page_size_shift_;
+  uint32_t chunk_count = state_chunk_count();
+  if (reference_chunk_hashes &&
+      reference_chunk_hashes->size() != chunk_count) {
+    reference_chunk_hashes = nullptr;
+  }
+  chunks_out.clear();
+  chunks_out.resize(chunk_count);
+  chunks_unchanged_out.clear();
+  chunks_unchanged_out.resize(chunk_count, 0);
+  std::atomic<uint32_t> next_chunk_index = 0;
+  RunOnStateThreads(chunk_count, [&]() {
+    ZSTD_CCtx* compression_context = ZSTD_createCCtx();
+    std::unique_ptr<uint8_t[]> pages(new uint8_t[kStateChunkSize]);
+    while (true) {
+      uint32_t chunk_index = next_chunk_index.fetch_add(1);
+      if (chunk_index >= chunk_count) {
+        break;
+      }
+      MemoryStateChunk& chunk = chunks_out[chunk_index];
+      uint32_t first_page = chunk_index * chunk_page_count;
+      uint32_t end_page = std::min(first_page + chunk_page_count, page_count);
+      uint64_t commit_mask = 0;
+      size_t pages_size = 0;
+      for (uint32_t i = first_page; i < end_page; ++i) {
+        const PageEntry& page = page_table_[i];
+        if (!(page.state & kMemoryAllocationCommit)) {
+          continue;
+        }
+        uint64_t page_bit = UINT64_C(1) << (i - first_page);
+        commit_mask |= page_bit;
+        auto page_host = TranslateRelative<uint8_t*>(size_t(i) * page_size_);
+        // Only pages the guest can't read are inaccessible to the host.
+        bool unprotect = !(page.current_protect & kMemoryProtectRead);
+        memory::PageAccess old_access;
+        if (unprotect) {
+          memory::Protect(page_host, page_size_, memory::PageAccess::kReadOnly,
+                          &old_access);
+        }
+        if (IsZeroPage(page_host, page_size_)) {
+          chunk.zero_page_mask |= page_bit;
+        } else {
+          std::memcpy(pages.get() + pages_size, page_host, page_size_);
+          pages_size += page_size_;
+        }
+        if (unprotect) {
+          memory::Protect(page_host, page_size_, old_access, nullptr);
+        }
+      }
+      if (!commit_mask) {
+        continue;
+      }
+      uint64_t page_masks[] = {commit_mask, chunk.zero_page_mask};
+      chunk.hash = XXH3_64bits_withSeed(
+          pages.get(), pages_size, XXH3_64bits(page_masks, sizeof(page_masks)));
+      if (reference_chunk_hashes &&
+          (*reference_chunk_hashes)[chunk_index] == chunk.hash) {
+        chunks_unchanged_out[chunk_index] = 1;
+        continue;
+      }
+      if (!pages_size) {
+        continue;
+      }
+      chunk.data.resize(ZSTD_compressBound(pages_size));
+      size_t compressed_size =
+          compression_context
+              ? ZSTD_compressCCtx(compression_context, chunk.data.data(),
+                                  chunk.data.size(), pages.get(), pages_size,
+                                  kStateCompressionLevel)
+              : pages_size;
+      if (!ZSTD_isError(compressed_size) && compressed_size < pages_size) {
+        chunk.compressed = true;
+        chunk.data.resize(compressed_size);
+      } else {
+        chunk.data.assign(pages.get(), pages.get() + pages_size);
+      }
+    }
+    ZSTD_freeCCtx(compression_context);
+  });
+}
 
-  for (size_t i = 0; i < page_table_.size(); i++) {
-    auto& page = page_table_[i];
-    page.qword = stream->Read<uint64_t>();
-    if (!page.state) {
-      // Unallocated.
+bool BaseHeap::DecodeStateChunks(const std::vector<StateChunkSource>& chunks) {
+  uint32_t page_count = uint32_t(page_table_.size());
+  uint32_t chunk_page_count = kStateChunkSize >> page_size_shift_;
+  uint32_t chunk_count = state_chunk_count();
+  if (chunks.size() != chunk_count) {
+    return false;
+  }
+
+  // Commit the memory if it isn't already, and make it writable for loading.
+  // We do not need to reserve any memory, as the mapping has already taken
+  // care of that.
+  for (uint32_t i = 0; i < page_count;) {
+    if (!(page_table_[i].state & kMemoryAllocationCommit)) {
+      ++i;
       continue;
     }
-
+    uint32_t run_end = i + 1;
+    while (run_end < page_count &&
+           (page_table_[run_end].state & kMemoryAllocationCommit)) {
+      ++run_end;
+    }
+    void* run_host = TranslateRelative(size_t(i) * page_size_);
+    size_t run_size = size_t(run_end - i) * page_size_;
+    xe::memory::AllocFixed(run_host, run_size,
+                           memory::AllocationType::kCommit,
+                           memory::PageAccess::kReadWrite);
+    xe::memory::Protect(run_host, run_size, memory::PageAccess::kReadWrite,
+                        nullptr);
+    i = run_end;
+  }
+
+  std::atomic<uint32_t> next_chunk_index = 0;
+  std::atomic<bool> chunks_valid = true;
+  RunOnStateThreads(chunk_count, [&]() {
+    ZSTD_DCtx* decompression_context = ZSTD_createDCtx();
+    std::unique_ptr<uint8_t[]> pages(new uint8_t[kStateChunkSize]);
+    while (true) {
+      uint32_t chunk_index = next_chunk_index.fetch_add(1);
+      if (chunk_index >= chunk_count) {
+        break;
+      }
+      const StateChunkSource& chunk = chunks[chunk_index];
+      uint32_t first_page = chunk_index * chunk_page_count;
+      uint32_t end_page = std::min(first_page + chunk_page_count, page_count);
+      uint64_t commit_mask = 0;
+      for (uint32_t i = first_page; i < end_page; ++i) {
+        if (page_table_[i].state & kMemoryAllocationCommit) {
+          commit_mask |= UINT64_C(1) << (i - first_page);
+        }
+      }
+      size_t pages_size =
+          size_t(std::popcount(commit_mask & ~chunk.zero_page_mask)) *
+          page_size_;
+      const uint8_t* pages_source = chunk.data;
+      if (chunk.compressed) {
+        if (ZSTD_decompressDCtx(decompression_context, pages.get(),
+                                kStateChunkSize, chunk.data,
+                                chunk.data_length) != pages_size) {
+          chunks_valid = false;
+          continue;
+        }
+        pages_source = pages.get();
+      } else if (chunk.data_length != pages_size) {
+        chunks_valid = false;
+        continue;
+      }
+      for (uint32_t i = first_page; i < end_page; ++i) {
+        uint64_t page_bit = UINT64_C(1) << (i - first_page);
+        if (!(commit_mask & page_bit)) {
+          continue;
+        }
+        auto page_host = TranslateRelative<uint8_t*>(size_t(i) * page_size_);
+        if (chunk.zero_page_mask & page_bit) {
+          std::memset(page_host, 0, page_size_);
+        } else {
+          std::memcpy(page_host, pages_source, page_size_);
+          pages_source += page_size_;
+        }
+      }
+    }
+    ZSTD_freeDCtx(decompression_context);
+  });
+
+  // Set the protection back to its previous state.
+  for (uint32_t i = 0; i < page_count;) {
+    const PageEntry& page = page_table_[i];
+    if (!(page.state & kMemoryAllocationCommit)) {
+      ++i;
+      continue;
+    }
+    uint32_t run_end = i + 1;
+    while (run_end < page_count &&
+           (page_table_[run_end].state & kMemoryAllocationCommit) &&
+           page_table_[run_end].current_protect == page.current_protect) {
+      ++run_end;
+    }
     memory::PageAccess page_access = memory::PageAccess::kNoAccess;
     if ((page.current_protect & kMemoryProtectRead) &&
         (page.current_protect & kMemoryProtectWrite)) {
@@ -921,34 +1349,216 @@ bool BaseHeap::Restore(ByteStream* stream) {
     } else if (page.current_protect & kMemoryProtectRead) {
       page_access = memory::PageAccess::kReadOnly;
     }
+    xe::memory::Protect(TranslateRelative(size_t(i) * page_size_),
+                        size_t(run_end - i) * page_size_, page_access,
+                        nullptr);
+    i = run_end;
+  }
 
-    // Commit the memory if it isn't already. We do not need to reserve any
-    // memory, as the mapping has already taken care of that.
-    if (page.state & kMemoryAllocationCommit) {
-      xe::memory::AllocFixed(TranslateRelative(i * page_size_), page_size_,
-                             memory::AllocationType::kCommit,
-                             memory::PageAccess::kReadWrite);
+  RebuildFreeBlocks();
+
+  if (!chunks_valid) {
+    XELOGE("Invalid memory chunk data");
+    return false;
+  }
+  return true;
+}
+
+bool BaseHeap::Save(ByteStream* stream,
+                    const std::vector<uint64_t>* base_chunk_hashes,
+                    std::vector<uint64_t>* chunk_hashes_out) {
+  XELOGD("Heap {:08X}-{:08X}", heap_base_, heap_base_ + (heap_size_ - 1));
+
+  std::vector<uint8_t> page_table;
+  if (!SavePageTable(page_table)) {
+    return false;
+  }
+  stream->Write(uint32_t(page_table.size()));
+  stream->Write(page_table.data(), page_table.size());
+
+  std::vector<MemoryStateChunk> chunks;
+  std::vector<uint8_t> chunks_unchanged;
+  EncodeStateChunks(base_chunk_hashes, chunks, chunks_unchanged);
+  uint32_t chunk_count = uint32_t(chunks.size());
+  std::vector<StateChunkHeader> chunk_headers(chunk_count);
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    const MemoryStateChunk& chunk = chunks[i];
+    StateChunkHeader& header = chunk_headers[i];
+    header.hash = chunk.hash;
+    header.zero_page_mask = chunk.zero_page_mask;
+    if (chunks_unchanged[i]) {
+      header.encoding = StateChunkEncoding::kBase;
+    } else if (chunk.data.empty()) {
+      header.encoding = StateChunkEncoding::kEmpty;
+    } else {
+      header.encoding = chunk.compressed ? StateChunkEncoding::kZstd
+                                         : StateChunkEncoding::kRaw;
     }
+    header.encoded_length = uint32_t(chunk.data.size());
+  }
 
-    // Now read into memory. We'll set R/W protection first, then set the
-    // protection back to its previous state.
-    // TODO(DrChat): read compressed with snappy.
-    if (page.state & kMemoryAllocationCommit) {
-      void* addr = TranslateRelative(i * page_size_);
-      xe::memory::Protect(addr, page_size_, memory::PageAccess::kReadWrite,
-                          nullptr);
+  stream->Write(chunk_count);
+  stream->Write(chunk_headers.data(), sizeof(StateChunkHeader) * chunk_count);
+  for (const MemoryStateChunk& chunk : chunks) {
+    stream->Write(chunk.data.data(), chunk.data.size());
+  }
+
+  if (chunk_hashes_out) {
+    chunk_hashes_out->resize(chunk_count);
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+      (*chunk_hashes_out)[i] = chunks[i].hash;
+    }
+  }
+
+  return true;
+}
 
-      stream->Read(addr, page_size_);
+bool BaseHeap::Restore(ByteStream* stream, ByteStream* base_stream,
+                       std::vector<uint64_t>* base_chunk_hashes_out) {
+  XELOGD("Heap {:08X}-{:08X}", heap_base_, heap_base_ + (heap_size_ - 1));
+
+  uint32_t page_table_compressed_size = stream->Read<uint32_t>();
+  if (stream->data_length() - stream->offset() < page_table_compressed_size) {
+    XELOGE("Invalid page table");
+    return false;
+  }
+  const uint8_t* page_table_compressed = stream->data() + stream->offset();
+  stream->Advance(page_table_compressed_size);
 
-      xe::memory::Protect(addr, page_size_, page_access, nullptr);
+  uint32_t chunk_count = state_chunk_count();
+  std::vector<StateChunkHeader> chunk_headers;
+  std::vector<const uint8_t*> chunk_data;
+  if (!ReadStateChunks(stream, chunk_count, chunk_headers, chunk_data)) {
+    XELOGE("Invalid memory chunk table");
+    return false;
+  }
+  std::vector<StateChunkHeader> base_chunk_headers;
+  std::vector<const uint8_t*> base_chunk_data;
+  if (base_stream) {
+    // Only the chunks are needed from the base state.
+    base_stream->Advance(base_stream->Read<uint32_t>());
+    if (!ReadStateChunks(base_stream, chunk_count, base_chunk_headers,
+                         base_chunk_data)) {
+      XELOGE("Invalid base state memory chunk table");
+      return false;
     }
   }
 
-  RebuildFreeBlocks();
+  std::vector<StateChunkSource> chunk_sources(chunk_count);
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    const StateChunkHeader* header = &chunk_headers[i];
+    const uint8_t* data = chunk_data[i];
+    if (header->encoding == StateChunkEncoding::kBase) {
+      if (!base_stream) {
+        XELOGE("Memory chunk {} is stored in the base state", i);
+        return false;
+      }
+      // The base state file may have been overwritten since the delta was
+      // saved.
+      if (base_chunk_headers[i].hash != header->hash) {
+        XELOGE("Memory chunk {} in the base state has different contents", i);
+        return false;
+      }
+      header = &base_chunk_headers[i];
+      data = base_chunk_data[i];
+    }
+    if (header->encoding != StateChunkEncoding::kEmpty &&
+        header->encoding != StateChunkEncoding::kZstd &&
+        header->encoding != StateChunkEncoding::kRaw) {
+      XELOGE("Invalid memory chunk {} encoding", i);
+      return false;
+    }
+    StateChunkSource& chunk_source = chunk_sources[i];
+    chunk_source.zero_page_mask = header->zero_page_mask;
+    chunk_source.compressed = header->encoding == StateChunkEncoding::kZstd;
+    chunk_source.data = data;
+    chunk_source.data_length = header->encoded_length;
+  }
+
+  if (base_chunk_hashes_out) {
+    const std::vector<StateChunkHeader>& hashed_chunk_headers =
+        base_stream ? base_chunk_headers : chunk_headers;
+    base_chunk_hashes_out->resize(chunk_count);
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+      (*base_chunk_hashes_out)[i] = hashed_chunk_headers[i].hash;
+    }
+  }
 
+  if (!RestorePageTable(page_table_compressed, page_table_compressed_size)) {
+    return false;
+  }
+  return DecodeStateChunks(chunk_sources);
+}
+
+bool BaseHeap::TakeSnapshot(const HeapSnapshot* previous,
+                            HeapSnapshot& snapshot_out) {
+  std::vector<uint8_t> page_table;
+  if (!SavePageTable(page_table)) {
+    return false;
+  }
+  if (previous && previous->page_table &&
+      *previous->page_table == page_table) {
+    snapshot_out.page_table = previous->page_table;
+  } else {
+    snapshot_out.page_table =
+        std::make_shared<const std::vector<uint8_t>>(std::move(page_table));
+  }
+
+  uint32_t chunk_count = state_chunk_count();
+  if (previous && previous->chunks.size() != chunk_count) {
+    previous = nullptr;
+  }
+  std::vector<uint64_t> previous_chunk_hashes;
+  if (previous) {
+    previous_chunk_hashes.resize(chunk_count);
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+      const MemoryStateChunk* previous_chunk = previous->chunks[i].get();
+      previous_chunk_hashes[i] = previous_chunk ? previous_chunk->hash : 0;
+    }
+  }
+  std::vector<MemoryStateChunk> chunks;
+  std::vector<uint8_t> chunks_unchanged;
+  EncodeStateChunks(previous ? &previous_chunk_hashes : nullptr, chunks,
+                    chunks_unchanged);
+  snapshot_out.chunks.clear();
+  snapshot_out.chunks.resize(chunk_count);
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    MemoryStateChunk& chunk = chunks[i];
+    if (chunks_unchanged[i]) {
+      snapshot_out.chunks[i] = previous->chunks[i];
+    } else if (!chunk.data.empty() || chunk.zero_page_mask) {
+      // Chunks without committed pages are left null.
+      snapshot_out.chunks[i] =
+          std::make_shared<const MemoryStateChunk>(std::move(chunk));
+    }
+  }
   return true;
 }
 
+bool BaseHeap::RestoreSnapshot(const HeapSnapshot& snapshot) {
+  uint32_t chunk_count = state_chunk_count();
+  if (!snapshot.page_table || snapshot.chunks.size() != chunk_count) {
+    return false;
+  }
+  std::vector<StateChunkSource> chunk_sources(chunk_count);
+  for (uint32_t i = 0; i < chunk_count; ++i) {
+    const MemoryStateChunk* chunk = snapshot.chunks[i].get();
+    if (!chunk) {
+      continue;
+    }
+    StateChunkSource& chunk_source = chunk_sources[i];
+    chunk_source.zero_page_mask = chunk->zero_page_mask;
+    chunk_source.compressed = chunk->compressed;
+    chunk_source.data = chunk->data.data();
+    chunk_source.data_length = chunk->data.size();
+  }
+  if (!RestorePageTable(snapshot.page_table->data(),
+                        snapshot.page_table->size())) {
+    return false;
+  }
+  return DecodeStateChunks(chunk_sources);
+}
+
 void BaseHeap::RebuildFreeBlocks() {
   free_blocks_.clear();
   uint32_t run_start = UINT32_MAX;
@@ -2047,6 +2657,21 @@ XE_NOINLINE void PhysicalHeap::EnableAccessCallbacksInner(
     xe::memory::PageAccess protect_access) XE_RESTRICT {
   uint8_t* protect_base = membase_ + heap_base_;
   uint32_t protect_system_page_first = UINT32_MAX;
+  uint8_t* write_map = memory_->physical_write_map_;
+  uint32_t write_map_pages_per_system_page =
+      system_page_size_ >> Memory::kPhysicalWriteMapPageShift;
+  xe::memory::WriteTracker* write_tracker =
+      memory_->physical_write_tracker_.get();
+  auto protect_range = [&](uint32_t range_first, uint32_t range_end) {
+    uint8_t* range_base = protect_base + (range_first << system_page_shift_);
+    size_t range_length = size_t(range_end - range_first) << system_page_shift_;
+    if (write_tracker) {
+      // Only the written state is reset, the pages stay writable.
+      write_tracker->Watch(range_base, range_length);
+    } else {
+      xe::memory::Protect(range_base, range_length, protect_access);
+    }
+  };
 
   SystemPageFlagsBlock* XE_RESTRICT sys_page_flags = system_page_flags_.data();
   PageEntry* XE_RESTRICT page_table_ptr = page_table_.data();
@@ -2114,27 +2739,28 @@ XE_NOINLINE void PhysicalHeap::EnableAccessCallbacksInner(
         }
       }
     }
+    if (protect_system_page && write_map) {
+      // Writes are marked by the guest code instead - only forget the ones
+      // done before the page was watched.
+      std::memset(write_map + ((heap_base_ + (i << system_page_shift_)) >>
+                               Memory::kPhysicalWriteMapPageShift),
+                  0, write_map_pages_per_system_page);
+      protect_system_page = false;
+    }
     if (protect_system_page) {
       if (protect_system_page_first == UINT32_MAX) {
         protect_system_page_first = i;
       }
     } else {
       if (protect_system_page_first != UINT32_MAX) {
-        xe::memory::Protect(
-            protect_base + (protect_system_page_first << system_page_shift_),
-            (i - protect_system_page_first) << system_page_shift_,
-            protect_access);
+        protect_range(protect_system_page_first, i);
         protect_system_page_first = UINT32_MAX;
       }
     }
   }
 
   if (protect_system_page_first != UINT32_MAX) {
-    xe::memory::Protect(
-        protect_base + (protect_system_page_first << system_page_shift_),
-        (system_page_last + 1 - protect_system_page_first)
-            << system_page_shift_,
-        protect_access);
+    protect_range(protect_system_page_first, system_page_last + 1);
   }
 }
 bool PhysicalHeap::TriggerCallbacks(
@@ -2259,8 +2885,10 @@ bool PhysicalHeap::TriggerCallbacks(
     block_index_last = system_page_last >> 6;
   }
 
-  // Unprotect ranges that need unprotection.
-  if (unprotect) {
+  // Unprotect ranges that need unprotection (never protected when tracking
+  // writes with the write map or the host write tracker).
+  if (unprotect && memory_->physical_write_tracking_ ==
+                       PhysicalWriteTracking::kProtect) {
     uint8_t* protect_base = membase_ + heap_base_;
     uint32_t unprotect_system_page_first = UINT32_MAX;
     for (uint32_t i = system_page_first; i <= system_page_last; ++i) {
@@ -2315,6 +2943,181 @@ bool PhysicalHeap::TriggerCallbacks(
   return true;
 }
 
+bool PhysicalHeap::RegisterWriteTracker(
+    xe::memory::WriteTracker& write_tracker) {
+  return write_tracker.Register(
+      membase_ + heap_base_, size_t(system_page_count_) << system_page_shift_);
+}
+
+uint32_t PhysicalHeap::CollectWrittenPages() {
+  uint8_t* write_map = memory_->physical_write_map_;
+  uint32_t write_map_pages_per_system_page =
+      system_page_size_ >> Memory::kPhysicalWriteMapPageShift;
+  xe::memory::WriteTracker* write_tracker =
+      memory_->physical_write_tracker_.get();
+  if (write_tracker) {
+    // Only scanning the blocks of 64 system pages containing watched pages,
+    // once for every contiguous range of such blocks - unwatched pages are
+    // reported as written, and scanning the whole heap is much slower. The
+    // bits of the other blocks are not used.
+    uint32_t block_count = uint32_t(system_page_flags_.size());
+    host_written_pages_.resize(block_count);
+    for (uint32_t block_first = 0; block_first < block_count;) {
+      if (!system_page_flags_[block_first].notify_on_invalidation) {
+        ++block_first;
+        continue;
+      }
+      uint32_t block_end = block_first + 1;
+      while (block_end < block_count &&
+             system_page_flags_[block_end].notify_on_invalidation) {
+        ++block_end;
+      }
+      auto written_pages_first = host_written_pages_.begin() + block_first;
+      auto written_pages_end = host_written_pages_.begin() + block_end;
+      std::fill(written_pages_first, written_pages_end, 0);
+      uint32_t system_page_first = block_first << 6;
+      uint32_t system_page_end =
+          std::min(block_end << 6, system_page_count_);
+      if (!write_tracker->GetWrittenPages(
+              membase_ + heap_base_ +
+                  (size_t(system_page_first) << system_page_shift_),
+              size_t(system_page_end - system_page_first)
+                  << system_page_shift_,
+              host_written_pages_.data() + block_first)) {
+        // Invalidating everything watched rather than missing writes.
+        XELOGE("Failed to get the pages written to physical memory");
+        std::fill(written_pages_first, written_pages_end, UINT64_MAX);
+      }
+      block_first = block_end;
+    }
+  }
+  uint32_t physical_address_offset = GetPhysicalAddress(heap_base_);
+  uint32_t written_page_count = 0;
+
+  // Invalidating contiguous written pages with one callback invocation.
+  uint32_t run_first = UINT32_MAX;
+  uint32_t run_last = UINT32_MAX;
+  auto invalidate_run = [&]() {
+    if (run_first == UINT32_MAX) {
+      return;
+    }
+    uint32_t physical_address_start =
+        xe::sat_sub(run_first << system_page_shift_, host_address_offset()) +
+        physical_address_offset;
+    uint32_t physical_length = std::min(
+        xe::sat_sub((run_last << system_page_shift_) + system_page_size_,
+                    host_address_offset()) +
+            physical_address_offset - physical_address_start,
+        heap_size_ - (physical_address_start - physical_address_offset));
+    if (physical_length) {
+      for (auto invalidation_callback :
+           memory_->physical_memory_invalidation_callbacks_) {
+        invalidation_callback->first(invalidation_callback->second,
+                                     physical_address_start, physical_length,
+                                     true);
+      }
+    }
+    run_first = UINT32_MAX;
+  };
+
+  // Collects the written pages among the watched ones in the mask.
+  auto collect_block = [&](uint32_t block_index, uint64_t page_mask) {
+    uint64_t watched_bits =
+        system_page_flags_[block_index].notify_on_invalidation & page_mask;
+    uint64_t written_bits = 0;
+    while (watched_bits) {
+      uint32_t bit = xe::tzcnt(watched_bits);
+      watched_bits &= watched_bits - 1;
+      uint32_t system_page = (block_index << 6) + bit;
+      if (write_map) {
+        uint8_t* write_map_pages =
+            write_map + ((heap_base_ + (system_page << system_page_shift_)) >>
+                         Memory::kPhysicalWriteMapPageShift);
+        bool written = false;
+        for (uint32_t i = 0; i < write_map_pages_per_system_page; ++i) {
+          if (write_map_pages[i]) {
+            written = true;
+            break;
+          }
+        }
+        if (!written) {
+          continue;
+        }
+        std::memset(write_map_pages, 0, write_map_pages_per_system_page);
+      } else if (!(host_written_pages_[block_index] & (uint64_t(1) << bit))) {
+        continue;
+      }
+      written_bits |= uint64_t(1) << bit;
+      if (run_first != UINT32_MAX && system_page != run_last + 1) {
+        invalidate_run();
+      }
+      if (run_first == UINT32_MAX) {
+        run_first = system_page;
+      }
+      run_last = system_page;
+    }
+    if (written_bits) {
+      system_page_flags_[block_index].notify_on_invalidation &= ~written_bits;
+      written_page_count += uint32_t(std::popcount(written_bits));
+    }
+  };
+
+  if (!write_map) {
+    for (uint32_t block_index = 0; block_index < system_page_flags_.size();
+         ++block_index) {
+      collect_block(block_index, UINT64_MAX);
+    }
+    invalidate_run();
+    return written_page_count;
+  }
+
+  // Only visiting the regions marked in the summary, so the cost of polling
+  // doesn't depend on how much memory is watched.
+  uint8_t* write_summary = memory_->physical_write_summary_;
+  uint32_t region_system_page_shift =
+      Memory::kPhysicalWriteSummaryShift -
+      std::min(system_page_shift_, Memory::kPhysicalWriteSummaryShift);
+  uint32_t region_system_page_count = uint32_t(1) << region_system_page_shift;
+  uint64_t region_page_mask =
+      region_system_page_count >= 64
+          ? UINT64_MAX
+          : (uint64_t(1) << region_system_page_count) - 1;
+  uint32_t region_first = heap_base_ >> Memory::kPhysicalWriteSummaryShift;
+  uint32_t region_end = uint32_t(
+      ((uint64_t(heap_base_) +
+        (uint64_t(system_page_count_) << system_page_shift_) - 1) >>
+       Memory::kPhysicalWriteSummaryShift) +
+      1);
+  for (uint32_t region = region_first; region < region_end;) {
+    if (!(region & 7) && region_end - region >= 8) {
+      uint64_t summary_word;
+      std::memcpy(&summary_word, write_summary + region, sizeof(uint64_t));
+      if (!summary_word) {
+        region += 8;
+        continue;
+      }
+    }
+    if (!write_summary[region]) {
+      ++region;
+      continue;
+    }
+    // Clearing the summary mark before checking the pages, so a store marking
+    // a page that is not seen here leaves the region marked for the next poll.
+    write_summary[region] = 0;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint32_t system_page_first =
+        (((region << Memory::kPhysicalWriteSummaryShift) - heap_base_) >>
+         system_page_shift_);
+    uint32_t block_index = system_page_first >> 6;
+    if (block_index < system_page_flags_.size()) {
+      collect_block(block_index, region_page_mask << (system_page_first & 63));
+    }
+    ++region;
+  }
+  invalidate_run();
+  return written_page_count;
+}
+
 uint32_t PhysicalHeap::GetPhysicalAddress(uint32_t address) const {
   assert_true(address >= heap_base_);
   address -= heap_base_;
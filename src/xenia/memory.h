@@ -10,6 +10,8 @@
 #ifndef XENIA_MEMORY_H_
 #define XENIA_MEMORY_H_
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <map>
 #include <memory>
@@ -37,6 +39,17 @@ enum SystemHeapFlag : uint32_t {
   kSystemHeapDefault = kSystemHeapVirtual,
 };
 
+// How guest writes to the physical memory watched with access callbacks are
+// detected.
+enum class PhysicalWriteTracking {
+  // Watched pages are write-protected, and writes cause access violations.
+  kProtect,
+  // The recompiled stores mark the pages in Memory::physical_write_map().
+  kWriteMap,
+  // The host kernel tracks the writes (xe::memory::WriteTracker).
+  kHostTracker,
+};
+
 enum class HeapType : uint8_t {
   kGuestVirtual,
   kGuestXex,
@@ -99,6 +112,39 @@ union PageEntry {
   };
 };
 
+// Content hashes of the chunks of committed pages of every heap in a saved
+// state, allowing later states to be saved as deltas containing only the chunks
+// that have changed since.
+struct MemoryStateHashes {
+  std::vector<std::vector<uint64_t>> heap_chunk_hashes;
+};
+
+// Committed pages of a BaseHeap::kStateChunkSize chunk of a heap, with the zero
+// pages elided.
+struct MemoryStateChunk {
+  // Hash of the committed page contents and of which pages are committed.
+  uint64_t hash = 0;
+  // Committed pages that are zero and not stored in the data.
+  uint64_t zero_page_mask = 0;
+  // Whether the data is compressed with zstd rather than stored as is.
+  bool compressed = false;
+  std::vector<uint8_t> data;
+};
+
+// In-memory snapshot of the state of a heap. Chunks that haven't changed since
+// the previous snapshot are shared with it rather than stored again, so the
+// snapshot mostly takes as much memory as the guest has written to since.
+struct HeapSnapshot {
+  // Compressed with zstd.
+  std::shared_ptr<const std::vector<uint8_t>> page_table;
+  // Null for chunks without committed pages.
+  std::vector<std::shared_ptr<const MemoryStateChunk>> chunks;
+};
+
+struct MemorySnapshot {
+  std::vector<HeapSnapshot> heaps;
+};
+
 // Heap abstraction for page-based allocation.
 class BaseHeap {
  public:
@@ -199,8 +245,24 @@ class BaseHeap {
   xe::memory::PageAccess QueryRangeAccess(uint32_t low_address,
                                           uint32_t high_address);
 
-  bool Save(ByteStream* stream);
-  bool Restore(ByteStream* stream);
+  // Guest address space is saved in kStateChunkSize chunks compressed in
+  // parallel, with zero pages elided. Chunks with hashes matching
+  // base_chunk_hashes are not stored, and are taken from the base state on
+  // restore.
+  static constexpr uint32_t kStateChunkSize = 256 * 1024;
+  bool Save(ByteStream* stream,
+            const std::vector<uint64_t>* base_chunk_hashes = nullptr,
+            std::vector<uint64_t>* chunk_hashes_out = nullptr);
+  // base_stream must be positioned at the state of the heap in the base state
+  // if the state was saved against one. The hashes of the chunks of the state
+  // later states can be saved against (the base state if there's one) are
+  // written to base_chunk_hashes_out.
+  bool Restore(ByteStream* stream, ByteStream* base_stream = nullptr,
+               std::vector<uint64_t>* base_chunk_hashes_out = nullptr);
+  // Snapshots are encoded the same way as saved states, with the chunks not
+  // changed since the previous snapshot taken from it.
+  bool TakeSnapshot(const HeapSnapshot* previous, HeapSnapshot& snapshot_out);
+  bool RestoreSnapshot(const HeapSnapshot& snapshot);
 
   void Reset();
 
@@ -214,6 +276,25 @@ class BaseHeap {
   // Rebuilds free_blocks_ by scanning page_table_. Used after Restore.
   void RebuildFreeBlocks();
 
+  // Location of the committed pages of a chunk being restored.
+  struct StateChunkSource {
+    uint64_t zero_page_mask = 0;
+    bool compressed = false;
+    const uint8_t* data = nullptr;
+    size_t data_length = 0;
+  };
+  uint32_t state_chunk_count() const;
+  bool SavePageTable(std::vector<uint8_t>& compressed_out) const;
+  bool RestorePageTable(const uint8_t* compressed, size_t compressed_size);
+  // Chunks with hashes matching reference_chunk_hashes are only hashed, and
+  // marked as unchanged.
+  void EncodeStateChunks(const std::vector<uint64_t>* reference_chunk_hashes,
+                         std::vector<MemoryStateChunk>& chunks_out,
+                         std::vector<uint8_t>& chunks_unchanged_out);
+  // Must be called after restoring the page table. Commits the pages, loads
+  // their contents and sets their protection.
+  bool DecodeStateChunks(const std::vector<StateChunkSource>& chunks);
+
   // Removes (or splits) the free block covering the given page range.
   void RemoveFreeBlock(uint32_t start_page, uint32_t page_count);
 
@@ -296,6 +377,16 @@ class PhysicalHeap : public BaseHeap {
                         bool is_write, bool unwatch_exact_range,
                         bool unprotect = true);
 
+  // Enables tracking of writes to the host view of the heap, once, for
+  // PhysicalWriteTracking::kHostTracker.
+  bool RegisterWriteTracker(xe::memory::WriteTracker& write_tracker);
+
+  // Triggers the invalidation callbacks for and unwatches the watched system
+  // pages written to according to the physical write map or the host write
+  // tracker, clearing their marks in the map. Returns the number of such
+  // pages. Must be called from the global critical region.
+  uint32_t CollectWrittenPages();
+
   uint32_t GetPhysicalAddress(uint32_t address) const;
 
   uint32_t SystemPagenumToGuestPagenum(uint32_t num) const {
@@ -326,6 +417,9 @@ class PhysicalHeap : public BaseHeap {
   // Protected by global_critical_region. Flags for each 64 system pages,
   // interleaved as blocks, so bit scan can be used to quickly extract ranges.
   std::vector<SystemPageFlagsBlock> system_page_flags_;
+  // Scratch for CollectWrittenPages with the host write tracker, one bit per
+  // system page, valid only for the blocks with watched pages.
+  std::vector<uint64_t> host_written_pages_;
 };
 
 // Models the entire guest memory system on the console.
@@ -517,6 +611,62 @@ class Memory {
       uint32_t length, bool is_write, bool unwatch_exact_range,
       bool unprotect = true);
 
+  PhysicalWriteTracking physical_write_tracking() const {
+    return physical_write_tracking_;
+  }
+
+  // With --host_write_tracking, the watched pages are not write-protected
+  // either, and the host kernel records the writes to the physical memory views
+  // instead, including the ones done by host code. Like with the write map,
+  // watched pages are invalidated only when PollPhysicalWrites is called.
+
+  // With --physical_write_map, guest stores to the physical memory views mark
+  // the 4 KB pages they write in a byte map instead of watched pages being
+  // write-protected, so invalidation doesn't cost an access violation and
+  // a protection change per page. The map is indexed by the offset from the
+  // virtual membase (with the 0xE0000000 host offset applied) shifted by
+  // kPhysicalWriteMapPageShift, and a byte rather than a bit is used per page
+  // so guest threads can mark pages concurrently without atomics. Watched
+  // pages are invalidated only when PollPhysicalWrites is called. Writes by
+  // host code are not tracked unless it calls MarkPhysicalWrite or triggers the
+  // callbacks explicitly.
+  // After marking the pages, the stores also mark the regions of
+  // 1 << kPhysicalWriteSummaryShift bytes containing them in the summary map,
+  // indexed the same way, so polling only visits the written regions rather
+  // than every watched page. The summary marks must become visible after the
+  // page marks.
+  static constexpr uint32_t kPhysicalWriteMapPageShift = 12;
+  static constexpr uint32_t kPhysicalWriteSummaryShift = 18;
+  static constexpr uint32_t kPhysicalWriteMapBase = 0xA0000000;
+  uint8_t* physical_write_map() const { return physical_write_map_; }
+  uint8_t* physical_write_summary() const { return physical_write_summary_; }
+  void MarkPhysicalWrite(uint32_t host_offset, uint32_t length) {
+    if (!physical_write_map_ || host_offset < kPhysicalWriteMapBase ||
+        !length) {
+      return;
+    }
+    uint64_t host_offset_last = uint64_t(host_offset) + length - 1;
+    physical_write_map_[host_offset >> kPhysicalWriteMapPageShift] = 1;
+    physical_write_map_[host_offset_last >> kPhysicalWriteMapPageShift] = 1;
+    std::atomic_thread_fence(std::memory_order_release);
+    physical_write_summary_[host_offset >> kPhysicalWriteSummaryShift] = 1;
+    physical_write_summary_[host_offset_last >> kPhysicalWriteSummaryShift] =
+        1;
+  }
+  // Triggers the invalidation callbacks for the watched pages written since
+  // the last poll with the write map or the host write tracker. Returns the
+  // number of such system pages.
+  uint32_t PollPhysicalWrites();
+
+  struct PhysicalWriteStats {
+    // Access violations caused by writing to watched physical memory.
+    uint64_t write_faults;
+    uint64_t polls;
+    // Watched system pages found written when polling.
+    uint64_t polled_pages;
+  };
+  PhysicalWriteStats GetPhysicalWriteStats();
+
   // Allocates virtual memory from the 'system' heap.
   // System memory is kept separate from game memory but is still accessible
   // using normal guest virtual addresses. Kernel structures and other internal
@@ -550,8 +700,14 @@ class Memory {
   // Dumps a map of all allocated memory to the log.
   void DumpMap();
 
-  bool Save(ByteStream* stream);
-  bool Restore(ByteStream* stream);
+  bool Save(ByteStream* stream, const MemoryStateHashes* delta_base = nullptr,
+            MemoryStateHashes* hashes_out = nullptr);
+  bool Restore(ByteStream* stream, ByteStream* base_stream = nullptr,
+               MemoryStateHashes* base_hashes_out = nullptr);
+  // For the in-memory rewind buffer. previous may be null.
+  bool TakeSnapshot(const MemorySnapshot* previous,
+                    MemorySnapshot& snapshot_out);
+  bool RestoreSnapshot(const MemorySnapshot& snapshot);
 
   void SetMMIOExceptionRecordingCallback(cpu::MmioAccessRecordCallback callback,
                                          void* context);
@@ -560,6 +716,9 @@ class Memory {
   int MapViews(uint8_t* mapping_base);
   void UnmapViews();
 
+  // Heaps with contents stored in saved states, in their order in the states.
+  std::array<BaseHeap*, 5> GetStateHeaps();
+
   static uint32_t HostToGuestVirtualThunk(const void* context,
                                           const void* host_address);
 
@@ -613,6 +772,17 @@ class Memory {
   xe::global_critical_region global_critical_region_;
   std::vector<std::pair<PhysicalMemoryInvalidationCallback, void*>*>
       physical_memory_invalidation_callbacks_;
+
+  PhysicalWriteTracking physical_write_tracking_ =
+      PhysicalWriteTracking::kProtect;
+  // Null unless --physical_write_map is enabled. The summary is in the same
+  // allocation as the map.
+  uint8_t* physical_write_map_ = nullptr;
+  uint8_t* physical_write_summary_ = nullptr;
+  // Null unless --host_write_tracking is enabled and supported by the host.
+  std::unique_ptr<xe::memory::WriteTracker> physical_write_tracker_;
+  // Protected by global_critical_region_.
+  PhysicalWriteStats physical_write_stats_ = {};
 };
 
 }  // namespace xe
@@ -0,0 +1,156 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "xenia/base/byte_stream.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/memory.h"
+#include "xenia/base/platform.h"
+#include "xenia/memory.h"
+
+DEFINE_uint32(memory_state_bench_size_mb, 256,
+              "Size of the synthetic heap image to save and restore, in MB.",
+              "Memory");
+DEFINE_uint32(memory_state_bench_delta_pages, 1024,
+              "Number of random pages to modify between the full and the "
+              "delta save.",
+              "Memory");
+
+namespace xe {
+
+namespace {
+
+constexpr uint32_t kBenchPageSize = 4096;
+
+// Roughly the composition of guest memory of a running title: a lot of zeros,
+// code and structured data that compresses well, and some textures and audio
+// that barely compress.
+void FillBenchPage(uint8_t* page, std::mt19937& random_engine) {
+  uint32_t kind = random_engine() % 8;
+  if (kind < 4) {
+    return;
+  }
+  if (kind < 7) {
+    // Structured data - big-endian words from a small set of values.
+    uint32_t values[16];
+    for (uint32_t& value : values) {
+      value = random_engine() & 0xFFFF00FF;
+    }
+    for (uint32_t i = 0; i < kBenchPageSize; i += sizeof(uint32_t)) {
+      std::memcpy(page + i, &values[random_engine() % 16], sizeof(uint32_t));
+    }
+    return;
+  }
+  for (uint32_t i = 0; i < kBenchPageSize; i += sizeof(uint32_t)) {
+    uint32_t value = random_engine();
+    std::memcpy(page + i, &value, sizeof(value));
+  }
+}
+
+}  // namespace
+
+// Saves and restores a synthetic guest heap image fully and as a delta against
+// the full state, and reports the latency and the size of each.
+int memory_state_bench_main(const std::vector<std::string>& args) {
+  uint32_t heap_size =
+      std::clamp(cvars::memory_state_bench_size_mb, uint32_t(1), uint32_t(512))
+      << 20;
+  uint32_t page_count = heap_size / kBenchPageSize;
+  XELOGI("Saving a {} MB heap image", heap_size >> 20);
+
+  auto membase = static_cast<uint8_t*>(xe::memory::AllocFixed(
+      nullptr, heap_size, xe::memory::AllocationType::kReserveCommit,
+      xe::memory::PageAccess::kReadWrite));
+  if (!membase) {
+    XELOGE("Failed to allocate the heap image");
+    return 1;
+  }
+  VirtualHeap heap;
+  heap.Initialize(nullptr, membase, HeapType::kGuestVirtual, 0, heap_size,
+                  kBenchPageSize);
+  if (!heap.AllocFixed(0, heap_size, kBenchPageSize,
+                       kMemoryAllocationReserve | kMemoryAllocationCommit,
+                       kMemoryProtectRead | kMemoryProtectWrite)) {
+    XELOGE("Failed to commit the heap image");
+    xe::memory::DeallocFixed(membase, heap_size,
+                             xe::memory::DeallocationType::kRelease);
+    return 1;
+  }
+  std::mt19937 random_engine;
+  for (uint32_t i = 0; i < page_count; ++i) {
+    FillBenchPage(membase + size_t(kBenchPageSize) * i, random_engine);
+  }
+
+  // Enough for incompressible data and the chunk headers.
+  std::vector<uint8_t> full_state(heap_size + (heap_size >> 4) + (1 << 20));
+  std::vector<uint8_t> delta_state(full_state.size());
+  double tick_frequency = double(Clock::QueryHostTickFrequency());
+  auto get_ms = [tick_frequency](uint64_t start_ticks) {
+    return double(Clock::QueryHostTickCount() - start_ticks) * 1000.0 /
+           tick_frequency;
+  };
+  bool succeeded = true;
+
+  ByteStream full_save_stream(full_state.data(), full_state.size());
+  std::vector<uint64_t> full_chunk_hashes;
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  succeeded &= heap.Save(&full_save_stream, nullptr, &full_chunk_hashes);
+  double full_save_ms = get_ms(start_ticks);
+
+  ByteStream full_restore_stream(full_state.data(), full_save_stream.offset());
+  start_ticks = Clock::QueryHostTickCount();
+  succeeded &= heap.Restore(&full_restore_stream);
+  double full_restore_ms = get_ms(start_ticks);
+
+  for (uint32_t i = 0; i < cvars::memory_state_bench_delta_pages; ++i) {
+    membase[size_t(random_engine() % page_count) * kBenchPageSize +
+            random_engine() % kBenchPageSize] ^= 1;
+  }
+  ByteStream delta_save_stream(delta_state.data(), delta_state.size());
+  start_ticks = Clock::QueryHostTickCount();
+  succeeded &= heap.Save(&delta_save_stream, &full_chunk_hashes);
+  double delta_save_ms = get_ms(start_ticks);
+
+  ByteStream delta_restore_stream(delta_state.data(),
+                                  delta_save_stream.offset());
+  ByteStream base_restore_stream(full_state.data(), full_save_stream.offset());
+  start_ticks = Clock::QueryHostTickCount();
+  succeeded &= heap.Restore(&delta_restore_stream, &base_restore_stream);
+  double delta_restore_ms = get_ms(start_ticks);
+
+  xe::memory::DeallocFixed(membase, heap_size,
+                           xe::memory::DeallocationType::kRelease);
+  if (!succeeded) {
+    XELOGE("Failed to save or restore the heap image");
+    return 1;
+  }
+  XELOGI("Full: {:.2f} MB ({:.1f}%), save {:.2f} ms, restore {:.2f} ms",
+         double(full_save_stream.offset()) / (1024.0 * 1024.0),
+         double(full_save_stream.offset()) * 100.0 / double(heap_size),
+         full_save_ms, full_restore_ms);
+  XELOGI("Delta: {:.2f} MB ({:.1f}%), save {:.2f} ms, restore {:.2f} ms",
+         double(delta_save_stream.offset()) / (1024.0 * 1024.0),
+         double(delta_save_stream.offset()) * 100.0 / double(heap_size),
+         delta_save_ms, delta_restore_ms);
+  return 0;
+}
+
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-memory-state-bench", xe::memory_state_bench_main,
+                      "");
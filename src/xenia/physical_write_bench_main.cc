@@ -0,0 +1,178 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xenia/base/clock.h"
+#include "xenia/base/console_app_main.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/platform.h"
+#include "xenia/memory.h"
+
+DEFINE_uint32(physical_write_bench_size_mb, 64,
+              "Size of the watched physical memory region, in MB.", "Memory");
+DEFINE_uint32(physical_write_bench_iterations, 16,
+              "Number of times every page of the region is watched and "
+              "written to.",
+              "Memory");
+
+DECLARE_bool(host_write_tracking);
+DECLARE_bool(physical_write_map);
+
+namespace xe {
+
+namespace {
+
+constexpr uint32_t kBenchPageSize = 4096;
+// Polls done with the region watched but not written to, like the draws
+// between the CPU writes, in each iteration.
+constexpr uint32_t kBenchIdlePolls = 64;
+
+struct BenchResult {
+  bool supported = false;
+  double write_ms = 0.0;
+  double poll_ms = 0.0;
+  double idle_poll_ms = 0.0;
+  uint64_t invalidated_pages = 0;
+  Memory::PhysicalWriteStats stats = {};
+};
+
+std::pair<uint32_t, uint32_t> CountInvalidation(void* context_ptr,
+                                                uint32_t physical_address_start,
+                                                uint32_t length,
+                                                bool exact_range) {
+  *static_cast<uint64_t*>(context_ptr) += length / kBenchPageSize;
+  return std::make_pair(uint32_t(0), UINT32_MAX);
+}
+
+// Watches the region, then writes a word to every page of it like a title
+// filling a vertex buffer, either faulting on every page, or marking the pages
+// in the write map or letting the host kernel track them and polling
+// afterwards like the GPU does before a draw.
+bool RunBench(PhysicalWriteTracking tracking, uint32_t region_size,
+              BenchResult& result) {
+  cvars::physical_write_map = tracking == PhysicalWriteTracking::kWriteMap;
+  cvars::host_write_tracking = tracking == PhysicalWriteTracking::kHostTracker;
+  // Only one Memory may exist at a time.
+  auto memory = std::make_unique<Memory>();
+  if (!memory->Initialize()) {
+    XELOGE("Failed to initialize the memory");
+    return false;
+  }
+  if (memory->physical_write_tracking() != tracking) {
+    return true;
+  }
+  result.supported = true;
+  BaseHeap* heap = memory->LookupHeapByType(true, kBenchPageSize);
+  uint32_t address;
+  if (!heap->Alloc(region_size, kBenchPageSize,
+                   kMemoryAllocationReserve | kMemoryAllocationCommit,
+                   kMemoryProtectRead | kMemoryProtectWrite, false, &address)) {
+    XELOGE("Failed to allocate the physical memory region");
+    return false;
+  }
+  uint32_t physical_address = memory->GetPhysicalAddress(address);
+  auto host_address = memory->TranslateVirtual<uint8_t*>(address);
+  auto host_offset = uint32_t(host_address - memory->virtual_membase());
+  void* callback_handle = memory->RegisterPhysicalMemoryInvalidationCallback(
+      CountInvalidation, &result.invalidated_pages);
+
+  double tick_frequency = double(Clock::QueryHostTickFrequency());
+  auto get_ms = [tick_frequency](uint64_t start_ticks) {
+    return double(Clock::QueryHostTickCount() - start_ticks) * 1000.0 /
+           tick_frequency;
+  };
+  for (uint32_t i = 0; i < cvars::physical_write_bench_iterations; ++i) {
+    memory->EnablePhysicalMemoryAccessCallbacks(physical_address, region_size,
+                                                true, false);
+    uint64_t start_ticks = Clock::QueryHostTickCount();
+    for (uint32_t j = 0; j < kBenchIdlePolls; ++j) {
+      memory->PollPhysicalWrites();
+    }
+    result.idle_poll_ms += get_ms(start_ticks);
+    start_ticks = Clock::QueryHostTickCount();
+    for (uint32_t offset = 0; offset < region_size; offset += kBenchPageSize) {
+      *reinterpret_cast<volatile uint32_t*>(host_address + offset) = i;
+      // What the recompiled store does after writing.
+      memory->MarkPhysicalWrite(host_offset + offset, sizeof(uint32_t));
+    }
+    result.write_ms += get_ms(start_ticks);
+    start_ticks = Clock::QueryHostTickCount();
+    memory->PollPhysicalWrites();
+    result.poll_ms += get_ms(start_ticks);
+  }
+
+  result.stats = memory->GetPhysicalWriteStats();
+  memory->UnregisterPhysicalMemoryInvalidationCallback(callback_handle);
+  return true;
+}
+
+void LogBenchResult(const char* name, uint32_t page_count,
+                    const BenchResult& result) {
+  if (!result.supported) {
+    XELOGI("{}: not supported", name);
+    return;
+  }
+  double iterations =
+      double(std::max(cvars::physical_write_bench_iterations, 1u));
+  double writes = double(page_count) * iterations;
+  XELOGI(
+      "{}: {:.1f} ns per page written, {:.1f} ns per page polled, {:.2f} us "
+      "per poll with nothing written, {} pages invalidated, {} faults, {} "
+      "polls finding {} pages",
+      name, result.write_ms * 1000000.0 / writes,
+      result.poll_ms * 1000000.0 / writes,
+      result.idle_poll_ms * 1000.0 / (iterations * kBenchIdlePolls),
+      result.invalidated_pages, result.stats.write_faults, result.stats.polls,
+      result.stats.polled_pages);
+}
+
+}  // namespace
+
+// Compares the cost of catching guest writes to GPU-watched physical memory
+// with access violations, with the --physical_write_map page map and with the
+// --host_write_tracking kernel tracker.
+int physical_write_bench_main(const std::vector<std::string>& args) {
+  uint32_t region_size =
+      std::clamp(cvars::physical_write_bench_size_mb, uint32_t(1),
+                 uint32_t(256))
+      << 20;
+  uint32_t page_count = region_size / kBenchPageSize;
+  XELOGI("Writing to {} watched pages {} times", page_count,
+         cvars::physical_write_bench_iterations);
+
+  bool write_map = cvars::physical_write_map;
+  bool host_write_tracking = cvars::host_write_tracking;
+  BenchResult fault_result, map_result, host_tracker_result;
+  bool succeeded =
+      RunBench(PhysicalWriteTracking::kProtect, region_size, fault_result) &&
+      RunBench(PhysicalWriteTracking::kWriteMap, region_size, map_result) &&
+      RunBench(PhysicalWriteTracking::kHostTracker, region_size,
+               host_tracker_result);
+  cvars::physical_write_map = write_map;
+  cvars::host_write_tracking = host_write_tracking;
+  if (!succeeded) {
+    return 1;
+  }
+  LogBenchResult("Access violations", page_count, fault_result);
+  LogBenchResult("Write map", page_count, map_result);
+  LogBenchResult("Host write tracker", page_count, host_tracker_result);
+  return 0;
+}
+
+}  // namespace xe
+
+XE_DEFINE_CONSOLE_APP("xenia-physical-write-bench",
+                      xe::physical_write_bench_main, "");
@@ -0,0 +1,216 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/rewind_buffer.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "xenia/apu/audio_system.h"
+#include "xenia/base/byte_stream.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/cvar.h"
+#include "xenia/base/literals.h"
+#include "xenia/base/logging.h"
+#include "xenia/cpu/processor.h"
+#include "xenia/emulator.h"
+#include "xenia/gpu/command_processor.h"
+#include "xenia/gpu/graphics_system.h"
+#include "xenia/kernel/kernel_state.h"
+
+DEFINE_uint32(rewind_interval, 0,
+              "Number of frames (guest vertical blanks) between the in-memory "
+              "snapshots of the emulator state for rewinding with Backspace. "
+              "0 to disable rewinding.",
+              "General");
+DEFINE_uint32(rewind_buffer_size_mb, 512,
+              "Maximum amount of memory taken by the rewind snapshots, in MB. "
+              "The oldest snapshots are dropped once it's exceeded.",
+              "General");
+
+namespace xe {
+
+using namespace xe::literals;
+
+namespace {
+
+// Enough for the state of the processor, the kernel objects and the GPU and
+// audio registers.
+constexpr size_t kSystemStateBufferSize = 64_MiB;
+
+uint32_t GetFrame(Emulator* emulator) {
+  gpu::GraphicsSystem* graphics_system = emulator->graphics_system();
+  if (!graphics_system || !graphics_system->command_processor()) {
+    return 0;
+  }
+  return graphics_system->command_processor()->counter();
+}
+
+// Memory of the snapshot that is not shared with the previous one.
+size_t GetUnsharedSize(const RewindBuffer::Snapshot& snapshot,
+                       const RewindBuffer::Snapshot* previous) {
+  size_t size = snapshot.system_state.size();
+  const std::vector<HeapSnapshot>& heaps = snapshot.memory.heaps;
+  if (previous && previous->memory.heaps.size() != heaps.size()) {
+    previous = nullptr;
+  }
+  for (size_t i = 0; i < heaps.size(); ++i) {
+    const HeapSnapshot& heap = heaps[i];
+    const HeapSnapshot* previous_heap =
+        previous ? &previous->memory.heaps[i] : nullptr;
+    if (heap.page_table &&
+        (!previous_heap || previous_heap->page_table != heap.page_table)) {
+      size += heap.page_table->size();
+    }
+    if (previous_heap && previous_heap->chunks.size() != heap.chunks.size()) {
+      previous_heap = nullptr;
+    }
+    for (size_t j = 0; j < heap.chunks.size(); ++j) {
+      const std::shared_ptr<const MemoryStateChunk>& chunk = heap.chunks[j];
+      if (chunk && (!previous_heap || previous_heap->chunks[j] != chunk)) {
+        size += sizeof(MemoryStateChunk) + chunk->data.size();
+      }
+    }
+  }
+  return size;
+}
+
+}  // namespace
+
+RewindBuffer::RewindBuffer(Emulator* emulator) : emulator_(emulator) {}
+
+RewindBuffer::~RewindBuffer() { Stop(); }
+
+void RewindBuffer::Start() {
+  if (!cvars::rewind_interval || worker_thread_) {
+    return;
+  }
+  worker_running_ = true;
+  worker_thread_ =
+      threading::Thread::Create({}, [this]() { WorkerThreadMain(); });
+  if (worker_thread_) {
+    worker_thread_->set_name("Rewind");
+  }
+}
+
+void RewindBuffer::Stop() {
+  worker_running_ = false;
+  if (worker_thread_) {
+    threading::Wait(worker_thread_.get(), false);
+    worker_thread_.reset();
+  }
+}
+
+void RewindBuffer::WorkerThreadMain() {
+  uint32_t last_snapshot_frame = GetFrame(emulator_);
+  while (worker_running_) {
+    // Polled much more often than the guest frame rate.
+    threading::Sleep(std::chrono::milliseconds(2));
+    if (rewind_requested_.exchange(false)) {
+      emulator_->Rewind();
+      last_snapshot_frame = GetFrame(emulator_);
+      continue;
+    }
+    uint32_t frame = GetFrame(emulator_);
+    if (frame - last_snapshot_frame < cvars::rewind_interval) {
+      continue;
+    }
+    if (!emulator_->is_title_open() || emulator_->is_paused()) {
+      last_snapshot_frame = frame;
+      continue;
+    }
+    emulator_->TakeRewindSnapshot();
+    last_snapshot_frame = GetFrame(emulator_);
+  }
+}
+
+bool RewindBuffer::TakeSnapshot() {
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+
+  auto snapshot = std::make_unique<Snapshot>();
+  snapshot->frame = GetFrame(emulator_);
+  if (!system_state_buffer_) {
+    // Not initialized so only the used part is committed.
+    system_state_buffer_.reset(new uint8_t[kSystemStateBufferSize]);
+  }
+  ByteStream stream(system_state_buffer_.get(), kSystemStateBufferSize);
+  if (!emulator_->processor()->Save(&stream) ||
+      !emulator_->graphics_system()->Save(&stream) ||
+      !emulator_->audio_system()->Save(&stream) ||
+      !emulator_->kernel_state()->Save(&stream)) {
+    XELOGE("Failed to save the system state for rewinding");
+    return false;
+  }
+  snapshot->system_state.assign(system_state_buffer_.get(),
+                                system_state_buffer_.get() + stream.offset());
+
+  const Snapshot* previous =
+      snapshots_.empty() ? nullptr : snapshots_.back().get();
+  if (!emulator_->memory()->TakeSnapshot(previous ? &previous->memory : nullptr,
+                                         snapshot->memory)) {
+    XELOGE("Failed to take a snapshot of the guest memory for rewinding");
+    return false;
+  }
+  snapshot->size = GetUnsharedSize(*snapshot, previous);
+
+  double snapshot_ms = double(Clock::QueryHostTickCount() - start_ticks) *
+                       1000.0 / double(Clock::QueryHostTickFrequency());
+  ++stats_.snapshots_taken;
+  stats_.last_snapshot_ms = snapshot_ms;
+  stats_.last_snapshot_size = snapshot->size;
+  stats_.total_snapshot_ms += snapshot_ms;
+  stats_.size += snapshot->size;
+  snapshots_.push_back(std::move(snapshot));
+  DropOldSnapshots();
+
+  XELOGD(
+      "Rewind snapshot taken in {:.2f} ms ({:.3f} ms per frame on average), "
+      "{} new bytes, {} snapshots in {:.1f} MB",
+      snapshot_ms,
+      stats_.total_snapshot_ms /
+          double(stats_.snapshots_taken *
+                 std::max(cvars::rewind_interval, uint32_t(1))),
+      stats_.last_snapshot_size, stats_.snapshot_count,
+      double(stats_.size) / double(1_MiB));
+  return true;
+}
+
+std::unique_ptr<RewindBuffer::Snapshot> RewindBuffer::PopSnapshot() {
+  if (snapshots_.empty()) {
+    return nullptr;
+  }
+  std::unique_ptr<Snapshot> snapshot = std::move(snapshots_.back());
+  snapshots_.pop_back();
+  stats_.size -= snapshot->size;
+  stats_.snapshot_count = snapshots_.size();
+  return snapshot;
+}
+
+void RewindBuffer::Clear() {
+  snapshots_.clear();
+  stats_.size = 0;
+  stats_.snapshot_count = 0;
+}
+
+void RewindBuffer::DropOldSnapshots() {
+  size_t budget = size_t(cvars::rewind_buffer_size_mb) * 1_MiB;
+  // The newest snapshot is kept even if it alone exceeds the budget.
+  while (snapshots_.size() > 1 && stats_.size > budget) {
+    stats_.size -= snapshots_.front()->size;
+    snapshots_.pop_front();
+    // Now owns the memory it was sharing with the dropped snapshot.
+    Snapshot& oldest = *snapshots_.front();
+    stats_.size -= oldest.size;
+    oldest.size = GetUnsharedSize(oldest, nullptr);
+    stats_.size += oldest.size;
+  }
+  stats_.snapshot_count = snapshots_.size();
+}
+
+}  // namespace xe
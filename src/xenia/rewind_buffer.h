@@ -0,0 +1,94 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2026 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_REWIND_BUFFER_H_
+#define XENIA_REWIND_BUFFER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "xenia/base/threading.h"
+#include "xenia/memory.h"
+
+namespace xe {
+
+class Emulator;
+
+// Bounded ring of in-memory snapshots of the emulator state, taken every
+// --rewind_interval frames by a host thread, for rewinding without going
+// through save state files. Guest memory chunks that haven't changed between
+// consecutive snapshots are shared, so a snapshot mostly costs the memory the
+// guest has written to since the previous one. The oldest snapshots are
+// dropped once --rewind_buffer_size_mb is exceeded.
+//
+// Not thread-safe - accessed by the Emulator under its rewind lock.
+class RewindBuffer {
+ public:
+  struct Snapshot {
+    // Processor, graphics system, audio system and kernel state.
+    std::vector<uint8_t> system_state;
+    MemorySnapshot memory;
+    // Guest vertical blank counter when the snapshot was taken.
+    uint32_t frame;
+    // Memory not shared with the previous snapshot in the buffer.
+    size_t size;
+  };
+
+  struct Stats {
+    size_t snapshot_count = 0;
+    size_t size = 0;
+    uint64_t snapshots_taken = 0;
+    double last_snapshot_ms = 0.0;
+    size_t last_snapshot_size = 0;
+    double total_snapshot_ms = 0.0;
+  };
+
+  explicit RewindBuffer(Emulator* emulator);
+  ~RewindBuffer();
+
+  // Starts taking snapshots if --rewind_interval is not 0.
+  void Start();
+  void Stop();
+
+  // The emulator must be paused.
+  bool TakeSnapshot();
+  // Removes the newest snapshot from the buffer and returns it, or null if the
+  // buffer is empty.
+  std::unique_ptr<Snapshot> PopSnapshot();
+  void Clear();
+
+  // Makes the worker thread rewind to the newest snapshot, so the caller
+  // (the UI thread) isn't blocked by the restore.
+  void RequestRewind() { rewind_requested_ = true; }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  void WorkerThreadMain();
+  void DropOldSnapshots();
+
+  Emulator* emulator_;
+
+  std::deque<std::unique_ptr<Snapshot>> snapshots_;
+  Stats stats_;
+  // Reused to avoid committing new memory for every snapshot.
+  std::unique_ptr<uint8_t[]> system_state_buffer_;
+
+  std::atomic<bool> worker_running_ = false;
+  std::atomic<bool> rewind_requested_ = false;
+  std::unique_ptr<threading::Thread> worker_thread_;
+};
+
+}  // namespace xe
+
+#endif  // XENIA_REWIND_BUFFER_H_